@@ -25,6 +25,9 @@ import com.android.inputmethod.latin.SuggestedWords.SuggestedWordInfo;
 import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.Locale;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.locks.ReentrantReadWriteLock;
 
 /**
  * Implements a static, compacted, binary dictionary of standard words.
@@ -35,20 +38,196 @@ public final class BinaryDictionary extends Dictionary {
     // Must be equal to MAX_WORD_LENGTH in native/jni/src/defines.h
     private static final int MAX_WORD_LENGTH = Constants.Dictionary.MAX_WORD_LENGTH;
     // Must be equal to MAX_RESULTS in native/jni/src/defines.h
-    private static final int MAX_RESULTS = 18;
+    static final int MAX_RESULTS = 18;
+    // Must be equal to MAX_SUGGESTION_BATCH_SIZE in native/jni/src/defines.h
+    private static final int MAX_SUGGESTION_BATCH_SIZE = 16;
+    // Must be equal to MAX_PACKED_RESULTS_LENGTH in native/jni/src/defines.h
+    private static final int MAX_PACKED_RESULTS_LENGTH = 1 + MAX_RESULTS * (3 + MAX_WORD_LENGTH);
+    // Must be equal to MAX_COLLECTION_DICTIONARY_COUNT in native/jni/src/defines.h
+    static final int MAX_COLLECTION_DICTIONARY_COUNT = 4;
+    // Must be equal to MAX_COLLECTION_PACKED_RESULTS_LENGTH in native/jni/src/defines.h
+    private static final int MAX_COLLECTION_PACKED_RESULTS_LENGTH =
+            1 + MAX_COLLECTION_DICTIONARY_COUNT * MAX_RESULTS * (4 + MAX_WORD_LENGTH);
 
-    private long mNativeDict;
+    // How the native code maps and warms up the dictionary file.
+    // Must be equal to LOAD_OPTION_* in native/jni/src/dictionary.h
+    public static final int LOAD_OPTION_NONE = 0;
+    // Disables read-ahead, as the trie is read in no particular order.
+    public static final int LOAD_OPTION_ADVISE_RANDOM = 0x1;
+    // Starts reading the whole file into the page cache.
+    public static final int LOAD_OPTION_ADVISE_WILLNEED = 0x2;
+    // Touches the pages of the first levels of the trie on a background thread.
+    public static final int LOAD_OPTION_PREFETCH_HOT_NODES = 0x4;
+    // Locks the pages of the first levels of the trie in memory.
+    public static final int LOAD_OPTION_LOCK_HOT_NODES = 0x8;
+    // Moves the pages of the first levels of the trie to anonymous memory, which the page cache
+    // can not reclaim. Only for mapped dictionaries.
+    public static final int LOAD_OPTION_COPY_HOT_NODES = 0x10;
+    // Does not build the indexes of the trie, which take about 13 times its size in memory, if
+    // the native library is built with FLAG_OPEN_TIME_INDEXES. The searches read the trie
+    // directly instead, more slowly, and there are no completions.
+    public static final int LOAD_OPTION_LOW_RAM = 0x20;
+    public static final int LOAD_OPTIONS_FOR_MAIN_DICTIONARY = LOAD_OPTION_ADVISE_RANDOM
+            | LOAD_OPTION_ADVISE_WILLNEED | LOAD_OPTION_PREFETCH_HOT_NODES;
+    // Only the pages of the trie that are read are kept in memory, where they can be reclaimed.
+    public static final int LOAD_OPTIONS_FOR_MAIN_DICTIONARY_ON_LOW_RAM_DEVICE =
+            LOAD_OPTION_ADVISE_RANDOM | LOAD_OPTION_LOW_RAM;
+
+    // The categories of the native memory usage, in bytes.
+    // Must be equal to MEMORY_USAGE_* in native/jni/src/dictionary.h
+    // The size of the dictionary data, mapped from the file or allocated.
+    public static final int MEMORY_USAGE_DICTIONARY_MAPPED = 0;
+    // The part of the dictionary data in memory.
+    public static final int MEMORY_USAGE_DICTIONARY_RESIDENT = 1;
+    // The indexes built when the dictionary is opened, and the words of an updatable dictionary.
+    public static final int MEMORY_USAGE_DICTIONARY_INDEXES = 2;
+    // The queues of DicNodes of the sessions, sized for their capacity.
+    public static final int MEMORY_USAGE_SESSION_QUEUES = 3;
+    // The caches the sessions keep from a call to the next, e.g. the bigram maps.
+    public static final int MEMORY_USAGE_SESSION_CACHES = 4;
+    // The input states and the scratch buffers of the sessions.
+    public static final int MEMORY_USAGE_SESSION_OTHERS = 5;
+    // The tables of the proximity info of a keyboard.
+    public static final int MEMORY_USAGE_PROXIMITY_INFO = 6;
+    public static final int MEMORY_USAGE_CATEGORY_COUNT = 7;
+
+    // The counters of the work of the native searches.
+    // Must be equal to STATISTIC_* in native/jni/src/suggest/core/session/search_statistics.h
+    public static final int STATISTIC_SEARCHES = 0;
+    // The DicNodes expanded, i.e. popped from the active queue of a session.
+    public static final int STATISTIC_EXPANDED_DIC_NODES = 1;
+    // The DicNodes pushed to the next active queue.
+    public static final int STATISTIC_PUSHED_DIC_NODES = 2;
+    // The pushes that dropped a DicNode because the next active queue was full.
+    public static final int STATISTIC_DROPPED_DIC_NODES = 3;
+    // The searches that continued from the DicNodes cached by the previous one, or restarted.
+    public static final int STATISTIC_CONTINUOUS_CACHE_HITS = 4;
+    public static final int STATISTIC_CONTINUOUS_CACHE_MISSES = 5;
+    // The terminal DicNodes found, before the best ones are kept.
+    public static final int STATISTIC_TERMINALS = 6;
+    // The largest sizes the queues reached, and the pushes that dropped a DicNode because a queue
+    // was full. The overflows of the next active queue are the STATISTIC_DROPPED_DIC_NODES.
+    public static final int STATISTIC_ACTIVE_QUEUE_HIGH_WATER_MARK = 7;
+    public static final int STATISTIC_ACTIVE_QUEUE_OVERFLOWS = 8;
+    public static final int STATISTIC_NEXT_ACTIVE_QUEUE_HIGH_WATER_MARK = 9;
+    public static final int STATISTIC_TERMINAL_QUEUE_HIGH_WATER_MARK = 10;
+    public static final int STATISTIC_TERMINAL_QUEUE_OVERFLOWS = 11;
+    public static final int STATISTIC_CONTINUOUS_QUEUE_HIGH_WATER_MARK = 12;
+    public static final int STATISTIC_CONTINUOUS_QUEUE_OVERFLOWS = 13;
+    // The largest number and size in bytes of the cached bigram maps, and their evictions.
+    public static final int STATISTIC_BIGRAM_MAP_CACHE_HIGH_WATER_MARK = 14;
+    public static final int STATISTIC_BIGRAM_MAP_CACHE_BYTES_HIGH_WATER_MARK = 15;
+    public static final int STATISTIC_BIGRAM_MAP_CACHE_EVICTIONS = 16;
+    // The cached bigram predictions replaced by those of another previous word.
+    public static final int STATISTIC_BIGRAM_PREDICTION_CACHE_EVICTIONS = 17;
+    // The DicNodes dropped by the lower bound pruning before they were pushed to the next active
+    // queue. Always 0 unless the native library is built with FLAG_LOWER_BOUND_PRUNING.
+    public static final int STATISTIC_PRUNED_DIC_NODES = 18;
+    // The terminals of a word that the terminal queue already had, merged into the queued one.
+    public static final int STATISTIC_DUPLICATE_TERMINALS = 19;
+    // The queries answered from the cached suggestions of the previous ones without a search,
+    // and the cached suggestions replaced by those of another query.
+    public static final int STATISTIC_SUGGESTION_RESULT_CACHE_HITS = 20;
+    public static final int STATISTIC_SUGGESTION_RESULT_CACHE_EVICTIONS = 21;
+    public static final int STATISTIC_COUNT = 22;
+
+    // The layout of the native histograms of the latencies of the getSuggestions calls.
+    // Must be equal to LATENCY_* in native/jni/src/suggest/core/session/latency_histogram.h
+    public static final int LATENCY_INPUT_TYPE_TYPING = 0;
+    public static final int LATENCY_INPUT_TYPE_GESTURE = 1;
+    public static final int LATENCY_INPUT_TYPE_COUNT = 2;
+    // The class of an input size is its bit length, up to LATENCY_INPUT_SIZE_CLASS_COUNT - 1.
+    public static final int LATENCY_INPUT_SIZE_CLASS_COUNT = 8;
+    // The buckets per power of two of the latencies in microseconds.
+    public static final int LATENCY_SUB_BUCKET_COUNT = 4;
+    public static final int LATENCY_BUCKET_COUNT = 96;
+    public static final int LATENCY_HISTOGRAM_SIZE =
+            LATENCY_INPUT_TYPE_COUNT * LATENCY_INPUT_SIZE_CLASS_COUNT * LATENCY_BUCKET_COUNT;
+
+    // What the native tracing does with the time spans of the native calls, 0 to disable it.
+    // Must be equal to TRACE_FLAG_* in native/jni/src/trace_recorder.h
+    // Keeps the spans for drainNativeTraceSpans.
+    public static final int TRACE_FLAG_RECORD_SPANS = 0x1;
+    // Writes the spans as systrace markers, shown with the "LatinIME:" prefix.
+    public static final int TRACE_FLAG_SYSTRACE = 0x2;
+
+    // The phases of the native calls that are traced.
+    // Must be equal to PHASE_* in native/jni/src/trace_recorder.h
+    public static final int TRACE_PHASE_OPEN_DICTIONARY = 0;
+    public static final int TRACE_PHASE_GET_SUGGESTIONS = 1;
+    // Within TRACE_PHASE_GET_SUGGESTIONS, the setup of the input, the search and the output.
+    public static final int TRACE_PHASE_SESSION_SETUP = 2;
+    public static final int TRACE_PHASE_SEARCH = 3;
+    public static final int TRACE_PHASE_OUTPUT = 4;
+    public static final int TRACE_PHASE_GET_BIGRAMS = 5;
+
+    // The ticket of no asynchronous request.
+    // Must be equal to NOT_A_REQUEST_TICKET in native/jni/src/defines.h
+    public static final int NOT_A_TICKET = 0;
+
+    /**
+     * Receives the suggestions of a request submitted with
+     * {@link #getSuggestionsAsync(WordComposer, String, ProximityInfo, boolean, int,
+     * OnSuggestionsListener)}.
+     */
+    public interface OnSuggestionsListener {
+        /**
+         * Called on the worker thread of the dictionary, unless the request was cancelled.
+         * @param ticket the ticket returned when the request was submitted.
+         * @param suggestions the suggestions, or null.
+         */
+        public void onSuggestions(int ticket, ArrayList<SuggestedWordInfo> suggestions);
+    }
+
+    /**
+     * Notified when a dictionary opened in the background is ready.
+     */
+    public interface OnDictionaryLoadedListener {
+        /**
+         * Called on the worker thread of the dictionary.
+         * @param dictionary the dictionary that was opened.
+         * @param isValid whether it could be opened, i.e. {@link #isValidDictionary()}.
+         */
+        public void onDictionaryLoaded(BinaryDictionary dictionary, boolean isValid);
+    }
+
+    // Written by the worker thread when the dictionary is opened or swapped in the background.
+    // The queries read it with the lock of their session held, and the lookups without a session
+    // with the read lock of mNativeDictLock held, so that replaced data can be released once they
+    // are done; see swapDictionaryInBackground.
+    private volatile long mNativeDict;
+    private final ReentrantReadWriteLock mNativeDictLock = new ReentrantReadWriteLock();
+    // Guarded by this.
+    private boolean mIsClosed = false;
+    // The words of an updatable dictionary, which owns mNativeDict. Guarded by this.
+    private long mNativeUpdatableDict = 0;
+    // The probability overlay of the sessions, which this dictionary owns, or 0. It is not
+    // attached to mNativeDict, which other instances opening the same file share. Guarded by
+    // this, and written with the lock of mDicTraverseSessions held too, so that the sessions
+    // created meanwhile start with it.
+    private long mNativeProbabilityOverlay = 0;
     private final Locale mLocale;
-    private final int[] mInputCodePoints = new int[MAX_WORD_LENGTH];
-    private final int[] mOutputCodePoints = new int[MAX_WORD_LENGTH * MAX_RESULTS];
-    private final int[] mSpaceIndices = new int[MAX_RESULTS];
-    private final int[] mOutputScores = new int[MAX_RESULTS];
-    private final int[] mOutputTypes = new int[MAX_RESULTS];
 
     private final boolean mUseFullEditDistance;
 
     private final SparseArray<DicTraverseSession> mDicTraverseSessions =
             CollectionUtils.newSparseArray();
+    // The search profile of the sessions. Guarded by mDicTraverseSessions.
+    private int mSearchProfile = DicTraverseSession.SEARCH_PROFILE_DEFAULT;
+
+    // getSuggestionsFromDictionaries locks the sessions of several dictionaries by increasing
+    // identity hash code, so that two callers may not wait for each other's sessions. Two
+    // sessions with the same hash code have no order, so this is taken before them.
+    private static final Object sCollectionTieLock = new Object();
+
+    // Runs the background open and the asynchronous requests one after another. Created when
+    // first needed.
+    private ExecutorService mSuggestionExecutor;
+    // The requests that are queued or running, by ticket. Guarded by itself, as are
+    // mLastTicket and mSuggestionExecutor.
+    private final SparseArray<SuggestionRequest> mPendingRequests =
+            CollectionUtils.newSparseArray();
+    private int mLastTicket = NOT_A_TICKET;
 
     // TODO: There should be a way to remove used DicTraverseSession objects from
     // {@code mDicTraverseSessions}.
@@ -58,7 +237,9 @@ public final class BinaryDictionary extends Dictionary {
             if (traverseSession == null) {
                 traverseSession = mDicTraverseSessions.get(traverseSessionId);
                 if (traverseSession == null) {
-                    traverseSession = new DicTraverseSession(mLocale, mNativeDict);
+                    traverseSession =
+                            new DicTraverseSession(mLocale, mNativeDict, mSearchProfile);
+                    traverseSession.setProbabilityOverlay(mNativeProbabilityOverlay);
                     mDicTraverseSessions.put(traverseSessionId, traverseSession);
                 }
             }
@@ -77,32 +258,266 @@ public final class BinaryDictionary extends Dictionary {
      */
     public BinaryDictionary(final String filename, final long offset, final long length,
             final boolean useFullEditDistance, final Locale locale, final String dictType) {
+        this(filename, offset, length, useFullEditDistance, locale, dictType, LOAD_OPTION_NONE);
+    }
+
+    /**
+     * Constructor for the binary dictionary with the way to load it.
+     * @param filename the name of the file to read through native code.
+     * @param offset the offset of the dictionary data within the file.
+     * @param length the length of the binary data.
+     * @param useFullEditDistance whether to use the full edit distance in suggestions
+     * @param dictType the dictionary type, as a human-readable string
+     * @param loadOptions a combination of the LOAD_OPTION_* flags
+     */
+    public BinaryDictionary(final String filename, final long offset, final long length,
+            final boolean useFullEditDistance, final Locale locale, final String dictType,
+            final int loadOptions) {
+        super(dictType);
+        mLocale = locale;
+        mUseFullEditDistance = useFullEditDistance;
+        loadDictionary(filename, offset, length, loadOptions);
+    }
+
+    /**
+     * Constructor for the binary dictionary that opens it on the worker thread of the
+     * dictionary instead of the calling thread. Until then, it behaves like an empty dictionary:
+     * {@link #isValidDictionary()} is false and the queries return no results. The asynchronous
+     * requests submitted meanwhile run once it is open.
+     * @param filename the name of the file to read through native code.
+     * @param offset the offset of the dictionary data within the file.
+     * @param length the length of the binary data.
+     * @param useFullEditDistance whether to use the full edit distance in suggestions
+     * @param dictType the dictionary type, as a human-readable string
+     * @param loadOptions a combination of the LOAD_OPTION_* flags
+     * @param listener called when the dictionary is open, or null
+     */
+    public BinaryDictionary(final String filename, final long offset, final long length,
+            final boolean useFullEditDistance, final Locale locale, final String dictType,
+            final int loadOptions, final OnDictionaryLoadedListener listener) {
         super(dictType);
         mLocale = locale;
         mUseFullEditDistance = useFullEditDistance;
-        loadDictionary(filename, offset, length);
+        synchronized (mPendingRequests) {
+            getSuggestionExecutorLocked().execute(new Runnable() {
+                @Override
+                public void run() {
+                    loadDictionaryInBackground(filename, offset, length, loadOptions, listener);
+                }
+            });
+        }
+    }
+
+    /**
+     * Constructor for an updatable dictionary, which starts empty. The words are added with
+     * {@link #addUnigramWord(String, int, boolean)} and {@link #addBigramWords(String, String,
+     * int)} and are looked up by the queries once {@link #flushUpdates()} is called.
+     * @param useFullEditDistance whether to use the full edit distance in suggestions
+     * @param dictType the dictionary type, as a human-readable string
+     */
+    public BinaryDictionary(final boolean useFullEditDistance, final Locale locale,
+            final String dictType) {
+        super(dictType);
+        mLocale = locale;
+        mUseFullEditDistance = useFullEditDistance;
+        mNativeUpdatableDict = createUpdatableNative();
+        mNativeDict = flushUpdatableNative(mNativeUpdatableDict);
     }
 
     static {
         JniUtils.loadNativeLibrary();
     }
 
-    private static native long openNative(String sourceDir, long dictOffset, long dictSize);
+    private static native long openNative(String sourceDir, long dictOffset, long dictSize,
+            int loadOptions);
     private static native void closeNative(long dict);
     private static native int getProbabilityNative(long dict, int[] word);
+    private static native void getProbabilitiesNative(long dict, int[] wordOffsets,
+            int[] wordCodePoints, int[] outProbabilities);
+    private static native int getCompletionsNative(long dict, int[] prefix, int[] outCodePoints,
+            int[] outProbabilities);
     private static native boolean isValidBigramNative(long dict, int[] word1, int[] word2);
     private static native int getSuggestionsNative(long dict, long proximityInfo,
             long traverseSession, int[] xCoordinates, int[] yCoordinates, int[] times,
             int[] pointerIds, int[] inputCodePoints, int inputSize, int commitPoint,
             boolean isGesture, int[] prevWordCodePointArray, boolean useFullEditDistance,
             int[] outputCodePoints, int[] outputScores, int[] outputIndices, int[] outputTypes);
+    private static native int speculateNextInputNative(long dict, long proximityInfo,
+            long traverseSession, int[] xCoordinates, int[] yCoordinates, int[] times,
+            int[] pointerIds, int[] inputCodePoints, int inputSize, int[] prevWordCodePointArray,
+            int maxStepCount);
+    private static native int getSuggestionsBatchNative(long dict, long proximityInfo,
+            long traverseSession, int[] inputOffsets, int[] inputCodePoints, int[] xCoordinates,
+            int[] yCoordinates, int[] prevWordOffsets, int[] prevWordCodePoints,
+            boolean useFullEditDistance, int[] outputResults, int[] outputOffsets);
+    private static native int getSuggestionsFromDictionariesNative(long[] dicts,
+            long proximityInfo, long[] traverseSessions, int[] xCoordinates, int[] yCoordinates,
+            int[] times, int[] pointerIds, int[] inputCodePoints, int inputSize, boolean isGesture,
+            int[] prevWordCodePointArray, boolean[] useFullEditDistances, int[] outputResults);
+    private static native void getMemoryUsageNative(long dict, long updatableDict,
+            long probabilityOverlay, long traverseSession, long proximityInfo, int[] usage);
+    private static native void getSearchStatisticsNative(long traverseSession,
+            long[] statistics, boolean reset);
+    private static native void getLatencyHistogramNative(long traverseSession, int[] counts,
+            boolean reset);
+    private static native void setTraceFlagsNative(int flags);
+    private static native int drainTraceSpansNative(int[] phases, int[] threadIds,
+            long[] startTimesNs, long[] durationsNs);
+    private static native void startHeatMapNative(long dict, int samplingInterval);
+    private static native void stopHeatMapNative();
+    private static native boolean writeHeatMapNative(String path);
+    private static native long createUpdatableNative();
+    private static native boolean addUnigramWordNative(long updatableDict, int[] word,
+            int probability, boolean isNotAWord);
+    private static native boolean addBigramWordsNative(long updatableDict, int[] word0,
+            int[] word1, int probability);
+    private static native boolean removeUnigramWordNative(long updatableDict, int[] word);
+    private static native long flushUpdatableNative(long updatableDict);
+    private static native void releaseFlushedUpdatableNative(long updatableDict, long dict);
+    private static native void closeUpdatableNative(long updatableDict);
+    private static native long createProbabilityOverlayNative(long dict, int[] wordOffsets,
+            int[] wordCodePoints, int[] probabilities, int[] bigramWordIndices,
+            int[] bigramProbabilities);
+    private static native void releaseProbabilityOverlayNative(long overlay);
     private static native float calcNormalizedScoreNative(int[] before, int[] after, int score);
     private static native int editDistanceNative(int[] before, int[] after);
+    private static native void editDistancesNative(int[] before, int[] afterOffsets,
+            int[] afterCodePoints, int[] outDistances);
 
     // TODO: Move native dict into session
     private final void loadDictionary(final String path, final long startOffset,
-            final long length) {
-        mNativeDict = openNative(path, startOffset, length);
+            final long length, final int loadOptions) {
+        mNativeDict = openNative(path, startOffset, length, loadOptions);
+    }
+
+    private void loadDictionaryInBackground(final String path, final long startOffset,
+            final long length, final int loadOptions, final OnDictionaryLoadedListener listener) {
+        final long nativeDict = openNative(path, startOffset, length, loadOptions);
+        final boolean isValid;
+        synchronized (this) {
+            if (mIsClosed) {
+                // Closed while it was being opened
+                if (nativeDict != 0) {
+                    closeNative(nativeDict);
+                }
+                isValid = false;
+            } else {
+                mNativeDict = nativeDict;
+                isValid = nativeDict != 0;
+            }
+        }
+        if (null != listener) {
+            listener.onDictionaryLoaded(this, isValid);
+        }
+    }
+
+    /**
+     * Replaces the data of the dictionary with another file, e.g. an updated version of the
+     * same dictionary, without closing the dictionary or its sessions. The file is opened on the
+     * worker thread; the queries meanwhile use the current data, and the queries started after
+     * the swap use the new one. The current data is released once the queries using it are done.
+     * An updatable dictionary cannot be swapped.
+     * @param filename the name of the file to read through native code.
+     * @param offset the offset of the dictionary data within the file.
+     * @param length the length of the binary data.
+     * @param loadOptions a combination of the LOAD_OPTION_* flags
+     * @param listener called when the new data is used, or could not be opened, or null.
+     *        isValid is false in the latter case, and the dictionary keeps the current data.
+     */
+    public void swapDictionary(final String filename, final long offset, final long length,
+            final int loadOptions, final OnDictionaryLoadedListener listener) {
+        synchronized (mPendingRequests) {
+            getSuggestionExecutorLocked().execute(new Runnable() {
+                @Override
+                public void run() {
+                    swapDictionaryInBackground(filename, offset, length, loadOptions, listener);
+                }
+            });
+        }
+    }
+
+    private void swapDictionaryInBackground(final String path, final long startOffset,
+            final long length, final int loadOptions, final OnDictionaryLoadedListener listener) {
+        final long nativeDict = openNative(path, startOffset, length, loadOptions);
+        final boolean isSwapped;
+        long oldNativeDict = 0;
+        synchronized (this) {
+            if (mIsClosed || 0 != mNativeUpdatableDict || 0 == nativeDict) {
+                if (nativeDict != 0) {
+                    closeNative(nativeDict);
+                }
+                isSwapped = false;
+            } else {
+                // Waits for the lookups without a session that read the current data.
+                mNativeDictLock.writeLock().lock();
+                try {
+                    oldNativeDict = mNativeDict;
+                    mNativeDict = nativeDict;
+                } finally {
+                    mNativeDictLock.writeLock().unlock();
+                }
+                // The overlay has the word positions of the old data.
+                replaceProbabilityOverlayLocked(0);
+                isSwapped = true;
+            }
+        }
+        if (oldNativeDict != 0) {
+            waitForSessionQueries();
+            closeNative(oldNativeDict);
+        }
+        if (null != listener) {
+            listener.onDictionaryLoaded(this, isSwapped);
+        }
+    }
+
+    private ArrayList<DicTraverseSession> getTraverseSessions() {
+        final ArrayList<DicTraverseSession> sessions = CollectionUtils.newArrayList();
+        synchronized (mDicTraverseSessions) {
+            final int sessionsSize = mDicTraverseSessions.size();
+            for (int index = 0; index < sessionsSize; ++index) {
+                sessions.add(mDicTraverseSessions.valueAt(index));
+            }
+        }
+        return sessions;
+    }
+
+    /**
+     * Selects the search parameters of the sessions of the dictionary, e.g. to save battery on
+     * entry-level devices or in the power saving mode.
+     * @param searchProfile one of the DicTraverseSession.SEARCH_PROFILE_* constants.
+     */
+    public void setSearchProfile(final int searchProfile) {
+        final ArrayList<DicTraverseSession> sessions;
+        synchronized (mDicTraverseSessions) {
+            // The sessions created from now on start with the profile.
+            mSearchProfile = searchProfile;
+            sessions = getTraverseSessions();
+        }
+        for (final DicTraverseSession session : sessions) {
+            synchronized (session) {
+                // The session may not change while a query runs with it.
+                session.setSearchProfile(searchProfile);
+            }
+        }
+    }
+
+    // Waits for the queries that are running with the sessions, which may still read the data
+    // mNativeDict held before. The queries started later read the current mNativeDict.
+    private void waitForSessionQueries() {
+        final ArrayList<DicTraverseSession> sessions = getTraverseSessions();
+        for (final DicTraverseSession session : sessions) {
+            synchronized (session) {
+                // A query holds the lock of its session from reading mNativeDict to its end.
+            }
+        }
+    }
+
+    // Must be called with the lock of mPendingRequests held.
+    private ExecutorService getSuggestionExecutorLocked() {
+        if (null == mSuggestionExecutor) {
+            mSuggestionExecutor = Executors.newSingleThreadExecutor();
+        }
+        return mSuggestionExecutor;
     }
 
     @Override
@@ -119,57 +534,501 @@ public final class BinaryDictionary extends Dictionary {
             final boolean blockOffensiveWords, final int sessionId) {
         if (!isValidDictionary()) return null;
 
-        Arrays.fill(mInputCodePoints, Constants.NOT_A_CODE);
         // TODO: toLowerCase in the native code
         final int[] prevWordCodePointArray = (null == prevWord)
                 ? null : StringUtils.toCodePointArray(prevWord);
         final int composerSize = composer.size();
+        final boolean isGesture = composer.isBatchMode();
+        if ((composerSize <= 1 || !isGesture) && composerSize > MAX_WORD_LENGTH - 1) return null;
+
+        final DicTraverseSession session = getTraverseSession(sessionId);
+        // The native dictionary may serve several threads at once, but a session and its buffers
+        // hold the state of only one call at a time.
+        synchronized (session) {
+            return getSuggestionsLocked(session, composer, prevWordCodePointArray, proximityInfo,
+                    blockOffensiveWords);
+        }
+    }
 
+    // Must be called with the lock of the session held.
+    private ArrayList<SuggestedWordInfo> getSuggestionsLocked(final DicTraverseSession session,
+            final WordComposer composer, final int[] prevWordCodePointArray,
+            final ProximityInfo proximityInfo, final boolean blockOffensiveWords) {
+        final int composerSize = composer.size();
         final boolean isGesture = composer.isBatchMode();
+        final int[] inputCodePoints = session.mInputCodePoints;
+        Arrays.fill(inputCodePoints, Constants.NOT_A_CODE);
         if (composerSize <= 1 || !isGesture) {
-            if (composerSize > MAX_WORD_LENGTH - 1) return null;
             for (int i = 0; i < composerSize; i++) {
-                mInputCodePoints[i] = composer.getCodeAt(i);
+                inputCodePoints[i] = composer.getCodeAt(i);
             }
         }
 
         final InputPointers ips = composer.getInputPointers();
         final int inputSize = isGesture ? ips.getPointerSize() : composerSize;
         // proximityInfo and/or prevWordForBigrams may not be null.
-        final int count = getSuggestionsNative(mNativeDict, proximityInfo.getNativeProximityInfo(),
-                getTraverseSession(sessionId).getSession(), ips.getXCoordinates(),
-                ips.getYCoordinates(), ips.getTimes(), ips.getPointerIds(), mInputCodePoints,
-                inputSize, 0 /* commitPoint */, isGesture, prevWordCodePointArray,
-                mUseFullEditDistance, mOutputCodePoints, mOutputScores, mSpaceIndices,
-                mOutputTypes);
+        final int count = getSuggestionsNative(mNativeDict,
+                proximityInfo.getNativeProximityInfo(), session.getSession(),
+                ips.getXCoordinates(), ips.getYCoordinates(), ips.getTimes(),
+                ips.getPointerIds(), inputCodePoints, inputSize, 0 /* commitPoint */,
+                isGesture, prevWordCodePointArray, mUseFullEditDistance,
+                session.mOutputCodePoints, session.mOutputScores, session.mSpaceIndices,
+                session.mOutputTypes);
+        return toSuggestedWordInfos(count, session.mOutputCodePoints, session.mOutputScores,
+                session.mOutputTypes, blockOffensiveWords);
+    }
+
+    // Prepares the search of the next key after the given input, whichever it is. Must be called
+    // with the lock of the session held.
+    private void speculateNextInputLocked(final DicTraverseSession session,
+            final WordComposer composer, final int[] prevWordCodePointArray,
+            final ProximityInfo proximityInfo) {
+        final int composerSize = composer.size();
+        if (composer.isBatchMode() || composerSize <= 0 || composerSize >= MAX_WORD_LENGTH - 1) {
+            return;
+        }
+        final int[] inputCodePoints = session.mInputCodePoints;
+        for (int i = 0; i < composerSize; i++) {
+            inputCodePoints[i] = composer.getCodeAt(i);
+        }
+        final InputPointers ips = composer.getInputPointers();
+        speculateNextInputNative(mNativeDict, proximityInfo.getNativeProximityInfo(),
+                session.getSession(), ips.getXCoordinates(), ips.getYCoordinates(),
+                ips.getTimes(), ips.getPointerIds(), inputCodePoints, composerSize,
+                prevWordCodePointArray, session.getSpeculationStepBudget());
+    }
+
+    /**
+     * Gets the suggestions on the worker thread of the dictionary. A request that is obsolete,
+     * e.g. because the user typed the next key, should be cancelled with
+     * {@link #cancelSuggestions(int)}: its search then stops at the next input index instead of
+     * running to completion. The requests run one after another in the order of submission.
+     * When the session has a speculation budget and no other request is queued, the worker
+     * then prepares the search of the next key; see
+     * {@link DicTraverseSession#setSpeculationStepBudget(int)}.
+     * @param composer the input. It is copied, so it may be changed after this returns.
+     * @param listener called with the suggestions on the worker thread.
+     * @return the ticket to cancel the request with.
+     */
+    public int getSuggestionsAsync(final WordComposer composer, final String prevWord,
+            final ProximityInfo proximityInfo, final boolean blockOffensiveWords,
+            final int sessionId, final OnSuggestionsListener listener) {
+        final SuggestionRequest request;
+        synchronized (mPendingRequests) {
+            ++mLastTicket;
+            if (mLastTicket == NOT_A_TICKET) {
+                ++mLastTicket;
+            }
+            request = new SuggestionRequest(mLastTicket, new WordComposer(composer), prevWord,
+                    proximityInfo, blockOffensiveWords, sessionId, listener);
+            mPendingRequests.put(request.mTicket, request);
+            getSuggestionExecutorLocked().execute(request);
+        }
+        return request.mTicket;
+    }
+
+    /**
+     * Cancels a request submitted with {@link #getSuggestionsAsync}. Its listener is not called
+     * afterwards. This does nothing if the request has already finished.
+     * @param ticket the ticket returned by getSuggestionsAsync.
+     */
+    public void cancelSuggestions(final int ticket) {
+        final SuggestionRequest request;
+        synchronized (mPendingRequests) {
+            request = mPendingRequests.get(ticket);
+            if (null == request) return;
+            request.mIsCancelled = true;
+        }
+        if (request.mIsRunning) {
+            // The sessions are closed with this lock held.
+            synchronized (mDicTraverseSessions) {
+                request.mSession.cancelRequest(ticket);
+            }
+        }
+    }
+
+    /**
+     * Gets the suggestions published so far by the search of a request submitted with
+     * {@link #getSuggestionsAsync}, whose session has a progressive interval; see
+     * {@link DicTraverseSession#setProgressiveInterval(int, int)}. This may be called from any
+     * thread while the request runs, e.g. at each frame to update the suggestion strip.
+     * @param ticket the ticket returned by getSuggestionsAsync.
+     * @return the suggestions found so far, or null if the request is not running or published
+     * none yet.
+     */
+    public ArrayList<SuggestedWordInfo> getPartialSuggestions(final int ticket) {
+        final SuggestionRequest request;
+        synchronized (mPendingRequests) {
+            request = mPendingRequests.get(ticket);
+        }
+        if (null == request || request.mIsCancelled || !request.mIsRunning) return null;
+        final int[] outputCodePoints = new int[MAX_WORD_LENGTH * MAX_RESULTS];
+        final int[] outputScores = new int[MAX_RESULTS];
+        final int[] spaceIndices = new int[MAX_RESULTS];
+        final int[] outputTypes = new int[MAX_RESULTS];
+        final int count;
+        // The sessions are closed with this lock held.
+        synchronized (mDicTraverseSessions) {
+            count = request.mSession.getPublishedResults(ticket, outputCodePoints, outputScores,
+                    spaceIndices, outputTypes);
+        }
+        if (count <= 0) return null;
+        return toSuggestedWordInfos(count, outputCodePoints, outputScores, outputTypes,
+                request.mBlockOffensiveWords);
+    }
+
+    private final class SuggestionRequest implements Runnable {
+        final int mTicket;
+        private final WordComposer mComposer;
+        private final int[] mPrevWordCodePointArray;
+        private final ProximityInfo mProximityInfo;
+        private final boolean mBlockOffensiveWords;
+        private final int mSessionId;
+        private final OnSuggestionsListener mListener;
+        // Written by the thread that cancels the request and read by the worker, or the
+        // opposite. Each writes its own flag before reading the other's, so either the worker
+        // skips the request or the canceller stops the native search.
+        volatile boolean mIsCancelled;
+        volatile boolean mIsRunning;
+        volatile DicTraverseSession mSession;
+
+        public SuggestionRequest(final int ticket, final WordComposer composer,
+                final String prevWord, final ProximityInfo proximityInfo,
+                final boolean blockOffensiveWords, final int sessionId,
+                final OnSuggestionsListener listener) {
+            mTicket = ticket;
+            mComposer = composer;
+            mPrevWordCodePointArray = (null == prevWord)
+                    ? null : StringUtils.toCodePointArray(prevWord);
+            mProximityInfo = proximityInfo;
+            mBlockOffensiveWords = blockOffensiveWords;
+            mSessionId = sessionId;
+            mListener = listener;
+        }
+
+        @Override
+        public void run() {
+            ArrayList<SuggestedWordInfo> suggestions = null;
+            if (!mIsCancelled && isValidDictionary()) {
+                suggestions = runLocked();
+            }
+            synchronized (mPendingRequests) {
+                mPendingRequests.remove(mTicket);
+            }
+            if (!mIsCancelled) {
+                mListener.onSuggestions(mTicket, suggestions);
+                speculateIfIdle();
+            }
+        }
+
+        // Uses the idle time until the next request to prepare the search of the next key.
+        private void speculateIfIdle() {
+            final DicTraverseSession session = mSession;
+            if (null == session || session.getSpeculationStepBudget() <= 0) return;
+            synchronized (mPendingRequests) {
+                if (mPendingRequests.size() > 0 || null == mSuggestionExecutor) return;
+            }
+            synchronized (session) {
+                if (!isValidDictionary()) return;
+                speculateNextInputLocked(session, mComposer, mPrevWordCodePointArray,
+                        mProximityInfo);
+            }
+        }
+
+        private ArrayList<SuggestedWordInfo> runLocked() {
+            final int composerSize = mComposer.size();
+            if ((composerSize <= 1 || !mComposer.isBatchMode())
+                    && composerSize > MAX_WORD_LENGTH - 1) {
+                return null;
+            }
+            final DicTraverseSession session = getTraverseSession(mSessionId);
+            synchronized (session) {
+                session.setRequestTicket(mTicket);
+                mSession = session;
+                mIsRunning = true;
+                try {
+                    if (mIsCancelled) return null;
+                    return getSuggestionsLocked(session, mComposer, mPrevWordCodePointArray,
+                            mProximityInfo, mBlockOffensiveWords);
+                } finally {
+                    mIsRunning = false;
+                    session.setRequestTicket(NOT_A_TICKET);
+                }
+            }
+        }
+    }
+
+    /**
+     * Gets the suggestions of several typed words in as few native calls as possible. This is
+     * cheaper than one call per word when checking many words at once, e.g. a whole paragraph.
+     * Gesture inputs are not supported in a batch and are looked up one by one.
+     * @return the suggestions of each composer, in the same order, or null.
+     */
+    public ArrayList<ArrayList<SuggestedWordInfo>> getSuggestionsBatchWithSessionId(
+            final WordComposer[] composers, final String[] prevWords,
+            final ProximityInfo proximityInfo, final boolean blockOffensiveWords,
+            final int sessionId) {
+        if (!isValidDictionary()) return null;
+
+        final ArrayList<ArrayList<SuggestedWordInfo>> allSuggestions =
+                CollectionUtils.newArrayList(composers.length);
+        final int[] batchIndices = new int[MAX_SUGGESTION_BATCH_SIZE];
+        int batchSize = 0;
+        for (int i = 0; i < composers.length; ++i) {
+            final WordComposer composer = composers[i];
+            if (composer.isBatchMode() || composer.size() > MAX_WORD_LENGTH - 1) {
+                allSuggestions.add(getSuggestionsWithSessionId(composer, prevWords[i],
+                        proximityInfo, blockOffensiveWords, sessionId));
+                continue;
+            }
+            allSuggestions.add(null);
+            batchIndices[batchSize++] = i;
+            if (batchSize == MAX_SUGGESTION_BATCH_SIZE) {
+                getSuggestionsBatch(composers, prevWords, batchIndices, batchSize, proximityInfo,
+                        blockOffensiveWords, sessionId, allSuggestions);
+                batchSize = 0;
+            }
+        }
+        if (batchSize > 0) {
+            getSuggestionsBatch(composers, prevWords, batchIndices, batchSize, proximityInfo,
+                    blockOffensiveWords, sessionId, allSuggestions);
+        }
+        return allSuggestions;
+    }
+
+    private void getSuggestionsBatch(final WordComposer[] composers, final String[] prevWords,
+            final int[] batchIndices, final int batchSize, final ProximityInfo proximityInfo,
+            final boolean blockOffensiveWords, final int sessionId,
+            final ArrayList<ArrayList<SuggestedWordInfo>> outSuggestions) {
+        final int[] inputOffsets = new int[batchSize + 1];
+        final int[] prevWordOffsets = new int[batchSize + 1];
+        final int[][] prevWordCodePointArrays = new int[batchSize][];
+        for (int i = 0; i < batchSize; ++i) {
+            final String prevWord = prevWords[batchIndices[i]];
+            prevWordCodePointArrays[i] = (null == prevWord)
+                    ? null : StringUtils.toCodePointArray(prevWord);
+            final int prevWordLength = (null == prevWordCodePointArrays[i])
+                    ? 0 : Math.min(prevWordCodePointArrays[i].length, MAX_WORD_LENGTH);
+            inputOffsets[i + 1] = inputOffsets[i] + composers[batchIndices[i]].size();
+            prevWordOffsets[i + 1] = prevWordOffsets[i] + prevWordLength;
+        }
+        final int[] inputCodePoints = new int[inputOffsets[batchSize]];
+        final int[] xCoordinates = new int[inputOffsets[batchSize]];
+        final int[] yCoordinates = new int[inputOffsets[batchSize]];
+        final int[] prevWordCodePoints = new int[prevWordOffsets[batchSize]];
+        for (int i = 0; i < batchSize; ++i) {
+            final WordComposer composer = composers[batchIndices[i]];
+            final InputPointers ips = composer.getInputPointers();
+            final int start = inputOffsets[i];
+            final int size = inputOffsets[i + 1] - start;
+            for (int j = 0; j < size; ++j) {
+                inputCodePoints[start + j] = composer.getCodeAt(j);
+            }
+            System.arraycopy(ips.getXCoordinates(), 0, xCoordinates, start, size);
+            System.arraycopy(ips.getYCoordinates(), 0, yCoordinates, start, size);
+            if (null != prevWordCodePointArrays[i]) {
+                System.arraycopy(prevWordCodePointArrays[i], 0, prevWordCodePoints,
+                        prevWordOffsets[i], prevWordOffsets[i + 1] - prevWordOffsets[i]);
+            }
+        }
+        // The results of query i are packed from outputOffsets[i]; see
+        // toSuggestedWordInfosFromPacked.
+        final int[] outputResults = new int[MAX_PACKED_RESULTS_LENGTH * batchSize];
+        final int[] outputOffsets = new int[batchSize + 1];
+        final DicTraverseSession session = getTraverseSession(sessionId);
+        synchronized (session) {
+            getSuggestionsBatchNative(mNativeDict, proximityInfo.getNativeProximityInfo(),
+                    session.getSession(), inputOffsets, inputCodePoints, xCoordinates,
+                    yCoordinates, prevWordOffsets, prevWordCodePoints, mUseFullEditDistance,
+                    outputResults, outputOffsets);
+        }
+        for (int i = 0; i < batchSize; ++i) {
+            outSuggestions.set(batchIndices[i], toSuggestedWordInfosFromPacked(outputResults,
+                    outputOffsets[i], blockOffensiveWords));
+        }
+    }
+
+    /**
+     * Gets the suggestions of several dictionaries in one native call, which looks up the input
+     * once for all of them instead of once per dictionary. The suggestions of all the
+     * dictionaries are merged by score.
+     * @param dictionaries the dictionaries, at most {@link #MAX_COLLECTION_DICTIONARY_COUNT}.
+     * @return the suggestions, or null.
+     */
+    static ArrayList<SuggestedWordInfo> getSuggestionsFromDictionaries(
+            final BinaryDictionary[] dictionaries, final WordComposer composer,
+            final String prevWord, final ProximityInfo proximityInfo,
+            final boolean blockOffensiveWords, final int sessionId) {
+        final int dictionaryCount = dictionaries.length;
+        if (dictionaryCount <= 0 || dictionaryCount > MAX_COLLECTION_DICTIONARY_COUNT) {
+            throw new IllegalArgumentException();
+        }
+        final int composerSize = composer.size();
+        final boolean isGesture = composer.isBatchMode();
+        if ((composerSize <= 1 || !isGesture) && composerSize > MAX_WORD_LENGTH - 1) return null;
+
+        // TODO: toLowerCase in the native code
+        final int[] prevWordCodePointArray = (null == prevWord)
+                ? null : StringUtils.toCodePointArray(prevWord);
+        final DicTraverseSession[] sessions = new DicTraverseSession[dictionaryCount];
+        final boolean[] useFullEditDistances = new boolean[dictionaryCount];
+        for (int i = 0; i < dictionaryCount; ++i) {
+            sessions[i] = dictionaries[i].getTraverseSession(sessionId);
+            useFullEditDistances[i] = dictionaries[i].mUseFullEditDistance;
+        }
+        // The indices of the sessions by increasing identity hash code, in which they are locked
+        final int[] lockOrder = new int[dictionaryCount];
+        boolean hasTie = false;
+        for (int i = 0; i < dictionaryCount; ++i) {
+            final int hashCode = System.identityHashCode(sessions[i]);
+            int j = i;
+            for (; j > 0; --j) {
+                final int previousHashCode = System.identityHashCode(sessions[lockOrder[j - 1]]);
+                if (previousHashCode == hashCode && sessions[lockOrder[j - 1]] != sessions[i]) {
+                    hasTie = true;
+                }
+                if (previousHashCode <= hashCode) break;
+                lockOrder[j] = lockOrder[j - 1];
+            }
+            lockOrder[j] = i;
+        }
+        final int[] packedResults = new int[MAX_COLLECTION_PACKED_RESULTS_LENGTH];
+        final int count;
+        if (hasTie) {
+            synchronized (sCollectionTieLock) {
+                count = getSuggestionsFromDictionariesLocked(dictionaries, sessions, lockOrder,
+                        0 /* lockedCount */, composer, prevWordCodePointArray, proximityInfo,
+                        useFullEditDistances, packedResults);
+            }
+        } else {
+            count = getSuggestionsFromDictionariesLocked(dictionaries, sessions, lockOrder,
+                    0 /* lockedCount */, composer, prevWordCodePointArray, proximityInfo,
+                    useFullEditDistances, packedResults);
+        }
+        final ArrayList<SuggestedWordInfo> suggestions = CollectionUtils.newArrayList(count);
+        int start = 1 + count * 4;
+        for (int j = 0; j < count; ++j) {
+            final int dictionaryIndex = packedResults[1 + j * 4];
+            final int len = packedResults[2 + j * 4];
+            final SuggestedWordInfo suggestion =
+                    dictionaries[dictionaryIndex].toSuggestedWordInfo(packedResults, start,
+                            len, packedResults[3 + j * 4], packedResults[4 + j * 4],
+                            blockOffensiveWords);
+            if (null != suggestion) {
+                suggestions.add(suggestion);
+            }
+            start += len;
+        }
+        return suggestions;
+    }
+
+    // Locks the sessions at lockOrder[lockedCount] on, then searches the dictionaries into
+    // packedResults. Must be called with the lock of the sessions before lockedCount in lockOrder
+    // held, and with sCollectionTieLock held if two sessions have the same identity hash code.
+    private static int getSuggestionsFromDictionariesLocked(final BinaryDictionary[] dictionaries,
+            final DicTraverseSession[] sessions, final int[] lockOrder, final int lockedCount,
+            final WordComposer composer, final int[] prevWordCodePointArray,
+            final ProximityInfo proximityInfo, final boolean[] useFullEditDistances,
+            final int[] packedResults) {
+        if (lockedCount < sessions.length) {
+            synchronized (sessions[lockOrder[lockedCount]]) {
+                return getSuggestionsFromDictionariesLocked(dictionaries, sessions, lockOrder,
+                        lockedCount + 1, composer, prevWordCodePointArray, proximityInfo,
+                        useFullEditDistances, packedResults);
+            }
+        }
+        final int composerSize = composer.size();
+        final boolean isGesture = composer.isBatchMode();
+        final int[] inputCodePoints = sessions[0].mInputCodePoints;
+        Arrays.fill(inputCodePoints, Constants.NOT_A_CODE);
+        if (composerSize <= 1 || !isGesture) {
+            for (int i = 0; i < composerSize; i++) {
+                inputCodePoints[i] = composer.getCodeAt(i);
+            }
+        }
+        final long[] nativeDicts = new long[sessions.length];
+        final long[] nativeSessions = new long[sessions.length];
+        for (int i = 0; i < sessions.length; ++i) {
+            // A dictionary that is not open yet, or closed already, returns no results.
+            nativeDicts[i] = dictionaries[i].mNativeDict;
+            nativeSessions[i] = sessions[i].getSession();
+        }
+        final InputPointers ips = composer.getInputPointers();
+        final int inputSize = isGesture ? ips.getPointerSize() : composerSize;
+        return getSuggestionsFromDictionariesNative(nativeDicts,
+                proximityInfo.getNativeProximityInfo(), nativeSessions, ips.getXCoordinates(),
+                ips.getYCoordinates(), ips.getTimes(), ips.getPointerIds(), inputCodePoints,
+                inputSize, isGesture, prevWordCodePointArray, useFullEditDistances,
+                packedResults);
+    }
+
+    /**
+     * Reads the results of a query packed from offset: the count, then the length, the score
+     * and the type of each word, then the code points of the words one after the other.
+     */
+    private ArrayList<SuggestedWordInfo> toSuggestedWordInfosFromPacked(final int[] packedResults,
+            final int offset, final boolean blockOffensiveWords) {
+        final int count = packedResults[offset];
+        final ArrayList<SuggestedWordInfo> suggestions = CollectionUtils.newArrayList(count);
+        int start = offset + 1 + count * 3;
+        for (int j = 0; j < count; ++j) {
+            final int len = packedResults[offset + 1 + j * 3];
+            final int outputType = packedResults[offset + 3 + j * 3];
+            final SuggestedWordInfo suggestion = toSuggestedWordInfo(packedResults, start, len,
+                    packedResults[offset + 2 + j * 3], outputType, blockOffensiveWords);
+            if (null != suggestion) {
+                suggestions.add(suggestion);
+            }
+            start += len;
+        }
+        return suggestions;
+    }
+
+    private ArrayList<SuggestedWordInfo> toSuggestedWordInfos(final int count,
+            final int[] outputCodePoints, final int[] outputScores, final int[] outputTypes,
+            final boolean blockOffensiveWords) {
         final ArrayList<SuggestedWordInfo> suggestions = CollectionUtils.newArrayList();
         for (int j = 0; j < count; ++j) {
             final int start = j * MAX_WORD_LENGTH;
             int len = 0;
-            while (len < MAX_WORD_LENGTH && mOutputCodePoints[start + len] != 0) {
+            while (len < MAX_WORD_LENGTH && outputCodePoints[start + len] != 0) {
                 ++len;
             }
-            if (len > 0) {
-                final int flags = mOutputTypes[j] & SuggestedWordInfo.KIND_MASK_FLAGS;
-                if (blockOffensiveWords
-                        && 0 != (flags & SuggestedWordInfo.KIND_FLAG_POSSIBLY_OFFENSIVE)
-                        && 0 == (flags & SuggestedWordInfo.KIND_FLAG_EXACT_MATCH)) {
-                    // If we block potentially offensive words, and if the word is possibly
-                    // offensive, then we don't output it unless it's also an exact match.
-                    continue;
-                }
-                final int kind = mOutputTypes[j] & SuggestedWordInfo.KIND_MASK_KIND;
-                final int score = SuggestedWordInfo.KIND_WHITELIST == kind
-                        ? SuggestedWordInfo.MAX_SCORE : mOutputScores[j];
-                // TODO: check that all users of the `kind' parameter are ready to accept
-                // flags too and pass mOutputTypes[j] instead of kind
-                suggestions.add(new SuggestedWordInfo(new String(mOutputCodePoints, start, len),
-                        score, kind, mDictType));
+            final SuggestedWordInfo suggestion = toSuggestedWordInfo(outputCodePoints, start,
+                    len, outputScores[j], outputTypes[j], blockOffensiveWords);
+            if (null != suggestion) {
+                suggestions.add(suggestion);
             }
         }
         return suggestions;
     }
 
+    /**
+     * @return the suggestion of the len code points from start, or null if it is empty or
+     * blocked.
+     */
+    private SuggestedWordInfo toSuggestedWordInfo(final int[] codePoints, final int start,
+            final int len, final int outputScore, final int outputType,
+            final boolean blockOffensiveWords) {
+        if (len <= 0) {
+            return null;
+        }
+        final int flags = outputType & SuggestedWordInfo.KIND_MASK_FLAGS;
+        if (blockOffensiveWords
+                && 0 != (flags & SuggestedWordInfo.KIND_FLAG_POSSIBLY_OFFENSIVE)
+                && 0 == (flags & SuggestedWordInfo.KIND_FLAG_EXACT_MATCH)) {
+            // If we block potentially offensive words, and if the word is possibly
+            // offensive, then we don't output it unless it's also an exact match.
+            return null;
+        }
+        final int kind = outputType & SuggestedWordInfo.KIND_MASK_KIND;
+        final int score = SuggestedWordInfo.KIND_WHITELIST == kind
+                ? SuggestedWordInfo.MAX_SCORE : outputScore;
+        // TODO: check that all users of the `kind' parameter are ready to accept
+        // flags too and pass mOutputTypes[j] instead of kind
+        return new SuggestedWordInfo(new String(codePoints, start, len), score, kind, mDictType);
+    }
+
     public boolean isValidDictionary() {
         return mNativeDict != 0;
     }
@@ -188,6 +1047,37 @@ public final class BinaryDictionary extends Dictionary {
                 StringUtils.toCodePointArray(after));
     }
 
+    /**
+     * Computes the edit distances between a word and several words in one native call, which is
+     * cheaper than calling {@link #editDistance(String, String)} for each of them.
+     * @return the edit distance between before and each of afters, in the same order.
+     */
+    public static int[] editDistances(final String before, final String[] afters) {
+        if (before == null || afters == null) {
+            throw new IllegalArgumentException();
+        }
+        final int[] afterOffsets = new int[afters.length + 1];
+        final int[][] afterCodePointArrays = new int[afters.length][];
+        for (int i = 0; i < afters.length; ++i) {
+            if (afters[i] == null) {
+                throw new IllegalArgumentException();
+            }
+            afterCodePointArrays[i] = StringUtils.toCodePointArray(afters[i]);
+            afterOffsets[i + 1] = afterOffsets[i] + afterCodePointArrays[i].length;
+        }
+        final int[] afterCodePoints = new int[afterOffsets[afters.length]];
+        for (int i = 0; i < afters.length; ++i) {
+            System.arraycopy(afterCodePointArrays[i], 0, afterCodePoints, afterOffsets[i],
+                    afterCodePointArrays[i].length);
+        }
+        final int[] distances = new int[afters.length];
+        if (afters.length > 0) {
+            editDistancesNative(StringUtils.toCodePointArray(before), afterOffsets,
+                    afterCodePoints, distances);
+        }
+        return distances;
+    }
+
     @Override
     public boolean isValidWord(final String word) {
         return getFrequency(word) >= 0;
@@ -195,9 +1085,81 @@ public final class BinaryDictionary extends Dictionary {
 
     @Override
     public int getFrequency(final String word) {
-        if (word == null) return -1;
+        if (word == null || !isValidDictionary()) return -1;
         int[] codePoints = StringUtils.toCodePointArray(word);
-        return getProbabilityNative(mNativeDict, codePoints);
+        mNativeDictLock.readLock().lock();
+        try {
+            return getProbabilityNative(mNativeDict, codePoints);
+        } finally {
+            mNativeDictLock.readLock().unlock();
+        }
+    }
+
+    /**
+     * Looks several words up in one native call, which is cheaper than calling
+     * {@link #getFrequency(String)} for each of them, e.g. to spell check a whole document.
+     * @return the frequency of each of words, in the same order, or -1 for the words that are
+     * not in the dictionary.
+     */
+    @Override
+    public int[] getFrequencies(final String[] words) {
+        final int[] frequencies = new int[words.length];
+        Arrays.fill(frequencies, NOT_A_PROBABILITY);
+        if (words.length == 0 || !isValidDictionary()) return frequencies;
+        final int[] wordOffsets = new int[words.length + 1];
+        final int[][] wordCodePointArrays = new int[words.length][];
+        for (int i = 0; i < words.length; ++i) {
+            wordCodePointArrays[i] = words[i] == null ? new int[0]
+                    : StringUtils.toCodePointArray(words[i]);
+            wordOffsets[i + 1] = wordOffsets[i] + wordCodePointArrays[i].length;
+        }
+        final int[] wordCodePoints = new int[wordOffsets[words.length]];
+        for (int i = 0; i < words.length; ++i) {
+            System.arraycopy(wordCodePointArrays[i], 0, wordCodePoints, wordOffsets[i],
+                    wordCodePointArrays[i].length);
+        }
+        mNativeDictLock.readLock().lock();
+        try {
+            getProbabilitiesNative(mNativeDict, wordOffsets, wordCodePoints, frequencies);
+        } finally {
+            mNativeDictLock.readLock().unlock();
+        }
+        return frequencies;
+    }
+
+    /**
+     * Finds the most probable words that start with prefix, exactly, without the correction
+     * search of {@link #getSuggestions}, e.g. to complete a word before it is typed further.
+     * The user history that replaces the probabilities of the search is not taken into account.
+     * @return at most maxCount words, the prefix included if it is a word, by decreasing
+     * frequency. None if the native library is built without FLAG_OPEN_TIME_INDEXES, or if the
+     * dictionary was opened with {@link #LOAD_OPTION_LOW_RAM}.
+     */
+    public ArrayList<SuggestedWordInfo> getCompletions(final String prefix, final int maxCount) {
+        final ArrayList<SuggestedWordInfo> completions = CollectionUtils.newArrayList();
+        if (prefix == null || maxCount <= 0 || !isValidDictionary()) return completions;
+        final int[] prefixCodePoints = StringUtils.toCodePointArray(prefix);
+        if (prefixCodePoints.length >= MAX_WORD_LENGTH) return completions;
+        final int[] outCodePoints = new int[maxCount * MAX_WORD_LENGTH];
+        final int[] outProbabilities = new int[maxCount];
+        final int count;
+        mNativeDictLock.readLock().lock();
+        try {
+            count = getCompletionsNative(mNativeDict, prefixCodePoints, outCodePoints,
+                    outProbabilities);
+        } finally {
+            mNativeDictLock.readLock().unlock();
+        }
+        for (int i = 0; i < count; ++i) {
+            final int start = i * MAX_WORD_LENGTH;
+            int len = 0;
+            while (len < MAX_WORD_LENGTH && outCodePoints[start + len] != 0) {
+                ++len;
+            }
+            completions.add(new SuggestedWordInfo(new String(outCodePoints, start, len),
+                    outProbabilities[i], SuggestedWordInfo.KIND_COMPLETION, mDictType));
+        }
+        return completions;
     }
 
     // TODO: Add a batch process version (isValidBigramMultiple?) to avoid excessive numbers of jni
@@ -206,11 +1168,317 @@ public final class BinaryDictionary extends Dictionary {
         if (TextUtils.isEmpty(word1) || TextUtils.isEmpty(word2)) return false;
         final int[] codePoints1 = StringUtils.toCodePointArray(word1);
         final int[] codePoints2 = StringUtils.toCodePointArray(word2);
-        return isValidBigramNative(mNativeDict, codePoints1, codePoints2);
+        mNativeDictLock.readLock().lock();
+        try {
+            return isValidBigramNative(mNativeDict, codePoints1, codePoints2);
+        } finally {
+            mNativeDictLock.readLock().unlock();
+        }
+    }
+
+    /**
+     * Adds a word to an updatable dictionary, or updates its probability.
+     * @return false if the word could not be added, e.g. because it is too long.
+     */
+    public synchronized boolean addUnigramWord(final String word, final int probability,
+            final boolean isNotAWord) {
+        if (TextUtils.isEmpty(word) || 0 == mNativeUpdatableDict) return false;
+        return addUnigramWordNative(mNativeUpdatableDict, StringUtils.toCodePointArray(word),
+                probability, isNotAWord);
+    }
+
+    /**
+     * Adds a bigram to an updatable dictionary, or updates its probability, from 0 to 15.
+     * @return false if either word has not been added to the dictionary.
+     */
+    public synchronized boolean addBigramWords(final String word0, final String word1,
+            final int probability) {
+        if (TextUtils.isEmpty(word0) || TextUtils.isEmpty(word1) || 0 == mNativeUpdatableDict) {
+            return false;
+        }
+        return addBigramWordsNative(mNativeUpdatableDict, StringUtils.toCodePointArray(word0),
+                StringUtils.toCodePointArray(word1), probability);
+    }
+
+    /**
+     * Removes a word and its bigrams from an updatable dictionary.
+     * @return false if the word is not in the dictionary.
+     */
+    public synchronized boolean removeUnigramWord(final String word) {
+        if (TextUtils.isEmpty(word) || 0 == mNativeUpdatableDict) return false;
+        return removeUnigramWordNative(mNativeUpdatableDict, StringUtils.toCodePointArray(word));
+    }
+
+    /**
+     * Makes the changes of an updatable dictionary visible to the queries. This only writes the
+     * probabilities again if no word was added or removed since the last flush. The queries
+     * started before keep reading the previous data, which is released once they are done, as
+     * swapping the dictionary does.
+     */
+    public void flushUpdates() {
+        final long oldNativeDict;
+        synchronized (this) {
+            if (0 == mNativeUpdatableDict) return;
+            final long nativeDict = flushUpdatableNative(mNativeUpdatableDict);
+            if (nativeDict == mNativeDict) return;
+            // Waits for the lookups without a session that read the current data.
+            mNativeDictLock.writeLock().lock();
+            try {
+                oldNativeDict = mNativeDict;
+                mNativeDict = nativeDict;
+            } finally {
+                mNativeDictLock.writeLock().unlock();
+            }
+            // The overlay has the word positions of the old data.
+            replaceProbabilityOverlayLocked(0);
+        }
+        waitForSessionQueries();
+        synchronized (this) {
+            // Closing the updatable dictionary meanwhile released the old data too.
+            if (0 != mNativeUpdatableDict) {
+                releaseFlushedUpdatableNative(mNativeUpdatableDict, oldNativeDict);
+            }
+        }
+    }
+
+    /**
+     * Replaces the probabilities of some words and bigrams of the dictionary for the searches,
+     * e.g. with the ones learned from the user, so that the suggestions are ranked for the user
+     * by one search of this dictionary. Each call replaces the probabilities of the previous
+     * one, and the words that are not in the dictionary are ignored. The queries started before
+     * keep the previous probabilities. Swapping the dictionary data drops them. The other
+     * instances that opened the same file keep the probabilities of the file.
+     * @param words the words whose probabilities or bigrams are replaced.
+     * @param probabilities the unigram probability of each of words, from 0 to 255, or
+     *        NOT_A_PROBABILITY to keep the one of the dictionary.
+     * @param bigramWordIndices the indices in words of the previous word and of the word of each
+     *        bigram, two per bigram.
+     * @param bigramProbabilities the probability of each bigram, from 0 to 255, as it is computed
+     *        from the unigram and bigram probabilities of the dictionary.
+     */
+    public void setProbabilityOverlay(final String[] words, final int[] probabilities,
+            final int[] bigramWordIndices, final int[] bigramProbabilities) {
+        if (words.length != probabilities.length
+                || bigramWordIndices.length != bigramProbabilities.length * 2) {
+            throw new IllegalArgumentException();
+        }
+        final int[] wordOffsets = new int[words.length + 1];
+        final int[][] wordCodePointArrays = new int[words.length][];
+        for (int i = 0; i < words.length; ++i) {
+            if (words[i] == null) {
+                throw new IllegalArgumentException();
+            }
+            wordCodePointArrays[i] = StringUtils.toCodePointArray(words[i]);
+            wordOffsets[i + 1] = wordOffsets[i] + wordCodePointArrays[i].length;
+        }
+        final int[] wordCodePoints = new int[wordOffsets[words.length]];
+        for (int i = 0; i < words.length; ++i) {
+            System.arraycopy(wordCodePointArrays[i], 0, wordCodePoints, wordOffsets[i],
+                    wordCodePointArrays[i].length);
+        }
+        synchronized (this) {
+            if (mIsClosed || 0 == mNativeDict) return;
+            // mNativeDict is not swapped or flushed meanwhile.
+            replaceProbabilityOverlayLocked(createProbabilityOverlayNative(mNativeDict,
+                    wordOffsets, wordCodePoints, probabilities, bigramWordIndices,
+                    bigramProbabilities));
+        }
+    }
+
+    // Makes the sessions use overlay, which may be 0, from their next query on, and releases the
+    // previous overlay once they are done with it. Must be called with the lock of this held.
+    private void replaceProbabilityOverlayLocked(final long overlay) {
+        final long oldOverlay;
+        final ArrayList<DicTraverseSession> sessions;
+        synchronized (mDicTraverseSessions) {
+            oldOverlay = mNativeProbabilityOverlay;
+            mNativeProbabilityOverlay = overlay;
+            sessions = getTraverseSessions();
+        }
+        for (final DicTraverseSession session : sessions) {
+            synchronized (session) {
+                // A query holds the lock of its session from reading the overlay to its end.
+                session.setProbabilityOverlay(overlay);
+            }
+        }
+        if (oldOverlay != 0) {
+            releaseProbabilityOverlayNative(oldOverlay);
+        }
+    }
+
+    /**
+     * Adds the native memory that the dictionary and its sessions use to usage. The usage of the
+     * process is the sum over its dictionaries; a dictionary file opened by several instances is
+     * counted for each of them, although it is only mapped once. Each session is counted once
+     * the query running with it, if any, is done.
+     * @param proximityInfo the proximity info of the keyboard to count too, or null.
+     * @param usage the bytes by MEMORY_USAGE_* category, MEMORY_USAGE_CATEGORY_COUNT of them,
+     *        which the bytes of the dictionary are added to.
+     */
+    public void addNativeMemoryUsage(final ProximityInfo proximityInfo, final int[] usage) {
+        if (usage.length < MEMORY_USAGE_CATEGORY_COUNT) {
+            throw new IllegalArgumentException("Too few categories: " + usage.length);
+        }
+        final long nativeProximityInfo =
+                null == proximityInfo ? 0 : proximityInfo.getNativeProximityInfo();
+        synchronized (this) {
+            mNativeDictLock.readLock().lock();
+            try {
+                getMemoryUsageNative(mNativeDict, mNativeUpdatableDict, mNativeProbabilityOverlay,
+                        0 /* traverseSession */, nativeProximityInfo, usage);
+            } finally {
+                mNativeDictLock.readLock().unlock();
+            }
+        }
+        final ArrayList<DicTraverseSession> sessions = getTraverseSessions();
+        for (final DicTraverseSession session : sessions) {
+            synchronized (session) {
+                getMemoryUsageNative(0 /* dict */, 0 /* updatableDict */,
+                        0 /* probabilityOverlay */, session.getSession(), 0 /* proximityInfo */,
+                        usage);
+            }
+        }
+    }
+
+    /**
+     * Adds the counters of the native searches of the sessions of this dictionary, counted since
+     * they were created or last reset, to statistics. The high-water marks are merged by maximum
+     * instead of added.
+     * @param statistics the counts by STATISTIC_*, STATISTIC_COUNT of them, added to.
+     * @param reset whether to reset the counters of the sessions.
+     */
+    public void addNativeSearchStatistics(final long[] statistics, final boolean reset) {
+        if (statistics.length < STATISTIC_COUNT) {
+            throw new IllegalArgumentException("Too few statistics: " + statistics.length);
+        }
+        final ArrayList<DicTraverseSession> sessions = getTraverseSessions();
+        for (final DicTraverseSession session : sessions) {
+            synchronized (session) {
+                getSearchStatisticsNative(session.getSession(), statistics, reset);
+            }
+        }
+    }
+
+    /**
+     * Adds the histograms of the latencies of the native getSuggestions calls of the sessions of
+     * this dictionary, recorded since they were created or last reset, to counts. The latencies
+     * are measured natively, so they leave out the copies of the arrays and the garbage
+     * collections.
+     * @param counts the counts of the calls at getLatencyHistogramIndex, LATENCY_HISTOGRAM_SIZE
+     *   of them, added to.
+     * @param reset whether to reset the histograms of the sessions.
+     */
+    public void addNativeLatencyHistogram(final int[] counts, final boolean reset) {
+        if (counts.length < LATENCY_HISTOGRAM_SIZE) {
+            throw new IllegalArgumentException("Too few counts: " + counts.length);
+        }
+        final ArrayList<DicTraverseSession> sessions = getTraverseSessions();
+        for (final DicTraverseSession session : sessions) {
+            synchronized (session) {
+                getLatencyHistogramNative(session.getSession(), counts, reset);
+            }
+        }
+    }
+
+    /**
+     * Returns the index in the counts of addNativeLatencyHistogram of the calls of an input type
+     * and size class with the latencies of a bucket.
+     */
+    public static int getLatencyHistogramIndex(final int inputType, final int inputSizeClass,
+            final int bucket) {
+        return (inputType * LATENCY_INPUT_SIZE_CLASS_COUNT + inputSizeClass)
+                * LATENCY_BUCKET_COUNT + bucket;
+    }
+
+    /**
+     * Returns the smallest latency in microseconds counted in a bucket of the native latency
+     * histograms. The buckets below LATENCY_SUB_BUCKET_COUNT are one microsecond wide, and each
+     * power of two above is split in LATENCY_SUB_BUCKET_COUNT buckets.
+     */
+    public static long getLatencyBucketLowerBoundUs(final int bucket) {
+        if (bucket < LATENCY_SUB_BUCKET_COUNT) return bucket;
+        final int exponent = bucket / LATENCY_SUB_BUCKET_COUNT + 1;
+        return (long)(LATENCY_SUB_BUCKET_COUNT + bucket % LATENCY_SUB_BUCKET_COUNT)
+                << (exponent - 2);
+    }
+
+    /**
+     * Enables or disables the tracing of the native calls of all the dictionaries. Tracing only
+     * reads the clock at the boundaries of the phases, so it may be enabled in release builds.
+     * @param flags a combination of the TRACE_FLAG_* flags, or 0 to disable tracing.
+     */
+    public static void setNativeTracing(final int flags) {
+        setTraceFlagsNative(flags);
+    }
+
+    /**
+     * Moves the oldest recorded spans to the arrays, in the order they ended. A limited number of
+     * spans is kept, after which the oldest ones are dropped.
+     * @param phases the TRACE_PHASE_* of each span.
+     * @param threadIds the kernel id of the thread of each span.
+     * @param startTimesNs the start time of each span, on the monotonic clock.
+     * @param durationsNs the duration of each span.
+     * @return the number of spans written, at most the length of the arrays.
+     */
+    public static int drainNativeTraceSpans(final int[] phases, final int[] threadIds,
+            final long[] startTimesNs, final long[] durationsNs) {
+        if (threadIds.length != phases.length || startTimesNs.length != phases.length
+                || durationsNs.length != phases.length) {
+            throw new IllegalArgumentException("The arrays have different lengths");
+        }
+        return drainTraceSpansNative(phases, threadIds, startTimesNs, durationsNs);
+    }
+
+    /**
+     * Starts recording which char groups of this dictionary the native searches read, for
+     * "dicttool heatmap" to study the locality of the accesses. Only one dictionary is recorded
+     * at a time: this clears the counts of any previous recording. Recording stops when the
+     * dictionary is closed.
+     * @param samplingInterval the number of reads for each one that is counted; a larger interval
+     *   makes recording cheaper.
+     */
+    public void startNativeHeatMap(final int samplingInterval) {
+        if (samplingInterval < 1) {
+            throw new IllegalArgumentException("Invalid sampling interval: " + samplingInterval);
+        }
+        startHeatMapNative(mNativeDict, samplingInterval);
+    }
+
+    /**
+     * Stops recording the heat map. The counts are kept for writeNativeHeatMap.
+     */
+    public static void stopNativeHeatMap() {
+        stopHeatMapNative();
+    }
+
+    /**
+     * Writes the counts of the current or last heat map recording to a text file.
+     * @param path the path of the file to write.
+     * @return whether the file was written.
+     */
+    public static boolean writeNativeHeatMap(final String path) {
+        return writeHeatMapNative(path);
     }
 
     @Override
     public void close() {
+        synchronized (mPendingRequests) {
+            if (null != mSuggestionExecutor) {
+                mSuggestionExecutor.shutdownNow();
+                mSuggestionExecutor = null;
+            }
+            final int requestsSize = mPendingRequests.size();
+            for (int index = 0; index < requestsSize; ++index) {
+                final SuggestionRequest request = mPendingRequests.valueAt(index);
+                request.mIsCancelled = true;
+                if (request.mIsRunning) {
+                    synchronized (mDicTraverseSessions) {
+                        request.mSession.cancelRequest(request.mTicket);
+                    }
+                }
+            }
+            mPendingRequests.clear();
+        }
         synchronized (mDicTraverseSessions) {
             final int sessionsSize = mDicTraverseSessions.size();
             for (int index = 0; index < sessionsSize; ++index) {
@@ -224,7 +1492,14 @@ public final class BinaryDictionary extends Dictionary {
     }
 
     private synchronized void closeInternal() {
-        if (mNativeDict != 0) {
+        mIsClosed = true;
+        replaceProbabilityOverlayLocked(0);
+        if (mNativeUpdatableDict != 0) {
+            // The native dictionary belongs to the updatable dictionary.
+            closeUpdatableNative(mNativeUpdatableDict);
+            mNativeUpdatableDict = 0;
+            mNativeDict = 0;
+        } else if (mNativeDict != 0) {
             closeNative(mNativeDict);
             mNativeDict = 0;
         }
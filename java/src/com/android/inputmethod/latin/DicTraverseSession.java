@@ -23,16 +23,54 @@ public final class DicTraverseSession {
         JniUtils.loadNativeLibrary();
     }
 
+    // Must be equal to the SEARCH_PROFILE_* constants in native/jni/src/suggest/core/session/
+    // search_profile.h
+    public static final int SEARCH_PROFILE_DEFAULT = 0;
+    // Keeps half the candidates, corrects fewer typing errors and suggests no multiple words.
+    public static final int SEARCH_PROFILE_BATTERY_SAVER = 1;
+    // Keeps more candidates and corrects more typing errors.
+    public static final int SEARCH_PROFILE_HIGH_QUALITY = 2;
+
     private static native long setDicTraverseSessionNative(String locale);
     private static native void initDicTraverseSessionNative(long nativeDicTraverseSession,
             long dictionary, int[] previousWord, int previousWordLength);
     private static native void releaseDicTraverseSessionNative(long nativeDicTraverseSession);
+    private static native void setLatencyBudgetNative(long nativeDicTraverseSession,
+            int latencyBudgetMs);
+    private static native void setProbabilityOverlayNative(long nativeDicTraverseSession,
+            long overlay);
+    private static native void setSearchProfileNative(long nativeDicTraverseSession, int profile);
+    private static native void setRequestTicketNative(long nativeDicTraverseSession, int ticket);
+    private static native void cancelRequestNative(long nativeDicTraverseSession, int ticket);
+    private static native void setProgressiveIntervalNative(long nativeDicTraverseSession,
+            int inputIndexCount, int intervalMs);
+    private static native int getPublishedResultsNative(long nativeDicTraverseSession,
+            int ticket, int[] outputCodePoints, int[] outputScores, int[] spaceIndices,
+            int[] outputTypes);
 
     private long mNativeDicTraverseSession;
+    // Read by the worker thread of the dictionary.
+    private volatile int mSpeculationStepBudget = 0;
+
+    // Buffers of a suggestion call with this session. Like the native session, they are used by
+    // one call at a time; see BinaryDictionary#getSuggestionsWithSessionId.
+    final int[] mInputCodePoints = new int[Constants.Dictionary.MAX_WORD_LENGTH];
+    final int[] mOutputCodePoints =
+            new int[Constants.Dictionary.MAX_WORD_LENGTH * BinaryDictionary.MAX_RESULTS];
+    final int[] mSpaceIndices = new int[BinaryDictionary.MAX_RESULTS];
+    final int[] mOutputScores = new int[BinaryDictionary.MAX_RESULTS];
+    final int[] mOutputTypes = new int[BinaryDictionary.MAX_RESULTS];
 
     public DicTraverseSession(Locale locale, long dictionary) {
+        this(locale, dictionary, SEARCH_PROFILE_DEFAULT);
+    }
+
+    public DicTraverseSession(Locale locale, long dictionary, int searchProfile) {
         mNativeDicTraverseSession = createNativeDicTraverseSession(
                 locale != null ? locale.toString() : "");
+        if (searchProfile != SEARCH_PROFILE_DEFAULT) {
+            setSearchProfile(searchProfile);
+        }
         initSession(dictionary);
     }
 
@@ -49,6 +87,90 @@ public final class DicTraverseSession {
                 mNativeDicTraverseSession, dictionary, previousWord, previousWordLength);
     }
 
+    /**
+     * Sets the time a suggestion search should take. The search narrows its beam when it is
+     * about to exceed the budget and widens it when there is slack.
+     * @param latencyBudgetMs the budget in milliseconds, or 0 to always use the default beam.
+     */
+    public void setLatencyBudget(int latencyBudgetMs) {
+        setLatencyBudgetNative(mNativeDicTraverseSession, latencyBudgetMs);
+    }
+
+    /**
+     * Makes the queries started after this use the probabilities of a native overlay on the
+     * dictionary it was created for, or none. The session does not own the overlay, which must
+     * be kept until the session is done with it; see BinaryDictionary#setProbabilityOverlay.
+     * @param overlay the native overlay, or 0.
+     */
+    void setProbabilityOverlay(long overlay) {
+        setProbabilityOverlayNative(mNativeDicTraverseSession, overlay);
+    }
+
+    /**
+     * Selects the search parameters, which trade the accuracy of the suggestions for CPU time.
+     * Changing the profile drops the searches kept for the next keys.
+     * @param searchProfile one of the SEARCH_PROFILE_* constants. Unknown profiles select
+     * SEARCH_PROFILE_DEFAULT.
+     */
+    public void setSearchProfile(int searchProfile) {
+        setSearchProfileNative(mNativeDicTraverseSession, searchProfile);
+    }
+
+    /**
+     * Sets how much work the asynchronous requests of the session may do in advance for the next
+     * key, in the idle time after their suggestions are delivered. This lowers the latency of
+     * the next key at the cost of CPU time and battery.
+     * @param maxStepCount the number of input indices to expand at most, or 0 to disable the
+     * speculation, which is the default. 1 is enough after each key of a word.
+     */
+    public void setSpeculationStepBudget(int maxStepCount) {
+        mSpeculationStepBudget = maxStepCount;
+    }
+
+    int getSpeculationStepBudget() {
+        return mSpeculationStepBudget;
+    }
+
+    /**
+     * Sets the ticket of the request the session runs, so that it can be cancelled while it runs.
+     * @param ticket the ticket, or BinaryDictionary.NOT_A_TICKET after the request.
+     */
+    void setRequestTicket(int ticket) {
+        setRequestTicketNative(mNativeDicTraverseSession, ticket);
+    }
+
+    /**
+     * Stops the search of the request with the ticket at its next input index if the session is
+     * running it. This may be called from any thread.
+     */
+    void cancelRequest(int ticket) {
+        cancelRequestNative(mNativeDicTraverseSession, ticket);
+    }
+
+    /**
+     * Makes the asynchronous requests of the session publish the suggestions found so far while
+     * their search continues, so that they can be shown before it completes; see
+     * BinaryDictionary#getPartialSuggestions. This is for long inputs such as gestures, as each
+     * publication costs about as much as the output of the final suggestions.
+     * @param inputIndexCount the number of input indices between publications, or 0.
+     * @param intervalMs the time between publications in milliseconds, or 0. The suggestions
+     * are published when either is reached. 0 for both, the default, disables the publication.
+     */
+    public void setProgressiveInterval(int inputIndexCount, int intervalMs) {
+        setProgressiveIntervalNative(mNativeDicTraverseSession, inputIndexCount, intervalMs);
+    }
+
+    /**
+     * Copies the suggestions last published by the request with the ticket to the arrays of
+     * BinaryDictionary.MAX_RESULTS suggestions. This may be called from any thread.
+     * @return the number of suggestions, or 0 if the request published none.
+     */
+    int getPublishedResults(int ticket, int[] outputCodePoints, int[] outputScores,
+            int[] spaceIndices, int[] outputTypes) {
+        return getPublishedResultsNative(mNativeDicTraverseSession, ticket, outputCodePoints,
+                outputScores, spaceIndices, outputTypes);
+    }
+
     private final long createNativeDicTraverseSession(String locale) {
         return setDicTraverseSessionNative(locale);
     }
@@ -79,6 +79,19 @@ public abstract class Dictionary {
         return NOT_A_PROBABILITY;
     }
 
+    /**
+     * Gets the frequencies of several words at once. Dictionaries that can look the words up in
+     * one batch override this.
+     * @return the frequency of each of words, as {@link #getFrequency(String)} returns it.
+     */
+    public int[] getFrequencies(final String[] words) {
+        final int[] frequencies = new int[words.length];
+        for (int i = 0; i < words.length; ++i) {
+            frequencies[i] = getFrequency(words[i]);
+        }
+        return frequencies;
+    }
+
     /**
      * Compares the contents of the character array with the typed word and returns true if they
      * are the same.
@@ -22,6 +22,7 @@ import com.android.inputmethod.latin.SuggestedWords.SuggestedWordInfo;
 import android.util.Log;
 
 import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.Collection;
 import java.util.Collections;
 import java.util.concurrent.CopyOnWriteArrayList;
@@ -60,17 +61,49 @@ public final class DictionaryCollection extends Dictionary {
             final boolean blockOffensiveWords) {
         final CopyOnWriteArrayList<Dictionary> dictionaries = mDictionaries;
         if (dictionaries.isEmpty()) return null;
-        // To avoid creating unnecessary objects, we get the list out of the first
-        // dictionary and add the rest to it if not null, hence the get(0)
-        ArrayList<SuggestedWordInfo> suggestions = dictionaries.get(0).getSuggestions(composer,
-                prevWord, proximityInfo, blockOffensiveWords);
-        if (null == suggestions) suggestions = CollectionUtils.newArrayList();
+        // The binary dictionaries are searched several at a time in one native call, and the
+        // other dictionaries one by one.
+        final ArrayList<BinaryDictionary> binaryDictionaries = CollectionUtils.newArrayList();
+        ArrayList<SuggestedWordInfo> suggestions = null;
         final int length = dictionaries.size();
-        for (int i = 1; i < length; ++ i) {
-            final ArrayList<SuggestedWordInfo> sugg = dictionaries.get(i).getSuggestions(composer,
-                    prevWord, proximityInfo, blockOffensiveWords);
-            if (null != sugg) suggestions.addAll(sugg);
+        for (int i = 0; i < length; ++ i) {
+            final Dictionary dictionary = dictionaries.get(i);
+            if (dictionary instanceof BinaryDictionary
+                    && ((BinaryDictionary)dictionary).isValidDictionary()) {
+                binaryDictionaries.add((BinaryDictionary)dictionary);
+                continue;
+            }
+            suggestions = addSuggestions(suggestions, dictionary.getSuggestions(composer,
+                    prevWord, proximityInfo, blockOffensiveWords));
         }
+        final int binaryDictionariesSize = binaryDictionaries.size();
+        if (1 == binaryDictionariesSize) {
+            suggestions = addSuggestions(suggestions, binaryDictionaries.get(0).getSuggestions(
+                    composer, prevWord, proximityInfo, blockOffensiveWords));
+        } else {
+            for (int i = 0; i < binaryDictionariesSize;
+                    i += BinaryDictionary.MAX_COLLECTION_DICTIONARY_COUNT) {
+                final int end = Math.min(binaryDictionariesSize,
+                        i + BinaryDictionary.MAX_COLLECTION_DICTIONARY_COUNT);
+                final BinaryDictionary[] group =
+                        binaryDictionaries.subList(i, end).toArray(new BinaryDictionary[end - i]);
+                suggestions = addSuggestions(suggestions,
+                        BinaryDictionary.getSuggestionsFromDictionaries(group, composer,
+                                prevWord, proximityInfo, blockOffensiveWords,
+                                0 /* sessionId */));
+            }
+        }
+        return (null == suggestions) ? CollectionUtils.<SuggestedWordInfo>newArrayList()
+                : suggestions;
+    }
+
+    // To avoid creating unnecessary objects, the first list that is not null is kept and the
+    // following ones are added to it.
+    private static ArrayList<SuggestedWordInfo> addSuggestions(
+            final ArrayList<SuggestedWordInfo> suggestions,
+            final ArrayList<SuggestedWordInfo> newSuggestions) {
+        if (null == suggestions) return newSuggestions;
+        if (null != newSuggestions) suggestions.addAll(newSuggestions);
         return suggestions;
     }
 
@@ -93,6 +126,21 @@ public final class DictionaryCollection extends Dictionary {
         return maxFreq;
     }
 
+    @Override
+    public int[] getFrequencies(final String[] words) {
+        final int[] maxFreqs = new int[words.length];
+        Arrays.fill(maxFreqs, -1);
+        for (int i = mDictionaries.size() - 1; i >= 0; --i) {
+            final int[] tempFreqs = mDictionaries.get(i).getFrequencies(words);
+            for (int j = 0; j < words.length; ++j) {
+                if (tempFreqs[j] >= maxFreqs[j]) {
+                    maxFreqs[j] = tempFreqs[j];
+                }
+            }
+        }
+        return maxFreqs;
+    }
+
     @Override
     public boolean isInitialized() {
         return !mDictionaries.isEmpty();
@@ -104,6 +152,30 @@ public final class DictionaryCollection extends Dictionary {
             dict.close();
     }
 
+    /**
+     * Swaps the data of the dictionaries with the files, in order, if the collection is made of
+     * one binary dictionary per file. The dictionaries keep answering queries meanwhile.
+     * See {@link BinaryDictionary#swapDictionary(String, long, long, int,
+     * BinaryDictionary.OnDictionaryLoadedListener)}.
+     * @param files the files to read the dictionaries from
+     * @param loadOptions a combination of the LOAD_OPTION_* flags of BinaryDictionary
+     * @return false if the collection does not match the files, in which case nothing is swapped
+     */
+    public boolean swapBinaryDictionaries(final ArrayList<AssetFileAddress> files,
+            final int loadOptions) {
+        final CopyOnWriteArrayList<Dictionary> dictionaries = mDictionaries;
+        if (null == files || files.isEmpty() || files.size() != dictionaries.size()) return false;
+        for (final Dictionary dictionary : dictionaries) {
+            if (!(dictionary instanceof BinaryDictionary)) return false;
+        }
+        for (int i = 0; i < files.size(); ++i) {
+            final AssetFileAddress file = files.get(i);
+            ((BinaryDictionary)dictionaries.get(i)).swapDictionary(file.mFilename, file.mOffset,
+                    file.mLength, loadOptions, null /* listener */);
+        }
+        return true;
+    }
+
     // Warning: this is not thread-safe. Take necessary precaution when calling.
     public void addDictionary(final Dictionary newDict) {
         if (null == newDict) return;
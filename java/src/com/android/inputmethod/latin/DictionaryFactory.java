@@ -16,11 +16,14 @@
 
 package com.android.inputmethod.latin;
 
+import android.app.ActivityManager;
 import android.content.Context;
 import android.content.res.AssetFileDescriptor;
 import android.content.res.Resources;
 import android.util.Log;
 
+import com.android.inputmethod.compat.ActivityManagerCompatUtils;
+
 import java.io.File;
 import java.util.ArrayList;
 import java.util.LinkedList;
@@ -32,6 +35,20 @@ import java.util.Locale;
 public final class DictionaryFactory {
     private static final String TAG = DictionaryFactory.class.getSimpleName();
 
+    /**
+     * Returns how to load the main dictionaries. On a low-RAM device, the native indexes of the
+     * dictionaries are not built, so that several languages fit in memory.
+     */
+    private static int getMainDictionaryLoadOptions(final Context context) {
+        final ActivityManager activityManager =
+                (ActivityManager)context.getSystemService(Context.ACTIVITY_SERVICE);
+        if (null != activityManager
+                && ActivityManagerCompatUtils.isLowRamDevice(activityManager)) {
+            return BinaryDictionary.LOAD_OPTIONS_FOR_MAIN_DICTIONARY_ON_LOW_RAM_DEVICE;
+        }
+        return BinaryDictionary.LOAD_OPTIONS_FOR_MAIN_DICTIONARY;
+    }
+
     /**
      * Initializes a main dictionary collection from a dictionary pack, with explicit flags.
      *
@@ -56,7 +73,8 @@ public final class DictionaryFactory {
         if (null != assetFileList) {
             for (final AssetFileAddress f : assetFileList) {
                 final BinaryDictionary binaryDictionary = new BinaryDictionary(f.mFilename,
-                        f.mOffset, f.mLength, useFullEditDistance, locale, Dictionary.TYPE_MAIN);
+                        f.mOffset, f.mLength, useFullEditDistance, locale, Dictionary.TYPE_MAIN,
+                        getMainDictionaryLoadOptions(context));
                 if (binaryDictionary.isValidDictionary()) {
                     dictList.add(binaryDictionary);
                 }
@@ -69,6 +87,23 @@ public final class DictionaryFactory {
         return new DictionaryCollection(Dictionary.TYPE_MAIN, dictList);
     }
 
+    /**
+     * Makes a main dictionary collection read the current files of the dictionary pack, e.g.
+     * after an update of the pack, without recreating its dictionaries and their sessions.
+     * @param context application context for reading resources
+     * @param locale the locale of the collection
+     * @param collection a collection created by createMainDictionaryFromManager for the locale
+     * @return false if the files do not match the dictionaries of the collection, in which case
+     *         it should be recreated
+     */
+    public static boolean swapMainDictionaryFromManager(final Context context,
+            final Locale locale, final DictionaryCollection collection) {
+        if (null == locale) return false;
+        return collection.swapBinaryDictionaries(
+                BinaryDictionaryGetter.getDictionaryFiles(locale, context),
+                getMainDictionaryLoadOptions(context));
+    }
+
     /**
      * Initializes a main dictionary collection from a dictionary pack, with default flags.
      *
@@ -109,7 +144,8 @@ public final class DictionaryFactory {
                 return null;
             }
             return new BinaryDictionary(sourceDir, afd.getStartOffset(), afd.getLength(),
-                    false /* useFullEditDistance */, locale, Dictionary.TYPE_MAIN);
+                    false /* useFullEditDistance */, locale, Dictionary.TYPE_MAIN,
+                    getMainDictionaryLoadOptions(context));
         } catch (android.content.res.Resources.NotFoundException e) {
             Log.e(TAG, "Could not find the resource");
             return null;
@@ -104,13 +104,25 @@ public final class Suggest {
     public void resetMainDict(final Context context, final Locale locale,
             final SuggestInitializationListener listener) {
         mIsCurrentlyWaitingForMainDictionary = true;
-        mMainDictionary = null;
-        if (listener != null) {
-            listener.onUpdateMainDictionaryAvailability(hasMainDictionary());
+        // An update of the dictionary pack for the same locale swaps the data of the current
+        // dictionaries, which keep being used meanwhile.
+        final DictionaryCollection currentMainDict =
+                (mMainDictionary instanceof DictionaryCollection && locale != null
+                        && locale.equals(mLocale)) ? (DictionaryCollection)mMainDictionary : null;
+        if (null == currentMainDict) {
+            mMainDictionary = null;
+            if (listener != null) {
+                listener.onUpdateMainDictionaryAvailability(hasMainDictionary());
+            }
         }
         new Thread("InitializeBinaryDictionary") {
             @Override
             public void run() {
+                if (null != currentMainDict && DictionaryFactory.swapMainDictionaryFromManager(
+                        context, locale, currentMainDict)) {
+                    mIsCurrentlyWaitingForMainDictionary = false;
+                    return;
+                }
                 final DictionaryCollection newMainDict =
                         DictionaryFactory.createMainDictionaryFromManager(context, locale);
                 addOrReplaceDictionary(mDictionaries, Dictionary.TYPE_MAIN, newMainDict);
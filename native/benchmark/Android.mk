@@ -0,0 +1,212 @@
+# Copyright (C) 2013 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+LOCAL_PATH := $(call my-dir)
+
+LATIN_IME_BENCHMARK_CFLAGS := -Werror -Wall -Wextra -Weffc++ -Wformat=2 -Wcast-qual \
+    -Wcast-align -Wwrite-strings -Wfloat-equal -Wpointer-arith -Winit-self -Wredundant-decls \
+    -Wno-system-headers
+
+# To suppress compiler warnings for unused variables/functions used for debug features etc.
+LATIN_IME_BENCHMARK_CFLAGS += -Wno-unused-parameter -Wno-unused-function
+
+# The host tools log through the host liblog when the core is built with the debug flags.
+LATIN_IME_BENCHMARK_HOST_STATIC_LIBRARIES := liblatinime_core_host_static
+ifneq ($(filter true, $(FLAG_DO_PROFILE) $(FLAG_DBG)),)
+    LATIN_IME_BENCHMARK_HOST_STATIC_LIBRARIES += liblog
+endif # FLAG_DO_PROFILE or FLAG_DBG
+
+######################################
+# Replays recorded suggestion calls on the device, e.g.
+#   adb shell latinime_replay_benchmark main_en.dict qwerty.layout typing.log
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../jni/src
+
+LOCAL_CFLAGS += $(LATIN_IME_BENCHMARK_CFLAGS)
+
+LOCAL_SRC_FILES := \
+    replay_benchmark.cpp \
+    replay_utils.cpp
+
+LOCAL_STATIC_LIBRARIES := libjni_latinime_common_static
+
+LOCAL_MODULE := latinime_replay_benchmark
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SDK_VERSION := 14
+LOCAL_NDK_STL_VARIANT := stlport_static
+
+include $(BUILD_EXECUTABLE)
+
+######################################
+# Times the decoding primitives of the binary format, e.g.
+#   adb shell latinime_binary_format_benchmark main_en.dict
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../jni/src
+
+LOCAL_CFLAGS += $(LATIN_IME_BENCHMARK_CFLAGS)
+
+LOCAL_SRC_FILES := \
+    binary_format_benchmark.cpp \
+    replay_utils.cpp
+
+LOCAL_STATIC_LIBRARIES := libjni_latinime_common_static
+
+LOCAL_MODULE := latinime_binary_format_benchmark
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SDK_VERSION := 14
+LOCAL_NDK_STL_VARIANT := stlport_static
+
+include $(BUILD_EXECUTABLE)
+
+######################################
+# Evaluates the suggestions of a labeled input log, e.g.
+#   adb shell latinime_scoring_evaluation main_en.dict qwerty_en.layout typing_en_eval.log \
+#       base.report
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../jni/src
+
+LOCAL_CFLAGS += $(LATIN_IME_BENCHMARK_CFLAGS)
+
+LOCAL_SRC_FILES := \
+    replay_utils.cpp \
+    scoring_evaluation.cpp
+
+LOCAL_STATIC_LIBRARIES := libjni_latinime_common_static
+
+LOCAL_MODULE := latinime_scoring_evaluation
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SDK_VERSION := 14
+LOCAL_NDK_STL_VARIANT := stlport_static
+
+include $(BUILD_EXECUTABLE)
+
+######################################
+# Stresses a shared dictionary with concurrent sessions, e.g.
+#   adb shell latinime_session_stress_benchmark main_en.dict qwerty_en.layout typing_en.log 4
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../jni/src
+
+LOCAL_CFLAGS += $(LATIN_IME_BENCHMARK_CFLAGS)
+
+LOCAL_SRC_FILES := \
+    replay_utils.cpp \
+    session_stress_benchmark.cpp
+
+LOCAL_STATIC_LIBRARIES := libjni_latinime_common_static
+
+LOCAL_MODULE := latinime_session_stress_benchmark
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SDK_VERSION := 14
+LOCAL_NDK_STL_VARIANT := stlport_static
+
+include $(BUILD_EXECUTABLE)
+
+######################################
+# The replay benchmark on the host, e.g.
+#   valgrind --tool=cachegrind latinime_replay_benchmark_host main_en.dict qwerty_en.layout \
+#       typing_en.log 1 0
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../jni/src $(JNI_H_INCLUDE)
+
+# The host libstdc++ warns that <hash_map> is deprecated.
+LOCAL_CFLAGS += $(LATIN_IME_BENCHMARK_CFLAGS) -Wno-deprecated
+
+LOCAL_SRC_FILES := \
+    replay_benchmark.cpp \
+    replay_utils.cpp
+
+LOCAL_STATIC_LIBRARIES := $(LATIN_IME_BENCHMARK_HOST_STATIC_LIBRARIES)
+LOCAL_LDLIBS += -lpthread -lrt
+
+LOCAL_MODULE := latinime_replay_benchmark_host
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+######################################
+# The binary format benchmark on the host.
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../jni/src $(JNI_H_INCLUDE)
+
+# The host libstdc++ warns that <hash_map> is deprecated.
+LOCAL_CFLAGS += $(LATIN_IME_BENCHMARK_CFLAGS) -Wno-deprecated
+
+LOCAL_SRC_FILES := \
+    binary_format_benchmark.cpp \
+    replay_utils.cpp
+
+LOCAL_STATIC_LIBRARIES := $(LATIN_IME_BENCHMARK_HOST_STATIC_LIBRARIES)
+LOCAL_LDLIBS += -lpthread -lrt
+
+LOCAL_MODULE := latinime_binary_format_benchmark_host
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+######################################
+# The scoring evaluation on the host, e.g. to diff the reports of two builds of ScoringParams:
+#   latinime_scoring_evaluation_host -diff base.report new.report
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../jni/src $(JNI_H_INCLUDE)
+
+# The host libstdc++ warns that <hash_map> is deprecated.
+LOCAL_CFLAGS += $(LATIN_IME_BENCHMARK_CFLAGS) -Wno-deprecated
+
+LOCAL_SRC_FILES := \
+    replay_utils.cpp \
+    scoring_evaluation.cpp
+
+LOCAL_STATIC_LIBRARIES := $(LATIN_IME_BENCHMARK_HOST_STATIC_LIBRARIES)
+LOCAL_LDLIBS += -lpthread -lrt
+
+LOCAL_MODULE := latinime_scoring_evaluation_host
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+######################################
+# The session stress benchmark on the host, e.g. under ThreadSanitizer.
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../jni/src $(JNI_H_INCLUDE)
+
+# The host libstdc++ warns that <hash_map> is deprecated.
+LOCAL_CFLAGS += $(LATIN_IME_BENCHMARK_CFLAGS) -Wno-deprecated
+
+LOCAL_SRC_FILES := \
+    replay_utils.cpp \
+    session_stress_benchmark.cpp
+
+LOCAL_STATIC_LIBRARIES := $(LATIN_IME_BENCHMARK_HOST_STATIC_LIBRARIES)
+LOCAL_LDLIBS += -lpthread -lrt
+
+LOCAL_MODULE := latinime_session_stress_benchmark_host
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#################### Clean up the tmp vars
+LATIN_IME_BENCHMARK_CFLAGS :=
+LATIN_IME_BENCHMARK_HOST_STATIC_LIBRARIES :=
@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Times the decoding primitives of BinaryFormat on every char group, word and bigram of the
+ * given dictionaries, and on a synthetic dictionary of worst cases: char groups of many
+ * three-byte code points, with three-byte children and attribute addresses, shortcuts and long
+ * bigram lists. Reports the time per operation in ns.
+ *
+ * Usage: latinime_binary_format_benchmark [-i <iterations>] [<dictionary> ...]
+ * Each iteration runs every operation once on every item of a dictionary.
+ */
+
+#define LOG_TAG "LatinIME: binary_format_benchmark.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+#include "binary_format.h"
+#include "defines.h"
+#include "dictionary.h"
+#include "replay_utils.h"
+#include "trace_recorder.h"
+
+namespace latinime {
+
+namespace {
+
+const int DEFAULT_ITERATION_COUNT = 20;
+
+// The synthetic dictionary has a root node of SYNTHETIC_GROUP_COUNT char groups, each with one
+// child, so that its words are MAX_WORD_LENGTH code points long.
+const int SYNTHETIC_GROUP_COUNT = 64;
+const int SYNTHETIC_CHAR_COUNT = MAX_WORD_LENGTH / 2;
+const int SYNTHETIC_BIGRAM_COUNT = 16;
+const int SYNTHETIC_FIRST_CODE_POINT = 0x4E00;
+const int THREE_BYTE_SIZE = 3;
+// Taken from binary_format.h
+const uint8_t CHARACTER_ARRAY_TERMINATOR = 0x1F;
+// The shortcut list is its size, then one attribute of one code point.
+const int SYNTHETIC_SHORTCUT_LIST_SIZE = 2 + 1 + THREE_BYTE_SIZE + 1;
+const int SYNTHETIC_GROUP_SIZE = 1 /* flags */ + SYNTHETIC_CHAR_COUNT * THREE_BYTE_SIZE
+        + 1 /* terminator */ + 1 /* probability */ + THREE_BYTE_SIZE /* children */
+        + SYNTHETIC_SHORTCUT_LIST_SIZE + SYNTHETIC_BIGRAM_COUNT * (1 + THREE_BYTE_SIZE);
+const int SYNTHETIC_PROBABILITY = 128;
+
+// The positions the operations are timed on, collected by walking the trie.
+struct DictionarySample {
+    DictionarySample()
+            : mGroupPositions(), mGroupFlags(), mAttributePositions(), mCodePointCount(0),
+              mTerminalPositions(), mWords(), mWordLengths(), mBigramWordPositions(),
+              mBigramNextPositions(), mBigramUnigramProbabilities() {}
+
+    std::vector<int> mGroupPositions;
+    std::vector<uint8_t> mGroupFlags;
+    // The position of the children address of each group, right after its probability.
+    std::vector<int> mAttributePositions;
+    int mCodePointCount;
+    std::vector<int> mTerminalPositions;
+    // MAX_WORD_LENGTH code points for each terminal.
+    std::vector<int> mWords;
+    std::vector<int> mWordLengths;
+    std::vector<int> mBigramWordPositions;
+    std::vector<int> mBigramNextPositions;
+    std::vector<int> mBigramUnigramProbabilities;
+};
+
+// Adds the bigrams of the terminal whose children address is at pos.
+void addBigrams(const uint8_t *const root, const int terminalPosition, const uint8_t flags,
+        const int pos, const int unigramProbability, DictionarySample *const outSample) {
+    if (!(BinaryFormat::FLAG_HAS_BIGRAMS & flags)) {
+        return;
+    }
+    int position = BinaryFormat::skipShortcuts(root, flags,
+            BinaryFormat::skipChildrenPosition(flags, pos));
+    uint8_t bigramFlags;
+    do {
+        bigramFlags = BinaryFormat::getFlagsAndForwardPointer(root, &position);
+        outSample->mBigramWordPositions.push_back(terminalPosition);
+        outSample->mBigramNextPositions.push_back(
+                BinaryFormat::getAttributeAddressAndForwardPointer(root, bigramFlags, &position));
+        outSample->mBigramUnigramProbabilities.push_back(unigramProbability);
+    } while (BinaryFormat::FLAG_ATTRIBUTE_HAS_NEXT & bigramFlags);
+}
+
+// Walks the node at nodePosition and its descendants. word holds the depth code points of the
+// path to the node.
+void collectNode(const uint8_t *const root, const int nodePosition, int *const word,
+        const int depth, DictionarySample *const outSample) {
+    int pos = nodePosition;
+    for (int groupCount = BinaryFormat::getGroupCountAndForwardPointer(root, &pos);
+            groupCount > 0; --groupCount) {
+        const int groupPosition = pos;
+        const uint8_t flags = BinaryFormat::getFlagsAndForwardPointer(root, &pos);
+        int wordLength = depth;
+        int codePoint = BinaryFormat::getCodePointAndForwardPointer(root, &pos);
+        do {
+            if (wordLength < MAX_WORD_LENGTH) {
+                word[wordLength] = codePoint;
+            }
+            ++wordLength;
+            ++outSample->mCodePointCount;
+            codePoint = (BinaryFormat::FLAG_HAS_MULTIPLE_CHARS & flags)
+                    ? BinaryFormat::getCodePointAndForwardPointer(root, &pos) : NOT_A_CODE_POINT;
+        } while (NOT_A_CODE_POINT != codePoint);
+        const int unigramProbability = BinaryFormat::readProbabilityWithoutMovingPointer(root, pos);
+        pos = BinaryFormat::skipProbability(flags, pos);
+        if ((BinaryFormat::FLAG_IS_TERMINAL & flags) && wordLength <= MAX_WORD_LENGTH) {
+            outSample->mTerminalPositions.push_back(groupPosition);
+            outSample->mWords.insert(outSample->mWords.end(), word, word + MAX_WORD_LENGTH);
+            outSample->mWordLengths.push_back(wordLength);
+            addBigrams(root, groupPosition, flags, pos, unigramProbability, outSample);
+        }
+        outSample->mGroupPositions.push_back(groupPosition);
+        outSample->mGroupFlags.push_back(flags);
+        outSample->mAttributePositions.push_back(pos);
+        if (BinaryFormat::hasChildrenInFlags(flags) && wordLength < MAX_WORD_LENGTH) {
+            collectNode(root, BinaryFormat::readChildrenPosition(root, flags, pos), word,
+                    wordLength, outSample);
+        }
+        pos = BinaryFormat::skipChildrenPosAndAttributes(root, flags, pos);
+    }
+}
+
+void writeThreeBytes(const int value, std::vector<uint8_t> *const outBuffer) {
+    outBuffer->push_back(static_cast<uint8_t>((value >> 16) & 0xFF));
+    outBuffer->push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+    outBuffer->push_back(static_cast<uint8_t>(value & 0xFF));
+}
+
+int getSyntheticRootGroupPosition(const int index) {
+    return 1 /* group count */ + index * SYNTHETIC_GROUP_SIZE;
+}
+
+int getSyntheticChildGroupPosition(const int index) {
+    return getSyntheticRootGroupPosition(SYNTHETIC_GROUP_COUNT)
+            + index * (1 /* group count */ + SYNTHETIC_GROUP_SIZE) + 1;
+}
+
+// Writes a char group of the synthetic dictionary. The bigrams of a group point at the groups of
+// the other level. A leaf has no children address, so its shortcut list is padded to keep all
+// the groups the same size.
+void writeSyntheticGroup(const int index, const bool isRoot,
+        std::vector<uint8_t> *const outBuffer) {
+    outBuffer->push_back(static_cast<uint8_t>(BinaryFormat::FLAG_HAS_MULTIPLE_CHARS
+            | BinaryFormat::FLAG_IS_TERMINAL | BinaryFormat::FLAG_HAS_SHORTCUT_TARGETS
+            | BinaryFormat::FLAG_HAS_BIGRAMS
+            | (isRoot ? BinaryFormat::FLAG_GROUP_ADDRESS_TYPE_THREEBYTES : 0)));
+    // The first code point tells the groups of a node apart.
+    for (int i = 0; i < SYNTHETIC_CHAR_COUNT; ++i) {
+        writeThreeBytes(SYNTHETIC_FIRST_CODE_POINT + (i == 0 ? index : (index * 7 + i) % 0x100),
+                outBuffer);
+    }
+    outBuffer->push_back(CHARACTER_ARRAY_TERMINATOR);
+    outBuffer->push_back(SYNTHETIC_PROBABILITY);
+    if (isRoot) {
+        const int addressPosition = static_cast<int>(outBuffer->size());
+        writeThreeBytes(getSyntheticChildGroupPosition(index) - 1 - addressPosition, outBuffer);
+    }
+    const int shortcutListSize = SYNTHETIC_SHORTCUT_LIST_SIZE + (isRoot ? 0 : THREE_BYTE_SIZE);
+    outBuffer->push_back(static_cast<uint8_t>(shortcutListSize >> 8));
+    outBuffer->push_back(static_cast<uint8_t>(shortcutListSize & 0xFF));
+    outBuffer->push_back(static_cast<uint8_t>(BinaryFormat::MASK_ATTRIBUTE_PROBABILITY));
+    writeThreeBytes(SYNTHETIC_FIRST_CODE_POINT + index, outBuffer);
+    outBuffer->push_back(CHARACTER_ARRAY_TERMINATOR);
+    if (!isRoot) {
+        outBuffer->insert(outBuffer->end(), THREE_BYTE_SIZE, 0);
+    }
+    for (int i = 0; i < SYNTHETIC_BIGRAM_COUNT; ++i) {
+        const int targetIndex = (index + i) % SYNTHETIC_GROUP_COUNT;
+        const int targetPosition = isRoot ? getSyntheticChildGroupPosition(targetIndex)
+                : getSyntheticRootGroupPosition(targetIndex);
+        const int addressPosition = static_cast<int>(outBuffer->size()) + 1;
+        const int offset = targetPosition - addressPosition;
+        outBuffer->push_back(static_cast<uint8_t>(
+                (i + 1 < SYNTHETIC_BIGRAM_COUNT ? BinaryFormat::FLAG_ATTRIBUTE_HAS_NEXT : 0)
+                | (offset < 0 ? BinaryFormat::FLAG_ATTRIBUTE_OFFSET_NEGATIVE : 0)
+                | BinaryFormat::FLAG_ATTRIBUTE_ADDRESS_TYPE_THREEBYTES
+                | (i % (BinaryFormat::MASK_ATTRIBUTE_PROBABILITY + 1))));
+        writeThreeBytes(offset < 0 ? -offset : offset, outBuffer);
+    }
+}
+
+void createSyntheticDictionary(std::vector<uint8_t> *const outBuffer) {
+    outBuffer->clear();
+    outBuffer->push_back(SYNTHETIC_GROUP_COUNT);
+    for (int i = 0; i < SYNTHETIC_GROUP_COUNT; ++i) {
+        writeSyntheticGroup(i, true /* isRoot */, outBuffer);
+    }
+    for (int i = 0; i < SYNTHETIC_GROUP_COUNT; ++i) {
+        outBuffer->push_back(1 /* group count */);
+        writeSyntheticGroup(i, false /* isRoot */, outBuffer);
+    }
+}
+
+// Each operation runs once on every item of the sample, and returns a checksum of the results
+// so that the work is not optimized away. The checksums wrap around.
+typedef uint32_t (*Operation)(const uint8_t *const root, const DictionarySample *const sample);
+
+uint32_t readFlags(const uint8_t *const root, const DictionarySample *const sample) {
+    uint32_t checksum = 0;
+    for (int i = 0; i < static_cast<int>(sample->mGroupPositions.size()); ++i) {
+        int pos = sample->mGroupPositions[i];
+        checksum += BinaryFormat::getFlagsAndForwardPointer(root, &pos) + pos;
+    }
+    return checksum;
+}
+
+uint32_t readCodePoints(const uint8_t *const root, const DictionarySample *const sample) {
+    uint32_t checksum = 0;
+    for (int i = 0; i < static_cast<int>(sample->mGroupPositions.size()); ++i) {
+        int pos = sample->mGroupPositions[i] + 1;
+        int codePoint = BinaryFormat::getCodePointAndForwardPointer(root, &pos);
+        if (BinaryFormat::FLAG_HAS_MULTIPLE_CHARS & sample->mGroupFlags[i]) {
+            while (NOT_A_CODE_POINT != codePoint) {
+                checksum += codePoint;
+                codePoint = BinaryFormat::getCodePointAndForwardPointer(root, &pos);
+            }
+        } else {
+            checksum += codePoint;
+        }
+    }
+    return checksum;
+}
+
+uint32_t skipChildrenPosAndAttributes(const uint8_t *const root,
+        const DictionarySample *const sample) {
+    uint32_t checksum = 0;
+    for (int i = 0; i < static_cast<int>(sample->mAttributePositions.size()); ++i) {
+        checksum += BinaryFormat::skipChildrenPosAndAttributes(root, sample->mGroupFlags[i],
+                sample->mAttributePositions[i]);
+    }
+    return checksum;
+}
+
+uint32_t getTerminalPositions(const uint8_t *const root, const DictionarySample *const sample) {
+    uint32_t checksum = 0;
+    for (int i = 0; i < static_cast<int>(sample->mWordLengths.size()); ++i) {
+        checksum += BinaryFormat::getTerminalPosition(root, &sample->mWords[i * MAX_WORD_LENGTH],
+                sample->mWordLengths[i], false /* forceLowerCaseSearch */);
+    }
+    return checksum;
+}
+
+uint32_t getWordsAtAddresses(const uint8_t *const root, const DictionarySample *const sample) {
+    uint32_t checksum = 0;
+    int word[MAX_WORD_LENGTH];
+    for (int i = 0; i < static_cast<int>(sample->mTerminalPositions.size()); ++i) {
+        int unigramProbability = 0;
+        checksum += BinaryFormat::getWordAtAddress(root, sample->mTerminalPositions[i],
+                MAX_WORD_LENGTH, word, &unigramProbability) + unigramProbability + word[0];
+    }
+    return checksum;
+}
+
+uint32_t getBigramProbabilities(const uint8_t *const root, const DictionarySample *const sample) {
+    uint32_t checksum = 0;
+    for (int i = 0; i < static_cast<int>(sample->mBigramWordPositions.size()); ++i) {
+        checksum += BinaryFormat::getBigramProbability(root, sample->mBigramWordPositions[i],
+                sample->mBigramNextPositions[i], sample->mBigramUnigramProbabilities[i]);
+    }
+    return checksum;
+}
+
+// Keeps the checksums alive.
+volatile uint32_t sChecksum = 0;
+
+void timeOperation(const char *const name, const Operation operation,
+        const int operationCount, const uint8_t *const root,
+        const DictionarySample *const sample, const int iterationCount) {
+    if (operationCount <= 0) {
+        printf("%-32s %10d %10s\n", name, 0, "-");
+        return;
+    }
+    // Warm the caches up once.
+    sChecksum += operation(root, sample);
+    const int64_t startTimeNs = TraceRecorder::getCurrentTimeNs();
+    for (int i = 0; i < iterationCount; ++i) {
+        sChecksum += operation(root, sample);
+    }
+    const int64_t durationNs = TraceRecorder::getCurrentTimeNs() - startTimeNs;
+    printf("%-32s %10d %10.2f\n", name, operationCount,
+            static_cast<double>(durationNs) / (static_cast<double>(operationCount)
+                    * iterationCount));
+}
+
+void runOperations(const char *const name, const uint8_t *const root,
+        const int iterationCount) {
+    DictionarySample sample;
+    int word[MAX_WORD_LENGTH];
+    collectNode(root, 0 /* nodePosition */, word, 0 /* depth */, &sample);
+    const int groupCount = static_cast<int>(sample.mGroupPositions.size());
+    printf("%s: %d char groups, %d code points, %d words, %d bigrams\n", name, groupCount,
+            sample.mCodePointCount, static_cast<int>(sample.mTerminalPositions.size()),
+            static_cast<int>(sample.mBigramWordPositions.size()));
+    printf("%-32s %10s %10s\n", "operation", "count", "ns/op");
+    timeOperation("getFlagsAndForwardPointer", readFlags, groupCount, root, &sample,
+            iterationCount);
+    timeOperation("getCodePointAndForwardPointer", readCodePoints, sample.mCodePointCount, root,
+            &sample, iterationCount);
+    timeOperation("skipChildrenPosAndAttributes", skipChildrenPosAndAttributes, groupCount,
+            root, &sample, iterationCount);
+    timeOperation("getTerminalPosition", getTerminalPositions,
+            static_cast<int>(sample.mWordLengths.size()), root, &sample, iterationCount);
+    timeOperation("getWordAtAddress", getWordsAtAddresses,
+            static_cast<int>(sample.mTerminalPositions.size()), root, &sample, iterationCount);
+    timeOperation("getBigramProbability", getBigramProbabilities,
+            static_cast<int>(sample.mBigramWordPositions.size()), root, &sample,
+            iterationCount);
+    printf("\n");
+}
+
+int runBenchmark(const int argc, char **const argv) {
+    int iterationCount = DEFAULT_ITERATION_COUNT;
+    int firstPathIndex = 1;
+    if (argc > 2 && 0 == strcmp(argv[1], "-i")) {
+        iterationCount = atoi(argv[2]);
+        firstPathIndex = 3;
+    }
+    if (iterationCount <= 0) {
+        fprintf(stderr, "Usage: %s [-i <iterations>] [<dictionary> ...]\n", argv[0]);
+        return 2;
+    }
+    std::vector<uint8_t> syntheticDictionary;
+    createSyntheticDictionary(&syntheticDictionary);
+    runOperations("synthetic worst cases", &syntheticDictionary[0], iterationCount);
+    for (int i = firstPathIndex; i < argc; ++i) {
+        Dictionary *const dictionary = ReplayUtils::openDictionary(argv[i]);
+        if (!dictionary) {
+            return 1;
+        }
+        runOperations(argv[i], dictionary->getOffsetDict(), iterationCount);
+        ReplayUtils::closeDictionary(dictionary);
+    }
+    return 0;
+}
+
+} // namespace
+} // namespace latinime
+
+int main(int argc, char **argv) {
+    return latinime::runBenchmark(argc, argv);
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays recorded getSuggestions calls on a dictionary and a layout, and reports the throughput
+ * and the latency percentiles of the calls and of their traced phases. The file formats are
+ * described in replay_utils.h.
+ *
+ * Usage: latinime_replay_benchmark <dictionary> <layout> <input log> [<iterations>
+ *         [<warm-up iterations>]]
+ * Each iteration replays the whole log with one session, like the keyboard does.
+ */
+
+#define LOG_TAG "LatinIME: replay_benchmark.cpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "dic_traverse_wrapper.h"
+#include "dictionary.h"
+#include "proximity_info.h"
+#include "replay_utils.h"
+#include "trace_recorder.h"
+
+namespace latinime {
+
+namespace {
+
+const int DEFAULT_ITERATION_COUNT = 10;
+const int DEFAULT_WARM_UP_ITERATION_COUNT = 1;
+const int MAX_DRAINED_SPAN_COUNT = 64;
+
+// The nearest-rank percentile of the sorted durations.
+int64_t getPercentile(const std::vector<int64_t> *const sortedDurationsNs,
+        const int percentile) {
+    const int count = static_cast<int>(sortedDurationsNs->size());
+    const int rank = (count * percentile + 99) / 100;
+    return (*sortedDurationsNs)[max(rank - 1, 0)];
+}
+
+void printDurations(const char *const name, std::vector<int64_t> *const durationsNs) {
+    if (durationsNs->empty()) {
+        return;
+    }
+    std::sort(durationsNs->begin(), durationsNs->end());
+    printf("%-16s %8d %10.1f %10.1f %10.1f %10.1f\n", name,
+            static_cast<int>(durationsNs->size()), getPercentile(durationsNs, 50) / 1000.0,
+            getPercentile(durationsNs, 95) / 1000.0, getPercentile(durationsNs, 99) / 1000.0,
+            durationsNs->back() / 1000.0);
+}
+
+// Replays the inputs once, and adds the durations if they are given.
+void replay(const Dictionary *const dictionary, ProximityInfo *const proximityInfo,
+        void *const traverseSession, const std::vector<ReplayInput> *const inputs,
+        std::vector<int64_t> *const callDurationsNs,
+        std::vector<int64_t> *const phaseDurationsNs) {
+    ReplayResult result;
+    int phases[MAX_DRAINED_SPAN_COUNT];
+    int threadIds[MAX_DRAINED_SPAN_COUNT];
+    int64_t startTimesNs[MAX_DRAINED_SPAN_COUNT];
+    int64_t durationsNs[MAX_DRAINED_SPAN_COUNT];
+    for (int i = 0; i < static_cast<int>(inputs->size()); ++i) {
+        const int64_t startTimeNs = TraceRecorder::getCurrentTimeNs();
+        ReplayUtils::getSuggestions(dictionary, proximityInfo, traverseSession, &(*inputs)[i],
+                &result);
+        const int64_t durationNs = TraceRecorder::getCurrentTimeNs() - startTimeNs;
+        const int spanCount = TraceRecorder::drainSpans(MAX_DRAINED_SPAN_COUNT, phases,
+                threadIds, startTimesNs, durationsNs);
+        if (!callDurationsNs) {
+            continue;
+        }
+        callDurationsNs->push_back(durationNs);
+        for (int j = 0; j < spanCount; ++j) {
+            phaseDurationsNs[phases[j]].push_back(durationsNs[j]);
+        }
+    }
+}
+
+int runBenchmark(const int argc, char **const argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <dictionary> <layout> <input log> [<iterations> "
+                "[<warm-up iterations>]]\n", argv[0]);
+        return 2;
+    }
+    const int iterationCount = argc > 4 ? atoi(argv[4]) : DEFAULT_ITERATION_COUNT;
+    const int warmUpIterationCount = argc > 5 ? atoi(argv[5]) : DEFAULT_WARM_UP_ITERATION_COUNT;
+    std::vector<ReplayInput> inputs;
+    if (!ReplayUtils::readInputs(argv[3], &inputs)) {
+        return 1;
+    }
+    const int inputCount = static_cast<int>(inputs.size());
+    for (int i = 0; i < static_cast<int>(inputs.size()); ++i) {
+        if (!ReplayUtils::canReplay(&inputs[i])) {
+            inputs.erase(inputs.begin() + i);
+            --i;
+        }
+    }
+    if (static_cast<int>(inputs.size()) < inputCount) {
+        printf("Skipped %d inputs the engine cannot replay\n",
+                inputCount - static_cast<int>(inputs.size()));
+    }
+    ProximityInfo *const proximityInfo = ReplayUtils::createProximityInfo(argv[2]);
+    if (!proximityInfo) {
+        return 1;
+    }
+    const int64_t openStartTimeNs = TraceRecorder::getCurrentTimeNs();
+    Dictionary *const dictionary = ReplayUtils::openDictionary(argv[1]);
+    if (!dictionary) {
+        delete proximityInfo;
+        return 1;
+    }
+    const int64_t openDurationNs = TraceRecorder::getCurrentTimeNs() - openStartTimeNs;
+    // The session does not use the Java VM.
+    void *const traverseSession = DicTraverseWrapper::getDicTraverseSession(0, 0);
+    TraceRecorder::setFlags(TraceRecorder::TRACE_FLAG_RECORD_SPANS);
+
+    for (int i = 0; i < warmUpIterationCount; ++i) {
+        replay(dictionary, proximityInfo, traverseSession, &inputs, 0, 0);
+    }
+    std::vector<int64_t> callDurationsNs;
+    std::vector<int64_t> phaseDurationsNs[TraceRecorder::PHASE_COUNT];
+    const int64_t startTimeNs = TraceRecorder::getCurrentTimeNs();
+    for (int i = 0; i < iterationCount; ++i) {
+        replay(dictionary, proximityInfo, traverseSession, &inputs, &callDurationsNs,
+                phaseDurationsNs);
+    }
+    const int64_t durationNs = TraceRecorder::getCurrentTimeNs() - startTimeNs;
+    TraceRecorder::setFlags(0);
+
+    printf("Opened the dictionary in %.1f ms\n", openDurationNs / 1000000.0);
+    printf("%d calls in %.1f ms: %.1f calls/s\n", static_cast<int>(callDurationsNs.size()),
+            durationNs / 1000000.0,
+            durationNs > 0 ? callDurationsNs.size() * 1000000000.0 / durationNs : 0.0);
+    printf("%-16s %8s %10s %10s %10s %10s\n", "phase", "count", "p50 (us)", "p95 (us)",
+            "p99 (us)", "max (us)");
+    printDurations("call", &callDurationsNs);
+    for (int phase = 0; phase < TraceRecorder::PHASE_COUNT; ++phase) {
+        printDurations(TraceRecorder::getPhaseName(phase), &phaseDurationsNs[phase]);
+    }
+
+    DicTraverseWrapper::releaseDicTraverseSession(traverseSession);
+    ReplayUtils::closeDictionary(dictionary);
+    delete proximityInfo;
+    return 0;
+}
+
+} // namespace
+} // namespace latinime
+
+int main(int argc, char **argv) {
+    return latinime::runBenchmark(argc, argv);
+}
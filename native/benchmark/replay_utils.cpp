@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: replay_utils.cpp"
+
+#include "replay_utils.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "binary_format.h"
+#include "dictionary.h"
+#include "proximity_info.h"
+#include "suggest/policyimpl/gesture/gesture_suggest_policy_factory.h"
+
+namespace latinime {
+
+namespace {
+
+// Must be equal to ProximityInfo.SEARCH_DISTANCE in Java
+const float SEARCH_DISTANCE = 1.2f;
+
+// Reads a whole line without its line break. Returns false at the end of the file.
+bool readLine(FILE *const file, std::string *const outLine) {
+    outLine->clear();
+    char buffer[1024];
+    while (fgets(buffer, sizeof(buffer), file)) {
+        outLine->append(buffer);
+        if (!outLine->empty() && (*outLine)[outLine->size() - 1] == '\n') {
+            outLine->erase(outLine->size() - 1);
+            return true;
+        }
+    }
+    return !outLine->empty();
+}
+
+// Splits the line at the spaces and tabs, up to a #.
+void splitLine(const std::string *const line, std::vector<std::string> *const outTokens) {
+    outTokens->clear();
+    const std::string content = line->substr(0, line->find('#'));
+    size_t start = content.find_first_not_of(" \t\r");
+    while (start != std::string::npos) {
+        const size_t end = content.find_first_of(" \t\r", start);
+        outTokens->push_back(content.substr(start, end - start));
+        start = content.find_first_not_of(" \t\r", end);
+    }
+}
+
+bool parseInts(const std::vector<std::string> *const tokens, const int begin,
+        const int count, int *const outValues) {
+    for (int i = 0; i < count; ++i) {
+        const char *const token = (*tokens)[begin + i].c_str();
+        char *end = 0;
+        outValues[i] = static_cast<int>(strtol(token, &end, 10));
+        if (end == token || *end != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseFloats(const std::vector<std::string> *const tokens, const int begin,
+        const int count, float *const outValues) {
+    for (int i = 0; i < count; ++i) {
+        const char *const token = (*tokens)[begin + i].c_str();
+        char *end = 0;
+        outValues[i] = static_cast<float>(strtod(token, &end));
+        if (end == token || *end != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns false if the string is not valid UTF-8.
+bool decodeUtf8(const std::string *const utf8, std::vector<int> *const outCodePoints) {
+    outCodePoints->clear();
+    int i = 0;
+    const int length = static_cast<int>(utf8->size());
+    while (i < length) {
+        const int leadByte = static_cast<unsigned char>((*utf8)[i]);
+        const int trailCount = leadByte < 0x80 ? 0 : leadByte < 0xC0 ? -1
+                : leadByte < 0xE0 ? 1 : leadByte < 0xF0 ? 2 : leadByte < 0xF8 ? 3 : -1;
+        if (trailCount < 0 || i + trailCount >= length) {
+            return false;
+        }
+        int codePoint = trailCount == 0 ? leadByte : leadByte & (0x3F >> trailCount);
+        for (int j = 1; j <= trailCount; ++j) {
+            const int trailByte = static_cast<unsigned char>((*utf8)[i + j]);
+            if ((trailByte & 0xC0) != 0x80) {
+                return false;
+            }
+            codePoint = (codePoint << 6) | (trailByte & 0x3F);
+        }
+        outCodePoints->push_back(codePoint);
+        i += trailCount + 1;
+    }
+    return true;
+}
+
+// Same as Key.squaredDistanceToEdge in Java.
+int getSquaredDistanceToEdge(const int x, const int y, const int left, const int top,
+        const int width, const int height) {
+    const int edgeX = x < left ? left : (x > left + width ? left + width : x);
+    const int edgeY = y < top ? top : (y > top + height ? top + height : y);
+    return (x - edgeX) * (x - edgeX) + (y - edgeY) * (y - edgeY);
+}
+
+const int *getData(const std::vector<int> *const values) {
+    return values->empty() ? 0 : &(*values)[0];
+}
+
+} // namespace
+
+/* static */ Dictionary *ReplayUtils::openDictionary(const char *const path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        fprintf(stderr, "Cannot read the size of %s\n", path);
+        close(fd);
+        return 0;
+    }
+    const int dictSize = static_cast<int>(fileStat.st_size);
+    void *const dictBuf = mmap(0, dictSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (dictBuf == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s: %s\n", path, strerror(errno));
+        close(fd);
+        return 0;
+    }
+    if (BinaryFormat::UNKNOWN_FORMAT
+            == BinaryFormat::detectFormat(static_cast<uint8_t *>(dictBuf), dictSize)) {
+        fprintf(stderr, "%s is not a dictionary\n", path);
+        munmap(dictBuf, dictSize);
+        close(fd);
+        return 0;
+    }
+    return new Dictionary(dictBuf, dictSize, fd, 0 /* dictBufAdjust */, 0 /* loadOptions */);
+}
+
+/* static */ void ReplayUtils::closeDictionary(Dictionary *const dictionary) {
+    void *const dictBuf = const_cast<uint8_t *>(dictionary->getDict());
+    const int dictSize = dictionary->getDictSize();
+    const int fd = dictionary->getMmapFd();
+    delete dictionary;
+    munmap(dictBuf, dictSize);
+    close(fd);
+}
+
+/* static */ ProximityInfo *ReplayUtils::createProximityInfo(const char *const layoutPath) {
+    FILE *const file = fopen(layoutPath, "r");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s: %s\n", layoutPath, strerror(errno));
+        return 0;
+    }
+    std::string locale;
+    int keyboard[6]; // The arguments of the keyboard line
+    bool hasKeyboard = false;
+    std::vector<int> keyCodePoints;
+    std::vector<int> keyXs;
+    std::vector<int> keyYs;
+    std::vector<int> keyWidths;
+    std::vector<int> keyHeights;
+    std::vector<float> sweetSpotCenterXs;
+    std::vector<float> sweetSpotCenterYs;
+    std::vector<float> sweetSpotRadii;
+    std::string line;
+    std::vector<std::string> tokens;
+    int lineNumber = 0;
+    bool isValid = true;
+    while (isValid && readLine(file, &line)) {
+        ++lineNumber;
+        splitLine(&line, &tokens);
+        const int tokenCount = static_cast<int>(tokens.size());
+        if (tokenCount == 0) {
+            continue;
+        }
+        if (tokens[0] == "locale" && tokenCount == 2) {
+            locale = tokens[1];
+        } else if (tokens[0] == "keyboard" && tokenCount == 7) {
+            isValid = parseInts(&tokens, 1, 6, keyboard);
+            hasKeyboard = true;
+        } else if (tokens[0] == "key" && (tokenCount == 6 || tokenCount == 9)) {
+            int key[5];
+            float sweetSpot[3];
+            isValid = parseInts(&tokens, 1, 5, key)
+                    && (tokenCount == 6 || parseFloats(&tokens, 6, 3, sweetSpot));
+            if (!isValid) {
+                break;
+            }
+            keyCodePoints.push_back(key[0]);
+            keyXs.push_back(key[1]);
+            keyYs.push_back(key[2]);
+            keyWidths.push_back(key[3]);
+            keyHeights.push_back(key[4]);
+            if (tokenCount == 9) {
+                sweetSpotCenterXs.push_back(sweetSpot[0]);
+                sweetSpotCenterYs.push_back(sweetSpot[1]);
+                sweetSpotRadii.push_back(sweetSpot[2]);
+            }
+        } else {
+            isValid = false;
+        }
+    }
+    fclose(file);
+    if (!isValid || !hasKeyboard || keyboard[2] <= 0 || keyboard[3] <= 0 || keyboard[4] <= 0
+            || locale.size() >= MAX_LOCALE_STRING_LENGTH) {
+        fprintf(stderr, "Invalid layout %s at line %d\n", layoutPath, lineNumber);
+        return 0;
+    }
+    const int keyboardWidth = keyboard[0];
+    const int keyboardHeight = keyboard[1];
+    const int gridWidth = keyboard[2];
+    const int gridHeight = keyboard[3];
+    const int mostCommonKeyWidth = keyboard[4];
+    const int cellWidth = (keyboardWidth + gridWidth - 1) / gridWidth;
+    const int cellHeight = (keyboardHeight + gridHeight - 1) / gridHeight;
+    const int thresholdBase = static_cast<int>(mostCommonKeyWidth * SEARCH_DISTANCE);
+    const int threshold = thresholdBase * thresholdBase;
+    const int keyCount = static_cast<int>(keyCodePoints.size());
+    std::vector<int> proximityChars(gridWidth * gridHeight * MAX_PROXIMITY_CHARS_SIZE,
+            NOT_A_CODE_POINT);
+    for (int cellIndex = 0; cellIndex < gridWidth * gridHeight; ++cellIndex) {
+        const int centerX = (cellIndex % gridWidth) * cellWidth + cellWidth / 2;
+        const int centerY = (cellIndex / gridWidth) * cellHeight + cellHeight / 2;
+        int count = 0;
+        for (int i = 0; i < keyCount && count < MAX_PROXIMITY_CHARS_SIZE; ++i) {
+            // The special keys have negative codes and no proximity.
+            if (keyCodePoints[i] >= KEYCODE_SPACE
+                    && getSquaredDistanceToEdge(centerX, centerY, keyXs[i], keyYs[i],
+                            keyWidths[i], keyHeights[i]) < threshold) {
+                proximityChars[cellIndex * MAX_PROXIMITY_CHARS_SIZE + count] = keyCodePoints[i];
+                ++count;
+            }
+        }
+    }
+    const bool hasSweetSpots = keyCount > 0
+            && static_cast<int>(sweetSpotRadii.size()) == keyCount;
+    return new ProximityInfo(locale.c_str(), keyboardWidth, keyboardHeight, gridWidth,
+            gridHeight, mostCommonKeyWidth, keyboard[5], &proximityChars[0], keyCount,
+            getData(&keyXs), getData(&keyYs), getData(&keyWidths), getData(&keyHeights),
+            getData(&keyCodePoints), hasSweetSpots ? &sweetSpotCenterXs[0] : 0,
+            hasSweetSpots ? &sweetSpotCenterYs[0] : 0, hasSweetSpots ? &sweetSpotRadii[0] : 0);
+}
+
+/* static */ bool ReplayUtils::readInputs(const char *const inputLogPath,
+        std::vector<ReplayInput> *const outInputs) {
+    FILE *const file = fopen(inputLogPath, "r");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s: %s\n", inputLogPath, strerror(errno));
+        return false;
+    }
+    std::string line;
+    std::vector<std::string> tokens;
+    int lineNumber = 0;
+    bool isValid = true;
+    while (isValid && readLine(file, &line)) {
+        ++lineNumber;
+        splitLine(&line, &tokens);
+        const int tokenCount = static_cast<int>(tokens.size());
+        if (tokenCount == 0) {
+            continue;
+        }
+        if (tokenCount < 2 || (tokens[0] != "typing" && tokens[0] != "gesture")) {
+            isValid = false;
+            break;
+        }
+        outInputs->push_back(ReplayInput());
+        ReplayInput *const input = &outInputs->back();
+        input->mIsGesture = tokens[0] == "gesture";
+        if (tokens[1] != "-") {
+            isValid = decodeUtf8(&tokens[1], &input->mPrevWordCodePoints)
+                    && input->mPrevWordCodePoints.size() <= MAX_WORD_LENGTH;
+        }
+        int pointTokenCount = tokenCount;
+        if (tokenCount > 2 && tokens[tokenCount - 1][0] == '=') {
+            --pointTokenCount;
+            const std::string expectedWord = tokens[tokenCount - 1].substr(1);
+            isValid = decodeUtf8(&expectedWord, &input->mExpectedCodePoints)
+                    && !input->mExpectedCodePoints.empty()
+                    && input->mExpectedCodePoints.size() <= MAX_WORD_LENGTH;
+        }
+        for (int i = 2; isValid && i < pointTokenCount; ++i) {
+            int point[5];
+            char end = '\0';
+            isValid = sscanf(tokens[i].c_str(), "%d,%d,%d,%d,%d%c", &point[0], &point[1],
+                    &point[2], &point[3], &point[4], &end) == 5;
+            if (!isValid) {
+                break;
+            }
+            input->mCodePoints.push_back(point[0]);
+            input->mXs.push_back(point[1]);
+            input->mYs.push_back(point[2]);
+            input->mTimes.push_back(point[3]);
+            input->mPointerIds.push_back(point[4]);
+        }
+        // Java never sends longer typed words.
+        if (!input->mIsGesture && input->getInputSize() > MAX_WORD_LENGTH) {
+            isValid = false;
+        }
+    }
+    fclose(file);
+    if (!isValid) {
+        fprintf(stderr, "Invalid input log %s at line %d\n", inputLogPath, lineNumber);
+    }
+    return isValid;
+}
+
+/* static */ bool ReplayUtils::canReplay(const ReplayInput *const input) {
+    return !input->mIsGesture || GestureSuggestPolicyFactory::getGestureSuggestPolicy();
+}
+
+/* static */ void ReplayUtils::getSuggestions(const Dictionary *const dictionary,
+        ProximityInfo *const proximityInfo, void *const traverseSession,
+        const ReplayInput *const input, ReplayResult *const outResult) {
+    // The engine writes its results over zeroes, e.g. the bigrams are inserted by probability.
+    memset(outResult, 0, sizeof(*outResult));
+    int *const prevWordCodePoints = const_cast<int *>(getData(&input->mPrevWordCodePoints));
+    const int prevWordLength = static_cast<int>(input->mPrevWordCodePoints.size());
+    int *const codePoints = const_cast<int *>(getData(&input->mCodePoints));
+    if (input->mIsGesture || input->getInputSize() > 0) {
+        outResult->mCount = dictionary->getSuggestions(proximityInfo, traverseSession,
+                const_cast<int *>(getData(&input->mXs)), const_cast<int *>(getData(&input->mYs)),
+                const_cast<int *>(getData(&input->mTimes)),
+                const_cast<int *>(getData(&input->mPointerIds)), codePoints,
+                input->getInputSize(), prevWordCodePoints, prevWordLength, 0 /* commitPoint */,
+                input->mIsGesture, false /* useFullEditDistance */,
+                outResult->mOutputCodePoints, outResult->mScores, outResult->mSpaceIndices,
+                outResult->mOutputTypes);
+    } else {
+        outResult->mCount = dictionary->getBigrams(traverseSession, prevWordCodePoints,
+                prevWordLength, codePoints, 0 /* inputSize */, outResult->mOutputCodePoints,
+                outResult->mScores, outResult->mOutputTypes);
+    }
+}
+} // namespace latinime
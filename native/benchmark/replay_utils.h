@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_REPLAY_UTILS_H
+#define LATINIME_REPLAY_UTILS_H
+
+#include <vector>
+
+#include "defines.h"
+
+namespace latinime {
+
+class Dictionary;
+class ProximityInfo;
+
+// One recorded getSuggestions call.
+struct ReplayInput {
+    ReplayInput()
+            : mIsGesture(false), mPrevWordCodePoints(), mCodePoints(), mXs(), mYs(), mTimes(),
+              mPointerIds(), mExpectedCodePoints() {}
+
+    int getInputSize() const { return static_cast<int>(mCodePoints.size()); }
+
+    bool mIsGesture;
+    std::vector<int> mPrevWordCodePoints;
+    std::vector<int> mCodePoints;
+    std::vector<int> mXs;
+    std::vector<int> mYs;
+    std::vector<int> mTimes;
+    std::vector<int> mPointerIds;
+    // The word the user meant, or empty if the input is not labeled.
+    std::vector<int> mExpectedCodePoints;
+};
+
+// The output of a call, as the JNI returns it to Java.
+struct ReplayResult {
+    int mCount;
+    int mOutputCodePoints[MAX_WORD_LENGTH * MAX_RESULTS];
+    int mScores[MAX_RESULTS];
+    int mSpaceIndices[MAX_RESULTS];
+    int mOutputTypes[MAX_RESULTS];
+};
+
+/**
+ * Loads the recorded workloads of the native tools and replays them through the engine the way
+ * the JNI does, without a Java VM.
+ *
+ * A layout file has one item per line, and # starts a comment:
+ *   locale <locale>
+ *   keyboard <width> <height> <gridWidth> <gridHeight> <mostCommonKeyWidth> <mostCommonKeyHeight>
+ *   key <codePoint> <x> <y> <width> <height> [<sweetSpotCenterX> <sweetSpotCenterY> <radius>]
+ * The proximity chars of the grid are computed from the keys as the Java ProximityInfo does.
+ * Touch position correction is used when every key has a sweet spot.
+ *
+ * An input log has one getSuggestions call per line, in the order they were made:
+ *   <typing|gesture> <previous word, or - for none> <codePoint>,<x>,<y>,<time>,<pointerId> ...
+ * The previous word is in UTF-8. A typing call without points gets the bigram predictions.
+ * A labeled input ends with =<expected word>, also in UTF-8, for the evaluation of the results.
+ */
+class ReplayUtils {
+ public:
+    // Maps the dictionary file, or returns 0 after printing the error.
+    static Dictionary *openDictionary(const char *const path);
+    static void closeDictionary(Dictionary *const dictionary);
+
+    // Returns 0 after printing the error if the layout file is invalid.
+    static ProximityInfo *createProximityInfo(const char *const layoutPath);
+
+    // Returns false after printing the error if the input log is invalid.
+    static bool readInputs(const char *const inputLogPath,
+            std::vector<ReplayInput> *const outInputs);
+
+    // Whether the engine can make the call of the input. The gesture policy is not part of
+    // this tree, and is only there when its library is linked in.
+    static bool canReplay(const ReplayInput *const input);
+
+    // Makes the call of the input with the session.
+    static void getSuggestions(const Dictionary *const dictionary,
+            ProximityInfo *const proximityInfo, void *const traverseSession,
+            const ReplayInput *const input, ReplayResult *const outResult);
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ReplayUtils);
+};
+} // namespace latinime
+#endif // LATINIME_REPLAY_UTILS_H
@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Evaluates the quality and the effort of the suggestions on a labeled input log, to tune the
+ * parameters of the scoring, e.g. ScoringParams, without regressing the corrections unnoticed.
+ * For each input, reports the rank of the expected word in the suggestions, the dicNodes the
+ * search expanded and the fastest latency of the calls. The parameters are compiled in, so to
+ * compare two parameter sets, write the report of each build and diff them.
+ *
+ * Usage: latinime_scoring_evaluation <dictionary> <layout> <labeled input log> [<report>
+ *         [<iterations>]]
+ *        latinime_scoring_evaluation -diff <base report> <new report>
+ * See replay_utils.h for the format of the labeled input log.
+ */
+
+#define LOG_TAG "LatinIME: scoring_evaluation.cpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "defines.h"
+#include "dic_traverse_wrapper.h"
+#include "dictionary.h"
+#include "proximity_info.h"
+#include "replay_utils.h"
+#include "suggest/core/session/search_statistics.h"
+#include "trace_recorder.h"
+
+namespace latinime {
+
+namespace {
+
+const int DEFAULT_ITERATION_COUNT = 3;
+const int NOT_FOUND_RANK = -1;
+const int TOP_RANK_COUNT = 3;
+const int MAX_REPORT_WORD_LENGTH = 256;
+
+// The evaluation of one labeled input, as written in a line of a report.
+struct Evaluation {
+    Evaluation()
+            : mRank(NOT_FOUND_RANK), mExpandedDicNodes(0), mLatencyUs(0), mExpectedWord(),
+              mTopWord() {}
+
+    // The rank of the expected word in the suggestions, or NOT_FOUND_RANK.
+    int mRank;
+    int64_t mExpandedDicNodes;
+    int64_t mLatencyUs;
+    std::string mExpectedWord;
+    // The first suggestion, or - if there is none.
+    std::string mTopWord;
+};
+
+void encodeUtf8(const int *const codePoints, const int length, std::string *const outUtf8) {
+    outUtf8->clear();
+    for (int i = 0; i < length && codePoints[i] != 0; ++i) {
+        const int codePoint = codePoints[i];
+        if (codePoint < 0x80) {
+            outUtf8->push_back(static_cast<char>(codePoint));
+        } else if (codePoint < 0x800) {
+            outUtf8->push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            outUtf8->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        } else if (codePoint < 0x10000) {
+            outUtf8->push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            outUtf8->push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            outUtf8->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        } else {
+            outUtf8->push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            outUtf8->push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            outUtf8->push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            outUtf8->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+}
+
+int getRank(const ReplayResult *const result, const std::vector<int> *const expectedCodePoints) {
+    const int expectedLength = static_cast<int>(expectedCodePoints->size());
+    for (int i = 0; i < result->mCount; ++i) {
+        const int *const word = &result->mOutputCodePoints[i * MAX_WORD_LENGTH];
+        if ((expectedLength == MAX_WORD_LENGTH || word[expectedLength] == 0)
+                && std::equal(expectedCodePoints->begin(), expectedCodePoints->end(), word)) {
+            return i;
+        }
+    }
+    return NOT_FOUND_RANK;
+}
+
+// Evaluates the inputs in order with one session, like the keyboard makes the calls. The rank and
+// the effort are those of the first iteration, the latency the fastest of all of them.
+void evaluate(const Dictionary *const dictionary, ProximityInfo *const proximityInfo,
+        const std::vector<ReplayInput> *const inputs, const int iterationCount,
+        std::vector<Evaluation> *const outEvaluations) {
+    // The session does not use the Java VM.
+    void *const traverseSession = DicTraverseWrapper::getDicTraverseSession(0, 0);
+    const int inputCount = static_cast<int>(inputs->size());
+    outEvaluations->assign(inputCount, Evaluation());
+    ReplayResult result;
+    for (int iteration = 0; iteration < iterationCount; ++iteration) {
+        for (int i = 0; i < inputCount; ++i) {
+            const ReplayInput *const input = &(*inputs)[i];
+            Evaluation *const evaluation = &(*outEvaluations)[i];
+            const int64_t startTimeNs = TraceRecorder::getCurrentTimeNs();
+            ReplayUtils::getSuggestions(dictionary, proximityInfo, traverseSession, input,
+                    &result);
+            const int64_t latencyUs = (TraceRecorder::getCurrentTimeNs() - startTimeNs) / 1000;
+            int64_t statistics[SearchStatistics::STATISTIC_COUNT] = {};
+            DicTraverseWrapper::addDicTraverseSessionStatistics(traverseSession, statistics,
+                    true /* reset */);
+            if (iteration > 0) {
+                evaluation->mLatencyUs = min(evaluation->mLatencyUs, latencyUs);
+                continue;
+            }
+            evaluation->mLatencyUs = latencyUs;
+            evaluation->mExpandedDicNodes =
+                    statistics[SearchStatistics::STATISTIC_EXPANDED_DIC_NODES];
+            evaluation->mRank = getRank(&result, &input->mExpectedCodePoints);
+            encodeUtf8(&input->mExpectedCodePoints[0],
+                    static_cast<int>(input->mExpectedCodePoints.size()),
+                    &evaluation->mExpectedWord);
+            encodeUtf8(result.mOutputCodePoints, result.mCount > 0 ? MAX_WORD_LENGTH : 0,
+                    &evaluation->mTopWord);
+            if (evaluation->mTopWord.empty()) {
+                evaluation->mTopWord = "-";
+            }
+        }
+    }
+    DicTraverseWrapper::releaseDicTraverseSession(traverseSession);
+}
+
+// The nearest-rank percentile of the latencies.
+int64_t getLatencyPercentileUs(const std::vector<Evaluation> *const evaluations,
+        const int percentile) {
+    std::vector<int64_t> latenciesUs;
+    for (int i = 0; i < static_cast<int>(evaluations->size()); ++i) {
+        latenciesUs.push_back((*evaluations)[i].mLatencyUs);
+    }
+    if (latenciesUs.empty()) {
+        return 0;
+    }
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    const int rank = (static_cast<int>(latenciesUs.size()) * percentile + 99) / 100;
+    return latenciesUs[max(rank - 1, 0)];
+}
+
+struct Summary {
+    Summary()
+            : mInputCount(0), mTopOneCount(0), mTopThreeCount(0), mExpandedDicNodes(0),
+              mLatencyP50Us(0), mLatencyP95Us(0) {}
+
+    int mInputCount;
+    int mTopOneCount;
+    int mTopThreeCount;
+    int64_t mExpandedDicNodes;
+    int64_t mLatencyP50Us;
+    int64_t mLatencyP95Us;
+};
+
+void summarize(const std::vector<Evaluation> *const evaluations, Summary *const outSummary) {
+    outSummary->mInputCount = static_cast<int>(evaluations->size());
+    for (int i = 0; i < outSummary->mInputCount; ++i) {
+        const Evaluation *const evaluation = &(*evaluations)[i];
+        if (evaluation->mRank == 0) {
+            ++outSummary->mTopOneCount;
+        }
+        if (evaluation->mRank != NOT_FOUND_RANK && evaluation->mRank < TOP_RANK_COUNT) {
+            ++outSummary->mTopThreeCount;
+        }
+        outSummary->mExpandedDicNodes += evaluation->mExpandedDicNodes;
+    }
+    outSummary->mLatencyP50Us = getLatencyPercentileUs(evaluations, 50);
+    outSummary->mLatencyP95Us = getLatencyPercentileUs(evaluations, 95);
+}
+
+double getPercentage(const int count, const int total) {
+    return total > 0 ? count * 100.0 / total : 0.0;
+}
+
+double getMean(const int64_t sum, const int count) {
+    return count > 0 ? static_cast<double>(sum) / count : 0.0;
+}
+
+void printSummary(const Summary *const summary) {
+    printf("%d inputs: top-1 %.1f%%, top-%d %.1f%%, %.1f expanded dicNodes per input, "
+            "latency p50 %lld us, p95 %lld us\n", summary->mInputCount,
+            getPercentage(summary->mTopOneCount, summary->mInputCount), TOP_RANK_COUNT,
+            getPercentage(summary->mTopThreeCount, summary->mInputCount),
+            getMean(summary->mExpandedDicNodes, summary->mInputCount),
+            static_cast<long long>(summary->mLatencyP50Us),
+            static_cast<long long>(summary->mLatencyP95Us));
+}
+
+// A report has one line per input: <rank> <expanded dicNodes> <latency in us> <expected word>
+// <first suggestion>. The first suggestion is last as it may have spaces. The lines starting
+// with # are comments.
+bool writeReport(const char *const path, const std::vector<Evaluation> *const evaluations) {
+    FILE *const file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+    fprintf(file, "# rank expandedDicNodes latencyUs expectedWord topWord\n");
+    for (int i = 0; i < static_cast<int>(evaluations->size()); ++i) {
+        const Evaluation *const evaluation = &(*evaluations)[i];
+        fprintf(file, "%d %lld %lld %s %s\n", evaluation->mRank,
+                static_cast<long long>(evaluation->mExpandedDicNodes),
+                static_cast<long long>(evaluation->mLatencyUs),
+                evaluation->mExpectedWord.c_str(), evaluation->mTopWord.c_str());
+    }
+    fclose(file);
+    return true;
+}
+
+bool readReport(const char *const path, std::vector<Evaluation> *const outEvaluations) {
+    FILE *const file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    outEvaluations->clear();
+    char line[3 * MAX_REPORT_WORD_LENGTH];
+    bool isValid = true;
+    while (isValid && fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        Evaluation evaluation;
+        long long expandedDicNodes = 0;
+        long long latencyUs = 0;
+        char expectedWord[MAX_REPORT_WORD_LENGTH];
+        char topWord[MAX_REPORT_WORD_LENGTH];
+        isValid = sscanf(line, "%d %lld %lld %255s %255[^\n]", &evaluation.mRank,
+                &expandedDicNodes, &latencyUs, expectedWord, topWord) == 5;
+        evaluation.mExpandedDicNodes = expandedDicNodes;
+        evaluation.mLatencyUs = latencyUs;
+        evaluation.mExpectedWord = expectedWord;
+        evaluation.mTopWord = topWord;
+        outEvaluations->push_back(evaluation);
+    }
+    fclose(file);
+    if (!isValid) {
+        fprintf(stderr, "Invalid report %s\n", path);
+    }
+    return isValid;
+}
+
+// Prints the changes of the summary, then the inputs whose first suggestion became right or wrong.
+int diffReports(const char *const basePath, const char *const newPath) {
+    std::vector<Evaluation> baseEvaluations;
+    std::vector<Evaluation> newEvaluations;
+    if (!readReport(basePath, &baseEvaluations) || !readReport(newPath, &newEvaluations)) {
+        return 1;
+    }
+    const int inputCount = static_cast<int>(baseEvaluations.size());
+    bool isSameCorpus = inputCount == static_cast<int>(newEvaluations.size());
+    for (int i = 0; isSameCorpus && i < inputCount; ++i) {
+        isSameCorpus = baseEvaluations[i].mExpectedWord == newEvaluations[i].mExpectedWord;
+    }
+    if (!isSameCorpus) {
+        fprintf(stderr, "The reports are not of the same labeled input log\n");
+        return 1;
+    }
+    Summary baseSummary;
+    Summary newSummary;
+    summarize(&baseEvaluations, &baseSummary);
+    summarize(&newEvaluations, &newSummary);
+    printf("%-24s %12s %12s %12s\n", "", "base", "new", "delta");
+    const double baseTopOne = getPercentage(baseSummary.mTopOneCount, inputCount);
+    const double newTopOne = getPercentage(newSummary.mTopOneCount, inputCount);
+    printf("%-24s %11.1f%% %11.1f%% %+11.1f%%\n", "top-1", baseTopOne, newTopOne,
+            newTopOne - baseTopOne);
+    const double baseTopThree = getPercentage(baseSummary.mTopThreeCount, inputCount);
+    const double newTopThree = getPercentage(newSummary.mTopThreeCount, inputCount);
+    printf("%-24s %11.1f%% %11.1f%% %+11.1f%%\n", "top-3", baseTopThree, newTopThree,
+            newTopThree - baseTopThree);
+    const double baseExpanded = getMean(baseSummary.mExpandedDicNodes, inputCount);
+    const double newExpanded = getMean(newSummary.mExpandedDicNodes, inputCount);
+    printf("%-24s %12.1f %12.1f %+11.1f%%\n", "expanded dicNodes/input", baseExpanded,
+            newExpanded, baseExpanded > 0.0 ? (newExpanded / baseExpanded - 1.0) * 100.0 : 0.0);
+    printf("%-24s %12lld %12lld %+12lld\n", "latency p50 (us)",
+            static_cast<long long>(baseSummary.mLatencyP50Us),
+            static_cast<long long>(newSummary.mLatencyP50Us),
+            static_cast<long long>(newSummary.mLatencyP50Us - baseSummary.mLatencyP50Us));
+    printf("%-24s %12lld %12lld %+12lld\n", "latency p95 (us)",
+            static_cast<long long>(baseSummary.mLatencyP95Us),
+            static_cast<long long>(newSummary.mLatencyP95Us),
+            static_cast<long long>(newSummary.mLatencyP95Us - baseSummary.mLatencyP95Us));
+    for (int pass = 0; pass < 2; ++pass) {
+        // The regressions first, then the fixes.
+        const bool listsRegressions = pass == 0;
+        printf("\n%s:\n", listsRegressions ? "Regressions" : "Fixes");
+        for (int i = 0; i < inputCount; ++i) {
+            const bool wasRight = baseEvaluations[i].mRank == 0;
+            const bool isRight = newEvaluations[i].mRank == 0;
+            if (wasRight != isRight && isRight != listsRegressions) {
+                printf("  input %d: %s, top %s -> %s, rank %d -> %d\n", i + 1,
+                        baseEvaluations[i].mExpectedWord.c_str(),
+                        baseEvaluations[i].mTopWord.c_str(), newEvaluations[i].mTopWord.c_str(),
+                        baseEvaluations[i].mRank, newEvaluations[i].mRank);
+            }
+        }
+    }
+    return 0;
+}
+
+int runEvaluation(const int argc, char **const argv) {
+    if (argc == 4 && 0 == strcmp(argv[1], "-diff")) {
+        return diffReports(argv[2], argv[3]);
+    }
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <dictionary> <layout> <labeled input log> [<report> "
+                "[<iterations>]]\n       %s -diff <base report> <new report>\n", argv[0],
+                argv[0]);
+        return 2;
+    }
+    const char *const reportPath = argc > 4 ? argv[4] : 0;
+    const int iterationCount = argc > 5 ? atoi(argv[5]) : DEFAULT_ITERATION_COUNT;
+    if (iterationCount <= 0) {
+        fprintf(stderr, "Invalid iteration count: %s\n", argv[5]);
+        return 2;
+    }
+    std::vector<ReplayInput> inputs;
+    if (!ReplayUtils::readInputs(argv[3], &inputs)) {
+        return 1;
+    }
+    // Only the labeled inputs the engine can make the calls of are evaluated.
+    const int inputCount = static_cast<int>(inputs.size());
+    for (int i = 0; i < static_cast<int>(inputs.size()); ++i) {
+        if (inputs[i].mExpectedCodePoints.empty() || !ReplayUtils::canReplay(&inputs[i])) {
+            inputs.erase(inputs.begin() + i);
+            --i;
+        }
+    }
+    if (static_cast<int>(inputs.size()) < inputCount) {
+        printf("Skipped %d inputs that are not labeled or the engine cannot replay\n",
+                inputCount - static_cast<int>(inputs.size()));
+    }
+    ProximityInfo *const proximityInfo = ReplayUtils::createProximityInfo(argv[2]);
+    if (!proximityInfo) {
+        return 1;
+    }
+    Dictionary *const dictionary = ReplayUtils::openDictionary(argv[1]);
+    if (!dictionary) {
+        delete proximityInfo;
+        return 1;
+    }
+    std::vector<Evaluation> evaluations;
+    evaluate(dictionary, proximityInfo, &inputs, iterationCount, &evaluations);
+    Summary summary;
+    summarize(&evaluations, &summary);
+    printSummary(&summary);
+    ReplayUtils::closeDictionary(dictionary);
+    delete proximityInfo;
+    return !reportPath || writeReport(reportPath, &evaluations) ? 0 : 1;
+}
+
+} // namespace
+} // namespace latinime
+
+int main(int argc, char **argv) {
+    return latinime::runEvaluation(argc, argv);
+}
@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stresses one shared dictionary with concurrent sessions. Each thread replays its own sequence
+ * of randomized inputs with a session of its own, so that the threads share the dictionary and
+ * the layout but not the work. The inputs are drawn from an input log: their points are moved,
+ * some of their keys are replaced by random ones, some are cut short and their previous words are
+ * shuffled. The results of each sequence are checked against a single-threaded run of it, and
+ * the aggregate throughput is reported for each thread count up to the number of cores. The file
+ * formats are described in replay_utils.h.
+ *
+ * Usage: latinime_session_stress_benchmark <dictionary> <layout> <input log> [<max threads>
+ *         [<calls per thread> [<seed>]]]
+ * Exits with 1 if a concurrent result differs from the single-threaded one.
+ */
+
+#define LOG_TAG "LatinIME: session_stress_benchmark.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <vector>
+
+#include "defines.h"
+#include "dic_traverse_wrapper.h"
+#include "dictionary.h"
+#include "proximity_info.h"
+#include "replay_utils.h"
+#include "trace_recorder.h"
+
+namespace latinime {
+
+namespace {
+
+const int DEFAULT_CALL_COUNT_PER_THREAD = 500;
+const unsigned int DEFAULT_SEED = 1;
+// The chances in percent of the randomizations of an input.
+const int SHUFFLED_PREVIOUS_WORD_PERCENT = 30;
+const int CUT_INPUT_PERCENT = 20;
+const int REPLACED_KEY_PERCENT = 10;
+
+// A linear congruential generator, so that a sequence is the same in every run.
+class Random {
+ public:
+    explicit Random(const unsigned int seed) : mState(seed) {}
+
+    // Returns an int in [0, bound).
+    int nextInt(const int bound) {
+        mState = mState * 1103515245u + 12345u;
+        return static_cast<int>((mState >> 16) % static_cast<unsigned int>(bound));
+    }
+
+ private:
+    unsigned int mState;
+};
+
+// The inputs replayed by a thread, and their results in a single-threaded run.
+struct Sequence {
+    Sequence() : mInputs(), mExpectedResults() {}
+
+    std::vector<ReplayInput> mInputs;
+    std::vector<ReplayResult> mExpectedResults;
+};
+
+// A thread replaying a sequence with its own session.
+class Worker {
+ public:
+    Worker(const Dictionary *const dictionary, ProximityInfo *const proximityInfo,
+            const Sequence *const sequence)
+            : mDictionary(dictionary), mProximityInfo(proximityInfo), mSequence(sequence),
+              mTraverseSession(DicTraverseWrapper::getDicTraverseSession(0, 0)), mThread(),
+              mMismatchCount(0), mFirstMismatchIndex(-1) {}
+
+    ~Worker() {
+        DicTraverseWrapper::releaseDicTraverseSession(mTraverseSession);
+    }
+
+    bool start() {
+        return pthread_create(&mThread, 0, threadMain, this) == 0;
+    }
+
+    void join() {
+        pthread_join(mThread, 0);
+    }
+
+    int getMismatchCount() const { return mMismatchCount; }
+    int getFirstMismatchIndex() const { return mFirstMismatchIndex; }
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(Worker);
+
+    static void *threadMain(void *worker) {
+        static_cast<Worker *>(worker)->replay();
+        return 0;
+    }
+
+    void replay() {
+        ReplayResult result;
+        for (int i = 0; i < static_cast<int>(mSequence->mInputs.size()); ++i) {
+            ReplayUtils::getSuggestions(mDictionary, mProximityInfo, mTraverseSession,
+                    &mSequence->mInputs[i], &result);
+            // The results are written over zeroes, so whole results can be compared.
+            if (memcmp(&result, &mSequence->mExpectedResults[i], sizeof(result)) != 0) {
+                if (mMismatchCount == 0) {
+                    mFirstMismatchIndex = i;
+                }
+                ++mMismatchCount;
+            }
+        }
+    }
+
+    const Dictionary *const mDictionary;
+    ProximityInfo *const mProximityInfo;
+    const Sequence *const mSequence;
+    void *const mTraverseSession;
+    pthread_t mThread;
+    int mMismatchCount;
+    int mFirstMismatchIndex;
+};
+
+int clamp(const int value, const int minValue, const int maxValue) {
+    return min(max(value, minValue), maxValue);
+}
+
+// Draws an input from the recorded ones and randomizes it.
+void makeRandomInput(const std::vector<ReplayInput> *const recordedInputs,
+        const ProximityInfo *const proximityInfo, Random *const random,
+        ReplayInput *const outInput) {
+    const int recordedInputCount = static_cast<int>(recordedInputs->size());
+    *outInput = (*recordedInputs)[random->nextInt(recordedInputCount)];
+    outInput->mExpectedCodePoints.clear();
+    if (random->nextInt(100) < SHUFFLED_PREVIOUS_WORD_PERCENT) {
+        outInput->mPrevWordCodePoints =
+                (*recordedInputs)[random->nextInt(recordedInputCount)].mPrevWordCodePoints;
+    }
+    const int inputSize = outInput->getInputSize();
+    if (!outInput->mIsGesture && inputSize > 1 && random->nextInt(100) < CUT_INPUT_PERCENT) {
+        const int cutInputSize = 1 + random->nextInt(inputSize - 1);
+        outInput->mCodePoints.resize(cutInputSize);
+        outInput->mXs.resize(cutInputSize);
+        outInput->mYs.resize(cutInputSize);
+        outInput->mTimes.resize(cutInputSize);
+        outInput->mPointerIds.resize(cutInputSize);
+    }
+    const int maxShift = proximityInfo->getMostCommonKeyWidth() / 4;
+    for (int i = 0; i < static_cast<int>(outInput->mXs.size()); ++i) {
+        if (!outInput->mIsGesture && random->nextInt(100) < REPLACED_KEY_PERCENT) {
+            const int keyIndex = random->nextInt(proximityInfo->getKeyCount());
+            const int codePoint = proximityInfo->getCodePointOf(keyIndex);
+            if (codePoint > 0) {
+                outInput->mCodePoints[i] = codePoint;
+                outInput->mXs[i] = proximityInfo->getKeyCenterXOfKeyIdG(keyIndex);
+                outInput->mYs[i] = proximityInfo->getKeyCenterYOfKeyIdG(keyIndex);
+            }
+        }
+        outInput->mXs[i] = clamp(outInput->mXs[i] + random->nextInt(2 * maxShift + 1) - maxShift,
+                0, proximityInfo->getKeyboardWidth() - 1);
+        outInput->mYs[i] = clamp(outInput->mYs[i] + random->nextInt(2 * maxShift + 1) - maxShift,
+                0, proximityInfo->getKeyboardHeight() - 1);
+    }
+}
+
+// Runs a worker on each of the threadCount first sequences at once. Returns the calls per second
+// of all the threads, and adds the mismatches.
+double runConcurrently(const Dictionary *const dictionary, ProximityInfo *const proximityInfo,
+        const std::vector<Sequence> *const sequences, const int threadCount,
+        int *const outMismatchCount) {
+    // The sessions are created before the clock starts, and they start without any cache like
+    // the sessions of the single-threaded runs.
+    std::vector<Worker *> workers;
+    int callCount = 0;
+    for (int i = 0; i < threadCount; ++i) {
+        workers.push_back(new Worker(dictionary, proximityInfo, &(*sequences)[i]));
+        callCount += static_cast<int>((*sequences)[i].mInputs.size());
+    }
+    const int64_t startTimeNs = TraceRecorder::getCurrentTimeNs();
+    int startedCount = 0;
+    while (startedCount < threadCount && workers[startedCount]->start()) {
+        ++startedCount;
+    }
+    for (int i = 0; i < startedCount; ++i) {
+        workers[i]->join();
+    }
+    const int64_t durationNs = TraceRecorder::getCurrentTimeNs() - startTimeNs;
+    if (startedCount < threadCount) {
+        fprintf(stderr, "Could only start %d threads\n", startedCount);
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        if (workers[i]->getMismatchCount() > 0) {
+            printf("Call %d of sequence %d differs from the single-threaded run, and %d more\n",
+                    workers[i]->getFirstMismatchIndex(), i, workers[i]->getMismatchCount() - 1);
+        }
+        *outMismatchCount += workers[i]->getMismatchCount();
+        delete workers[i];
+    }
+    return durationNs > 0 ? callCount * 1000000000.0 / durationNs : 0.0;
+}
+
+int runBenchmark(const int argc, char **const argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <dictionary> <layout> <input log> [<max threads> "
+                "[<calls per thread> [<seed>]]]\n", argv[0]);
+        return 2;
+    }
+    const int coreCount = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+    const int maxThreadCount = argc > 4 ? atoi(argv[4]) : max(coreCount, 1);
+    const int callCountPerThread = argc > 5 ? atoi(argv[5]) : DEFAULT_CALL_COUNT_PER_THREAD;
+    const unsigned int seed =
+            argc > 6 ? static_cast<unsigned int>(strtoul(argv[6], 0, 10)) : DEFAULT_SEED;
+    if (maxThreadCount < 1 || callCountPerThread < 1) {
+        fprintf(stderr, "Invalid thread or call count\n");
+        return 2;
+    }
+    std::vector<ReplayInput> recordedInputs;
+    if (!ReplayUtils::readInputs(argv[3], &recordedInputs)) {
+        return 1;
+    }
+    for (int i = 0; i < static_cast<int>(recordedInputs.size()); ++i) {
+        if (!ReplayUtils::canReplay(&recordedInputs[i])) {
+            recordedInputs.erase(recordedInputs.begin() + i);
+            --i;
+        }
+    }
+    if (recordedInputs.empty()) {
+        fprintf(stderr, "No input of %s can be replayed\n", argv[3]);
+        return 1;
+    }
+    ProximityInfo *const proximityInfo = ReplayUtils::createProximityInfo(argv[2]);
+    if (!proximityInfo) {
+        return 1;
+    }
+    Dictionary *const dictionary = ReplayUtils::openDictionary(argv[1]);
+    if (!dictionary) {
+        delete proximityInfo;
+        return 1;
+    }
+
+    // The single-threaded runs also warm the dictionary up.
+    std::vector<Sequence> sequences(maxThreadCount);
+    for (int i = 0; i < maxThreadCount; ++i) {
+        Sequence *const sequence = &sequences[i];
+        Random random(seed + i);
+        sequence->mInputs.resize(callCountPerThread);
+        sequence->mExpectedResults.resize(callCountPerThread);
+        void *const traverseSession = DicTraverseWrapper::getDicTraverseSession(0, 0);
+        for (int j = 0; j < callCountPerThread; ++j) {
+            makeRandomInput(&recordedInputs, proximityInfo, &random, &sequence->mInputs[j]);
+            ReplayUtils::getSuggestions(dictionary, proximityInfo, traverseSession,
+                    &sequence->mInputs[j], &sequence->mExpectedResults[j]);
+        }
+        DicTraverseWrapper::releaseDicTraverseSession(traverseSession);
+    }
+
+    printf("%d calls per thread, %d cores\n", callCountPerThread, coreCount);
+    printf("%8s %12s %8s %11s\n", "threads", "calls/s", "speedup", "efficiency");
+    int mismatchCount = 0;
+    double singleThreadCallsPerSecond = 0.0;
+    for (int threadCount = 1; threadCount <= maxThreadCount;
+            threadCount = (threadCount < maxThreadCount && threadCount * 2 > maxThreadCount)
+                    ? maxThreadCount : threadCount * 2) {
+        const double callsPerSecond = runConcurrently(dictionary, proximityInfo, &sequences,
+                threadCount, &mismatchCount);
+        if (threadCount == 1) {
+            singleThreadCallsPerSecond = callsPerSecond;
+        }
+        const double speedup = singleThreadCallsPerSecond > 0.0
+                ? callsPerSecond / singleThreadCallsPerSecond : 0.0;
+        printf("%8d %12.1f %8.2f %10.0f%%\n", threadCount, callsPerSecond, speedup,
+                speedup * 100.0 / threadCount);
+    }
+    if (mismatchCount > 0) {
+        printf("%d results differ from the single-threaded runs\n", mismatchCount);
+    } else {
+        printf("All the results match the single-threaded runs\n");
+    }
+
+    ReplayUtils::closeDictionary(dictionary);
+    delete proximityInfo;
+    return mismatchCount > 0 ? 1 : 0;
+}
+
+} // namespace
+} // namespace latinime
+
+int main(int argc, char **argv) {
+    return latinime::runBenchmark(argc, argv);
+}
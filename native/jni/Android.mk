@@ -19,25 +19,60 @@ LOCAL_PATH := $(call my-dir)
 # and the shared library that uses libjni_latinime_common_static.
 FLAG_DBG ?= false
 FLAG_DO_PROFILE ?= false
+FLAG_PARALLEL_EXPANSION ?= false
+FLAG_MULTI_POINTER_GESTURE ?= false
+FLAG_LOWER_BOUND_PRUNING ?= false
+FLAG_BMP_CODE_POINTS ?= false
+FLAG_TWO_PASS_GESTURE ?= false
+FLAG_OPEN_TIME_INDEXES ?= false
 
 ######################################
-include $(CLEAR_VARS)
-
 LATIN_IME_SRC_DIR := src
 
-LOCAL_C_INCLUDES += $(LOCAL_PATH)/$(LATIN_IME_SRC_DIR)
-
-LOCAL_CFLAGS += -Werror -Wall -Wextra -Weffc++ -Wformat=2 -Wcast-qual -Wcast-align \
+# The flags of the core, for both the target and the host libraries.
+LATIN_IME_CFLAGS := -Werror -Wall -Wextra -Weffc++ -Wformat=2 -Wcast-qual -Wcast-align \
     -Wwrite-strings -Wfloat-equal -Wpointer-arith -Winit-self -Wredundant-decls -Wno-system-headers
 
-ifeq ($(TARGET_ARCH), arm)
-ifeq ($(TARGET_GCC_VERSION), 4.6)
-LOCAL_CFLAGS += -Winline
-endif # TARGET_GCC_VERSION
-endif # TARGET_ARCH
+ifeq ($(FLAG_PARALLEL_EXPANSION), true)
+    LATIN_IME_CFLAGS += -DFLAG_PARALLEL_EXPANSION
+endif # FLAG_PARALLEL_EXPANSION
+
+ifeq ($(FLAG_MULTI_POINTER_GESTURE), true)
+    LATIN_IME_CFLAGS += -DFLAG_MULTI_POINTER_GESTURE
+endif # FLAG_MULTI_POINTER_GESTURE
+
+ifeq ($(FLAG_LOWER_BOUND_PRUNING), true)
+    LATIN_IME_CFLAGS += -DFLAG_LOWER_BOUND_PRUNING
+endif # FLAG_LOWER_BOUND_PRUNING
+
+ifeq ($(FLAG_BMP_CODE_POINTS), true)
+    LATIN_IME_CFLAGS += -DFLAG_BMP_CODE_POINTS
+endif # FLAG_BMP_CODE_POINTS
+
+ifeq ($(FLAG_TWO_PASS_GESTURE), true)
+    LATIN_IME_CFLAGS += -DFLAG_TWO_PASS_GESTURE
+endif # FLAG_TWO_PASS_GESTURE
+
+ifeq ($(FLAG_OPEN_TIME_INDEXES), true)
+    LATIN_IME_CFLAGS += -DFLAG_OPEN_TIME_INDEXES
+endif # FLAG_OPEN_TIME_INDEXES
 
 # To suppress compiler warnings for unused variables/functions used for debug features etc.
-LOCAL_CFLAGS += -Wno-unused-parameter -Wno-unused-function
+LATIN_IME_CFLAGS += -Wno-unused-parameter -Wno-unused-function
+
+ifeq ($(FLAG_DO_PROFILE), true)
+    $(warning Making profiling version of native library)
+    LATIN_IME_CFLAGS += -DFLAG_DO_PROFILE -funwind-tables -fno-inline
+else # FLAG_DO_PROFILE
+ifeq ($(FLAG_DBG), true)
+    $(warning Making debug version of native library)
+    LATIN_IME_CFLAGS += -DFLAG_DBG -funwind-tables -fno-inline
+ifeq ($(FLAG_FULL_DBG), true)
+    $(warning Making full debug version of native library)
+    LATIN_IME_CFLAGS += -DFLAG_FULL_DBG
+endif # FLAG_FULL_DBG
+endif # FLAG_DBG
+endif # FLAG_DO_PROFILE
 
 LATIN_IME_JNI_SRC_FILES := \
     com_android_inputmethod_keyboard_ProximityInfo.cpp \
@@ -51,22 +86,51 @@ LATIN_IME_CORE_SRC_FILES := \
     char_utils.cpp \
     correction.cpp \
     dictionary.cpp \
+    dictionary_heat_map.cpp \
+    dictionary_page_warmer.cpp \
+    dictionary_registry.cpp \
     dic_traverse_wrapper.cpp \
     digraph_utils.cpp \
+    key_center_grid.cpp \
+    probability_overlay.cpp \
+    proximity_grid.cpp \
     proximity_info.cpp \
+    proximity_info_cache.cpp \
     proximity_info_params.cpp \
     proximity_info_state.cpp \
     proximity_info_state_utils.cpp \
+    thread_placement.cpp \
+    trace_recorder.cpp \
     unigram_dictionary.cpp \
+    updatable_dictionary.cpp \
     words_priority_queue.cpp \
     suggest/core/suggest.cpp \
     $(addprefix suggest/core/dicnode/, \
         dic_node.cpp \
         dic_node_utils.cpp \
         dic_nodes_cache.cpp) \
-    suggest/core/policy/weighting.cpp \
-    suggest/core/session/dic_traverse_session.cpp \
-    suggest/policyimpl/gesture/gesture_suggest_policy_factory.cpp \
+    suggest/core/dictionary/bigram_list_index.cpp \
+    suggest/core/dictionary/completion_index.cpp \
+    suggest/core/dictionary/decoded_node_index.cpp \
+    suggest/core/dictionary/dictionary_header.cpp \
+    suggest/core/dictionary/shortcut_table.cpp \
+    suggest/core/dictionary/terminal_position_index.cpp \
+    suggest/core/dictionary/word_address_index.cpp \
+    $(addprefix suggest/core/session/, \
+        adaptive_beam_controller.cpp \
+        candidate_path_set.cpp \
+        dic_traverse_session.cpp \
+        expansion_worker_pool.cpp \
+        progressive_results.cpp \
+        search_profile.cpp \
+        suggestion_result_cache.cpp) \
+    $(addprefix suggest/policyimpl/gesture/, \
+        gesture_params.cpp \
+        gesture_scoring.cpp \
+        gesture_suggest_policy.cpp \
+        gesture_suggest_policy_factory.cpp \
+        gesture_traversal.cpp \
+        gesture_weighting.cpp) \
     $(addprefix suggest/policyimpl/typing/, \
         scoring_params.cpp \
         typing_scoring.cpp \
@@ -74,24 +138,23 @@ LATIN_IME_CORE_SRC_FILES := \
         typing_traversal.cpp \
         typing_weighting.cpp)
 
+######################################
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/$(LATIN_IME_SRC_DIR)
+
+LOCAL_CFLAGS += $(LATIN_IME_CFLAGS)
+
+ifeq ($(TARGET_ARCH), arm)
+ifeq ($(TARGET_GCC_VERSION), 4.6)
+LOCAL_CFLAGS += -Winline
+endif # TARGET_GCC_VERSION
+endif # TARGET_ARCH
+
 LOCAL_SRC_FILES := \
     $(LATIN_IME_JNI_SRC_FILES) \
     $(addprefix $(LATIN_IME_SRC_DIR)/, $(LATIN_IME_CORE_SRC_FILES))
 
-ifeq ($(FLAG_DO_PROFILE), true)
-    $(warning Making profiling version of native library)
-    LOCAL_CFLAGS += -DFLAG_DO_PROFILE -funwind-tables -fno-inline
-else # FLAG_DO_PROFILE
-ifeq ($(FLAG_DBG), true)
-    $(warning Making debug version of native library)
-    LOCAL_CFLAGS += -DFLAG_DBG -funwind-tables -fno-inline
-ifeq ($(FLAG_FULL_DBG), true)
-    $(warning Making full debug version of native library)
-    LOCAL_CFLAGS += -DFLAG_FULL_DBG
-endif # FLAG_FULL_DBG
-endif # FLAG_DBG
-endif # FLAG_DO_PROFILE
-
 LOCAL_MODULE := libjni_latinime_common_static
 LOCAL_MODULE_TAGS := optional
 
@@ -124,7 +187,26 @@ LOCAL_LDFLAGS += -ldl
 
 include $(BUILD_SHARED_LIBRARY)
 
+######################################
+# The core without the JNI wrappers, for the host, so that the native tools also run on a
+# workstation, e.g. under perf, valgrind or the sanitizers. The core only needs the declarations
+# of jni.h.
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/$(LATIN_IME_SRC_DIR) $(JNI_H_INCLUDE)
+
+# The host libstdc++ warns that <hash_map> is deprecated.
+LOCAL_CFLAGS += $(LATIN_IME_CFLAGS) -Wno-deprecated
+
+LOCAL_SRC_FILES := $(addprefix $(LATIN_IME_SRC_DIR)/, $(LATIN_IME_CORE_SRC_FILES))
+
+LOCAL_MODULE := liblatinime_core_host_static
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_STATIC_LIBRARY)
+
 #################### Clean up the tmp vars
+LATIN_IME_CFLAGS :=
 LATIN_IME_CORE_SRC_FILES :=
 LATIN_IME_JNI_SRC_FILES :=
 LATIN_IME_SRC_DIR :=
@@ -21,6 +21,7 @@
 #include "jni.h"
 #include "jni_common.h"
 #include "proximity_info.h"
+#include "proximity_info_cache.h"
 
 namespace latinime {
 
@@ -30,16 +31,17 @@ static jlong latinime_Keyboard_setProximityInfo(JNIEnv *env, jclass clazz, jstri
         jintArray keyXCoordinates, jintArray keyYCoordinates, jintArray keyWidths,
         jintArray keyHeights, jintArray keyCharCodes, jfloatArray sweetSpotCenterXs,
         jfloatArray sweetSpotCenterYs, jfloatArray sweetSpotRadii) {
-    ProximityInfo *proximityInfo = new ProximityInfo(env, localeJStr, displayWidth, displayHeight,
-            gridWidth, gridHeight, mostCommonkeyWidth, mostCommonkeyHeight, proximityChars,
-            keyCount, keyXCoordinates, keyYCoordinates, keyWidths, keyHeights, keyCharCodes,
-            sweetSpotCenterXs, sweetSpotCenterYs, sweetSpotRadii);
+    ProximityInfo *proximityInfo = ProximityInfoCache::acquire(env, localeJStr, displayWidth,
+            displayHeight, gridWidth, gridHeight, mostCommonkeyWidth, mostCommonkeyHeight,
+            proximityChars, keyCount, keyXCoordinates, keyYCoordinates, keyWidths, keyHeights,
+            keyCharCodes, sweetSpotCenterXs, sweetSpotCenterYs, sweetSpotRadii);
     return reinterpret_cast<jlong>(proximityInfo);
 }
 
 static void latinime_Keyboard_release(JNIEnv *env, jclass clazz, jlong proximityInfo) {
     ProximityInfo *pi = reinterpret_cast<ProximityInfo *>(proximityInfo);
-    delete pi;
+    if (!pi) return;
+    ProximityInfoCache::release(pi);
 }
 
 static JNINativeMethod sMethods[] = {
@@ -15,13 +15,16 @@
  */
 
 #include <cstring> // for memset()
+#include <vector>
 
 #define LOG_TAG "LatinIME: jni: BinaryDictionary"
 
 #include "defines.h" // for macros below
 
-#ifdef USE_MMAP_FOR_DICTIONARY
 #include <cerrno>
+#include <sys/stat.h>
+
+#ifdef USE_MMAP_FOR_DICTIONARY
 #include <fcntl.h>
 #include <sys/mman.h>
 #else // USE_MMAP_FOR_DICTIONARY
@@ -30,22 +33,34 @@
 #endif // USE_MMAP_FOR_DICTIONARY
 
 #include "binary_format.h"
+#include "char_utils.h"
 #include "com_android_inputmethod_latin_BinaryDictionary.h"
 #include "correction.h"
+#include "dic_traverse_wrapper.h"
 #include "dictionary.h"
+#include "dictionary_heat_map.h"
+#include "dictionary_registry.h"
 #include "jni.h"
 #include "jni_common.h"
+#include "probability_overlay.h"
+#include "proximity_info.h"
+#include "suggest/core/dicnode/dic_node_utils.h"
+#include "suggest/core/session/latency_histogram.h"
+#include "suggest/core/session/search_statistics.h"
+#include "trace_recorder.h"
+#include "updatable_dictionary.h"
 
 namespace latinime {
 
-class ProximityInfo;
-
 static void releaseDictBuf(const void *dictBuf, const size_t length, const int fd);
+static void deleteDictionary(Dictionary *dictionary);
+#ifdef USE_MMAP_FOR_DICTIONARY
+static void adviseDictBuf(void *dictBuf, const size_t length, const int loadOptions);
+#endif // USE_MMAP_FOR_DICTIONARY
 
 static jlong latinime_BinaryDictionary_open(JNIEnv *env, jclass clazz, jstring sourceDir,
-        jlong dictOffset, jlong dictSize) {
-    PROF_OPEN;
-    PROF_START(66);
+        jlong dictOffset, jlong dictSize, jint loadOptions) {
+    TraceSpan openSpan(TraceRecorder::PHASE_OPEN_DICTIONARY);
     const jsize sourceDirUtf8Length = env->GetStringUTFLength(sourceDir);
     if (sourceDirUtf8Length <= 0) {
         AKLOGE("DICT: Can't get sourceDir string");
@@ -54,6 +69,19 @@ static jlong latinime_BinaryDictionary_open(JNIEnv *env, jclass clazz, jstring s
     char sourceDirChars[sourceDirUtf8Length + 1];
     env->GetStringUTFRegion(sourceDir, 0, env->GetStringLength(sourceDir), sourceDirChars);
     sourceDirChars[sourceDirUtf8Length] = '\0';
+    // Taken before the file is opened, so that the data opened is never older than the file
+    // that the registry keys it by.
+    struct stat fileStat;
+    if (stat(sourceDirChars, &fileStat) != 0) {
+        AKLOGE("DICT: Can't stat sourceDir. sourceDirChars=%s errno=%d", sourceDirChars, errno);
+        return 0;
+    }
+    // The load options of the first opener apply to a shared dictionary.
+    Dictionary *const sharedDictionary = DictionaryRegistry::acquire(sourceDirChars, &fileStat,
+            static_cast<long>(dictOffset), static_cast<long>(dictSize));
+    if (sharedDictionary) {
+        return reinterpret_cast<jlong>(sharedDictionary);
+    }
     int fd = 0;
     void *dictBuf = 0;
     int adjust = 0;
@@ -108,23 +136,83 @@ static jlong latinime_BinaryDictionary_open(JNIEnv *env, jclass clazz, jstring s
         return 0;
     }
     Dictionary *dictionary = 0;
+    const uint8_t *const dict = static_cast<uint8_t *>(dictBuf);
+    bool isSupported = true;
     if (BinaryFormat::UNKNOWN_FORMAT
-            == BinaryFormat::detectFormat(static_cast<uint8_t *>(dictBuf),
-                    static_cast<int>(dictSize))) {
+            == BinaryFormat::detectFormat(dict, static_cast<int>(dictSize))) {
         AKLOGE("DICT: dictionary format is unknown, bad magic number");
+        isSupported = false;
+    } else if (USE_BMP_CODE_POINTS) {
+        const int headerSize = BinaryFormat::getHeaderSize(dict, static_cast<int>(dictSize));
+        if (!DicNodeUtils::hasOnlyBmpCodePoints(dict + headerSize,
+                static_cast<int>(dictSize) - headerSize)) {
+            AKLOGE("DICT: dictionary has code points beyond the BMP");
+            isSupported = false;
+        }
+    }
+    if (!isSupported) {
 #ifdef USE_MMAP_FOR_DICTIONARY
         releaseDictBuf(static_cast<const char *>(dictBuf) - adjust, adjDictSize, fd);
 #else // USE_MMAP_FOR_DICTIONARY
         releaseDictBuf(dictBuf, 0, 0);
 #endif // USE_MMAP_FOR_DICTIONARY
     } else {
-        dictionary = new Dictionary(dictBuf, static_cast<int>(dictSize), fd, adjust);
+        dictionary = new Dictionary(dictBuf, static_cast<int>(dictSize), fd, adjust,
+                loadOptions);
+#ifdef USE_MMAP_FOR_DICTIONARY
+        // Given after the dictionary has been constructed, which reads it sequentially.
+        adviseDictBuf(static_cast<char *>(dictBuf) - adjust, adjDictSize, loadOptions);
+#endif // USE_MMAP_FOR_DICTIONARY
+#ifdef USE_MMAP_FOR_DICTIONARY
+        // A malloc'ed buffer is anonymous memory already.
+        const bool copyPages = 0 != (loadOptions & Dictionary::LOAD_OPTION_COPY_HOT_NODES);
+#else // USE_MMAP_FOR_DICTIONARY
+        const bool copyPages = false;
+#endif // USE_MMAP_FOR_DICTIONARY
+        if (copyPages || (loadOptions & (Dictionary::LOAD_OPTION_PREFETCH_HOT_NODES
+                | Dictionary::LOAD_OPTION_LOCK_HOT_NODES))) {
+            dictionary->startPageWarming(
+                    0 != (loadOptions & Dictionary::LOAD_OPTION_LOCK_HOT_NODES), copyPages);
+        }
+        Dictionary *const registeredDictionary = DictionaryRegistry::add(sourceDirChars,
+                &fileStat, static_cast<long>(dictOffset), static_cast<long>(dictSize),
+                dictionary);
+        if (registeredDictionary != dictionary) {
+            // Opened concurrently by another thread
+            deleteDictionary(dictionary);
+            dictionary = registeredDictionary;
+        }
     }
-    PROF_END(66);
-    PROF_CLOSE;
     return reinterpret_cast<jlong>(dictionary);
 }
 
+// The elements of a Java int array for the duration of a native call. A VM that does not move
+// arrays, like Dalvik, hands out the array itself, so the engine reads and writes it in place with
+// no copy. The elements are written back on release, unless the array is only read.
+class ScopedIntArrayElements {
+ public:
+    ScopedIntArrayElements(JNIEnv *env, jintArray array, const bool isReadOnly)
+            : mEnv(env), mArray(array), mIsReadOnly(isReadOnly),
+              mElements(array ? env->GetIntArrayElements(array, 0) : 0) {}
+
+    // Non virtual inline destructor -- never inherit this class
+    ~ScopedIntArrayElements() {
+        if (mElements) {
+            mEnv->ReleaseIntArrayElements(mArray, mElements, mIsReadOnly ? JNI_ABORT : 0);
+        }
+    }
+
+    int *get() const { return mElements; }
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ScopedIntArrayElements);
+
+    JNIEnv *const mEnv;
+    const jintArray mArray;
+    const bool mIsReadOnly;
+    jint *const mElements;
+};
+
 static int latinime_BinaryDictionary_getSuggestions(JNIEnv *env, jclass clazz, jlong dict,
         jlong proximityInfo, jlong dicTraverseSession, jintArray xCoordinatesArray,
         jintArray yCoordinatesArray, jintArray timesArray, jintArray pointerIdsArray,
@@ -137,27 +225,17 @@ static int latinime_BinaryDictionary_getSuggestions(JNIEnv *env, jclass clazz, j
     ProximityInfo *pInfo = reinterpret_cast<ProximityInfo *>(proximityInfo);
     void *traverseSession = reinterpret_cast<void *>(dicTraverseSession);
 
-    // Input values
-    int xCoordinates[inputSize];
-    int yCoordinates[inputSize];
-    int times[inputSize];
-    int pointerIds[inputSize];
-    const jsize inputCodePointsLength = env->GetArrayLength(inputCodePointsArray);
-    int inputCodePoints[inputCodePointsLength];
+    // The input arrays are read in place, so they must be long enough.
+    if (inputSize < 0 || env->GetArrayLength(xCoordinatesArray) < inputSize
+            || env->GetArrayLength(yCoordinatesArray) < inputSize
+            || env->GetArrayLength(timesArray) < inputSize
+            || env->GetArrayLength(pointerIdsArray) < inputSize) {
+        AKLOGE("Invalid inputSize: %d", inputSize);
+        ASSERT(false);
+        return 0;
+    }
     const jsize prevWordCodePointsLength =
             prevWordCodePointsForBigrams ? env->GetArrayLength(prevWordCodePointsForBigrams) : 0;
-    int prevWordCodePointsInternal[prevWordCodePointsLength];
-    int *prevWordCodePoints = 0;
-    env->GetIntArrayRegion(xCoordinatesArray, 0, inputSize, xCoordinates);
-    env->GetIntArrayRegion(yCoordinatesArray, 0, inputSize, yCoordinates);
-    env->GetIntArrayRegion(timesArray, 0, inputSize, times);
-    env->GetIntArrayRegion(pointerIdsArray, 0, inputSize, pointerIds);
-    env->GetIntArrayRegion(inputCodePointsArray, 0, inputCodePointsLength, inputCodePoints);
-    if (prevWordCodePointsForBigrams) {
-        env->GetIntArrayRegion(prevWordCodePointsForBigrams, 0, prevWordCodePointsLength,
-                prevWordCodePointsInternal);
-        prevWordCodePoints = prevWordCodePointsInternal;
-    }
 
     // Output values
     /* By the way, let's check the output array length here to make sure */
@@ -173,35 +251,334 @@ static int latinime_BinaryDictionary_getSuggestions(JNIEnv *env, jclass clazz, j
         ASSERT(false);
         return 0;
     }
-    int outputCodePoints[outputCodePointsLength];
-    int scores[scoresLength];
     const jsize spaceIndicesLength = env->GetArrayLength(spaceIndicesArray);
-    int spaceIndices[spaceIndicesLength];
     const jsize outputTypesLength = env->GetArrayLength(outputTypesArray);
-    int outputTypes[outputTypesLength];
+
+    // Input values
+    const ScopedIntArrayElements xCoordinates(env, xCoordinatesArray, true /* isReadOnly */);
+    const ScopedIntArrayElements yCoordinates(env, yCoordinatesArray, true /* isReadOnly */);
+    const ScopedIntArrayElements times(env, timesArray, true /* isReadOnly */);
+    const ScopedIntArrayElements pointerIds(env, pointerIdsArray, true /* isReadOnly */);
+    const ScopedIntArrayElements inputCodePoints(env, inputCodePointsArray,
+            true /* isReadOnly */);
+    const ScopedIntArrayElements prevWordCodePoints(env, prevWordCodePointsForBigrams,
+            true /* isReadOnly */);
+    const ScopedIntArrayElements outputCodePoints(env, outputCodePointsArray,
+            false /* isReadOnly */);
+    const ScopedIntArrayElements scores(env, scoresArray, false /* isReadOnly */);
+    const ScopedIntArrayElements spaceIndices(env, spaceIndicesArray, false /* isReadOnly */);
+    const ScopedIntArrayElements outputTypes(env, outputTypesArray, false /* isReadOnly */);
+    if (!xCoordinates.get() || !yCoordinates.get() || !times.get() || !pointerIds.get()
+            || !inputCodePoints.get() || (prevWordCodePointsForBigrams && !prevWordCodePoints.get())
+            || !outputCodePoints.get() || !scores.get() || !spaceIndices.get()
+            || !outputTypes.get()) {
+        // Out of memory: an exception is pending.
+        return 0;
+    }
+    // The engine writes its results over zeroes, e.g. the bigrams are inserted by probability.
+    memset(outputCodePoints.get(), 0, outputCodePointsLength * sizeof(outputCodePoints.get()[0]));
+    memset(scores.get(), 0, scoresLength * sizeof(scores.get()[0]));
+    memset(spaceIndices.get(), 0, spaceIndicesLength * sizeof(spaceIndices.get()[0]));
+    memset(outputTypes.get(), 0, outputTypesLength * sizeof(outputTypes.get()[0]));
+
+    // The latency of the native work only, without the copies of the arrays.
+    const int64_t startTimeNs = TraceRecorder::getCurrentTimeNs();
+    int count;
+    if (isGesture || inputSize > 0) {
+        const TraceSpan suggestionsSpan(TraceRecorder::PHASE_GET_SUGGESTIONS);
+        count = dictionary->getSuggestions(pInfo, traverseSession, xCoordinates.get(),
+                yCoordinates.get(), times.get(), pointerIds.get(), inputCodePoints.get(),
+                inputSize, prevWordCodePoints.get(), prevWordCodePointsLength, commitPoint,
+                isGesture, useFullEditDistance, outputCodePoints.get(), scores.get(),
+                spaceIndices.get(), outputTypes.get());
+    } else {
+        const TraceSpan bigramsSpan(TraceRecorder::PHASE_GET_BIGRAMS);
+        count = dictionary->getBigrams(traverseSession, prevWordCodePoints.get(),
+                prevWordCodePointsLength, inputCodePoints.get(), inputSize,
+                outputCodePoints.get(), scores.get(), outputTypes.get());
+    }
+    DicTraverseWrapper::recordDicTraverseSessionLatency(traverseSession, isGesture, inputSize,
+            TraceRecorder::getCurrentTimeNs() - startTimeNs);
+    // The output values are written back when the arrays are released.
+    return count;
+}
+
+// Takes the same input as the last getSuggestions call of the session.
+static jint latinime_BinaryDictionary_speculateNextInput(JNIEnv *env, jclass clazz, jlong dict,
+        jlong proximityInfo, jlong dicTraverseSession, jintArray xCoordinatesArray,
+        jintArray yCoordinatesArray, jintArray timesArray, jintArray pointerIdsArray,
+        jintArray inputCodePointsArray, jint inputSize, jintArray prevWordCodePointsForBigrams,
+        jint maxStepCount) {
+    Dictionary *dictionary = reinterpret_cast<Dictionary *>(dict);
+    if (!dictionary) return 0;
+    ProximityInfo *pInfo = reinterpret_cast<ProximityInfo *>(proximityInfo);
+    void *traverseSession = reinterpret_cast<void *>(dicTraverseSession);
+    if (inputSize <= 0 || env->GetArrayLength(xCoordinatesArray) < inputSize
+            || env->GetArrayLength(yCoordinatesArray) < inputSize
+            || env->GetArrayLength(timesArray) < inputSize
+            || env->GetArrayLength(pointerIdsArray) < inputSize
+            || env->GetArrayLength(inputCodePointsArray) < inputSize) {
+        return 0;
+    }
+    const jsize prevWordCodePointsLength =
+            prevWordCodePointsForBigrams ? env->GetArrayLength(prevWordCodePointsForBigrams) : 0;
+    const ScopedIntArrayElements xCoordinates(env, xCoordinatesArray, true /* isReadOnly */);
+    const ScopedIntArrayElements yCoordinates(env, yCoordinatesArray, true /* isReadOnly */);
+    const ScopedIntArrayElements times(env, timesArray, true /* isReadOnly */);
+    const ScopedIntArrayElements pointerIds(env, pointerIdsArray, true /* isReadOnly */);
+    const ScopedIntArrayElements inputCodePoints(env, inputCodePointsArray,
+            true /* isReadOnly */);
+    const ScopedIntArrayElements prevWordCodePoints(env, prevWordCodePointsForBigrams,
+            true /* isReadOnly */);
+    if (!xCoordinates.get() || !yCoordinates.get() || !times.get() || !pointerIds.get()
+            || !inputCodePoints.get()
+            || (prevWordCodePointsForBigrams && !prevWordCodePoints.get())) {
+        // Out of memory: an exception is pending.
+        return 0;
+    }
+    return dictionary->speculateNextInput(pInfo, traverseSession, xCoordinates.get(),
+            yCoordinates.get(), times.get(), pointerIds.get(), inputCodePoints.get(), inputSize,
+            prevWordCodePoints.get(), prevWordCodePointsLength, maxStepCount);
+}
+
+// Packs the count results of a query as BinaryDictionary#toSuggestedWordInfos reads them in Java:
+// the count, then the length, the score and the type of each word, then the code points of the
+// words one after the other. Returns the number of ints written, at most
+// MAX_PACKED_RESULTS_LENGTH.
+static int packResults(const int count, const int *const codePoints, const int *const scores,
+        const int *const outputTypes, int *const outPackedResults) {
+    outPackedResults[0] = count;
+    int packedLength = 1 + count * 3;
+    for (int i = 0; i < count; ++i) {
+        const int *const word = &codePoints[i * MAX_WORD_LENGTH];
+        const int length = getCodePointCount(MAX_WORD_LENGTH, word);
+        outPackedResults[1 + i * 3] = length;
+        outPackedResults[2 + i * 3] = scores[i];
+        outPackedResults[3 + i * 3] = outputTypes[i];
+        memcpy(&outPackedResults[packedLength], word, length * sizeof(word[0]));
+        packedLength += length;
+    }
+    return packedLength;
+}
+
+static int latinime_BinaryDictionary_getSuggestionsBatch(JNIEnv *env, jclass clazz, jlong dict,
+        jlong proximityInfo, jlong dicTraverseSession, jintArray inputOffsetsArray,
+        jintArray inputCodePointsArray, jintArray xCoordinatesArray, jintArray yCoordinatesArray,
+        jintArray prevWordOffsetsArray, jintArray prevWordCodePointsArray,
+        jboolean useFullEditDistance, jintArray outputResultsArray,
+        jintArray outputOffsetsArray) {
+    Dictionary *dictionary = reinterpret_cast<Dictionary *>(dict);
+    if (!dictionary) return 0;
+    ProximityInfo *pInfo = reinterpret_cast<ProximityInfo *>(proximityInfo);
+    void *traverseSession = reinterpret_cast<void *>(dicTraverseSession);
+
+    const jsize batchSize = env->GetArrayLength(inputOffsetsArray) - 1;
+    if (batchSize <= 0 || batchSize > MAX_SUGGESTION_BATCH_SIZE
+            || env->GetArrayLength(prevWordOffsetsArray) != batchSize + 1
+            || env->GetArrayLength(outputOffsetsArray) != batchSize + 1) {
+        AKLOGE("Invalid batchSize: %d", batchSize);
+        ASSERT(false);
+        return 0;
+    }
+
+    // Input values
+    int inputOffsets[batchSize + 1];
+    int prevWordOffsets[batchSize + 1];
+    env->GetIntArrayRegion(inputOffsetsArray, 0, batchSize + 1, inputOffsets);
+    env->GetIntArrayRegion(prevWordOffsetsArray, 0, batchSize + 1, prevWordOffsets);
+    const jsize inputCodePointsLength = env->GetArrayLength(inputCodePointsArray);
+    const jsize prevWordCodePointsLength = env->GetArrayLength(prevWordCodePointsArray);
+    if (inputOffsets[0] != 0 || inputOffsets[batchSize] > inputCodePointsLength
+            || env->GetArrayLength(xCoordinatesArray) < inputOffsets[batchSize]
+            || env->GetArrayLength(yCoordinatesArray) < inputOffsets[batchSize]
+            || prevWordOffsets[0] != 0 || prevWordOffsets[batchSize] > prevWordCodePointsLength) {
+        AKLOGE("Invalid offsets: inputSize %d, prevWordsSize %d", inputOffsets[batchSize],
+                prevWordOffsets[batchSize]);
+        ASSERT(false);
+        return 0;
+    }
+    // The queries are sorted by their packed inputs, so all of them are checked before.
+    for (int i = 0; i < batchSize; ++i) {
+        if (inputOffsets[i] > inputOffsets[i + 1]
+                || prevWordOffsets[i] > prevWordOffsets[i + 1]) {
+            AKLOGE("Invalid offsets of query %d: %d, %d, %d, %d", i, inputOffsets[i],
+                    inputOffsets[i + 1], prevWordOffsets[i], prevWordOffsets[i + 1]);
+            ASSERT(false);
+            return 0;
+        }
+    }
+    const int totalInputSize = inputOffsets[batchSize];
+    int inputCodePoints[totalInputSize];
+    int xCoordinates[totalInputSize];
+    int yCoordinates[totalInputSize];
+    int prevWordCodePoints[prevWordCodePointsLength];
+    env->GetIntArrayRegion(inputCodePointsArray, 0, totalInputSize, inputCodePoints);
+    env->GetIntArrayRegion(xCoordinatesArray, 0, totalInputSize, xCoordinates);
+    env->GetIntArrayRegion(yCoordinatesArray, 0, totalInputSize, yCoordinates);
+    env->GetIntArrayRegion(prevWordCodePointsArray, 0, prevWordCodePointsLength,
+            prevWordCodePoints);
+
+    // Output values
+    const jsize outputResultsLength = env->GetArrayLength(outputResultsArray);
+    if (outputResultsLength < MAX_PACKED_RESULTS_LENGTH * batchSize) {
+        AKLOGE("Invalid outputResultsLength: %d", outputResultsLength);
+        ASSERT(false);
+        return 0;
+    }
+    const jsize outputCodePointsLength = MAX_WORD_LENGTH * MAX_RESULTS * batchSize;
+    const jsize resultsLength = MAX_RESULTS * batchSize;
+    int outputCodePoints[outputCodePointsLength];
+    int scores[resultsLength];
+    int spaceIndices[resultsLength];
+    int outputTypes[resultsLength];
+    int outputCounts[batchSize];
     memset(outputCodePoints, 0, sizeof(outputCodePoints));
     memset(scores, 0, sizeof(scores));
     memset(spaceIndices, 0, sizeof(spaceIndices));
     memset(outputTypes, 0, sizeof(outputTypes));
 
-    int count;
-    if (isGesture || inputSize > 0) {
-        count = dictionary->getSuggestions(pInfo, traverseSession, xCoordinates, yCoordinates,
-                times, pointerIds, inputCodePoints, inputSize, prevWordCodePoints,
-                prevWordCodePointsLength, commitPoint, isGesture, useFullEditDistance,
-                outputCodePoints, scores, spaceIndices, outputTypes);
-    } else {
-        count = dictionary->getBigrams(prevWordCodePoints, prevWordCodePointsLength,
-                inputCodePoints, inputSize, outputCodePoints, scores, outputTypes);
+    dictionary->getSuggestionsBatch(pInfo, traverseSession, batchSize, inputOffsets,
+            inputCodePoints, xCoordinates, yCoordinates, prevWordOffsets, prevWordCodePoints,
+            useFullEditDistance, outputCodePoints, scores, spaceIndices, outputTypes,
+            outputCounts);
+
+    // Copy back the output values, packed so that only what was found is copied
+    int packedResults[MAX_PACKED_RESULTS_LENGTH];
+    int outputOffsets[batchSize + 1];
+    outputOffsets[0] = 0;
+    for (int i = 0; i < batchSize; ++i) {
+        const int packedLength = packResults(outputCounts[i],
+                &outputCodePoints[i * MAX_WORD_LENGTH * MAX_RESULTS], &scores[i * MAX_RESULTS],
+                &outputTypes[i * MAX_RESULTS], packedResults);
+        env->SetIntArrayRegion(outputResultsArray, outputOffsets[i], packedLength, packedResults);
+        outputOffsets[i + 1] = outputOffsets[i] + packedLength;
     }
+    env->SetIntArrayRegion(outputOffsetsArray, 0, batchSize + 1, outputOffsets);
 
-    // Copy back the output values
-    env->SetIntArrayRegion(outputCodePointsArray, 0, outputCodePointsLength, outputCodePoints);
-    env->SetIntArrayRegion(scoresArray, 0, scoresLength, scores);
-    env->SetIntArrayRegion(spaceIndicesArray, 0, spaceIndicesLength, spaceIndices);
-    env->SetIntArrayRegion(outputTypesArray, 0, outputTypesLength, outputTypes);
+    return batchSize;
+}
 
-    return count;
+// Searches several dictionaries with the same input in one call, each with its own session, and
+// merges their results by score. The input is pinned once for all the dictionaries. The results
+// are packed as BinaryDictionary#getSuggestionsFromDictionaries reads them in Java: the count,
+// then the index of the dictionary, the length, the score and the type of each word, then the
+// code points of the words one after the other. Returns the number of results.
+static jint latinime_BinaryDictionary_getSuggestionsFromDictionaries(JNIEnv *env, jclass clazz,
+        jlongArray dictsArray, jlong proximityInfo, jlongArray dicTraverseSessionsArray,
+        jintArray xCoordinatesArray, jintArray yCoordinatesArray, jintArray timesArray,
+        jintArray pointerIdsArray, jintArray inputCodePointsArray, jint inputSize,
+        jboolean isGesture, jintArray prevWordCodePointsForBigrams,
+        jbooleanArray useFullEditDistancesArray, jintArray outputResultsArray) {
+    const jsize dictCount = env->GetArrayLength(dictsArray);
+    if (dictCount <= 0 || dictCount > MAX_COLLECTION_DICTIONARY_COUNT
+            || env->GetArrayLength(dicTraverseSessionsArray) != dictCount
+            || env->GetArrayLength(useFullEditDistancesArray) != dictCount) {
+        AKLOGE("Invalid dictCount: %d", dictCount);
+        ASSERT(false);
+        return 0;
+    }
+    if (inputSize < 0 || env->GetArrayLength(xCoordinatesArray) < inputSize
+            || env->GetArrayLength(yCoordinatesArray) < inputSize
+            || env->GetArrayLength(timesArray) < inputSize
+            || env->GetArrayLength(pointerIdsArray) < inputSize) {
+        AKLOGE("Invalid inputSize: %d", inputSize);
+        ASSERT(false);
+        return 0;
+    }
+    if (env->GetArrayLength(outputResultsArray) < MAX_COLLECTION_PACKED_RESULTS_LENGTH) {
+        AKLOGE("Invalid outputResultsLength: %d", env->GetArrayLength(outputResultsArray));
+        ASSERT(false);
+        return 0;
+    }
+    ProximityInfo *pInfo = reinterpret_cast<ProximityInfo *>(proximityInfo);
+    jlong dicts[dictCount];
+    jlong dicTraverseSessions[dictCount];
+    jboolean useFullEditDistances[dictCount];
+    env->GetLongArrayRegion(dictsArray, 0, dictCount, dicts);
+    env->GetLongArrayRegion(dicTraverseSessionsArray, 0, dictCount, dicTraverseSessions);
+    env->GetBooleanArrayRegion(useFullEditDistancesArray, 0, dictCount, useFullEditDistances);
+    const jsize prevWordCodePointsLength =
+            prevWordCodePointsForBigrams ? env->GetArrayLength(prevWordCodePointsForBigrams) : 0;
+
+    // Input values
+    const ScopedIntArrayElements xCoordinates(env, xCoordinatesArray, true /* isReadOnly */);
+    const ScopedIntArrayElements yCoordinates(env, yCoordinatesArray, true /* isReadOnly */);
+    const ScopedIntArrayElements times(env, timesArray, true /* isReadOnly */);
+    const ScopedIntArrayElements pointerIds(env, pointerIdsArray, true /* isReadOnly */);
+    const ScopedIntArrayElements inputCodePoints(env, inputCodePointsArray,
+            true /* isReadOnly */);
+    const ScopedIntArrayElements prevWordCodePoints(env, prevWordCodePointsForBigrams,
+            true /* isReadOnly */);
+    if (!xCoordinates.get() || !yCoordinates.get() || !times.get() || !pointerIds.get()
+            || !inputCodePoints.get()
+            || (prevWordCodePointsForBigrams && !prevWordCodePoints.get())) {
+        // Out of memory: an exception is pending.
+        return 0;
+    }
+
+    // Output values, the results of the dictionary i from i * MAX_RESULTS
+    int outputCodePoints[MAX_WORD_LENGTH * MAX_RESULTS * dictCount];
+    int scores[MAX_RESULTS * dictCount];
+    int spaceIndices[MAX_RESULTS * dictCount];
+    int outputTypes[MAX_RESULTS * dictCount];
+    // The engine writes its results over zeroes, e.g. the bigrams are inserted by probability.
+    memset(outputCodePoints, 0, sizeof(outputCodePoints));
+    memset(scores, 0, sizeof(scores));
+    memset(spaceIndices, 0, sizeof(spaceIndices));
+    memset(outputTypes, 0, sizeof(outputTypes));
+    // The results of all the dictionaries, sorted by score
+    int mergedResults[MAX_RESULTS * dictCount];
+    int mergedCount = 0;
+    for (int i = 0; i < dictCount; ++i) {
+        Dictionary *dictionary = reinterpret_cast<Dictionary *>(dicts[i]);
+        if (!dictionary) continue;
+        void *traverseSession = reinterpret_cast<void *>(dicTraverseSessions[i]);
+        int *const dictCodePoints = &outputCodePoints[i * MAX_WORD_LENGTH * MAX_RESULTS];
+        int *const dictScores = &scores[i * MAX_RESULTS];
+        int *const dictTypes = &outputTypes[i * MAX_RESULTS];
+        int count;
+        if (isGesture || inputSize > 0) {
+            count = dictionary->getSuggestions(pInfo, traverseSession, xCoordinates.get(),
+                    yCoordinates.get(), times.get(), pointerIds.get(), inputCodePoints.get(),
+                    inputSize, prevWordCodePoints.get(), prevWordCodePointsLength,
+                    0 /* commitPoint */, isGesture, useFullEditDistances[i], dictCodePoints,
+                    dictScores, &spaceIndices[i * MAX_RESULTS], dictTypes);
+        } else {
+            count = dictionary->getBigrams(traverseSession, prevWordCodePoints.get(),
+                    prevWordCodePointsLength, inputCodePoints.get(), inputSize, dictCodePoints,
+                    dictScores, dictTypes);
+        }
+        // Each dictionary returns its results by score, so they are inserted after the results
+        // of the same score of the previous dictionaries
+        for (int j = 0; j < count; ++j) {
+            const int result = i * MAX_RESULTS + j;
+            int k = mergedCount;
+            while (k > 0 && scores[mergedResults[k - 1]] < scores[result]) {
+                mergedResults[k] = mergedResults[k - 1];
+                --k;
+            }
+            mergedResults[k] = result;
+            ++mergedCount;
+        }
+    }
+
+    // Copy back the output values, packed so that only what was found is copied
+    int packedResults[MAX_COLLECTION_PACKED_RESULTS_LENGTH];
+    packedResults[0] = mergedCount;
+    int packedLength = 1 + mergedCount * 4;
+    for (int i = 0; i < mergedCount; ++i) {
+        const int result = mergedResults[i];
+        const int *const word = &outputCodePoints[result * MAX_WORD_LENGTH];
+        const int length = getCodePointCount(MAX_WORD_LENGTH, word);
+        packedResults[1 + i * 4] = result / MAX_RESULTS;
+        packedResults[2 + i * 4] = length;
+        packedResults[3 + i * 4] = scores[result];
+        packedResults[4 + i * 4] = outputTypes[result];
+        memcpy(&packedResults[packedLength], word, length * sizeof(word[0]));
+        packedLength += length;
+    }
+    env->SetIntArrayRegion(outputResultsArray, 0, packedLength, packedResults);
+    return mergedCount;
 }
 
 static jint latinime_BinaryDictionary_getProbability(JNIEnv *env, jclass clazz, jlong dict,
@@ -214,6 +591,65 @@ static jint latinime_BinaryDictionary_getProbability(JNIEnv *env, jclass clazz,
     return dictionary->getProbability(codePoints, codePointLength);
 }
 
+static void latinime_BinaryDictionary_getProbabilities(JNIEnv *env, jclass clazz, jlong dict,
+        jintArray wordOffsetsArray, jintArray wordCodePointsArray,
+        jintArray outProbabilitiesArray) {
+    Dictionary *dictionary = reinterpret_cast<Dictionary *>(dict);
+    if (!dictionary) return;
+    const jsize wordCount = env->GetArrayLength(outProbabilitiesArray);
+    if (wordCount <= 0 || env->GetArrayLength(wordOffsetsArray) != wordCount + 1) {
+        AKLOGE("Invalid wordCount: %d", wordCount);
+        ASSERT(false);
+        return;
+    }
+    // The words of a whole document may be checked at once.
+    std::vector<int> wordOffsets(wordCount + 1);
+    env->GetIntArrayRegion(wordOffsetsArray, 0, wordCount + 1, &wordOffsets[0]);
+    const jsize wordCodePointsLength = env->GetArrayLength(wordCodePointsArray);
+    for (int i = 0; i < wordCount; ++i) {
+        if (wordOffsets[i] < 0 || wordOffsets[i] > wordOffsets[i + 1]
+                || wordOffsets[i + 1] > wordCodePointsLength) {
+            AKLOGE("Invalid offsets: %d, %d", wordOffsets[i], wordOffsets[i + 1]);
+            ASSERT(false);
+            return;
+        }
+    }
+    std::vector<int> wordCodePoints(wordCodePointsLength + 1);
+    env->GetIntArrayRegion(wordCodePointsArray, 0, wordCodePointsLength, &wordCodePoints[0]);
+    std::vector<int> probabilities(wordCount);
+    dictionary->getProbabilities(&wordOffsets[0], &wordCodePoints[0], wordCount,
+            &probabilities[0]);
+    env->SetIntArrayRegion(outProbabilitiesArray, 0, wordCount, &probabilities[0]);
+}
+
+static jint latinime_BinaryDictionary_getCompletions(JNIEnv *env, jclass clazz, jlong dict,
+        jintArray prefixArray, jintArray outCodePointsArray, jintArray outProbabilitiesArray) {
+    Dictionary *dictionary = reinterpret_cast<Dictionary *>(dict);
+    if (!dictionary) return 0;
+    const jsize maxCount = env->GetArrayLength(outProbabilitiesArray);
+    if (maxCount <= 0 || env->GetArrayLength(outCodePointsArray) < maxCount * MAX_WORD_LENGTH) {
+        AKLOGE("Invalid maxCount: %d", maxCount);
+        ASSERT(false);
+        return 0;
+    }
+    const jsize prefixLength = env->GetArrayLength(prefixArray);
+    if (prefixLength >= MAX_WORD_LENGTH) {
+        return 0;
+    }
+    int prefix[MAX_WORD_LENGTH];
+    env->GetIntArrayRegion(prefixArray, 0, prefixLength, prefix);
+    std::vector<int> outCodePoints(maxCount * MAX_WORD_LENGTH);
+    std::vector<int> outProbabilities(maxCount);
+    const int count = dictionary->getCompletions(prefix, prefixLength, maxCount,
+            &outCodePoints[0], &outProbabilities[0]);
+    if (count > 0) {
+        env->SetIntArrayRegion(outCodePointsArray, 0, count * MAX_WORD_LENGTH,
+                &outCodePoints[0]);
+        env->SetIntArrayRegion(outProbabilitiesArray, 0, count, &outProbabilities[0]);
+    }
+    return count;
+}
+
 static jboolean latinime_BinaryDictionary_isValidBigram(JNIEnv *env, jclass clazz, jlong dict,
         jintArray wordArray1, jintArray wordArray2) {
     Dictionary *dictionary = reinterpret_cast<Dictionary *>(dict);
@@ -251,20 +687,310 @@ static jint latinime_BinaryDictionary_editDistance(JNIEnv *env, jclass clazz, ji
             afterCodePoints, afterLength);
 }
 
+static void latinime_BinaryDictionary_editDistances(JNIEnv *env, jclass clazz, jintArray before,
+        jintArray afterOffsetsArray, jintArray afterCodePointsArray, jintArray distancesArray) {
+    const jsize afterCount = env->GetArrayLength(distancesArray);
+    if (afterCount <= 0 || env->GetArrayLength(afterOffsetsArray) != afterCount + 1) {
+        AKLOGE("Invalid afterCount: %d", afterCount);
+        ASSERT(false);
+        return;
+    }
+    int afterOffsets[afterCount + 1];
+    env->GetIntArrayRegion(afterOffsetsArray, 0, afterCount + 1, afterOffsets);
+    const jsize afterCodePointsLength = env->GetArrayLength(afterCodePointsArray);
+    for (int i = 0; i < afterCount; ++i) {
+        if (afterOffsets[i] < 0 || afterOffsets[i] > afterOffsets[i + 1]
+                || afterOffsets[i + 1] > afterCodePointsLength) {
+            AKLOGE("Invalid offsets: %d, %d", afterOffsets[i], afterOffsets[i + 1]);
+            ASSERT(false);
+            return;
+        }
+    }
+    const jsize beforeLength = env->GetArrayLength(before);
+    int beforeCodePoints[beforeLength];
+    int afterCodePoints[afterCodePointsLength];
+    env->GetIntArrayRegion(before, 0, beforeLength, beforeCodePoints);
+    env->GetIntArrayRegion(afterCodePointsArray, 0, afterCodePointsLength, afterCodePoints);
+    int distances[afterCount];
+    Correction::RankingAlgorithm::editDistances(beforeCodePoints, beforeLength, afterOffsets,
+            afterCodePoints, afterCount, distances);
+    env->SetIntArrayRegion(distancesArray, 0, afterCount, distances);
+}
+
+// Adds the native memory of the given objects, any of which may be 0, to the categories of
+// usageArray. The process total is the sum over all of them; see BinaryDictionary.java.
+static void latinime_BinaryDictionary_getMemoryUsage(JNIEnv *env, jclass clazz, jlong dict,
+        jlong updatableDict, jlong probabilityOverlay, jlong traverseSession, jlong proximityInfo,
+        jintArray usageArray) {
+    if (env->GetArrayLength(usageArray) < Dictionary::MEMORY_USAGE_CATEGORY_COUNT) {
+        AKLOGE("Invalid usageArray length: %d", env->GetArrayLength(usageArray));
+        ASSERT(false);
+        return;
+    }
+    int usage[Dictionary::MEMORY_USAGE_CATEGORY_COUNT];
+    env->GetIntArrayRegion(usageArray, 0, Dictionary::MEMORY_USAGE_CATEGORY_COUNT, usage);
+    const Dictionary *const dictionary = reinterpret_cast<Dictionary *>(dict);
+    if (dictionary) {
+        dictionary->addMemoryUsage(usage);
+    }
+    const UpdatableDictionary *const updatableDictionary =
+            reinterpret_cast<UpdatableDictionary *>(updatableDict);
+    if (updatableDictionary) {
+        usage[Dictionary::MEMORY_USAGE_DICTIONARY_INDEXES] +=
+                updatableDictionary->getMemorySize();
+    }
+    const ProbabilityOverlay *const overlay =
+            reinterpret_cast<ProbabilityOverlay *>(probabilityOverlay);
+    if (overlay) {
+        usage[Dictionary::MEMORY_USAGE_DICTIONARY_INDEXES] += overlay->getMemorySize();
+    }
+    DicTraverseWrapper::addDicTraverseSessionMemoryUsage(
+            reinterpret_cast<void *>(traverseSession), usage);
+    const ProximityInfo *const pInfo = reinterpret_cast<ProximityInfo *>(proximityInfo);
+    if (pInfo) {
+        usage[Dictionary::MEMORY_USAGE_PROXIMITY_INFO] += pInfo->getMemorySize();
+    }
+    env->SetIntArrayRegion(usageArray, 0, Dictionary::MEMORY_USAGE_CATEGORY_COUNT, usage);
+}
+
+// Adds the search counters of the session to statisticsArray, and resets them if requested.
+static void latinime_BinaryDictionary_getSearchStatistics(JNIEnv *env, jclass clazz,
+        jlong traverseSession, jlongArray statisticsArray, jboolean reset) {
+    if (env->GetArrayLength(statisticsArray) < SearchStatistics::STATISTIC_COUNT) {
+        AKLOGE("Invalid statisticsArray length: %d", env->GetArrayLength(statisticsArray));
+        ASSERT(false);
+        return;
+    }
+    int64_t statistics[SearchStatistics::STATISTIC_COUNT];
+    env->GetLongArrayRegion(statisticsArray, 0, SearchStatistics::STATISTIC_COUNT,
+            reinterpret_cast<jlong *>(statistics));
+    DicTraverseWrapper::addDicTraverseSessionStatistics(
+            reinterpret_cast<void *>(traverseSession), statistics, reset);
+    env->SetLongArrayRegion(statisticsArray, 0, SearchStatistics::STATISTIC_COUNT,
+            reinterpret_cast<const jlong *>(statistics));
+}
+
+// Adds the latency counts of the session to countsArray, and resets them if requested.
+static void latinime_BinaryDictionary_getLatencyHistogram(JNIEnv *env, jclass clazz,
+        jlong traverseSession, jintArray countsArray, jboolean reset) {
+    if (env->GetArrayLength(countsArray) < LatencyHistogram::LATENCY_HISTOGRAM_SIZE) {
+        AKLOGE("Invalid countsArray length: %d", env->GetArrayLength(countsArray));
+        ASSERT(false);
+        return;
+    }
+    int counts[LatencyHistogram::LATENCY_HISTOGRAM_SIZE];
+    env->GetIntArrayRegion(countsArray, 0, LatencyHistogram::LATENCY_HISTOGRAM_SIZE, counts);
+    DicTraverseWrapper::addDicTraverseSessionLatencyHistogram(
+            reinterpret_cast<void *>(traverseSession), counts, reset);
+    env->SetIntArrayRegion(countsArray, 0, LatencyHistogram::LATENCY_HISTOGRAM_SIZE, counts);
+}
+
+static void latinime_BinaryDictionary_setTraceFlags(JNIEnv *env, jclass clazz, jint flags) {
+    TraceRecorder::setFlags(flags);
+}
+
+// Moves the oldest recorded spans to the arrays, which have the same length, and returns their
+// number.
+static jint latinime_BinaryDictionary_drainTraceSpans(JNIEnv *env, jclass clazz,
+        jintArray phasesArray, jintArray threadIdsArray, jlongArray startTimesNsArray,
+        jlongArray durationsNsArray) {
+    const jsize maxCount = env->GetArrayLength(phasesArray);
+    if (env->GetArrayLength(threadIdsArray) != maxCount
+            || env->GetArrayLength(startTimesNsArray) != maxCount
+            || env->GetArrayLength(durationsNsArray) != maxCount) {
+        AKLOGE("Invalid trace span array lengths");
+        ASSERT(false);
+        return 0;
+    }
+    // No more spans than the ring buffer holds can be pending.
+    const int bufferCount = maxCount < TraceRecorder::MAX_SPAN_COUNT
+            ? static_cast<int>(maxCount) : static_cast<int>(TraceRecorder::MAX_SPAN_COUNT);
+    int phases[bufferCount];
+    int threadIds[bufferCount];
+    int64_t startTimesNs[bufferCount];
+    int64_t durationsNs[bufferCount];
+    const int count = TraceRecorder::drainSpans(bufferCount, phases, threadIds, startTimesNs,
+            durationsNs);
+    env->SetIntArrayRegion(phasesArray, 0, count, phases);
+    env->SetIntArrayRegion(threadIdsArray, 0, count, threadIds);
+    env->SetLongArrayRegion(startTimesNsArray, 0, count,
+            reinterpret_cast<const jlong *>(startTimesNs));
+    env->SetLongArrayRegion(durationsNsArray, 0, count,
+            reinterpret_cast<const jlong *>(durationsNs));
+    return count;
+}
+
+static void latinime_BinaryDictionary_startHeatMap(JNIEnv *env, jclass clazz, jlong dict,
+        jint samplingInterval) {
+    Dictionary *dictionary = reinterpret_cast<Dictionary *>(dict);
+    if (!dictionary) return;
+    DictionaryHeatMap::start(dictionary->getOffsetDict(), samplingInterval);
+}
+
+static void latinime_BinaryDictionary_stopHeatMap(JNIEnv *env, jclass clazz) {
+    DictionaryHeatMap::stop();
+}
+
+static jboolean latinime_BinaryDictionary_writeHeatMap(JNIEnv *env, jclass clazz,
+        jstring path) {
+    const jsize pathUtf8Length = env->GetStringUTFLength(path);
+    if (pathUtf8Length <= 0) {
+        AKLOGE("Can't get the heat map path");
+        return false;
+    }
+    char pathChars[pathUtf8Length + 1];
+    env->GetStringUTFRegion(path, 0, env->GetStringLength(path), pathChars);
+    pathChars[pathUtf8Length] = '\0';
+    return DictionaryHeatMap::write(pathChars);
+}
+
+static jlong latinime_BinaryDictionary_createUpdatable(JNIEnv *env, jclass clazz) {
+    return reinterpret_cast<jlong>(new UpdatableDictionary());
+}
+
+static jboolean latinime_BinaryDictionary_addUnigramWord(JNIEnv *env, jclass clazz,
+        jlong updatableDict, jintArray wordArray, jint probability, jboolean isNotAWord) {
+    UpdatableDictionary *dictionary = reinterpret_cast<UpdatableDictionary *>(updatableDict);
+    if (!dictionary) return JNI_FALSE;
+    const jsize codePointLength = env->GetArrayLength(wordArray);
+    if (codePointLength > MAX_WORD_LENGTH) return JNI_FALSE;
+    int codePoints[codePointLength];
+    env->GetIntArrayRegion(wordArray, 0, codePointLength, codePoints);
+    return dictionary->addUnigramWord(codePoints, codePointLength, probability, isNotAWord);
+}
+
+static jboolean latinime_BinaryDictionary_addBigramWords(JNIEnv *env, jclass clazz,
+        jlong updatableDict, jintArray wordArray0, jintArray wordArray1, jint probability) {
+    UpdatableDictionary *dictionary = reinterpret_cast<UpdatableDictionary *>(updatableDict);
+    if (!dictionary) return JNI_FALSE;
+    const jsize codePointLength0 = env->GetArrayLength(wordArray0);
+    const jsize codePointLength1 = env->GetArrayLength(wordArray1);
+    if (codePointLength0 > MAX_WORD_LENGTH || codePointLength1 > MAX_WORD_LENGTH) {
+        return JNI_FALSE;
+    }
+    int codePoints0[codePointLength0];
+    int codePoints1[codePointLength1];
+    env->GetIntArrayRegion(wordArray0, 0, codePointLength0, codePoints0);
+    env->GetIntArrayRegion(wordArray1, 0, codePointLength1, codePoints1);
+    return dictionary->addBigramWords(codePoints0, codePointLength0, codePoints1,
+            codePointLength1, probability);
+}
+
+static jboolean latinime_BinaryDictionary_removeUnigramWord(JNIEnv *env, jclass clazz,
+        jlong updatableDict, jintArray wordArray) {
+    UpdatableDictionary *dictionary = reinterpret_cast<UpdatableDictionary *>(updatableDict);
+    if (!dictionary) return JNI_FALSE;
+    const jsize codePointLength = env->GetArrayLength(wordArray);
+    if (codePointLength > MAX_WORD_LENGTH) return JNI_FALSE;
+    int codePoints[codePointLength];
+    env->GetIntArrayRegion(wordArray, 0, codePointLength, codePoints);
+    return dictionary->removeUnigramWord(codePoints, codePointLength);
+}
+
+// Returns the dictionary to query. The one of the previous flush stays valid until it is released
+// by releaseFlushedUpdatable.
+static jlong latinime_BinaryDictionary_flushUpdatable(JNIEnv *env, jclass clazz,
+        jlong updatableDict) {
+    UpdatableDictionary *dictionary = reinterpret_cast<UpdatableDictionary *>(updatableDict);
+    if (!dictionary) return 0;
+    return reinterpret_cast<jlong>(dictionary->flush());
+}
+
+static void latinime_BinaryDictionary_releaseFlushedUpdatable(JNIEnv *env, jclass clazz,
+        jlong updatableDict, jlong dict) {
+    UpdatableDictionary *dictionary = reinterpret_cast<UpdatableDictionary *>(updatableDict);
+    if (!dictionary) return;
+    dictionary->releaseFlushedDictionary(reinterpret_cast<Dictionary *>(dict));
+}
+
+static void latinime_BinaryDictionary_closeUpdatable(JNIEnv *env, jclass clazz,
+        jlong updatableDict) {
+    delete reinterpret_cast<UpdatableDictionary *>(updatableDict);
+}
+
+// Creates the overlay of the words and bigrams for the dictionary, see ProbabilityOverlay::create,
+// which the caller attaches to its sessions and releases.
+static jlong latinime_BinaryDictionary_createProbabilityOverlay(JNIEnv *env, jclass clazz,
+        jlong dict, jintArray wordOffsetsArray, jintArray wordCodePointsArray,
+        jintArray probabilitiesArray, jintArray bigramWordIndicesArray,
+        jintArray bigramProbabilitiesArray) {
+    const Dictionary *const dictionary = reinterpret_cast<Dictionary *>(dict);
+    if (!dictionary) return 0;
+    const jsize wordCount = env->GetArrayLength(probabilitiesArray);
+    const jsize bigramCount = env->GetArrayLength(bigramProbabilitiesArray);
+    if (env->GetArrayLength(wordOffsetsArray) != wordCount + 1
+            || env->GetArrayLength(bigramWordIndicesArray) != bigramCount * 2) {
+        AKLOGE("Invalid overlay sizes: %d, %d", wordCount, bigramCount);
+        ASSERT(false);
+        return 0;
+    }
+    // The overlay may have thousands of words.
+    std::vector<int> wordOffsets(wordCount + 1);
+    env->GetIntArrayRegion(wordOffsetsArray, 0, wordCount + 1, &wordOffsets[0]);
+    const jsize wordCodePointsLength = env->GetArrayLength(wordCodePointsArray);
+    for (int i = 0; i < wordCount; ++i) {
+        if (wordOffsets[i] < 0 || wordOffsets[i] > wordOffsets[i + 1]
+                || wordOffsets[i + 1] > wordCodePointsLength) {
+            AKLOGE("Invalid offsets: %d, %d", wordOffsets[i], wordOffsets[i + 1]);
+            ASSERT(false);
+            return 0;
+        }
+    }
+    std::vector<int> wordCodePoints(wordCodePointsLength + 1);
+    std::vector<int> probabilities(wordCount + 1);
+    std::vector<int> bigramWordIndices(bigramCount * 2 + 1);
+    std::vector<int> bigramProbabilities(bigramCount + 1);
+    env->GetIntArrayRegion(wordCodePointsArray, 0, wordCodePointsLength, &wordCodePoints[0]);
+    env->GetIntArrayRegion(probabilitiesArray, 0, wordCount, &probabilities[0]);
+    env->GetIntArrayRegion(bigramWordIndicesArray, 0, bigramCount * 2, &bigramWordIndices[0]);
+    env->GetIntArrayRegion(bigramProbabilitiesArray, 0, bigramCount, &bigramProbabilities[0]);
+    return reinterpret_cast<jlong>(ProbabilityOverlay::create(dictionary, wordCount,
+            &wordOffsets[0], &wordCodePoints[0], &probabilities[0], bigramCount,
+            &bigramWordIndices[0], &bigramProbabilities[0]));
+}
+
+static void latinime_BinaryDictionary_releaseProbabilityOverlay(JNIEnv *env, jclass clazz,
+        jlong overlay) {
+    delete reinterpret_cast<ProbabilityOverlay *>(overlay);
+}
+
 static void latinime_BinaryDictionary_close(JNIEnv *env, jclass clazz, jlong dict) {
     Dictionary *dictionary = reinterpret_cast<Dictionary *>(dict);
     if (!dictionary) return;
+    if (!DictionaryRegistry::release(dictionary)) return;
+    deleteDictionary(dictionary);
+}
+
+static void deleteDictionary(Dictionary *dictionary) {
     const void *dictBuf = dictionary->getDict();
     if (!dictBuf) return;
+    const int dictBufAdjust = dictionary->getDictBufAdjust();
+    const int dictSize = dictionary->getDictSize();
+    const int mmapFd = dictionary->getMmapFd();
+    // Deleted first, as it may still be reading the buffer in the background.
+    delete dictionary;
 #ifdef USE_MMAP_FOR_DICTIONARY
-    releaseDictBuf(static_cast<const char *>(dictBuf) - dictionary->getDictBufAdjust(),
-            dictionary->getDictSize() + dictionary->getDictBufAdjust(), dictionary->getMmapFd());
+    releaseDictBuf(static_cast<const char *>(dictBuf) - dictBufAdjust, dictSize + dictBufAdjust,
+            mmapFd);
 #else // USE_MMAP_FOR_DICTIONARY
     releaseDictBuf(dictBuf, 0, 0);
 #endif // USE_MMAP_FOR_DICTIONARY
-    delete dictionary;
 }
 
+#ifdef USE_MMAP_FOR_DICTIONARY
+static void adviseDictBuf(void *dictBuf, const size_t length, const int loadOptions) {
+    // The trie is read in no particular order, so read-ahead mostly reads unused pages.
+    if ((loadOptions & Dictionary::LOAD_OPTION_ADVISE_RANDOM)
+            && madvise(dictBuf, length, MADV_RANDOM) != 0) {
+        AKLOGE("DICT: Failure in madvise(MADV_RANDOM). errno=%d", errno);
+    }
+    if ((loadOptions & Dictionary::LOAD_OPTION_ADVISE_WILLNEED)
+            && madvise(dictBuf, length, MADV_WILLNEED) != 0) {
+        AKLOGE("DICT: Failure in madvise(MADV_WILLNEED). errno=%d", errno);
+    }
+}
+#endif // USE_MMAP_FOR_DICTIONARY
+
 static void releaseDictBuf(const void *dictBuf, const size_t length, const int fd) {
 #ifdef USE_MMAP_FOR_DICTIONARY
     int ret = munmap(const_cast<void *>(dictBuf), length);
@@ -282,7 +1008,7 @@ static void releaseDictBuf(const void *dictBuf, const size_t length, const int f
 
 static JNINativeMethod sMethods[] = {
     {const_cast<char *>("openNative"),
-     const_cast<char *>("(Ljava/lang/String;JJ)J"),
+     const_cast<char *>("(Ljava/lang/String;JJI)J"),
      reinterpret_cast<void *>(latinime_BinaryDictionary_open)},
     {const_cast<char *>("closeNative"),
      const_cast<char *>("(J)V"),
@@ -290,9 +1016,24 @@ static JNINativeMethod sMethods[] = {
     {const_cast<char *>("getSuggestionsNative"),
      const_cast<char *>("(JJJ[I[I[I[I[IIIZ[IZ[I[I[I[I)I"),
      reinterpret_cast<void *>(latinime_BinaryDictionary_getSuggestions)},
+    {const_cast<char *>("speculateNextInputNative"),
+     const_cast<char *>("(JJJ[I[I[I[I[II[II)I"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_speculateNextInput)},
+    {const_cast<char *>("getSuggestionsBatchNative"),
+     const_cast<char *>("(JJJ[I[I[I[I[I[IZ[I[I)I"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_getSuggestionsBatch)},
+    {const_cast<char *>("getSuggestionsFromDictionariesNative"),
+     const_cast<char *>("([JJ[J[I[I[I[I[IIZ[I[Z[I)I"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_getSuggestionsFromDictionaries)},
     {const_cast<char *>("getProbabilityNative"),
      const_cast<char *>("(J[I)I"),
      reinterpret_cast<void *>(latinime_BinaryDictionary_getProbability)},
+    {const_cast<char *>("getProbabilitiesNative"),
+     const_cast<char *>("(J[I[I[I)V"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_getProbabilities)},
+    {const_cast<char *>("getCompletionsNative"),
+     const_cast<char *>("(J[I[I[I)I"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_getCompletions)},
     {const_cast<char *>("isValidBigramNative"),
      const_cast<char *>("(J[I[I)Z"),
      reinterpret_cast<void *>(latinime_BinaryDictionary_isValidBigram)},
@@ -301,7 +1042,61 @@ static JNINativeMethod sMethods[] = {
      reinterpret_cast<void *>(latinime_BinaryDictionary_calcNormalizedScore)},
     {const_cast<char *>("editDistanceNative"),
      const_cast<char *>("([I[I)I"),
-     reinterpret_cast<void *>(latinime_BinaryDictionary_editDistance)}
+     reinterpret_cast<void *>(latinime_BinaryDictionary_editDistance)},
+    {const_cast<char *>("editDistancesNative"),
+     const_cast<char *>("([I[I[I[I)V"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_editDistances)},
+    {const_cast<char *>("getMemoryUsageNative"),
+     const_cast<char *>("(JJJJJ[I)V"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_getMemoryUsage)},
+    {const_cast<char *>("getSearchStatisticsNative"),
+     const_cast<char *>("(J[JZ)V"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_getSearchStatistics)},
+    {const_cast<char *>("getLatencyHistogramNative"),
+     const_cast<char *>("(J[IZ)V"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_getLatencyHistogram)},
+    {const_cast<char *>("setTraceFlagsNative"),
+     const_cast<char *>("(I)V"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_setTraceFlags)},
+    {const_cast<char *>("drainTraceSpansNative"),
+     const_cast<char *>("([I[I[J[J)I"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_drainTraceSpans)},
+    {const_cast<char *>("startHeatMapNative"),
+     const_cast<char *>("(JI)V"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_startHeatMap)},
+    {const_cast<char *>("stopHeatMapNative"),
+     const_cast<char *>("()V"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_stopHeatMap)},
+    {const_cast<char *>("writeHeatMapNative"),
+     const_cast<char *>("(Ljava/lang/String;)Z"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_writeHeatMap)},
+    {const_cast<char *>("createUpdatableNative"),
+     const_cast<char *>("()J"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_createUpdatable)},
+    {const_cast<char *>("addUnigramWordNative"),
+     const_cast<char *>("(J[IIZ)Z"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_addUnigramWord)},
+    {const_cast<char *>("addBigramWordsNative"),
+     const_cast<char *>("(J[I[II)Z"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_addBigramWords)},
+    {const_cast<char *>("removeUnigramWordNative"),
+     const_cast<char *>("(J[I)Z"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_removeUnigramWord)},
+    {const_cast<char *>("flushUpdatableNative"),
+     const_cast<char *>("(J)J"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_flushUpdatable)},
+    {const_cast<char *>("releaseFlushedUpdatableNative"),
+     const_cast<char *>("(JJ)V"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_releaseFlushedUpdatable)},
+    {const_cast<char *>("closeUpdatableNative"),
+     const_cast<char *>("(J)V"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_closeUpdatable)},
+    {const_cast<char *>("createProbabilityOverlayNative"),
+     const_cast<char *>("(J[I[I[I[I[I)J"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_createProbabilityOverlay)},
+    {const_cast<char *>("releaseProbabilityOverlayNative"),
+     const_cast<char *>("(J)V"),
+     reinterpret_cast<void *>(latinime_BinaryDictionary_releaseProbabilityOverlay)}
 };
 
 int register_BinaryDictionary(JNIEnv *env) {
@@ -24,6 +24,7 @@
 
 namespace latinime {
 class Dictionary;
+class ProbabilityOverlay;
 static jlong latinime_setDicTraverseSession(JNIEnv *env, jclass clazz, jstring localeJStr) {
     void *traverseSession = DicTraverseWrapper::getDicTraverseSession(env, localeJStr);
     return reinterpret_cast<jlong>(traverseSession);
@@ -47,6 +48,72 @@ static void latinime_releaseDicTraverseSession(JNIEnv *env, jclass clazz, jlong
     DicTraverseWrapper::releaseDicTraverseSession(ts);
 }
 
+static void latinime_setDicTraverseSessionLatencyBudget(JNIEnv *env, jclass clazz,
+        jlong traverseSession, jint latencyBudgetMs) {
+    void *ts = reinterpret_cast<void *>(traverseSession);
+    DicTraverseWrapper::setDicTraverseSessionLatencyBudget(ts, latencyBudgetMs);
+}
+
+static void latinime_setDicTraverseSessionProbabilityOverlay(JNIEnv *env, jclass clazz,
+        jlong traverseSession, jlong overlay) {
+    void *ts = reinterpret_cast<void *>(traverseSession);
+    DicTraverseWrapper::setDicTraverseSessionProbabilityOverlay(ts,
+            reinterpret_cast<ProbabilityOverlay *>(overlay));
+}
+
+static void latinime_setDicTraverseSessionSearchProfile(JNIEnv *env, jclass clazz,
+        jlong traverseSession, jint profile) {
+    void *ts = reinterpret_cast<void *>(traverseSession);
+    DicTraverseWrapper::setDicTraverseSessionSearchProfile(ts, profile);
+}
+
+static void latinime_setDicTraverseSessionRequestTicket(JNIEnv *env, jclass clazz,
+        jlong traverseSession, jint ticket) {
+    void *ts = reinterpret_cast<void *>(traverseSession);
+    DicTraverseWrapper::setDicTraverseSessionRequestTicket(ts, ticket);
+}
+
+// Called from another thread than the one running the request of the session.
+static void latinime_cancelDicTraverseSessionRequest(JNIEnv *env, jclass clazz,
+        jlong traverseSession, jint ticket) {
+    void *ts = reinterpret_cast<void *>(traverseSession);
+    DicTraverseWrapper::cancelDicTraverseSessionRequest(ts, ticket);
+}
+
+static void latinime_setDicTraverseSessionProgressiveInterval(JNIEnv *env, jclass clazz,
+        jlong traverseSession, jint inputIndexCount, jint intervalMs) {
+    void *ts = reinterpret_cast<void *>(traverseSession);
+    DicTraverseWrapper::setDicTraverseSessionProgressiveInterval(ts, inputIndexCount, intervalMs);
+}
+
+// Called from another thread than the one running the request of the session.
+static jint latinime_getDicTraverseSessionPublishedResults(JNIEnv *env, jclass clazz,
+        jlong traverseSession, jint ticket, jintArray outCodePointsArray,
+        jintArray outScoresArray, jintArray outSpaceIndicesArray, jintArray outTypesArray) {
+    void *ts = reinterpret_cast<void *>(traverseSession);
+    if (env->GetArrayLength(outCodePointsArray) < MAX_RESULTS * MAX_WORD_LENGTH
+            || env->GetArrayLength(outScoresArray) < MAX_RESULTS
+            || env->GetArrayLength(outSpaceIndicesArray) < MAX_RESULTS
+            || env->GetArrayLength(outTypesArray) < MAX_RESULTS) {
+        AKLOGE("Invalid array lengths for the published results");
+        ASSERT(false);
+        return 0;
+    }
+    int outCodePoints[MAX_RESULTS * MAX_WORD_LENGTH];
+    int outScores[MAX_RESULTS];
+    int outSpaceIndices[MAX_RESULTS];
+    int outTypes[MAX_RESULTS];
+    const int count = DicTraverseWrapper::getDicTraverseSessionPublishedResults(ts, ticket,
+            outCodePoints, outScores, outSpaceIndices, outTypes);
+    if (count > 0) {
+        env->SetIntArrayRegion(outCodePointsArray, 0, count * MAX_WORD_LENGTH, outCodePoints);
+        env->SetIntArrayRegion(outScoresArray, 0, count, outScores);
+        env->SetIntArrayRegion(outSpaceIndicesArray, 0, count, outSpaceIndices);
+        env->SetIntArrayRegion(outTypesArray, 0, count, outTypes);
+    }
+    return count;
+}
+
 static JNINativeMethod sMethods[] = {
     {const_cast<char *>("setDicTraverseSessionNative"),
      const_cast<char *>("(Ljava/lang/String;)J"),
@@ -56,7 +123,28 @@ static JNINativeMethod sMethods[] = {
      reinterpret_cast<void *>(latinime_initDicTraverseSession)},
     {const_cast<char *>("releaseDicTraverseSessionNative"),
      const_cast<char *>("(J)V"),
-     reinterpret_cast<void *>(latinime_releaseDicTraverseSession)}
+     reinterpret_cast<void *>(latinime_releaseDicTraverseSession)},
+    {const_cast<char *>("setLatencyBudgetNative"),
+     const_cast<char *>("(JI)V"),
+     reinterpret_cast<void *>(latinime_setDicTraverseSessionLatencyBudget)},
+    {const_cast<char *>("setProbabilityOverlayNative"),
+     const_cast<char *>("(JJ)V"),
+     reinterpret_cast<void *>(latinime_setDicTraverseSessionProbabilityOverlay)},
+    {const_cast<char *>("setSearchProfileNative"),
+     const_cast<char *>("(JI)V"),
+     reinterpret_cast<void *>(latinime_setDicTraverseSessionSearchProfile)},
+    {const_cast<char *>("setRequestTicketNative"),
+     const_cast<char *>("(JI)V"),
+     reinterpret_cast<void *>(latinime_setDicTraverseSessionRequestTicket)},
+    {const_cast<char *>("cancelRequestNative"),
+     const_cast<char *>("(JI)V"),
+     reinterpret_cast<void *>(latinime_cancelDicTraverseSessionRequest)},
+    {const_cast<char *>("setProgressiveIntervalNative"),
+     const_cast<char *>("(JII)V"),
+     reinterpret_cast<void *>(latinime_setDicTraverseSessionProgressiveInterval)},
+    {const_cast<char *>("getPublishedResultsNative"),
+     const_cast<char *>("(JI[I[I[I[I)I"),
+     reinterpret_cast<void *>(latinime_getDicTraverseSessionPublishedResults)}
 };
 
 int register_DicTraverseSession(JNIEnv *env) {
@@ -19,15 +19,22 @@
 #define LOG_TAG "LatinIME: bigram_dictionary.cpp"
 
 #include "bigram_dictionary.h"
+#include "bigram_prediction_cache.h"
 #include "binary_format.h"
-#include "bloom_filter.h"
 #include "char_utils.h"
 #include "defines.h"
 #include "dictionary.h"
+#include "dictionary_heat_map.h"
+#include "suggest/core/dictionary/terminal_position_index.h"
+#include "suggest/core/dictionary/word_address_index.h"
 
 namespace latinime {
 
-BigramDictionary::BigramDictionary(const uint8_t *const streamStart) : DICT_ROOT(streamStart) {
+BigramDictionary::BigramDictionary(const int dictionaryId, const uint8_t *const streamStart,
+        const TerminalPositionIndex *const terminalPositionIndex,
+        const WordAddressIndex *const wordAddressIndex)
+        : mDictionaryId(dictionaryId), DICT_ROOT(streamStart),
+          mTerminalPositionIndex(terminalPositionIndex), mWordAddressIndex(wordAddressIndex) {
     if (DEBUG_DICT) {
         AKLOGI("BigramDictionary - constructor");
     }
@@ -98,11 +105,11 @@ void BigramDictionary::addWordBigram(int *word, int length, int probability, int
  * reduce their scope to the ones that match the first letter.
  */
 int BigramDictionary::getBigrams(const int *prevWord, int prevWordLength, int *inputCodePoints,
-        int inputSize, int *bigramCodePoints, int *bigramProbability, int *outputTypes) const {
+        int inputSize, int *bigramCodePoints, int *bigramProbability, int *outputTypes,
+        BigramPredictionCache *predictionCache) const {
     // TODO: remove unused arguments, and refrain from storing stuff in members of this class
     // TODO: have "in" arguments before "out" ones, and make out args explicit in the name
 
-    const uint8_t *const root = DICT_ROOT;
     int pos = getBigramListPositionForWord(prevWord, prevWordLength,
             false /* forceLowerCaseSearch */);
     // getBigramListPositionForWord returns 0 if this word isn't in the dictionary or has no bigrams
@@ -113,6 +120,30 @@ int BigramDictionary::getBigrams(const int *prevWord, int prevWordLength, int *i
     }
     // If still no bigrams, we really don't have them!
     if (0 == pos) return 0;
+    // inputSize == 0 means we are trying to find bigram predictions, which only depend on the
+    // bigram list.
+    if (inputSize >= 1 || !predictionCache) {
+        return getBigramsAt(pos, inputCodePoints, inputSize, bigramCodePoints, bigramProbability,
+                outputTypes);
+    }
+    const BigramPredictionCache::Entry *entry = predictionCache->get(mDictionaryId, pos);
+    if (!entry) {
+        BigramPredictionCache::Entry *const newEntry = predictionCache->add(mDictionaryId, pos);
+        newEntry->mCount = getBigramsAt(pos, inputCodePoints, inputSize, newEntry->mCodePoints,
+                newEntry->mProbabilities, newEntry->mOutputTypes);
+        entry = newEntry;
+    }
+    memcpy(bigramCodePoints, entry->mCodePoints, sizeof(entry->mCodePoints));
+    memcpy(bigramProbability, entry->mProbabilities, sizeof(entry->mProbabilities));
+    memcpy(outputTypes, entry->mOutputTypes, sizeof(entry->mOutputTypes));
+    return entry->mCount;
+}
+
+// Adds the bigrams of the bigram list at pos to the outputs, sorted by probability.
+int BigramDictionary::getBigramsAt(int pos, int *inputCodePoints, int inputSize,
+        int *bigramCodePoints, int *bigramProbability, int *outputTypes) const {
+    const uint8_t *const root = DICT_ROOT;
+    DictionaryHeatMap::recordRead(root, pos);
     uint8_t bigramFlags;
     int bigramCount = 0;
     do {
@@ -121,8 +152,8 @@ int BigramDictionary::getBigrams(const int *prevWord, int prevWordLength, int *i
         int unigramProbability = 0;
         const int bigramPos = BinaryFormat::getAttributeAddressAndForwardPointer(root, bigramFlags,
                 &pos);
-        const int length = BinaryFormat::getWordAtAddress(root, bigramPos, MAX_WORD_LENGTH,
-                bigramBuffer, &unigramProbability);
+        const int length = WordAddressIndex::getWordAtAddress(mWordAddressIndex, root, bigramPos,
+                MAX_WORD_LENGTH, bigramBuffer, &unigramProbability);
 
         // inputSize == 0 means we are trying to find bigram predictions.
         if (inputSize < 1 || checkFirstCharacter(bigramBuffer, inputCodePoints)) {
@@ -149,8 +180,8 @@ int BigramDictionary::getBigramListPositionForWord(const int *prevWord, const in
         const bool forceLowerCaseSearch) const {
     if (0 >= prevWordLength) return 0;
     const uint8_t *const root = DICT_ROOT;
-    int pos = BinaryFormat::getTerminalPosition(root, prevWord, prevWordLength,
-            forceLowerCaseSearch);
+    int pos = TerminalPositionIndex::getTerminalPosition(mTerminalPositionIndex, root, prevWord,
+            prevWordLength, forceLowerCaseSearch);
 
     if (NOT_VALID_WORD == pos) return 0;
     const uint8_t flags = BinaryFormat::getFlagsAndForwardPointer(root, &pos);
@@ -166,9 +197,9 @@ int BigramDictionary::getBigramListPositionForWord(const int *prevWord, const in
     return pos;
 }
 
-void BigramDictionary::fillBigramAddressToProbabilityMapAndFilter(const int *prevWord,
-        const int prevWordLength, std::map<int, int> *map, uint8_t *filter) const {
-    memset(filter, 0, BIGRAM_FILTER_BYTE_SIZE);
+void BigramDictionary::fillBigramAddressToProbabilityMap(const int *prevWord,
+        const int prevWordLength, BigramProbabilityMap *map) const {
+    map->clear();
     const uint8_t *const root = DICT_ROOT;
     int pos = getBigramListPositionForWord(prevWord, prevWordLength,
             false /* forceLowerCaseSearch */);
@@ -185,9 +216,9 @@ void BigramDictionary::fillBigramAddressToProbabilityMapAndFilter(const int *pre
         const int probability = BinaryFormat::MASK_ATTRIBUTE_PROBABILITY & bigramFlags;
         const int bigramPos = BinaryFormat::getAttributeAddressAndForwardPointer(root, bigramFlags,
                 &pos);
-        (*map)[bigramPos] = probability;
-        setInFilter(filter, bigramPos);
+        map->add(bigramPos, probability);
     } while (BinaryFormat::FLAG_ATTRIBUTE_HAS_NEXT & bigramFlags);
+    map->sort();
 }
 
 bool BigramDictionary::checkFirstCharacter(int *word, int *inputCodePoints) const {
@@ -212,8 +243,8 @@ bool BigramDictionary::isValidBigram(const int *word1, int length1, const int *w
     int pos = getBigramListPositionForWord(word1, length1, false /* forceLowerCaseSearch */);
     // getBigramListPositionForWord returns 0 if this word isn't in the dictionary or has no bigrams
     if (0 == pos) return false;
-    int nextWordPos = BinaryFormat::getTerminalPosition(root, word2, length2,
-            false /* forceLowerCaseSearch */);
+    int nextWordPos = TerminalPositionIndex::getTerminalPosition(mTerminalPositionIndex, root,
+            word2, length2, false /* forceLowerCaseSearch */);
     if (NOT_VALID_WORD == nextWordPos) return false;
     uint8_t bigramFlags;
     do {
@@ -17,20 +17,27 @@
 #ifndef LATINIME_BIGRAM_DICTIONARY_H
 #define LATINIME_BIGRAM_DICTIONARY_H
 
-#include <map>
 #include <stdint.h>
 
 #include "defines.h"
 
 namespace latinime {
 
+class BigramPredictionCache;
+class BigramProbabilityMap;
+class TerminalPositionIndex;
+class WordAddressIndex;
+
 class BigramDictionary {
  public:
-    BigramDictionary(const uint8_t *const streamStart);
+    BigramDictionary(const int dictionaryId, const uint8_t *const streamStart,
+            const TerminalPositionIndex *const terminalPositionIndex,
+            const WordAddressIndex *const wordAddressIndex);
+    // The predictions found when inputSize is 0 are kept in predictionCache, if not 0.
     int getBigrams(const int *word, int length, int *inputCodePoints, int inputSize, int *outWords,
-            int *frequencies, int *outputTypes) const;
-    void fillBigramAddressToProbabilityMapAndFilter(const int *prevWord, const int prevWordLength,
-            std::map<int, int> *map, uint8_t *filter) const;
+            int *frequencies, int *outputTypes, BigramPredictionCache *predictionCache) const;
+    void fillBigramAddressToProbabilityMap(const int *prevWord, const int prevWordLength,
+            BigramProbabilityMap *map) const;
     bool isValidBigram(const int *word1, int length1, const int *word2, int length2) const;
     ~BigramDictionary();
  private:
@@ -38,10 +45,16 @@ class BigramDictionary {
     void addWordBigram(int *word, int length, int probability, int *bigramProbability,
             int *bigramCodePoints, int *outputTypes) const;
     bool checkFirstCharacter(int *word, int *inputCodePoints) const;
+    int getBigramsAt(int pos, int *inputCodePoints, int inputSize, int *outWords,
+            int *frequencies, int *outputTypes) const;
     int getBigramListPositionForWord(const int *prevWord, const int prevWordLength,
             const bool forceLowerCaseSearch) const;
 
+    // Keys the cached predictions: a dictionary may be opened at the address of a deleted one.
+    const int mDictionaryId;
     const uint8_t *const DICT_ROOT;
+    const TerminalPositionIndex *const mTerminalPositionIndex;
+    const WordAddressIndex *const mWordAddressIndex;
     // TODO: Re-implement proximity correction for bigram correction
     static const int MAX_ALTERNATIVES = 1;
 };
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_BIGRAM_PREDICTION_CACHE_H
+#define LATINIME_BIGRAM_PREDICTION_CACHE_H
+
+#include <cstring>
+
+#include "defines.h"
+#include "suggest/core/session/search_statistics.h"
+
+namespace latinime {
+
+/**
+ * The predictions of the last previous words of a session, decoded to code points as
+ * BigramDictionary::getBigrams outputs them. The predictions are shown after every space, often
+ * for the same few previous words, and finding them walks the whole bigram list and climbs the
+ * trie for each of its words. An entry is keyed by the id of the dictionary and the position of the
+ * bigram list, and the least recently used one is replaced.
+ */
+class BigramPredictionCache {
+ public:
+    struct Entry {
+        int mDictionaryId;
+        int mBigramListPos;
+        int mLastUsed;
+        int mCount;
+        int mProbabilities[MAX_RESULTS];
+        int mOutputTypes[MAX_RESULTS];
+        int mCodePoints[MAX_RESULTS * MAX_WORD_LENGTH];
+    };
+
+    // The evictions are counted in statistics.
+    explicit BigramPredictionCache(SearchStatistics *const statistics)
+            : mStatistics(statistics), mUseCount(0) {
+        memset(mEntries, 0, sizeof(mEntries));
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    ~BigramPredictionCache() {}
+
+    // Returns the predictions of the bigram list, or 0 if they are not cached.
+    const Entry *get(const int dictionaryId, const int bigramListPos) {
+        for (int i = 0; i < MAX_ENTRIES; ++i) {
+            Entry *const entry = &mEntries[i];
+            if (entry->mDictionaryId == dictionaryId && entry->mBigramListPos == bigramListPos) {
+                entry->mLastUsed = ++mUseCount;
+                return entry;
+            }
+        }
+        return 0;
+    }
+
+    // Returns a cleared entry to fill with the predictions of the bigram list.
+    Entry *add(const int dictionaryId, const int bigramListPos) {
+        Entry *entry = &mEntries[0];
+        for (int i = 1; i < MAX_ENTRIES; ++i) {
+            if (mEntries[i].mLastUsed < entry->mLastUsed) {
+                entry = &mEntries[i];
+            }
+        }
+        if (entry->mLastUsed != 0) {
+            mStatistics->countEviction(
+                    SearchStatistics::STATISTIC_BIGRAM_PREDICTION_CACHE_EVICTIONS);
+        }
+        memset(entry, 0, sizeof(*entry));
+        entry->mDictionaryId = dictionaryId;
+        entry->mBigramListPos = bigramListPos;
+        entry->mLastUsed = ++mUseCount;
+        return entry;
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(BigramPredictionCache);
+
+    static const int MAX_ENTRIES = 8;
+
+    SearchStatistics *const mStatistics;
+    Entry mEntries[MAX_ENTRIES];
+    int mUseCount;
+};
+} // namespace latinime
+#endif // LATINIME_BIGRAM_PREDICTION_CACHE_H
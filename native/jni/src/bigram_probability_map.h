@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_BIGRAM_PROBABILITY_MAP_H
+#define LATINIME_BIGRAM_PROBABILITY_MAP_H
+
+#include <algorithm>
+#include <vector>
+
+#include "bloom_filter.h"
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * The bigrams of a previous word as a flat array of (next word position, probability) sorted by
+ * position, for lookups by binary search without the node allocations of a tree or hash map.
+ * Clearing keeps the capacity, so that a map owned by a session is filled on every keystroke
+ * without allocating. A bloom filter sized to the bigrams rejects most of the other words before
+ * the search.
+ */
+class BigramProbabilityMap {
+ public:
+    BigramProbabilityMap() : mEntries(), mFilter() {}
+    // Note: Default copy constructor needed for use in hash_map.
+
+    void clear() {
+        mEntries.clear();
+        mFilter.clear();
+    }
+
+    // Bigrams may be added in any order. A position added twice keeps the last probability.
+    void add(const int position, const int probability) {
+        Entry entry;
+        entry.mPosition = position;
+        entry.mProbability = probability;
+        entry.mOrder = static_cast<int>(mEntries.size());
+        mEntries.push_back(entry);
+    }
+
+    // Must be called after adding the bigrams and before looking them up.
+    void sort() {
+        std::sort(mEntries.begin(), mEntries.end(), compareEntries);
+        // Keep the last added entry of each position, which sorts last.
+        int size = 0;
+        for (int i = 0; i < static_cast<int>(mEntries.size()); ++i) {
+            if (i + 1 < static_cast<int>(mEntries.size())
+                    && mEntries[i + 1].mPosition == mEntries[i].mPosition) {
+                continue;
+            }
+            mEntries[size++] = mEntries[i];
+        }
+        mEntries.resize(size);
+        mFilter.reset(size);
+        for (int i = 0; i < size; ++i) {
+            mFilter.setInFilter(mEntries[i].mPosition);
+        }
+    }
+
+    // The bytes allocated for the map, including the retained capacity.
+    int getMemorySize() const {
+        return static_cast<int>(mEntries.capacity() * sizeof(mEntries[0]))
+                + mFilter.getMemorySize();
+    }
+
+    // Returns the probability of the bigram to position, or NOT_A_PROBABILITY.
+    AK_FORCE_INLINE int getProbability(const int position) const {
+        if (!mFilter.isInFilter(position)) {
+            return NOT_A_PROBABILITY;
+        }
+        int low = 0;
+        int high = static_cast<int>(mEntries.size());
+        while (low < high) {
+            const int middle = (low + high) / 2;
+            if (mEntries[middle].mPosition < position) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low < static_cast<int>(mEntries.size()) && mEntries[low].mPosition == position) {
+            return mEntries[low].mProbability;
+        }
+        return NOT_A_PROBABILITY;
+    }
+
+ private:
+    struct Entry {
+        int mPosition;
+        int mProbability;
+        int mOrder;
+    };
+
+    static bool compareEntries(const Entry &left, const Entry &right) {
+        if (left.mPosition != right.mPosition) {
+            return left.mPosition < right.mPosition;
+        }
+        return left.mOrder < right.mOrder;
+    }
+
+    std::vector<Entry> mEntries;
+    BloomFilter mFilter;
+};
+} // namespace latinime
+#endif // LATINIME_BIGRAM_PROBABILITY_MAP_H
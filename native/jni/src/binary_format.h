@@ -18,12 +18,10 @@
 #define LATINIME_BINARY_FORMAT_H
 
 #include <cstdlib>
-#include <map>
 #include <stdint.h>
 
-#include "bloom_filter.h"
+#include "bigram_probability_map.h"
 #include "char_utils.h"
-#include "hash_map_compat.h"
 
 namespace latinime {
 
@@ -31,6 +29,10 @@ class BinaryFormat {
  public:
     // Mask and flags for children address type selection.
     static const int MASK_GROUP_ADDRESS_TYPE = 0xC0;
+    static const int FLAG_GROUP_ADDRESS_TYPE_NOADDRESS = 0x00;
+    static const int FLAG_GROUP_ADDRESS_TYPE_ONEBYTE = 0x40;
+    static const int FLAG_GROUP_ADDRESS_TYPE_TWOBYTES = 0x80;
+    static const int FLAG_GROUP_ADDRESS_TYPE_THREEBYTES = 0xC0;
 
     // Flag for single/multiple char group
     static const int FLAG_HAS_MULTIPLE_CHARS = 0x20;
@@ -60,8 +62,19 @@ class BinaryFormat {
 
     // Mask and flags for attribute address type selection.
     static const int MASK_ATTRIBUTE_ADDRESS_TYPE = 0x30;
+    static const int FLAG_ATTRIBUTE_ADDRESS_TYPE_ONEBYTE = 0x10;
+    static const int FLAG_ATTRIBUTE_ADDRESS_TYPE_TWOBYTES = 0x20;
+    static const int FLAG_ATTRIBUTE_ADDRESS_TYPE_THREEBYTES = 0x30;
 
     static const int UNKNOWN_FORMAT = -1;
+    // The versions of Latin IME that only handle format version 1 only test for the magic
+    // number, so we had to change it so that version 2 files would be rejected by older
+    // implementations. On this occasion, we made the magic number 32 bits long.
+    static const int FORMAT_VERSION_2_MAGIC_NUMBER = -1681835266; // 0x9BC13AFE
+    // Magic number (4 bytes), version (2 bytes), options (2 bytes), header size (4 bytes) = 12
+    static const int FORMAT_VERSION_2_MINIMUM_SIZE = 12;
+    // The code points from this one to 0xFF are written on one byte, the others on three.
+    static const int MINIMAL_ONE_BYTE_CHARACTER_VALUE = 0x20;
     static const int SHORTCUT_LIST_SIZE_SIZE = 2;
 
     static int detectFormat(const uint8_t *const dict, const int dictSize);
@@ -93,13 +106,12 @@ class BinaryFormat {
             int *outWord, int *outUnigramProbability);
     static int computeProbabilityForBigram(
             const int unigramProbability, const int bigramProbability);
-    static int getProbability(const int position, const std::map<int, int> *bigramMap,
-            const uint8_t *bigramFilter, const int unigramProbability);
-    static int getBigramProbabilityFromHashMap(const int position,
-            const hash_map_compat<int, int> *bigramMap, const int unigramProbability);
-    static float getMultiWordCostMultiplier(const uint8_t *const dict, const int dictSize);
-    static void fillBigramProbabilityToHashMap(const uint8_t *const root, int position,
-            hash_map_compat<int, int> *bigramMap);
+    static int getProbability(const int position, const BigramProbabilityMap *bigramMap,
+            const int unigramProbability);
+    static int getBigramProbabilityFromMap(const int position,
+            const BigramProbabilityMap *bigramMap, const int unigramProbability);
+    static void fillBigramProbabilityMap(const uint8_t *const root, int position,
+            BigramProbabilityMap *bigramMap);
     static int getBigramProbability(const uint8_t *const root, int position,
             const int nextPosition, const int unigramProbability);
 
@@ -115,14 +127,6 @@ class BinaryFormat {
     DISALLOW_IMPLICIT_CONSTRUCTORS(BinaryFormat);
     static int getBigramListPositionForWordPosition(const uint8_t *const root, int position);
 
-    static const int FLAG_GROUP_ADDRESS_TYPE_NOADDRESS = 0x00;
-    static const int FLAG_GROUP_ADDRESS_TYPE_ONEBYTE = 0x40;
-    static const int FLAG_GROUP_ADDRESS_TYPE_TWOBYTES = 0x80;
-    static const int FLAG_GROUP_ADDRESS_TYPE_THREEBYTES = 0xC0;
-    static const int FLAG_ATTRIBUTE_ADDRESS_TYPE_ONEBYTE = 0x10;
-    static const int FLAG_ATTRIBUTE_ADDRESS_TYPE_TWOBYTES = 0x20;
-    static const int FLAG_ATTRIBUTE_ADDRESS_TYPE_THREEBYTES = 0x30;
-
     // Any file smaller than this is not a dictionary.
     static const int DICTIONARY_MINIMUM_SIZE = 4;
     // Originally, format version 1 had a 16-bit magic number, then the version number `01'
@@ -130,15 +134,8 @@ class BinaryFormat {
     // and it's okay to consider them a magic number as a whole.
     static const int FORMAT_VERSION_1_MAGIC_NUMBER = 0x78B10100;
     static const int FORMAT_VERSION_1_HEADER_SIZE = 5;
-    // The versions of Latin IME that only handle format version 1 only test for the magic
-    // number, so we had to change it so that version 2 files would be rejected by older
-    // implementations. On this occasion, we made the magic number 32 bits long.
-    static const int FORMAT_VERSION_2_MAGIC_NUMBER = -1681835266; // 0x9BC13AFE
-    // Magic number (4 bytes), version (2 bytes), options (2 bytes), header size (4 bytes) = 12
-    static const int FORMAT_VERSION_2_MINIMUM_SIZE = 12;
 
     static const int CHARACTER_ARRAY_TERMINATOR_SIZE = 1;
-    static const int MINIMAL_ONE_BYTE_CHARACTER_VALUE = 0x20;
     static const int CHARACTER_ARRAY_TERMINATOR = 0x1F;
     static const int MULTIPLE_BYTE_CHARACTER_ADDITIONAL_SIZE = 2;
     static const int NO_FLAGS = 0;
@@ -269,19 +266,6 @@ AK_FORCE_INLINE int BinaryFormat::getGroupCountAndForwardPointer(const uint8_t *
     return ((msb & 0x7F) << 8) | dict[(*pos)++];
 }
 
-inline float BinaryFormat::getMultiWordCostMultiplier(const uint8_t *const dict,
-        const int dictSize) {
-    const int headerValue = readHeaderValueInt(dict, dictSize,
-            "MULTIPLE_WORDS_DEMOTION_RATE");
-    if (headerValue == S_INT_MIN) {
-        return 1.0f;
-    }
-    if (headerValue <= 0) {
-        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
-    }
-    return 100.0f / static_cast<float>(headerValue);
-}
-
 inline uint8_t BinaryFormat::getFlagsAndForwardPointer(const uint8_t *const dict, int *pos) {
     return dict[(*pos)++];
 }
@@ -700,32 +684,25 @@ inline int BinaryFormat::computeProbabilityForBigram(
 }
 
 // This returns a probability in log space.
-inline int BinaryFormat::getProbability(const int position, const std::map<int, int> *bigramMap,
-        const uint8_t *bigramFilter, const int unigramProbability) {
-    if (!bigramMap || !bigramFilter) return backoff(unigramProbability);
-    if (!isInFilter(bigramFilter, position)) return backoff(unigramProbability);
-    const std::map<int, int>::const_iterator bigramProbabilityIt = bigramMap->find(position);
-    if (bigramProbabilityIt != bigramMap->end()) {
-        const int bigramProbability = bigramProbabilityIt->second;
-        return computeProbabilityForBigram(unigramProbability, bigramProbability);
-    }
-    return backoff(unigramProbability);
+inline int BinaryFormat::getProbability(const int position,
+        const BigramProbabilityMap *bigramMap, const int unigramProbability) {
+    return getBigramProbabilityFromMap(position, bigramMap, unigramProbability);
 }
 
 // This returns a probability in log space.
-inline int BinaryFormat::getBigramProbabilityFromHashMap(const int position,
-        const hash_map_compat<int, int> *bigramMap, const int unigramProbability) {
+inline int BinaryFormat::getBigramProbabilityFromMap(const int position,
+        const BigramProbabilityMap *bigramMap, const int unigramProbability) {
     if (!bigramMap) return backoff(unigramProbability);
-    const hash_map_compat<int, int>::const_iterator bigramProbabilityIt = bigramMap->find(position);
-    if (bigramProbabilityIt != bigramMap->end()) {
-        const int bigramProbability = bigramProbabilityIt->second;
+    const int bigramProbability = bigramMap->getProbability(position);
+    if (NOT_A_PROBABILITY != bigramProbability) {
         return computeProbabilityForBigram(unigramProbability, bigramProbability);
     }
     return backoff(unigramProbability);
 }
 
-AK_FORCE_INLINE void BinaryFormat::fillBigramProbabilityToHashMap(
-        const uint8_t *const root, int position, hash_map_compat<int, int> *bigramMap) {
+// Adds the bigrams of the word at position to bigramMap, and sorts it.
+AK_FORCE_INLINE void BinaryFormat::fillBigramProbabilityMap(
+        const uint8_t *const root, int position, BigramProbabilityMap *bigramMap) {
     position = getBigramListPositionForWordPosition(root, position);
     if (0 == position) return;
 
@@ -735,8 +712,9 @@ AK_FORCE_INLINE void BinaryFormat::fillBigramProbabilityToHashMap(
         const int probability = MASK_ATTRIBUTE_PROBABILITY & bigramFlags;
         const int bigramPos = getAttributeAddressAndForwardPointer(root, bigramFlags,
                 &position);
-        (*bigramMap)[bigramPos] = probability;
+        bigramMap->add(bigramPos, probability);
     } while (FLAG_ATTRIBUTE_HAS_NEXT & bigramFlags);
+    bigramMap->sort();
 }
 
 AK_FORCE_INLINE int BinaryFormat::getBigramProbability(const uint8_t *const root, int position,
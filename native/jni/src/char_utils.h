@@ -18,6 +18,7 @@
 #define LATINIME_CHAR_UTILS_H
 
 #include <cctype>
+#include <stdint.h>
 
 #include "defines.h"
 
@@ -37,7 +38,27 @@ inline static bool isAscii(int c) {
     return isascii(c) != 0;
 }
 
-unsigned short latin_tolower(const unsigned short c);
+// Returns the bit of a lower case ASCII letter in a set of letters kept as a bit mask of
+// (letter - 'a'), or 0 for any other code point.
+inline static uint32_t getLowerLetterBit(const int c) {
+    return (c >= 'a' && c <= 'z') ? (1U << (c - 'a')) : 0;
+}
+
+/**
+ * Two-level table of the lower case characters of the BMP, generated from SORTED_CHAR_MAP in
+ * char_utils.cpp. LOWER_CASE_PAGE_INDICES[c >> 8] is 0 if no character of the page of c has a
+ * lower case, and 1 + the index of the page in LOWER_CASE_PAGES otherwise, so that a lookup
+ * takes constant time.
+ */
+static const int LOWER_CASE_PAGE_COUNT = 0x0100;
+static const int LOWER_CASE_PAGE_SIZE = 0x0100;
+extern const uint8_t LOWER_CASE_PAGE_INDICES[LOWER_CASE_PAGE_COUNT];
+extern const unsigned short LOWER_CASE_PAGES[][LOWER_CASE_PAGE_SIZE];
+
+inline static unsigned short latin_tolower(const unsigned short c) {
+    const int pageIndex = LOWER_CASE_PAGE_INDICES[c / LOWER_CASE_PAGE_SIZE];
+    return pageIndex == 0 ? c : LOWER_CASE_PAGES[pageIndex - 1][c % LOWER_CASE_PAGE_SIZE];
+}
 
 /**
  * Table mapping most combined Latin, Greek, and Cyrillic characters
@@ -47,6 +68,8 @@ unsigned short latin_tolower(const unsigned short c);
  */
 static const int BASE_CHARS_SIZE = 0x0500;
 extern const unsigned short BASE_CHARS[BASE_CHARS_SIZE];
+// The lower case of BASE_CHARS[c], generated from BASE_CHARS and SORTED_CHAR_MAP
+extern const unsigned short BASE_LOWER_CHARS[BASE_CHARS_SIZE];
 
 inline static int toBaseCodePoint(int c) {
     if (c < BASE_CHARS_SIZE) {
@@ -66,7 +89,10 @@ AK_FORCE_INLINE static int toLowerCase(const int c) {
 }
 
 AK_FORCE_INLINE static int toBaseLowerCase(const int c) {
-    return toLowerCase(toBaseCodePoint(c));
+    if (c < BASE_CHARS_SIZE) {
+        return static_cast<int>(BASE_LOWER_CHARS[c]);
+    }
+    return toLowerCase(c);
 }
 
 inline static bool isIntentionalOmissionCodePoint(const int codePoint) {
@@ -23,6 +23,7 @@
 #include "defines.h"
 #include "proximity_info_state.h"
 #include "suggest_utils.h"
+#include "suggest/policyimpl/utils/bit_vector_edit_distance.h"
 #include "suggest/policyimpl/utils/edit_distance.h"
 #include "suggest/policyimpl/utils/damerau_levenshtein_edit_distance_policy.h"
 
@@ -34,13 +35,7 @@ class ProximityInfo;
 // edit distance funcitons //
 /////////////////////////////
 
-inline static void initEditDistance(int *editDistanceTable) {
-    for (int i = 0; i <= MAX_WORD_LENGTH; ++i) {
-        editDistanceTable[i] = i;
-    }
-}
-
-inline static void dumpEditDistance10ForDebug(int *editDistanceTable,
+inline static void dumpEditDistance10ForDebug(const BitVectorEditDistance *editDistance,
         const int editDistanceTableWidth, const int outputLength) {
     if (DEBUG_DICT) {
         AKLOGI("EditDistanceTable");
@@ -48,7 +43,7 @@ inline static void dumpEditDistance10ForDebug(int *editDistanceTable,
             int c[11];
             for (int j = 0; j <= 10; ++j) {
                 if (j < editDistanceTableWidth + 1 && i < outputLength + 1) {
-                    c[j] = (editDistanceTable + i * (editDistanceTableWidth + 1))[j];
+                    c[j] = editDistance->getEditDistance(j, i);
                 } else {
                     c[j] = -1;
                 }
@@ -60,12 +55,12 @@ inline static void dumpEditDistance10ForDebug(int *editDistanceTable,
     }
 }
 
-inline static int getCurrentEditDistance(int *editDistanceTable, const int editDistanceTableWidth,
+inline static int getCurrentEditDistance(const BitVectorEditDistance *editDistance,
         const int outputLength, const int inputSize) {
     if (DEBUG_EDIT_DISTANCE) {
         AKLOGI("getCurrentEditDistance %d, %d", inputSize, outputLength);
     }
-    return editDistanceTable[(editDistanceTableWidth + 1) * (outputLength) + inputSize];
+    return editDistance->getEditDistance(inputSize, outputLength);
 }
 
 ////////////////
@@ -81,9 +76,17 @@ void Correction::initCorrection(const ProximityInfo *pi, const int inputSize, co
     mInputSize = inputSize;
     mMaxDepth = maxDepth;
     mMaxEditDistance = mInputSize < 5 ? 2 : mInputSize / 2;
-    // TODO: This is not supposed to be required.  Check what's going wrong with
-    // editDistance[0 ~ MAX_WORD_LENGTH]
-    initEditDistance(mEditDistanceTable);
+    mEditDistance.setString0(getPrimaryInputWord(), mInputSize);
+    for (int i = 0; i < mInputSize; ++i) {
+        mInputDigraphs[i] = 0;
+        for (int j = 0; i + 1 < mInputSize && j < mDigraphsSize; ++j) {
+            if (getPrimaryCodePointAt(i) == mDigraphs[j].first
+                    && getPrimaryCodePointAt(i + 1) == mDigraphs[j].second) {
+                mInputDigraphs[i] = &mDigraphs[j];
+                break;
+            }
+        }
+    }
 }
 
 void Correction::initCorrectionState(
@@ -142,6 +145,28 @@ int Correction::getFinalProbabilityForSubQueue(const int probability, int **word
     return getFinalProbabilityInternal(probability, word, wordLength, inputSize);
 }
 
+// Returns the edit distance between mWord and the first inputSize code points of the input, in
+// which the digraphs matched to the composite glyphs of mWord are replaced by the glyphs.
+int Correction::getEditDistanceWithDigraphs(const int outputLength, const int inputSize) const {
+    int replacedInput[MAX_WORD_LENGTH];
+    int replacedInputSize = 0;
+    int outputIndex = 0;
+    for (int i = 0; i < inputSize; ++i) {
+        while (outputIndex < outputLength && (mDigraphInputIndices[outputIndex] == NOT_AN_INDEX
+                || mDigraphInputIndices[outputIndex] < i)) {
+            ++outputIndex;
+        }
+        if (outputIndex < outputLength && mDigraphInputIndices[outputIndex] == i) {
+            replacedInput[replacedInputSize++] = mWord[outputIndex];
+            ++i;
+        } else {
+            replacedInput[replacedInputSize++] = getPrimaryCodePointAt(i);
+        }
+    }
+    return BitVectorEditDistance::getEditDistance(replacedInput, replacedInputSize, mWord,
+            outputLength);
+}
+
 bool Correction::initProcessState(const int outputIndex) {
     if (mCorrectionStates[outputIndex].mChildCount <= 0) {
         return false;
@@ -156,12 +181,16 @@ bool Correction::initProcessState(const int outputIndex) {
     mTransposedCount = mCorrectionStates[outputIndex].mTransposedCount;
     mExcessiveCount = mCorrectionStates[outputIndex].mExcessiveCount;
     mSkippedCount = mCorrectionStates[outputIndex].mSkippedCount;
+    mDigraphCount = mCorrectionStates[outputIndex].mDigraphCount;
     mLastCharExceeded = mCorrectionStates[outputIndex].mLastCharExceeded;
 
     mTransposedPos = mCorrectionStates[outputIndex].mTransposedPos;
     mExcessivePos = mCorrectionStates[outputIndex].mExcessivePos;
     mSkipPos = mCorrectionStates[outputIndex].mSkipPos;
 
+    mDigraphChoices = mCorrectionStates[outputIndex].mDigraphChoices;
+    mDigraphBranchCount = 0;
+
     mMatching = false;
     mProximityMatching = false;
     mAdditionalProximityMatching = false;
@@ -172,10 +201,28 @@ bool Correction::initProcessState(const int outputIndex) {
     return true;
 }
 
+// Returns whether the node just processed has to be visited again to take the other branch at a
+// digraph. The branches are enumerated as binary numbers whose bits are the choices at the
+// digraphs met in a visit, from the first one: the next visit flips the last choice that did not
+// match the digraph, and does not match the digraphs met after it.
+bool Correction::retryCurrentNodeForDigraphs(const int outputIndex) {
+    for (int i = mDigraphBranchCount - 1; i >= 0; --i) {
+        if ((mDigraphChoices & (1u << i)) == 0) {
+            mCorrectionStates[outputIndex].mDigraphChoices =
+                    (mDigraphChoices & ((1u << i) - 1)) | (1u << i);
+            ++(mCorrectionStates[outputIndex].mChildCount);
+            return true;
+        }
+    }
+    mCorrectionStates[outputIndex].mDigraphChoices = 0;
+    return false;
+}
+
 int Correction::goDownTree(const int parentIndex, const int childCount, const int firstChildPos) {
     mCorrectionStates[mOutputIndex].mParentIndex = parentIndex;
     mCorrectionStates[mOutputIndex].mChildCount = childCount;
     mCorrectionStates[mOutputIndex].mSiblingPos = firstChildPos;
+    mCorrectionStates[mOutputIndex].mDigraphChoices = 0;
     return mOutputIndex;
 }
 
@@ -210,6 +257,7 @@ Correction::CorrectionType Correction::processCharAndCalcState(const int c, cons
     const bool canTryCorrection = noCorrectionsHappenedSoFar;
     int proximityIndex = 0;
     mDistances[mOutputIndex] = NOT_A_DISTANCE;
+    mDigraphInputIndices[mOutputIndex] = NOT_AN_INDEX;
 
     // Skip checking this node
     if (mNeedsToTraverseAllNodes || isSingleQuote(c)) {
@@ -244,7 +292,7 @@ Correction::CorrectionType Correction::processCharAndCalcState(const int c, cons
             mExcessivePos = mOutputIndex;
         }
         if (mExcessivePos < mInputSize - 1) {
-            mExceeding = mExcessivePos == mInputIndex && canTryCorrection;
+            mExceeding = mExcessivePos == mInputIndex - mDigraphCount && canTryCorrection;
         }
     }
 
@@ -264,7 +312,7 @@ Correction::CorrectionType Correction::processCharAndCalcState(const int c, cons
             mTransposedPos = mOutputIndex;
         }
         if (mTransposedPos < mInputSize - 1) {
-            mTransposing = mInputIndex == mTransposedPos && canTryCorrection;
+            mTransposing = mInputIndex - mDigraphCount == mTransposedPos && canTryCorrection;
         }
     }
 
@@ -300,7 +348,11 @@ Correction::CorrectionType Correction::processCharAndCalcState(const int c, cons
             ? (noCorrectionsHappenedSoFar || mProximityCount == 0)
             : (noCorrectionsHappenedSoFar && mProximityCount == 0);
 
-    ProximityType matchedProximityCharId = secondTransposing
+    // A composite glyph matches its digraph in the input, as if the user had typed the glyph.
+    // Example:
+    // pruefen -> pr[u-umlaut]fen
+    const bool isDigraph = !secondTransposing && mInputIndex < mInputSize && matchesDigraph(c);
+    ProximityType matchedProximityCharId = (secondTransposing || isDigraph)
             ? MATCH_CHAR
             : mProximityInfoState.getProximityType(
                     mInputIndex, c, checkProximityChars, &proximityIndex);
@@ -457,6 +509,12 @@ Correction::CorrectionType Correction::processCharAndCalcState(const int c, cons
         mMatching = true;
         ++mEquivalentCharCount;
         mDistances[mOutputIndex] = mProximityInfoState.getNormalizedSquaredDistance(mInputIndex, 0);
+        if (isDigraph) {
+            // The second char of the digraph is consumed by the composite glyph too.
+            mDigraphInputIndices[mOutputIndex] = mInputIndex;
+            ++mDigraphCount;
+            incrementInputIndex();
+        }
     } else if (PROXIMITY_CHAR == matchedProximityCharId) {
         mProximityMatching = true;
         ++mProximityCount;
@@ -535,9 +593,15 @@ inline static bool isUpperCase(unsigned short c) {
 // RankingAlgorithm //
 //////////////////////
 
-/* static */ int Correction::RankingAlgorithm::calculateFinalProbability(const int inputIndex,
-        const int outputIndex, const int freq, int *editDistanceTable, const Correction *correction,
-        const int inputSize) {
+/* static */ int Correction::RankingAlgorithm::calculateFinalProbability(
+        const int typedInputIndex, const int outputIndex, const int freq,
+        const BitVectorEditDistance *editDistance, const Correction *correction,
+        const int typedInputSize) {
+    // The input is scored as if each digraph matched to a composite glyph had been typed as the
+    // glyph.
+    const int digraphCount = correction->mDigraphCount;
+    const int inputIndex = typedInputIndex - digraphCount;
+    const int inputSize = typedInputSize - digraphCount;
     const int excessivePos = correction->getExcessivePos();
     const int typedLetterMultiplier = correction->TYPED_LETTER_MULTIPLIER;
     const int fullWordMultiplier = correction->FULL_WORD_MULTIPLIER;
@@ -564,12 +628,12 @@ inline static bool isUpperCase(unsigned short c) {
     const bool skipped = skippedCount > 0;
 
     const int quoteDiffCount = max(0, getQuoteCount(word, outputLength)
-            - getQuoteCount(proximityInfoState->getPrimaryInputWord(), inputSize));
+            - getQuoteCount(proximityInfoState->getPrimaryInputWord(), typedInputSize));
 
     // TODO: Calculate edit distance for transposed and excessive
     int ed = 0;
     if (DEBUG_DICT_FULL) {
-        dumpEditDistance10ForDebug(editDistanceTable, correction->mInputSize, outputLength);
+        dumpEditDistance10ForDebug(editDistance, correction->mInputSize, outputLength);
     }
     int adjustedProximityMatchedCount = proximityMatchedCount;
 
@@ -581,8 +645,10 @@ inline static bool isUpperCase(unsigned short c) {
     }
     // TODO: Optimize this.
     if (transposedCount > 0 || proximityMatchedCount > 0 || skipped || excessiveCount > 0) {
-        ed = getCurrentEditDistance(editDistanceTable, correction->mInputSize, outputLength,
-                inputSize) - transposedCount;
+        ed = (digraphCount > 0
+                ? correction->getEditDistanceWithDigraphs(outputLength, typedInputSize)
+                : getCurrentEditDistance(editDistance, outputLength, inputSize))
+                        - transposedCount;
 
         const int matchWeight = powerIntCapped(typedLetterMultiplier,
                 max(inputSize, outputLength) - ed);
@@ -910,11 +976,33 @@ inline static bool isUpperCase(unsigned short c) {
 
 /* static */ int Correction::RankingAlgorithm::editDistance(const int *before,
         const int beforeLength, const int *after, const int afterLength) {
+    // The distance is symmetric, so either string can be the one of the bit vectors.
+    if (beforeLength <= BitVectorEditDistance::MAX_STRING0_LENGTH) {
+        return BitVectorEditDistance::getEditDistance(before, beforeLength, after, afterLength);
+    }
+    if (afterLength <= BitVectorEditDistance::MAX_STRING0_LENGTH) {
+        return BitVectorEditDistance::getEditDistance(after, afterLength, before, beforeLength);
+    }
     const DamerauLevenshteinEditDistancePolicy daemaruLevenshtein(
             before, beforeLength, after, afterLength);
     return static_cast<int>(EditDistance::getEditDistance(&daemaruLevenshtein));
 }
 
+/* static */ void Correction::RankingAlgorithm::editDistances(const int *before,
+        const int beforeLength, const int *afterOffsets, const int *afters, const int afterCount,
+        int *outDistances) {
+    // The bit vectors of before are shared by all the words.
+    if (beforeLength <= BitVectorEditDistance::MAX_STRING0_LENGTH) {
+        BitVectorEditDistance::getEditDistances(before, beforeLength, afterOffsets, afters,
+                afterCount, outDistances);
+        return;
+    }
+    for (int i = 0; i < afterCount; ++i) {
+        outDistances[i] = editDistance(before, beforeLength, afters + afterOffsets[i],
+                afterOffsets[i + 1] - afterOffsets[i]);
+    }
+}
+
 
 // In dictionary.cpp, getSuggestion() method,
 // When USE_SUGGEST_INTERFACE_FOR_TYPING is true:
@@ -948,7 +1036,24 @@ inline static bool isUpperCase(unsigned short c) {
     if (0 == beforeLength || 0 == afterLength) {
         return 0.0f;
     }
-    const int distance = editDistance(before, beforeLength, after, afterLength);
+    return calcNormalizedScoreForDistance(beforeLength, after, afterLength, score,
+            editDistance(before, beforeLength, after, afterLength));
+}
+
+/* static */ float Correction::RankingAlgorithm::calcNormalizedScoreUpperBound(
+        const int beforeLength, const int *after, const int afterLength, const int score) {
+    if (0 == beforeLength || 0 == afterLength) {
+        return 0.0f;
+    }
+    // The distance is at least the difference of the lengths, and the score only decreases with
+    // the distance.
+    return calcNormalizedScoreForDistance(beforeLength, after, afterLength, score,
+            max(beforeLength - afterLength, afterLength - beforeLength));
+}
+
+/* static */ float Correction::RankingAlgorithm::calcNormalizedScoreForDistance(
+        const int beforeLength, const int *after, const int afterLength, const int score,
+        const int distance) {
     int spaceCount = 0;
     for (int i = 0; i < afterLength; ++i) {
         if (after[i] == KEYCODE_SPACE) {
@@ -19,9 +19,12 @@
 
 #include <cstring> // for memset()
 
+#include "char_utils.h"
 #include "correction_state.h"
 #include "defines.h"
+#include "digraph_utils.h"
 #include "proximity_info_state.h"
+#include "suggest/policyimpl/utils/bit_vector_edit_distance.h"
 
 namespace latinime {
 
@@ -41,15 +44,18 @@ class Correction {
             : mProximityInfo(0), mUseFullEditDistance(false), mDoAutoCompletion(false),
               mMaxEditDistance(0), mMaxDepth(0), mInputSize(0), mSpaceProximityPos(0),
               mMissingSpacePos(0), mTerminalInputIndex(0), mTerminalOutputIndex(0), mMaxErrors(0),
-              mTotalTraverseCount(0), mNeedsToTraverseAllNodes(false), mOutputIndex(0),
-              mInputIndex(0), mEquivalentCharCount(0), mProximityCount(0), mExcessiveCount(0),
-              mTransposedCount(0), mSkippedCount(0), mTransposedPos(0), mExcessivePos(0),
-              mSkipPos(0), mLastCharExceeded(false), mMatching(false), mProximityMatching(false),
-              mAdditionalProximityMatching(false), mExceeding(false), mTransposing(false),
-              mSkipping(false), mProximityInfoState() {
+              mTotalTraverseCount(0), mEditDistance(), mNeedsToTraverseAllNodes(false),
+              mOutputIndex(0), mInputIndex(0), mEquivalentCharCount(0), mProximityCount(0),
+              mExcessiveCount(0), mTransposedCount(0), mSkippedCount(0), mDigraphCount(0),
+              mTransposedPos(0), mExcessivePos(0), mSkipPos(0), mLastCharExceeded(false),
+              mMatching(false), mProximityMatching(false), mAdditionalProximityMatching(false),
+              mExceeding(false), mTransposing(false), mSkipping(false), mDigraphs(0),
+              mDigraphsSize(0), mDigraphChoices(0), mDigraphBranchCount(0),
+              mProximityInfoState() {
         memset(mWord, 0, sizeof(mWord));
         memset(mDistances, 0, sizeof(mDistances));
-        memset(mEditDistanceTable, 0, sizeof(mEditDistanceTable));
+        memset(mDigraphInputIndices, 0, sizeof(mDigraphInputIndices));
+        memset(mInputDigraphs, 0, sizeof(mInputDigraphs));
         // NOTE: mCorrectionStates is an array of instances.
         // No need to initialize it explicitly here.
     }
@@ -59,6 +65,13 @@ class Correction {
     void resetCorrection();
     void initCorrection(const ProximityInfo *pi, const int inputSize, const int maxDepth);
     void initCorrectionState(const int rootPos, const int childCount, const bool traverseAll);
+    // Sets the digraphs of the dictionary. A composite glyph of the dictionary then also matches
+    // its digraph in the input, so that the traversal finds the words of all the spellings.
+    void setDigraphs(const DigraphUtils::digraph_t *const digraphs, const int digraphsSize) {
+        mDigraphs = digraphs;
+        mDigraphsSize = digraphsSize;
+    }
+    bool retryCurrentNodeForDigraphs(const int outputIndex);
 
     // TODO: remove
     void setCorrectionParams(const int skipPos, const int excessivePos, const int transposedPos,
@@ -76,6 +89,10 @@ class Correction {
         return ++mTotalTraverseCount;
     }
 
+    int getTotalTraverseCount() const {
+        return mTotalTraverseCount;
+    }
+
     int getFreqForSplitMultipleWords(const int *freqArray, const int *wordLengthArray,
             const int wordCount, const bool isSpaceProximity, const int *word) const;
     int getFinalProbability(const int probability, int **word, int *wordLength);
@@ -103,24 +120,37 @@ class Correction {
     class RankingAlgorithm {
      public:
         static int calculateFinalProbability(const int inputIndex, const int depth,
-                const int probability, int *editDistanceTable, const Correction *correction,
+                const int probability, const BitVectorEditDistance *editDistance,
+                const Correction *correction,
                 const int inputSize);
         static int calcFreqForSplitMultipleWords(const int *freqArray, const int *wordLengthArray,
                 const int wordCount, const Correction *correction, const bool isSpaceProximity,
                 const int *word);
         static float calcNormalizedScore(const int *before, const int beforeLength,
                 const int *after, const int afterLength, const int score);
+        // An upper bound of calcNormalizedScore that does not compute the edit distance.
+        static float calcNormalizedScoreUpperBound(const int beforeLength, const int *after,
+                const int afterLength, const int score);
         static int editDistance(const int *before, const int beforeLength, const int *after,
                 const int afterLength);
+        // The distances between before and each of the afterCount words of afters, the word i
+        // spanning from afterOffsets[i] to afterOffsets[i + 1].
+        static void editDistances(const int *before, const int beforeLength,
+                const int *afterOffsets, const int *afters, const int afterCount,
+                int *outDistances);
      private:
         static const int MAX_INITIAL_SCORE = 255;
+
+        static float calcNormalizedScoreForDistance(const int beforeLength, const int *after,
+                const int afterLength, const int score, const int distance);
     };
 
     // proximity info state
     void initInputParams(const ProximityInfo *proximityInfo, const int *inputCodes,
             const int inputSize, const int *xCoordinates, const int *yCoordinates) {
         mProximityInfoState.initInputParams(0, static_cast<float>(MAX_VALUE_FOR_WEIGHTING),
-                proximityInfo, inputCodes, inputSize, xCoordinates, yCoordinates, 0, 0, false);
+                proximityInfo, inputCodes, inputSize, xCoordinates, yCoordinates, 0, 0, false,
+                false);
     }
 
     const int *getPrimaryInputWord() const {
@@ -217,8 +247,11 @@ class Correction {
     inline void addCharToCurrentWord(const int c);
     inline int getFinalProbabilityInternal(const int probability, int **word, int *wordLength,
             const int inputSize);
+    inline bool matchesDigraph(const int c);
+    int getEditDistanceWithDigraphs(const int outputLength, const int inputSize) const;
 
     static const int TYPED_LETTER_MULTIPLIER = 2;
+    static const int MAX_DIGRAPH_BRANCH_COUNT = 32;
     static const int FULL_WORD_MULTIPLIER = 2;
     const ProximityInfo *mProximityInfo;
 
@@ -238,10 +271,11 @@ class Correction {
     // The following arrays are state buffer.
     int mWord[MAX_WORD_LENGTH];
     int mDistances[MAX_WORD_LENGTH];
+    // The input index of the digraph matched to each char of mWord, or NOT_AN_INDEX
+    int mDigraphInputIndices[MAX_WORD_LENGTH];
 
-    // Edit distance calculation requires a buffer with (N+1)^2 length for the input length N.
-    // Caveat: Do not create multiple tables per thread as this table eats up RAM a lot.
-    int mEditDistanceTable[(MAX_WORD_LENGTH + 1) * (MAX_WORD_LENGTH + 1)];
+    // The edit distances between the prefixes of the input and of mWord
+    BitVectorEditDistance mEditDistance;
 
     CorrectionState mCorrectionStates[MAX_WORD_LENGTH];
 
@@ -255,6 +289,7 @@ class Correction {
     int mExcessiveCount;
     int mTransposedCount;
     int mSkippedCount;
+    int mDigraphCount;
 
     int mTransposedPos;
     int mExcessivePos;
@@ -268,6 +303,14 @@ class Correction {
     bool mExceeding;
     bool mTransposing;
     bool mSkipping;
+
+    const DigraphUtils::digraph_t *mDigraphs;
+    int mDigraphsSize;
+    // The digraph of the input that starts at each input index, or 0
+    const DigraphUtils::digraph_t *mInputDigraphs[MAX_WORD_LENGTH];
+    // The branches taken at the digraphs in the current visit of the node, and their count
+    uint32_t mDigraphChoices;
+    int mDigraphBranchCount;
     ProximityInfoState mProximityInfoState;
 };
 
@@ -288,6 +331,7 @@ AK_FORCE_INLINE void Correction::incrementOutputIndex() {
     mCorrectionStates[mOutputIndex].mTransposedCount = mTransposedCount;
     mCorrectionStates[mOutputIndex].mExcessiveCount = mExcessiveCount;
     mCorrectionStates[mOutputIndex].mSkippedCount = mSkippedCount;
+    mCorrectionStates[mOutputIndex].mDigraphCount = mDigraphCount;
 
     mCorrectionStates[mOutputIndex].mSkipPos = mSkipPos;
     mCorrectionStates[mOutputIndex].mTransposedPos = mTransposedPos;
@@ -331,34 +375,28 @@ inline Correction::CorrectionType Correction::processUnrelatedCorrectionType() {
     return UNRELATED;
 }
 
-AK_FORCE_INLINE static void calcEditDistanceOneStep(int *editDistanceTable, const int *input,
-        const int inputSize, const int *output, const int outputLength) {
-    // TODO: Make sure that editDistance[0 ~ MAX_WORD_LENGTH] is not touched.
-    // Let dp[i][j] be editDistanceTable[i * (inputSize + 1) + j].
-    // Assuming that dp[0][0] ... dp[outputLength - 1][inputSize] are already calculated,
-    // and calculate dp[ouputLength][0] ... dp[outputLength][inputSize].
-    int *const current = editDistanceTable + outputLength * (inputSize + 1);
-    const int *const prev = editDistanceTable + (outputLength - 1) * (inputSize + 1);
-    const int *const prevprev =
-            outputLength >= 2 ? editDistanceTable + (outputLength - 2) * (inputSize + 1) : 0;
-    current[0] = outputLength;
-    const int co = toBaseLowerCase(output[outputLength - 1]);
-    const int prevCO = outputLength >= 2 ? toBaseLowerCase(output[outputLength - 2]) : 0;
-    for (int i = 1; i <= inputSize; ++i) {
-        const int ci = toBaseLowerCase(input[i - 1]);
-        const int cost = (ci == co) ? 0 : 1;
-        current[i] = min(current[i - 1] + 1, min(prev[i] + 1, prev[i - 1] + cost));
-        if (i >= 2 && prevprev && ci == prevCO && co == toBaseLowerCase(input[i - 2])) {
-            current[i] = min(current[i], prevprev[i - 2] + 1);
-        }
-    }
-}
-
 AK_FORCE_INLINE void Correction::addCharToCurrentWord(const int c) {
     mWord[mOutputIndex] = c;
-    const int *primaryInputWord = mProximityInfoState.getPrimaryInputWord();
-    calcEditDistanceOneStep(mEditDistanceTable, primaryInputWord, mInputSize, mWord,
-            mOutputIndex + 1);
+    mEditDistance.setString1CodePointAt(mOutputIndex + 1, c);
+}
+
+// Returns whether c matches the digraph of the input at the input index, as if the composite
+// glyph of the digraph had been typed. A composite glyph always matches its digraph. The char
+// the glyph is based on may match either the glyph or the first char of the digraph, so the
+// current node is visited once for each.
+AK_FORCE_INLINE bool Correction::matchesDigraph(const int c) {
+    const DigraphUtils::digraph_t *const digraph = mInputDigraphs[mInputIndex];
+    if (!digraph) {
+        return false;
+    }
+    if (toLowerCase(c) == digraph->compositeGlyph) {
+        return true;
+    }
+    if (toBaseLowerCase(c) != toBaseLowerCase(digraph->compositeGlyph)
+            || mDigraphBranchCount >= MAX_DIGRAPH_BRANCH_COUNT) {
+        return false;
+    }
+    return (mDigraphChoices & (1u << (mDigraphBranchCount++))) != 0;
 }
 
 inline int Correction::getFinalProbabilityInternal(const int probability, int **word,
@@ -368,7 +406,7 @@ inline int Correction::getFinalProbabilityInternal(const int probability, int **
     *wordLength = outputIndex + 1;
     *word = mWord;
     int finalProbability= Correction::RankingAlgorithm::calculateFinalProbability(
-            inputIndex, outputIndex, probability, mEditDistanceTable, this, inputSize);
+            inputIndex, outputIndex, probability, &mEditDistance, this, inputSize);
     return finalProbability;
 }
 
@@ -26,6 +26,9 @@ namespace latinime {
 struct CorrectionState {
     int mParentIndex;
     int mSiblingPos;
+    // The branches to take at the digraphs of the input in the next visit of the node at this
+    // index. See Correction::retryCurrentNodeForDigraphs().
+    uint32_t mDigraphChoices;
     uint16_t mChildCount;
     uint8_t mInputIndex;
 
@@ -34,6 +37,8 @@ struct CorrectionState {
     uint8_t mTransposedCount;
     uint8_t mExcessiveCount;
     uint8_t mSkippedCount;
+    // The number of the digraphs of the input matched to one composite glyph each
+    uint8_t mDigraphCount;
 
     int8_t mTransposedPos;
     int8_t mExcessivePos;
@@ -58,6 +63,7 @@ inline static void initCorrectionState(CorrectionState *state, const int rootPos
     state->mChildCount = childCount;
     state->mInputIndex = 0;
     state->mSiblingPos = rootPos;
+    state->mDigraphChoices = 0;
     state->mNeedsToTraverseAllNodes = traverseAll;
 
     state->mTransposedPos = -1;
@@ -69,6 +75,7 @@ inline static void initCorrectionState(CorrectionState *state, const int rootPos
     state->mTransposedCount = 0;
     state->mExcessiveCount = 0;
     state->mSkippedCount = 0;
+    state->mDigraphCount = 0;
 
     state->mLastCharExceeded = false;
 
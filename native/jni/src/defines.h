@@ -32,6 +32,21 @@
 #define MAX_WORD_LENGTH 48
 // Must be equal to BinaryDictionary.MAX_RESULTS in Java
 #define MAX_RESULTS 18
+// Must be equal to BinaryDictionary.MAX_SUGGESTION_BATCH_SIZE in Java
+#define MAX_SUGGESTION_BATCH_SIZE 16
+// The length of the packed results of a batched query: the count, then the length, score and type
+// and the code points of each word. Must be equal to BinaryDictionary.MAX_PACKED_RESULTS_LENGTH
+// in Java
+#define MAX_PACKED_RESULTS_LENGTH (1 + MAX_RESULTS * (3 + MAX_WORD_LENGTH))
+// The number of dictionaries searched in one call by
+// BinaryDictionary.getSuggestionsFromDictionaries. Must be equal to
+// BinaryDictionary.MAX_COLLECTION_DICTIONARY_COUNT in Java
+#define MAX_COLLECTION_DICTIONARY_COUNT 4
+// The length of the merged results of those dictionaries: the count, then the dictionary index,
+// length, score and type and the code points of each word. Must be equal to
+// BinaryDictionary.MAX_COLLECTION_PACKED_RESULTS_LENGTH in Java
+#define MAX_COLLECTION_PACKED_RESULTS_LENGTH \
+        (1 + MAX_COLLECTION_DICTIONARY_COUNT * MAX_RESULTS * (4 + MAX_WORD_LENGTH))
 // Must be equal to ProximityInfo.MAX_PROXIMITY_CHARS_SIZE in Java
 #define MAX_PROXIMITY_CHARS_SIZE 16
 #define ADDITIONAL_PROXIMITY_CHAR_DELIMITER_CODE 2
@@ -282,6 +297,8 @@ static inline void prof_out(void) {
 #define ADDITIONAL_PROXIMITY_CHAR_DISTANCE_INFO (-4)
 #define NOT_AN_INDEX (-1)
 #define NOT_A_PROBABILITY (-1)
+// Must be equal to NOT_A_TICKET in BinaryDictionary.java
+#define NOT_A_REQUEST_TICKET 0
 
 #define KEYCODE_SPACE ' '
 #define KEYCODE_SINGLE_QUOTE '\''
@@ -290,6 +307,38 @@ static inline void prof_out(void) {
 #define CALIBRATE_SCORE_BY_TOUCH_COORDINATES true
 #define SUGGEST_MULTIPLE_WORDS true
 #define USE_SUGGEST_INTERFACE_FOR_TYPING true
+// Define FLAG_OPEN_TIME_INDEXES to build the indexes below when a dictionary is opened, unless
+// it is opened with LOAD_OPTION_LOW_RAM. They take about 13 times the size of the trie: 14.4MB
+// for the 1.07MB trie of main_en.dict, which the searches otherwise read directly, more slowly.
+// Without them there are no completions.
+#ifdef FLAG_OPEN_TIME_INDEXES
+#define USE_OPEN_TIME_INDEXES true
+#else
+#define USE_OPEN_TIME_INDEXES false
+#endif
+// Decode all the char groups of a dictionary when it is opened. Costs about 35 bytes per group,
+// 7.97MB for main_en.dict.
+#define USE_DECODED_NODE_INDEX USE_OPEN_TIME_INDEXES
+// Hash the words of a dictionary to their terminal positions when it is opened. Costs about 10
+// bytes per word, 1.54MB for main_en.dict.
+#define USE_TERMINAL_POSITION_INDEX USE_OPEN_TIME_INDEXES
+// Link the char groups of a dictionary to their parents when it is opened, so that the targets of
+// bigrams are read from their addresses without a search. Costs about 8 bytes per group, 1.61MB
+// for main_en.dict.
+#define USE_WORD_ADDRESS_INDEX USE_OPEN_TIME_INDEXES
+// Bound the probabilities of the words under each char group of a dictionary when it is opened,
+// so that the completions of a prefix are found without a search. Costs about 16 bytes per group,
+// 3.23MB for main_en.dict.
+#define USE_COMPLETION_INDEX USE_OPEN_TIME_INDEXES
+// Sort the bigrams of each word of a dictionary by target when it is opened, so that the bigram
+// of a word pair is found by a binary search. Costs about 4 bytes per bigram.
+#define USE_BIGRAM_LIST_INDEX true
+// Decode the shortcut targets of a dictionary when it is opened. Costs about 16 bytes plus 4 per
+// code point for each target.
+#define USE_SHORTCUT_TABLE true
+// Keep the suggestions of the last queries of a session to answer the same query again without a
+// search. Costs about 40KB per session.
+#define USE_SUGGESTION_RESULT_CACHE true
 #define SUGGEST_INTERFACE_OUTPUT_SCALE 1000000.0f
 
 // The following "rate"s are used as a multiplier before dividing by 100, so they are in percent.
@@ -359,34 +408,65 @@ static inline void prof_out(void) {
 
 // TODO: Remove
 #define MAX_POINTER_COUNT 1
+// Define FLAG_MULTI_POINTER_GESTURE to decode gestures drawn with up to 4 fingers instead of 2.
+// Every dicNode holds an input index per pointer, so this makes all dicNodes larger.
+#ifdef FLAG_MULTI_POINTER_GESTURE
+#define MAX_POINTER_COUNT_G 4
+#else
 #define MAX_POINTER_COUNT_G 2
+#endif
+
+// Max number of bytes of the bigram maps (previous word contexts) cached by a session. Increasing
+// this number could improve bigram lookup speed for multi-word suggestions, but at the cost of
+// more memory usage. The maps are kept across keystrokes and the least recently used ones are
+// evicted; a typical bigram list takes about 1KB.
+#define MAX_BIGRAM_MAP_CACHE_BYTE_SIZE (128 * 1024)
+
+// Define FLAG_PARALLEL_EXPANSION to expand large search frontiers on a small pool of worker
+// threads. The results are merged in the same order as the sequential expansion, so suggestions
+// do not depend on thread scheduling. The input of each pointer of a gesture is also sampled on
+// its own worker.
+#ifdef FLAG_PARALLEL_EXPANSION
+#define USE_PARALLEL_EXPANSION true
+#else
+#define USE_PARALLEL_EXPANSION false
+#endif
+// Max number of threads expanding the frontier, including the calling thread
+#define MAX_EXPANSION_WORKER_COUNT 4
+// Frontiers smaller than this are expanded on the calling thread only
+#define MIN_ACTIVE_SIZE_FOR_PARALLEL_EXPANSION 48
+// The beam width is never narrowed below this to meet a latency budget
+#define MIN_ADAPTIVE_BEAM_WIDTH 20
+
+// Define FLAG_LOWER_BOUND_PRUNING to drop the typing dicNodes that can not reach the terminal queue
+// once it is full: their distance plus a lower bound of the cost of the rest of the input exceeds
+// the distance of its worst terminal. Keeping them out of the beam makes room for other dicNodes,
+// so the suggestions may differ from the search without pruning.
+#ifdef FLAG_LOWER_BOUND_PRUNING
+#define USE_LOWER_BOUND_PRUNING true
+#else
+#define USE_LOWER_BOUND_PRUNING false
+#endif
 
-// Size, in bytes, of the bloom filter index for bigrams
-// 128 gives us 1024 buckets. The probability of false positive is (1 - e ** (-kn/m))**k,
-// where k is the number of hash functions, n the number of bigrams, and m the number of
-// bits we can test.
-// At the moment 100 is the maximum number of bigrams for a word with the current
-// dictionaries, so n = 100. 1024 buckets give us m = 1024.
-// With 1 hash function, our false positive rate is about 9.3%, which should be enough for
-// our uses since we are only using this to increase average performance. For the record,
-// k = 2 gives 3.1% and k = 3 gives 1.6%. With k = 1, making m = 2048 gives 4.8%,
-// and m = 4096 gives 2.4%.
-#define BIGRAM_FILTER_BYTE_SIZE 128
-// Must be smaller than BIGRAM_FILTER_BYTE_SIZE * 8, and preferably prime. 1021 is the largest
-// prime under 128 * 8.
-#define BIGRAM_FILTER_MODULO 1021
-#if BIGRAM_FILTER_BYTE_SIZE * 8 < BIGRAM_FILTER_MODULO
-#error "BIGRAM_FILTER_MODULO is larger than BIGRAM_FILTER_BYTE_SIZE"
+// Define FLAG_TWO_PASS_GESTURE to search the long gestures in two passes: a narrow beam on a coarse
+// sampling of the path finds the candidate words, and the full sampling is only searched along
+// their paths in the lexicon. A word that the first pass misses is not suggested.
+#ifdef FLAG_TWO_PASS_GESTURE
+#define USE_TWO_PASS_GESTURE true
+#else
+#define USE_TWO_PASS_GESTURE false
 #endif
 
-// Max number of bigram maps (previous word contexts) to be cached. Increasing this number could
-// improve bigram lookup speed for multi-word suggestions, but at the cost of more memory usage.
-// Also, there are diminishing returns since the most frequently used bigrams are typically near
-// the beginning of the input and are thus the first ones to be cached. Note that these bigrams
-// are reset for each new composing word.
-#define MAX_CACHED_PREV_WORDS_IN_BIGRAM_MAP 25
-// Most common previous word contexts currently have 100 bigrams
-#define DEFAULT_HASH_MAP_SIZE_FOR_EACH_BIGRAM_MAP 100
+// Define FLAG_BMP_CODE_POINTS to store the code points of the words of the dicNodes on 16 bits
+// instead of 32, which halves the word buffer that every copy of a dicNode copies. The dictionary
+// files with code points beyond the BMP are then refused when they are opened, and such words are
+// not added to the updatable dictionaries.
+#ifdef FLAG_BMP_CODE_POINTS
+#define USE_BMP_CODE_POINTS true
+#else
+#define USE_BMP_CODE_POINTS false
+#endif
+#define MAX_BMP_CODE_POINT 0xFFFF
 
 template<typename T> AK_FORCE_INLINE const T &min(const T &a, const T &b) { return a < b ? a : b; }
 template<typename T> AK_FORCE_INLINE const T &max(const T &a, const T &b) { return a > b ? a : b; }
@@ -23,4 +23,31 @@ void *(*DicTraverseWrapper::sDicTraverseSessionFactoryMethod)(JNIEnv *, jstring)
 void (*DicTraverseWrapper::sDicTraverseSessionReleaseMethod)(void *) = 0;
 void (*DicTraverseWrapper::sDicTraverseSessionInitMethod)(
         void *, const Dictionary *const, const int *, const int) = 0;
+void (*DicTraverseWrapper::sDicTraverseSessionSetLatencyBudgetMethod)(void *, const int) = 0;
+void (*DicTraverseWrapper::sDicTraverseSessionSetProbabilityOverlayMethod)(
+        void *, const ProbabilityOverlay *const) = 0;
+void (*DicTraverseWrapper::sDicTraverseSessionSetSearchProfileMethod)(void *, const int) = 0;
+void (*DicTraverseWrapper::sDicTraverseSessionSetRequestTicketMethod)(void *, const int) = 0;
+void (*DicTraverseWrapper::sDicTraverseSessionCancelRequestMethod)(void *, const int) = 0;
+void (*DicTraverseWrapper::sDicTraverseSessionSetProgressiveIntervalMethod)(
+        void *, const int, const int) = 0;
+int (*DicTraverseWrapper::sDicTraverseSessionGetPublishedResultsMethod)(
+        void *, const int, int *const, int *const, int *const, int *const) = 0;
+int (*DicTraverseWrapper::sDicTraverseSessionGetCachedSuggestionsMethod)(void *,
+        const ProximityInfo *const, const bool, const int *const, const int *const,
+        const int *const, const int *const, const int *const, const int, const int, int *const,
+        int *const, int *const, int *const) = 0;
+void (*DicTraverseWrapper::sDicTraverseSessionCacheSuggestionsMethod)(void *, const int *const,
+        const int *const, const int *const, const int *const, const int) = 0;
+BigramProbabilityMap *(*DicTraverseWrapper::sDicTraverseSessionGetBigramProbabilityMapMethod)(
+        void *) = 0;
+BigramPredictionCache *(*DicTraverseWrapper::sDicTraverseSessionGetBigramPredictionCacheMethod)(
+        void *) = 0;
+void (*DicTraverseWrapper::sDicTraverseSessionAddMemoryUsageMethod)(void *, int *const) = 0;
+void (*DicTraverseWrapper::sDicTraverseSessionAddStatisticsMethod)(
+        void *, int64_t *const, const bool) = 0;
+void (*DicTraverseWrapper::sDicTraverseSessionRecordLatencyMethod)(
+        void *, const bool, const int, const int64_t) = 0;
+void (*DicTraverseWrapper::sDicTraverseSessionAddLatencyHistogramMethod)(
+        void *, int *const, const bool) = 0;
 } // namespace latinime
@@ -17,11 +17,17 @@
 #ifndef LATINIME_DIC_TRAVERSE_WRAPPER_H
 #define LATINIME_DIC_TRAVERSE_WRAPPER_H
 
+#include <stdint.h>
+
 #include "defines.h"
 #include "jni.h"
 
 namespace latinime {
+class BigramPredictionCache;
+class BigramProbabilityMap;
 class Dictionary;
+class ProbabilityOverlay;
+class ProximityInfo;
 // TODO: Remove
 class DicTraverseWrapper {
  public:
@@ -42,6 +48,120 @@ class DicTraverseWrapper {
             sDicTraverseSessionReleaseMethod(traverseSession);
         }
     }
+    static void setDicTraverseSessionLatencyBudget(void *traverseSession,
+            const int latencyBudgetMs) {
+        if (sDicTraverseSessionSetLatencyBudgetMethod) {
+            sDicTraverseSessionSetLatencyBudgetMethod(traverseSession, latencyBudgetMs);
+        }
+    }
+    static void setDicTraverseSessionProbabilityOverlay(void *traverseSession,
+            const ProbabilityOverlay *const overlay) {
+        if (sDicTraverseSessionSetProbabilityOverlayMethod) {
+            sDicTraverseSessionSetProbabilityOverlayMethod(traverseSession, overlay);
+        }
+    }
+    static void setDicTraverseSessionSearchProfile(void *traverseSession, const int profile) {
+        if (sDicTraverseSessionSetSearchProfileMethod) {
+            sDicTraverseSessionSetSearchProfileMethod(traverseSession, profile);
+        }
+    }
+    static void setDicTraverseSessionRequestTicket(void *traverseSession, const int ticket) {
+        if (sDicTraverseSessionSetRequestTicketMethod) {
+            sDicTraverseSessionSetRequestTicketMethod(traverseSession, ticket);
+        }
+    }
+    static void cancelDicTraverseSessionRequest(void *traverseSession, const int ticket) {
+        if (sDicTraverseSessionCancelRequestMethod) {
+            sDicTraverseSessionCancelRequestMethod(traverseSession, ticket);
+        }
+    }
+    static void setDicTraverseSessionProgressiveInterval(void *traverseSession,
+            const int inputIndexCount, const int intervalMs) {
+        if (sDicTraverseSessionSetProgressiveIntervalMethod) {
+            sDicTraverseSessionSetProgressiveIntervalMethod(traverseSession, inputIndexCount,
+                    intervalMs);
+        }
+    }
+    // Copies the suggestions last published by the running request with ticket to the arrays of
+    // MAX_RESULTS suggestions, and returns their count.
+    static int getDicTraverseSessionPublishedResults(void *traverseSession, const int ticket,
+            int *const outCodePoints, int *const outScores, int *const outSpaceIndices,
+            int *const outTypes) {
+        if (sDicTraverseSessionGetPublishedResultsMethod) {
+            return sDicTraverseSessionGetPublishedResultsMethod(traverseSession, ticket,
+                    outCodePoints, outScores, outSpaceIndices, outTypes);
+        }
+        return 0;
+    }
+    // Copies the cached suggestions of the query to the output arrays and returns their count,
+    // or returns NOT_AN_INDEX if they must be searched and passed to
+    // cacheDicTraverseSessionSuggestions. Called after initDicTraverseSession.
+    static int getDicTraverseSessionCachedSuggestions(void *traverseSession,
+            const ProximityInfo *const proximityInfo, const bool isGesture,
+            const int *const xcoordinates, const int *const ycoordinates, const int *const times,
+            const int *const pointerIds, const int *const inputCodePoints, const int inputSize,
+            const int commitPoint, int *const outWords, int *const frequencies,
+            int *const spaceIndices, int *const outputTypes) {
+        if (sDicTraverseSessionGetCachedSuggestionsMethod) {
+            return sDicTraverseSessionGetCachedSuggestionsMethod(traverseSession, proximityInfo,
+                    isGesture, xcoordinates, ycoordinates, times, pointerIds, inputCodePoints,
+                    inputSize, commitPoint, outWords, frequencies, spaceIndices, outputTypes);
+        }
+        return NOT_AN_INDEX;
+    }
+    static void cacheDicTraverseSessionSuggestions(void *traverseSession,
+            const int *const outWords, const int *const frequencies,
+            const int *const spaceIndices, const int *const outputTypes, const int count) {
+        if (sDicTraverseSessionCacheSuggestionsMethod) {
+            sDicTraverseSessionCacheSuggestionsMethod(traverseSession, outWords, frequencies,
+                    spaceIndices, outputTypes, count);
+        }
+    }
+    // Returns the map to fill with the bigrams of the previous word, or 0 without a session.
+    static BigramProbabilityMap *getDicTraverseSessionBigramProbabilityMap(
+            void *traverseSession) {
+        if (sDicTraverseSessionGetBigramProbabilityMapMethod) {
+            return sDicTraverseSessionGetBigramProbabilityMapMethod(traverseSession);
+        }
+        return 0;
+    }
+    // Returns the cache of the predictions of the session, or 0 without a session.
+    static BigramPredictionCache *getDicTraverseSessionBigramPredictionCache(
+            void *traverseSession) {
+        if (sDicTraverseSessionGetBigramPredictionCacheMethod) {
+            return sDicTraverseSessionGetBigramPredictionCacheMethod(traverseSession);
+        }
+        return 0;
+    }
+    // Adds the bytes of the session to the MEMORY_USAGE_SESSION_* categories of usage.
+    static void addDicTraverseSessionMemoryUsage(void *traverseSession, int *const usage) {
+        if (sDicTraverseSessionAddMemoryUsageMethod) {
+            sDicTraverseSessionAddMemoryUsageMethod(traverseSession, usage);
+        }
+    }
+    // Adds the counters of the session to the SearchStatistics::STATISTIC_COUNT elements of
+    // statistics, and resets them if requested.
+    static void addDicTraverseSessionStatistics(void *traverseSession,
+            int64_t *const statistics, const bool reset) {
+        if (sDicTraverseSessionAddStatisticsMethod) {
+            sDicTraverseSessionAddStatisticsMethod(traverseSession, statistics, reset);
+        }
+    }
+    static void recordDicTraverseSessionLatency(void *traverseSession, const bool isGesture,
+            const int inputSize, const int64_t durationNs) {
+        if (sDicTraverseSessionRecordLatencyMethod) {
+            sDicTraverseSessionRecordLatencyMethod(traverseSession, isGesture, inputSize,
+                    durationNs);
+        }
+    }
+    // Adds the latency counts of the session to the LatencyHistogram::LATENCY_HISTOGRAM_SIZE
+    // elements of counts, and resets them if requested.
+    static void addDicTraverseSessionLatencyHistogram(void *traverseSession, int *const counts,
+            const bool reset) {
+        if (sDicTraverseSessionAddLatencyHistogramMethod) {
+            sDicTraverseSessionAddLatencyHistogramMethod(traverseSession, counts, reset);
+        }
+    }
     static void setTraverseSessionFactoryMethod(void *(*factoryMethod)(JNIEnv *, jstring)) {
         sDicTraverseSessionFactoryMethod = factoryMethod;
     }
@@ -52,13 +172,101 @@ class DicTraverseWrapper {
     static void setTraverseSessionReleaseMethod(void (*releaseMethod)(void *)) {
         sDicTraverseSessionReleaseMethod = releaseMethod;
     }
+    static void setTraverseSessionSetLatencyBudgetMethod(
+            void (*setLatencyBudgetMethod)(void *, const int)) {
+        sDicTraverseSessionSetLatencyBudgetMethod = setLatencyBudgetMethod;
+    }
+    static void setTraverseSessionSetProbabilityOverlayMethod(
+            void (*setProbabilityOverlayMethod)(void *, const ProbabilityOverlay *const)) {
+        sDicTraverseSessionSetProbabilityOverlayMethod = setProbabilityOverlayMethod;
+    }
+    static void setTraverseSessionSetSearchProfileMethod(
+            void (*setSearchProfileMethod)(void *, const int)) {
+        sDicTraverseSessionSetSearchProfileMethod = setSearchProfileMethod;
+    }
+    static void setTraverseSessionSetRequestTicketMethod(
+            void (*setRequestTicketMethod)(void *, const int)) {
+        sDicTraverseSessionSetRequestTicketMethod = setRequestTicketMethod;
+    }
+    static void setTraverseSessionCancelRequestMethod(
+            void (*cancelRequestMethod)(void *, const int)) {
+        sDicTraverseSessionCancelRequestMethod = cancelRequestMethod;
+    }
+    static void setTraverseSessionSetProgressiveIntervalMethod(
+            void (*setProgressiveIntervalMethod)(void *, const int, const int)) {
+        sDicTraverseSessionSetProgressiveIntervalMethod = setProgressiveIntervalMethod;
+    }
+    static void setTraverseSessionGetPublishedResultsMethod(
+            int (*getPublishedResultsMethod)(void *, const int, int *const, int *const,
+                    int *const, int *const)) {
+        sDicTraverseSessionGetPublishedResultsMethod = getPublishedResultsMethod;
+    }
+    static void setTraverseSessionGetCachedSuggestionsMethod(
+            int (*getCachedSuggestionsMethod)(void *, const ProximityInfo *const, const bool,
+                    const int *const, const int *const, const int *const, const int *const,
+                    const int *const, const int, const int, int *const, int *const, int *const,
+                    int *const)) {
+        sDicTraverseSessionGetCachedSuggestionsMethod = getCachedSuggestionsMethod;
+    }
+    static void setTraverseSessionCacheSuggestionsMethod(
+            void (*cacheSuggestionsMethod)(void *, const int *const, const int *const,
+                    const int *const, const int *const, const int)) {
+        sDicTraverseSessionCacheSuggestionsMethod = cacheSuggestionsMethod;
+    }
+    static void setTraverseSessionGetBigramProbabilityMapMethod(
+            BigramProbabilityMap *(*getBigramProbabilityMapMethod)(void *)) {
+        sDicTraverseSessionGetBigramProbabilityMapMethod = getBigramProbabilityMapMethod;
+    }
+    static void setTraverseSessionGetBigramPredictionCacheMethod(
+            BigramPredictionCache *(*getBigramPredictionCacheMethod)(void *)) {
+        sDicTraverseSessionGetBigramPredictionCacheMethod = getBigramPredictionCacheMethod;
+    }
+    static void setTraverseSessionAddMemoryUsageMethod(
+            void (*addMemoryUsageMethod)(void *, int *const)) {
+        sDicTraverseSessionAddMemoryUsageMethod = addMemoryUsageMethod;
+    }
+    static void setTraverseSessionAddStatisticsMethod(
+            void (*addStatisticsMethod)(void *, int64_t *const, const bool)) {
+        sDicTraverseSessionAddStatisticsMethod = addStatisticsMethod;
+    }
+    static void setTraverseSessionRecordLatencyMethod(
+            void (*recordLatencyMethod)(void *, const bool, const int, const int64_t)) {
+        sDicTraverseSessionRecordLatencyMethod = recordLatencyMethod;
+    }
+    static void setTraverseSessionAddLatencyHistogramMethod(
+            void (*addLatencyHistogramMethod)(void *, int *const, const bool)) {
+        sDicTraverseSessionAddLatencyHistogramMethod = addLatencyHistogramMethod;
+    }
 
  private:
     DISALLOW_IMPLICIT_CONSTRUCTORS(DicTraverseWrapper);
+    // Set by static initializers before any call and never changed afterwards.
     static void *(*sDicTraverseSessionFactoryMethod)(JNIEnv *, jstring);
     static void (*sDicTraverseSessionInitMethod)(
             void *, const Dictionary *const, const int *, const int);
     static void (*sDicTraverseSessionReleaseMethod)(void *);
+    static void (*sDicTraverseSessionSetLatencyBudgetMethod)(void *, const int);
+    static void (*sDicTraverseSessionSetProbabilityOverlayMethod)(
+            void *, const ProbabilityOverlay *const);
+    static void (*sDicTraverseSessionSetSearchProfileMethod)(void *, const int);
+    static void (*sDicTraverseSessionSetRequestTicketMethod)(void *, const int);
+    static void (*sDicTraverseSessionCancelRequestMethod)(void *, const int);
+    static void (*sDicTraverseSessionSetProgressiveIntervalMethod)(void *, const int, const int);
+    static int (*sDicTraverseSessionGetPublishedResultsMethod)(void *, const int, int *const,
+            int *const, int *const, int *const);
+    static int (*sDicTraverseSessionGetCachedSuggestionsMethod)(void *,
+            const ProximityInfo *const, const bool, const int *const, const int *const,
+            const int *const, const int *const, const int *const, const int, const int,
+            int *const, int *const, int *const, int *const);
+    static void (*sDicTraverseSessionCacheSuggestionsMethod)(void *, const int *const,
+            const int *const, const int *const, const int *const, const int);
+    static BigramProbabilityMap *(*sDicTraverseSessionGetBigramProbabilityMapMethod)(void *);
+    static BigramPredictionCache *(*sDicTraverseSessionGetBigramPredictionCacheMethod)(void *);
+    static void (*sDicTraverseSessionAddMemoryUsageMethod)(void *, int *const);
+    static void (*sDicTraverseSessionAddStatisticsMethod)(void *, int64_t *const, const bool);
+    static void (*sDicTraverseSessionRecordLatencyMethod)(void *, const bool, const int,
+            const int64_t);
+    static void (*sDicTraverseSessionAddLatencyHistogramMethod)(void *, int *const, const bool);
 };
 } // namespace latinime
 #endif // LATINIME_DIC_TRAVERSE_WRAPPER_H
@@ -18,37 +18,96 @@
 
 #include "dictionary.h"
 
-#include <map> // TODO: remove
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
 #include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
 
 #include "bigram_dictionary.h"
+#include "bigram_probability_map.h"
 #include "binary_format.h"
 #include "defines.h"
 #include "dic_traverse_wrapper.h"
+#include "dictionary_heat_map.h"
+#include "dictionary_page_warmer.h"
+#include "suggest/core/dictionary/bigram_list_index.h"
+#include "suggest/core/dictionary/completion_index.h"
+#include "suggest/core/dictionary/decoded_node_index.h"
+#include "suggest/core/dictionary/dictionary_header.h"
+#include "suggest/core/dictionary/shortcut_table.h"
+#include "suggest/core/dictionary/terminal_position_index.h"
+#include "suggest/core/dictionary/word_address_index.h"
 #include "suggest/core/suggest.h"
 #include "suggest/policyimpl/gesture/gesture_suggest_policy_factory.h"
 #include "suggest/policyimpl/typing/typing_suggest_policy_factory.h"
+#include "thread_placement.h"
 #include "unigram_dictionary.h"
 
 namespace latinime {
 
-Dictionary::Dictionary(void *dict, int dictSize, int mmapFd, int dictBufAdjust)
-        : mDict(static_cast<unsigned char *>(dict)),
-          mOffsetDict((static_cast<unsigned char *>(dict))
-                  + BinaryFormat::getHeaderSize(mDict, dictSize)),
+// Dictionaries are opened on several threads.
+static pthread_mutex_t sLastDictionaryIdMutex = PTHREAD_MUTEX_INITIALIZER;
+static int sLastDictionaryId = 0;
+
+static int generateDictionaryId() {
+    pthread_mutex_lock(&sLastDictionaryIdMutex);
+    const int id = ++sLastDictionaryId;
+    pthread_mutex_unlock(&sLastDictionaryIdMutex);
+    return id;
+}
+
+// The indexes of USE_OPEN_TIME_INDEXES cost about 13 times the size of the trie, which is read
+// directly without them, only more slowly. The shortcut table is kept, as it is small.
+static bool buildsIndexes(const int loadOptions) {
+    return 0 == (loadOptions & Dictionary::LOAD_OPTION_LOW_RAM);
+}
+
+Dictionary::Dictionary(void *dict, int dictSize, int mmapFd, int dictBufAdjust,
+        const int loadOptions)
+        : mId(generateDictionaryId()), mDict(static_cast<unsigned char *>(dict)),
+          mHeader(new DictionaryHeader(mDict, dictSize)),
+          mOffsetDict(mDict + mHeader->getSize()),
           mDictSize(dictSize), mMmapFd(mmapFd), mDictBufAdjust(dictBufAdjust),
-          mUnigramDictionary(new UnigramDictionary(mOffsetDict,
-                  BinaryFormat::getFlags(mDict, dictSize))),
-          mBigramDictionary(new BigramDictionary(mOffsetDict)),
+          mDecodedNodeIndex(USE_DECODED_NODE_INDEX && buildsIndexes(loadOptions)
+                  ? DecodedNodeIndex::create(mOffsetDict, dictSize - mHeader->getSize()) : 0),
+          mTerminalPositionIndex(USE_TERMINAL_POSITION_INDEX && buildsIndexes(loadOptions)
+                  ? TerminalPositionIndex::create(mOffsetDict, dictSize - mHeader->getSize())
+                  : 0),
+          mWordAddressIndex(USE_WORD_ADDRESS_INDEX && buildsIndexes(loadOptions)
+                  ? WordAddressIndex::create(mOffsetDict, dictSize - mHeader->getSize()) : 0),
+          mCompletionIndex(USE_COMPLETION_INDEX && buildsIndexes(loadOptions)
+                  ? CompletionIndex::create(mOffsetDict, dictSize - mHeader->getSize()) : 0),
+          mBigramListIndex(USE_BIGRAM_LIST_INDEX && buildsIndexes(loadOptions)
+                  ? BigramListIndex::create(mOffsetDict, dictSize - mHeader->getSize()) : 0),
+          mShortcutTable(USE_SHORTCUT_TABLE ? ShortcutTable::create(mOffsetDict,
+                  dictSize - mHeader->getSize()) : 0),
+          mUnigramDictionary(new UnigramDictionary(mOffsetDict, mHeader->getFlags(),
+                  mTerminalPositionIndex, mShortcutTable)),
+          mBigramDictionary(new BigramDictionary(mId, mOffsetDict, mTerminalPositionIndex,
+                  mWordAddressIndex)),
           mGestureSuggest(new Suggest(GestureSuggestPolicyFactory::getGestureSuggestPolicy())),
-          mTypingSuggest(new Suggest(TypingSuggestPolicyFactory::getTypingSuggestPolicy())) {
+          mTypingSuggest(new TypingSuggest(TypingSuggestPolicyFactory::getTypingSuggestPolicy())),
+          mPageWarmer(0) {
 }
 
 Dictionary::~Dictionary() {
+    // The trie is unmapped after this.
+    DictionaryHeatMap::stopIfRecording(mOffsetDict);
+    delete mPageWarmer;
+    delete mDecodedNodeIndex;
+    delete mTerminalPositionIndex;
+    delete mWordAddressIndex;
+    delete mCompletionIndex;
+    delete mBigramListIndex;
+    delete mShortcutTable;
     delete mUnigramDictionary;
     delete mBigramDictionary;
     delete mGestureSuggest;
     delete mTypingSuggest;
+    delete mHeader;
 }
 
 int Dictionary::getSuggestions(ProximityInfo *proximityInfo, void *traverseSession,
@@ -60,9 +119,18 @@ int Dictionary::getSuggestions(ProximityInfo *proximityInfo, void *traverseSessi
     if (isGesture) {
         DicTraverseWrapper::initDicTraverseSession(
                 traverseSession, this, prevWordCodePoints, prevWordLength);
+        result = DicTraverseWrapper::getDicTraverseSessionCachedSuggestions(traverseSession,
+                proximityInfo, isGesture, xcoordinates, ycoordinates, times, pointerIds,
+                inputCodePoints, inputSize, commitPoint, outWords, frequencies, spaceIndices,
+                outputTypes);
+        if (result != NOT_AN_INDEX) {
+            return result;
+        }
         result = mGestureSuggest->getSuggestions(proximityInfo, traverseSession, xcoordinates,
                 ycoordinates, times, pointerIds, inputCodePoints, inputSize, commitPoint, outWords,
                 frequencies, spaceIndices, outputTypes);
+        DicTraverseWrapper::cacheDicTraverseSessionSuggestions(traverseSession, outWords,
+                frequencies, spaceIndices, outputTypes, result);
         if (DEBUG_DICT) {
             DUMP_RESULT(outWords, frequencies);
         }
@@ -71,43 +139,236 @@ int Dictionary::getSuggestions(ProximityInfo *proximityInfo, void *traverseSessi
         if (USE_SUGGEST_INTERFACE_FOR_TYPING) {
             DicTraverseWrapper::initDicTraverseSession(
                     traverseSession, this, prevWordCodePoints, prevWordLength);
+            result = DicTraverseWrapper::getDicTraverseSessionCachedSuggestions(traverseSession,
+                    proximityInfo, isGesture, xcoordinates, ycoordinates, times, pointerIds,
+                    inputCodePoints, inputSize, commitPoint, outWords, frequencies, spaceIndices,
+                    outputTypes);
+            if (result != NOT_AN_INDEX) {
+                return result;
+            }
             result = mTypingSuggest->getSuggestions(proximityInfo, traverseSession, xcoordinates,
                     ycoordinates, times, pointerIds, inputCodePoints, inputSize, commitPoint,
                     outWords, frequencies, spaceIndices, outputTypes);
+            DicTraverseWrapper::cacheDicTraverseSessionSuggestions(traverseSession, outWords,
+                    frequencies, spaceIndices, outputTypes, result);
             if (DEBUG_DICT) {
                 DUMP_RESULT(outWords, frequencies);
             }
             return result;
         } else {
-            std::map<int, int> bigramMap;
-            uint8_t bigramFilter[BIGRAM_FILTER_BYTE_SIZE];
-            mBigramDictionary->fillBigramAddressToProbabilityMapAndFilter(prevWordCodePoints,
-                    prevWordLength, &bigramMap, bigramFilter);
+            // The map of the session keeps its capacity from a call to the next.
+            BigramProbabilityMap localBigramMap;
+            BigramProbabilityMap *sessionBigramMap =
+                    DicTraverseWrapper::getDicTraverseSessionBigramProbabilityMap(traverseSession);
+            BigramProbabilityMap *const bigramMap =
+                    sessionBigramMap ? sessionBigramMap : &localBigramMap;
+            mBigramDictionary->fillBigramAddressToProbabilityMap(prevWordCodePoints,
+                    prevWordLength, bigramMap);
             result = mUnigramDictionary->getSuggestions(proximityInfo, xcoordinates, ycoordinates,
-                    inputCodePoints, inputSize, &bigramMap, bigramFilter, useFullEditDistance,
+                    inputCodePoints, inputSize, bigramMap, useFullEditDistance,
                     outWords, frequencies, outputTypes);
             return result;
         }
     }
 }
 
-int Dictionary::getBigrams(const int *word, int length, int *inputCodePoints, int inputSize,
-        int *outWords, int *frequencies, int *outputTypes) const {
+int Dictionary::speculateNextInput(ProximityInfo *proximityInfo, void *traverseSession,
+        int *xcoordinates, int *ycoordinates, int *times, int *pointerIds, int *inputCodePoints,
+        int inputSize, int *prevWordCodePoints, int prevWordLength, int maxStepCount) const {
+    if (!USE_SUGGEST_INTERFACE_FOR_TYPING) {
+        // The legacy typing path does not keep a frontier in the session.
+        return 0;
+    }
+    // The speculation runs in the idle time of the thread of the suggestions, so it only moves to
+    // the slow cores while it runs.
+    const ScopedThreadPlacement placement(ThreadPlacement::THREAD_CLASS_BACKGROUND);
+    DicTraverseWrapper::initDicTraverseSession(
+            traverseSession, this, prevWordCodePoints, prevWordLength);
+    return mTypingSuggest->speculateNextInput(proximityInfo, traverseSession, xcoordinates,
+            ycoordinates, times, pointerIds, inputCodePoints, inputSize, maxStepCount);
+}
+
+// Compares the code points of two queries packed at [offsets[i], offsets[i + 1]).
+static int compareCodePoints(const int *const offsets, const int *const codePoints,
+        const int left, const int right) {
+    const int leftLength = offsets[left + 1] - offsets[left];
+    const int rightLength = offsets[right + 1] - offsets[right];
+    const int minLength = leftLength < rightLength ? leftLength : rightLength;
+    for (int i = 0; i < minLength; ++i) {
+        const int diff = codePoints[offsets[left] + i] - codePoints[offsets[right] + i];
+        if (diff != 0) {
+            return diff;
+        }
+    }
+    return leftLength - rightLength;
+}
+
+void Dictionary::getSuggestionsBatch(ProximityInfo *proximityInfo, void *traverseSession,
+        const int batchSize, const int *const inputOffsets, const int *const inputCodePoints,
+        const int *const xcoordinates, const int *const ycoordinates,
+        const int *const prevWordOffsets, const int *const prevWordCodePoints,
+        bool useFullEditDistance, int *outWords, int *frequencies, int *spaceIndices,
+        int *outputTypes, int *outputCounts) const {
+    for (int i = 0; i < batchSize; ++i) {
+        outputCounts[i] = 0;
+    }
+    for (int i = 0; i < batchSize; ++i) {
+        if (inputOffsets[i] < 0 || inputOffsets[i] > inputOffsets[i + 1]
+                || prevWordOffsets[i] < 0 || prevWordOffsets[i] > prevWordOffsets[i + 1]) {
+            AKLOGE("Invalid offsets of query %d: %d, %d, %d, %d", i, inputOffsets[i],
+                    inputOffsets[i + 1], prevWordOffsets[i], prevWordOffsets[i + 1]);
+            ASSERT(false);
+            return;
+        }
+    }
+    // Queries are processed in the order of their previous word and input, so that queries
+    // sharing a prefix follow each other and the session resumes the search of the previous
+    // one from its cached frontier instead of traversing the same part of the trie again.
+    int order[batchSize];
+    for (int i = 0; i < batchSize; ++i) {
+        int j = i;
+        for (; j > 0; --j) {
+            int diff = compareCodePoints(prevWordOffsets, prevWordCodePoints, order[j - 1], i);
+            if (diff == 0) {
+                diff = compareCodePoints(inputOffsets, inputCodePoints, order[j - 1], i);
+            }
+            if (diff <= 0) {
+                break;
+            }
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+
+    int queryCodePoints[MAX_WORD_LENGTH];
+    int queryXs[MAX_WORD_LENGTH];
+    int queryYs[MAX_WORD_LENGTH];
+    int queryTimes[MAX_WORD_LENGTH];
+    int queryPointerIds[MAX_WORD_LENGTH];
+    int queryPrevWord[MAX_WORD_LENGTH];
+    memset(queryTimes, 0, sizeof(queryTimes));
+    memset(queryPointerIds, 0, sizeof(queryPointerIds));
+    for (int i = 0; i < batchSize; ++i) {
+        const int query = order[i];
+        const int inputStart = inputOffsets[query];
+        const int inputSize = inputOffsets[query + 1] - inputStart;
+        const int prevWordStart = prevWordOffsets[query];
+        const int prevWordLength = prevWordOffsets[query + 1] - prevWordStart;
+        if (inputSize < 0 || inputSize >= MAX_WORD_LENGTH || prevWordLength < 0
+                || prevWordLength > MAX_WORD_LENGTH) {
+            AKLOGE("Invalid query %d: inputSize %d, prevWordLength %d", query, inputSize,
+                    prevWordLength);
+            ASSERT(false);
+            continue;
+        }
+        for (int j = 0; j < MAX_WORD_LENGTH; ++j) {
+            queryCodePoints[j] = j < inputSize ? inputCodePoints[inputStart + j] : NOT_A_CODE_POINT;
+        }
+        memcpy(queryXs, xcoordinates + inputStart, sizeof(queryXs[0]) * inputSize);
+        memcpy(queryYs, ycoordinates + inputStart, sizeof(queryYs[0]) * inputSize);
+        memcpy(queryPrevWord, prevWordCodePoints + prevWordStart,
+                sizeof(queryPrevWord[0]) * prevWordLength);
+        int *const prevWord = prevWordLength > 0 ? queryPrevWord : 0;
+        int *const queryOutWords = outWords + query * MAX_WORD_LENGTH * MAX_RESULTS;
+        int *const queryFrequencies = frequencies + query * MAX_RESULTS;
+        int *const querySpaceIndices = spaceIndices + query * MAX_RESULTS;
+        int *const queryOutputTypes = outputTypes + query * MAX_RESULTS;
+        if (inputSize > 0) {
+            outputCounts[query] = getSuggestions(proximityInfo, traverseSession, queryXs, queryYs,
+                    queryTimes, queryPointerIds, queryCodePoints, inputSize, prevWord,
+                    prevWordLength, 0 /* commitPoint */, false /* isGesture */,
+                    useFullEditDistance, queryOutWords, queryFrequencies, querySpaceIndices,
+                    queryOutputTypes);
+        } else {
+            outputCounts[query] = getBigrams(traverseSession, prevWord, prevWordLength,
+                    queryCodePoints, inputSize, queryOutWords, queryFrequencies,
+                    queryOutputTypes);
+        }
+    }
+}
+
+int Dictionary::getBigrams(void *traverseSession, const int *word, int length,
+        int *inputCodePoints, int inputSize, int *outWords, int *frequencies,
+        int *outputTypes) const {
     if (length <= 0) return 0;
     return mBigramDictionary->getBigrams(word, length, inputCodePoints, inputSize, outWords,
-            frequencies, outputTypes);
+            frequencies, outputTypes,
+            DicTraverseWrapper::getDicTraverseSessionBigramPredictionCache(traverseSession));
+}
+
+// Returns the bytes of the pages of buf that are in memory, mapped from a file or not.
+static int getResidentSize(const uint8_t *const buf, const int size) {
+    const intptr_t pageSize = static_cast<intptr_t>(sysconf(_SC_PAGESIZE));
+    const intptr_t start = reinterpret_cast<intptr_t>(buf) & ~(pageSize - 1);
+    const intptr_t end = reinterpret_cast<intptr_t>(buf) + size;
+    const int pageCount = static_cast<int>((end - start + pageSize - 1) / pageSize);
+    std::vector<unsigned char> residentPages(pageCount);
+    if (mincore(reinterpret_cast<void *>(start), static_cast<size_t>(end - start),
+            &residentPages[0]) != 0) {
+        AKLOGE("DICT: Failure in mincore. errno=%d", errno);
+        return 0;
+    }
+    int residentPageCount = 0;
+    for (int i = 0; i < pageCount; ++i) {
+        residentPageCount += residentPages[i] & 1;
+    }
+    return residentPageCount * static_cast<int>(pageSize);
+}
+
+void Dictionary::addMemoryUsage(int *const usage) const {
+    usage[MEMORY_USAGE_DICTIONARY_MAPPED] += mDictSize;
+    if (mDictSize > 0) {
+        usage[MEMORY_USAGE_DICTIONARY_RESIDENT] += getResidentSize(mDict, mDictSize);
+    }
+    int indexSize = static_cast<int>(sizeof(*this) + sizeof(*mHeader) + sizeof(*mUnigramDictionary)
+            + sizeof(*mBigramDictionary));
+    if (mDecodedNodeIndex) indexSize += mDecodedNodeIndex->getMemorySize();
+    if (mTerminalPositionIndex) indexSize += mTerminalPositionIndex->getMemorySize();
+    if (mWordAddressIndex) indexSize += mWordAddressIndex->getMemorySize();
+    if (mCompletionIndex) indexSize += mCompletionIndex->getMemorySize();
+    if (mBigramListIndex) indexSize += mBigramListIndex->getMemorySize();
+    if (mShortcutTable) indexSize += mShortcutTable->getMemorySize();
+    usage[MEMORY_USAGE_DICTIONARY_INDEXES] += indexSize;
 }
 
 int Dictionary::getProbability(const int *word, int length) const {
     return mUnigramDictionary->getProbability(word, length);
 }
 
+// The words are looked up with the terminal position index, so the order of the words does not
+// matter and sorting them to share the walks of their prefixes would not pay off.
+void Dictionary::getProbabilities(const int *const wordOffsets, const int *const wordCodePoints,
+        const int wordCount, int *const outProbabilities) const {
+    for (int i = 0; i < wordCount; ++i) {
+        outProbabilities[i] = mUnigramDictionary->getProbability(&wordCodePoints[wordOffsets[i]],
+                wordOffsets[i + 1] - wordOffsets[i]);
+    }
+}
+
+int Dictionary::getCompletions(const int *const prefix, const int prefixLength,
+        const int maxCount, int *const outCodePoints, int *const outProbabilities) const {
+    if (!mCompletionIndex) {
+        return 0;
+    }
+    return mCompletionIndex->getCompletions(mOffsetDict, prefix, prefixLength, maxCount,
+            outCodePoints, outProbabilities);
+}
+
 bool Dictionary::isValidBigram(const int *word1, int length1, const int *word2, int length2) const {
     return mBigramDictionary->isValidBigram(word1, length1, word2, length2);
 }
 
 int Dictionary::getDictFlags() const {
-    return mUnigramDictionary->getDictFlags();
+    return mHeader->getFlags();
+}
+
+void Dictionary::startPageWarming(const bool lockPages, const bool copyPages) {
+    if (mPageWarmer) {
+        return;
+    }
+    mPageWarmer = new DictionaryPageWarmer(mDict, mDictSize, mOffsetDict, lockPages,
+            copyPages);
+    mPageWarmer->start();
 }
 
 } // namespace latinime
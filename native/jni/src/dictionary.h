@@ -24,10 +24,20 @@
 namespace latinime {
 
 class BigramDictionary;
+class BigramListIndex;
+class CompletionIndex;
+class DecodedNodeIndex;
+class DictionaryHeader;
+class DictionaryPageWarmer;
 class ProximityInfo;
+class ShortcutTable;
 class SuggestInterface;
+class TerminalPositionIndex;
 class UnigramDictionary;
+class WordAddressIndex;
 
+// Immutable once opened. Suggestions may be requested from several threads at once as long as
+// each thread uses its own traverse session.
 class Dictionary {
  public:
     // Taken from SuggestedWords.java
@@ -46,7 +56,26 @@ class Dictionary {
     static const int KIND_FLAG_POSSIBLY_OFFENSIVE = 0x80000000;
     static const int KIND_FLAG_EXACT_MATCH = 0x40000000;
 
-    Dictionary(void *dict, int dictSize, int mmapFd, int dictBufAdjust);
+    // Taken from BinaryDictionary.java
+    static const int LOAD_OPTION_ADVISE_RANDOM = 0x1;
+    static const int LOAD_OPTION_ADVISE_WILLNEED = 0x2;
+    static const int LOAD_OPTION_PREFETCH_HOT_NODES = 0x4;
+    static const int LOAD_OPTION_LOCK_HOT_NODES = 0x8;
+    static const int LOAD_OPTION_COPY_HOT_NODES = 0x10;
+    static const int LOAD_OPTION_LOW_RAM = 0x20;
+
+    // Taken from BinaryDictionary.java
+    static const int MEMORY_USAGE_DICTIONARY_MAPPED = 0; // Bytes of the dictionary data
+    static const int MEMORY_USAGE_DICTIONARY_RESIDENT = 1; // Bytes of its pages in memory
+    static const int MEMORY_USAGE_DICTIONARY_INDEXES = 2; // Indexes, words of updatable ones
+    static const int MEMORY_USAGE_SESSION_QUEUES = 3; // DicNode queues of the sessions
+    static const int MEMORY_USAGE_SESSION_CACHES = 4; // Caches kept across calls by the sessions
+    static const int MEMORY_USAGE_SESSION_OTHERS = 5; // Input states and scratch buffers
+    static const int MEMORY_USAGE_PROXIMITY_INFO = 6;
+    static const int MEMORY_USAGE_CATEGORY_COUNT = 7;
+
+    // Only the LOAD_OPTION_LOW_RAM of loadOptions applies here; the others are for the mapping.
+    Dictionary(void *dict, int dictSize, int mmapFd, int dictBufAdjust, const int loadOptions);
 
     int getSuggestions(ProximityInfo *proximityInfo, void *traverseSession, int *xcoordinates,
             int *ycoordinates, int *times, int *pointerIds, int *inputCodePoints, int inputSize,
@@ -54,10 +83,40 @@ class Dictionary {
             bool useFullEditDistance, int *outWords, int *frequencies, int *spaceIndices,
             int *outputTypes) const;
 
-    int getBigrams(const int *word, int length, int *inputCodePoints, int inputSize, int *outWords,
-            int *frequencies, int *outputTypes) const;
+    // Prepares the typing search of the input followed by one more key in the traverse session,
+    // expanding at most maxStepCount input indices. Returns the number of expanded input indices.
+    int speculateNextInput(ProximityInfo *proximityInfo, void *traverseSession, int *xcoordinates,
+            int *ycoordinates, int *times, int *pointerIds, int *inputCodePoints, int inputSize,
+            int *prevWordCodePoints, int prevWordLength, int maxStepCount) const;
+
+    int getBigrams(void *traverseSession, const int *word, int length, int *inputCodePoints,
+            int inputSize, int *outWords, int *frequencies, int *outputTypes) const;
+
+    // Gets the typing suggestions of batchSize inputs with one traverse session. The inputs of
+    // query i are at [inputOffsets[i], inputOffsets[i + 1]) of the packed input arrays and its
+    // previous word at [prevWordOffsets[i], prevWordOffsets[i + 1]) of prevWordCodePoints. The
+    // results of query i are written to the i-th block of MAX_RESULTS suggestions of the output
+    // arrays and their count to outputCounts[i]. No query is searched if the offsets of one of
+    // them are not in order.
+    void getSuggestionsBatch(ProximityInfo *proximityInfo, void *traverseSession,
+            const int batchSize, const int *const inputOffsets, const int *const inputCodePoints,
+            const int *const xcoordinates, const int *const ycoordinates,
+            const int *const prevWordOffsets, const int *const prevWordCodePoints,
+            bool useFullEditDistance, int *outWords, int *frequencies, int *spaceIndices,
+            int *outputTypes, int *outputCounts) const;
 
     int getProbability(const int *word, int length) const;
+    // Writes the probability of each of the wordCount words at [wordOffsets[i],
+    // wordOffsets[i + 1]) of wordCodePoints, as getProbability does.
+    void getProbabilities(const int *const wordOffsets, const int *const wordCodePoints,
+            const int wordCount, int *const outProbabilities) const;
+    // Writes the at most maxCount most probable words that start with the prefix, the prefix
+    // included, by decreasing probability, each at i * MAX_WORD_LENGTH of outCodePoints and
+    // terminated by 0 if shorter, and returns their count. The probability overlay is ignored.
+    // There are none without USE_COMPLETION_INDEX or for a dictionary opened with
+    // LOAD_OPTION_LOW_RAM, which have no index.
+    int getCompletions(const int *const prefix, const int prefixLength, const int maxCount,
+            int *const outCodePoints, int *const outProbabilities) const;
     bool isValidBigram(const int *word1, int length1, const int *word2, int length2) const;
     const uint8_t *getDict() const { // required to release dictionary buffer
         return mDict;
@@ -65,15 +124,38 @@ class Dictionary {
     const uint8_t *getOffsetDict() const {
         return mOffsetDict;
     }
+    // Unique in the process, unlike the address, which a dictionary opened after another one was
+    // deleted may reuse. Sessions compare it to know when their caches refer to another dictionary.
+    int getId() const { return mId; }
     int getDictSize() const { return mDictSize; }
     int getMmapFd() const { return mMmapFd; }
     int getDictBufAdjust() const { return mDictBufAdjust; }
     int getDictFlags() const;
+    // The header parsed when the dictionary was opened.
+    const DictionaryHeader *getHeader() const { return mHeader; }
+    // Reads the header and the first levels of the trie on a background thread, moves their pages
+    // to anonymous memory if copyPages is true, and locks them in memory if lockPages is true.
+    // Stopped when the dictionary is deleted. copyPages requires a mapped dictionary.
+    void startPageWarming(const bool lockPages, const bool copyPages);
+    // Returns the decoded char groups of the dictionary, or 0 if they are not available.
+    const DecodedNodeIndex *getDecodedNodeIndex() const { return mDecodedNodeIndex; }
+    const TerminalPositionIndex *getTerminalPositionIndex() const {
+        return mTerminalPositionIndex;
+    }
+    // Returns the sorted bigrams of the dictionary, or 0 if they are not available.
+    const BigramListIndex *getBigramListIndex() const { return mBigramListIndex; }
+    // Returns the decoded shortcut targets of the dictionary, or 0 if they are not available.
+    const ShortcutTable *getShortcutTable() const { return mShortcutTable; }
+    // Adds the bytes of the dictionary to the MEMORY_USAGE_DICTIONARY_* categories of usage.
+    // Finding the resident pages walks the page table of the data, so this is not for every call.
+    void addMemoryUsage(int *const usage) const;
     virtual ~Dictionary();
 
  private:
     DISALLOW_IMPLICIT_CONSTRUCTORS(Dictionary);
+    const int mId;
     const uint8_t *mDict;
+    const DictionaryHeader *const mHeader;
     const uint8_t *mOffsetDict;
 
     // Used only for the mmap version of dictionary loading, but we use these as dummy variables
@@ -82,10 +164,17 @@ class Dictionary {
     const int mMmapFd;
     const int mDictBufAdjust;
 
+    const DecodedNodeIndex *const mDecodedNodeIndex;
+    const TerminalPositionIndex *const mTerminalPositionIndex;
+    const WordAddressIndex *const mWordAddressIndex;
+    const CompletionIndex *const mCompletionIndex;
+    const BigramListIndex *const mBigramListIndex;
+    const ShortcutTable *const mShortcutTable;
     const UnigramDictionary *mUnigramDictionary;
     const BigramDictionary *mBigramDictionary;
-    SuggestInterface *mGestureSuggest;
-    SuggestInterface *mTypingSuggest;
+    const SuggestInterface *const mGestureSuggest;
+    const SuggestInterface *const mTypingSuggest;
+    DictionaryPageWarmer *mPageWarmer;
 };
 } // namespace latinime
 #endif // LATINIME_DICTIONARY_H
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: dictionary_heat_map.cpp"
+
+#include "dictionary_heat_map.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <pthread.h>
+#include <utility>
+#include <vector>
+
+#include "hash_map_compat.h"
+
+namespace latinime {
+
+namespace {
+
+pthread_mutex_t sCountsMutex = PTHREAD_MUTEX_INITIALIZER;
+hash_map_compat<int, int> sCounts;
+int sSamplingInterval = 1;
+int sRecordedReadCount = 0;
+// Decremented without a lock by the reads of all the threads. A race may take or skip a sample
+// twice, which only blurs the sampling.
+volatile int sReadsToNextSample = 1;
+
+} // namespace
+
+const uint8_t *volatile DictionaryHeatMap::sDicRoot = 0;
+
+/* static */ void DictionaryHeatMap::start(const uint8_t *const dicRoot,
+        const int samplingInterval) {
+    pthread_mutex_lock(&sCountsMutex);
+    sCounts.clear();
+    sSamplingInterval = samplingInterval > 1 ? samplingInterval : 1;
+    sRecordedReadCount = 0;
+    sReadsToNextSample = sSamplingInterval;
+    sDicRoot = dicRoot;
+    pthread_mutex_unlock(&sCountsMutex);
+}
+
+/* static */ void DictionaryHeatMap::stop() {
+    pthread_mutex_lock(&sCountsMutex);
+    sDicRoot = 0;
+    pthread_mutex_unlock(&sCountsMutex);
+}
+
+/* static */ void DictionaryHeatMap::stopIfRecording(const uint8_t *const dicRoot) {
+    pthread_mutex_lock(&sCountsMutex);
+    if (sDicRoot == dicRoot) {
+        sDicRoot = 0;
+    }
+    pthread_mutex_unlock(&sCountsMutex);
+}
+
+/* static */ bool DictionaryHeatMap::write(const char *const path) {
+    pthread_mutex_lock(&sCountsMutex);
+    std::vector<std::pair<int, int> > counts(sCounts.begin(), sCounts.end());
+    const int samplingInterval = sSamplingInterval;
+    const int recordedReadCount = sRecordedReadCount;
+    pthread_mutex_unlock(&sCountsMutex);
+    std::sort(counts.begin(), counts.end());
+    FILE *const file = fopen(path, "w");
+    if (!file) {
+        AKLOGE("Cannot open the heat map file %s.", path);
+        return false;
+    }
+    fprintf(file, "# LatinIME dictionary heat map\n");
+    fprintf(file, "# samplingInterval %d\n", samplingInterval);
+    fprintf(file, "# sampledReads %d\n", recordedReadCount);
+    for (std::vector<std::pair<int, int> >::const_iterator it = counts.begin();
+            it != counts.end(); ++it) {
+        fprintf(file, "%d %d\n", it->first, it->second);
+    }
+    const bool written = !ferror(file);
+    return (fclose(file) == 0) && written;
+}
+
+/* static */ void DictionaryHeatMap::recordSampledRead(const int pos) {
+    if (--sReadsToNextSample > 0) {
+        return;
+    }
+    sReadsToNextSample = sSamplingInterval;
+    pthread_mutex_lock(&sCountsMutex);
+    // Recording may have been stopped since the root was compared.
+    if (sDicRoot) {
+        ++sCounts[pos];
+        ++sRecordedReadCount;
+    }
+    pthread_mutex_unlock(&sCountsMutex);
+}
+} // namespace latinime
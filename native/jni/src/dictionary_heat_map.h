@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_DICTIONARY_HEAT_MAP_H
+#define LATINIME_DICTIONARY_HEAT_MAP_H
+
+#include <stdint.h>
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * Process-wide recorder of the char groups of one dictionary that are read during real use, so
+ * that the locality of the accesses to the trie can be studied offline with "dicttool heatmap".
+ * Enabled at runtime only. One in samplingInterval reads is counted by position: the char group
+ * arrays expanded by the searches, whichever cache served them, and the bigram lists read for
+ * the previous words. The positions are relative to the start of the trie, after the header.
+ * When it is disabled a read only costs comparing the root of its dictionary to a pointer.
+ * Thread safe.
+ */
+class DictionaryHeatMap {
+ public:
+    // Starts recording the reads of the trie at dicRoot and clears the counts of the previous
+    // recording of any dictionary.
+    static void start(const uint8_t *const dicRoot, const int samplingInterval);
+    // Stops recording. The counts are kept until they are written or a recording is started.
+    static void stop();
+    // Stops recording if the trie at dicRoot is recorded, e.g. because it is about to be unmapped.
+    static void stopIfRecording(const uint8_t *const dicRoot);
+    // Writes the counts to the text file at path: lines starting with '#' are comments, the others
+    // are "<position> <count>" by increasing position. Returns whether the file was written.
+    static bool write(const char *const path);
+
+    static AK_FORCE_INLINE void recordRead(const uint8_t *const dicRoot, const int pos) {
+        if (dicRoot == sDicRoot) {
+            recordSampledRead(pos);
+        }
+    }
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(DictionaryHeatMap);
+
+    static void recordSampledRead(const int pos);
+
+    // The trie whose reads are recorded, or 0. Read without a lock by every read, hence volatile.
+    static const uint8_t *volatile sDicRoot;
+};
+} // namespace latinime
+#endif // LATINIME_DICTIONARY_HEAT_MAP_H
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "LatinIME: dictionary_page_warmer.cpp"
+
+#include "dictionary_page_warmer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "binary_format.h"
+#include "suggest/core/dicnode/dic_node_utils.h"
+#include "thread_placement.h"
+
+namespace latinime {
+
+// The root, the first letters and the first bigrams of letters: the nodes every search expands.
+const int DictionaryPageWarmer::HOT_LEVEL_COUNT = 3;
+
+DictionaryPageWarmer::DictionaryPageWarmer(const uint8_t *const dict, const int dictSize,
+        const uint8_t *const offsetDict, const bool lockPages, const bool copyPages)
+        : mDict(dict), mDictSize(dictSize), mOffsetDict(offsetDict),
+          mOffsetDictSize(dictSize - static_cast<int>(offsetDict - dict)), mLockPages(lockPages),
+          mCopyPages(copyPages), mPageSize(static_cast<int>(sysconf(_SC_PAGESIZE))), mMutex(),
+          mThread(), mIsRunning(false), mIsStopRequested(false), mPagesRead(), mLockedPages(),
+          mChecksum(0) {
+    pthread_mutex_init(&mMutex, 0);
+}
+
+DictionaryPageWarmer::~DictionaryPageWarmer() {
+    if (mIsRunning) {
+        pthread_mutex_lock(&mMutex);
+        mIsStopRequested = true;
+        pthread_mutex_unlock(&mMutex);
+        pthread_join(mThread, 0);
+    }
+    const uintptr_t pageMask = static_cast<uintptr_t>(mPageSize - 1);
+    uint8_t *const firstPage = reinterpret_cast<uint8_t *>(
+            reinterpret_cast<uintptr_t>(mDict) & ~pageMask);
+    for (int i = 0; i < static_cast<int>(mLockedPages.size()); i += 2) {
+        munlock(firstPage + mLockedPages[i] * mPageSize, mLockedPages[i + 1] * mPageSize);
+    }
+    pthread_mutex_destroy(&mMutex);
+}
+
+void DictionaryPageWarmer::start() {
+    if (mIsRunning || mPageSize <= 0) {
+        return;
+    }
+    mIsRunning = ThreadPlacement::createThread(&mThread, ThreadPlacement::THREAD_CLASS_BACKGROUND,
+            threadMain, this);
+    if (!mIsRunning) {
+        AKLOGE("Can't start warming the dictionary pages. errno=%d", errno);
+    }
+}
+
+/* static */ void *DictionaryPageWarmer::threadMain(void *warmer) {
+    static_cast<DictionaryPageWarmer *>(warmer)->warmPages();
+    return 0;
+}
+
+bool DictionaryPageWarmer::isStopRequested() {
+    pthread_mutex_lock(&mMutex);
+    const bool isStopRequested = mIsStopRequested;
+    pthread_mutex_unlock(&mMutex);
+    return isStopRequested;
+}
+
+void DictionaryPageWarmer::warmPages() {
+    const int pageOffset = static_cast<int>(
+            reinterpret_cast<uintptr_t>(mDict) & static_cast<uintptr_t>(mPageSize - 1));
+    mPagesRead.assign((pageOffset + mDictSize + mPageSize - 1) / mPageSize, false);
+    const int headerSize = mDictSize - mOffsetDictSize;
+    markPages(0, headerSize);
+
+    // Children arrays of the current level, as pairs of (position of the first group, count)
+    std::vector<int> arrays;
+    int rootPos = 0;
+    const int rootCount = BinaryFormat::getGroupCountAndForwardPointer(mOffsetDict, &rootPos);
+    arrays.push_back(rootPos);
+    arrays.push_back(rootCount);
+    std::vector<int> nextArrays;
+    DicNodeChildrenCache::DecodedChild child;
+    int subword[MAX_WORD_LENGTH];
+    for (int level = 0; level < HOT_LEVEL_COUNT && !arrays.empty(); ++level) {
+        nextArrays.clear();
+        for (int i = 0; i < static_cast<int>(arrays.size()); i += 2) {
+            if (isStopRequested()) {
+                return;
+            }
+            int pos = arrays[i];
+            for (int j = 0; j < arrays[i + 1] && pos < mOffsetDictSize; ++j) {
+                const int groupPos = pos;
+                pos = DicNodeUtils::readChildGroup(mOffsetDict, pos, &child, subword);
+                markPages(headerSize + groupPos, headerSize + pos);
+                if (child.mChildrenCount > 0 && child.mChildrenPos < mOffsetDictSize) {
+                    nextArrays.push_back(child.mChildrenPos);
+                    nextArrays.push_back(child.mChildrenCount);
+                }
+            }
+        }
+        arrays.swap(nextArrays);
+    }
+    if (mCopyPages) {
+        copyMarkedPages();
+    }
+    if (mLockPages) {
+        lockMarkedPages();
+    }
+    AKLOGI("Warmed the dictionary pages. checksum=%d", mChecksum);
+}
+
+// Marks the pages of [begin, end) in the dictionary as read, reading one byte of each new page.
+void DictionaryPageWarmer::markPages(const int begin, const int end) {
+    if (begin >= end) {
+        return;
+    }
+    const int pageOffset = static_cast<int>(
+            reinterpret_cast<uintptr_t>(mDict) & static_cast<uintptr_t>(mPageSize - 1));
+    const int lastPage = min(pageOffset + end - 1, pageOffset + mDictSize - 1) / mPageSize;
+    for (int page = (pageOffset + begin) / mPageSize; page <= lastPage; ++page) {
+        if (mPagesRead[page]) {
+            continue;
+        }
+        mPagesRead[page] = true;
+        const int offset = max(page * mPageSize - pageOffset, 0);
+        mChecksum += mDict[offset];
+    }
+}
+
+// Replaces each range of marked pages with an anonymous copy. The searches may be reading the
+// pages meanwhile, so the copy is filled elsewhere and moved over the range by one mremap, which
+// the readers see as either the old or the new page. The 5 argument mremap is called through
+// syscall as the older C libraries of Android only declare 4 arguments.
+void DictionaryPageWarmer::copyMarkedPages() {
+    const uintptr_t pageMask = static_cast<uintptr_t>(mPageSize - 1);
+    uint8_t *const firstPage = reinterpret_cast<uint8_t *>(
+            reinterpret_cast<uintptr_t>(mDict) & ~pageMask);
+    const int pageCount = static_cast<int>(mPagesRead.size());
+    int copiedPageCount = 0;
+    for (int page = 0; page < pageCount; ) {
+        if (!mPagesRead[page]) {
+            ++page;
+            continue;
+        }
+        const int first = page;
+        while (page < pageCount && mPagesRead[page]) {
+            ++page;
+        }
+        uint8_t *const target = firstPage + first * mPageSize;
+        const size_t length = static_cast<size_t>((page - first) * mPageSize);
+        void *const copy = mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                -1, 0);
+        if (copy == MAP_FAILED) {
+            AKLOGI("Can't copy the dictionary pages. errno=%d", errno);
+            return;
+        }
+        memcpy(copy, target, length);
+        if (mprotect(copy, length, PROT_READ) != 0
+                || reinterpret_cast<void *>(syscall(__NR_mremap, copy, length, length,
+                        MREMAP_MAYMOVE | MREMAP_FIXED, target)) != target) {
+            AKLOGI("Can't move the copied dictionary pages. errno=%d", errno);
+            munmap(copy, length);
+            return;
+        }
+        copiedPageCount += page - first;
+    }
+    AKLOGI("Copied the dictionary pages. count=%d", copiedPageCount);
+}
+
+void DictionaryPageWarmer::lockMarkedPages() {
+    const uintptr_t pageMask = static_cast<uintptr_t>(mPageSize - 1);
+    uint8_t *const firstPage = reinterpret_cast<uint8_t *>(
+            reinterpret_cast<uintptr_t>(mDict) & ~pageMask);
+    const int pageCount = static_cast<int>(mPagesRead.size());
+    for (int page = 0; page < pageCount; ) {
+        if (!mPagesRead[page]) {
+            ++page;
+            continue;
+        }
+        const int first = page;
+        while (page < pageCount && mPagesRead[page]) {
+            ++page;
+        }
+        if (mlock(firstPage + first * mPageSize, (page - first) * mPageSize) != 0) {
+            // Usually RLIMIT_MEMLOCK. The pages stay read, just not locked.
+            AKLOGI("Can't lock the dictionary pages. errno=%d", errno);
+            return;
+        }
+        mLockedPages.push_back(first);
+        mLockedPages.push_back(page - first);
+    }
+}
+} // namespace latinime
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LATINIME_DICTIONARY_PAGE_WARMER_H
+#define LATINIME_DICTIONARY_PAGE_WARMER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * Reads the header and the first levels of the trie of a mapped dictionary on a background
+ * thread, so that the first keystrokes after a cold start do not wait for these pages to be read
+ * from storage. Optionally locks the pages it read in memory.
+ *
+ * Optionally moves the pages it read to anonymous memory first: they are copied and the copies
+ * replace the mapped pages at the same addresses, so that the reads of the dictionary are served
+ * by them with no change. The page cache can drop the pages of a file under memory pressure, and
+ * then the first search after the IME comes back to the foreground reads them from storage again.
+ * The copies are only swapped out, and not at all when they are locked too.
+ */
+class DictionaryPageWarmer {
+ public:
+    DictionaryPageWarmer(const uint8_t *const dict, const int dictSize,
+            const uint8_t *const offsetDict, const bool lockPages, const bool copyPages);
+    // Stops reading if it has not finished yet, and unlocks the locked pages.
+    // Non virtual destructor -- never inherit this class
+    ~DictionaryPageWarmer();
+
+    void start();
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(DictionaryPageWarmer);
+    // The depth of the trie to read, the root being at depth 1
+    static const int HOT_LEVEL_COUNT;
+
+    static void *threadMain(void *warmer);
+    void warmPages();
+    bool isStopRequested();
+    void markPages(const int begin, const int end);
+    void copyMarkedPages();
+    void lockMarkedPages();
+
+    const uint8_t *const mDict;
+    const int mDictSize;
+    const uint8_t *const mOffsetDict;
+    const int mOffsetDictSize;
+    const bool mLockPages;
+    const bool mCopyPages;
+    const int mPageSize;
+    pthread_mutex_t mMutex;
+    pthread_t mThread;
+    bool mIsRunning;
+    bool mIsStopRequested;
+    // Whether each page of the dictionary has been read
+    std::vector<bool> mPagesRead;
+    // Locked ranges, as pairs of (first page, page count)
+    std::vector<int> mLockedPages;
+    // Sum of the bytes read, so that reads cannot be optimized away
+    int mChecksum;
+};
+} // namespace latinime
+#endif // LATINIME_DICTIONARY_PAGE_WARMER_H
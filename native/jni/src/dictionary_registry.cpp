@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: dictionary_registry.cpp"
+
+#include "dictionary_registry.h"
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace latinime {
+
+struct RegisteredDictionary {
+    RegisteredDictionary(const char *const path, const struct stat *const fileStat,
+            const long offset, const long size, Dictionary *const dictionary)
+            : mPath(path), mDevice(fileStat->st_dev), mInode(fileStat->st_ino),
+              mModificationTime(fileStat->st_mtime), mOffset(offset), mSize(size),
+              mDictionary(dictionary), mRefCount(1) {}
+
+    std::string mPath;
+    // The file at mPath when it was opened. A file written again is usually renamed over the
+    // previous one, so it has another inode, and otherwise a later modification time.
+    dev_t mDevice;
+    ino_t mInode;
+    time_t mModificationTime;
+    long mOffset;
+    long mSize;
+    Dictionary *mDictionary;
+    int mRefCount;
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(RegisteredDictionary);
+};
+
+// A process only opens a handful of dictionaries, so a linear search is enough.
+static pthread_mutex_t sRegistryMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<RegisteredDictionary *> sRegisteredDictionaries;
+
+// Must be called with sRegistryMutex held.
+static RegisteredDictionary *findLocked(const char *const path,
+        const struct stat *const fileStat, const long offset, const long size) {
+    for (int i = 0; i < static_cast<int>(sRegisteredDictionaries.size()); ++i) {
+        RegisteredDictionary *const entry = sRegisteredDictionaries[i];
+        if (entry->mOffset == offset && entry->mSize == size
+                && entry->mInode == fileStat->st_ino && entry->mDevice == fileStat->st_dev
+                && entry->mModificationTime == fileStat->st_mtime && entry->mPath == path) {
+            return entry;
+        }
+    }
+    return 0;
+}
+
+/* static */ Dictionary *DictionaryRegistry::acquire(const char *const path,
+        const struct stat *const fileStat, const long offset, const long size) {
+    pthread_mutex_lock(&sRegistryMutex);
+    RegisteredDictionary *const entry = findLocked(path, fileStat, offset, size);
+    Dictionary *dictionary = 0;
+    if (entry) {
+        ++entry->mRefCount;
+        dictionary = entry->mDictionary;
+    }
+    pthread_mutex_unlock(&sRegistryMutex);
+    return dictionary;
+}
+
+/* static */ Dictionary *DictionaryRegistry::add(const char *const path,
+        const struct stat *const fileStat, const long offset, const long size,
+        Dictionary *const dictionary) {
+    pthread_mutex_lock(&sRegistryMutex);
+    RegisteredDictionary *const entry = findLocked(path, fileStat, offset, size);
+    Dictionary *registeredDictionary = dictionary;
+    if (entry) {
+        ++entry->mRefCount;
+        registeredDictionary = entry->mDictionary;
+    } else {
+        sRegisteredDictionaries.push_back(
+                new RegisteredDictionary(path, fileStat, offset, size, dictionary));
+    }
+    pthread_mutex_unlock(&sRegistryMutex);
+    return registeredDictionary;
+}
+
+/* static */ bool DictionaryRegistry::release(const Dictionary *const dictionary) {
+    pthread_mutex_lock(&sRegistryMutex);
+    bool isLastReference = true;
+    for (int i = 0; i < static_cast<int>(sRegisteredDictionaries.size()); ++i) {
+        RegisteredDictionary *const entry = sRegisteredDictionaries[i];
+        if (entry->mDictionary != dictionary) {
+            continue;
+        }
+        --entry->mRefCount;
+        if (entry->mRefCount > 0) {
+            isLastReference = false;
+        } else {
+            delete entry;
+            sRegisteredDictionaries.erase(sRegisteredDictionaries.begin() + i);
+        }
+        break;
+    }
+    pthread_mutex_unlock(&sRegistryMutex);
+    return isLastReference;
+}
+} // namespace latinime
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_DICTIONARY_REGISTRY_H
+#define LATINIME_DICTIONARY_REGISTRY_H
+
+#include <sys/stat.h>
+
+#include "defines.h"
+
+namespace latinime {
+
+class Dictionary;
+
+/**
+ * Process-wide table of the opened dictionaries, keyed by (path, offset, size) and by the
+ * device, inode and modification time of the file, so that the IME and each spell checker
+ * session opening the same file share one mapping and one set of dictionary objects, while a
+ * file rewritten at the same path, e.g. by ExpandableBinaryDictionary, is opened again even if
+ * its size did not change. Dictionaries are reference counted. Thread safe.
+ */
+class DictionaryRegistry {
+ public:
+    // Returns the dictionary opened from this part of the file with one more reference, or 0.
+    // fileStat is the stat of the file at path, taken before it is opened.
+    static Dictionary *acquire(const char *const path, const struct stat *const fileStat,
+            const long offset, const long size);
+    // Registers a dictionary just opened with one reference. If another thread registered the same
+    // file in the meantime, returns that dictionary with one more reference instead, and the
+    // caller must release the one it opened.
+    static Dictionary *add(const char *const path, const struct stat *const fileStat,
+            const long offset, const long size, Dictionary *const dictionary);
+    // Drops a reference. Returns true if it was the last one, after which the caller must delete
+    // the dictionary and release its buffer. Dictionaries never registered are always the last.
+    static bool release(const Dictionary *const dictionary);
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(DictionaryRegistry);
+};
+} // namespace latinime
+#endif // LATINIME_DICTIONARY_REGISTRY_H
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_DIGRAPH_CODE_POINT_SET_H
+#define LATINIME_DIGRAPH_CODE_POINT_SET_H
+
+#include <cstring>
+#include <stdint.h>
+
+#include "char_utils.h"
+#include "defines.h"
+#include "digraph_utils.h"
+
+namespace latinime {
+
+/**
+ * The code points that the digraphs of a dictionary are typed for, e.g. 'ä' and 'Ä' typed as "ae"
+ * with a German dictionary, as a bitmap. The composite glyphs of all the digraphs and their upper
+ * cases are below MAX_CODE_POINT, so the test of a dictionary letter is a single load.
+ */
+class DigraphCodePointSet {
+ public:
+    AK_FORCE_INLINE DigraphCodePointSet()
+            : mDictFlags(0), mIsEmpty(true), mBits() {}
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~DigraphCodePointSet() {}
+
+    // Rebuilds the set for the digraphs of the dictionary flags if they changed.
+    AK_FORCE_INLINE void setDictFlags(const int dictFlags) {
+        if (dictFlags == mDictFlags) {
+            return;
+        }
+        mDictFlags = dictFlags;
+        memset(mBits, 0, sizeof(mBits));
+        const DigraphUtils::digraph_t *digraphs = 0;
+        const int digraphCount =
+                DigraphUtils::getAllDigraphsForDictionaryAndReturnSize(dictFlags, &digraphs);
+        mIsEmpty = digraphCount <= 0;
+        // Like DigraphUtils::hasDigraphForCodePoint, the code points are lower cased.
+        for (int codePoint = 0; codePoint < MAX_CODE_POINT; ++codePoint) {
+            const int lowerCodePoint = toLowerCase(codePoint);
+            for (int i = 0; i < digraphCount; ++i) {
+                if (digraphs[i].compositeGlyph == lowerCodePoint) {
+                    mBits[codePoint >> 5] |= 1U << (codePoint & 31);
+                }
+            }
+        }
+    }
+
+    // True if the dictionary has no digraphs, so that no code point needs to be tested.
+    AK_FORCE_INLINE bool isEmpty() const {
+        return mIsEmpty;
+    }
+
+    AK_FORCE_INLINE bool contains(const int codePoint) const {
+        return codePoint >= 0 && codePoint < MAX_CODE_POINT
+                && (mBits[codePoint >> 5] & (1U << (codePoint & 31))) != 0;
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(DigraphCodePointSet);
+
+    // Past the end of Latin Extended-A, which has U+0152 LATIN CAPITAL LIGATURE OE
+    static const int MAX_CODE_POINT = 0x180;
+
+    int mDictFlags;
+    bool mIsEmpty;
+    uint32_t mBits[MAX_CODE_POINT / 32];
+};
+} // namespace latinime
+#endif // LATINIME_DIGRAPH_CODE_POINT_SET_H
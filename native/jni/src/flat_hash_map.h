@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_FLAT_HASH_MAP_H
+#define LATINIME_FLAT_HASH_MAP_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "memory_utils.h"
+
+namespace latinime {
+
+/**
+ * A map from int keys to values as an open addressing table with linear probing, for the small
+ * maps of the hot paths that a node based hash_map would allocate an entry for each key of. The
+ * first INLINE_SLOT_COUNT slots are inside the map, so that a map of a few keys never allocates,
+ * and the table moves to the heap when it is three quarters full. Clearing keeps the table.
+ * INLINE_SLOT_COUNT must be a power of 2.
+ *
+ * The slots are visited in no particular order by iterating the slot indices below
+ * getSlotCount() that isUsedSlot() accepts.
+ */
+template<typename ValueT, int INLINE_SLOT_COUNT>
+class FlatHashMap {
+ public:
+    FlatHashMap()
+            : mInlineSlots(), mHeapSlots(), mSlots(mInlineSlots), mSlotCount(INLINE_SLOT_COUNT),
+              mSize(0) {}
+
+    // Non virtual inline destructor -- never inherit this class
+    ~FlatHashMap() {}
+
+    AK_FORCE_INLINE int size() const {
+        return mSize;
+    }
+
+    AK_FORCE_INLINE bool empty() const {
+        return mSize == 0;
+    }
+
+    // Returns the value of key, or 0 if the map does not have key. The value stays valid until
+    // the map is modified.
+    AK_FORCE_INLINE const ValueT *find(const int key) const {
+        const int slotIndex = findSlotIndex(key);
+        return slotIndex == NOT_AN_INDEX ? 0 : &mSlots[slotIndex].mValue;
+    }
+
+    // Sets the value of key, replacing the previous one.
+    AK_FORCE_INLINE void put(const int key, const ValueT &value) {
+        const int slotIndex = findSlotIndex(key);
+        if (slotIndex != NOT_AN_INDEX) {
+            mSlots[slotIndex].mValue = value;
+            return;
+        }
+        if ((mSize + 1) * 4 > mSlotCount * 3) {
+            rehash(mSlotCount * 2);
+        }
+        insertNewKey(key, value);
+    }
+
+    // Removes key, if present. The entries probed after it are shifted back into the hole, so
+    // that lookups never need to skip deleted slots.
+    void erase(const int key) {
+        int holeIndex = findSlotIndex(key);
+        if (holeIndex == NOT_AN_INDEX) {
+            return;
+        }
+        const int mask = mSlotCount - 1;
+        for (int i = (holeIndex + 1) & mask; mSlots[i].mIsUsed; i = (i + 1) & mask) {
+            // The entry may fill the hole if the hole is between its home slot and its slot.
+            const int homeIndex = getHomeSlotIndex(mSlots[i].mKey);
+            if (((i - homeIndex) & mask) >= ((i - holeIndex) & mask)) {
+                mSlots[holeIndex] = mSlots[i];
+                holeIndex = i;
+            }
+        }
+        mSlots[holeIndex].mIsUsed = false;
+        --mSize;
+    }
+
+    void clear() {
+        if (mSize == 0) {
+            return;
+        }
+        for (int i = 0; i < mSlotCount; ++i) {
+            mSlots[i].mIsUsed = false;
+        }
+        mSize = 0;
+    }
+
+    AK_FORCE_INLINE int getSlotCount() const {
+        return mSlotCount;
+    }
+
+    AK_FORCE_INLINE bool isUsedSlot(const int slotIndex) const {
+        return mSlots[slotIndex].mIsUsed;
+    }
+
+    AK_FORCE_INLINE int getKeyAt(const int slotIndex) const {
+        return mSlots[slotIndex].mKey;
+    }
+
+    AK_FORCE_INLINE const ValueT &getValueAt(const int slotIndex) const {
+        return mSlots[slotIndex].mValue;
+    }
+
+    // The bytes allocated for the table once it has moved to the heap. The inline slots are part
+    // of the size of the map itself.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mHeapSlots);
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(FlatHashMap);
+
+    struct Slot {
+        Slot() : mKey(0), mIsUsed(false), mValue() {}
+
+        int mKey;
+        bool mIsUsed;
+        ValueT mValue;
+    };
+
+    // Fibonacci hashing, folded into the low bits, spreads both the consecutive code points and
+    // key indices and the dictionary positions, whose low bits are not uniform.
+    AK_FORCE_INLINE int getHomeSlotIndex(const int key) const {
+        const uint32_t hash = static_cast<uint32_t>(key) * 2654435769U;
+        return static_cast<int>(hash ^ (hash >> 16)) & (mSlotCount - 1);
+    }
+
+    AK_FORCE_INLINE int findSlotIndex(const int key) const {
+        const int mask = mSlotCount - 1;
+        for (int i = getHomeSlotIndex(key); mSlots[i].mIsUsed; i = (i + 1) & mask) {
+            if (mSlots[i].mKey == key) {
+                return i;
+            }
+        }
+        return NOT_AN_INDEX;
+    }
+
+    AK_FORCE_INLINE void insertNewKey(const int key, const ValueT &value) {
+        const int mask = mSlotCount - 1;
+        int i = getHomeSlotIndex(key);
+        while (mSlots[i].mIsUsed) {
+            i = (i + 1) & mask;
+        }
+        mSlots[i].mKey = key;
+        mSlots[i].mIsUsed = true;
+        mSlots[i].mValue = value;
+        ++mSize;
+    }
+
+    void rehash(const int slotCount) {
+        std::vector<Slot> oldHeapSlots;
+        oldHeapSlots.swap(mHeapSlots);
+        const Slot *const oldSlots = mSlots;
+        const int oldSlotCount = mSlotCount;
+        mHeapSlots.resize(slotCount);
+        mSlots = &mHeapSlots[0];
+        mSlotCount = slotCount;
+        mSize = 0;
+        for (int i = 0; i < oldSlotCount; ++i) {
+            if (oldSlots[i].mIsUsed) {
+                insertNewKey(oldSlots[i].mKey, oldSlots[i].mValue);
+            }
+        }
+    }
+
+    Slot mInlineSlots[INLINE_SLOT_COUNT];
+    std::vector<Slot> mHeapSlots;
+    // mInlineSlots until the table grows past them, then mHeapSlots.
+    Slot *mSlots;
+    int mSlotCount;
+    int mSize;
+};
+} // namespace latinime
+#endif // LATINIME_FLAT_HASH_MAP_H
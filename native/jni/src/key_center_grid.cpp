@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "LatinIME: key_center_grid.cpp"
+
+#include "key_center_grid.h"
+
+namespace latinime {
+
+void KeyCenterGrid::init(const int keyboardWidth, const int keyboardHeight, const int cellSize,
+        const int keyCount, const float *const centerXs, const float *const centerYs,
+        const float *const gapYs) {
+    const int size = max(cellSize, 1);
+    mCellSize = static_cast<float>(size);
+    mColumnCount = max((keyboardWidth + size - 1) / size, 1);
+    mRowCount = max((keyboardHeight + size - 1) / size, 1);
+    mCellKeyMasks.assign(mColumnCount * mRowCount, 0);
+    for (int k = 0; k < keyCount; ++k) {
+        const int column = getColumn(centerXs[k]);
+        const int firstRow = getRow(min(centerYs[k], centerYs[k] + gapYs[k]));
+        const int lastRow = getRow(max(centerYs[k], centerYs[k] + gapYs[k]));
+        for (int row = firstRow; row <= lastRow; ++row) {
+            mCellKeyMasks[row * mColumnCount + column] |= 1ULL << k;
+        }
+    }
+}
+
+uint64_t KeyCenterGrid::getKeysInSquare(const float x, const float y, const float radius) const {
+    const int firstColumn = getColumn(x - radius);
+    const int lastColumn = getColumn(x + radius);
+    const int firstRow = getRow(y - radius);
+    const int lastRow = getRow(y + radius);
+    uint64_t keys = 0;
+    for (int row = firstRow; row <= lastRow; ++row) {
+        const uint64_t *const cellKeyMasks = &mCellKeyMasks[row * mColumnCount];
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            keys |= cellKeyMasks[column];
+        }
+    }
+    return keys;
+}
+
+// Points outside of the keyboard are clamped to the border cells, which keeps the order of the
+// coordinates: a key is always found in the range of cells of a square that contains its center.
+int KeyCenterGrid::getColumn(const float x) const {
+    const float column = x / mCellSize;
+    if (!(column > 0.0f)) {
+        return 0;
+    }
+    if (column >= static_cast<float>(mColumnCount - 1)) {
+        return mColumnCount - 1;
+    }
+    return static_cast<int>(column);
+}
+
+int KeyCenterGrid::getRow(const float y) const {
+    const float row = y / mCellSize;
+    if (!(row > 0.0f)) {
+        return 0;
+    }
+    if (row >= static_cast<float>(mRowCount - 1)) {
+        return mRowCount - 1;
+    }
+    return static_cast<int>(row);
+}
+} // namespace latinime
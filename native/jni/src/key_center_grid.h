@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LATINIME_KEY_CENTER_GRID_H
+#define LATINIME_KEY_CENTER_GRID_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "memory_utils.h"
+
+#if MAX_KEY_COUNT_IN_A_KEYBOARD > 64
+#error "KeyCenterGrid stores the keys of a cell in a 64-bit mask"
+#endif
+
+namespace latinime {
+
+/**
+ * A uniform grid over the keyboard that records in each cell the mask of the keys whose center
+ * may lie in it, so that the keys near a point are found by visiting the few cells around it
+ * instead of measuring the distance to every key. The center of a key moves with the vertical
+ * sweet spot scale: a key is recorded in all the cells its center crosses for scales in [0, 1].
+ */
+class KeyCenterGrid {
+ public:
+    KeyCenterGrid() : mCellSize(1.0f), mColumnCount(0), mRowCount(0), mCellKeyMasks() {}
+
+    // Non virtual inline destructor -- never inherit this class
+    ~KeyCenterGrid() {}
+
+    // The bytes allocated for the cells.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mCellKeyMasks);
+    }
+
+    // The center of key k at the vertical scale s is (centerXs[k], centerYs[k] + gapYs[k] * s).
+    void init(const int keyboardWidth, const int keyboardHeight, const int cellSize,
+            const int keyCount, const float *const centerXs, const float *const centerYs,
+            const float *const gapYs);
+
+    // Returns a mask of keys that contains all the keys whose center is within the square of
+    // half side radius around (x, y), for any vertical scale in [0, 1].
+    uint64_t getKeysInSquare(const float x, const float y, const float radius) const;
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(KeyCenterGrid);
+
+    int getColumn(const float x) const;
+    int getRow(const float y) const;
+
+    float mCellSize;
+    int mColumnCount;
+    int mRowCount;
+    std::vector<uint64_t> mCellKeyMasks;
+};
+} // namespace latinime
+#endif // LATINIME_KEY_CENTER_GRID_H
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_MEMORY_UTILS_H
+#define LATINIME_MEMORY_UTILS_H
+
+#include <vector>
+
+#include "defines.h"
+
+namespace latinime {
+class MemoryUtils {
+ public:
+    // The bytes allocated for the elements of a vector, including the retained capacity.
+    template<typename T>
+    static AK_FORCE_INLINE int getVectorMemorySize(const std::vector<T> *const elements) {
+        return static_cast<int>(elements->capacity() * sizeof(T));
+    }
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(MemoryUtils);
+};
+} // namespace latinime
+#endif // LATINIME_MEMORY_UTILS_H
@@ -14,76 +14,134 @@
  * limitations under the License.
  */
 
+
 #ifndef LATINIME_MULTI_BIGRAM_MAP_H
 #define LATINIME_MULTI_BIGRAM_MAP_H
 
 #include <cstring>
+#include <list>
 #include <stdint.h>
 
 #include "defines.h"
+#include "bigram_probability_map.h"
 #include "binary_format.h"
-#include "hash_map_compat.h"
+#include "dictionary_heat_map.h"
+#include "flat_hash_map.h"
+#include "suggest/core/session/search_statistics.h"
 
 namespace latinime {
 
 // Class for caching bigram maps for multiple previous word contexts. This is useful since the
 // algorithm needs to look up the set of bigrams for every word pair that occurs in every
-// multi-word suggestion.
+// multi-word suggestion. The maps only depend on the dictionary, so they are kept across the
+// keystrokes of a session, which probe the same previous words again, and the least recently
+// used ones are evicted when they take more than MAX_BIGRAM_MAP_CACHE_BYTE_SIZE.
 class MultiBigramMap {
  public:
-    MultiBigramMap() : mBigramMaps() {}
+    // The sizes and the evictions of the cache are counted in statistics.
+    explicit MultiBigramMap(SearchStatistics *const statistics)
+            : mStatistics(statistics), mDicRoot(0), mBigramMaps(), mBigramMapIterators(),
+              mMemorySize(0) {}
     ~MultiBigramMap() {}
 
     // Look up the bigram probability for the given word pair from the cached bigram maps.
-    // Also caches the bigrams if there is space remaining and they have not been cached already.
+    // Also caches the bigrams if they have not been cached already.
     int getBigramProbability(const uint8_t *const dicRoot, const int wordPosition,
             const int nextWordPosition, const int unigramProbability) {
-        hash_map_compat<int, BigramMap>::const_iterator mapPosition =
-                mBigramMaps.find(wordPosition);
-        if (mapPosition != mBigramMaps.end()) {
-            return mapPosition->second.getBigramProbability(nextWordPosition, unigramProbability);
-        }
-        if (mBigramMaps.size() < MAX_CACHED_PREV_WORDS_IN_BIGRAM_MAP) {
-            addBigramsForWordPosition(dicRoot, wordPosition);
-            return mBigramMaps[wordPosition].getBigramProbability(
-                    nextWordPosition, unigramProbability);
+        if (dicRoot != mDicRoot) {
+            // The cached positions are those of another dictionary.
+            clear();
+            mDicRoot = dicRoot;
         }
-        return BinaryFormat::getBigramProbability(
-                dicRoot, wordPosition, nextWordPosition, unigramProbability);
+        return getBigramMap(wordPosition)->getBigramProbability(
+                nextWordPosition, unigramProbability);
     }
 
     void clear() {
+        mDicRoot = 0;
         mBigramMaps.clear();
+        mBigramMapIterators.clear();
+        mMemorySize = 0;
     }
 
+    // The bytes of the cached maps, as counted against MAX_BIGRAM_MAP_CACHE_BYTE_SIZE.
+    int getMemorySize() const { return mMemorySize; }
+
  private:
     DISALLOW_COPY_AND_ASSIGN(MultiBigramMap);
 
     class BigramMap {
      public:
-        BigramMap() : mBigramMap(DEFAULT_HASH_MAP_SIZE_FOR_EACH_BIGRAM_MAP) {}
+        BigramMap() : mPosition(NOT_VALID_WORD), mBigramMap() {}
         ~BigramMap() {}
 
         void init(const uint8_t *const dicRoot, int position) {
-            BinaryFormat::fillBigramProbabilityToHashMap(dicRoot, position, &mBigramMap);
+            mPosition = position;
+            DictionaryHeatMap::recordRead(dicRoot, position);
+            BinaryFormat::fillBigramProbabilityMap(dicRoot, position, &mBigramMap);
         }
 
         inline int getBigramProbability(const int nextWordPosition, const int unigramProbability)
                 const {
-           return BinaryFormat::getBigramProbabilityFromHashMap(
+           return BinaryFormat::getBigramProbabilityFromMap(
                    nextWordPosition, &mBigramMap, unigramProbability);
         }
 
+        int getPosition() const { return mPosition; }
+
+        int getMemorySize() const { return mBigramMap.getMemorySize(); }
+
      private:
-        // Note: Default copy constructor needed for use in hash_map.
-        hash_map_compat<int, int> mBigramMap;
+        // Note: Default copy constructor needed for use in list.
+        int mPosition;
+        BigramProbabilityMap mBigramMap;
     };
 
-    void addBigramsForWordPosition(const uint8_t *const dicRoot, const int position) {
-        mBigramMaps[position].init(dicRoot, position);
+    // The most recently used bigram map first.
+    typedef std::list<BigramMap> BigramMapList;
+
+    const BigramMap *getBigramMap(const int position) {
+        const BigramMapList::iterator *const mapIterator = mBigramMapIterators.find(position);
+        if (mapIterator) {
+            mBigramMaps.splice(mBigramMaps.begin(), mBigramMaps, *mapIterator);
+            return &mBigramMaps.front();
+        }
+        if (!mBigramMaps.empty() && mMemorySize >= MAX_BIGRAM_MAP_CACHE_BYTE_SIZE) {
+            // Reuse the least recently used map, which keeps the capacity of its arrays.
+            mStatistics->countEviction(SearchStatistics::STATISTIC_BIGRAM_MAP_CACHE_EVICTIONS);
+            unregisterBigramMap(&mBigramMaps.back());
+            mBigramMaps.splice(mBigramMaps.begin(), mBigramMaps, --mBigramMaps.end());
+        } else {
+            mBigramMaps.push_front(BigramMap());
+        }
+        BigramMap *const bigramMap = &mBigramMaps.front();
+        bigramMap->init(mDicRoot, position);
+        mMemorySize += bigramMap->getMemorySize();
+        mBigramMapIterators.put(position, mBigramMaps.begin());
+        mStatistics->updateHighWaterMark(
+                SearchStatistics::STATISTIC_BIGRAM_MAP_CACHE_BYTES_HIGH_WATER_MARK, mMemorySize);
+        while (mMemorySize > MAX_BIGRAM_MAP_CACHE_BYTE_SIZE && &mBigramMaps.back() != bigramMap) {
+            mStatistics->countEviction(SearchStatistics::STATISTIC_BIGRAM_MAP_CACHE_EVICTIONS);
+            unregisterBigramMap(&mBigramMaps.back());
+            mBigramMaps.pop_back();
+        }
+        mStatistics->updateHighWaterMark(
+                SearchStatistics::STATISTIC_BIGRAM_MAP_CACHE_HIGH_WATER_MARK,
+                mBigramMapIterators.size());
+        return bigramMap;
+    }
+
+    void unregisterBigramMap(const BigramMap *const bigramMap) {
+        mMemorySize -= bigramMap->getMemorySize();
+        mBigramMapIterators.erase(bigramMap->getPosition());
     }
 
-    hash_map_compat<int, BigramMap> mBigramMaps;
+    SearchStatistics *const mStatistics;
+    const uint8_t *mDicRoot;
+    BigramMapList mBigramMaps;
+    // The cached maps by previous word position. Clearing keeps the table.
+    FlatHashMap<BigramMapList::iterator, 64> mBigramMapIterators;
+    int mMemorySize;
 };
 } // namespace latinime
 #endif // LATINIME_MULTI_BIGRAM_MAP_H
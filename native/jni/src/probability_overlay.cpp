@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: probability_overlay.cpp"
+
+#include "probability_overlay.h"
+
+#include <pthread.h>
+
+#include "dictionary.h"
+#include "suggest/core/dictionary/terminal_position_index.h"
+
+namespace latinime {
+
+// A key with both positions at 0xFFFFFFFF, which neither a word nor a bigram has.
+const uint64_t ProbabilityOverlay::EMPTY_KEY = ~0ULL;
+
+// Overlays are created on several threads.
+static pthread_mutex_t sLastOverlayIdMutex = PTHREAD_MUTEX_INITIALIZER;
+static int sLastOverlayId = 0;
+
+static int generateOverlayId() {
+    pthread_mutex_lock(&sLastOverlayIdMutex);
+    const int id = ++sLastOverlayId;
+    pthread_mutex_unlock(&sLastOverlayIdMutex);
+    return id;
+}
+
+static int getSlotCount(const int entryCount) {
+    int slotCount = 16;
+    while (slotCount < entryCount * 2) {
+        slotCount *= 2;
+    }
+    return slotCount;
+}
+
+ProbabilityOverlay::ProbabilityOverlay(const int dictionaryId, const int entryCount)
+        : mId(generateOverlayId()), mDictionaryId(dictionaryId), mKeys(getSlotCount(entryCount), EMPTY_KEY),
+          mProbabilities(getSlotCount(entryCount), 0),
+          mSlotMask(getSlotCount(entryCount) - 1), mSize(0) {}
+
+/* static */ ProbabilityOverlay *ProbabilityOverlay::create(const Dictionary *const dictionary,
+        const int wordCount, const int *const wordOffsets, const int *const wordCodePoints,
+        const int *const probabilities, const int bigramCount,
+        const int *const bigramWordIndices, const int *const bigramProbabilities) {
+    std::vector<int> wordPositions(wordCount, NOT_VALID_WORD);
+    for (int i = 0; i < wordCount; ++i) {
+        const int length = wordOffsets[i + 1] - wordOffsets[i];
+        if (length <= 0 || length > MAX_WORD_LENGTH) {
+            continue;
+        }
+        wordPositions[i] = TerminalPositionIndex::getTerminalPosition(
+                dictionary->getTerminalPositionIndex(), dictionary->getOffsetDict(),
+                &wordCodePoints[wordOffsets[i]], length, false /* forceLowerCaseSearch */);
+    }
+    ProbabilityOverlay *const overlay = new ProbabilityOverlay(dictionary->getId(),
+            wordCount + bigramCount);
+    for (int i = 0; i < wordCount; ++i) {
+        if (wordPositions[i] != NOT_VALID_WORD && probabilities[i] != NOT_A_PROBABILITY) {
+            overlay->put(getKey(NOT_VALID_WORD, wordPositions[i]), probabilities[i]);
+        }
+    }
+    for (int i = 0; i < bigramCount; ++i) {
+        const int wordIndex0 = bigramWordIndices[i * 2];
+        const int wordIndex1 = bigramWordIndices[i * 2 + 1];
+        if (wordIndex0 < 0 || wordIndex0 >= wordCount || wordIndex1 < 0
+                || wordIndex1 >= wordCount) {
+            AKLOGE("Invalid bigram word indices: %d, %d", wordIndex0, wordIndex1);
+            continue;
+        }
+        if (wordPositions[wordIndex0] != NOT_VALID_WORD
+                && wordPositions[wordIndex1] != NOT_VALID_WORD) {
+            overlay->put(getKey(wordPositions[wordIndex0], wordPositions[wordIndex1]),
+                    bigramProbabilities[i]);
+        }
+    }
+    return overlay;
+}
+
+void ProbabilityOverlay::put(const uint64_t key, const int probability) {
+    int slot = getSlot(key);
+    while (mKeys[slot] != EMPTY_KEY && mKeys[slot] != key) {
+        slot = (slot + 1) & mSlotMask;
+    }
+    if (mKeys[slot] == EMPTY_KEY) {
+        mKeys[slot] = key;
+        ++mSize;
+    }
+    mProbabilities[slot] = static_cast<uint8_t>(min(max(probability, 0), MAX_PROBABILITY));
+}
+} // namespace latinime
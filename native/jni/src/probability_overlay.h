@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_PROBABILITY_OVERLAY_H
+#define LATINIME_PROBABILITY_OVERLAY_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "memory_utils.h"
+
+namespace latinime {
+
+class Dictionary;
+
+/**
+ * Probabilities that replace those of some words and bigrams of a dictionary, e.g. the ones
+ * learned from the user, so that one search of the dictionary ranks its words for the user
+ * instead of merging the suggestions of a second dictionary. The words are keyed by their
+ * terminal positions in the dictionary, so an overlay only applies to the dictionary it was
+ * created for. The unigrams and the bigrams share one open addressing table of 64-bit keys.
+ * Immutable once created, hence shared by the sessions of the Java dictionary that set it, and
+ * not by the other ones that share the native dictionary; see DicTraverseSession::init.
+ */
+class ProbabilityOverlay {
+ public:
+    // Creates the overlay of the words of dictionary at [wordOffsets[i], wordOffsets[i + 1]) of
+    // wordCodePoints, wordCount of them, and of the bigrams from the word at
+    // bigramWordIndices[2 * i] to the one at bigramWordIndices[2 * i + 1]. A word whose
+    // probability is NOT_A_PROBABILITY keeps the one of the dictionary, and the words that are
+    // not in the dictionary are ignored. The bigram probabilities are those of
+    // BinaryFormat::getBigramProbability, combined with the unigram probabilities already.
+    static ProbabilityOverlay *create(const Dictionary *const dictionary, const int wordCount,
+            const int *const wordOffsets, const int *const wordCodePoints,
+            const int *const probabilities, const int bigramCount,
+            const int *const bigramWordIndices, const int *const bigramProbabilities);
+
+    // Non virtual inline destructor -- never inherit this class
+    ~ProbabilityOverlay() {}
+
+    // Unique in the process, so that the sessions know when the overlay was replaced even if the
+    // new one is at the address of the old one.
+    int getId() const { return mId; }
+
+    // The id of the dictionary the overlay was created for, see Dictionary::getId.
+    int getDictionaryId() const { return mDictionaryId; }
+
+    // Returns the probability of the word at wordPos, or NOT_A_PROBABILITY if it is not replaced.
+    AK_FORCE_INLINE int getUnigramProbability(const int wordPos) const {
+        return getProbability(getKey(NOT_VALID_WORD, wordPos));
+    }
+
+    // Returns the probability of the bigram, or NOT_A_PROBABILITY if it is not replaced.
+    AK_FORCE_INLINE int getBigramProbability(const int prevWordPos, const int wordPos) const {
+        return getProbability(getKey(prevWordPos, wordPos));
+    }
+
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mKeys)
+                + MemoryUtils::getVectorMemorySize(&mProbabilities);
+    }
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ProbabilityOverlay);
+
+    static const uint64_t EMPTY_KEY;
+
+    // The table is at most half full.
+    ProbabilityOverlay(const int dictionaryId, const int entryCount);
+
+    static AK_FORCE_INLINE uint64_t getKey(const int prevWordPos, const int wordPos) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(prevWordPos)) << 32)
+                | static_cast<uint32_t>(wordPos);
+    }
+
+    AK_FORCE_INLINE int getSlot(const uint64_t key) const {
+        const uint64_t hash = key * 0x9E3779B97F4A7C15ULL;
+        return static_cast<int>(hash >> 32) & mSlotMask;
+    }
+
+    AK_FORCE_INLINE int getProbability(const uint64_t key) const {
+        if (mSize == 0) {
+            return NOT_A_PROBABILITY;
+        }
+        for (int slot = getSlot(key); mKeys[slot] != EMPTY_KEY; slot = (slot + 1) & mSlotMask) {
+            if (mKeys[slot] == key) {
+                return mProbabilities[slot];
+            }
+        }
+        return NOT_A_PROBABILITY;
+    }
+
+    // A later probability of the same key replaces the earlier one.
+    void put(const uint64_t key, const int probability);
+
+    const int mId;
+    const int mDictionaryId;
+    std::vector<uint64_t> mKeys;
+    std::vector<uint8_t> mProbabilities;
+    const int mSlotMask;
+    int mSize;
+};
+} // namespace latinime
+#endif // LATINIME_PROBABILITY_OVERLAY_H
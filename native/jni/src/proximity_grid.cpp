@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: proximity_grid.cpp"
+
+#include "proximity_grid.h"
+
+namespace latinime {
+
+void ProximityGrid::init(const int cellWidth, const int cellHeight, const int gridWidth,
+        const int gridHeight, const int *const proximityChars, const int keyCount,
+        const int *const keyCodePoints) {
+    mCellWidth = max(cellWidth, 1);
+    mCellHeight = max(cellHeight, 1);
+    mGridWidth = gridWidth;
+    mCellCount = max(gridWidth * gridHeight, 0);
+    mKeyCodePoints.assign(keyCodePoints, keyCodePoints + max(keyCount, 0));
+    mSpaceKeys = 0;
+    for (int k = 0; k < keyCount; ++k) {
+        if (KEYCODE_SPACE == keyCodePoints[k]) {
+            mSpaceKeys |= 1ULL << k;
+        }
+    }
+    mCellCodePoints.clear();
+    if (!initCellKeyMasks(proximityChars, keyCount)) {
+        if (DEBUG_PROXIMITY_INFO) {
+            AKLOGI("The proximity grid is not made of keys: it is not compacted.");
+        }
+        std::vector<uint64_t>().swap(mCellKeyMasks);
+        mCellCodePoints.assign(proximityChars,
+                proximityChars + mCellCount * MAX_PROXIMITY_CHARS_SIZE);
+    }
+}
+
+bool ProximityGrid::hasSpaceAt(const int x, const int y) const {
+    const int cellIndex = getCellIndex(x, y);
+    if (NOT_AN_INDEX == cellIndex) {
+        return false;
+    }
+    if (mCellCodePoints.empty()) {
+        return (mCellKeyMasks[cellIndex] & mSpaceKeys) != 0;
+    }
+    const int *const codePoints = &mCellCodePoints[cellIndex * MAX_PROXIMITY_CHARS_SIZE];
+    for (int i = 0; i < MAX_PROXIMITY_CHARS_SIZE; ++i) {
+        if (KEYCODE_SPACE == codePoints[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A code point of a cell is the next key with this code point, so that the keys of the mask
+// give back the code points of the cell in their order, and the ones below KEYCODE_SPACE, which
+// are skipped, are dropped.
+bool ProximityGrid::initCellKeyMasks(const int *const proximityChars, const int keyCount) {
+    mCellKeyMasks.assign(mCellCount, 0);
+    if (!proximityChars) {
+        return true;
+    }
+    for (int cellIndex = 0; cellIndex < mCellCount; ++cellIndex) {
+        const int *const codePoints = &proximityChars[cellIndex * MAX_PROXIMITY_CHARS_SIZE];
+        int k = 0;
+        for (int i = 0; i < MAX_PROXIMITY_CHARS_SIZE; ++i) {
+            if (codePoints[i] < KEYCODE_SPACE) {
+                continue;
+            }
+            while (k < keyCount && mKeyCodePoints[k] != codePoints[i]) {
+                ++k;
+            }
+            if (k >= keyCount) {
+                return false;
+            }
+            mCellKeyMasks[cellIndex] |= 1ULL << k;
+            ++k;
+        }
+    }
+    return true;
+}
+} // namespace latinime
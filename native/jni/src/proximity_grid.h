@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_PROXIMITY_GRID_H
+#define LATINIME_PROXIMITY_GRID_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "memory_utils.h"
+
+#if MAX_KEY_COUNT_IN_A_KEYBOARD > 64
+#error "ProximityGrid stores the keys of a cell in a 64-bit mask"
+#endif
+
+namespace latinime {
+
+/**
+ * The keys near each cell of the grid of the keyboard, as computed by the Java ProximityInfo.
+ * Java sends them as up to MAX_PROXIMITY_CHARS_SIZE code points per cell, listed in the order of
+ * the keys, so they are stored as the mask of these keys: 8 bytes per cell instead of 64, and a
+ * membership test is a bit test. A grid that does not fit, e.g. with code points that are not
+ * keys, is kept as it was sent.
+ */
+class ProximityGrid {
+ public:
+    ProximityGrid()
+            : mCellWidth(1), mCellHeight(1), mGridWidth(0), mCellCount(0), mSpaceKeys(0),
+              mKeyCodePoints(), mCellKeyMasks(), mCellCodePoints() {}
+
+    // Non virtual inline destructor -- never inherit this class
+    ~ProximityGrid() {}
+
+    // The bytes allocated for the cells.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mKeyCodePoints)
+                + MemoryUtils::getVectorMemorySize(&mCellKeyMasks)
+                + MemoryUtils::getVectorMemorySize(&mCellCodePoints);
+    }
+
+    // proximityChars has gridWidth * gridHeight * MAX_PROXIMITY_CHARS_SIZE code points, unused
+    // slots being negative, or is 0 for empty cells. keyCodePoints has keyCount code points.
+    void init(const int cellWidth, const int cellHeight, const int gridWidth,
+            const int gridHeight, const int *const proximityChars, const int keyCount,
+            const int *const keyCodePoints);
+
+    // Writes the code points of the cell of (x, y) to outCodePoints, which holds
+    // MAX_PROXIMITY_CHARS_SIZE of them, and returns their count, or NOT_AN_INDEX if the point is
+    // beyond the grid. The code points below KEYCODE_SPACE are to be skipped.
+    AK_FORCE_INLINE int getCodePointsAt(const int x, const int y, int *const outCodePoints)
+            const {
+        const int cellIndex = getCellIndex(x, y);
+        if (NOT_AN_INDEX == cellIndex) {
+            return NOT_AN_INDEX;
+        }
+        if (!mCellCodePoints.empty()) {
+            const int *const codePoints = &mCellCodePoints[cellIndex * MAX_PROXIMITY_CHARS_SIZE];
+            for (int i = 0; i < MAX_PROXIMITY_CHARS_SIZE; ++i) {
+                outCodePoints[i] = codePoints[i];
+            }
+            return MAX_PROXIMITY_CHARS_SIZE;
+        }
+        int count = 0;
+        for (uint64_t keys = mCellKeyMasks[cellIndex]; keys; keys &= keys - 1) {
+            outCodePoints[count++] = mKeyCodePoints[__builtin_ctzll(keys)];
+        }
+        return count;
+    }
+
+    // Whether the cell of (x, y) has the space key.
+    bool hasSpaceAt(const int x, const int y) const;
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(ProximityGrid);
+
+    AK_FORCE_INLINE int getCellIndex(const int x, const int y) const {
+        // A point right of the last column falls in the next row, as it always did.
+        const int cellIndex = (y / mCellHeight) * mGridWidth + x / mCellWidth;
+        return cellIndex >= 0 && cellIndex < mCellCount ? cellIndex : NOT_AN_INDEX;
+    }
+
+    bool initCellKeyMasks(const int *const proximityChars, const int keyCount);
+
+    int mCellWidth;
+    int mCellHeight;
+    int mGridWidth;
+    int mCellCount;
+    uint64_t mSpaceKeys;
+    std::vector<int> mKeyCodePoints;
+    // The keys of each cell, or empty if the grid is in mCellCodePoints
+    std::vector<uint64_t> mCellKeyMasks;
+    // The code points of each cell as sent, if they are not all keys in the order of the keys
+    std::vector<int> mCellCodePoints;
+};
+} // namespace latinime
+#endif // LATINIME_PROXIMITY_GRID_H
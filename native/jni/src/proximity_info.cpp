@@ -16,6 +16,7 @@
 
 #include <cstring>
 #include <cmath>
+#include <pthread.h>
 
 #define LOG_TAG "LatinIME: proximity_info.cpp"
 
@@ -23,38 +24,47 @@
 #include "char_utils.h"
 #include "defines.h"
 #include "geometry_utils.h"
-#include "jni.h"
+#include "memory_utils.h"
 #include "proximity_info.h"
 #include "proximity_info_params.h"
 
 namespace latinime {
 
-static AK_FORCE_INLINE void safeGetOrFillZeroIntArrayRegion(JNIEnv *env, jintArray jArray,
-        jsize len, jint *buffer) {
-    if (jArray && buffer) {
-        env->GetIntArrayRegion(jArray, 0, len, buffer);
-    } else if (buffer) {
-        memset(buffer, 0, len * sizeof(buffer[0]));
-    }
+const int ProximityInfo::MAX_KEY_KEY_DISTANCE_G = 0xFFFF;
+
+static pthread_mutex_t sLastProximityInfoIdMutex = PTHREAD_MUTEX_INITIALIZER;
+static int sLastProximityInfoId = 0;
+
+static int generateProximityInfoId() {
+    pthread_mutex_lock(&sLastProximityInfoIdMutex);
+    const int id = ++sLastProximityInfoId;
+    pthread_mutex_unlock(&sLastProximityInfoIdMutex);
+    return id;
 }
 
-static AK_FORCE_INLINE void safeGetOrFillZeroFloatArrayRegion(JNIEnv *env, jfloatArray jArray,
-        jsize len, jfloat *buffer) {
-    if (jArray && buffer) {
-        env->GetFloatArrayRegion(jArray, 0, len, buffer);
-    } else if (buffer) {
-        memset(buffer, 0, len * sizeof(buffer[0]));
+// Copies the array, or fills the buffer with zeroes if there is none.
+template<typename T>
+static AK_FORCE_INLINE void copyOrFillZeroArray(const T *const array, const int length,
+        T *const buffer) {
+    if (length <= 0) {
+        return;
+    }
+    if (array) {
+        memcpy(buffer, array, length * sizeof(buffer[0]));
+    } else {
+        memset(buffer, 0, length * sizeof(buffer[0]));
     }
 }
 
-ProximityInfo::ProximityInfo(JNIEnv *env, const jstring localeJStr,
+ProximityInfo::ProximityInfo(const char *const localeStr,
         const int keyboardWidth, const int keyboardHeight, const int gridWidth,
         const int gridHeight, const int mostCommonKeyWidth, const int mostCommonKeyHeight,
-        const jintArray proximityChars, const int keyCount, const jintArray keyXCoordinates,
-        const jintArray keyYCoordinates, const jintArray keyWidths, const jintArray keyHeights,
-        const jintArray keyCharCodes, const jfloatArray sweetSpotCenterXs,
-        const jfloatArray sweetSpotCenterYs, const jfloatArray sweetSpotRadii)
-        : GRID_WIDTH(gridWidth), GRID_HEIGHT(gridHeight), MOST_COMMON_KEY_WIDTH(mostCommonKeyWidth),
+        const int *const proximityChars, const int keyCount, const int *const keyXCoordinates,
+        const int *const keyYCoordinates, const int *const keyWidths, const int *const keyHeights,
+        const int *const keyCharCodes, const float *const sweetSpotCenterXs,
+        const float *const sweetSpotCenterYs, const float *const sweetSpotRadii)
+        : mId(generateProximityInfoId()), GRID_WIDTH(gridWidth), GRID_HEIGHT(gridHeight),
+          MOST_COMMON_KEY_WIDTH(mostCommonKeyWidth),
           MOST_COMMON_KEY_WIDTH_SQUARE(mostCommonKeyWidth * mostCommonKeyWidth),
           MOST_COMMON_KEY_HEIGHT(mostCommonKeyHeight),
           NORMALIZED_SQUARED_MOST_COMMON_KEY_HYPOTENUSE(1.0f +
@@ -68,41 +78,55 @@ ProximityInfo::ProximityInfo(JNIEnv *env, const jstring localeJStr,
           HAS_TOUCH_POSITION_CORRECTION_DATA(keyCount > 0 && keyXCoordinates && keyYCoordinates
                   && keyWidths && keyHeights && keyCharCodes && sweetSpotCenterXs
                   && sweetSpotCenterYs && sweetSpotRadii),
-          mProximityCharsArray(new int[GRID_WIDTH * GRID_HEIGHT * MAX_PROXIMITY_CHARS_SIZE
-                  /* proximityCharsLength */]),
-          mCodeToKeyMap() {
-    /* Let's check the input array length here to make sure */
-    const jsize proximityCharsLength = env->GetArrayLength(proximityChars);
-    if (proximityCharsLength != GRID_WIDTH * GRID_HEIGHT * MAX_PROXIMITY_CHARS_SIZE) {
-        AKLOGE("Invalid proximityCharsLength: %d", proximityCharsLength);
-        ASSERT(false);
-        return;
-    }
+          mProximityGrid(),
+          mKeyXCoordinates(KEY_COUNT), mKeyYCoordinates(KEY_COUNT), mKeyWidths(KEY_COUNT),
+          mKeyHeights(KEY_COUNT), mKeyCodePoints(KEY_COUNT), mSweetSpotCenterXs(KEY_COUNT),
+          mSweetSpotCenterYs(KEY_COUNT), mSweetSpotRadii(KEY_COUNT), mCodeToKeyMap(),
+          mKeyIndexToCodePointG(KEY_COUNT), mKeysWithSameCodePointG(KEY_COUNT),
+          mCenterXsG(KEY_COUNT), mCenterYsG(KEY_COUNT),
+          mKeyKeyDistancesG(KEY_COUNT * (KEY_COUNT - 1) / 2), mCenterXsFloatG(KEY_COUNT),
+          mCenterYsFloatG(KEY_COUNT), mCenterGapYsFloatG(KEY_COUNT), mKeyCenterGrid() {
+    memset(mKeyIndexPageIndices, 0, sizeof(mKeyIndexPageIndices));
     if (DEBUG_PROXIMITY_INFO) {
-        AKLOGI("Create proximity info array %d", proximityCharsLength);
-    }
-    const jsize localeCStrUtf8Length = env->GetStringUTFLength(localeJStr);
-    if (localeCStrUtf8Length >= MAX_LOCALE_STRING_LENGTH) {
-        AKLOGI("Locale string length too long: length=%d", localeCStrUtf8Length);
-        ASSERT(false);
+        AKLOGI("Create proximity info grid %d", GRID_WIDTH * GRID_HEIGHT);
     }
     memset(mLocaleStr, 0, sizeof(mLocaleStr));
-    env->GetStringUTFRegion(localeJStr, 0, env->GetStringLength(localeJStr), mLocaleStr);
-    safeGetOrFillZeroIntArrayRegion(env, proximityChars, proximityCharsLength,
-            mProximityCharsArray);
-    safeGetOrFillZeroIntArrayRegion(env, keyXCoordinates, KEY_COUNT, mKeyXCoordinates);
-    safeGetOrFillZeroIntArrayRegion(env, keyYCoordinates, KEY_COUNT, mKeyYCoordinates);
-    safeGetOrFillZeroIntArrayRegion(env, keyWidths, KEY_COUNT, mKeyWidths);
-    safeGetOrFillZeroIntArrayRegion(env, keyHeights, KEY_COUNT, mKeyHeights);
-    safeGetOrFillZeroIntArrayRegion(env, keyCharCodes, KEY_COUNT, mKeyCodePoints);
-    safeGetOrFillZeroFloatArrayRegion(env, sweetSpotCenterXs, KEY_COUNT, mSweetSpotCenterXs);
-    safeGetOrFillZeroFloatArrayRegion(env, sweetSpotCenterYs, KEY_COUNT, mSweetSpotCenterYs);
-    safeGetOrFillZeroFloatArrayRegion(env, sweetSpotRadii, KEY_COUNT, mSweetSpotRadii);
+    strncpy(mLocaleStr, localeStr, MAX_LOCALE_STRING_LENGTH - 1);
+    copyOrFillZeroArray(keyXCoordinates, KEY_COUNT, &mKeyXCoordinates[0]);
+    copyOrFillZeroArray(keyYCoordinates, KEY_COUNT, &mKeyYCoordinates[0]);
+    copyOrFillZeroArray(keyWidths, KEY_COUNT, &mKeyWidths[0]);
+    copyOrFillZeroArray(keyHeights, KEY_COUNT, &mKeyHeights[0]);
+    copyOrFillZeroArray(keyCharCodes, KEY_COUNT, &mKeyCodePoints[0]);
+    copyOrFillZeroArray(sweetSpotCenterXs, KEY_COUNT, &mSweetSpotCenterXs[0]);
+    copyOrFillZeroArray(sweetSpotCenterYs, KEY_COUNT, &mSweetSpotCenterYs[0]);
+    copyOrFillZeroArray(sweetSpotRadii, KEY_COUNT, &mSweetSpotRadii[0]);
+    mProximityGrid.init(CELL_WIDTH, CELL_HEIGHT, GRID_WIDTH, GRID_HEIGHT, proximityChars,
+            KEY_COUNT, KEY_COUNT > 0 ? &mKeyCodePoints[0] : 0);
     initializeG();
 }
 
-ProximityInfo::~ProximityInfo() {
-    delete[] mProximityCharsArray;
+ProximityInfo::~ProximityInfo() {}
+
+int ProximityInfo::getMemorySize() const {
+    return static_cast<int>(sizeof(*this)) + mProximityGrid.getMemorySize()
+            + mCodeToKeyMap.getMemorySize()
+            + MemoryUtils::getVectorMemorySize(&mKeyXCoordinates)
+            + MemoryUtils::getVectorMemorySize(&mKeyYCoordinates)
+            + MemoryUtils::getVectorMemorySize(&mKeyWidths)
+            + MemoryUtils::getVectorMemorySize(&mKeyHeights)
+            + MemoryUtils::getVectorMemorySize(&mKeyCodePoints)
+            + MemoryUtils::getVectorMemorySize(&mSweetSpotCenterXs)
+            + MemoryUtils::getVectorMemorySize(&mSweetSpotCenterYs)
+            + MemoryUtils::getVectorMemorySize(&mSweetSpotRadii)
+            + MemoryUtils::getVectorMemorySize(&mKeyIndexToCodePointG)
+            + MemoryUtils::getVectorMemorySize(&mKeysWithSameCodePointG)
+            + MemoryUtils::getVectorMemorySize(&mCenterXsG)
+            + MemoryUtils::getVectorMemorySize(&mCenterYsG)
+            + MemoryUtils::getVectorMemorySize(&mKeyKeyDistancesG)
+            + MemoryUtils::getVectorMemorySize(&mCenterXsFloatG)
+            + MemoryUtils::getVectorMemorySize(&mCenterYsFloatG)
+            + MemoryUtils::getVectorMemorySize(&mCenterGapYsFloatG)
+            + mKeyCenterGrid.getMemorySize();
 }
 
 bool ProximityInfo::hasSpaceProximity(const int x, const int y) const {
@@ -114,38 +138,13 @@ bool ProximityInfo::hasSpaceProximity(const int x, const int y) const {
         }
         return false;
     }
-
-    const int startIndex = ProximityInfoUtils::getStartIndexFromCoordinates(x, y,
-            CELL_HEIGHT, CELL_WIDTH, GRID_WIDTH);
-    if (DEBUG_PROXIMITY_INFO) {
-        AKLOGI("hasSpaceProximity: index %d, %d, %d", startIndex, x, y);
-    }
-    int *proximityCharsArray = mProximityCharsArray;
-    for (int i = 0; i < MAX_PROXIMITY_CHARS_SIZE; ++i) {
-        if (DEBUG_PROXIMITY_INFO) {
-            AKLOGI("Index: %d", mProximityCharsArray[startIndex + i]);
-        }
-        if (proximityCharsArray[startIndex + i] == KEYCODE_SPACE) {
-            return true;
-        }
-    }
-    return false;
+    return mProximityGrid.hasSpaceAt(x, y);
 }
 
 float ProximityInfo::getNormalizedSquaredDistanceFromCenterFloatG(
         const int keyId, const int x, const int y, const float verticalScale) const {
-    const bool correctTouchPosition = hasTouchPositionCorrectionData();
-    const float centerX = static_cast<float>(correctTouchPosition ? getSweetSpotCenterXAt(keyId)
-            : getKeyCenterXOfKeyIdG(keyId));
-    const float visualKeyCenterY = static_cast<float>(getKeyCenterYOfKeyIdG(keyId));
-    float centerY;
-    if (correctTouchPosition) {
-        const float sweetSpotCenterY = static_cast<float>(getSweetSpotCenterYAt(keyId));
-        const float gapY = sweetSpotCenterY - visualKeyCenterY;
-        centerY = visualKeyCenterY + gapY * verticalScale;
-    } else {
-        centerY = visualKeyCenterY;
-    }
+    const float centerX = mCenterXsFloatG[keyId];
+    const float centerY = mCenterYsFloatG[keyId] + mCenterGapYsFloatG[keyId] * verticalScale;
     const float touchX = static_cast<float>(x);
     const float touchY = static_cast<float>(y);
     const float keyWidth = static_cast<float>(getMostCommonKeyWidth());
@@ -153,6 +152,33 @@ float ProximityInfo::getNormalizedSquaredDistanceFromCenterFloatG(
             / SQUARE_FLOAT(keyWidth);
 }
 
+void ProximityInfo::getNormalizedSquaredDistancesFromCentersFloatG(const int x, const int y,
+        const float verticalScale, float *const outDistances) const {
+    ProximityInfoUtils::getSquaredDistancesFloat(&mCenterXsFloatG[0], &mCenterYsFloatG[0],
+            &mCenterGapYsFloatG[0], verticalScale, KEY_COUNT, static_cast<float>(x),
+            static_cast<float>(y), outDistances);
+    const float squaredKeyWidth = SQUARE_FLOAT(static_cast<float>(getMostCommonKeyWidth()));
+    for (int k = 0; k < KEY_COUNT; ++k) {
+        outDistances[k] /= squaredKeyWidth;
+    }
+}
+
+uint64_t ProximityInfo::getNearKeysMaskG(const int x, const int y, const float verticalScale,
+        const float normalizedSquaredDistance) const {
+    if (verticalScale < 0.0f || verticalScale > 1.0f) {
+        // The grid only covers the centers for the scales in [0, 1].
+        return getAllKeysMask();
+    }
+    // One more pixel for the rounding of the distances.
+    const float radius = sqrtf(normalizedSquaredDistance)
+            * static_cast<float>(getMostCommonKeyWidth()) + 1.0f;
+    if (!(radius < KEYBOARD_HYPOTENUSE)) {
+        return getAllKeysMask();
+    }
+    return mKeyCenterGrid.getKeysInSquare(static_cast<float>(x), static_cast<float>(y), radius)
+            & getAllKeysMask();
+}
+
 int ProximityInfo::getCodePointOf(const int keyIndex) const {
     if (keyIndex < 0 || keyIndex >= KEY_COUNT) {
         return NOT_A_CODE_POINT;
@@ -167,27 +193,69 @@ void ProximityInfo::initializeG() {
         const int lowerCode = toLowerCase(code);
         mCenterXsG[i] = mKeyXCoordinates[i] + mKeyWidths[i] / 2;
         mCenterYsG[i] = mKeyYCoordinates[i] + mKeyHeights[i] / 2;
-        mCodeToKeyMap[lowerCode] = i;
+        mCodeToKeyMap.put(lowerCode, i);
         mKeyIndexToCodePointG[i] = lowerCode;
+        const bool correctTouchPosition = hasTouchPositionCorrectionData();
+        mCenterXsFloatG[i] = correctTouchPosition ? mSweetSpotCenterXs[i]
+                : static_cast<float>(mCenterXsG[i]);
+        mCenterYsFloatG[i] = static_cast<float>(mCenterYsG[i]);
+        mCenterGapYsFloatG[i] = correctTouchPosition
+                ? mSweetSpotCenterYs[i] - mCenterYsFloatG[i] : 0.0f;
     }
-    for (int i = 0; i < KEY_COUNT; i++) {
-        mKeyKeyDistancesG[i][i] = 0;
-        for (int j = i + 1; j < KEY_COUNT; j++) {
-            mKeyKeyDistancesG[i][j] = getDistanceInt(
+    for (int i = 0; i < KEY_COUNT; ++i) {
+        mKeysWithSameCodePointG[i] = 0;
+        for (int j = 0; j < KEY_COUNT; ++j) {
+            if (mKeyIndexToCodePointG[j] == mKeyIndexToCodePointG[i]) {
+                mKeysWithSameCodePointG[i] |= 1ULL << j;
+            }
+        }
+    }
+    initializeKeyIndexPages();
+    mKeyCenterGrid.init(KEYBOARD_WIDTH, KEYBOARD_HEIGHT, MOST_COMMON_KEY_WIDTH, KEY_COUNT,
+            &mCenterXsFloatG[0], &mCenterYsFloatG[0], &mCenterGapYsFloatG[0]);
+    initializeKeyKeyDistances();
+}
+
+void ProximityInfo::initializeKeyKeyDistances() {
+    for (int i = 1; i < KEY_COUNT; ++i) {
+        uint16_t *const distances = &mKeyKeyDistancesG[i * (i - 1) / 2];
+        for (int j = 0; j < i; ++j) {
+            const int distance = getDistanceInt(
                     mCenterXsG[i], mCenterYsG[i], mCenterXsG[j], mCenterYsG[j]);
-            mKeyKeyDistancesG[j][i] = mKeyKeyDistancesG[i][j];
+            distances[j] = static_cast<uint16_t>(min(distance, MAX_KEY_KEY_DISTANCE_G));
         }
     }
 }
 
+// Fills the key indices of the whole page of each key code point, as mCodeToKeyMap gives them. The
+// pages past MAX_KEY_INDEX_PAGE_COUNT are left to mCodeToKeyMap.
+void ProximityInfo::initializeKeyIndexPages() {
+    int pageCount = 0;
+    for (int i = 0; i < KEY_COUNT; ++i) {
+        const int lowerCode = mKeyIndexToCodePointG[i];
+        if (lowerCode < 0 || lowerCode >= CODE_POINT_PAGE_COUNT * CODE_POINT_PAGE_SIZE) {
+            continue;
+        }
+        const int page = lowerCode / CODE_POINT_PAGE_SIZE;
+        if (mKeyIndexPageIndices[page] > 0 || pageCount >= MAX_KEY_INDEX_PAGE_COUNT) {
+            continue;
+        }
+        int8_t *const keyIndices = mKeyIndexPages[pageCount];
+        for (int j = 0; j < CODE_POINT_PAGE_SIZE; ++j) {
+            keyIndices[j] = static_cast<int8_t>(ProximityInfoUtils::getKeyIndexOf(
+                    KEY_COUNT, page * CODE_POINT_PAGE_SIZE + j, &mCodeToKeyMap));
+        }
+        ++pageCount;
+        mKeyIndexPageIndices[page] = static_cast<uint8_t>(pageCount);
+    }
+}
+
 int ProximityInfo::getKeyCenterXOfCodePointG(int charCode) const {
-    return getKeyCenterXOfKeyIdG(
-            ProximityInfoUtils::getKeyIndexOf(KEY_COUNT, charCode, &mCodeToKeyMap));
+    return getKeyCenterXOfKeyIdG(getKeyIndexOf(charCode));
 }
 
 int ProximityInfo::getKeyCenterYOfCodePointG(int charCode) const {
-    return getKeyCenterYOfKeyIdG(
-            ProximityInfoUtils::getKeyIndexOf(KEY_COUNT, charCode, &mCodeToKeyMap));
+    return getKeyCenterYOfKeyIdG(getKeyIndexOf(charCode));
 }
 
 int ProximityInfo::getKeyCenterXOfKeyIdG(int keyId) const {
@@ -206,7 +274,11 @@ int ProximityInfo::getKeyCenterYOfKeyIdG(int keyId) const {
 
 int ProximityInfo::getKeyKeyDistanceG(const int keyId0, const int keyId1) const {
     if (keyId0 >= 0 && keyId1 >= 0) {
-        return mKeyKeyDistancesG[keyId0][keyId1];
+        if (keyId0 == keyId1) {
+            return 0;
+        }
+        const int i = max(keyId0, keyId1);
+        return mKeyKeyDistancesG[i * (i - 1) / 2 + min(keyId0, keyId1)];
     }
     return MAX_VALUE_FOR_WEIGHTING;
 }
@@ -17,9 +17,13 @@
 #ifndef LATINIME_PROXIMITY_INFO_H
 #define LATINIME_PROXIMITY_INFO_H
 
+#include <stdint.h>
+#include <vector>
+
+#include "char_utils.h"
 #include "defines.h"
-#include "hash_map_compat.h"
-#include "jni.h"
+#include "key_center_grid.h"
+#include "proximity_grid.h"
 #include "proximity_info_utils.h"
 
 namespace latinime {
@@ -28,19 +32,37 @@ class Correction;
 
 class ProximityInfo {
  public:
-    ProximityInfo(JNIEnv *env, const jstring localeJStr,
+    // proximityChars has gridWidth * gridHeight * MAX_PROXIMITY_CHARS_SIZE code points and the
+    // key arrays keyCount elements, or are 0 to read zeroes. The arrays are copied.
+    ProximityInfo(const char *const localeStr,
             const int keyboardWidth, const int keyboardHeight, const int gridWidth,
             const int gridHeight, const int mostCommonKeyWidth, const int mostCommonKeyHeight,
-            const jintArray proximityChars, const int keyCount, const jintArray keyXCoordinates,
-            const jintArray keyYCoordinates, const jintArray keyWidths, const jintArray keyHeights,
-            const jintArray keyCharCodes, const jfloatArray sweetSpotCenterXs,
-            const jfloatArray sweetSpotCenterYs, const jfloatArray sweetSpotRadii);
+            const int *const proximityChars, const int keyCount, const int *const keyXCoordinates,
+            const int *const keyYCoordinates, const int *const keyWidths,
+            const int *const keyHeights, const int *const keyCharCodes,
+            const float *const sweetSpotCenterXs, const float *const sweetSpotCenterYs,
+            const float *const sweetSpotRadii);
     ~ProximityInfo();
+    // Unique to the instance, unlike its address, which a later keyboard may take.
+    int getId() const { return mId; }
+    // The bytes allocated for the instance and its tables.
+    int getMemorySize() const;
     bool hasSpaceProximity(const int x, const int y) const;
     int getNormalizedSquaredDistance(const int inputIndex, const int proximityIndex) const;
     float getNormalizedSquaredDistanceFromCenterFloatG(
             const int keyId, const int x, const int y,
             const float verticalScale) const;
+    // Fills outDistances with the normalized squared distances from (x, y) to each of the
+    // getKeyCount() keys, as getNormalizedSquaredDistanceFromCenterFloatG does for one key.
+    void getNormalizedSquaredDistancesFromCentersFloatG(const int x, const int y,
+            const float verticalScale, float *const outDistances) const;
+    // Returns a mask of key indices that contains all the keys whose normalized squared distance
+    // from (x, y) is less than normalizedSquaredDistance, and possibly a few farther ones.
+    uint64_t getNearKeysMaskG(const int x, const int y, const float verticalScale,
+            const float normalizedSquaredDistance) const;
+    uint64_t getAllKeysMask() const {
+        return KEY_COUNT >= 64 ? ~0ULL : (1ULL << KEY_COUNT) - 1;
+    }
     bool sameAsTyped(const unsigned short *word, int length) const;
     int getCodePointOf(const int keyIndex) const;
     bool hasSweetSpotData(const int keyIndex) const {
@@ -78,26 +100,55 @@ class ProximityInfo {
             const int *const inputXCoordinates, const int *const inputYCoordinates,
             const int inputSize, int *allInputCodes) const {
         ProximityInfoUtils::initializeProximities(inputCodes, inputXCoordinates, inputYCoordinates,
-                inputSize, mKeyXCoordinates, mKeyYCoordinates, mKeyWidths, mKeyHeights,
-                mProximityCharsArray, CELL_HEIGHT, CELL_WIDTH, GRID_WIDTH, MOST_COMMON_KEY_WIDTH,
-                KEY_COUNT, mLocaleStr, &mCodeToKeyMap, allInputCodes);
+                inputSize, &mKeyXCoordinates[0], &mKeyYCoordinates[0], &mKeyWidths[0],
+                &mKeyHeights[0], &mProximityGrid, MOST_COMMON_KEY_WIDTH, KEY_COUNT, mLocaleStr,
+                &mCodeToKeyMap, allInputCodes);
     }
 
     AK_FORCE_INLINE int getKeyIndexOf(const int c) const {
+        if (c >= 0 && c < CODE_POINT_PAGE_COUNT * CODE_POINT_PAGE_SIZE) {
+            const int page = mKeyIndexPageIndices[c / CODE_POINT_PAGE_SIZE];
+            if (page > 0) {
+                return mKeyIndexPages[page - 1][c % CODE_POINT_PAGE_SIZE];
+            }
+        }
         return ProximityInfoUtils::getKeyIndexOf(KEY_COUNT, c, &mCodeToKeyMap);
     }
 
+    // The key of the code point, or else of its base code point, as 'é' is gestured through 'e'.
+    AK_FORCE_INLINE int getKeyIndexOrBaseKeyIndexOf(const int c) const {
+        const int keyIndex = getKeyIndexOf(c);
+        return keyIndex != NOT_AN_INDEX ? keyIndex : getKeyIndexOf(toBaseCodePoint(c));
+    }
+
+    // The keys of the lower case of c, as a mask of key indices. Several keys may have the same
+    // code point.
+    AK_FORCE_INLINE uint64_t getKeysWithCodePointOf(const int c) const {
+        const int keyIndex = getKeyIndexOf(c);
+        return keyIndex != NOT_AN_INDEX ? mKeysWithSameCodePointG[keyIndex] : 0;
+    }
+
     AK_FORCE_INLINE bool isCodePointOnKeyboard(const int codePoint) const {
         return getKeyIndexOf(codePoint) != NOT_AN_INDEX;
     }
 
  private:
     DISALLOW_IMPLICIT_CONSTRUCTORS(ProximityInfo);
+    // The BMP is split into pages of code points. The pages that have a key code point are
+    // direct-mapped to key indices, including the upper case code points of the keys.
+    static const int CODE_POINT_PAGE_SIZE = 0x100;
+    static const int CODE_POINT_PAGE_COUNT = 0x100;
+    static const int MAX_KEY_INDEX_PAGE_COUNT = 4;
+    // The key to key distances are stored in 16 bits.
+    static const int MAX_KEY_KEY_DISTANCE_G;
 
     void initializeG();
+    void initializeKeyIndexPages();
+    void initializeKeyKeyDistances();
     float calculateNormalizedSquaredDistance(const int keyIndex, const int inputIndex) const;
     bool hasInputCoordinates() const;
 
+    const int mId;
     const int GRID_WIDTH;
     const int GRID_HEIGHT;
     const int MOST_COMMON_KEY_WIDTH;
@@ -112,21 +163,36 @@ class ProximityInfo {
     const float KEYBOARD_HYPOTENUSE;
     const bool HAS_TOUCH_POSITION_CORRECTION_DATA;
     char mLocaleStr[MAX_LOCALE_STRING_LENGTH];
-    int *mProximityCharsArray;
-    int mKeyXCoordinates[MAX_KEY_COUNT_IN_A_KEYBOARD];
-    int mKeyYCoordinates[MAX_KEY_COUNT_IN_A_KEYBOARD];
-    int mKeyWidths[MAX_KEY_COUNT_IN_A_KEYBOARD];
-    int mKeyHeights[MAX_KEY_COUNT_IN_A_KEYBOARD];
-    int mKeyCodePoints[MAX_KEY_COUNT_IN_A_KEYBOARD];
-    float mSweetSpotCenterXs[MAX_KEY_COUNT_IN_A_KEYBOARD];
-    float mSweetSpotCenterYs[MAX_KEY_COUNT_IN_A_KEYBOARD];
-    float mSweetSpotRadii[MAX_KEY_COUNT_IN_A_KEYBOARD];
-    hash_map_compat<int, int> mCodeToKeyMap;
-
-    int mKeyIndexToCodePointG[MAX_KEY_COUNT_IN_A_KEYBOARD];
-    int mCenterXsG[MAX_KEY_COUNT_IN_A_KEYBOARD];
-    int mCenterYsG[MAX_KEY_COUNT_IN_A_KEYBOARD];
-    int mKeyKeyDistancesG[MAX_KEY_COUNT_IN_A_KEYBOARD][MAX_KEY_COUNT_IN_A_KEYBOARD];
+    ProximityGrid mProximityGrid;
+    // The arrays of the keys have KEY_COUNT elements.
+    std::vector<int> mKeyXCoordinates;
+    std::vector<int> mKeyYCoordinates;
+    std::vector<int> mKeyWidths;
+    std::vector<int> mKeyHeights;
+    std::vector<int> mKeyCodePoints;
+    std::vector<float> mSweetSpotCenterXs;
+    std::vector<float> mSweetSpotCenterYs;
+    std::vector<float> mSweetSpotRadii;
+    ProximityInfoUtils::CodeToKeyMap mCodeToKeyMap;
+    // 1 + the index in mKeyIndexPages of each page of code points, or 0 to use mCodeToKeyMap
+    uint8_t mKeyIndexPageIndices[CODE_POINT_PAGE_COUNT];
+    int8_t mKeyIndexPages[MAX_KEY_INDEX_PAGE_COUNT][CODE_POINT_PAGE_SIZE];
+
+    std::vector<int> mKeyIndexToCodePointG;
+    // The keys with the same code point as each key, itself included, as masks of key indices
+    std::vector<uint64_t> mKeysWithSameCodePointG;
+    std::vector<int> mCenterXsG;
+    std::vector<int> mCenterYsG;
+    // The distances between two different keys, as a lower triangular matrix without the
+    // diagonal: the distance between the keys i and j < i is at i * (i - 1) / 2 + j.
+    std::vector<uint16_t> mKeyKeyDistancesG;
+    // The centers of the keys for the geometric distances, the sweet spots if there are touch
+    // position correction data. The Y of a center is mCenterYsFloatG + mCenterGapYsFloatG
+    // scaled by the vertical sweet spot scale.
+    std::vector<float> mCenterXsFloatG;
+    std::vector<float> mCenterYsFloatG;
+    std::vector<float> mCenterGapYsFloatG;
+    KeyCenterGrid mKeyCenterGrid;
     // TODO: move to correction.h
 };
 } // namespace latinime
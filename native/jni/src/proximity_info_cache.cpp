@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "LatinIME: proximity_info_cache.cpp"
+
+#include "proximity_info_cache.h"
+
+#include <cstring>
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+#include "proximity_info.h"
+
+namespace latinime {
+
+struct CachedProximityInfo {
+    CachedProximityInfo(const std::vector<int> *const layout, const uint32_t layoutHash,
+            ProximityInfo *const proximityInfo)
+            : mLayout(*layout), mLayoutHash(layoutHash), mProximityInfo(proximityInfo),
+              mRefCount(1) {}
+
+    // All the arguments the proximity info was created from, flattened into ints.
+    std::vector<int> mLayout;
+    uint32_t mLayoutHash;
+    ProximityInfo *mProximityInfo;
+    int mRefCount;
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(CachedProximityInfo);
+};
+
+// Enough for the alphabet, symbols and their shifted layouts in both orientations.
+static const int MAX_UNREFERENCED_PROXIMITY_INFO_COUNT = 8;
+
+// Most recently used first. A keyboard has only a handful of layouts, so a linear search is
+// enough.
+static pthread_mutex_t sCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<CachedProximityInfo *> sCachedProximityInfos;
+
+// Reads the elements of the array, if any, and appends a presence flag and them to the layout.
+// Returns the elements, or 0 if there are none.
+static const int *readIntArray(JNIEnv *env, const jintArray jArray, const int length,
+        std::vector<int> *const elements, std::vector<int> *const layout) {
+    layout->push_back(jArray ? 1 : 0);
+    if (!jArray || length <= 0) {
+        return 0;
+    }
+    elements->resize(length);
+    env->GetIntArrayRegion(jArray, 0, length, &(*elements)[0]);
+    layout->insert(layout->end(), elements->begin(), elements->end());
+    return &(*elements)[0];
+}
+
+// Same as readIntArray, but the bits of the elements are appended to the layout.
+static const float *readFloatArray(JNIEnv *env, const jfloatArray jArray, const int length,
+        std::vector<float> *const elements, std::vector<int> *const layout) {
+    layout->push_back(jArray ? 1 : 0);
+    if (!jArray || length <= 0) {
+        return 0;
+    }
+    elements->resize(length);
+    env->GetFloatArrayRegion(jArray, 0, length, &(*elements)[0]);
+    const int start = static_cast<int>(layout->size());
+    layout->resize(start + length);
+    memcpy(&(*layout)[start], &(*elements)[0], length * sizeof((*elements)[0]));
+    return &(*elements)[0];
+}
+
+static uint32_t getLayoutHash(const std::vector<int> *const layout) {
+    // FNV-1a
+    uint32_t hash = 2166136261U;
+    for (int i = 0; i < static_cast<int>(layout->size()); ++i) {
+        hash = (hash ^ static_cast<uint32_t>((*layout)[i])) * 16777619U;
+    }
+    return hash;
+}
+
+// Must be called with sCacheMutex held. Moves the found entry to the front.
+static CachedProximityInfo *findLocked(const std::vector<int> *const layout,
+        const uint32_t layoutHash) {
+    for (int i = 0; i < static_cast<int>(sCachedProximityInfos.size()); ++i) {
+        CachedProximityInfo *const entry = sCachedProximityInfos[i];
+        if (entry->mLayoutHash == layoutHash && entry->mLayout == *layout) {
+            sCachedProximityInfos.erase(sCachedProximityInfos.begin() + i);
+            sCachedProximityInfos.insert(sCachedProximityInfos.begin(), entry);
+            return entry;
+        }
+    }
+    return 0;
+}
+
+// Must be called with sCacheMutex held. Deletes the least recently used unreferenced entries
+// over the limit.
+static void evictLocked() {
+    int unreferencedCount = 0;
+    for (int i = 0; i < static_cast<int>(sCachedProximityInfos.size()); ++i) {
+        CachedProximityInfo *const entry = sCachedProximityInfos[i];
+        if (entry->mRefCount > 0) {
+            continue;
+        }
+        ++unreferencedCount;
+        if (unreferencedCount > MAX_UNREFERENCED_PROXIMITY_INFO_COUNT) {
+            delete entry->mProximityInfo;
+            delete entry;
+            sCachedProximityInfos.erase(sCachedProximityInfos.begin() + i);
+            --i;
+        }
+    }
+}
+
+/* static */ ProximityInfo *ProximityInfoCache::acquire(JNIEnv *env, const jstring localeJStr,
+        const int keyboardWidth, const int keyboardHeight, const int gridWidth,
+        const int gridHeight, const int mostCommonKeyWidth, const int mostCommonKeyHeight,
+        const jintArray proximityChars, const int keyCount, const jintArray keyXCoordinates,
+        const jintArray keyYCoordinates, const jintArray keyWidths, const jintArray keyHeights,
+        const jintArray keyCharCodes, const jfloatArray sweetSpotCenterXs,
+        const jfloatArray sweetSpotCenterYs, const jfloatArray sweetSpotRadii) {
+    const int proximityCharsLength = gridWidth * gridHeight * MAX_PROXIMITY_CHARS_SIZE;
+    if (!proximityChars || env->GetArrayLength(proximityChars) != proximityCharsLength
+            || env->GetStringUTFLength(localeJStr) >= MAX_LOCALE_STRING_LENGTH) {
+        AKLOGE("Invalid proximity info: proximityCharsLength=%d localeLength=%d",
+                proximityChars ? env->GetArrayLength(proximityChars) : 0,
+                env->GetStringUTFLength(localeJStr));
+        ASSERT(false);
+        // Not cached. The keyboard has no keys, so that no input is near any key.
+        return new ProximityInfo("", keyboardWidth, keyboardHeight, gridWidth, gridHeight,
+                mostCommonKeyWidth, mostCommonKeyHeight, 0 /* proximityChars */,
+                0 /* keyCount */, 0 /* keyXCoordinates */, 0 /* keyYCoordinates */,
+                0 /* keyWidths */, 0 /* keyHeights */, 0 /* keyCharCodes */,
+                0 /* sweetSpotCenterXs */, 0 /* sweetSpotCenterYs */, 0 /* sweetSpotRadii */);
+    }
+    // The proximity info only reads this many keys.
+    const int readKeyCount = min(keyCount, MAX_KEY_COUNT_IN_A_KEYBOARD);
+    std::vector<int> layout;
+    layout.push_back(keyboardWidth);
+    layout.push_back(keyboardHeight);
+    layout.push_back(gridWidth);
+    layout.push_back(gridHeight);
+    layout.push_back(mostCommonKeyWidth);
+    layout.push_back(mostCommonKeyHeight);
+    layout.push_back(keyCount);
+    char localeStr[MAX_LOCALE_STRING_LENGTH];
+    memset(localeStr, 0, sizeof(localeStr));
+    env->GetStringUTFRegion(localeJStr, 0, env->GetStringLength(localeJStr), localeStr);
+    layout.insert(layout.end(), localeStr, localeStr + MAX_LOCALE_STRING_LENGTH);
+    std::vector<int> proximityCharsElements;
+    const int *const proximityCharsArray = readIntArray(env, proximityChars,
+            proximityCharsLength, &proximityCharsElements, &layout);
+    std::vector<int> keyXCoordinatesElements;
+    const int *const keyXCoordinatesArray = readIntArray(env, keyXCoordinates, readKeyCount,
+            &keyXCoordinatesElements, &layout);
+    std::vector<int> keyYCoordinatesElements;
+    const int *const keyYCoordinatesArray = readIntArray(env, keyYCoordinates, readKeyCount,
+            &keyYCoordinatesElements, &layout);
+    std::vector<int> keyWidthsElements;
+    const int *const keyWidthsArray = readIntArray(env, keyWidths, readKeyCount,
+            &keyWidthsElements, &layout);
+    std::vector<int> keyHeightsElements;
+    const int *const keyHeightsArray = readIntArray(env, keyHeights, readKeyCount,
+            &keyHeightsElements, &layout);
+    std::vector<int> keyCharCodesElements;
+    const int *const keyCharCodesArray = readIntArray(env, keyCharCodes, readKeyCount,
+            &keyCharCodesElements, &layout);
+    std::vector<float> sweetSpotCenterXsElements;
+    const float *const sweetSpotCenterXsArray = readFloatArray(env, sweetSpotCenterXs,
+            readKeyCount, &sweetSpotCenterXsElements, &layout);
+    std::vector<float> sweetSpotCenterYsElements;
+    const float *const sweetSpotCenterYsArray = readFloatArray(env, sweetSpotCenterYs,
+            readKeyCount, &sweetSpotCenterYsElements, &layout);
+    std::vector<float> sweetSpotRadiiElements;
+    const float *const sweetSpotRadiiArray = readFloatArray(env, sweetSpotRadii, readKeyCount,
+            &sweetSpotRadiiElements, &layout);
+    const uint32_t layoutHash = getLayoutHash(&layout);
+
+    pthread_mutex_lock(&sCacheMutex);
+    CachedProximityInfo *entry = findLocked(&layout, layoutHash);
+    if (entry) {
+        ++entry->mRefCount;
+        ProximityInfo *const proximityInfo = entry->mProximityInfo;
+        pthread_mutex_unlock(&sCacheMutex);
+        return proximityInfo;
+    }
+    pthread_mutex_unlock(&sCacheMutex);
+
+    ProximityInfo *proximityInfo = new ProximityInfo(localeStr, keyboardWidth, keyboardHeight,
+            gridWidth, gridHeight, mostCommonKeyWidth, mostCommonKeyHeight,
+            proximityCharsArray, readKeyCount, keyXCoordinatesArray, keyYCoordinatesArray,
+            keyWidthsArray, keyHeightsArray, keyCharCodesArray, sweetSpotCenterXsArray,
+            sweetSpotCenterYsArray, sweetSpotRadiiArray);
+    pthread_mutex_lock(&sCacheMutex);
+    entry = findLocked(&layout, layoutHash);
+    if (entry) {
+        // Created concurrently by another thread
+        ++entry->mRefCount;
+        delete proximityInfo;
+        proximityInfo = entry->mProximityInfo;
+    } else {
+        sCachedProximityInfos.insert(sCachedProximityInfos.begin(),
+                new CachedProximityInfo(&layout, layoutHash, proximityInfo));
+    }
+    pthread_mutex_unlock(&sCacheMutex);
+    return proximityInfo;
+}
+
+/* static */ void ProximityInfoCache::release(ProximityInfo *const proximityInfo) {
+    pthread_mutex_lock(&sCacheMutex);
+    for (int i = 0; i < static_cast<int>(sCachedProximityInfos.size()); ++i) {
+        CachedProximityInfo *const entry = sCachedProximityInfos[i];
+        if (entry->mProximityInfo != proximityInfo) {
+            continue;
+        }
+        --entry->mRefCount;
+        if (entry->mRefCount <= 0) {
+            evictLocked();
+        }
+        pthread_mutex_unlock(&sCacheMutex);
+        return;
+    }
+    pthread_mutex_unlock(&sCacheMutex);
+    // Never cached
+    delete proximityInfo;
+}
+} // namespace latinime
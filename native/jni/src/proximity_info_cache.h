@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LATINIME_PROXIMITY_INFO_CACHE_H
+#define LATINIME_PROXIMITY_INFO_CACHE_H
+
+#include "defines.h"
+#include "jni.h"
+
+namespace latinime {
+
+class ProximityInfo;
+
+/**
+ * Process-wide cache of the proximity infos, keyed by the layout they are created from. The
+ * keyboard is recreated on each shift or symbol toggle and orientation change, so the same few
+ * layouts come back many times. Proximity infos are reference counted, and the most recently
+ * released ones are kept so that switching back to a recent layout does not build it again.
+ * Thread safe.
+ */
+class ProximityInfoCache {
+ public:
+    // Returns the proximity info for this layout with one more reference, creating it if needed.
+    static ProximityInfo *acquire(JNIEnv *env, const jstring localeJStr,
+            const int keyboardWidth, const int keyboardHeight, const int gridWidth,
+            const int gridHeight, const int mostCommonKeyWidth, const int mostCommonKeyHeight,
+            const jintArray proximityChars, const int keyCount, const jintArray keyXCoordinates,
+            const jintArray keyYCoordinates, const jintArray keyWidths, const jintArray keyHeights,
+            const jintArray keyCharCodes, const jfloatArray sweetSpotCenterXs,
+            const jfloatArray sweetSpotCenterYs, const jfloatArray sweetSpotRadii);
+    // Drops a reference. The proximity info may be deleted, or kept for a later acquire.
+    static void release(ProximityInfo *const proximityInfo);
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ProximityInfoCache);
+};
+} // namespace latinime
+#endif // LATINIME_PROXIMITY_INFO_CACHE_H
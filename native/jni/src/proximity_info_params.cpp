@@ -23,6 +23,10 @@ const int ProximityInfoParams::MIN_DOUBLE_LETTER_BEELINE_SPEED_PERCENTILE = 5;
 const float ProximityInfoParams::VERTICAL_SWEET_SPOT_SCALE = 1.0f;
 const float ProximityInfoParams::VERTICAL_SWEET_SPOT_SCALE_G = 0.5f;
 
+// Used by ProximityInfoState::initInputParams()
+// The min distance between the points of a coarse sampling, in percent of the most common key width
+const int ProximityInfoParams::COARSE_SAMPLING_STEP_PERCENTILE = 50;
+
 /* Per method constants */
 // Used by ProximityInfoStateUtils::initGeometricDistanceInfos()
 const float ProximityInfoParams::NEAR_KEY_NORMALIZED_SQUARED_THRESHOLD = 4.0f;
@@ -28,6 +28,9 @@ class ProximityInfoParams {
     static const float VERTICAL_SWEET_SPOT_SCALE;
     static const float VERTICAL_SWEET_SPOT_SCALE_G;
 
+    // Used by ProximityInfoState::initInputParams()
+    static const int COARSE_SAMPLING_STEP_PERCENTILE;
+
     // Used by ProximityInfoStateUtils::initGeometricDistanceInfos()
     static const float NEAR_KEY_NORMALIZED_SQUARED_THRESHOLD;
 
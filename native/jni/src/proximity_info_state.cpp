@@ -20,8 +20,10 @@
 
 #define LOG_TAG "LatinIME: proximity_info_state.cpp"
 
+#include "char_utils.h"
 #include "defines.h"
 #include "geometry_utils.h"
+#include "memory_utils.h"
 #include "proximity_info.h"
 #include "proximity_info_state.h"
 #include "proximity_info_state_utils.h"
@@ -29,10 +31,11 @@
 namespace latinime {
 
 // TODO: Remove the dependency of "isGeometric"
+// A coarse sampling keeps fewer points of a gesture, for a first cheap search of its words.
 void ProximityInfoState::initInputParams(const int pointerId, const float maxPointToKeyLength,
         const ProximityInfo *proximityInfo, const int *const inputCodes, const int inputSize,
         const int *const xCoordinates, const int *const yCoordinates, const int *const times,
-        const int *const pointerIds, const bool isGeometric) {
+        const int *const pointerIds, const bool isGeometric, const bool samplesCoarsely) {
     ASSERT(isGeometric || (inputSize < MAX_WORD_LENGTH));
     mIsContinuousSuggestionPossible =
             ProximityInfoStateUtils::checkAndReturnIsContinuousSuggestionPossible(
@@ -57,6 +60,11 @@ void ProximityInfoState::initInputParams(const int pointerId, const float maxPoi
     if (!isGeometric && pointerId == 0) {
         mProximityInfo->initializeProximities(inputCodes, xCoordinates, yCoordinates,
                 inputSize, mInputProximities);
+        ProximityInfoStateUtils::initProximityTypes(inputSize, mInputProximities,
+                mProximityTypes);
+        mProximityTypeTableSize = inputSize;
+    } else {
+        mProximityTypeTableSize = 0;
     }
 
     ///////////////////////
@@ -87,13 +95,18 @@ void ProximityInfoState::initInputParams(const int pointerId, const float maxPoi
         mSpeedRates.clear();
         mBeelineSpeedPercentiles.clear();
         mCharProbabilities.clear();
+        mKeyAlignmentCosts.clear();
+        mSkipCostSums.clear();
         mDirections.clear();
+        mMostProbableStringLengths.clear();
+        mMostProbableStringLogProbabilities.clear();
     }
 
     if (DEBUG_GEO_FULL) {
         AKLOGI("Init ProximityInfoState: reused points =  %d, last input size = %d",
                 pushTouchPointStartIndex, lastSavedInputSize);
     }
+    reserveSampledInputs(inputSize, isGeometric);
 
     // TODO: Remove the dependency of "isGeometric"
     const float verticalSweetSpotScale = isGeometric
@@ -101,9 +114,13 @@ void ProximityInfoState::initInputParams(const int pointerId, const float maxPoi
             : ProximityInfoParams::VERTICAL_SWEET_SPOT_SCALE;
 
     if (xCoordinates && yCoordinates) {
+        const int samplingStep = (isGeometric && samplesCoarsely)
+                ? mProximityInfo->getMostCommonKeyWidth()
+                        * ProximityInfoParams::COARSE_SAMPLING_STEP_PERCENTILE / MAX_PERCENTILE
+                : 0;
         mSampledInputSize = ProximityInfoStateUtils::updateTouchPoints(mProximityInfo,
                 mMaxPointToKeyLength, mInputProximities, xCoordinates, yCoordinates, times,
-                pointerIds, verticalSweetSpotScale, inputSize, isGeometric, pointerId,
+                pointerIds, verticalSweetSpotScale, samplingStep, inputSize, isGeometric, pointerId,
                 pushTouchPointStartIndex, &mSampledInputXs, &mSampledInputYs, &mSampledTimes,
                 &mSampledLengthCache, &mSampledInputIndice);
     }
@@ -113,30 +130,37 @@ void ProximityInfoState::initInputParams(const int pointerId, const float maxPoi
                 yCoordinates, times, lastSavedInputSize, mSampledInputSize, &mSampledInputXs,
                 &mSampledInputYs, &mSampledTimes, &mSampledLengthCache, &mSampledInputIndice,
                 &mSpeedRates, &mDirections);
-        ProximityInfoStateUtils::refreshBeelineSpeedRates(mProximityInfo->getMostCommonKeyWidth(),
-                mAverageSpeed, inputSize, xCoordinates, yCoordinates, times, mSampledInputSize,
-                &mSampledInputXs, &mSampledInputYs, &mSampledInputIndice,
+        mBeelineSpeedRevisitIndex = ProximityInfoStateUtils::refreshBeelineSpeedRates(
+                mProximityInfo->getMostCommonKeyWidth(), mAverageSpeed, inputSize, xCoordinates,
+                yCoordinates, times, min(lastSavedInputSize, mBeelineSpeedRevisitIndex),
+                mSampledInputSize, &mSampledInputXs, &mSampledInputYs, &mSampledInputIndice,
                 &mBeelineSpeedPercentiles);
     }
 
     if (mSampledInputSize > 0) {
-        ProximityInfoStateUtils::initGeometricDistanceInfos(mProximityInfo, mSampledInputSize,
-                lastSavedInputSize, verticalSweetSpotScale, &mSampledInputXs, &mSampledInputYs,
-                &mSampledNearKeySets, &mSampledNormalizedSquaredLengthCache);
+        ProximityInfoStateUtils::initGeometricDistanceInfos(mProximityInfo, mMaxPointToKeyLength,
+                mSampledInputSize, lastSavedInputSize, verticalSweetSpotScale, &mSampledInputXs,
+                &mSampledInputYs, &mSampledNearKeySets, &mSampledNormalizedSquaredLengthCache);
         if (isGeometric) {
             // updates probabilities of skipping or mapping each key for all points.
             ProximityInfoStateUtils::updateAlignPointProbabilities(
                     mMaxPointToKeyLength, mProximityInfo->getMostCommonKeyWidth(),
                     mProximityInfo->getKeyCount(), lastSavedInputSize, mSampledInputSize,
-                    &mSampledInputXs, &mSampledInputYs, &mSpeedRates, &mSampledLengthCache,
+                    &mSampledInputXs, &mSampledInputYs, &mSpeedRates, &mDirections,
+                    &mSampledLengthCache,
                     &mSampledNormalizedSquaredLengthCache, &mSampledNearKeySets,
                     &mCharProbabilities);
+            ProximityInfoStateUtils::updateAlignmentCosts(mProximityInfo->getKeyCount(),
+                    mSampledInputSize, &mCharProbabilities, &mSampledNearKeySets,
+                    &mKeyAlignmentCosts, &mSkipCostSums);
             ProximityInfoStateUtils::updateSampledSearchKeySets(mProximityInfo,
                     mSampledInputSize, lastSavedInputSize, &mSampledLengthCache,
-                    &mSampledNearKeySets, &mSampledSearchKeySets,
-                    &mSampledSearchKeyVectors);
+                    &mSampledNearKeySets, &mSampledSearchKeySets);
             mMostProbableStringProbability = ProximityInfoStateUtils::getMostProbableString(
-                    mProximityInfo, mSampledInputSize, &mCharProbabilities, mMostProbableString);
+                    mProximityInfo, lastSavedInputSize, mSampledInputSize,
+                    mProximityInfo->getKeyCount(), &mCharProbabilities, &mSampledNearKeySets,
+                    &mMostProbableStringLengths, &mMostProbableStringLogProbabilities,
+                    mMostProbableString);
 
         }
     }
@@ -188,48 +212,16 @@ float ProximityInfoState::getPointToKeyByIdLength(
             keyId);
 }
 
-// In the following function, c is the current character of the dictionary word currently examined.
-// currentChars is an array containing the keys close to the character the user actually typed at
-// the same position. We want to see if c is in it: if so, then the word contains at that position
-// a character close to what the user typed.
-// What the user typed is actually the first character of the array.
-// proximityIndex is a pointer to the variable where getProximityType returns the index of c
-// in the proximity chars of the input index.
-// Notice : accented characters do not have a proximity list, so they are alone in their list. The
-// non-accented version of the character should be considered "close", but not the other keys close
-// to the non-accented version.
-ProximityType ProximityInfoState::getProximityType(const int index, const int codePoint,
-        const bool checkProximityChars, int *proximityIndex) const {
+uint32_t ProximityInfoState::getProximityLowerLetterMask(const int index) const {
+    // The same tests as getProximityType, knowing that a lower case ASCII letter is its own base
+    // lower case.
     const int *currentCodePoints = getProximityCodePointsAt(index);
-    const int firstCodePoint = currentCodePoints[0];
-    const int baseLowerC = toBaseLowerCase(codePoint);
-
-    // The first char in the array is what user typed. If it matches right away, that means the
-    // user typed that same char for this pos.
-    if (firstCodePoint == baseLowerC || firstCodePoint == codePoint) {
-        return MATCH_CHAR;
-    }
-
-    if (!checkProximityChars) return SUBSTITUTION_CHAR;
-
-    // If the non-accented, lowercased version of that first character matches c, then we have a
-    // non-accented version of the accented character the user typed. Treat it as a close char.
-    if (toBaseLowerCase(firstCodePoint) == baseLowerC) {
-        return PROXIMITY_CHAR;
-    }
-
-    // Not an exact nor an accent-alike match: search the list of close keys
+    uint32_t mask = getLowerLetterBit(currentCodePoints[0])
+            | getLowerLetterBit(toBaseLowerCase(currentCodePoints[0]));
     int j = 1;
     while (j < MAX_PROXIMITY_CHARS_SIZE
             && currentCodePoints[j] > ADDITIONAL_PROXIMITY_CHAR_DELIMITER_CODE) {
-        const bool matched = (currentCodePoints[j] == baseLowerC
-                || currentCodePoints[j] == codePoint);
-        if (matched) {
-            if (proximityIndex) {
-                *proximityIndex = j;
-            }
-            return PROXIMITY_CHAR;
-        }
+        mask |= getLowerLetterBit(currentCodePoints[j]);
         ++j;
     }
     if (j < MAX_PROXIMITY_CHARS_SIZE
@@ -237,19 +229,11 @@ ProximityType ProximityInfoState::getProximityType(const int index, const int co
         ++j;
         while (j < MAX_PROXIMITY_CHARS_SIZE
                 && currentCodePoints[j] > ADDITIONAL_PROXIMITY_CHAR_DELIMITER_CODE) {
-            const bool matched = (currentCodePoints[j] == baseLowerC
-                    || currentCodePoints[j] == codePoint);
-            if (matched) {
-                if (proximityIndex) {
-                    *proximityIndex = j;
-                }
-                return ADDITIONAL_PROXIMITY_CHAR;
-            }
+            mask |= getLowerLetterBit(currentCodePoints[j]);
             ++j;
         }
     }
-    // Was not included, signal this as a substitution character.
-    return SUBSTITUTION_CHAR;
+    return mask;
 }
 
 ProximityType ProximityInfoState::getProximityTypeG(const int index, const int codePoint) const {
@@ -258,18 +242,15 @@ ProximityType ProximityInfoState::getProximityTypeG(const int index, const int c
     }
     const int lowerCodePoint = toLowerCase(codePoint);
     const int baseLowerCodePoint = toBaseCodePoint(lowerCodePoint);
-    for (int i = 0; i < static_cast<int>(mSampledSearchKeyVectors[index].size()); ++i) {
-        if (mSampledSearchKeyVectors[index][i] == lowerCodePoint
-                || mSampledSearchKeyVectors[index][i] == baseLowerCodePoint) {
-            return MATCH_CHAR;
-        }
-    }
-    return UNRELATED_CHAR;
+    const ProximityInfoStateUtils::NearKeycodesSet keys =
+            mProximityInfo->getKeysWithCodePointOf(lowerCodePoint)
+                    | mProximityInfo->getKeysWithCodePointOf(baseLowerCodePoint);
+    return (mSampledSearchKeySets[index] & keys) ? MATCH_CHAR : UNRELATED_CHAR;
 }
 
 bool ProximityInfoState::isKeyInSerchKeysAfterIndex(const int index, const int keyId) const {
     ASSERT(keyId >= 0 && index >= 0 && index < mSampledInputSize);
-    return mSampledSearchKeySets[index].test(keyId);
+    return ProximityInfoStateUtils::hasKey(mSampledSearchKeySets[index], keyId);
 }
 
 float ProximityInfoState::getDirection(const int index0, const int index1) const {
@@ -310,10 +291,58 @@ bool ProximityInfoState::hasSpaceProximity(const int index) const {
 // Returns a probability of mapping index to keyIndex.
 float ProximityInfoState::getProbability(const int index, const int keyIndex) const {
     ASSERT(0 <= index && index < mSampledInputSize);
-    hash_map_compat<int, float>::const_iterator it = mCharProbabilities[index].find(keyIndex);
-    if (it != mCharProbabilities[index].end()) {
-        return it->second;
+    const float *const probabilities = &mCharProbabilities[index * (mKeyCount + 1)];
+    if (keyIndex == NOT_AN_INDEX) {
+        return probabilities[mKeyCount];
+    }
+    if (0 <= keyIndex && keyIndex < mKeyCount
+            && ProximityInfoStateUtils::hasKey(mSampledNearKeySets[index], keyIndex)) {
+        return probabilities[keyIndex];
     }
     return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
 }
+
+// The vectors of the sampled points are members of the session, and clearing them keeps their
+// capacity. The vectors of one element per point are reserved for all of the points of the input
+// at once, as the input is sampled down, so that they are allocated once for the longest input of
+// the session rather than grown point by point. The vectors of one element per point and key are
+// resized at once by the sampling and are not reserved, which would reserve them for the points
+// that sampling drops.
+void ProximityInfoState::reserveSampledInputs(const int inputSize, const bool isGeometric) {
+    mSampledInputXs.reserve(inputSize);
+    mSampledInputYs.reserve(inputSize);
+    mSampledTimes.reserve(inputSize);
+    mSampledInputIndice.reserve(inputSize);
+    mSampledLengthCache.reserve(inputSize);
+    mSampledNearKeySets.reserve(inputSize);
+    if (!isGeometric) {
+        return;
+    }
+    mSpeedRates.reserve(inputSize);
+    mDirections.reserve(inputSize);
+    mBeelineSpeedPercentiles.reserve(inputSize);
+    mSkipCostSums.reserve(inputSize + 1);
+    mSampledSearchKeySets.reserve(inputSize);
+    mMostProbableStringLengths.reserve(inputSize);
+    mMostProbableStringLogProbabilities.reserve(inputSize);
+}
+
+int ProximityInfoState::getMemorySize() const {
+    return MemoryUtils::getVectorMemorySize(&mSampledInputXs)
+            + MemoryUtils::getVectorMemorySize(&mSampledInputYs)
+            + MemoryUtils::getVectorMemorySize(&mSampledTimes)
+            + MemoryUtils::getVectorMemorySize(&mSampledInputIndice)
+            + MemoryUtils::getVectorMemorySize(&mSampledLengthCache)
+            + MemoryUtils::getVectorMemorySize(&mBeelineSpeedPercentiles)
+            + MemoryUtils::getVectorMemorySize(&mSampledNormalizedSquaredLengthCache)
+            + MemoryUtils::getVectorMemorySize(&mSpeedRates)
+            + MemoryUtils::getVectorMemorySize(&mDirections)
+            + MemoryUtils::getVectorMemorySize(&mCharProbabilities)
+            + MemoryUtils::getVectorMemorySize(&mKeyAlignmentCosts)
+            + MemoryUtils::getVectorMemorySize(&mSkipCostSums)
+            + MemoryUtils::getVectorMemorySize(&mSampledNearKeySets)
+            + MemoryUtils::getVectorMemorySize(&mSampledSearchKeySets)
+            + MemoryUtils::getVectorMemorySize(&mMostProbableStringLengths)
+            + MemoryUtils::getVectorMemorySize(&mMostProbableStringLogProbabilities);
+}
 } // namespace latinime
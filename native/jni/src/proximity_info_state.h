@@ -18,11 +18,11 @@
 #define LATINIME_PROXIMITY_INFO_STATE_H
 
 #include <cstring> // for memset()
+#include <stdint.h>
 #include <vector>
 
 #include "char_utils.h"
 #include "defines.h"
-#include "hash_map_compat.h"
 #include "proximity_info_params.h"
 #include "proximity_info_state_utils.h"
 
@@ -38,7 +38,10 @@ class ProximityInfoState {
     void initInputParams(const int pointerId, const float maxPointToKeyLength,
             const ProximityInfo *proximityInfo, const int *const inputCodes,
             const int inputSize, const int *xCoordinates, const int *yCoordinates,
-            const int *const times, const int *const pointerIds, const bool isGeometric);
+            const int *const times, const int *const pointerIds, const bool isGeometric,
+            const bool samplesCoarsely);
+    // The bytes allocated for the sampled input, including the retained capacity.
+    int getMemorySize() const;
 
     /////////////////////////////////////////
     // Defined here                        //
@@ -50,9 +53,11 @@ class ProximityInfoState {
               mIsContinuousSuggestionPossible(false), mSampledInputXs(), mSampledInputYs(),
               mSampledTimes(), mSampledInputIndice(), mSampledLengthCache(),
               mBeelineSpeedPercentiles(), mSampledNormalizedSquaredLengthCache(), mSpeedRates(),
-              mDirections(), mCharProbabilities(), mSampledNearKeySets(), mSampledSearchKeySets(),
-              mSampledSearchKeyVectors(), mTouchPositionCorrectionEnabled(false),
-              mSampledInputSize(0), mMostProbableStringProbability(0.0f) {
+              mDirections(), mCharProbabilities(), mKeyAlignmentCosts(), mSkipCostSums(),
+              mSampledNearKeySets(), mSampledSearchKeySets(), mBeelineSpeedRevisitIndex(0),
+              mMostProbableStringLengths(), mMostProbableStringLogProbabilities(),
+              mTouchPositionCorrectionEnabled(false), mSampledInputSize(0),
+              mMostProbableStringProbability(0.0f), mProximityTypeTableSize(0) {
         memset(mInputProximities, 0, sizeof(mInputProximities));
         memset(mNormalizedSquaredDistances, 0, sizeof(mNormalizedSquaredDistances));
         memset(mPrimaryInputWord, 0, sizeof(mPrimaryInputWord));
@@ -152,13 +157,29 @@ class ProximityInfoState {
     // TODO: Rename s/Length/NormalizedSquaredLength/
     float getPointToKeyLength(const int inputIndex, const int codePoint) const;
 
-    ProximityType getProximityType(const int index, const int codePoint,
-            const bool checkProximityChars, int *proximityIndex = 0) const;
+    AK_FORCE_INLINE ProximityType getProximityType(const int index, const int codePoint,
+            const bool checkProximityChars, int *proximityIndex = 0) const {
+        // The table does not give the index of the char in the proximity chars.
+        if (!proximityIndex && index < mProximityTypeTableSize && codePoint >= 0
+                && codePoint < ProximityInfoStateUtils::PROXIMITY_TYPE_TABLE_SIZE) {
+            const ProximityType proximityType =
+                    static_cast<ProximityType>(mProximityTypes[index][codePoint]);
+            return (checkProximityChars || proximityType == MATCH_CHAR)
+                    ? proximityType : SUBSTITUTION_CHAR;
+        }
+        return ProximityInfoStateUtils::getProximityType(getProximityCodePointsAt(index),
+                codePoint, checkProximityChars, proximityIndex);
+    }
 
     ProximityType getProximityTypeG(const int index, const int codePoint) const;
 
-    const std::vector<int> *getSearchKeyVector(const int index) const {
-        return &mSampledSearchKeyVectors[index];
+    // Returns the lower case ASCII letters for which getProximityType with checkProximityChars
+    // is a proximity char, as a bit mask of (letter - 'a').
+    uint32_t getProximityLowerLetterMask(const int index) const;
+
+    // The search keys of the sampled input point at index, as a mask of key indices.
+    ProximityInfoStateUtils::NearKeycodesSet getSearchKeys(const int index) const {
+        return mSampledSearchKeySets[index];
     }
 
     float getSpeedRate(const int index) const {
@@ -196,6 +217,18 @@ class ProximityInfoState {
 
     bool isKeyInSerchKeysAfterIndex(const int index, const int keyId) const;
 
+    // The costs of aligning the sampled points to the key, relative to the cheapest choice of
+    // each point, from the first point on. The keys that are not near a point cost
+    // MAX_VALUE_FOR_WEIGHTING there. Only for the geometric input.
+    AK_FORCE_INLINE const float *getKeyAlignmentCosts(const int keyId) const {
+        return &mKeyAlignmentCosts[keyId * mSampledInputSize];
+    }
+
+    // The sum of the relative costs of skipping the sampled points before index.
+    AK_FORCE_INLINE float getSkipCostSum(const int index) const {
+        return mSkipCostSums[index];
+    }
+
  private:
     DISALLOW_COPY_AND_ASSIGN(ProximityInfoState);
     /////////////////////////////////////////
@@ -206,6 +239,8 @@ class ProximityInfoState {
     float calculateSquaredDistanceFromSweetSpotCenter(
             const int keyIndex, const int inputIndex) const;
 
+    void reserveSampledInputs(const int inputSize, const bool isGeometric);
+
     /////////////////////////////////////////
     // Defined here                        //
     /////////////////////////////////////////
@@ -236,8 +271,13 @@ class ProximityInfoState {
     std::vector<float> mSampledNormalizedSquaredLengthCache;
     std::vector<float> mSpeedRates;
     std::vector<float> mDirections;
-    // probabilities of skipping or mapping to a key for each point.
-    std::vector<hash_map_compat<int, float> > mCharProbabilities;
+    // probabilities of mapping to each key and then of skipping for each point, as -log. Only the
+    // keys in mSampledNearKeySets have a probability.
+    std::vector<float> mCharProbabilities;
+    // mCharProbabilities relative to the cheapest choice of each point, by key then point, and
+    // the sums of the relative costs of skipping the points before each index.
+    std::vector<float> mKeyAlignmentCosts;
+    std::vector<float> mSkipCostSums;
     // The vector for the key code set which holds nearby keys for each sampled input point
     // 1. Used to calculate the probability of the key
     // 2. Used to calculate mSampledSearchKeySets
@@ -247,7 +287,11 @@ class ProximityInfoState {
     // the dictionary. Specifically, currently we are looking for keys nearby trailing sampled
     // inputs including the current input point.
     std::vector<ProximityInfoStateUtils::NearKeycodesSet> mSampledSearchKeySets;
-    std::vector<std::vector<int> > mSampledSearchKeyVectors;
+    // The first point whose beeline speed rate needs to be refreshed when more points come in.
+    int mBeelineSpeedRevisitIndex;
+    // The length and the probability of the most probable string up to each point.
+    std::vector<int> mMostProbableStringLengths;
+    std::vector<float> mMostProbableStringLogProbabilities;
     bool mTouchPositionCorrectionEnabled;
     int mInputProximities[MAX_PROXIMITY_CHARS_SIZE * MAX_WORD_LENGTH];
     int mNormalizedSquaredDistances[MAX_PROXIMITY_CHARS_SIZE * MAX_WORD_LENGTH];
@@ -255,6 +299,9 @@ class ProximityInfoState {
     int mPrimaryInputWord[MAX_WORD_LENGTH];
     float mMostProbableStringProbability;
     int mMostProbableString[MAX_WORD_LENGTH];
+    // getProximityType for each input index of the typing input, for the small code points
+    uint8_t mProximityTypes[MAX_WORD_LENGTH][ProximityInfoStateUtils::PROXIMITY_TYPE_TABLE_SIZE];
+    int mProximityTypeTableSize;
 };
 } // namespace latinime
 #endif // LATINIME_PROXIMITY_INFO_STATE_H
@@ -14,11 +14,14 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cmath>
 #include <cstring> // for memset()
 #include <sstream> // for debug prints
+#include <stdint.h>
 #include <vector>
 
+#include "char_utils.h"
 #include "defines.h"
 #include "geometry_utils.h"
 #include "proximity_info.h"
@@ -38,11 +41,14 @@ namespace latinime {
     return nextStartIndex;
 }
 
+// A samplingStep of 0 samples the input as finely as the points are useful, otherwise only the
+// corners and the points nearest to a key are sampled, at least samplingStep apart.
 /* static */ int ProximityInfoStateUtils::updateTouchPoints(
         const ProximityInfo *const proximityInfo, const int maxPointToKeyLength,
         const int *const inputProximities, const int *const inputXCoordinates,
         const int *const inputYCoordinates, const int *const times, const int *const pointerIds,
-        const float verticalSweetSpotScale, const int inputSize, const bool isGeometric,
+        const float verticalSweetSpotScale, const int samplingStep, const int inputSize,
+        const bool isGeometric,
         const int pointerId, const int pushTouchPointStartIndex, std::vector<int> *sampledInputXs,
         std::vector<int> *sampledInputYs, std::vector<int> *sampledInputTimes,
         std::vector<int> *sampledLengthCache, std::vector<int> *sampledInputIndice) {
@@ -88,6 +94,10 @@ namespace latinime {
     // the threshold we save that point, reset sumAngle. This aims to keep the figure of
     // the curve.
     float sumAngle = 0.0f;
+    // The angle of the segment that ends at the point of lastSegmentEndIndex, which is the
+    // previous angle of the next point.
+    float lastSegmentAngle = 0.0f;
+    int lastSegmentEndIndex = NOT_AN_INDEX;
 
     for (int i = pushTouchPointStartIndex; i <= lastInputIndex; ++i) {
         // Assuming pointerId == 0 if pointerIds is null.
@@ -103,16 +113,21 @@ namespace latinime {
             const int time = times ? times[i] : -1;
 
             if (i > 1) {
-                const float prevAngle = getAngle(
-                        inputXCoordinates[i - 2], inputYCoordinates[i - 2],
-                        inputXCoordinates[i - 1], inputYCoordinates[i - 1]);
+                const float prevAngle = (lastSegmentEndIndex == i - 1) ? lastSegmentAngle
+                        : getAngle(inputXCoordinates[i - 2], inputYCoordinates[i - 2],
+                                inputXCoordinates[i - 1], inputYCoordinates[i - 1]);
                 const float currentAngle = getAngle(
                         inputXCoordinates[i - 1], inputYCoordinates[i - 1], x, y);
                 sumAngle += getAngleDiff(prevAngle, currentAngle);
+                if (!proximityOnly) {
+                    lastSegmentAngle = currentAngle;
+                    lastSegmentEndIndex = i;
+                }
             }
 
             if (pushTouchPoint(proximityInfo, maxPointToKeyLength, i, c, x, y, time,
-                    verticalSweetSpotScale, isGeometric /* doSampling */, i == lastInputIndex,
+                    verticalSweetSpotScale, isGeometric /* doSampling */, samplingStep,
+                    i == lastInputIndex,
                     sumAngle, currentNearKeysDistances, prevNearKeysDistances,
                     prevPrevNearKeysDistances, sampledInputXs, sampledInputYs, sampledInputTimes,
                     sampledLengthCache, sampledInputIndice)) {
@@ -150,6 +165,122 @@ namespace latinime {
     }
 }
 
+// Fills the table of getProximityType for the code points below PROXIMITY_TYPE_TABLE_SIZE at each
+// input index. The type of a code point is the best of the types of the code point itself and of
+// its base lower case in the proximity chars, after the tests against the first char.
+/* static */ void ProximityInfoStateUtils::initProximityTypes(const int inputSize,
+        const int *const inputProximities,
+        uint8_t (*const proximityTypes)[PROXIMITY_TYPE_TABLE_SIZE]) {
+    int baseLowerCodePoints[PROXIMITY_TYPE_TABLE_SIZE];
+    for (int c = 0; c < PROXIMITY_TYPE_TABLE_SIZE; ++c) {
+        baseLowerCodePoints[c] = toBaseLowerCase(c);
+    }
+    for (int i = 0; i < inputSize; ++i) {
+        const int *const currentCodePoints = getProximityCodePointsAt(inputProximities, i);
+        // The types of the proximity chars themselves
+        uint8_t charTypes[PROXIMITY_TYPE_TABLE_SIZE];
+        memset(charTypes, SUBSTITUTION_CHAR, sizeof(charTypes));
+        int j = 1;
+        for (; j < MAX_PROXIMITY_CHARS_SIZE
+                && currentCodePoints[j] > ADDITIONAL_PROXIMITY_CHAR_DELIMITER_CODE; ++j) {
+            if (currentCodePoints[j] < PROXIMITY_TYPE_TABLE_SIZE) {
+                charTypes[currentCodePoints[j]] = PROXIMITY_CHAR;
+            }
+        }
+        if (j < MAX_PROXIMITY_CHARS_SIZE
+                && currentCodePoints[j] == ADDITIONAL_PROXIMITY_CHAR_DELIMITER_CODE) {
+            for (++j; j < MAX_PROXIMITY_CHARS_SIZE
+                    && currentCodePoints[j] > ADDITIONAL_PROXIMITY_CHAR_DELIMITER_CODE; ++j) {
+                const int additionalCodePoint = currentCodePoints[j];
+                if (additionalCodePoint < PROXIMITY_TYPE_TABLE_SIZE
+                        && charTypes[additionalCodePoint] == SUBSTITUTION_CHAR) {
+                    charTypes[additionalCodePoint] = ADDITIONAL_PROXIMITY_CHAR;
+                }
+            }
+        }
+        const int firstCodePoint = currentCodePoints[0];
+        const int baseLowerFirstCodePoint = toBaseLowerCase(firstCodePoint);
+        uint8_t *const types = proximityTypes[i];
+        for (int c = 0; c < PROXIMITY_TYPE_TABLE_SIZE; ++c) {
+            const int baseLowerC = baseLowerCodePoints[c];
+            if (firstCodePoint == baseLowerC || firstCodePoint == c) {
+                types[c] = MATCH_CHAR;
+            } else if (baseLowerFirstCodePoint == baseLowerC) {
+                types[c] = PROXIMITY_CHAR;
+            } else if (baseLowerC < PROXIMITY_TYPE_TABLE_SIZE) {
+                types[c] = min(charTypes[c], charTypes[baseLowerC]);
+            } else {
+                types[c] = getProximityType(currentCodePoints, c, true /* checkProximityChars */,
+                        0 /* proximityIndex */);
+            }
+        }
+    }
+}
+
+// In the following function, c is the current character of the dictionary word currently examined.
+// currentChars is an array containing the keys close to the character the user actually typed at
+// the same position. We want to see if c is in it: if so, then the word contains at that position
+// a character close to what the user typed.
+// What the user typed is actually the first character of the array.
+// proximityIndex is a pointer to the variable where getProximityType returns the index of c
+// in the proximity chars of the input index.
+// Notice : accented characters do not have a proximity list, so they are alone in their list. The
+// non-accented version of the character should be considered "close", but not the other keys close
+// to the non-accented version.
+/* static */ ProximityType ProximityInfoStateUtils::getProximityType(
+        const int *const currentCodePoints, const int codePoint, const bool checkProximityChars,
+        int *proximityIndex) {
+    const int firstCodePoint = currentCodePoints[0];
+    const int baseLowerC = toBaseLowerCase(codePoint);
+
+    // The first char in the array is what user typed. If it matches right away, that means the
+    // user typed that same char for this pos.
+    if (firstCodePoint == baseLowerC || firstCodePoint == codePoint) {
+        return MATCH_CHAR;
+    }
+
+    if (!checkProximityChars) return SUBSTITUTION_CHAR;
+
+    // If the non-accented, lowercased version of that first character matches c, then we have a
+    // non-accented version of the accented character the user typed. Treat it as a close char.
+    if (toBaseLowerCase(firstCodePoint) == baseLowerC) {
+        return PROXIMITY_CHAR;
+    }
+
+    // Not an exact nor an accent-alike match: search the list of close keys
+    int j = 1;
+    while (j < MAX_PROXIMITY_CHARS_SIZE
+            && currentCodePoints[j] > ADDITIONAL_PROXIMITY_CHAR_DELIMITER_CODE) {
+        const bool matched = (currentCodePoints[j] == baseLowerC
+                || currentCodePoints[j] == codePoint);
+        if (matched) {
+            if (proximityIndex) {
+                *proximityIndex = j;
+            }
+            return PROXIMITY_CHAR;
+        }
+        ++j;
+    }
+    if (j < MAX_PROXIMITY_CHARS_SIZE
+            && currentCodePoints[j] == ADDITIONAL_PROXIMITY_CHAR_DELIMITER_CODE) {
+        ++j;
+        while (j < MAX_PROXIMITY_CHARS_SIZE
+                && currentCodePoints[j] > ADDITIONAL_PROXIMITY_CHAR_DELIMITER_CODE) {
+            const bool matched = (currentCodePoints[j] == baseLowerC
+                    || currentCodePoints[j] == codePoint);
+            if (matched) {
+                if (proximityIndex) {
+                    *proximityIndex = j;
+                }
+                return ADDITIONAL_PROXIMITY_CHAR;
+            }
+            ++j;
+        }
+    }
+    // Was not included, signal this as a substitution character.
+    return SUBSTITUTION_CHAR;
+}
+
 /* static */ float ProximityInfoStateUtils::calculateSquaredDistanceFromSweetSpotCenter(
         const ProximityInfo *const proximityInfo, const std::vector<int> *const sampledInputXs,
         const std::vector<int> *const sampledInputYs, const int keyIndex, const int inputIndex) {
@@ -220,9 +351,13 @@ namespace latinime {
 
 }
 
+// The lengths to the keys are only read capped to maxPointToKeyLength, so the keys that the grid
+// of the proximity info shows to be farther than both that and the near key threshold are given
+// that bound without measuring them.
 /* static */ void ProximityInfoStateUtils::initGeometricDistanceInfos(
-        const ProximityInfo *const proximityInfo, const int sampledInputSize,
-        const int lastSavedInputSize, const float verticalSweetSpotScale,
+        const ProximityInfo *const proximityInfo, const float maxPointToKeyLength,
+        const int sampledInputSize, const int lastSavedInputSize,
+        const float verticalSweetSpotScale,
         const std::vector<int> *const sampledInputXs,
         const std::vector<int> *const sampledInputYs,
         std::vector<NearKeycodesSet> *sampledNearKeySets,
@@ -230,19 +365,37 @@ namespace latinime {
     sampledNearKeySets->resize(sampledInputSize);
     const int keyCount = proximityInfo->getKeyCount();
     sampledNormalizedSquaredLengthCache->resize(sampledInputSize * keyCount);
+    const float measuredLength = max(ProximityInfoParams::NEAR_KEY_NORMALIZED_SQUARED_THRESHOLD,
+            maxPointToKeyLength);
     for (int i = lastSavedInputSize; i < sampledInputSize; ++i) {
-        (*sampledNearKeySets)[i].reset();
+        (*sampledNearKeySets)[i] = 0;
+        if (keyCount == 0) {
+            continue;
+        }
+        const int x = (*sampledInputXs)[i];
+        const int y = (*sampledInputYs)[i];
+        float *const normalizedSquaredDistances =
+                &(*sampledNormalizedSquaredLengthCache)[i * keyCount];
+        uint64_t nearKeys = proximityInfo->getNearKeysMaskG(x, y, verticalSweetSpotScale,
+                measuredLength);
+        if (nearKeys == proximityInfo->getAllKeysMask()) {
+            proximityInfo->getNormalizedSquaredDistancesFromCentersFloatG(x, y,
+                    verticalSweetSpotScale, normalizedSquaredDistances);
+        } else {
+            for (int k = 0; k < keyCount; ++k) {
+                normalizedSquaredDistances[k] = measuredLength;
+            }
+            for (; nearKeys; nearKeys &= nearKeys - 1) {
+                const int k = __builtin_ctzll(nearKeys);
+                normalizedSquaredDistances[k] =
+                        proximityInfo->getNormalizedSquaredDistanceFromCenterFloatG(
+                                k, x, y, verticalSweetSpotScale);
+            }
+        }
         for (int k = 0; k < keyCount; ++k) {
-            const int index = i * keyCount + k;
-            const int x = (*sampledInputXs)[i];
-            const int y = (*sampledInputYs)[i];
-            const float normalizedSquaredDistance =
-                    proximityInfo->getNormalizedSquaredDistanceFromCenterFloatG(
-                            k, x, y, verticalSweetSpotScale);
-            (*sampledNormalizedSquaredLengthCache)[index] = normalizedSquaredDistance;
-            if (normalizedSquaredDistance
+            if (normalizedSquaredDistances[k]
                     < ProximityInfoParams::NEAR_KEY_NORMALIZED_SQUARED_THRESHOLD) {
-                (*sampledNearKeySets)[i][k] = true;
+                (*sampledNearKeySets)[i] |= getKeyBit(k);
             }
         }
     }
@@ -317,21 +470,31 @@ namespace latinime {
     return averageSpeed;
 }
 
-/* static */ void ProximityInfoStateUtils::refreshBeelineSpeedRates(const int mostCommonKeyWidth,
+// Refreshes the rates from start and returns the first point whose lookup reached the last input
+// point. The rates of the points before it do not change as the stroke grows, except for the
+// average speed, which is kept as it was when they were calculated, like the speed rates.
+/* static */ int ProximityInfoStateUtils::refreshBeelineSpeedRates(const int mostCommonKeyWidth,
         const float averageSpeed, const int inputSize, const int *const xCoordinates,
-        const int *const yCoordinates, const int *times, const int sampledInputSize,
-        const std::vector<int> *const sampledInputXs,
+        const int *const yCoordinates, const int *times, const int start,
+        const int sampledInputSize, const std::vector<int> *const sampledInputXs,
         const std::vector<int> *const sampledInputYs, const std::vector<int> *const inputIndice,
         std::vector<int> *beelineSpeedPercentiles) {
     if (DEBUG_SAMPLING_POINTS) {
         AKLOGI("--- refresh beeline speed rates");
     }
     beelineSpeedPercentiles->resize(sampledInputSize);
-    for (int i = 0; i < sampledInputSize; ++i) {
+    int revisitIndex = sampledInputSize;
+    for (int i = start; i < sampledInputSize; ++i) {
+        int lookupEnd = 0;
         (*beelineSpeedPercentiles)[i] = static_cast<int>(calculateBeelineSpeedRate(
                 mostCommonKeyWidth, averageSpeed, i, inputSize, xCoordinates, yCoordinates, times,
-                sampledInputSize, sampledInputXs, sampledInputYs, inputIndice) * MAX_PERCENTILE);
+                sampledInputSize, sampledInputXs, sampledInputYs, inputIndice, &lookupEnd)
+                        * MAX_PERCENTILE);
+        if (lookupEnd >= inputSize - 1 && revisitIndex == sampledInputSize) {
+            revisitIndex = i;
+        }
     }
+    return revisitIndex;
 }
 
 /* static */float ProximityInfoStateUtils::getDirection(
@@ -361,11 +524,30 @@ namespace latinime {
     currentNearKeysDistances->clear();
     const int keyCount = proximityInfo->getKeyCount();
     float nearestKeyDistance = maxPointToKeyLength;
+    // The keys farther than both the threshold and maxPointToKeyLength change nothing.
+    uint64_t nearKeys = proximityInfo->getNearKeysMaskG(x, y, verticalSweetspotScale,
+            max(ProximityInfoParams::NEAR_KEY_THRESHOLD_FOR_DISTANCE, maxPointToKeyLength));
+    if (nearKeys != proximityInfo->getAllKeysMask()) {
+        for (; nearKeys; nearKeys &= nearKeys - 1) {
+            const int k = __builtin_ctzll(nearKeys);
+            const float dist = proximityInfo->getNormalizedSquaredDistanceFromCenterFloatG(k, x,
+                    y, verticalSweetspotScale);
+            if (dist < ProximityInfoParams::NEAR_KEY_THRESHOLD_FOR_DISTANCE) {
+                currentNearKeysDistances->put(k, dist);
+            }
+            if (nearestKeyDistance > dist) {
+                nearestKeyDistance = dist;
+            }
+        }
+        return nearestKeyDistance;
+    }
+    float distances[MAX_KEY_COUNT_IN_A_KEYBOARD];
+    proximityInfo->getNormalizedSquaredDistancesFromCentersFloatG(x, y, verticalSweetspotScale,
+            distances);
     for (int k = 0; k < keyCount; ++k) {
-        const float dist = proximityInfo->getNormalizedSquaredDistanceFromCenterFloatG(k, x, y,
-                verticalSweetspotScale);
+        const float dist = distances[k];
         if (dist < ProximityInfoParams::NEAR_KEY_THRESHOLD_FOR_DISTANCE) {
-            currentNearKeysDistances->insert(std::pair<int, float>(k, dist));
+            currentNearKeysDistances->put(k, dist);
         }
         if (nearestKeyDistance > dist) {
             nearestKeyDistance = dist;
@@ -379,14 +561,18 @@ namespace latinime {
         const NearKeysDistanceMap *const currentNearKeysDistances,
         const NearKeysDistanceMap *const prevNearKeysDistances,
         const NearKeysDistanceMap *const prevPrevNearKeysDistances) {
-    for (NearKeysDistanceMap::const_iterator it = prevNearKeysDistances->begin();
-            it != prevNearKeysDistances->end(); ++it) {
-        NearKeysDistanceMap::const_iterator itPP = prevPrevNearKeysDistances->find(it->first);
-        NearKeysDistanceMap::const_iterator itC = currentNearKeysDistances->find(it->first);
-        const bool isPrevPrevNear = (itPP == prevPrevNearKeysDistances->end()
-                || itPP->second > it->second + ProximityInfoParams::MARGIN_FOR_PREV_LOCAL_MIN);
-        const bool isCurrentNear = (itC == currentNearKeysDistances->end()
-                || itC->second > it->second + ProximityInfoParams::MARGIN_FOR_PREV_LOCAL_MIN);
+    for (int i = 0; i < prevNearKeysDistances->getSlotCount(); ++i) {
+        if (!prevNearKeysDistances->isUsedSlot(i)) {
+            continue;
+        }
+        const int keyIndex = prevNearKeysDistances->getKeyAt(i);
+        const float prevDistance = prevNearKeysDistances->getValueAt(i);
+        const float *const prevPrevDistance = prevPrevNearKeysDistances->find(keyIndex);
+        const float *const currentDistance = currentNearKeysDistances->find(keyIndex);
+        const bool isPrevPrevNear = (!prevPrevDistance || *prevPrevDistance
+                > prevDistance + ProximityInfoParams::MARGIN_FOR_PREV_LOCAL_MIN);
+        const bool isCurrentNear = (!currentDistance || *currentDistance
+                > prevDistance + ProximityInfoParams::MARGIN_FOR_PREV_LOCAL_MIN);
         if (isPrevPrevNear && isCurrentNear) {
             return true;
         }
@@ -397,7 +583,8 @@ namespace latinime {
 // Calculating a point score that indicates usefulness of the point.
 /* static */ float ProximityInfoStateUtils::getPointScore(const int mostCommonKeyWidth,
         const int x, const int y, const int time, const bool lastPoint, const float nearest,
-        const float sumAngle, const NearKeysDistanceMap *const currentNearKeysDistances,
+        const float sumAngle, const int samplingStep,
+        const NearKeysDistanceMap *const currentNearKeysDistances,
         const NearKeysDistanceMap *const prevNearKeysDistances,
         const NearKeysDistanceMap *const prevPrevNearKeysDistances,
         std::vector<int> *sampledInputXs, std::vector<int> *sampledInputYs) {
@@ -436,6 +623,11 @@ namespace latinime {
                     || angleDiff > ProximityInfoParams::CORNER_ANGLE_THRESHOLD_FOR_POINT_SCORE)) {
         score += ProximityInfoParams::CORNER_SCORE;
     }
+    // A coarse sampling drops the other points, and those too close to the previous one.
+    if (samplingStep > 0 && (score <= 0.0f
+            || distPrev < samplingStep * ProximityInfoParams::DISTANCE_BASE_SCALE)) {
+        return ProximityInfoParams::NOT_LOCALMIN_DISTANCE_SCORE;
+    }
     return score;
 }
 
@@ -444,7 +636,7 @@ namespace latinime {
 /* static */ bool ProximityInfoStateUtils::pushTouchPoint(const ProximityInfo *const proximityInfo,
         const int maxPointToKeyLength, const int inputIndex, const int nodeCodePoint, int x, int y,
         const int time, const float verticalSweetSpotScale, const bool doSampling,
-        const bool isLastPoint, const float sumAngle,
+        const int samplingStep, const bool isLastPoint, const float sumAngle,
         NearKeysDistanceMap *const currentNearKeysDistances,
         const NearKeysDistanceMap *const prevNearKeysDistances,
         const NearKeysDistanceMap *const prevPrevNearKeysDistances,
@@ -459,7 +651,7 @@ namespace latinime {
         const float nearest = updateNearKeysDistances(proximityInfo, maxPointToKeyLength, x, y,
                 verticalSweetSpotScale, currentNearKeysDistances);
         const float score = getPointScore(mostCommonKeyWidth, x, y, time, isLastPoint, nearest,
-                sumAngle, currentNearKeysDistances, prevNearKeysDistances,
+                sumAngle, samplingStep, currentNearKeysDistances, prevNearKeysDistances,
                 prevPrevNearKeysDistances, sampledInputXs, sampledInputYs);
         if (score < 0) {
             // Pop previous point because it would be useless.
@@ -520,7 +712,9 @@ namespace latinime {
         const int *const yCoordinates, const int *times, const int sampledInputSize,
         const std::vector<int> *const sampledInputXs,
         const std::vector<int> *const sampledInputYs,
-        const std::vector<int> *const sampledInputIndices) {
+        const std::vector<int> *const sampledInputIndices, int *const lookupEnd) {
+    // The rate may change when more points come in, until a valid lookup ends before the last one.
+    *lookupEnd = inputSize - 1;
     if (sampledInputSize <= 0 || averageSpeed < 0.001f) {
         if (DEBUG_SAMPLING_POINTS) {
             AKLOGI("--- invalid state: cancel. size = %d, ave = %f",
@@ -559,6 +753,7 @@ namespace latinime {
     if (end > actualInputIndex && end < (inputSize - 1)) {
         --end;
     }
+    *lookupEnd = end;
 
     if (start >= end) {
         if (DEBUG_DOUBLE_LETTER) {
@@ -659,30 +854,32 @@ namespace latinime {
         const int start, const int sampledInputSize, const std::vector<int> *const sampledInputXs,
         const std::vector<int> *const sampledInputYs,
         const std::vector<float> *const sampledSpeedRates,
+        const std::vector<float> *const sampledDirections,
         const std::vector<int> *const sampledLengthCache,
         const std::vector<float> *const sampledNormalizedSquaredLengthCache,
-        std::vector<NearKeycodesSet> *sampledNearKeySets,
-        std::vector<hash_map_compat<int, float> > *charProbabilities) {
-    charProbabilities->resize(sampledInputSize);
+        std::vector<NearKeycodesSet> *sampledNearKeySets, std::vector<float> *charProbabilities) {
+    const int stride = keyCount + 1;
+    charProbabilities->resize(sampledInputSize * stride);
     // Calculates probabilities of using a point as a correlated point with the character
     // for each point.
     for (int i = start; i < sampledInputSize; ++i) {
-        (*charProbabilities)[i].clear();
+        float *const probabilities = &(*charProbabilities)[i * stride];
         // First, calculates skip probability. Starts from MAX_SKIP_PROBABILITY.
         // Note that all values that are multiplied to this probability should be in [0.0, 1.0];
         float skipProbability = ProximityInfoParams::MAX_SKIP_PROBABILITY;
 
-        const float currentAngle = getPointAngle(sampledInputXs, sampledInputYs, i);
+        // The same as getPointAngle, from the directions of the segments around the point.
+        const float currentAngle = (i > 0 && i < sampledInputSize - 1)
+                ? getAngleDiff((*sampledDirections)[i - 1], (*sampledDirections)[i]) : 0.0f;
         const float speedRate = (*sampledSpeedRates)[i];
 
         float nearestKeyDistance = static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
-        for (int j = 0; j < keyCount; ++j) {
-            if ((*sampledNearKeySets)[i].test(j)) {
-                const float distance = getPointToKeyByIdLength(
-                        maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount, i, j);
-                if (distance < nearestKeyDistance) {
-                    nearestKeyDistance = distance;
-                }
+        for (NearKeycodesSet keys = (*sampledNearKeySets)[i]; keys; keys &= keys - 1) {
+            const int j = __builtin_ctzll(keys);
+            const float distance = getPointToKeyByIdLength(
+                    maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount, i, j);
+            if (distance < nearestKeyDistance) {
+                nearestKeyDistance = distance;
             }
         }
 
@@ -728,9 +925,9 @@ namespace latinime {
             // We assume the angle of this point is the angle for point[i], point[i - 2]
             // and point[i - 3]. The reason why we don't use the angle for point[i], point[i - 1]
             // and point[i - 2] is this angle can be more affected by the noise.
-            const float prevAngle = getPointsAngle(sampledInputXs, sampledInputYs, i, i - 2, i - 3);
-            if (i >= 3 && prevAngle < ProximityInfoParams::STRAIGHT_ANGLE_THRESHOLD
-                    && currentAngle > ProximityInfoParams::CORNER_ANGLE_THRESHOLD) {
+            if (i >= 3 && currentAngle > ProximityInfoParams::CORNER_ANGLE_THRESHOLD
+                    && getPointsAngle(sampledInputXs, sampledInputYs, i, i - 2, i - 3)
+                            < ProximityInfoParams::STRAIGHT_ANGLE_THRESHOLD) {
                 skipProbability *= ProximityInfoParams::SKIP_CORNER_PROBABILITY;
             }
         }
@@ -738,7 +935,7 @@ namespace latinime {
         // probabilities must be in [0.0, ProximityInfoParams::MAX_SKIP_PROBABILITY];
         ASSERT(skipProbability >= 0.0f);
         ASSERT(skipProbability <= ProximityInfoParams::MAX_SKIP_PROBABILITY);
-        (*charProbabilities)[i][NOT_AN_INDEX] = skipProbability;
+        probabilities[keyCount] = skipProbability;
 
         // Second, calculates key probabilities by dividing the rest probability
         // (1.0f - skipProbability).
@@ -757,80 +954,78 @@ namespace latinime {
                 distribution(ProximityInfoParams::CENTER_VALUE_OF_NORMALIZED_DISTRIBUTION, sigma);
         // Summing up probability densities of all near keys.
         float sumOfProbabilityDensities = 0.0f;
-        for (int j = 0; j < keyCount; ++j) {
-            if ((*sampledNearKeySets)[i].test(j)) {
-                float distance = sqrtf(getPointToKeyByIdLength(
-                        maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount, i, j));
-                if (i == 0 && i != sampledInputSize - 1) {
-                    // For the first point, weighted average of distances from first point and the
-                    // next point to the key is used as a point to key distance.
-                    const float nextDistance = sqrtf(getPointToKeyByIdLength(
-                            maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount,
-                            i + 1, j));
-                    if (nextDistance < distance) {
-                        // The distance of the first point tends to bigger than continuing
-                        // points because the first touch by the user can be sloppy.
-                        // So we promote the first point if the distance of that point is larger
-                        // than the distance of the next point.
-                        distance = (distance
-                                + nextDistance * ProximityInfoParams::NEXT_DISTANCE_WEIGHT)
-                                        / (1.0f + ProximityInfoParams::NEXT_DISTANCE_WEIGHT);
-                    }
-                } else if (i != 0 && i == sampledInputSize - 1) {
-                    // For the first point, weighted average of distances from last point and
-                    // the previous point to the key is used as a point to key distance.
-                    const float previousDistance = sqrtf(getPointToKeyByIdLength(
-                            maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount,
-                            i - 1, j));
-                    if (previousDistance < distance) {
-                        // The distance of the last point tends to bigger than continuing points
-                        // because the last touch by the user can be sloppy. So we promote the
-                        // last point if the distance of that point is larger than the distance of
-                        // the previous point.
-                        distance = (distance
-                                + previousDistance * ProximityInfoParams::PREV_DISTANCE_WEIGHT)
-                                        / (1.0f + ProximityInfoParams::PREV_DISTANCE_WEIGHT);
-                    }
+        for (NearKeycodesSet keys = (*sampledNearKeySets)[i]; keys; keys &= keys - 1) {
+            const int j = __builtin_ctzll(keys);
+            float distance = sqrtf(getPointToKeyByIdLength(
+                    maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount, i, j));
+            if (i == 0 && i != sampledInputSize - 1) {
+                // For the first point, weighted average of distances from first point and the
+                // next point to the key is used as a point to key distance.
+                const float nextDistance = sqrtf(getPointToKeyByIdLength(
+                        maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount,
+                        i + 1, j));
+                if (nextDistance < distance) {
+                    // The distance of the first point tends to bigger than continuing
+                    // points because the first touch by the user can be sloppy.
+                    // So we promote the first point if the distance of that point is larger
+                    // than the distance of the next point.
+                    distance = (distance
+                            + nextDistance * ProximityInfoParams::NEXT_DISTANCE_WEIGHT)
+                                    / (1.0f + ProximityInfoParams::NEXT_DISTANCE_WEIGHT);
+                }
+            } else if (i != 0 && i == sampledInputSize - 1) {
+                // For the first point, weighted average of distances from last point and
+                // the previous point to the key is used as a point to key distance.
+                const float previousDistance = sqrtf(getPointToKeyByIdLength(
+                        maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount,
+                        i - 1, j));
+                if (previousDistance < distance) {
+                    // The distance of the last point tends to bigger than continuing points
+                    // because the last touch by the user can be sloppy. So we promote the
+                    // last point if the distance of that point is larger than the distance of
+                    // the previous point.
+                    distance = (distance
+                            + previousDistance * ProximityInfoParams::PREV_DISTANCE_WEIGHT)
+                                    / (1.0f + ProximityInfoParams::PREV_DISTANCE_WEIGHT);
                 }
-                // TODO: Promote the first point when the extended line from the next input is near
-                // from a key. Also, promote the last point as well.
-                sumOfProbabilityDensities += distribution.getProbabilityDensity(distance);
             }
+            // TODO: Promote the first point when the extended line from the next input is near
+            // from a key. Also, promote the last point as well.
+            sumOfProbabilityDensities += distribution.getProbabilityDensity(distance);
         }
 
         // Split the probability of an input point to keys that are close to the input point.
-        for (int j = 0; j < keyCount; ++j) {
-            if ((*sampledNearKeySets)[i].test(j)) {
-                float distance = sqrtf(getPointToKeyByIdLength(
-                        maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount, i, j));
-                if (i == 0 && i != sampledInputSize - 1) {
-                    // For the first point, weighted average of distances from the first point and
-                    // the next point to the key is used as a point to key distance.
-                    const float prevDistance = sqrtf(getPointToKeyByIdLength(
-                            maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount,
-                            i + 1, j));
-                    if (prevDistance < distance) {
-                        distance = (distance
-                                + prevDistance * ProximityInfoParams::NEXT_DISTANCE_WEIGHT)
-                                        / (1.0f + ProximityInfoParams::NEXT_DISTANCE_WEIGHT);
-                    }
-                } else if (i != 0 && i == sampledInputSize - 1) {
-                    // For the first point, weighted average of distances from last point and
-                    // the previous point to the key is used as a point to key distance.
-                    const float prevDistance = sqrtf(getPointToKeyByIdLength(
-                            maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount,
-                            i - 1, j));
-                    if (prevDistance < distance) {
-                        distance = (distance
-                                + prevDistance * ProximityInfoParams::PREV_DISTANCE_WEIGHT)
-                                        / (1.0f + ProximityInfoParams::PREV_DISTANCE_WEIGHT);
-                    }
+        for (NearKeycodesSet keys = (*sampledNearKeySets)[i]; keys; keys &= keys - 1) {
+            const int j = __builtin_ctzll(keys);
+            float distance = sqrtf(getPointToKeyByIdLength(
+                    maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount, i, j));
+            if (i == 0 && i != sampledInputSize - 1) {
+                // For the first point, weighted average of distances from the first point and
+                // the next point to the key is used as a point to key distance.
+                const float prevDistance = sqrtf(getPointToKeyByIdLength(
+                        maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount,
+                        i + 1, j));
+                if (prevDistance < distance) {
+                    distance = (distance
+                            + prevDistance * ProximityInfoParams::NEXT_DISTANCE_WEIGHT)
+                                    / (1.0f + ProximityInfoParams::NEXT_DISTANCE_WEIGHT);
+                }
+            } else if (i != 0 && i == sampledInputSize - 1) {
+                // For the first point, weighted average of distances from last point and
+                // the previous point to the key is used as a point to key distance.
+                const float prevDistance = sqrtf(getPointToKeyByIdLength(
+                        maxPointToKeyLength, sampledNormalizedSquaredLengthCache, keyCount,
+                        i - 1, j));
+                if (prevDistance < distance) {
+                    distance = (distance
+                            + prevDistance * ProximityInfoParams::PREV_DISTANCE_WEIGHT)
+                                    / (1.0f + ProximityInfoParams::PREV_DISTANCE_WEIGHT);
                 }
-                const float probabilityDensity = distribution.getProbabilityDensity(distance);
-                const float probability = inputCharProbability * probabilityDensity
-                        / sumOfProbabilityDensities;
-                (*charProbabilities)[i][j] = probability;
             }
+            const float probabilityDensity = distribution.getProbabilityDensity(distance);
+            const float probability = inputCharProbability * probabilityDensity
+                    / sumOfProbabilityDensities;
+            probabilities[j] = probability;
         }
     }
 
@@ -842,22 +1037,21 @@ namespace latinime {
             sstream << "Speed: "<< (*sampledSpeedRates)[i] << ", ";
             sstream << "Angle: "<< getPointAngle(sampledInputXs, sampledInputYs, i) << ", \n";
 
-            for (hash_map_compat<int, float>::iterator it = (*charProbabilities)[i].begin();
-                    it != (*charProbabilities)[i].end(); ++it) {
-                if (it->first == NOT_AN_INDEX) {
-                    sstream << it->first
-                            << "(skip):"
-                            << it->second
-                            << "\n";
-                } else {
-                    sstream << it->first
+            const float *const probabilities = &(*charProbabilities)[i * stride];
+            for (int j = 0; j < keyCount; ++j) {
+                if (hasKey((*sampledNearKeySets)[i], j)) {
+                    sstream << j
                             << "("
-                            //<< static_cast<char>(mProximityInfo->getCodePointOf(it->first))
+                            //<< static_cast<char>(mProximityInfo->getCodePointOf(j))
                             << "):"
-                            << it->second
+                            << probabilities[j]
                             << "\n";
                 }
             }
+            sstream << NOT_AN_INDEX
+                    << "(skip):"
+                    << probabilities[keyCount]
+                    << "\n";
             AKLOGI("%s", sstream.str().c_str());
         }
     }
@@ -867,15 +1061,15 @@ namespace latinime {
     for (int i = max(start, 1); i < sampledInputSize; ++i) {
         for (int j = i + 1; j < sampledInputSize; ++j) {
             if (!suppressCharProbabilities(
-                    mostCommonKeyWidth, sampledInputSize, sampledLengthCache, i, j,
-                    charProbabilities)) {
+                    mostCommonKeyWidth, keyCount, sampledInputSize, sampledLengthCache,
+                    sampledNearKeySets, i, j, charProbabilities)) {
                 break;
             }
         }
         for (int j = i - 1; j >= max(start, 0); --j) {
             if (!suppressCharProbabilities(
-                    mostCommonKeyWidth, sampledInputSize, sampledLengthCache, i, j,
-                    charProbabilities)) {
+                    mostCommonKeyWidth, keyCount, sampledInputSize, sampledLengthCache,
+                    sampledNearKeySets, i, j, charProbabilities)) {
                 break;
             }
         }
@@ -883,19 +1077,47 @@ namespace latinime {
 
     // Converting from raw probabilities to log probabilities to calculate spatial distance.
     for (int i = start; i < sampledInputSize; ++i) {
-        for (int j = 0; j < keyCount; ++j) {
-            hash_map_compat<int, float>::iterator it = (*charProbabilities)[i].find(j);
-            if (it == (*charProbabilities)[i].end()){
-                (*sampledNearKeySets)[i].reset(j);
-            } else if(it->second < ProximityInfoParams::MIN_PROBABILITY) {
+        float *const probabilities = &(*charProbabilities)[i * stride];
+        for (NearKeycodesSet keys = (*sampledNearKeySets)[i]; keys; keys &= keys - 1) {
+            const int j = __builtin_ctzll(keys);
+            if (probabilities[j] < ProximityInfoParams::MIN_PROBABILITY) {
                 // Erases from near keys vector because it has very low probability.
-                (*sampledNearKeySets)[i].reset(j);
-                (*charProbabilities)[i].erase(j);
+                (*sampledNearKeySets)[i] &= ~getKeyBit(j);
             } else {
-                it->second = -logf(it->second);
+                probabilities[j] = -logf(probabilities[j]);
             }
         }
-        (*charProbabilities)[i][NOT_AN_INDEX] = -logf((*charProbabilities)[i][NOT_AN_INDEX]);
+        probabilities[keyCount] = -logf(probabilities[keyCount]);
+    }
+}
+
+// Lays out the costs of charProbabilities by key for the gesture policy, which scans the points
+// forward for a key. The costs are relative to the cheapest choice of each point, so the costs of
+// the points that are consumed so far can be compared between paths that consumed more or less of
+// them, and never decrease as more points are consumed.
+/* static */ void ProximityInfoStateUtils::updateAlignmentCosts(const int keyCount,
+        const int sampledInputSize, const std::vector<float> *const charProbabilities,
+        const std::vector<NearKeycodesSet> *const sampledNearKeySets,
+        std::vector<float> *keyAlignmentCosts, std::vector<float> *skipCostSums) {
+    const int stride = keyCount + 1;
+    // A point that cannot be skipped costs as much to skip as the least probable key to align, so
+    // that the sums stay finite.
+    const float maxSkipCost = -logf(ProximityInfoParams::MIN_PROBABILITY);
+    keyAlignmentCosts->resize(keyCount * sampledInputSize);
+    skipCostSums->resize(sampledInputSize + 1);
+    (*skipCostSums)[0] = 0.0f;
+    for (int i = 0; i < sampledInputSize; ++i) {
+        const float *const probabilities = &(*charProbabilities)[i * stride];
+        const float skipCost = min(probabilities[keyCount], maxSkipCost);
+        float minCost = skipCost;
+        for (NearKeycodesSet keys = (*sampledNearKeySets)[i]; keys; keys &= keys - 1) {
+            minCost = min(minCost, probabilities[__builtin_ctzll(keys)]);
+        }
+        for (int j = 0; j < keyCount; ++j) {
+            (*keyAlignmentCosts)[j * sampledInputSize + i] = hasKey((*sampledNearKeySets)[i], j)
+                    ? probabilities[j] - minCost : static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+        }
+        (*skipCostSums)[i + 1] = (*skipCostSums)[i] + skipCost - minCost;
     }
 }
 
@@ -904,16 +1126,21 @@ namespace latinime {
         const int lastSavedInputSize,
         const std::vector<int> *const sampledLengthCache,
         const std::vector<NearKeycodesSet> *const sampledNearKeySets,
-        std::vector<NearKeycodesSet> *sampledSearchKeySets,
-        std::vector<std::vector<int> > *sampledSearchKeyVectors) {
+        std::vector<NearKeycodesSet> *sampledSearchKeySets) {
     sampledSearchKeySets->resize(sampledInputSize);
-    sampledSearchKeyVectors->resize(sampledInputSize);
     const int readForwordLength = static_cast<int>(
             hypotf(proximityInfo->getKeyboardWidth(), proximityInfo->getKeyboardHeight())
                     * ProximityInfoParams::SEARCH_KEY_RADIUS_RATIO);
-    for (int i = 0; i < sampledInputSize; ++i) {
+    // Only the points that read forward into the new points get new search keys.
+    int start = min(lastSavedInputSize, sampledInputSize);
+    while (start > 0 && lastSavedInputSize < sampledInputSize
+            && (*sampledLengthCache)[lastSavedInputSize] - (*sampledLengthCache)[start - 1]
+                    < readForwordLength) {
+        --start;
+    }
+    for (int i = start; i < sampledInputSize; ++i) {
         if (i >= lastSavedInputSize) {
-            (*sampledSearchKeySets)[i].reset();
+            (*sampledSearchKeySets)[i] = 0;
         }
         for (int j = max(i, lastSavedInputSize); j < sampledInputSize; ++j) {
             // TODO: Investigate if this is required. This may not fail.
@@ -923,28 +1150,14 @@ namespace latinime {
             (*sampledSearchKeySets)[i] |= (*sampledNearKeySets)[j];
         }
     }
-    const int keyCount = proximityInfo->getKeyCount();
-    for (int i = 0; i < sampledInputSize; ++i) {
-        std::vector<int> *searchKeyVector = &(*sampledSearchKeyVectors)[i];
-        searchKeyVector->clear();
-        for (int j = 0; j < keyCount; ++j) {
-            if ((*sampledSearchKeySets)[i].test(j)) {
-                const int keyCodePoint = proximityInfo->getCodePointOf(j);
-                if (std::find(searchKeyVector->begin(), searchKeyVector->end(), keyCodePoint)
-                        == searchKeyVector->end()) {
-                    searchKeyVector->push_back(keyCodePoint);
-                }
-            }
-        }
-    }
 }
 
 // Decreases char probabilities of index0 by checking probabilities of a near point (index1) and
 // increases char probabilities of index1 by checking probabilities of index0.
 /* static */ bool ProximityInfoStateUtils::suppressCharProbabilities(const int mostCommonKeyWidth,
-        const int sampledInputSize, const std::vector<int> *const lengthCache,
-        const int index0, const int index1,
-        std::vector<hash_map_compat<int, float> > *charProbabilities) {
+        const int keyCount, const int sampledInputSize, const std::vector<int> *const lengthCache,
+        const std::vector<NearKeycodesSet> *const sampledNearKeySets, const int index0,
+        const int index1, std::vector<float> *charProbabilities) {
     ASSERT(0 <= index0 && index0 < sampledInputSize);
     ASSERT(0 <= index1 && index1 < sampledInputSize);
     const float keyWidthFloat = static_cast<float>(mostCommonKeyWidth);
@@ -955,23 +1168,30 @@ namespace latinime {
     const float suppressionRate = ProximityInfoParams::MIN_SUPPRESSION_RATE
             + diff / keyWidthFloat / ProximityInfoParams::SUPPRESSION_LENGTH_WEIGHT
                     * ProximityInfoParams::SUPPRESSION_WEIGHT;
-    for (hash_map_compat<int, float>::iterator it = (*charProbabilities)[index0].begin();
-            it != (*charProbabilities)[index0].end(); ++it) {
-        hash_map_compat<int, float>::iterator it2 =  (*charProbabilities)[index1].find(it->first);
-        if (it2 != (*charProbabilities)[index1].end() && it->second < it2->second) {
-            const float newProbability = it->second * suppressionRate;
-            const float suppression = it->second - newProbability;
-            it->second = newProbability;
-            // mCharProbabilities[index0][NOT_AN_INDEX] is the probability of skipping this point.
-            (*charProbabilities)[index0][NOT_AN_INDEX] += suppression;
+    const int stride = keyCount + 1;
+    float *const probabilities0 = &(*charProbabilities)[index0 * stride];
+    float *const probabilities1 = &(*charProbabilities)[index1 * stride];
+    // probabilities[keyCount] is the probability of skipping the point. It is suppressed last.
+    NearKeycodesSet commonKeys = (*sampledNearKeySets)[index0] & (*sampledNearKeySets)[index1];
+    while (true) {
+        const int j = commonKeys ? __builtin_ctzll(commonKeys) : keyCount;
+        commonKeys &= commonKeys - 1;
+        if (probabilities0[j] < probabilities1[j]) {
+            const float newProbability = probabilities0[j] * suppressionRate;
+            const float suppression = probabilities0[j] - newProbability;
+            probabilities0[j] = newProbability;
+            probabilities0[keyCount] += suppression;
 
             // Add the probability of the same key nearby index1
             const float probabilityGain = min(suppression
                     * ProximityInfoParams::SUPPRESSION_WEIGHT_FOR_PROBABILITY_GAIN,
-                    (*charProbabilities)[index1][NOT_AN_INDEX]
+                    probabilities1[keyCount]
                             * ProximityInfoParams::SKIP_PROBABALITY_WEIGHT_FOR_PROBABILITY_GAIN);
-            it2->second += probabilityGain;
-            (*charProbabilities)[index1][NOT_AN_INDEX] -= probabilityGain;
+            probabilities1[j] += probabilityGain;
+            probabilities1[keyCount] -= probabilityGain;
+        }
+        if (j == keyCount) {
+            break;
         }
     }
     return true;
@@ -1006,33 +1226,49 @@ namespace latinime {
 }
 
 // Get a word that is detected by tracing the most probable string into codePointBuf and
-// returns probability of generating the word.
+// returns probability of generating the word. The length of the string and its probability are
+// kept for each point so that the tracing resumes from start when more points come in.
 /* static */ float ProximityInfoStateUtils::getMostProbableString(
-        const ProximityInfo *const proximityInfo, const int sampledInputSize,
-        const std::vector<hash_map_compat<int, float> > *const charProbabilities,
-        int *const codePointBuf) {
+        const ProximityInfo *const proximityInfo, const int start, const int sampledInputSize,
+        const int keyCount, const std::vector<float> *const charProbabilities,
+        const std::vector<NearKeycodesSet> *const sampledNearKeySets,
+        std::vector<int> *mostProbableStringLengths,
+        std::vector<float> *mostProbableStringLogProbabilities, int *const codePointBuf) {
     ASSERT(sampledInputSize >= 0);
-    memset(codePointBuf, 0, sizeof(codePointBuf[0]) * MAX_WORD_LENGTH);
-    int index = 0;
-    float sumLogProbability = 0.0f;
+    const int resumeIndex = min(start, static_cast<int>(mostProbableStringLengths->size()));
+    int index = resumeIndex > 0 ? (*mostProbableStringLengths)[resumeIndex - 1] : 0;
+    float sumLogProbability = resumeIndex > 0
+            ? (*mostProbableStringLogProbabilities)[resumeIndex - 1] : 0.0f;
+    memset(codePointBuf + index, 0, sizeof(codePointBuf[0]) * (MAX_WORD_LENGTH - index));
+    mostProbableStringLengths->resize(sampledInputSize);
+    mostProbableStringLogProbabilities->resize(sampledInputSize);
     // TODO: Current implementation is greedy algorithm. DP would be efficient for many cases.
-    for (int i = 0; i < sampledInputSize && index < MAX_WORD_LENGTH - 1; ++i) {
-        float minLogProbability = static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
-        int character = NOT_AN_INDEX;
-        for (hash_map_compat<int, float>::const_iterator it = (*charProbabilities)[i].begin();
-                it != (*charProbabilities)[i].end(); ++it) {
-            const float logProbability = (it->first != NOT_AN_INDEX)
-                    ? it->second + ProximityInfoParams::DEMOTION_LOG_PROBABILITY : it->second;
-            if (logProbability < minLogProbability) {
-                minLogProbability = logProbability;
-                character = it->first;
+    for (int i = resumeIndex; i < sampledInputSize; ++i) {
+        if (index < MAX_WORD_LENGTH - 1) {
+            const float *const probabilities = &(*charProbabilities)[i * (keyCount + 1)];
+            float minLogProbability = static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+            int character = NOT_AN_INDEX;
+            for (NearKeycodesSet keys = (*sampledNearKeySets)[i]; keys; keys &= keys - 1) {
+                const int j = __builtin_ctzll(keys);
+                const float logProbability =
+                        probabilities[j] + ProximityInfoParams::DEMOTION_LOG_PROBABILITY;
+                if (logProbability < minLogProbability) {
+                    minLogProbability = logProbability;
+                    character = j;
+                }
             }
+            if (probabilities[keyCount] < minLogProbability) {
+                minLogProbability = probabilities[keyCount];
+                character = NOT_AN_INDEX;
+            }
+            if (character != NOT_AN_INDEX) {
+                codePointBuf[index] = proximityInfo->getCodePointOf(character);
+                index++;
+            }
+            sumLogProbability += minLogProbability;
         }
-        if (character != NOT_AN_INDEX) {
-            codePointBuf[index] = proximityInfo->getCodePointOf(character);
-            index++;
-        }
-        sumLogProbability += minLogProbability;
+        (*mostProbableStringLengths)[i] = index;
+        (*mostProbableStringLogProbabilities)[i] = sumLogProbability;
     }
     codePointBuf[index] = '\0';
     return sumLogProbability;
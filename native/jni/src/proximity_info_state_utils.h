@@ -17,11 +17,11 @@
 #ifndef LATINIME_PROXIMITY_INFO_STATE_UTILS_H
 #define LATINIME_PROXIMITY_INFO_STATE_UTILS_H
 
-#include <bitset>
+#include <stdint.h>
 #include <vector>
 
 #include "defines.h"
-#include "hash_map_compat.h"
+#include "flat_hash_map.h"
 
 namespace latinime {
 class ProximityInfo;
@@ -29,8 +29,23 @@ class ProximityInfoParams;
 
 class ProximityInfoStateUtils {
  public:
-    typedef hash_map_compat<int, float> NearKeysDistanceMap;
-    typedef std::bitset<MAX_KEY_COUNT_IN_A_KEYBOARD> NearKeycodesSet;
+    // The distances of the keys near an input point, by key index. They are few enough for the
+    // inline slots.
+    typedef FlatHashMap<float, 32> NearKeysDistanceMap;
+    // A set of keys as a mask of key indices, which fits a word as there are at most
+    // MAX_KEY_COUNT_IN_A_KEYBOARD = 64 keys. The keys of a set are visited in ascending order by
+    // clearing its lowest bit.
+    typedef uint64_t NearKeycodesSet;
+    // The proximity types of the code points below this are kept in a table for each input index.
+    static const int PROXIMITY_TYPE_TABLE_SIZE = 0x100;
+
+    static AK_FORCE_INLINE NearKeycodesSet getKeyBit(const int keyIndex) {
+        return 1ULL << keyIndex;
+    }
+
+    static AK_FORCE_INLINE bool hasKey(const NearKeycodesSet keys, const int keyIndex) {
+        return (keys & getKeyBit(keyIndex)) != 0;
+    }
 
     static int trimLastTwoTouchPoints(std::vector<int> *sampledInputXs,
             std::vector<int> *sampledInputYs, std::vector<int> *sampledInputTimes,
@@ -39,7 +54,7 @@ class ProximityInfoStateUtils {
             const int maxPointToKeyLength, const int *const inputProximities,
             const int *const inputXCoordinates, const int *const inputYCoordinates,
             const int *const times, const int *const pointerIds,
-            const float verticalSweetSpotScale, const int inputSize,
+            const float verticalSweetSpotScale, const int samplingStep, const int inputSize,
             const bool isGeometric, const int pointerId, const int pushTouchPointStartIndex,
             std::vector<int> *sampledInputXs, std::vector<int> *sampledInputYs,
             std::vector<int> *sampledInputTimes, std::vector<int> *sampledLengthCache,
@@ -57,9 +72,9 @@ class ProximityInfoStateUtils {
             const std::vector<int> *const sampledLengthCache,
             const std::vector<int> *const sampledInputIndice,
             std::vector<float> *sampledSpeedRates, std::vector<float> *sampledDirections);
-    static void refreshBeelineSpeedRates(const int mostCommonKeyWidth,  const float averageSpeed,
+    static int refreshBeelineSpeedRates(const int mostCommonKeyWidth,  const float averageSpeed,
             const int inputSize, const int *const xCoordinates, const int *const yCoordinates,
-            const int *times, const int sampledInputSize,
+            const int *times, const int start, const int sampledInputSize,
             const std::vector<int> *const sampledInputXs,
             const std::vector<int> *const sampledInputYs, const std::vector<int> *const inputIndice,
             std::vector<int> *beelineSpeedPercentiles);
@@ -70,28 +85,36 @@ class ProximityInfoStateUtils {
             const int sampledInputSize, const std::vector<int> *const sampledInputXs,
             const std::vector<int> *const sampledInputYs,
             const std::vector<float> *const sampledSpeedRates,
+            const std::vector<float> *const sampledDirections,
             const std::vector<int> *const sampledLengthCache,
             const std::vector<float> *const sampledNormalizedSquaredLengthCache,
             std::vector<NearKeycodesSet> *sampledNearKeySets,
-            std::vector<hash_map_compat<int, float> > *charProbabilities);
+            std::vector<float> *charProbabilities);
+    static void updateAlignmentCosts(const int keyCount, const int sampledInputSize,
+            const std::vector<float> *const charProbabilities,
+            const std::vector<NearKeycodesSet> *const sampledNearKeySets,
+            std::vector<float> *keyAlignmentCosts, std::vector<float> *skipCostSums);
     static void updateSampledSearchKeySets(const ProximityInfo *const proximityInfo,
             const int sampledInputSize, const int lastSavedInputSize,
             const std::vector<int> *const sampledLengthCache,
             const std::vector<NearKeycodesSet> *const sampledNearKeySets,
-            std::vector<NearKeycodesSet> *sampledSearchKeySets,
-            std::vector<std::vector<int> > *sampledSearchKeyVectors);
+            std::vector<NearKeycodesSet> *sampledSearchKeySets);
     static float getPointToKeyByIdLength(const float maxPointToKeyLength,
             const std::vector<float> *const sampledNormalizedSquaredLengthCache, const int keyCount,
             const int inputIndex, const int keyId);
     static void initGeometricDistanceInfos(const ProximityInfo *const proximityInfo,
-            const int sampledInputSize, const int lastSavedInputSize,
-            const float verticalSweetSpotScale,
+            const float maxPointToKeyLength, const int sampledInputSize,
+            const int lastSavedInputSize, const float verticalSweetSpotScale,
             const std::vector<int> *const sampledInputXs,
             const std::vector<int> *const sampledInputYs,
             std::vector<NearKeycodesSet> *sampledNearKeySets,
             std::vector<float> *sampledNormalizedSquaredLengthCache);
     static void initPrimaryInputWord(const int inputSize, const int *const inputProximities,
             int *primaryInputWord);
+    static void initProximityTypes(const int inputSize, const int *const inputProximities,
+            uint8_t (*const proximityTypes)[PROXIMITY_TYPE_TABLE_SIZE]);
+    static ProximityType getProximityType(const int *const currentCodePoints,
+            const int codePoint, const bool checkProximityChars, int *proximityIndex);
     static void initNormalizedSquaredDistances(const ProximityInfo *const proximityInfo,
             const int inputSize, const int *inputXCoordinates, const int *inputYCoordinates,
             const int *const inputProximities, const std::vector<int> *const sampledInputXs,
@@ -111,9 +134,11 @@ class ProximityInfoStateUtils {
             const std::vector<int> *const sampledInputIndices);
     // TODO: Move to most_probable_string_utils.h
     static float getMostProbableString(const ProximityInfo *const proximityInfo,
-            const int sampledInputSize,
-            const std::vector<hash_map_compat<int, float> > *const charProbabilities,
-            int *const codePointBuf);
+            const int start, const int sampledInputSize, const int keyCount,
+            const std::vector<float> *const charProbabilities,
+            const std::vector<NearKeycodesSet> *const sampledNearKeySets,
+            std::vector<int> *mostProbableStringLengths,
+            std::vector<float> *mostProbableStringLogProbabilities, int *const codePointBuf);
 
  private:
     DISALLOW_IMPLICIT_CONSTRUCTORS(ProximityInfoStateUtils);
@@ -127,14 +152,14 @@ class ProximityInfoStateUtils {
             const NearKeysDistanceMap *const prevPrevNearKeysDistances);
     static float getPointScore(const int mostCommonKeyWidth, const int x, const int y,
             const int time, const bool lastPoint, const float nearest, const float sumAngle,
-            const NearKeysDistanceMap *const currentNearKeysDistances,
+            const int samplingStep, const NearKeysDistanceMap *const currentNearKeysDistances,
             const NearKeysDistanceMap *const prevNearKeysDistances,
             const NearKeysDistanceMap *const prevPrevNearKeysDistances,
             std::vector<int> *sampledInputXs, std::vector<int> *sampledInputYs);
     static bool pushTouchPoint(const ProximityInfo *const proximityInfo,
             const int maxPointToKeyLength, const int inputIndex, const int nodeCodePoint, int x,
             int y, const int time, const float verticalSweetSpotScale,
-            const bool doSampling, const bool isLastPoint,
+            const bool doSampling, const int samplingStep, const bool isLastPoint,
             const float sumAngle, NearKeysDistanceMap *const currentNearKeysDistances,
             const NearKeysDistanceMap *const prevNearKeysDistances,
             const NearKeysDistanceMap *const prevPrevNearKeysDistances,
@@ -146,15 +171,16 @@ class ProximityInfoStateUtils {
             const int *const yCoordinates, const int *times, const int sampledInputSize,
             const std::vector<int> *const sampledInputXs,
             const std::vector<int> *const sampledInputYs,
-            const std::vector<int> *const inputIndice);
+            const std::vector<int> *const inputIndice, int *const lookupEnd);
     static float getPointAngle(const std::vector<int> *const sampledInputXs,
             const std::vector<int> *const sampledInputYs, const int index);
     static float getPointsAngle(const std::vector<int> *const sampledInputXs,
             const std::vector<int> *const sampledInputYs, const int index0, const int index1,
             const int index2);
-    static bool suppressCharProbabilities(const int mostCommonKeyWidth,
-            const int sampledInputSize, const std::vector<int> *const lengthCache, const int index0,
-            const int index1, std::vector<hash_map_compat<int, float> > *charProbabilities);
+    static bool suppressCharProbabilities(const int mostCommonKeyWidth, const int keyCount,
+            const int sampledInputSize, const std::vector<int> *const lengthCache,
+            const std::vector<NearKeycodesSet> *const sampledNearKeySets, const int index0,
+            const int index1, std::vector<float> *charProbabilities);
     static float calculateSquaredDistanceFromSweetSpotCenter(
             const ProximityInfo *const proximityInfo, const std::vector<int> *const sampledInputXs,
             const std::vector<int> *const sampledInputYs, const int keyIndex,
@@ -18,18 +18,28 @@
 #define LATINIME_PROXIMITY_INFO_UTILS_H
 
 #include <cmath>
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif // defined(__ARM_NEON__) || defined(__ARM_NEON)
 
 #include "additional_proximity_chars.h"
 #include "char_utils.h"
 #include "defines.h"
 #include "geometry_utils.h"
-#include "hash_map_compat.h"
+#include "flat_hash_map.h"
+#include "proximity_grid.h"
 
 namespace latinime {
 class ProximityInfoUtils {
  public:
+    // The key index of each lower case key code point, which holds the keys of any keyboard
+    // without allocating.
+    typedef FlatHashMap<int, 2 * MAX_KEY_COUNT_IN_A_KEYBOARD> CodeToKeyMap;
+
     static AK_FORCE_INLINE int getKeyIndexOf(const int keyCount, const int c,
-            const hash_map_compat<int, int> *const codeToKeyMap) {
+            const CodeToKeyMap *const codeToKeyMap) {
         if (keyCount == 0) {
             // We do not have the coordinate data
             return NOT_AN_INDEX;
@@ -38,21 +48,17 @@ class ProximityInfoUtils {
             return NOT_AN_INDEX;
         }
         const int lowerCode = toLowerCase(c);
-        hash_map_compat<int, int>::const_iterator mapPos = codeToKeyMap->find(lowerCode);
-        if (mapPos != codeToKeyMap->end()) {
-            return mapPos->second;
-        }
-        return NOT_AN_INDEX;
+        const int *const keyIndex = codeToKeyMap->find(lowerCode);
+        return keyIndex ? *keyIndex : NOT_AN_INDEX;
     }
 
     static AK_FORCE_INLINE void initializeProximities(const int *const inputCodes,
             const int *const inputXCoordinates, const int *const inputYCoordinates,
             const int inputSize, const int *const keyXCoordinates,
             const int *const keyYCoordinates, const int *const keyWidths, const int *keyHeights,
-            const int *const proximityCharsArray, const int cellHeight, const int cellWidth,
-            const int gridWidth, const int mostCommonKeyWidth, const int keyCount,
-            const char *const localeStr,
-            const hash_map_compat<int, int> *const codeToKeyMap, int *inputProximities) {
+            const ProximityGrid *const proximityGrid, const int mostCommonKeyWidth,
+            const int keyCount, const char *const localeStr,
+            const CodeToKeyMap *const codeToKeyMap, int *inputProximities) {
         // Initialize
         // - mInputCodes
         // - mNormalizedSquaredDistances
@@ -63,8 +69,8 @@ class ProximityInfoUtils {
             const int y = inputYCoordinates[i];
             int *proximities = &inputProximities[i * MAX_PROXIMITY_CHARS_SIZE];
             calculateProximities(keyXCoordinates, keyYCoordinates, keyWidths, keyHeights,
-                    proximityCharsArray, cellHeight, cellWidth, gridWidth, mostCommonKeyWidth,
-                    keyCount, x, y, primaryKey, localeStr, codeToKeyMap, proximities);
+                    proximityGrid, mostCommonKeyWidth, keyCount, x, y, primaryKey, localeStr,
+                    codeToKeyMap, proximities);
         }
 
         if (DEBUG_PROXIMITY_CHARS) {
@@ -80,16 +86,49 @@ class ProximityInfoUtils {
         }
     }
 
-    static AK_FORCE_INLINE int getStartIndexFromCoordinates(const int x, const int y,
-            const int cellHeight, const int cellWidth, const int gridWidth) {
-        return ((y / cellHeight) * gridWidth + (x / cellWidth)) * MAX_PROXIMITY_CHARS_SIZE;
-    }
-
     static inline float getSquaredDistanceFloat(const float x1, const float y1, const float x2,
             const float y2) {
         return SQUARE_FLOAT(x1 - x2) + SQUARE_FLOAT(y1 - y2);
     }
 
+    // Computes the squared distances from (x, y) to the centers of keyCount keys, the center of
+    // key k being (centerXs[k], centerYs[k] + centerGapYs[k] * verticalScale). Four keys are
+    // scored at a time with NEON or SSE, with the same operations as getSquaredDistanceFloat.
+    static AK_FORCE_INLINE void getSquaredDistancesFloat(const float *const centerXs,
+            const float *const centerYs, const float *const centerGapYs,
+            const float verticalScale, const int keyCount, const float x, const float y,
+            float *const outSquaredDistances) {
+        int k = 0;
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+        const float32x4_t touchXs = vdupq_n_f32(x);
+        const float32x4_t touchYs = vdupq_n_f32(y);
+        const float32x4_t verticalScales = vdupq_n_f32(verticalScale);
+        for (; k + 4 <= keyCount; k += 4) {
+            const float32x4_t dx = vsubq_f32(vld1q_f32(centerXs + k), touchXs);
+            const float32x4_t centerY = vaddq_f32(vld1q_f32(centerYs + k),
+                    vmulq_f32(vld1q_f32(centerGapYs + k), verticalScales));
+            const float32x4_t dy = vsubq_f32(centerY, touchYs);
+            vst1q_f32(outSquaredDistances + k, vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)));
+        }
+#elif defined(__SSE__)
+        const __m128 touchXs = _mm_set1_ps(x);
+        const __m128 touchYs = _mm_set1_ps(y);
+        const __m128 verticalScales = _mm_set1_ps(verticalScale);
+        for (; k + 4 <= keyCount; k += 4) {
+            const __m128 dx = _mm_sub_ps(_mm_loadu_ps(centerXs + k), touchXs);
+            const __m128 centerY = _mm_add_ps(_mm_loadu_ps(centerYs + k),
+                    _mm_mul_ps(_mm_loadu_ps(centerGapYs + k), verticalScales));
+            const __m128 dy = _mm_sub_ps(centerY, touchYs);
+            _mm_storeu_ps(outSquaredDistances + k,
+                    _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        }
+#endif // defined(__ARM_NEON__) || defined(__ARM_NEON)
+        for (; k < keyCount; ++k) {
+            outSquaredDistances[k] = getSquaredDistanceFloat(centerXs[k],
+                    centerYs[k] + centerGapYs[k] * verticalScale, x, y);
+        }
+    }
+
     static inline float pointToLineSegSquaredDistanceFloat(const float x, const float y,
         const float x1, const float y1, const float x2, const float y2, const bool extend) {
         const float ray1x = x - x1;
@@ -153,17 +192,18 @@ class ProximityInfoUtils {
 
     static AK_FORCE_INLINE void calculateProximities(const int *const keyXCoordinates,
             const int *const keyYCoordinates, const int *const keyWidths, const int *keyHeights,
-            const int *const proximityCharsArray, const int cellHeight, const int cellWidth,
-            const int gridWidth, const int mostCommonKeyWidth, const int keyCount,
-            const int x, const int y, const int primaryKey, const char *const localeStr,
-            const hash_map_compat<int, int> *const codeToKeyMap, int *proximities) {
+            const ProximityGrid *const proximityGrid, const int mostCommonKeyWidth,
+            const int keyCount, const int x, const int y, const int primaryKey,
+            const char *const localeStr, const CodeToKeyMap *const codeToKeyMap,
+            int *proximities) {
         const int mostCommonKeyWidthSquare = mostCommonKeyWidth * mostCommonKeyWidth;
         int insertPos = 0;
         proximities[insertPos++] = primaryKey;
-        const int startIndex = getStartIndexFromCoordinates(x, y, cellHeight, cellWidth, gridWidth);
-        if (startIndex >= 0) {
-            for (int i = 0; i < MAX_PROXIMITY_CHARS_SIZE; ++i) {
-                const int c = proximityCharsArray[startIndex + i];
+        int cellCodePoints[MAX_PROXIMITY_CHARS_SIZE];
+        const int cellCodePointCount = proximityGrid->getCodePointsAt(x, y, cellCodePoints);
+        if (NOT_AN_INDEX != cellCodePointCount) {
+            for (int i = 0; i < cellCodePointCount; ++i) {
+                const int c = cellCodePoints[i];
                 if (c < KEYCODE_SPACE || c == primaryKey) {
                     continue;
                 }
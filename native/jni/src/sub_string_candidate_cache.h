@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_SUB_STRING_CANDIDATE_CACHE_H
+#define LATINIME_SUB_STRING_CANDIDATE_CACHE_H
+
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * The words found for the substrings of the input by one multiple word suggestion search. The
+ * search splits the input in many ways, and looks the same substrings up for each split. A
+ * candidate only depends on the position and the length of its substring, so it is looked up
+ * once per search.
+ */
+class SubStringCandidateCache {
+ public:
+    struct Candidate {
+        Candidate() : mStartPos(0), mLength(0), mFlag(0), mProbability(0), mWordLength(0),
+                mMatchedLength(0), mHasSearchedCorrections(false), mIsTraverseCountExceeded(false) {
+            memset(mWord, 0, sizeof(mWord));
+        }
+
+        int mStartPos;
+        int mLength;
+        // One of the UnigramDictionary::FLAG_MULTIPLE_SUGGEST_* flags. When it is
+        // FLAG_MULTIPLE_SUGGEST_CONTINUE, the probability and the word are the ones found.
+        int mFlag;
+        int mProbability;
+        int mWordLength;
+        // The length of the substring as the word matched it, where a digraph matched to its
+        // composite glyph counts as one char
+        int mMatchedLength;
+        // Whether the lookup searched the corrections of the substring. The search counts as a
+        // traversal, and leaves the correction initialized with the substring instead of the
+        // whole input.
+        bool mHasSearchedCorrections;
+        // Whether the search was skipped because of the limit of the traversals
+        bool mIsTraverseCountExceeded;
+        int mWord[MAX_WORD_LENGTH];
+    };
+
+    SubStringCandidateCache() : mCandidates(), mReusedCandidateIndex(NOT_AN_INDEX) {
+        memset(mCandidateIndices, 0, sizeof(mCandidateIndices));
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    ~SubStringCandidateCache() {}
+
+    // Returns the candidate of the substring, or 0 if it has not been looked up yet.
+    AK_FORCE_INLINE const Candidate *get(const int startPos, const int length) const {
+        ASSERT(isInRange(startPos, length));
+        const int index = mCandidateIndices[startPos][length - 1];
+        return index > 0 ? &mCandidates[index - 1] : 0;
+    }
+
+    // Returns a new candidate to fill for the substring.
+    Candidate *add(const int startPos, const int length) {
+        ASSERT(isInRange(startPos, length));
+        mReusedCandidateIndex = NOT_AN_INDEX;
+        mCandidates.push_back(Candidate());
+        mCandidateIndices[startPos][length - 1] = static_cast<uint16_t>(mCandidates.size());
+        Candidate *const candidate = &mCandidates.back();
+        candidate->mStartPos = startPos;
+        candidate->mLength = length;
+        return candidate;
+    }
+
+    // Records that the candidate has been reused without the lookup that initializes the
+    // correction.
+    void onReused(const Candidate *const candidate) {
+        mReusedCandidateIndex = static_cast<int>(candidate - &mCandidates[0]);
+    }
+
+    // Returns the candidate whose lookup would have initialized the correction last, or 0 if the
+    // correction is already initialized as that lookup left it.
+    const Candidate *getReusedCandidate() const {
+        return mReusedCandidateIndex != NOT_AN_INDEX ? &mCandidates[mReusedCandidateIndex] : 0;
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(SubStringCandidateCache);
+
+    static AK_FORCE_INLINE bool isInRange(const int startPos, const int length) {
+        return startPos >= 0 && startPos < MAX_WORD_LENGTH && length > 0
+                && length <= MULTIPLE_WORDS_SUGGESTION_MAX_WORD_LENGTH;
+    }
+
+    std::vector<Candidate> mCandidates;
+    // 1 + the index in mCandidates of the candidate of each substring, or 0
+    uint16_t mCandidateIndices[MAX_WORD_LENGTH][MULTIPLE_WORDS_SUGGESTION_MAX_WORD_LENGTH];
+    int mReusedCandidateIndex;
+};
+} // namespace latinime
+#endif // LATINIME_SUB_STRING_CANDIDATE_CACHE_H
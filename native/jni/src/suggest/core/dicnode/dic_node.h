@@ -27,16 +27,18 @@
 
 #if DEBUG_DICT
 #define LOGI_SHOW_ADD_COST_PROP \
-        do { char charBuf[50]; \
-        INTS_TO_CHARS(getOutputWordBuf(), getDepth(), charBuf); \
+        do { char charBuf[50]; int codePoints[MAX_WORD_LENGTH]; \
+        INTS_TO_CHARS(getOutputCodePoints(codePoints), getDepth(), charBuf); \
         AKLOGI("%20s, \"%c\", size = %03d, total = %03d, index(0) = %02d, dist = %.4f, %s,,", \
                 __FUNCTION__, getNodeCodePoint(), inputSize, getTotalInputIndex(), \
                 getInputIndex(0), getNormalizedCompoundDistance(), charBuf); } while (0)
 #define DUMP_WORD_AND_SCORE(header) \
-        do { char charBuf[50]; char prevWordCharBuf[50]; \
-        INTS_TO_CHARS(getOutputWordBuf(), getDepth(), charBuf); \
-        INTS_TO_CHARS(mDicNodeState.mDicNodeStatePrevWord.mPrevWord, \
-                mDicNodeState.mDicNodeStatePrevWord.getPrevWordLength(), prevWordCharBuf); \
+        do { char charBuf[50]; char prevWordCharBuf[50]; int prevWord[MAX_WORD_LENGTH]; \
+        int codePoints[MAX_WORD_LENGTH]; \
+        INTS_TO_CHARS(getOutputCodePoints(codePoints), getDepth(), charBuf); \
+        mDicNodeState.mDicNodeStatePrevWord.outputPrevWordCodePoints(prevWord); \
+        INTS_TO_CHARS(prevWord, mDicNodeState.mDicNodeStatePrevWord.getPrevWordLength(), \
+                prevWordCharBuf); \
         AKLOGI("#%8s, %5f, %5f, %5f, %5f, %s, %s, %d,,", header, \
                 getSpatialDistanceForScoring(), getLanguageDistanceForScoring(), \
                 getNormalizedCompoundDistance(), getRawLength(), prevWordCharBuf, charBuf, \
@@ -90,7 +92,8 @@ class DicNode {
 
     DicNode(const DicNode &dicNode);
     DicNode &operator=(const DicNode &dicNode);
-    virtual ~DicNode() {}
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~DicNode() {}
 
     // TODO: minimize arguments by looking binary_format
     // Init for copy
@@ -119,14 +122,14 @@ class DicNode {
         mIsCachedForNextSuggestion = parentNode->mIsCachedForNextSuggestion;
         const int c = parentNode->getNodeTypedCodePoint();
         mDicNodeProperties.init(&parentNode->mDicNodeProperties, c);
-        mDicNodeState.init(&parentNode->mDicNodeState);
+        mDicNodeState.initAsChild(&parentNode->mDicNodeState);
         PROF_NODE_COPY(&parentNode->mProfiler, mProfiler);
     }
 
     // TODO: minimize arguments by looking binary_format
     // Init for root with previous word
     void initAsRootWithPreviousWord(DicNode *dicNode, const int pos, const int childrenPos,
-            const int childrenCount) {
+            const int childrenCount, DicNodePrevWordChains *const prevWordChains) {
         mIsUsed = true;
         mIsCachedForNextSuggestion = false;
         mDicNodeProperties.init(
@@ -137,16 +140,16 @@ class DicNode {
                 &dicNode->mDicNodeState.mDicNodeStateInput, true /* resetTerminalDiffCost */);
         mDicNodeState.mDicNodeStateScoring.init(
                 &dicNode->mDicNodeState.mDicNodeStateScoring);
+        int codePoints[MAX_WORD_LENGTH];
         mDicNodeState.mDicNodeStatePrevWord.init(
                 dicNode->mDicNodeState.mDicNodeStatePrevWord.getPrevWordCount() + 1,
                 dicNode->mDicNodeProperties.getProbability(),
                 dicNode->mDicNodeProperties.getPos(),
-                dicNode->mDicNodeState.mDicNodeStatePrevWord.mPrevWord,
-                dicNode->mDicNodeState.mDicNodeStatePrevWord.getPrevWordLength(),
-                dicNode->getOutputWordBuf(),
+                &dicNode->mDicNodeState.mDicNodeStatePrevWord,
+                dicNode->getOutputCodePoints(codePoints),
                 dicNode->mDicNodeProperties.getDepth(),
-                dicNode->mDicNodeState.mDicNodeStatePrevWord.mPrevSpacePositions,
-                mDicNodeState.mDicNodeStateInput.getInputIndex(0) /* lastInputIndex */);
+                mDicNodeState.mDicNodeStateInput.getInputIndex(0) /* lastInputIndex */,
+                prevWordChains);
         PROF_NODE_COPY(&dicNode->mProfiler, mProfiler);
     }
 
@@ -164,7 +167,8 @@ class DicNode {
         mDicNodeProperties.init(pos, flags, childrenPos, attributesPos, siblingPos, nodeCodePoint,
                 childrenCount, probability, bigramProbability, isTerminal, hasMultipleChars,
                 hasChildren, newDepth, newLeavingDepth);
-        mDicNodeState.init(&dicNode->mDicNodeState, additionalSubwordLength, additionalSubword);
+        mDicNodeState.initAsChild(&dicNode->mDicNodeState, additionalSubwordLength,
+                additionalSubword);
         PROF_NODE_COPY(&dicNode->mProfiler, mProfiler);
     }
 
@@ -220,7 +224,7 @@ class DicNode {
     }
 
     bool isFirstCharUppercase() const {
-        const int c = getOutputWordBuf()[0];
+        const int c = mDicNodeState.mDicNodeStateOutput.getCodePointAt(0);
         return isAsciiUpper(c);
     }
 
@@ -236,6 +240,13 @@ class DicNode {
         return mDicNodeState.mDicNodeStateInput.getInputIndex(0) < inputSize - 1;
     }
 
+    // Whether both dicNodes output the same words: the same terminal after the same previous words,
+    // whichever corrections they went through.
+    AK_FORCE_INLINE bool isSameWord(const DicNode *const right) const {
+        return getPos() == right->getPos() && mDicNodeState.mDicNodeStatePrevWord.hasSamePrevWords(
+                &right->mDicNodeState.mDicNodeStatePrevWord);
+    }
+
     // Used to get bigram probability in DicNodeUtils
     int getPos() const {
         return mDicNodeProperties.getPos();
@@ -287,38 +298,59 @@ class DicNode {
         return prevWordsLen + currentWordDepth > MAX_WORD_LENGTH - 3;
     }
 
-    // TODO: This may be defective. Needs to be revised.
-    bool truncateNode(const DicNode *const topNode, const int inputCommitPoint) {
-        const int prevWordLenOfTop = mDicNodeState.mDicNodeStatePrevWord.getPrevWordLength();
-        int newPrevWordStartIndex = inputCommitPoint;
+    // The number of code points of the previous words before their inputCommitPoint-th letter.
+    int getPrevWordCommitOffset(const int inputCommitPoint) const {
+        const int prevWordLength = mDicNodeState.mDicNodeStatePrevWord.getPrevWordLength();
+        int prevWord[MAX_WORD_LENGTH];
+        mDicNodeState.mDicNodeStatePrevWord.outputPrevWordCodePoints(prevWord);
         int charCount = 0;
-        // Find new word start index
-        for (int i = 0; i < prevWordLenOfTop; ++i) {
-            const int c = mDicNodeState.mDicNodeStatePrevWord.getPrevWordCodePointAt(i);
+        for (int i = 0; i < prevWordLength; ++i) {
+            const int c = prevWord[i];
             // TODO: Check other separators.
             if (c != KEYCODE_SPACE && c != KEYCODE_SINGLE_QUOTE) {
                 if (charCount == inputCommitPoint) {
-                    newPrevWordStartIndex = i;
-                    break;
+                    return i;
                 }
                 ++charCount;
             }
         }
+        return inputCommitPoint;
+    }
+
+    // Drops the input and the previous words before the commit point if the dicNode starts with
+    // the same previous words as topNode, whose offset is topPrevWordOffset. The previous words
+    // are copied to truncatedChains, which replace the chains of the dicNode once all the dicNodes
+    // are truncated. copiedIndices has the records copied so far with topPrevWordOffset.
+    // TODO: This may be defective. Needs to be revised.
+    bool truncateNode(const DicNode *const topNode, const int inputCommitPoint,
+            const int topPrevWordOffset, DicNodePrevWordChains *const truncatedChains,
+            DicNodePrevWordChains::CopiedIndexMap *const copiedIndices) {
+        const int newPrevWordStartIndex = getPrevWordCommitOffset(inputCommitPoint);
         if (!mDicNodeState.mDicNodeStatePrevWord.startsWith(
                 &topNode->mDicNodeState.mDicNodeStatePrevWord, newPrevWordStartIndex - 1)) {
             // Node mismatch.
             return false;
         }
         mDicNodeState.mDicNodeStateInput.truncate(inputCommitPoint);
-        mDicNodeState.mDicNodeStatePrevWord.truncate(newPrevWordStartIndex);
+        if (newPrevWordStartIndex == topPrevWordOffset) {
+            mDicNodeState.mDicNodeStatePrevWord.truncate(newPrevWordStartIndex, truncatedChains,
+                    copiedIndices);
+        } else {
+            DicNodePrevWordChains::CopiedIndexMap otherCopiedIndices;
+            mDicNodeState.mDicNodeStatePrevWord.truncate(newPrevWordStartIndex, truncatedChains,
+                    &otherCopiedIndices);
+        }
         return true;
     }
 
     void outputResult(int *dest) const {
         const uint16_t prevWordLength = mDicNodeState.mDicNodeStatePrevWord.getPrevWordLength();
         const uint16_t currentDepth = getDepth();
-        DicNodeUtils::appendTwoWords(mDicNodeState.mDicNodeStatePrevWord.mPrevWord,
-                   prevWordLength, getOutputWordBuf(), currentDepth, dest);
+        int prevWord[MAX_WORD_LENGTH];
+        int codePoints[MAX_WORD_LENGTH];
+        mDicNodeState.mDicNodeStatePrevWord.outputPrevWordCodePoints(prevWord);
+        DicNodeUtils::appendTwoWords(prevWord, prevWordLength, getOutputCodePoints(codePoints),
+                currentDepth, dest);
         DUMP_WORD_AND_SCORE("OUTPUT");
     }
 
@@ -364,8 +396,10 @@ class DicNode {
         return mDicNodeState.mDicNodeStatePrevWord.getPrevWordNodePos();
     }
 
-    AK_FORCE_INLINE const int *getOutputWordBuf() const {
-        return mDicNodeState.mDicNodeStateOutput.mWordBuf;
+    // Returns the code points of the word, which are written to buffer if they are not all in
+    // this dicNode.
+    AK_FORCE_INLINE const int *getOutputCodePoints(int *const buffer) const {
+        return mDicNodeState.mDicNodeStateOutput.getCodePoints(buffer);
     }
 
     int getPrevCodePointG(int pointerId) const {
@@ -492,7 +526,7 @@ class DicNode {
         mReleaseListener = releaseListener;
     }
 
-    AK_FORCE_INLINE bool compare(const DicNode *right) {
+    AK_FORCE_INLINE bool compare(const DicNode *right) const {
         if (!isUsed() && !right->isUsed()) {
             // Compare pointer values here for stable comparison
             return this > right;
@@ -516,9 +550,14 @@ class DicNode {
         if (depthDiff != 0) {
             return depthDiff > 0;
         }
+        // The dicNodes of the queues are copies, which have all of their code points.
+        int codePointsBuffer[MAX_WORD_LENGTH];
+        int rightCodePointsBuffer[MAX_WORD_LENGTH];
+        const int *const codePoints = getOutputCodePoints(codePointsBuffer);
+        const int *const rightCodePoints = right->getOutputCodePoints(rightCodePointsBuffer);
         for (int i = 0; i < depth; ++i) {
-            const int codePoint = mDicNodeState.mDicNodeStateOutput.getCodePointAt(i);
-            const int rightCodePoint = right->mDicNodeState.mDicNodeStateOutput.getCodePointAt(i);
+            const int codePoint = codePoints[i];
+            const int rightCodePoint = rightCodePoints[i];
             if (codePoint != rightCodePoint) {
                 return rightCodePoint > codePoint;
             }
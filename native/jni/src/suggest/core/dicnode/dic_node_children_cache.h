@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_DIC_NODE_CHILDREN_CACHE_H
+#define LATINIME_DIC_NODE_CHILDREN_CACHE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "memory_utils.h"
+
+namespace latinime {
+
+/**
+ * A bounded, direct-mapped cache of decoded children groups keyed by the position of the group
+ * in the dictionary. The same groups are expanded repeatedly: for the omission and insertion
+ * corrections, from the root of every new word and again in each keystroke of a continued
+ * search. A cached group is copied into child dicNodes without parsing the byte stream again.
+ * Not thread safe; each expanding thread has its own cache.
+ */
+class DicNodeChildrenCache {
+ public:
+    // A child group as read by DicNodeUtils::createAndGetLeavingChildNode.
+    struct DecodedChild {
+        int mPos;
+        int mChildrenPos;
+        int mAttributesPos;
+        int mSiblingPos;
+        int mCodePoint;
+        int mChildrenCount;
+        int mProbability;
+        // Index of the code points of this group in the code point buffer of the entry.
+        int mSubwordStart;
+        uint16_t mSubwordLength;
+        uint8_t mFlags;
+    };
+
+    class Entry {
+     public:
+        Entry() : mDicRoot(0), mChildrenPos(NOT_AN_INDEX), mChildren(), mCodePoints() {}
+
+        int getChildCount() const {
+            return static_cast<int>(mChildren.size());
+        }
+
+        const DecodedChild *getChildAt(const int index) const {
+            return &mChildren[index];
+        }
+
+        const int *getSubwordOf(const DecodedChild *const child) const {
+            return &mCodePoints[child->mSubwordStart];
+        }
+
+        // Adds a child with its code points. The caller fills the other fields.
+        DecodedChild *addChild(const int *const subword, const uint16_t subwordLength) {
+            mChildren.push_back(DecodedChild());
+            DecodedChild *const child = &mChildren.back();
+            child->mSubwordStart = static_cast<int>(mCodePoints.size());
+            child->mSubwordLength = subwordLength;
+            mCodePoints.insert(mCodePoints.end(), subword, subword + subwordLength);
+            return child;
+        }
+
+     private:
+        DISALLOW_COPY_AND_ASSIGN(Entry);
+        friend class DicNodeChildrenCache;
+
+        const uint8_t *mDicRoot;
+        int mChildrenPos;
+        std::vector<DecodedChild> mChildren;
+        std::vector<int> mCodePoints;
+    };
+
+    DicNodeChildrenCache() {}
+
+    // Non virtual inline destructor -- never inherit this class
+    ~DicNodeChildrenCache() {}
+
+    // Returns the cached children of the group at childrenPos, or 0.
+    AK_FORCE_INLINE const Entry *get(const uint8_t *const dicRoot, const int childrenPos) const {
+        const Entry *const entry = &mEntries[getEntryIndex(childrenPos)];
+        if (entry->mDicRoot != dicRoot || entry->mChildrenPos != childrenPos) {
+            return 0;
+        }
+        return entry;
+    }
+
+    // Returns the entry to fill for the group at childrenPos, evicting the group that shares it.
+    AK_FORCE_INLINE Entry *getEntryToFill(const uint8_t *const dicRoot, const int childrenPos) {
+        Entry *const entry = &mEntries[getEntryIndex(childrenPos)];
+        entry->mDicRoot = dicRoot;
+        entry->mChildrenPos = childrenPos;
+        entry->mChildren.clear();
+        entry->mCodePoints.clear();
+        return entry;
+    }
+
+    // The bytes allocated for the decoded groups, including the retained capacity.
+    int getMemorySize() const {
+        int memorySize = 0;
+        for (int i = 0; i < ENTRY_COUNT; ++i) {
+            memorySize += MemoryUtils::getVectorMemorySize(&mEntries[i].mChildren)
+                    + MemoryUtils::getVectorMemorySize(&mEntries[i].mCodePoints);
+        }
+        return memorySize;
+    }
+
+    // Drops all the groups, e.g. because a dictionary was opened at the address of another one.
+    void clear() {
+        for (int i = 0; i < ENTRY_COUNT; ++i) {
+            mEntries[i].mDicRoot = 0;
+            mEntries[i].mChildrenPos = NOT_AN_INDEX;
+        }
+    }
+
+    // Groups with more children than this are read from the dictionary every time.
+    static const int MAX_CACHED_CHILD_COUNT = 128;
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(DicNodeChildrenCache);
+    // Must be a power of 2
+    static const int ENTRY_COUNT = 256;
+
+    static AK_FORCE_INLINE int getEntryIndex(const int childrenPos) {
+        // Fibonacci hashing: children positions are close to each other in the dictionary.
+        return static_cast<int>((static_cast<uint32_t>(childrenPos) * 2654435769U) >> 24)
+                & (ENTRY_COUNT - 1);
+    }
+
+    Entry mEntries[ENTRY_COUNT];
+};
+} // namespace latinime
+#endif // LATINIME_DIC_NODE_CHILDREN_CACHE_H
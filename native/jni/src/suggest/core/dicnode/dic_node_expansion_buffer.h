@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_DIC_NODE_EXPANSION_BUFFER_H
+#define LATINIME_DIC_NODE_EXPANSION_BUFFER_H
+
+#include <vector>
+
+#include "defines.h"
+#include "dic_node.h"
+#include "dic_node_children_cache.h"
+#include "dic_node_vector.h"
+#include "memory_utils.h"
+
+namespace latinime {
+
+// Records the outputs of expanding dic nodes on a worker thread. Pushing to the DicNodesCache and
+// weighting with the bigram map are not thread safe, so they are deferred and applied in order on
+// the calling thread afterwards.
+class DicNodeExpansionBuffer {
+ public:
+    enum OutputType {
+        // The node is to be pushed to the next active queue.
+        OUTPUT_NEXT_ACTIVE,
+        // The node is a terminal that is not weighted as a terminal yet.
+        OUTPUT_TERMINAL,
+        // The node is the last node of a word after which a new word starts.
+        OUTPUT_NEXT_WORD,
+        // Same as above for the space substitution error correction.
+        OUTPUT_NEXT_WORD_BY_SPACE_SUBSTITUTION
+    };
+
+    AK_FORCE_INLINE DicNodeExpansionBuffer()
+            : mChildDicNodes(), mCorrectionDicNodes(), mTranspositionDicNodes(),
+              mChildrenCache(), mDicNodes(),
+              mOutputTypes(), mSize(0), mEmptyDicNode() {}
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~DicNodeExpansionBuffer() {}
+
+    // Keeps the storage to avoid reallocating it for every input index.
+    AK_FORCE_INLINE void clear() {
+        mSize = 0;
+    }
+
+    AK_FORCE_INLINE void push(const OutputType outputType, DicNode *const dicNode) {
+        if (mSize == static_cast<int>(mDicNodes.size())) {
+            mDicNodes.push_back(mEmptyDicNode);
+            mOutputTypes.push_back(outputType);
+        }
+        mDicNodes[mSize].initByCopy(dicNode);
+        mOutputTypes[mSize] = outputType;
+        ++mSize;
+    }
+
+    int getSize() const {
+        return mSize;
+    }
+
+    // The bytes allocated for the outputs and the scratch vectors, without the children cache.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mDicNodes)
+                + MemoryUtils::getVectorMemorySize(&mOutputTypes)
+                + mChildDicNodes.getMemorySize() + mCorrectionDicNodes.getMemorySize()
+                + mTranspositionDicNodes.getMemorySize();
+    }
+
+    OutputType getOutputTypeAt(const int index) const {
+        ASSERT(index < mSize);
+        return mOutputTypes[index];
+    }
+
+    DicNode *getDicNodeAt(const int index) {
+        ASSERT(index < mSize);
+        return &mDicNodes[index];
+    }
+
+    // Scratch vector of the worker to get child nodes
+    DicNodeVector *getChildDicNodes() {
+        return &mChildDicNodes;
+    }
+
+    // Scratch vector of the worker to get child nodes for omission, insertion and the first
+    // letter of transposition. They are got while iterating the vector above.
+    DicNodeVector *getCorrectionDicNodes() {
+        return &mCorrectionDicNodes;
+    }
+
+    // Scratch vector of the worker to get the second letter of transposition.
+    DicNodeVector *getTranspositionDicNodes() {
+        return &mTranspositionDicNodes;
+    }
+
+    // Decoded children cache of the worker. It is kept across searches.
+    DicNodeChildrenCache *getChildrenCache() {
+        return &mChildrenCache;
+    }
+
+    const DicNodeChildrenCache *getChildrenCache() const {
+        return &mChildrenCache;
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(DicNodeExpansionBuffer);
+    DicNodeVector mChildDicNodes;
+    DicNodeVector mCorrectionDicNodes;
+    DicNodeVector mTranspositionDicNodes;
+    DicNodeChildrenCache mChildrenCache;
+    std::vector<DicNode> mDicNodes;
+    std::vector<OutputType> mOutputTypes;
+    int mSize;
+    DicNode mEmptyDicNode;
+};
+} // namespace latinime
+#endif // LATINIME_DIC_NODE_EXPANSION_BUFFER_H
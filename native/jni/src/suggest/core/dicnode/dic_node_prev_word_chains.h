@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_DIC_NODE_PREV_WORD_CHAINS_H
+#define LATINIME_DIC_NODE_PREV_WORD_CHAINS_H
+
+#include <cstring> // for memcpy()
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "flat_hash_map.h"
+#include "memory_utils.h"
+
+namespace latinime {
+
+/**
+ * The previous words of the multi-word dicNodes of a session. Each word that ends in a dicNode is
+ * an immutable record that links to the record of the word before it, so the dicNodes of the same
+ * words share one chain and copying a dicNode copies the index of its last record only.
+ *
+ * Records are only appended, on the thread of the session, and are all dropped when the search
+ * restarts from the root without any dicNode of the previous searches. A partial commit copies the
+ * chains of the remaining dicNodes without the committed words into new chains, which replace
+ * these ones, so that the records stay shared and bounded however many words get committed.
+ */
+class DicNodePrevWordChains {
+ public:
+    // Maps the records of a chain to their copies in other chains.
+    typedef FlatHashMap<int, 64> CopiedIndexMap;
+
+    AK_FORCE_INLINE DicNodePrevWordChains() : mRecords(), mCodePoints() {}
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~DicNodePrevWordChains() {}
+
+    // Keeps the storage for the next searches.
+    AK_FORCE_INLINE void clear() {
+        mRecords.clear();
+        mCodePoints.clear();
+    }
+
+    AK_FORCE_INLINE void swap(DicNodePrevWordChains *const other) {
+        mRecords.swap(other->mRecords);
+        mCodePoints.swap(other->mCodePoints);
+    }
+
+    // Whether the chains should be cleared before more words are appended. The records of one
+    // search stay far below this, but the searches that continue the previous ones keep adding.
+    AK_FORCE_INLINE bool isFull() const {
+        return static_cast<int>(mCodePoints.size()) >= MAX_CODE_POINT_COUNT;
+    }
+
+    // Appends the record of a word that follows the chain of parentIndex, or NOT_AN_INDEX for the
+    // first word, and returns its index. spacePosition is the input index of the space after it.
+    AK_FORCE_INLINE int append(const int parentIndex, const int *const codePoints,
+            const int length, const int spacePosition) {
+        Record record;
+        record.mParentIndex = parentIndex;
+        record.mCodePointStart = static_cast<int>(mCodePoints.size());
+        record.mLength = static_cast<int16_t>(length);
+        record.mTotalLength = static_cast<int16_t>(length + getTotalLength(parentIndex));
+        record.mSpacePosition = spacePosition;
+        mCodePoints.insert(mCodePoints.end(), codePoints, codePoints + length);
+        mRecords.push_back(record);
+        return static_cast<int>(mRecords.size()) - 1;
+    }
+
+    AK_FORCE_INLINE int getParentIndex(const int index) const {
+        return mRecords[index].mParentIndex;
+    }
+
+    AK_FORCE_INLINE int getLength(const int index) const {
+        return mRecords[index].mLength;
+    }
+
+    AK_FORCE_INLINE int getSpacePosition(const int index) const {
+        return mRecords[index].mSpacePosition;
+    }
+
+    AK_FORCE_INLINE const int *getCodePoints(const int index) const {
+        return mRecords[index].mLength > 0 ? &mCodePoints[mRecords[index].mCodePointStart] : 0;
+    }
+
+    // The length of the words of the chain that ends at index.
+    AK_FORCE_INLINE int getTotalLength(const int index) const {
+        return index == NOT_AN_INDEX ? 0 : mRecords[index].mTotalLength;
+    }
+
+    // Writes the getTotalLength(index) code points of the words of the chain that ends at index.
+    AK_FORCE_INLINE void outputCodePoints(const int index, int *const dest) const {
+        for (int i = index; i != NOT_AN_INDEX; i = mRecords[i].mParentIndex) {
+            const Record *const record = &mRecords[i];
+            if (record->mLength == 0) {
+                continue;
+            }
+            memcpy(&dest[record->mTotalLength - record->mLength],
+                    &mCodePoints[record->mCodePointStart], record->mLength * sizeof(dest[0]));
+        }
+    }
+
+    // Appends to dest the chain that ends at index without its first offset code points, keeping a
+    // record for each word and the space positions, and returns the index of the copy. The records
+    // that copiedIndices has, which must have been copied with the same offset, are not copied
+    // again, and the new copies are added to it.
+    int copyTruncatedChain(const int index, const int offset, DicNodePrevWordChains *const dest,
+            CopiedIndexMap *const copiedIndices) const {
+        int chainIndices[MAX_WORD_LENGTH];
+        int chainSize = 0;
+        int copiedIndex = NOT_AN_INDEX;
+        for (int i = index; i != NOT_AN_INDEX && chainSize < MAX_WORD_LENGTH;
+                i = mRecords[i].mParentIndex) {
+            const int *const copiedRecordIndex = copiedIndices->find(i);
+            if (copiedRecordIndex) {
+                copiedIndex = *copiedRecordIndex;
+                break;
+            }
+            chainIndices[chainSize++] = i;
+        }
+        for (int i = chainSize - 1; i >= 0; --i) {
+            const Record *const record = &mRecords[chainIndices[i]];
+            const int skippedLength = min(max(offset - (record->mTotalLength - record->mLength), 0),
+                    static_cast<int>(record->mLength));
+            copiedIndex = dest->append(copiedIndex, getCodePoints(chainIndices[i]) + skippedLength,
+                    record->mLength - skippedLength, record->mSpacePosition);
+            copiedIndices->put(chainIndices[i], copiedIndex);
+        }
+        return copiedIndex;
+    }
+
+    // The bytes allocated for the chains. Cleared chains keep their storage.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mRecords)
+                + MemoryUtils::getVectorMemorySize(&mCodePoints);
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(DicNodePrevWordChains);
+
+    struct Record {
+        int mParentIndex;
+        int mCodePointStart;
+        int16_t mLength;
+        int16_t mTotalLength;
+        int mSpacePosition;
+    };
+
+    static const int MAX_CODE_POINT_COUNT = 1 << 17;
+
+    std::vector<Record> mRecords;
+    std::vector<int> mCodePoints;
+};
+} // namespace latinime
+#endif // LATINIME_DIC_NODE_PREV_WORD_CHAINS_H
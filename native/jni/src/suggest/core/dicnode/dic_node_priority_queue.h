@@ -17,10 +17,10 @@
 #ifndef LATINIME_DIC_NODE_PRIORITY_QUEUE_H
 #define LATINIME_DIC_NODE_PRIORITY_QUEUE_H
 
-#include <queue>
 #include <vector>
 
 #include "defines.h"
+#include "memory_utils.h"
 #include "dic_node.h"
 #include "dic_node_release_listener.h"
 
@@ -30,12 +30,25 @@ namespace latinime {
 
 class DicNodePriorityQueue : public DicNodeReleaseListener {
  public:
+    // The queue holds no nodes until init() hands it its slots.
     AK_FORCE_INLINE DicNodePriorityQueue()
-            : MAX_CAPACITY(MAX_DIC_NODE_PRIORITY_QUEUE_CAPACITY),
-              mMaxSize(MAX_DIC_NODE_PRIORITY_QUEUE_CAPACITY), mDicNodesBuf(), mUnusedNodeIndices(),
-              mNextUnusedNodeId(0), mDicNodesQueue() {
-        mDicNodesBuf.resize(MAX_CAPACITY + 1);
-        mUnusedNodeIndices.resize(MAX_CAPACITY + 1);
+            : mCapacity(0), mMaxSize(0), mDicNodesBuf(0), mUnusedNodeIndices(),
+              mNodeGenerations(), mGeneration(0), mNextUnusedNodeId(NOT_A_NODE_ID),
+              mNextFreshNodeId(0), mDicNodesHeap() {}
+
+    // Makes the queue draw its nodes from the capacity + 1 nodes at dicNodesBuf, which are owned
+    // by the caller and must outlive the queue. The extra node takes a new node while a full queue
+    // decides which node to drop.
+    AK_FORCE_INLINE void init(DicNode *const dicNodesBuf, const int capacity) {
+        mCapacity = capacity;
+        mDicNodesBuf = dicNodesBuf;
+        mUnusedNodeIndices.resize(mCapacity + 1);
+        mNodeGenerations.resize(mCapacity + 1);
+        mDicNodesHeap.reserve(mCapacity + 1);
+        for (int i = 0; i < mCapacity + 1; ++i) {
+            mDicNodesBuf[i].setReleaseListener(this);
+            mNodeGenerations[i] = NOT_A_GENERATION;
+        }
         reset();
     }
 
@@ -43,36 +56,64 @@ class DicNodePriorityQueue : public DicNodeReleaseListener {
     AK_FORCE_INLINE ~DicNodePriorityQueue() {}
 
     int getSize() const {
-        return static_cast<int>(mDicNodesQueue.size());
+        return static_cast<int>(mDicNodesHeap.size());
     }
 
     int getMaxSize() const {
         return mMaxSize;
     }
 
+    // Returns the normalized compound distance of the worst node, which is at the top of the heap.
+    AK_FORCE_INLINE bool getWorstDistance(float *const outDistance) const {
+        if (mDicNodesHeap.empty()) {
+            return false;
+        }
+        *outDistance = mDicNodesHeap[0].mNormalizedCompoundDistance;
+        return true;
+    }
+
+    int getCapacity() const {
+        return mCapacity;
+    }
+
+    // The bytes allocated for the bookkeeping of the slots and the heap. The nodes themselves
+    // belong to the owner of the slots.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mUnusedNodeIndices)
+                + MemoryUtils::getVectorMemorySize(&mNodeGenerations)
+                + MemoryUtils::getVectorMemorySize(&mDicNodesHeap);
+    }
+
     AK_FORCE_INLINE void setMaxSize(const int maxSize) {
-        mMaxSize = min(maxSize, MAX_CAPACITY);
+        mMaxSize = min(maxSize, mCapacity);
     }
 
     AK_FORCE_INLINE void reset() {
-        clearAndResize(MAX_CAPACITY);
+        clearAndResize(mCapacity);
     }
 
     AK_FORCE_INLINE void clear() {
         clearAndResize(mMaxSize);
     }
 
+    // Clearing is O(1): instead of releasing every buffer slot, the generation is bumped so that
+    // all slots stamped with an older generation are considered free. Slots are then handed out
+    // from the fresh area above mNextFreshNodeId, and the free list only ever holds slots that
+    // were allocated and released within the current generation.
     AK_FORCE_INLINE void clearAndResize(const int maxSize) {
-        while (!mDicNodesQueue.empty()) {
-            mDicNodesQueue.pop();
-        }
+        mDicNodesHeap.clear();
         setMaxSize(maxSize);
-        for (int i = 0; i < MAX_CAPACITY + 1; ++i) {
-            mDicNodesBuf[i].remove();
-            mDicNodesBuf[i].setReleaseListener(this);
-            mUnusedNodeIndices[i] = i == MAX_CAPACITY ? NOT_A_NODE_ID : static_cast<int>(i) + 1;
+        if (mGeneration == MAX_GENERATION) {
+            // Wrap around. Stamps of the previous cycle must not match any future generation.
+            for (int i = 0; i < mCapacity + 1; ++i) {
+                mNodeGenerations[i] = NOT_A_GENERATION;
+            }
+            mGeneration = 0;
+        } else {
+            ++mGeneration;
         }
-        mNextUnusedNodeId = 0;
+        mNextUnusedNodeId = NOT_A_NODE_ID;
+        mNextFreshNodeId = 0;
     }
 
     AK_FORCE_INLINE DicNode *newDicNode(DicNode *dicNode) {
@@ -89,34 +130,83 @@ class DicNodePriorityQueue : public DicNodeReleaseListener {
         return copyPush(dicNode, mMaxSize);
     }
 
+    // If the queue has a node of the same word as dicNode, keeps the better of the two and returns
+    // true. This scans the queue, so it is meant for small queues such as the terminal queue.
+    AK_FORCE_INLINE bool copyMergeSameWord(DicNode *dicNode) {
+        const int size = getSize();
+        for (int i = 0; i < size; ++i) {
+            DicNode *const queuedDicNode = &mDicNodesBuf[mDicNodesHeap[i].mNodeIndex];
+            if (!queuedDicNode->isSameWord(dicNode)) {
+                continue;
+            }
+            if (dicNode->compare(queuedDicNode)) {
+                // The better node takes the slot of the queued one, which moves down the heap.
+                DicNodeUtils::initByCopy(dicNode, queuedDicNode);
+                siftDownHeap(i, createHeapEntry(queuedDicNode));
+            }
+            return true;
+        }
+        return false;
+    }
+
     AK_FORCE_INLINE void copyPop(DicNode *dest) {
-        if (mDicNodesQueue.empty()) {
+        if (mDicNodesHeap.empty()) {
             ASSERT(false);
             return;
         }
-        DicNode *node = mDicNodesQueue.top();
+        DicNode *node = &mDicNodesBuf[mDicNodesHeap[0].mNodeIndex];
         if (dest) {
             DicNodeUtils::initByCopy(node, dest);
         }
         node->remove();
-        mDicNodesQueue.pop();
+        popHeap();
+    }
+
+    // Writes the best maxCount nodes to dest, the best first, without popping them. The nodes
+    // belong to the queue and stay valid until it is modified. This is an insertion sort meant for
+    // small queues such as the terminal queue.
+    AK_FORCE_INLINE int getSortedDicNodes(DicNode **const dest, const int maxCount) {
+        int count = 0;
+        const int size = getSize();
+        for (int i = 0; i < size; ++i) {
+            DicNode *const dicNode = &mDicNodesBuf[mDicNodesHeap[i].mNodeIndex];
+            int index;
+            if (count < maxCount) {
+                index = count;
+                ++count;
+            } else if (maxCount > 0 && dicNode->compare(dest[maxCount - 1])) {
+                index = maxCount - 1;
+            } else {
+                continue;
+            }
+            while (index > 0 && dicNode->compare(dest[index - 1])) {
+                dest[index] = dest[index - 1];
+                --index;
+            }
+            dest[index] = dicNode;
+        }
+        return count;
     }
 
     void onReleased(DicNode *dicNode) {
-        const int index = static_cast<int>(dicNode - &mDicNodesBuf[0]);
-        if (mUnusedNodeIndices[index] != NOT_A_NODE_ID) {
+        const int index = static_cast<int>(dicNode - mDicNodesBuf);
+        if (!isLiveNodeIndex(index)) {
+            // it belongs to an older generation and is free already
+            return;
+        }
+        if (mUnusedNodeIndices[index] != USED_NODE_ID) {
             // it's already released
             return;
         }
         mUnusedNodeIndices[index] = mNextUnusedNodeId;
         mNextUnusedNodeId = index;
-        ASSERT(index >= 0 && index < (MAX_CAPACITY + 1));
+        ASSERT(index >= 0 && index < (mCapacity + 1));
     }
 
     AK_FORCE_INLINE void dump() const {
         AKLOGI("\n\n\n\n\n===========================");
-        for (int i = 0; i < MAX_CAPACITY + 1; ++i) {
-            if (mDicNodesBuf[i].isUsed()) {
+        for (int i = 0; i < mCapacity + 1; ++i) {
+            if (isLiveNodeIndex(i) && mDicNodesBuf[i].isUsed()) {
                 mDicNodesBuf[i].dump("QUEUE: ");
             }
         }
@@ -126,24 +216,41 @@ class DicNodePriorityQueue : public DicNodeReleaseListener {
  private:
     DISALLOW_COPY_AND_ASSIGN(DicNodePriorityQueue);
     static const int NOT_A_NODE_ID = -1;
+    // Marks a slot of mUnusedNodeIndices whose node is handed out. NOT_A_NODE_ID cannot be used
+    // for this because it also terminates the free list.
+    static const int USED_NODE_ID = -2;
+    static const int NOT_A_GENERATION = -1;
+    static const int MAX_GENERATION = S_INT_MAX;
 
-    AK_FORCE_INLINE static bool compareDicNode(DicNode *left, DicNode *right) {
-        return left->compare(right);
-    }
-
-    struct DicNodeComparator {
-        bool operator ()(DicNode *left, DicNode *right) {
-            return compareDicNode(left, right);
-        }
+    // Entries of the heap keep the primary sort keys of DicNode::compare() inline next to the
+    // slot index so that sift operations only touch the contiguous heap array. The DicNode itself
+    // is only visited to break exact ties.
+    struct DicNodeHeapEntry {
+        float mNormalizedCompoundDistance;
+        int mDepth;
+        int mNodeIndex;
     };
 
-    typedef std::priority_queue<DicNode *, std::vector<DicNode *>, DicNodeComparator> DicNodesQueue;
-    const int MAX_CAPACITY;
+    // The heap is 4-ary: it is shallower than a binary heap, and the children of one entry share
+    // a cache line.
+    static const int HEAP_ARITY = 4;
+
+    int mCapacity;
     int mMaxSize;
-    std::vector<DicNode> mDicNodesBuf; // of each element of mDicNodesBuf respectively
+    DicNode *mDicNodesBuf; // of each element of mDicNodesBuf respectively
     std::vector<int> mUnusedNodeIndices;
+    // The generation in which each slot of mDicNodesBuf was last handed out
+    std::vector<int> mNodeGenerations;
+    int mGeneration;
     int mNextUnusedNodeId;
-    DicNodesQueue mDicNodesQueue;
+    // Slots at or above this index have not been handed out in the current generation
+    int mNextFreshNodeId;
+    // Max-heap ordered by DicNode::compare(); the worst node is at the top.
+    std::vector<DicNodeHeapEntry> mDicNodesHeap;
+
+    AK_FORCE_INLINE bool isLiveNodeIndex(const int index) const {
+        return mNodeGenerations[index] == mGeneration;
+    }
 
     inline bool isFull(const int maxSize) const {
         return getSize() >= maxSize;
@@ -154,37 +261,117 @@ class DicNodePriorityQueue : public DicNodeReleaseListener {
     }
 
     AK_FORCE_INLINE bool betterThanWorstDicNode(DicNode *dicNode) const {
-        DicNode *worstNode = mDicNodesQueue.top();
-        if (!worstNode) {
+        if (mDicNodesHeap.empty()) {
             return true;
         }
-        return compareDicNode(dicNode, worstNode);
+        const DicNodeHeapEntry entry = createHeapEntry(dicNode);
+        return isLowerInHeap(&entry, &mDicNodesHeap[0]);
     }
 
-    AK_FORCE_INLINE DicNode *searchEmptyDicNode() {
-        // TODO: Currently O(n) but should be improved to O(1)
-        if (MAX_CAPACITY == 0) {
-            return 0;
+    AK_FORCE_INLINE DicNodeHeapEntry createHeapEntry(const DicNode *const dicNode) const {
+        DicNodeHeapEntry entry;
+        entry.mNormalizedCompoundDistance = dicNode->getNormalizedCompoundDistance();
+        entry.mDepth = dicNode->getDepth();
+        entry.mNodeIndex = static_cast<int>(dicNode - mDicNodesBuf);
+        return entry;
+    }
+
+    // Same order as DicNode::compare(). Nodes in the heap are always used.
+    AK_FORCE_INLINE bool isLowerInHeap(const DicNodeHeapEntry *const left,
+            const DicNodeHeapEntry *const right) const {
+        const float diff = right->mNormalizedCompoundDistance - left->mNormalizedCompoundDistance;
+        static const float MIN_DIFF = 0.000001f;
+        if (diff > MIN_DIFF) {
+            return true;
+        } else if (diff < -MIN_DIFF) {
+            return false;
+        }
+        if (left->mDepth != right->mDepth) {
+            return right->mDepth > left->mDepth;
         }
-        if (mNextUnusedNodeId == NOT_A_NODE_ID) {
-            AKLOGI("No unused node found.");
-            for (int i = 0; i < MAX_CAPACITY + 1; ++i) {
-                AKLOGI("Dump node availability, %d, %d, %d",
-                        i, mDicNodesBuf[i].isUsed(), mUnusedNodeIndices[i]);
+        return mDicNodesBuf[left->mNodeIndex].compare(&mDicNodesBuf[right->mNodeIndex]);
+    }
+
+    AK_FORCE_INLINE void pushHeap(const DicNode *const dicNode) {
+        const DicNodeHeapEntry entry = createHeapEntry(dicNode);
+        int index = static_cast<int>(mDicNodesHeap.size());
+        mDicNodesHeap.push_back(entry);
+        while (index > 0) {
+            const int parentIndex = (index - 1) / HEAP_ARITY;
+            if (!isLowerInHeap(&mDicNodesHeap[parentIndex], &entry)) {
+                break;
             }
-            ASSERT(false);
+            mDicNodesHeap[index] = mDicNodesHeap[parentIndex];
+            index = parentIndex;
+        }
+        mDicNodesHeap[index] = entry;
+    }
+
+    AK_FORCE_INLINE void popHeap() {
+        const DicNodeHeapEntry entry = mDicNodesHeap.back();
+        mDicNodesHeap.pop_back();
+        if (mDicNodesHeap.empty()) {
+            return;
+        }
+        siftDownHeap(0, entry);
+    }
+
+    // Moves entry down from startIndex, whose entry it replaces, until its children are lower.
+    AK_FORCE_INLINE void siftDownHeap(const int startIndex, const DicNodeHeapEntry entry) {
+        const int size = static_cast<int>(mDicNodesHeap.size());
+        int index = startIndex;
+        while (true) {
+            const int firstChildIndex = index * HEAP_ARITY + 1;
+            if (firstChildIndex >= size) {
+                break;
+            }
+            const int endChildIndex = min(firstChildIndex + HEAP_ARITY, size);
+            int highestChildIndex = firstChildIndex;
+            for (int i = firstChildIndex + 1; i < endChildIndex; ++i) {
+                if (isLowerInHeap(&mDicNodesHeap[highestChildIndex], &mDicNodesHeap[i])) {
+                    highestChildIndex = i;
+                }
+            }
+            if (!isLowerInHeap(&entry, &mDicNodesHeap[highestChildIndex])) {
+                break;
+            }
+            mDicNodesHeap[index] = mDicNodesHeap[highestChildIndex];
+            index = highestChildIndex;
+        }
+        mDicNodesHeap[index] = entry;
+    }
+
+    AK_FORCE_INLINE DicNode *searchEmptyDicNode() {
+        if (mCapacity == 0) {
             return 0;
         }
-        DicNode *dicNode = &mDicNodesBuf[mNextUnusedNodeId];
-        markNodeAsUsed(dicNode);
-        return dicNode;
+        if (mNextUnusedNodeId != NOT_A_NODE_ID) {
+            DicNode *dicNode = &mDicNodesBuf[mNextUnusedNodeId];
+            markNodeAsUsed(dicNode);
+            return dicNode;
+        }
+        if (mNextFreshNodeId < mCapacity + 1) {
+            const int index = mNextFreshNodeId;
+            ++mNextFreshNodeId;
+            mNodeGenerations[index] = mGeneration;
+            mUnusedNodeIndices[index] = USED_NODE_ID;
+            return &mDicNodesBuf[index];
+        }
+        AKLOGI("No unused node found.");
+        for (int i = 0; i < mCapacity + 1; ++i) {
+            AKLOGI("Dump node availability, %d, %d, %d, %d",
+                    i, mDicNodesBuf[i].isUsed(), mUnusedNodeIndices[i], mNodeGenerations[i]);
+        }
+        ASSERT(false);
+        return 0;
     }
 
     AK_FORCE_INLINE void markNodeAsUsed(DicNode *dicNode) {
-        const int index = static_cast<int>(dicNode - &mDicNodesBuf[0]);
+        const int index = static_cast<int>(dicNode - mDicNodesBuf);
+        ASSERT(isLiveNodeIndex(index));
         mNextUnusedNodeId = mUnusedNodeIndices[index];
-        mUnusedNodeIndices[index] = NOT_A_NODE_ID;
-        ASSERT(index >= 0 && index < (MAX_CAPACITY + 1));
+        mUnusedNodeIndices[index] = USED_NODE_ID;
+        ASSERT(index >= 0 && index < (mCapacity + 1));
     }
 
     AK_FORCE_INLINE DicNode *pushPoolNodeWithMaxSize(DicNode *dicNode, const int maxSize) {
@@ -192,12 +379,12 @@ class DicNodePriorityQueue : public DicNodeReleaseListener {
             return 0;
         }
         if (!isFull(maxSize)) {
-            mDicNodesQueue.push(dicNode);
+            pushHeap(dicNode);
             return dicNode;
         }
         if (betterThanWorstDicNode(dicNode)) {
             pop();
-            mDicNodesQueue.push(dicNode);
+            pushHeap(dicNode);
             return dicNode;
         }
         dicNode->remove();
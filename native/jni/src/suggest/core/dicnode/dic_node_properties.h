@@ -36,7 +36,8 @@ class DicNodeProperties {
               mHasChildren(false) {
     }
 
-    virtual ~DicNodeProperties() {}
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~DicNodeProperties() {}
 
     // Should be called only once per DicNode is initialized.
     void init(const int pos, const uint8_t flags, const int childrenPos, const int attributesPos,
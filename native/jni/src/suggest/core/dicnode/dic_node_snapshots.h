@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LATINIME_DIC_NODE_SNAPSHOTS_H
+#define LATINIME_DIC_NODE_SNAPSHOTS_H
+
+#include <vector>
+
+#include "defines.h"
+#include "memory_utils.h"
+#include "dic_node.h"
+
+#define MAX_DIC_NODE_SNAPSHOT_COUNT 8
+
+namespace latinime {
+
+/**
+ * Keeps copies of the active dicNodes (the search frontier) for the deepest input indices of
+ * the previous searches, so that a search for an input that shares a prefix with them can resume
+ * from there instead of the root. Snapshots are stored in a ring keyed by the input index.
+ */
+class DicNodeSnapshots {
+ public:
+    AK_FORCE_INLINE DicNodeSnapshots()
+            : mSnapshotDicNodes(), mInputIndices(), mSizes(), mRecordingSlot(NOT_AN_INDEX) {
+        for (int i = 0; i < MAX_DIC_NODE_SNAPSHOT_COUNT; ++i) {
+            mInputIndices[i] = NOT_AN_INDEX;
+            mSizes[i] = 0;
+        }
+        mSnapshotDicNodes.resize(MAX_DIC_NODE_SNAPSHOT_COUNT);
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~DicNodeSnapshots() {}
+
+    AK_FORCE_INLINE void clear() {
+        invalidateFrom(0);
+    }
+
+    // The bytes allocated for the snapshots. Cleared snapshots keep their storage.
+    int getMemorySize() const {
+        int memorySize = MemoryUtils::getVectorMemorySize(&mSnapshotDicNodes);
+        for (int i = 0; i < MAX_DIC_NODE_SNAPSHOT_COUNT; ++i) {
+            memorySize += MemoryUtils::getVectorMemorySize(&mSnapshotDicNodes[i]);
+        }
+        return memorySize;
+    }
+
+    // Drops the snapshots taken at inputIndex or deeper.
+    AK_FORCE_INLINE void invalidateFrom(const int inputIndex) {
+        for (int i = 0; i < MAX_DIC_NODE_SNAPSHOT_COUNT; ++i) {
+            if (mInputIndices[i] >= inputIndex) {
+                mInputIndices[i] = NOT_AN_INDEX;
+                mSizes[i] = 0;
+            }
+        }
+        mRecordingSlot = NOT_AN_INDEX;
+    }
+
+    // Returns the deepest input index that has a snapshot and is not deeper than maxInputIndex,
+    // or NOT_AN_INDEX.
+    AK_FORCE_INLINE int getDeepestInputIndex(const int maxInputIndex) const {
+        int deepestInputIndex = NOT_AN_INDEX;
+        for (int i = 0; i < MAX_DIC_NODE_SNAPSHOT_COUNT; ++i) {
+            if (mInputIndices[i] <= maxInputIndex && mInputIndices[i] > deepestInputIndex
+                    && mSizes[i] > 0) {
+                deepestInputIndex = mInputIndices[i];
+            }
+        }
+        return deepestInputIndex;
+    }
+
+    // Starts recording the frontier of inputIndex, replacing the snapshot that shares its slot.
+    AK_FORCE_INLINE void beginSnapshot(const int inputIndex) {
+        mRecordingSlot = inputIndex % MAX_DIC_NODE_SNAPSHOT_COUNT;
+        mInputIndices[mRecordingSlot] = inputIndex;
+        mSizes[mRecordingSlot] = 0;
+    }
+
+    AK_FORCE_INLINE void endSnapshot() {
+        mRecordingSlot = NOT_AN_INDEX;
+    }
+
+    // Drops the snapshot being recorded, which is incomplete.
+    AK_FORCE_INLINE void abortSnapshot() {
+        if (isRecording()) {
+            mInputIndices[mRecordingSlot] = NOT_AN_INDEX;
+            mSizes[mRecordingSlot] = 0;
+            mRecordingSlot = NOT_AN_INDEX;
+        }
+    }
+
+    AK_FORCE_INLINE bool isRecording() const {
+        return mRecordingSlot != NOT_AN_INDEX;
+    }
+
+    AK_FORCE_INLINE void add(DicNode *const dicNode) {
+        ASSERT(isRecording());
+        std::vector<DicNode> *const dicNodes = &mSnapshotDicNodes[mRecordingSlot];
+        const int size = mSizes[mRecordingSlot];
+        if (size == static_cast<int>(dicNodes->size())) {
+            dicNodes->push_back(DicNode());
+        }
+        (*dicNodes)[size].initByCopy(dicNode);
+        mSizes[mRecordingSlot] = size + 1;
+    }
+
+    // The snapshot of inputIndex has to exist.
+    AK_FORCE_INLINE int getSize(const int inputIndex) const {
+        const int slot = inputIndex % MAX_DIC_NODE_SNAPSHOT_COUNT;
+        ASSERT(mInputIndices[slot] == inputIndex);
+        return mSizes[slot];
+    }
+
+    AK_FORCE_INLINE DicNode *getDicNodeAt(const int inputIndex, const int index) {
+        const int slot = inputIndex % MAX_DIC_NODE_SNAPSHOT_COUNT;
+        ASSERT(mInputIndices[slot] == inputIndex && index < mSizes[slot]);
+        return &mSnapshotDicNodes[slot][index];
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(DicNodeSnapshots);
+    // Storage is kept across searches to avoid reallocating it
+    std::vector<std::vector<DicNode> > mSnapshotDicNodes;
+    int mInputIndices[MAX_DIC_NODE_SNAPSHOT_COUNT];
+    int mSizes[MAX_DIC_NODE_SNAPSHOT_COUNT];
+    int mRecordingSlot;
+};
+} // namespace latinime
+#endif // LATINIME_DIC_NODE_SNAPSHOTS_H
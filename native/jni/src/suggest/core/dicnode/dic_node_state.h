@@ -25,40 +25,51 @@
 
 namespace latinime {
 
+// The small states that change on every expansion come first, followed by the word buffer of the
+// output, which is only copied up to its used length. The previous words are shared chains.
 class DicNodeState {
  public:
     DicNodeStateInput mDicNodeStateInput;
+    DicNodeStateScoring mDicNodeStateScoring;
     DicNodeStateOutput mDicNodeStateOutput;
     DicNodeStatePrevWord mDicNodeStatePrevWord;
-    DicNodeStateScoring mDicNodeStateScoring;
 
     AK_FORCE_INLINE DicNodeState()
-            : mDicNodeStateInput(), mDicNodeStateOutput(), mDicNodeStatePrevWord(),
-              mDicNodeStateScoring() {
+            : mDicNodeStateInput(), mDicNodeStateScoring(), mDicNodeStateOutput(),
+              mDicNodeStatePrevWord() {
     }
 
-    virtual ~DicNodeState() {}
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~DicNodeState() {}
 
     // Init with prevWordPos
     void init(const int prevWordPos) {
         mDicNodeStateInput.init();
+        mDicNodeStateScoring.init();
         mDicNodeStateOutput.init();
         mDicNodeStatePrevWord.init(prevWordPos);
-        mDicNodeStateScoring.init();
     }
 
     // Init by copy
     AK_FORCE_INLINE void init(const DicNodeState *const src) {
         mDicNodeStateInput.init(&src->mDicNodeStateInput);
+        mDicNodeStateScoring.init(&src->mDicNodeStateScoring);
         mDicNodeStateOutput.init(&src->mDicNodeStateOutput);
         mDicNodeStatePrevWord.init(&src->mDicNodeStatePrevWord);
+    }
+
+    // Init for a child of the dicNode of src, whose output is linked rather than copied
+    AK_FORCE_INLINE void initAsChild(const DicNodeState *const src) {
+        mDicNodeStateInput.init(&src->mDicNodeStateInput);
         mDicNodeStateScoring.init(&src->mDicNodeStateScoring);
+        mDicNodeStateOutput.initAsChild(&src->mDicNodeStateOutput);
+        mDicNodeStatePrevWord.init(&src->mDicNodeStatePrevWord);
     }
 
-    // Init by copy and adding subword
-    void init(const DicNodeState *const src, const uint16_t additionalSubwordLength,
+    // Init for a child and adding subword
+    void initAsChild(const DicNodeState *const src, const uint16_t additionalSubwordLength,
             const int *const additionalSubword) {
-        init(src);
+        initAsChild(src);
         mDicNodeStateOutput.addSubword(additionalSubwordLength, additionalSubword);
     }
 
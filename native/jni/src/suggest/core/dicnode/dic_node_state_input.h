@@ -25,7 +25,8 @@ namespace latinime {
 class DicNodeStateInput {
  public:
     DicNodeStateInput() {}
-    virtual ~DicNodeStateInput() {}
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~DicNodeStateInput() {}
 
     // TODO: Merge into DicNodeStatePrevWord::truncate
     void truncate(const int commitPoint) {
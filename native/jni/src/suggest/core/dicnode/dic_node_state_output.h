@@ -24,23 +24,60 @@
 
 namespace latinime {
 
+// The output of a child is linked to the output of the dicNode it is expanded from, which stays
+// in place while its children are processed: the code points below mParentLength are those of
+// mParentOutput, and only the code points the child adds are in mWordBuf. The children that are
+// dropped never copy the word, and copying a dicNode to a queue or a buffer copies the linked
+// code points, so that the copy has all of its output.
+//
+// The code points are stored on 16 bits with USE_BMP_CODE_POINTS, and are ints everywhere else.
 class DicNodeStateOutput {
  public:
-    DicNodeStateOutput() : mOutputtedLength(0) {
+    DicNodeStateOutput() : mOutputtedLength(0), mParentLength(0), mParentOutput(0) {
         init();
     }
 
-    virtual ~DicNodeStateOutput() {}
+    // Copies all the code points, so that the copy does not depend on the lifetime of the linked
+    // outputs.
+    DicNodeStateOutput(const DicNodeStateOutput &stateOutput)
+            : mOutputtedLength(0), mParentLength(0), mParentOutput(0) {
+        init(&stateOutput);
+    }
+
+    DicNodeStateOutput &operator=(const DicNodeStateOutput &stateOutput) {
+        if (this != &stateOutput) {
+            init(&stateOutput);
+        }
+        return *this;
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~DicNodeStateOutput() {}
 
     void init() {
         mOutputtedLength = 0;
+        mParentLength = 0;
+        mParentOutput = 0;
         mWordBuf[0] = 0;
     }
 
+    // Init by copy
     void init(const DicNodeStateOutput *const stateOutput) {
-        memcpy(mWordBuf, stateOutput->mWordBuf,
-                stateOutput->mOutputtedLength * sizeof(mWordBuf[0]));
+        stateOutput->outputCodePoints(mWordBuf);
         mOutputtedLength = stateOutput->mOutputtedLength;
+        mParentLength = 0;
+        mParentOutput = 0;
+        if (mOutputtedLength < MAX_WORD_LENGTH) {
+            mWordBuf[mOutputtedLength] = 0;
+        }
+    }
+
+    // Init for a child of the dicNode of parentOutput, which must outlive this one unless it is
+    // copied.
+    AK_FORCE_INLINE void initAsChild(const DicNodeStateOutput *const parentOutput) {
+        mOutputtedLength = parentOutput->mOutputtedLength;
+        mParentLength = parentOutput->mOutputtedLength;
+        mParentOutput = parentOutput;
         if (mOutputtedLength < MAX_WORD_LENGTH) {
             mWordBuf[mOutputtedLength] = 0;
         }
@@ -48,8 +85,8 @@ class DicNodeStateOutput {
 
     void addSubword(const uint16_t additionalSubwordLength, const int *const additionalSubword) {
         if (additionalSubword) {
-            memcpy(&mWordBuf[mOutputtedLength], additionalSubword,
-                    additionalSubwordLength * sizeof(mWordBuf[0]));
+            copyCodePoints(&mWordBuf[mOutputtedLength], additionalSubword,
+                    additionalSubwordLength);
             mOutputtedLength = static_cast<uint16_t>(mOutputtedLength + additionalSubwordLength);
             if (mOutputtedLength < MAX_WORD_LENGTH) {
                 mWordBuf[mOutputtedLength] = 0;
@@ -58,18 +95,73 @@ class DicNodeStateOutput {
     }
 
     // TODO: Remove
-    int getCodePointAt(const int id) const {
-        return mWordBuf[id];
+    AK_FORCE_INLINE int getCodePointAt(const int id) const {
+        if (id >= mOutputtedLength) {
+            return 0;
+        }
+        const DicNodeStateOutput *stateOutput = this;
+        while (id < stateOutput->mParentLength) {
+            stateOutput = stateOutput->mParentOutput;
+        }
+        return stateOutput->mWordBuf[id];
     }
 
-    // TODO: Move to private
-    int mWordBuf[MAX_WORD_LENGTH];
+    // Returns the code points, which are written to buffer unless they are all in this output.
+    // The returned code points are followed by a 0 if they are shorter than MAX_WORD_LENGTH.
+    AK_FORCE_INLINE const int *getCodePoints(int *const buffer) const {
+#if !USE_BMP_CODE_POINTS
+        if (!mParentOutput) {
+            return mWordBuf;
+        }
+#endif // !USE_BMP_CODE_POINTS
+        outputCodePoints(buffer);
+        if (mOutputtedLength < MAX_WORD_LENGTH) {
+            buffer[mOutputtedLength] = 0;
+        }
+        return buffer;
+    }
 
  private:
-    // Caution!!!
-    // Use a default copy constructor and an assign operator because shallow copies are ok
-    // for this class
+#if USE_BMP_CODE_POINTS
+    typedef uint16_t CodePoint;
+#else // USE_BMP_CODE_POINTS
+    typedef int CodePoint;
+#endif // USE_BMP_CODE_POINTS
+
+    // Converts the code points if they are stored on 16 bits.
+    template<typename DestT, typename SrcT>
+    static AK_FORCE_INLINE void copyCodePoints(DestT *const dest, const SrcT *const src,
+            const int count) {
+        for (int i = 0; i < count; ++i) {
+            dest[i] = static_cast<DestT>(src[i]);
+        }
+    }
+
+    template<typename T>
+    static AK_FORCE_INLINE void copyCodePoints(T *const dest, const T *const src,
+            const int count) {
+        memcpy(dest, src, count * sizeof(dest[0]));
+    }
+
+    // Writes the mOutputtedLength code points, walking up the linked outputs.
+    template<typename DestT>
+    AK_FORCE_INLINE void outputCodePoints(DestT *const dest) const {
+        int end = mOutputtedLength;
+        const DicNodeStateOutput *stateOutput = this;
+        while (stateOutput->mParentOutput) {
+            const int start = min(static_cast<int>(stateOutput->mParentLength), end);
+            copyCodePoints(&dest[start], &stateOutput->mWordBuf[start], end - start);
+            end = start;
+            stateOutput = stateOutput->mParentOutput;
+        }
+        copyCodePoints(dest, stateOutput->mWordBuf, end);
+    }
+
+    CodePoint mWordBuf[MAX_WORD_LENGTH];
     uint16_t mOutputtedLength;
+    // The length of the code points of mParentOutput, or 0 if all the code points are in mWordBuf
+    uint16_t mParentLength;
+    const DicNodeStateOutput *mParentOutput;
 };
 } // namespace latinime
 #endif // LATINIME_DIC_NODE_STATE_OUTPUT_H
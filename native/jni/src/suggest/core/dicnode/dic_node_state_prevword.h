@@ -17,32 +17,44 @@
 #ifndef LATINIME_DIC_NODE_STATE_PREVWORD_H
 #define LATINIME_DIC_NODE_STATE_PREVWORD_H
 
-#include <cstring> // for memset()
+#include <cstring> // for memcmp()
 #include <stdint.h>
 
 #include "defines.h"
+#include "dic_node_prev_word_chains.h"
 #include "dic_node_utils.h"
 
 namespace latinime {
 
+// The previous words are the chain of records that ends at mPrevWordChainIndex in the chains of
+// the session, which the dicNodes of the same words share. Only the scalars are copied.
 class DicNodeStatePrevWord {
  public:
     AK_FORCE_INLINE DicNodeStatePrevWord()
             : mPrevWordCount(0), mPrevWordLength(0), mPrevWordStart(0), mPrevWordProbability(0),
-              mPrevWordNodePos(0) {
-        memset(mPrevWord, 0, sizeof(mPrevWord));
-        memset(mPrevSpacePositions, 0, sizeof(mPrevSpacePositions));
+              mPrevWordNodePos(0), mPrevWordChainIndex(NOT_AN_INDEX), mPrevWordChains(0) {
     }
 
-    virtual ~DicNodeStatePrevWord() {}
+    // Shallow copies are ok: the chains are shared.
+    AK_FORCE_INLINE DicNodeStatePrevWord(const DicNodeStatePrevWord &prevWord)
+            : mPrevWordCount(prevWord.mPrevWordCount), mPrevWordLength(prevWord.mPrevWordLength),
+              mPrevWordStart(prevWord.mPrevWordStart),
+              mPrevWordProbability(prevWord.mPrevWordProbability),
+              mPrevWordNodePos(prevWord.mPrevWordNodePos),
+              mPrevWordChainIndex(prevWord.mPrevWordChainIndex),
+              mPrevWordChains(prevWord.mPrevWordChains) {
+    }
+
+    AK_FORCE_INLINE DicNodeStatePrevWord &operator=(const DicNodeStatePrevWord &prevWord) {
+        init(&prevWord);
+        return *this;
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~DicNodeStatePrevWord() {}
 
     void init() {
-        mPrevWordLength = 0;
-        mPrevWordCount = 0;
-        mPrevWordStart = 0;
-        mPrevWordProbability = -1;
-        mPrevWordNodePos = NOT_VALID_WORD;
-        memset(mPrevSpacePositions, 0, sizeof(mPrevSpacePositions));
+        init(NOT_VALID_WORD);
     }
 
     void init(const int prevWordNodePos) {
@@ -51,7 +63,8 @@ class DicNodeStatePrevWord {
         mPrevWordStart = 0;
         mPrevWordProbability = -1;
         mPrevWordNodePos = prevWordNodePos;
-        memset(mPrevSpacePositions, 0, sizeof(mPrevSpacePositions));
+        mPrevWordChainIndex = NOT_AN_INDEX;
+        mPrevWordChains = 0;
     }
 
     // Init by copy
@@ -61,42 +74,72 @@ class DicNodeStatePrevWord {
         mPrevWordStart = prevWord->mPrevWordStart;
         mPrevWordProbability = prevWord->mPrevWordProbability;
         mPrevWordNodePos = prevWord->mPrevWordNodePos;
-        memcpy(mPrevWord, prevWord->mPrevWord, prevWord->mPrevWordLength * sizeof(mPrevWord[0]));
-        memcpy(mPrevSpacePositions, prevWord->mPrevSpacePositions, sizeof(mPrevSpacePositions));
+        mPrevWordChainIndex = prevWord->mPrevWordChainIndex;
+        mPrevWordChains = prevWord->mPrevWordChains;
     }
 
+    // Init with the words of prevWord followed by the word, and the space after it at
+    // lastInputIndex.
     void init(const int16_t prevWordCount, const int16_t prevWordProbability,
-            const int prevWordNodePos, const int *const src0, const int16_t length0,
-            const int *const src1, const int16_t length1, const int *const prevSpacePositions,
-            const int lastInputIndex) {
+            const int prevWordNodePos, const DicNodeStatePrevWord *const prevWord,
+            const int *const word, const int16_t wordLength, const int lastInputIndex,
+            DicNodePrevWordChains *const prevWordChains) {
         mPrevWordCount = prevWordCount;
         mPrevWordProbability = prevWordProbability;
         mPrevWordNodePos = prevWordNodePos;
-        const int twoWordsLen =
-                DicNodeUtils::appendTwoWords(src0, length0, src1, length1, mPrevWord);
-        mPrevWord[twoWordsLen] = KEYCODE_SPACE;
-        mPrevWordStart = length0;
-        mPrevWordLength = static_cast<int16_t>(twoWordsLen + 1);
-        memcpy(mPrevSpacePositions, prevSpacePositions, sizeof(mPrevSpacePositions));
-        mPrevSpacePositions[mPrevWordCount - 1] = lastInputIndex;
-    }
-
-    void truncate(const int offset) {
-        // TODO: memmove
-        if (mPrevWordLength < offset) {
-            memset(mPrevWord, 0, sizeof(mPrevWord));
+        mPrevWordStart = prevWord->mPrevWordLength;
+        mPrevWordChains = prevWordChains;
+        // Same as DicNodeUtils::appendTwoWords: the word stops at a 0 and the words with the
+        // space after them fit in MAX_WORD_LENGTH.
+        const int prevWordsLength = min(static_cast<int>(prevWord->mPrevWordLength),
+                MAX_WORD_LENGTH - 1);
+        int length = 0;
+        while (length < wordLength && length < MAX_WORD_LENGTH - prevWordsLength - 1
+                && word[length] != 0) {
+            ++length;
+        }
+        int codePoints[MAX_WORD_LENGTH];
+        memcpy(codePoints, word, length * sizeof(codePoints[0]));
+        codePoints[length] = KEYCODE_SPACE;
+        mPrevWordChainIndex = mPrevWordChains->append(prevWord->mPrevWordChainIndex, codePoints,
+                length + 1, lastInputIndex);
+        mPrevWordLength = static_cast<int16_t>(prevWordsLength + length + 1);
+    }
+
+    // Drops the first offset code points of the previous words. The shared records are not
+    // changed: the chain is copied without them to truncatedChains, keeping the space positions,
+    // and the chains of the dicNode are replaced with truncatedChains afterwards.
+    void truncate(const int offset, DicNodePrevWordChains *const truncatedChains,
+            DicNodePrevWordChains::CopiedIndexMap *const copiedIndices) {
+        if (mPrevWordChainIndex == NOT_AN_INDEX) {
             mPrevWordLength = 0;
             return;
         }
-        const int newPrevWordLength = mPrevWordLength - offset;
-        memmove(mPrevWord, &mPrevWord[offset], newPrevWordLength * sizeof(mPrevWord[0]));
-        mPrevWordLength = newPrevWordLength;
+        mPrevWordChainIndex = mPrevWordChains->copyTruncatedChain(mPrevWordChainIndex, offset,
+                truncatedChains, copiedIndices);
+        mPrevWordLength =
+                static_cast<int16_t>(truncatedChains->getTotalLength(mPrevWordChainIndex));
     }
 
     void outputSpacePositions(int *spaceIndices) const {
-        // Convert uint16_t to int
         for (int i = 0; i < MAX_RESULTS; i++) {
-            spaceIndices[i] = mPrevSpacePositions[i];
+            spaceIndices[i] = 0;
+        }
+        // The chain has a record for each of the previous words, the last one first.
+        int wordIndex = mPrevWordCount - 1;
+        for (int i = mPrevWordChainIndex; i != NOT_AN_INDEX;
+                i = mPrevWordChains->getParentIndex(i)) {
+            if (wordIndex < MAX_RESULTS) {
+                spaceIndices[wordIndex] = mPrevWordChains->getSpacePosition(i);
+            }
+            --wordIndex;
+        }
+    }
+
+    // Writes the getPrevWordLength() code points of the previous words.
+    AK_FORCE_INLINE void outputPrevWordCodePoints(int *const dest) const {
+        if (mPrevWordChainIndex != NOT_AN_INDEX) {
+            mPrevWordChains->outputCodePoints(mPrevWordChainIndex, dest);
         }
     }
 
@@ -121,36 +164,48 @@ class DicNodeStatePrevWord {
         return mPrevWordNodePos;
     }
 
-    int getPrevWordCodePointAt(const int id) const {
-        return mPrevWord[id];
+    // Whether both have the same previous words after the same word context. The dicNodes that
+    // share the chain have the same words without comparing them.
+    AK_FORCE_INLINE bool hasSamePrevWords(const DicNodeStatePrevWord *const right) const {
+        if (mPrevWordNodePos != right->mPrevWordNodePos
+                || mPrevWordCount != right->mPrevWordCount
+                || mPrevWordLength != right->mPrevWordLength) {
+            return false;
+        }
+        if (mPrevWordLength == 0 || (mPrevWordChainIndex == right->mPrevWordChainIndex
+                && mPrevWordChains == right->mPrevWordChains)) {
+            return true;
+        }
+        int codePoints[MAX_WORD_LENGTH];
+        int rightCodePoints[MAX_WORD_LENGTH];
+        outputPrevWordCodePoints(codePoints);
+        right->outputPrevWordCodePoints(rightCodePoints);
+        return memcmp(codePoints, rightCodePoints, mPrevWordLength * sizeof(codePoints[0])) == 0;
     }
 
     bool startsWith(const DicNodeStatePrevWord *const prefix, const int prefixLen) const {
-        if (prefixLen > mPrevWordLength) {
+        if (prefixLen > mPrevWordLength || prefixLen > prefix->mPrevWordLength) {
             return false;
         }
-        for (int i = 0; i < prefixLen; ++i) {
-            if (mPrevWord[i] != prefix->mPrevWord[i]) {
-                return false;
-            }
+        if (prefixLen <= 0 || (mPrevWordChainIndex == prefix->mPrevWordChainIndex
+                && mPrevWordChains == prefix->mPrevWordChains)) {
+            return true;
         }
-        return true;
+        int codePoints[MAX_WORD_LENGTH];
+        int prefixCodePoints[MAX_WORD_LENGTH];
+        outputPrevWordCodePoints(codePoints);
+        prefix->outputPrevWordCodePoints(prefixCodePoints);
+        return memcmp(codePoints, prefixCodePoints, prefixLen * sizeof(codePoints[0])) == 0;
     }
 
-    // TODO: Move to private
-    int mPrevWord[MAX_WORD_LENGTH];
-    // TODO: Move to private
-    int mPrevSpacePositions[MAX_RESULTS];
-
  private:
-    // Caution!!!
-    // Use a default copy constructor and an assign operator because shallow copies are ok
-    // for this class
     int16_t mPrevWordCount;
     int16_t mPrevWordLength;
     int16_t mPrevWordStart;
     int16_t mPrevWordProbability;
     int mPrevWordNodePos;
+    int mPrevWordChainIndex;
+    DicNodePrevWordChains *mPrevWordChains;
 };
 } // namespace latinime
 #endif // LATINIME_DIC_NODE_STATE_PREVWORD_H
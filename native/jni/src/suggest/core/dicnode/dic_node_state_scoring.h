@@ -34,7 +34,8 @@ class DicNodeStateScoring {
               mRawLength(0.0f), mExactMatch(true) {
     }
 
-    virtual ~DicNodeStateScoring() {}
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~DicNodeStateScoring() {}
 
     void init() {
         mEditCorrectionCount = 0;
@@ -21,9 +21,13 @@
 #include "dic_node.h"
 #include "dic_node_utils.h"
 #include "dic_node_vector.h"
+#include "dictionary_heat_map.h"
 #include "multi_bigram_map.h"
+#include "probability_overlay.h"
 #include "proximity_info.h"
 #include "proximity_info_state.h"
+#include "suggest/core/dictionary/bigram_list_index.h"
+#include "suggest/core/dictionary/decoded_node_index.h"
 
 namespace latinime {
 
@@ -41,12 +45,14 @@ namespace latinime {
 }
 
 /*static */ void DicNodeUtils::initAsRootWithPreviousWord(const int rootPos,
-        const uint8_t *const dicRoot, DicNode *prevWordLastNode, DicNode *newRootNode) {
+        const uint8_t *const dicRoot, DicNodePrevWordChains *prevWordChains,
+        DicNode *prevWordLastNode, DicNode *newRootNode) {
     int curPos = rootPos;
     const int pos = curPos;
     const int childrenCount = BinaryFormat::getGroupCountAndForwardPointer(dicRoot, &curPos);
     const int childrenPos = curPos;
-    newRootNode->initAsRootWithPreviousWord(prevWordLastNode, pos, childrenPos, childrenCount);
+    newRootNode->initAsRootWithPreviousWord(prevWordLastNode, pos, childrenPos, childrenCount,
+            prevWordChains);
 }
 
 /* static */ void DicNodeUtils::initByCopy(DicNode *srcNode, DicNode *destNode) {
@@ -69,11 +75,9 @@ namespace latinime {
     }
 }
 
-/* static */ int DicNodeUtils::createAndGetLeavingChildNode(DicNode *dicNode, int pos,
-        const uint8_t *const dicRoot, const int terminalDepth, const ProximityInfoState *pInfoState,
-        const int pointIndex, const bool exactOnly, const std::vector<int> *const codePointsFilter,
-        const ProximityInfo *const pInfo, DicNodeVector *childDicNodes) {
-    int nextPos = pos;
+/* static */ int DicNodeUtils::readChildGroup(const uint8_t *const dicRoot, int pos,
+        DicNodeChildrenCache::DecodedChild *const child, int *const subword) {
+    child->mPos = pos;
     const uint8_t flags = BinaryFormat::getFlagsAndForwardPointer(dicRoot, &pos);
     const bool hasMultipleChars = (0 != (BinaryFormat::FLAG_HAS_MULTIPLE_CHARS & flags));
     const bool isTerminal = (0 != (BinaryFormat::FLAG_IS_TERMINAL & flags));
@@ -81,41 +85,98 @@ namespace latinime {
 
     int codePoint = BinaryFormat::getCodePointAndForwardPointer(dicRoot, &pos);
     ASSERT(NOT_A_CODE_POINT != codePoint);
-    const int nodeCodePoint = codePoint;
-    // TODO: optimize this
-    int additionalWordBuf[MAX_WORD_LENGTH];
-    uint16_t additionalSubwordLength = 0;
-    additionalWordBuf[additionalSubwordLength++] = codePoint;
+    child->mCodePoint = codePoint;
+    uint16_t subwordLength = 0;
+    subword[subwordLength++] = codePoint;
 
     do {
         const int nextCodePoint = hasMultipleChars
                 ? BinaryFormat::getCodePointAndForwardPointer(dicRoot, &pos) : NOT_A_CODE_POINT;
         const bool isLastChar = (NOT_A_CODE_POINT == nextCodePoint);
         if (!isLastChar) {
-            additionalWordBuf[additionalSubwordLength++] = nextCodePoint;
+            subword[subwordLength++] = nextCodePoint;
         }
         codePoint = nextCodePoint;
     } while (NOT_A_CODE_POINT != codePoint);
+    child->mSubwordLength = subwordLength;
 
-    const int probability =
+    child->mProbability =
             isTerminal ? BinaryFormat::readProbabilityWithoutMovingPointer(dicRoot, pos) : -1;
     pos = BinaryFormat::skipProbability(flags, pos);
     int childrenPos = hasChildren ? BinaryFormat::readChildrenPosition(dicRoot, flags, pos) : 0;
-    const int attributesPos = BinaryFormat::skipChildrenPosition(flags, pos);
-    const int siblingPos = BinaryFormat::skipChildrenPosAndAttributes(dicRoot, flags, pos);
+    child->mAttributesPos = BinaryFormat::skipChildrenPosition(flags, pos);
+    child->mSiblingPos = BinaryFormat::skipChildrenPosAndAttributes(dicRoot, flags, pos);
+    child->mChildrenCount = hasChildren
+            ? BinaryFormat::getGroupCountAndForwardPointer(dicRoot, &childrenPos) : 0;
+    child->mChildrenPos = childrenPos;
+    child->mFlags = flags;
+    return child->mSiblingPos;
+}
 
-    if (isDicNodeFilteredOut(nodeCodePoint, pInfo, codePointsFilter)) {
-        return siblingPos;
+/* static */ bool DicNodeUtils::hasOnlyBmpCodePoints(const uint8_t *const dicRoot,
+        const int dicSize) {
+    // The children arrays to read, as pairs of (position of the first group, count)
+    std::vector<int> arrays;
+    int rootPos = 0;
+    const int rootCount = BinaryFormat::getGroupCountAndForwardPointer(dicRoot, &rootPos);
+    arrays.push_back(rootPos);
+    arrays.push_back(rootCount);
+    DicNodeChildrenCache::DecodedChild child;
+    int subword[MAX_WORD_LENGTH];
+    // A group takes 2 bytes at least, which bounds the groups of a broken trie that loops.
+    int remainingGroupCount = dicSize / 2;
+    while (!arrays.empty()) {
+        const int count = arrays.back();
+        arrays.pop_back();
+        int pos = arrays.back();
+        arrays.pop_back();
+        for (int i = 0; i < count && pos < dicSize; ++i) {
+            if (--remainingGroupCount < 0) {
+                return false;
+            }
+            pos = readChildGroup(dicRoot, pos, &child, subword);
+            for (int j = 0; j < child.mSubwordLength; ++j) {
+                if (subword[j] > MAX_BMP_CODE_POINT) {
+                    return false;
+                }
+            }
+            if (child.mChildrenCount > 0 && child.mChildrenPos < dicSize) {
+                arrays.push_back(child.mChildrenPos);
+                arrays.push_back(child.mChildrenCount);
+            }
+        }
     }
-    if (!isMatchedNodeCodePoint(pInfoState, pointIndex, exactOnly, nodeCodePoint)) {
-        return siblingPos;
+    return true;
+}
+
+/* static */ void DicNodeUtils::createAndGetLeavingChildNode(DicNode *dicNode,
+        const DicNodeChildrenCache::DecodedChild *const child, const int *const subword,
+        const ProximityInfoState *pInfoState, const int pointIndex, const bool exactOnly,
+        const std::vector<int> *const codePointsFilter, const ProximityInfo *const pInfo,
+        DicNodeVector *childDicNodes) {
+    if (isLeavingChildAccepted(child->mCodePoint, pInfoState, pointIndex, exactOnly,
+            codePointsFilter, pInfo)) {
+        pushLeavingChildNode(dicNode, child, subword, childDicNodes);
     }
-    const int childrenCount = hasChildren
-            ? BinaryFormat::getGroupCountAndForwardPointer(dicRoot, &childrenPos) : 0;
-    childDicNodes->pushLeavingChild(dicNode, nextPos, flags, childrenPos, attributesPos, siblingPos,
-            nodeCodePoint, childrenCount, probability, -1 /* bigramProbability */, isTerminal,
-            hasMultipleChars, hasChildren, additionalSubwordLength, additionalWordBuf);
-    return siblingPos;
+}
+
+/* static */ bool DicNodeUtils::isLeavingChildAccepted(const int nodeCodePoint,
+        const ProximityInfoState *pInfoState, const int pointIndex, const bool exactOnly,
+        const std::vector<int> *const codePointsFilter, const ProximityInfo *const pInfo) {
+    return !isDicNodeFilteredOut(nodeCodePoint, pInfo, codePointsFilter)
+            && isMatchedNodeCodePoint(pInfoState, pointIndex, exactOnly, nodeCodePoint);
+}
+
+/* static */ void DicNodeUtils::pushLeavingChildNode(DicNode *dicNode,
+        const DicNodeChildrenCache::DecodedChild *const child, const int *const subword,
+        DicNodeVector *childDicNodes) {
+    const uint8_t flags = child->mFlags;
+    childDicNodes->pushLeavingChild(dicNode, child->mPos, flags, child->mChildrenPos,
+            child->mAttributesPos, child->mSiblingPos, child->mCodePoint, child->mChildrenCount,
+            child->mProbability, -1 /* bigramProbability */,
+            0 != (BinaryFormat::FLAG_IS_TERMINAL & flags) /* isTerminal */,
+            0 != (BinaryFormat::FLAG_HAS_MULTIPLE_CHARS & flags) /* hasMultipleChars */,
+            BinaryFormat::hasChildrenInFlags(flags), child->mSubwordLength, subword);
 }
 
 /* static */ bool DicNodeUtils::isDicNodeFilteredOut(const int nodeCodePoint,
@@ -149,14 +210,72 @@ namespace latinime {
 /* static */ void DicNodeUtils::createAndGetAllLeavingChildNodes(DicNode *dicNode,
         const uint8_t *const dicRoot, const ProximityInfoState *pInfoState, const int pointIndex,
         const bool exactOnly, const std::vector<int> *const codePointsFilter,
-        const ProximityInfo *const pInfo, DicNodeVector *childDicNodes) {
-    const int terminalDepth = dicNode->getLeavingDepth();
+        const ProximityInfo *const pInfo, const DecodedNodeIndex *const nodeIndex,
+        DicNodeChildrenCache *const childrenCache, DicNodeVector *childDicNodes) {
     const int childCount = dicNode->getChildrenCount();
+    if (childCount > 0) {
+        DictionaryHeatMap::recordRead(dicRoot, dicNode->getChildrenPos());
+    }
+    const int filterSize = codePointsFilter ? codePointsFilter->size() : 0;
+    const int firstChildIndex =
+            nodeIndex ? nodeIndex->getFirstChildIndex(dicNode->getChildrenPos()) : NOT_AN_INDEX;
+    if (firstChildIndex != NOT_AN_INDEX && pInfoState && filterSize <= 0) {
+        // Most children are rejected by a lookup of their code point in the set of the accepted
+        // lower case letters. Other code points take the full test.
+        const uint32_t acceptedLetters = exactOnly
+                ? getLowerLetterBit(pInfoState->getPrimaryCodePointAt(pointIndex))
+                : pInfoState->getProximityLowerLetterMask(pointIndex);
+        DicNodeChildrenCache::DecodedChild child;
+        for (int i = firstChildIndex; i < firstChildIndex + childCount; i++) {
+            const int codePoint = nodeIndex->getCodePointAt(i);
+            const uint32_t letterBit = getLowerLetterBit(codePoint);
+            if (letterBit ? !(acceptedLetters & letterBit)
+                    : !isMatchedNodeCodePoint(pInfoState, pointIndex, exactOnly, codePoint)) {
+                continue;
+            }
+            const int *const subword = nodeIndex->decodeGroupAt(i, &child);
+            pushLeavingChildNode(dicNode, &child, subword, childDicNodes);
+        }
+        return;
+    }
+    if (firstChildIndex != NOT_AN_INDEX) {
+        DicNodeChildrenCache::DecodedChild child;
+        for (int i = firstChildIndex; i < firstChildIndex + childCount; i++) {
+            // Only the code point column is read for the children that are not accepted.
+            if (!isLeavingChildAccepted(nodeIndex->getCodePointAt(i), pInfoState, pointIndex,
+                    exactOnly, codePointsFilter, pInfo)) {
+                continue;
+            }
+            const int *const subword = nodeIndex->decodeGroupAt(i, &child);
+            pushLeavingChildNode(dicNode, &child, subword, childDicNodes);
+            if (!pInfo && filterSize > 0 && childDicNodes->exceeds(filterSize)) {
+                // All code points have been found.
+                break;
+            }
+        }
+        return;
+    }
+    if (childrenCache && childCount <= DicNodeChildrenCache::MAX_CACHED_CHILD_COUNT) {
+        const DicNodeChildrenCache::Entry *const entry =
+                getCachedChildren(dicNode, dicRoot, childrenCache);
+        for (int i = 0; i < childCount; i++) {
+            const DicNodeChildrenCache::DecodedChild *const child = entry->getChildAt(i);
+            createAndGetLeavingChildNode(dicNode, child, entry->getSubwordOf(child), pInfoState,
+                    pointIndex, exactOnly, codePointsFilter, pInfo, childDicNodes);
+            if (!pInfo && filterSize > 0 && childDicNodes->exceeds(filterSize)) {
+                // All code points have been found.
+                break;
+            }
+        }
+        return;
+    }
     int nextPos = dicNode->getChildrenPos();
+    DicNodeChildrenCache::DecodedChild child;
+    int subword[MAX_WORD_LENGTH];
     for (int i = 0; i < childCount; i++) {
-        const int filterSize = codePointsFilter ? codePointsFilter->size() : 0;
-        nextPos = createAndGetLeavingChildNode(dicNode, nextPos, dicRoot, terminalDepth, pInfoState,
-                pointIndex, exactOnly, codePointsFilter, pInfo, childDicNodes);
+        nextPos = readChildGroup(dicRoot, nextPos, &child, subword);
+        createAndGetLeavingChildNode(dicNode, &child, subword, pInfoState, pointIndex, exactOnly,
+                codePointsFilter, pInfo, childDicNodes);
         if (!pInfo && filterSize > 0 && childDicNodes->exceeds(filterSize)) {
             // All code points have been found.
             break;
@@ -164,14 +283,44 @@ namespace latinime {
     }
 }
 
+// Returns the decoded children of the leaving dicNode, reading them into the cache if needed.
+/* static */ const DicNodeChildrenCache::Entry *DicNodeUtils::getCachedChildren(
+        DicNode *dicNode, const uint8_t *const dicRoot,
+        DicNodeChildrenCache *const childrenCache) {
+    const int childrenPos = dicNode->getChildrenPos();
+    const DicNodeChildrenCache::Entry *const cachedEntry =
+            childrenCache->get(dicRoot, childrenPos);
+    if (cachedEntry) {
+        return cachedEntry;
+    }
+    DicNodeChildrenCache::Entry *const entry =
+            childrenCache->getEntryToFill(dicRoot, childrenPos);
+    const int childCount = dicNode->getChildrenCount();
+    int nextPos = childrenPos;
+    DicNodeChildrenCache::DecodedChild child;
+    int subword[MAX_WORD_LENGTH];
+    for (int i = 0; i < childCount; i++) {
+        nextPos = readChildGroup(dicRoot, nextPos, &child, subword);
+        DicNodeChildrenCache::DecodedChild *const cachedChild =
+                entry->addChild(subword, child.mSubwordLength);
+        const int subwordStart = cachedChild->mSubwordStart;
+        *cachedChild = child;
+        cachedChild->mSubwordStart = subwordStart;
+    }
+    return entry;
+}
+
 /* static */ void DicNodeUtils::getAllChildDicNodes(DicNode *dicNode, const uint8_t *const dicRoot,
+        const DecodedNodeIndex *const nodeIndex, DicNodeChildrenCache *const childrenCache,
         DicNodeVector *childDicNodes) {
-    getProximityChildDicNodes(dicNode, dicRoot, 0, 0, false, childDicNodes);
+    getProximityChildDicNodes(dicNode, dicRoot, 0, 0, false, nodeIndex, childrenCache,
+            childDicNodes);
 }
 
 /* static */ void DicNodeUtils::getProximityChildDicNodes(DicNode *dicNode,
         const uint8_t *const dicRoot, const ProximityInfoState *pInfoState, const int pointIndex,
-        bool exactOnly, DicNodeVector *childDicNodes) {
+        bool exactOnly, const DecodedNodeIndex *const nodeIndex,
+        DicNodeChildrenCache *const childrenCache, DicNodeVector *childDicNodes) {
     if (dicNode->isTotalInputSizeExceedingLimit()) {
         return;
     }
@@ -180,7 +329,7 @@ namespace latinime {
                 childDicNodes);
     } else {
         DicNodeUtils::createAndGetAllLeavingChildNodes(dicNode, dicRoot, pInfoState, pointIndex,
-                exactOnly, 0 /* codePointsFilter */, 0 /* pInfo */,
+                exactOnly, 0 /* codePointsFilter */, 0 /* pInfo */, nodeIndex, childrenCache,
                 childDicNodes);
     }
 }
@@ -192,11 +341,13 @@ namespace latinime {
  * Computes the combined bigram / unigram cost for the given dicNode.
  */
 /* static */ float DicNodeUtils::getBigramNodeImprobability(const uint8_t *const dicRoot,
-        const DicNode *const node, MultiBigramMap *multiBigramMap) {
+        const BigramListIndex *const bigramListIndex, const DicNode *const node,
+        MultiBigramMap *multiBigramMap, const ProbabilityOverlay *const probabilityOverlay) {
     if (node->isImpossibleBigramWord()) {
         return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
     }
-    const int probability = getBigramNodeProbability(dicRoot, node, multiBigramMap);
+    const int probability = getBigramNodeProbability(dicRoot, bigramListIndex, node,
+            multiBigramMap, probabilityOverlay);
     // TODO: This equation to calculate the improbability looks unreasonable.  Investigate this.
     const float cost = static_cast<float>(MAX_PROBABILITY - probability)
             / static_cast<float>(MAX_PROBABILITY);
@@ -204,14 +355,32 @@ namespace latinime {
 }
 
 /* static */ int DicNodeUtils::getBigramNodeProbability(const uint8_t *const dicRoot,
-        const DicNode *const node, MultiBigramMap *multiBigramMap) {
-    const int unigramProbability = node->getProbability();
+        const BigramListIndex *const bigramListIndex, const DicNode *const node,
+        MultiBigramMap *multiBigramMap, const ProbabilityOverlay *const probabilityOverlay) {
+    int unigramProbability = node->getProbability();
     const int wordPos = node->getPos();
     const int prevWordPos = node->getPrevWordPos();
+    if (probabilityOverlay && NOT_VALID_WORD != wordPos) {
+        if (NOT_VALID_WORD != prevWordPos) {
+            const int bigramProbability =
+                    probabilityOverlay->getBigramProbability(prevWordPos, wordPos);
+            if (NOT_A_PROBABILITY != bigramProbability) {
+                return bigramProbability;
+            }
+        }
+        // The bigrams of the dictionary are then relative to the replaced probability.
+        const int overlaidProbability = probabilityOverlay->getUnigramProbability(wordPos);
+        if (NOT_A_PROBABILITY != overlaidProbability) {
+            unigramProbability = overlaidProbability;
+        }
+    }
     if (NOT_VALID_WORD == wordPos || NOT_VALID_WORD == prevWordPos) {
         // Note: Normally wordPos comes from the dictionary and should never equal NOT_VALID_WORD.
         return backoff(unigramProbability);
     }
+    if (bigramListIndex) {
+        return bigramListIndex->getBigramProbability(prevWordPos, wordPos, unigramProbability);
+    }
     if (multiBigramMap) {
         return multiBigramMap->getBigramProbability(
                 dicRoot, prevWordPos, wordPos, unigramProbability);
@@ -21,14 +21,19 @@
 #include <vector>
 
 #include "defines.h"
+#include "dic_node_children_cache.h"
 
 namespace latinime {
 
+class BigramListIndex;
+class DecodedNodeIndex;
 class DicNode;
+class DicNodePrevWordChains;
 class DicNodeVector;
 class ProximityInfo;
 class ProximityInfoState;
 class MultiBigramMap;
+class ProbabilityOverlay;
 
 class DicNodeUtils {
  public:
@@ -37,18 +42,33 @@ class DicNodeUtils {
     static void initAsRoot(const int rootPos, const uint8_t *const dicRoot,
             const int prevWordNodePos, DicNode *newRootNode);
     static void initAsRootWithPreviousWord(const int rootPos, const uint8_t *const dicRoot,
-            DicNode *prevWordLastNode, DicNode *newRootNode);
+            DicNodePrevWordChains *prevWordChains, DicNode *prevWordLastNode,
+            DicNode *newRootNode);
     static void initByCopy(DicNode *srcNode, DicNode *destNode);
+    // nodeIndex and childrenCache may be null. Children are taken from nodeIndex if given, else
+    // from childrenCache, else read from the dictionary.
     static void getAllChildDicNodes(DicNode *dicNode, const uint8_t *const dicRoot,
+            const DecodedNodeIndex *const nodeIndex, DicNodeChildrenCache *const childrenCache,
             DicNodeVector *childDicNodes);
+    // bigramListIndex, multiBigramMap and probabilityOverlay may be null. The bigrams are looked
+    // up in bigramListIndex if given, else in multiBigramMap, else in the dictionary.
     static float getBigramNodeImprobability(const uint8_t *const dicRoot,
-            const DicNode *const node, MultiBigramMap *const multiBigramMap);
+            const BigramListIndex *const bigramListIndex, const DicNode *const node,
+            MultiBigramMap *const multiBigramMap,
+            const ProbabilityOverlay *const probabilityOverlay);
     static bool isDicNodeFilteredOut(const int nodeCodePoint, const ProximityInfo *const pInfo,
             const std::vector<int> *const codePointsFilter);
     // TODO: Move to private
     static void getProximityChildDicNodes(DicNode *dicNode, const uint8_t *const dicRoot,
             const ProximityInfoState *pInfoState, const int pointIndex, bool exactOnly,
+            const DecodedNodeIndex *const nodeIndex, DicNodeChildrenCache *const childrenCache,
             DicNodeVector *childDicNodes);
+    // Decodes the char group at pos and its code points into subword. Returns the position of
+    // the next sibling group.
+    static int readChildGroup(const uint8_t *const dicRoot, int pos,
+            DicNodeChildrenCache::DecodedChild *const child, int *const subword);
+    // Whether all the code points of the trie at dicRoot are in the BMP. Reads the whole trie.
+    static bool hasOnlyBmpCodePoints(const uint8_t *const dicRoot, const int dicSize);
 
     // TODO: Move to proximity info
     static bool isProximityChar(ProximityType type) {
@@ -60,18 +80,29 @@ class DicNodeUtils {
     // Max number of bigrams to look up
     static const int MAX_BIGRAMS_CONSIDERED_PER_CONTEXT = 500;
 
-    static int getBigramNodeProbability(const uint8_t *const dicRoot, const DicNode *const node,
-            MultiBigramMap *multiBigramMap);
+    static int getBigramNodeProbability(const uint8_t *const dicRoot,
+            const BigramListIndex *const bigramListIndex, const DicNode *const node,
+            MultiBigramMap *multiBigramMap, const ProbabilityOverlay *const probabilityOverlay);
     static void createAndGetPassingChildNode(DicNode *dicNode, const ProximityInfoState *pInfoState,
             const int pointIndex, const bool exactOnly, DicNodeVector *childDicNodes);
     static void createAndGetAllLeavingChildNodes(DicNode *dicNode, const uint8_t *const dicRoot,
             const ProximityInfoState *pInfoState, const int pointIndex, const bool exactOnly,
-            const std::vector<int> *const codePointsFilter,
-            const ProximityInfo *const pInfo, DicNodeVector *childDicNodes);
-    static int createAndGetLeavingChildNode(DicNode *dicNode, int pos, const uint8_t *const dicRoot,
-            const int terminalDepth, const ProximityInfoState *pInfoState, const int pointIndex,
-            const bool exactOnly, const std::vector<int> *const codePointsFilter,
-            const ProximityInfo *const pInfo, DicNodeVector *childDicNodes);
+            const std::vector<int> *const codePointsFilter, const ProximityInfo *const pInfo,
+            const DecodedNodeIndex *const nodeIndex, DicNodeChildrenCache *const childrenCache,
+            DicNodeVector *childDicNodes);
+    static const DicNodeChildrenCache::Entry *getCachedChildren(DicNode *dicNode,
+            const uint8_t *const dicRoot, DicNodeChildrenCache *const childrenCache);
+    static void createAndGetLeavingChildNode(DicNode *dicNode,
+            const DicNodeChildrenCache::DecodedChild *const child, const int *const subword,
+            const ProximityInfoState *pInfoState, const int pointIndex, const bool exactOnly,
+            const std::vector<int> *const codePointsFilter, const ProximityInfo *const pInfo,
+            DicNodeVector *childDicNodes);
+    static bool isLeavingChildAccepted(const int nodeCodePoint,
+            const ProximityInfoState *pInfoState, const int pointIndex, const bool exactOnly,
+            const std::vector<int> *const codePointsFilter, const ProximityInfo *const pInfo);
+    static void pushLeavingChildNode(DicNode *dicNode,
+            const DicNodeChildrenCache::DecodedChild *const child, const int *const subword,
+            DicNodeVector *childDicNodes);
 
     // TODO: Move to proximity info
     static bool isMatchedNodeCodePoint(const ProximityInfoState *pInfoState, const int pointIndex,
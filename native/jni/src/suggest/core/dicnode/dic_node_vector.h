@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "defines.h"
+#include "memory_utils.h"
 #include "dic_node.h"
 
 namespace latinime {
@@ -32,34 +33,41 @@ class DicNodeVector {
 #else
     static const int DEFAULT_NODES_SIZE_FOR_OPTIMIZATION = 60;
 #endif
-    AK_FORCE_INLINE DicNodeVector() : mDicNodes(0), mLock(false), mEmptyNode() {}
+    AK_FORCE_INLINE DicNodeVector() : mDicNodes(0), mSize(0), mLock(false), mEmptyNode() {}
 
     // Specify the capacity of the vector
-    AK_FORCE_INLINE DicNodeVector(const int size) : mDicNodes(0), mLock(false), mEmptyNode() {
+    AK_FORCE_INLINE DicNodeVector(const int size)
+            : mDicNodes(0), mSize(0), mLock(false), mEmptyNode() {
         mDicNodes.reserve(size);
     }
 
     // Non virtual inline destructor -- never inherit this class
     AK_FORCE_INLINE ~DicNodeVector() {}
 
+    // The dicNodes are kept and overwritten by the next pushes. Copying a whole DicNode including
+    // its word buffers on every push costs more than initializing it in place.
     AK_FORCE_INLINE void clear() {
-        mDicNodes.clear();
+        mSize = 0;
         mLock = false;
     }
 
+    // The bytes allocated for the dicNodes, including the retained capacity.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mDicNodes);
+    }
+
     int getSizeAndLock() {
         mLock = true;
-        return static_cast<int>(mDicNodes.size());
+        return mSize;
     }
 
     bool exceeds(const size_t limit) const {
-        return mDicNodes.size() >= limit;
+        return static_cast<size_t>(mSize) >= limit;
     }
 
     void pushPassingChild(DicNode *dicNode) {
         ASSERT(!mLock);
-        mDicNodes.push_back(mEmptyNode);
-        mDicNodes.back().initAsPassingChild(dicNode);
+        getNextDicNode()->initAsPassingChild(dicNode);
     }
 
     void pushLeavingChild(DicNode *dicNode, const int pos, const uint8_t flags,
@@ -69,25 +77,33 @@ class DicNodeVector {
             const bool hasChildren, const uint16_t additionalSubwordLength,
             const int *additionalSubword) {
         ASSERT(!mLock);
-        mDicNodes.push_back(mEmptyNode);
-        mDicNodes.back().initAsChild(dicNode, pos, flags, childrenPos, attributesPos, siblingPos,
+        getNextDicNode()->initAsChild(dicNode, pos, flags, childrenPos, attributesPos, siblingPos,
                 nodeCodePoint, childrenCount, probability, -1 /* bigramProbability */, isTerminal,
                 hasMultipleChars, hasChildren, additionalSubwordLength, additionalSubword);
     }
 
     DicNode *operator[](const int id) {
-        ASSERT(id < static_cast<int>(mDicNodes.size()));
+        ASSERT(id < mSize);
         return &mDicNodes[id];
     }
 
     DicNode *front() {
-        ASSERT(1 <= static_cast<int>(mDicNodes.size()));
+        ASSERT(1 <= mSize);
         return &mDicNodes[0];
     }
 
  private:
     DISALLOW_COPY_AND_ASSIGN(DicNodeVector);
+
+    AK_FORCE_INLINE DicNode *getNextDicNode() {
+        if (mSize == static_cast<int>(mDicNodes.size())) {
+            mDicNodes.push_back(mEmptyNode);
+        }
+        return &mDicNodes[mSize++];
+    }
+
     std::vector<DicNode> mDicNodes;
+    int mSize;
     bool mLock;
     DicNode mEmptyNode;
 };
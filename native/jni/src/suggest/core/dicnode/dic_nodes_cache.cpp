@@ -17,17 +17,27 @@
 #include <list>
 
 #include "defines.h"
+#include "dic_node_prev_word_chains.h"
 #include "dic_node_priority_queue.h"
 #include "dic_node_utils.h"
 #include "dic_nodes_cache.h"
 
 namespace latinime {
 
+const int DicNodesCache::CACHE_BACK_LENGTH = 3;
+
 /**
  * Truncates all of the dicNodes so that they start at the given commit point.
  * Only called for multi-word typing input.
+ *
+ * The dicNodes of the continuous suggestion cache are the only ones left that use prevWordChains,
+ * so the truncated chains are built in truncatedPrevWordChains and then replace prevWordChains.
+ * The dicNodes that shared the records of their previous words share their truncated copies, and
+ * the records of the committed words are dropped, so that the chains do not grow with the number
+ * of commits.
  */
-DicNode *DicNodesCache::setCommitPoint(int commitPoint) {
+int DicNodesCache::setCommitPoint(int commitPoint, DicNodePrevWordChains *prevWordChains,
+        DicNodePrevWordChains *truncatedPrevWordChains) {
     std::list<DicNode> dicNodesList;
     while (mCachedDicNodesForContinuousSuggestion->getSize() > 0) {
         DicNode dicNode;
@@ -40,12 +50,17 @@ DicNode *DicNodesCache::setCommitPoint(int commitPoint) {
     DicNode *topDicNode = &dicNodesList.front();
     DicNode topDicNodeCopy;
     DicNodeUtils::initByCopy(topDicNode, &topDicNodeCopy);
+    const int topPrevWordOffset = topDicNodeCopy.getPrevWordCommitOffset(commitPoint);
+    const int topPrevWordNodePos = topDicNodeCopy.getPrevWordNodePos();
 
     // Keep only those dicNodes that match the same starting words.
+    truncatedPrevWordChains->clear();
+    DicNodePrevWordChains::CopiedIndexMap copiedIndices;
     std::list<DicNode>::iterator iter;
     for (iter = dicNodesList.begin(); iter != dicNodesList.end(); iter++) {
         DicNode *dicNode = &*iter;
-        if (dicNode->truncateNode(&topDicNodeCopy, commitPoint)) {
+        if (dicNode->truncateNode(&topDicNodeCopy, commitPoint, topPrevWordOffset,
+                truncatedPrevWordChains, &copiedIndices)) {
             mCachedDicNodesForContinuousSuggestion->copyPush(dicNode);
         } else {
             // Top dicNode should be reprocessed.
@@ -53,7 +68,9 @@ DicNode *DicNodesCache::setCommitPoint(int commitPoint) {
             DicNode::managedDelete(dicNode);
         }
     }
+    prevWordChains->swap(truncatedPrevWordChains);
+    truncatedPrevWordChains->clear();
     mInputIndex -= commitPoint;
-    return topDicNode;
+    return topPrevWordNodePos;
 }
 }  // namespace latinime
@@ -18,9 +18,12 @@
 #define LATINIME_DIC_NODES_CACHE_H
 
 #include <stdint.h>
+#include <vector>
 
 #include "defines.h"
 #include "dic_node_priority_queue.h"
+#include "memory_utils.h"
+#include "suggest/core/session/search_statistics.h"
 
 #define INITIAL_QUEUE_ID_ACTIVE 0
 #define INITIAL_QUEUE_ID_NEXT_ACTIVE 1
@@ -31,19 +34,39 @@
 namespace latinime {
 
 class DicNode;
+class DicNodePrevWordChains;
 
 /**
  * Class for controlling dicNode search priority queue and lexicon trie traversal.
+ *
+ * The queues draw their nodes from one slab. The active, the next active and the continuous
+ * suggestion queues trade places as the search advances, so they share the capacity of the widest
+ * beam; the terminal queue only ever keeps MAX_RESULTS nodes.
  */
 class DicNodesCache {
  public:
-    AK_FORCE_INLINE DicNodesCache()
-            : mActiveDicNodes(&mDicNodePriorityQueues[INITIAL_QUEUE_ID_ACTIVE]),
+    // Nodes more than this number of input indices behind the end of the input are not affected
+    // by appending to the input.
+    static const int CACHE_BACK_LENGTH;
+
+    // The pushes and pops are counted in statistics.
+    AK_FORCE_INLINE explicit DicNodesCache(SearchStatistics *const statistics)
+            : mStatistics(statistics), mDicNodesBuf(),
+              mActiveDicNodes(&mDicNodePriorityQueues[INITIAL_QUEUE_ID_ACTIVE]),
               mNextActiveDicNodes(&mDicNodePriorityQueues[INITIAL_QUEUE_ID_NEXT_ACTIVE]),
               mTerminalDicNodes(&mDicNodePriorityQueues[INITIAL_QUEUE_ID_TERMINAL]),
               mCachedDicNodesForContinuousSuggestion(
                       &mDicNodePriorityQueues[INITIAL_QUEUE_ID_CACHE_FOR_CONTINUOUS_SUGGESTION]),
               mInputIndex(0), mLastCachedInputIndex(0) {
+        mDicNodesBuf.resize(ROTATING_QUEUES_SIZE * (ROTATING_QUEUE_CAPACITY + 1)
+                + TERMINAL_QUEUE_CAPACITY + 1);
+        DicNode *dicNodesBuf = &mDicNodesBuf[0];
+        for (int i = 0; i < PRIORITY_QUEUES_SIZE; ++i) {
+            const int capacity = (i == INITIAL_QUEUE_ID_TERMINAL)
+                    ? TERMINAL_QUEUE_CAPACITY : ROTATING_QUEUE_CAPACITY;
+            mDicNodePriorityQueues[i].init(dicNodesBuf, capacity);
+            dicNodesBuf += capacity + 1;
+        }
     }
 
     AK_FORCE_INLINE virtual ~DicNodesCache() {}
@@ -73,9 +96,23 @@ class DicNodesCache {
                 moveNodesAndReturnReusableEmptyQueue(mNextActiveDicNodes, &mActiveDicNodes);
     }
 
-    DicNode *setCommitPoint(int commitPoint);
+    // Returns the position of the last committed word, for the bigrams of the next words.
+    int setCommitPoint(int commitPoint, DicNodePrevWordChains *prevWordChains,
+            DicNodePrevWordChains *truncatedPrevWordChains);
+
+    // The beam width: the number of dicNodes kept for the next input index.
+    AK_FORCE_INLINE void setNextActiveCacheSize(const int nextActiveSize) {
+        mNextActiveDicNodes->setMaxSize(nextActiveSize);
+    }
+
+    // Makes the search start at inputIndex. The caller pushes the frontier of that index.
+    AK_FORCE_INLINE void setInputIndexToResume(const int inputIndex) {
+        mInputIndex = inputIndex;
+        mLastCachedInputIndex = inputIndex;
+    }
 
     int activeSize() const { return mActiveDicNodes->getSize(); }
+    int getInputIndex() const { return mInputIndex; }
     int terminalSize() const { return mTerminalDicNodes->getSize(); }
     bool isLookAheadCorrectionInputIndex(const int inputIndex) const {
         return inputIndex == mInputIndex - 1;
@@ -87,19 +124,37 @@ class DicNodesCache {
     }
 
     AK_FORCE_INLINE void copyPushTerminal(DicNode *dicNode) {
-        mTerminalDicNodes->copyPush(dicNode);
+        mStatistics->countTerminal();
+        // The same word reached through several corrections takes a single slot.
+        if (mTerminalDicNodes->copyMergeSameWord(dicNode)) {
+            mStatistics->countDuplicateTerminal();
+            return;
+        }
+        copyPushAndCount(mTerminalDicNodes, dicNode,
+                SearchStatistics::STATISTIC_TERMINAL_QUEUE_HIGH_WATER_MARK,
+                SearchStatistics::STATISTIC_TERMINAL_QUEUE_OVERFLOWS);
     }
 
     AK_FORCE_INLINE void copyPushActive(DicNode *dicNode) {
-        mActiveDicNodes->copyPush(dicNode);
+        copyPushAndCount(mActiveDicNodes, dicNode,
+                SearchStatistics::STATISTIC_ACTIVE_QUEUE_HIGH_WATER_MARK,
+                SearchStatistics::STATISTIC_ACTIVE_QUEUE_OVERFLOWS);
     }
 
     AK_FORCE_INLINE bool copyPushContinue(DicNode *dicNode) {
-        return mCachedDicNodesForContinuousSuggestion->copyPush(dicNode);
+        return copyPushAndCount(mCachedDicNodesForContinuousSuggestion, dicNode,
+                SearchStatistics::STATISTIC_CONTINUOUS_QUEUE_HIGH_WATER_MARK,
+                SearchStatistics::STATISTIC_CONTINUOUS_QUEUE_OVERFLOWS);
     }
 
     AK_FORCE_INLINE void copyPushNextActive(DicNode *dicNode) {
+        const int size = mNextActiveDicNodes->getSize();
         DicNode *pushedDicNode = mNextActiveDicNodes->copyPush(dicNode);
+        // A full queue drops either this dicNode or its worst one.
+        mStatistics->countPushedDicNode(mNextActiveDicNodes->getSize() == size);
+        mStatistics->updateHighWaterMark(
+                SearchStatistics::STATISTIC_NEXT_ACTIVE_QUEUE_HIGH_WATER_MARK,
+                mNextActiveDicNodes->getSize());
         if (!pushedDicNode) {
             if (dicNode->isCached()) {
                 dicNode->remove();
@@ -109,22 +164,58 @@ class DicNodesCache {
         }
     }
 
-    void popTerminal(DicNode *dest) {
-        mTerminalDicNodes->copyPop(dest);
+    // Drops a dicNode instead of pushing it to the next active queue.
+    AK_FORCE_INLINE void dropPrunedDicNode(DicNode *dicNode) {
+        mStatistics->countPrunedDicNode();
+        if (dicNode->isCached()) {
+            dicNode->remove();
+        }
+    }
+
+    // Returns the distance of the worst terminal once the terminal queue is full, which a new
+    // terminal has to beat to replace it.
+    AK_FORCE_INLINE bool getWorstTerminalDistance(float *const outDistance) const {
+        if (mTerminalDicNodes->getSize() < mTerminalDicNodes->getMaxSize()) {
+            return false;
+        }
+        return mTerminalDicNodes->getWorstDistance(outDistance);
+    }
+
+    // The terminals stay in the queue until clearTerminals() is called.
+    int getSortedTerminals(DicNode **const dest, const int maxCount) {
+        return mTerminalDicNodes->getSortedDicNodes(dest, maxCount);
+    }
+
+    void clearTerminals() {
+        mTerminalDicNodes->clear();
     }
 
     void popActive(DicNode *dest) {
+        mStatistics->countExpandedDicNode();
         mActiveDicNodes->copyPop(dest);
     }
 
+    // Drops the nodes cached to continue the search, e.g. because they refer to another
+    // dictionary than the next search.
+    AK_FORCE_INLINE void clearCachedDicNodesForContinuousSuggestion() {
+        mCachedDicNodesForContinuousSuggestion->clear();
+    }
+
+    // The bytes allocated for the nodes and the queues.
+    int getMemorySize() const {
+        int memorySize = MemoryUtils::getVectorMemorySize(&mDicNodesBuf);
+        for (int i = 0; i < PRIORITY_QUEUES_SIZE; ++i) {
+            memorySize += mDicNodePriorityQueues[i].getMemorySize();
+        }
+        return memorySize;
+    }
+
     bool hasCachedDicNodesForContinuousSuggestion() const {
         return mCachedDicNodesForContinuousSuggestion
                 && mCachedDicNodesForContinuousSuggestion->getSize() > 0;
     }
 
     AK_FORCE_INLINE bool isCacheBorderForTyping(const int inputSize) const {
-        // TODO: Move this variable to header
-        static const int CACHE_BACK_LENGTH = 3;
         const int cacheInputIndex = inputSize - CACHE_BACK_LENGTH;
         const bool shouldCache = (cacheInputIndex == mInputIndex)
                 && (cacheInputIndex != mLastCachedInputIndex);
@@ -137,6 +228,9 @@ class DicNodesCache {
 
  private:
     DISALLOW_COPY_AND_ASSIGN(DicNodesCache);
+    static const int ROTATING_QUEUES_SIZE = PRIORITY_QUEUES_SIZE - 1;
+    static const int ROTATING_QUEUE_CAPACITY = MAX_DIC_NODE_PRIORITY_QUEUE_CAPACITY;
+    static const int TERMINAL_QUEUE_CAPACITY = MAX_RESULTS;
 
     AK_FORCE_INLINE void restoreActiveDicNodesFromCache() {
         if (DEBUG_DICT) {
@@ -154,6 +248,7 @@ class DicNodesCache {
 
     AK_FORCE_INLINE static DicNodePriorityQueue *moveNodesAndReturnReusableEmptyQueue(
             DicNodePriorityQueue *src, DicNodePriorityQueue **dest) {
+        ASSERT(src->getCapacity() == (*dest)->getCapacity());
         const int srcMaxSize = src->getMaxSize();
         const int destMaxSize = (*dest)->getMaxSize();
         DicNodePriorityQueue *tmp = *dest;
@@ -163,12 +258,27 @@ class DicNodesCache {
         return tmp;
     }
 
+    // A full queue drops either this dicNode or its worst one, so its size does not change.
+    AK_FORCE_INLINE DicNode *copyPushAndCount(DicNodePriorityQueue *const queue,
+            DicNode *const dicNode, const int highWaterMarkStatistic,
+            const int overflowStatistic) {
+        const int size = queue->getSize();
+        DicNode *const pushedDicNode = queue->copyPush(dicNode);
+        const int newSize = queue->getSize();
+        mStatistics->countQueuePush(highWaterMarkStatistic, overflowStatistic, newSize,
+                newSize == size);
+        return pushedDicNode;
+    }
+
     AK_FORCE_INLINE void resetTemporaryCaches() {
         mActiveDicNodes->clear();
         mNextActiveDicNodes->clear();
         mTerminalDicNodes->clear();
     }
 
+    SearchStatistics *const mStatistics;
+    // The slots of all of the queues. It is never resized, as the queues point into it.
+    std::vector<DicNode> mDicNodesBuf;
     DicNodePriorityQueue mDicNodePriorityQueues[PRIORITY_QUEUES_SIZE];
     // Active dicNodes currently being expanded.
     DicNodePriorityQueue *mActiveDicNodes;
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: bigram_list_index.cpp"
+
+#include "suggest/core/dictionary/bigram_list_index.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "binary_format.h"
+#include "suggest/core/dicnode/dic_node_utils.h"
+
+namespace latinime {
+
+// Bounds the reading of a broken trie, as WordAddressIndex does.
+const int BigramListIndex::MAX_GROUP_COUNT = 1 << 20;
+// 4 bytes per bigram: the bigrams stay under 16MB.
+const int BigramListIndex::MAX_BIGRAM_COUNT = 1 << 22;
+// The probability of a bigram is the 4 bits of BinaryFormat::MASK_ATTRIBUTE_PROBABILITY.
+static const int PROBABILITY_BIT_COUNT = 4;
+
+// Orders the pairs of (word position, packed bigram) by word, then by target, and leaves the
+// bigrams of a word to the same target in the order of the list.
+static bool compareBigrams(const std::pair<int, uint32_t> &left,
+        const std::pair<int, uint32_t> &right) {
+    if (left.first != right.first) {
+        return left.first < right.first;
+    }
+    return (left.second >> PROBABILITY_BIT_COUNT) < (right.second >> PROBABILITY_BIT_COUNT);
+}
+
+/* static */ BigramListIndex *BigramListIndex::create(const uint8_t *const dicRoot,
+        const int dicSize) {
+    BigramListIndex *const index = new BigramListIndex();
+    if (!index->build(dicRoot, dicSize)) {
+        AKLOGI("No bigram list index for the dictionary of size %d", dicSize);
+        delete index;
+        return 0;
+    }
+    return index;
+}
+
+int BigramListIndex::getBigramProbability(const int position, const int nextPosition,
+        const int unigramProbability) const {
+    const std::vector<int>::const_iterator word =
+            std::lower_bound(mWordPositions.begin(), mWordPositions.end(), position);
+    if (word == mWordPositions.end() || *word != position || nextPosition < 0) {
+        return backoff(unigramProbability);
+    }
+    const int wordIndex = static_cast<int>(word - mWordPositions.begin());
+    const std::vector<uint32_t>::const_iterator end =
+            mBigrams.begin() + mBigramStarts[wordIndex + 1];
+    // The first bigram whose target is not before nextPosition
+    const std::vector<uint32_t>::const_iterator bigram = std::lower_bound(
+            mBigrams.begin() + mBigramStarts[wordIndex], end,
+            static_cast<uint32_t>(nextPosition) << PROBABILITY_BIT_COUNT);
+    if (bigram == end || static_cast<int>(*bigram >> PROBABILITY_BIT_COUNT) != nextPosition) {
+        return backoff(unigramProbability);
+    }
+    return BinaryFormat::computeProbabilityForBigram(unigramProbability,
+            static_cast<int>(*bigram & BinaryFormat::MASK_ATTRIBUTE_PROBABILITY));
+}
+
+bool BigramListIndex::build(const uint8_t *const dicRoot, const int dicSize) {
+    // The positions are packed above the probabilities.
+    if (dicSize <= 0 || dicSize > (1 << (32 - PROBABILITY_BIT_COUNT))) {
+        return false;
+    }
+    // Children arrays to read, as pairs of (position, group count)
+    std::vector<int> pendingArrays;
+    int rootPos = 0;
+    const int rootCount = BinaryFormat::getGroupCountAndForwardPointer(dicRoot, &rootPos);
+    pendingArrays.push_back(rootPos);
+    pendingArrays.push_back(rootCount);
+    std::vector<std::pair<int, uint32_t> > bigrams;
+    int groupCount = 0;
+    int subword[MAX_WORD_LENGTH];
+    while (!pendingArrays.empty()) {
+        const int count = pendingArrays.back();
+        pendingArrays.pop_back();
+        int pos = pendingArrays.back();
+        pendingArrays.pop_back();
+        groupCount += count;
+        if (count <= 0 || pos <= 0 || pos >= dicSize || groupCount > MAX_GROUP_COUNT) {
+            return false;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (pos >= dicSize) {
+                return false;
+            }
+            DicNodeChildrenCache::DecodedChild child;
+            pos = DicNodeUtils::readChildGroup(dicRoot, pos, &child, subword);
+            if (child.mChildrenCount > 0) {
+                pendingArrays.push_back(child.mChildrenPos);
+                pendingArrays.push_back(child.mChildrenCount);
+            }
+            if (!(BinaryFormat::FLAG_HAS_BIGRAMS & child.mFlags)) {
+                continue;
+            }
+            int bigramPos = BinaryFormat::skipShortcuts(dicRoot, child.mFlags,
+                    child.mAttributesPos);
+            uint8_t bigramFlags;
+            do {
+                if (bigramPos >= dicSize
+                        || static_cast<int>(bigrams.size()) >= MAX_BIGRAM_COUNT) {
+                    return false;
+                }
+                bigramFlags = BinaryFormat::getFlagsAndForwardPointer(dicRoot, &bigramPos);
+                const int targetPos = BinaryFormat::getAttributeAddressAndForwardPointer(dicRoot,
+                        bigramFlags, &bigramPos);
+                if (targetPos < 0 || targetPos >= dicSize) {
+                    return false;
+                }
+                bigrams.push_back(std::make_pair(child.mPos,
+                        (static_cast<uint32_t>(targetPos) << PROBABILITY_BIT_COUNT)
+                                | (BinaryFormat::MASK_ATTRIBUTE_PROBABILITY & bigramFlags)));
+            } while (BinaryFormat::FLAG_ATTRIBUTE_HAS_NEXT & bigramFlags);
+        }
+    }
+
+    std::stable_sort(bigrams.begin(), bigrams.end(), compareBigrams);
+    const int bigramCount = static_cast<int>(bigrams.size());
+    mBigrams.reserve(bigramCount);
+    for (int i = 0; i < bigramCount; ++i) {
+        const bool isNewWord = i == 0 || bigrams[i].first != bigrams[i - 1].first;
+        if (!isNewWord && (bigrams[i].second >> PROBABILITY_BIT_COUNT)
+                == (bigrams[i - 1].second >> PROBABILITY_BIT_COUNT)) {
+            // Keep the first bigram to a target, which is the one the list scan finds.
+            continue;
+        }
+        if (isNewWord) {
+            mWordPositions.push_back(bigrams[i].first);
+            mBigramStarts.push_back(static_cast<int>(mBigrams.size()));
+        }
+        mBigrams.push_back(bigrams[i].second);
+    }
+    mBigramStarts.push_back(static_cast<int>(mBigrams.size()));
+    return true;
+}
+} // namespace latinime
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_BIGRAM_LIST_INDEX_H
+#define LATINIME_BIGRAM_LIST_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "memory_utils.h"
+
+namespace latinime {
+
+/**
+ * The bigrams of every word of a dictionary, so that the bigram of a word pair is found by two
+ * binary searches instead of decoding the attributes of the previous word until its target, as
+ * BinaryFormat::getBigramProbability does. The positions of the words that have bigrams are
+ * sorted, and the bigrams of each word are packed as (target position << 4 | probability) and
+ * sorted by target. Immutable once created, hence shared by all sessions, including the
+ * expansion workers, which have no bigram map of their own.
+ */
+class BigramListIndex {
+ public:
+    // Returns 0 if the dictionary is too large to index or seems broken.
+    static BigramListIndex *create(const uint8_t *const dicRoot, const int dicSize);
+
+    // The bytes allocated for the index, including the retained capacity.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mWordPositions)
+                + MemoryUtils::getVectorMemorySize(&mBigramStarts)
+                + MemoryUtils::getVectorMemorySize(&mBigrams);
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    ~BigramListIndex() {}
+
+    // For parameters and return value see BinaryFormat::getBigramProbability.
+    int getBigramProbability(const int position, const int nextPosition,
+            const int unigramProbability) const;
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(BigramListIndex);
+    static const int MAX_GROUP_COUNT;
+    static const int MAX_BIGRAM_COUNT;
+
+    BigramListIndex() : mWordPositions(), mBigramStarts(), mBigrams() {}
+
+    bool build(const uint8_t *const dicRoot, const int dicSize);
+
+    // The positions of the words that have bigrams, sorted
+    std::vector<int> mWordPositions;
+    // The bigrams of mWordPositions[i] are at [mBigramStarts[i], mBigramStarts[i + 1]) of mBigrams.
+    std::vector<int> mBigramStarts;
+    std::vector<uint32_t> mBigrams;
+};
+} // namespace latinime
+#endif // LATINIME_BIGRAM_LIST_INDEX_H
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: completion_index.cpp"
+
+#include "suggest/core/dictionary/completion_index.h"
+
+#include <cstring>
+#include <queue>
+#include <utility>
+
+#include "binary_format.h"
+#include "suggest/core/dicnode/dic_node_utils.h"
+
+namespace latinime {
+
+// 16 bytes per group: the index stays under 16MB.
+const int CompletionIndex::MAX_GROUP_COUNT = 1 << 20;
+
+/* static */ CompletionIndex *CompletionIndex::create(const uint8_t *const dicRoot,
+        const int dicSize) {
+    CompletionIndex *const index = new CompletionIndex();
+    if (!index->build(dicRoot, dicSize)) {
+        AKLOGI("No completion index for the dictionary of size %d", dicSize);
+        delete index;
+        return 0;
+    }
+    return index;
+}
+
+// Writes the code points of the group at pos to outCodePoints, which has room for maxLength,
+// and returns their count, or NOT_AN_INDEX if they do not fit.
+static int readGroupCodePoints(const uint8_t *const dicRoot, int pos, int *const outCodePoints,
+        const int maxLength) {
+    const uint8_t flags = BinaryFormat::getFlagsAndForwardPointer(dicRoot, &pos);
+    int codePoint = BinaryFormat::getCodePointAndForwardPointer(dicRoot, &pos);
+    int length = 0;
+    while (NOT_A_CODE_POINT != codePoint) {
+        if (length >= maxLength) {
+            return NOT_AN_INDEX;
+        }
+        outCodePoints[length++] = codePoint;
+        if (!(BinaryFormat::FLAG_HAS_MULTIPLE_CHARS & flags)) {
+            break;
+        }
+        codePoint = BinaryFormat::getCodePointAndForwardPointer(dicRoot, &pos);
+    }
+    return length;
+}
+
+int CompletionIndex::getCompletions(const uint8_t *const dicRoot, const int *const prefix,
+        const int prefixLength, const int maxCount, int *const outCodePoints,
+        int *const outProbabilities) const {
+    if (maxCount <= 0 || prefixLength < 0 || prefixLength >= MAX_WORD_LENGTH) {
+        return 0;
+    }
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, QueueEntryComparator> queue;
+    // The groups visited in the descent, as pairs of (index of the group, index in the path of
+    // the entry of its parent). The first groups of the words are those of the root array for
+    // an empty prefix, or the group where the prefix ends.
+    std::vector<std::pair<int, int> > path;
+    int prefixGroupIndex = NOT_AN_INDEX;
+    int matchedLength = 0;
+    if (prefixLength > 0) {
+        prefixGroupIndex = findPrefixGroup(dicRoot, prefix, prefixLength, &matchedLength);
+        if (NOT_AN_INDEX == prefixGroupIndex) {
+            return 0;
+        }
+    }
+    const int firstIndex = NOT_AN_INDEX == prefixGroupIndex ? 0 : prefixGroupIndex;
+    const int firstCount = NOT_AN_INDEX == prefixGroupIndex ? mRootCount : 1;
+    for (int i = firstIndex; i < firstIndex + firstCount; ++i) {
+        if (NOT_A_PROBABILITY != mGroups[i].mMaxProbability) {
+            path.push_back(std::make_pair(i, NOT_AN_INDEX));
+            const QueueEntry entry = { mGroups[i].mMaxProbability, i,
+                    static_cast<int>(path.size()) - 1, false };
+            queue.push(entry);
+        }
+    }
+    // The prefix but for the code points of its group, which the first group of the path writes
+    const int prefixHeadLength = prefixLength - matchedLength;
+    int count = 0;
+    while (!queue.empty() && count < maxCount) {
+        const QueueEntry entry = queue.top();
+        queue.pop();
+        const Group *const group = &mGroups[entry.mGroupIndex];
+        if (entry.mIsWord) {
+            int pathGroupIndices[MAX_WORD_LENGTH];
+            int depth = 0;
+            for (int i = entry.mPathIndex; i != NOT_AN_INDEX && depth < MAX_WORD_LENGTH;
+                    i = path[i].second) {
+                pathGroupIndices[depth++] = path[i].first;
+            }
+            int *const word = &outCodePoints[count * MAX_WORD_LENGTH];
+            memcpy(word, prefix, prefixHeadLength * sizeof(word[0]));
+            int length = prefixHeadLength;
+            while (depth > 0 && length != NOT_AN_INDEX) {
+                const int groupLength = readGroupCodePoints(dicRoot,
+                        mGroups[pathGroupIndices[--depth]].mPos, &word[length],
+                        MAX_WORD_LENGTH - length);
+                length = NOT_AN_INDEX == groupLength ? NOT_AN_INDEX : length + groupLength;
+            }
+            if (NOT_AN_INDEX == length) {
+                // Too long to be output.
+                continue;
+            }
+            if (length < MAX_WORD_LENGTH) {
+                word[length] = 0;
+            }
+            outProbabilities[count] = entry.mProbability;
+            ++count;
+            continue;
+        }
+        if (NOT_A_PROBABILITY != group->mProbability) {
+            const QueueEntry wordEntry = { group->mProbability, entry.mGroupIndex,
+                    entry.mPathIndex, true };
+            queue.push(wordEntry);
+        }
+        if (NOT_AN_INDEX == group->mFirstChildIndex) {
+            continue;
+        }
+        for (int i = group->mFirstChildIndex; i < group->mFirstChildIndex + group->mChildrenCount;
+                ++i) {
+            if (NOT_A_PROBABILITY != mGroups[i].mMaxProbability) {
+                path.push_back(std::make_pair(i, entry.mPathIndex));
+                const QueueEntry childEntry = { mGroups[i].mMaxProbability, i,
+                        static_cast<int>(path.size()) - 1, false };
+                queue.push(childEntry);
+            }
+        }
+    }
+    return count;
+}
+
+int CompletionIndex::findPrefixGroup(const uint8_t *const dicRoot, const int *const prefix,
+        const int prefixLength, int *const outMatchedLength) const {
+    int firstIndex = 0;
+    int groupCount = mRootCount;
+    int prefixIndex = 0;
+    while (true) {
+        int groupIndex = NOT_AN_INDEX;
+        uint8_t flags = 0;
+        int pos = 0;
+        for (int i = firstIndex; i < firstIndex + groupCount; ++i) {
+            pos = mGroups[i].mPos;
+            flags = BinaryFormat::getFlagsAndForwardPointer(dicRoot, &pos);
+            if (BinaryFormat::getCodePointAndForwardPointer(dicRoot, &pos) == prefix[prefixIndex]) {
+                groupIndex = i;
+                break;
+            }
+        }
+        if (NOT_AN_INDEX == groupIndex) {
+            return NOT_AN_INDEX;
+        }
+        ++prefixIndex;
+        int matchedLength = 1;
+        if (BinaryFormat::FLAG_HAS_MULTIPLE_CHARS & flags) {
+            while (prefixIndex < prefixLength) {
+                const int codePoint = BinaryFormat::getCodePointAndForwardPointer(dicRoot, &pos);
+                if (NOT_A_CODE_POINT == codePoint) {
+                    break;
+                }
+                if (codePoint != prefix[prefixIndex]) {
+                    return NOT_AN_INDEX;
+                }
+                ++prefixIndex;
+                ++matchedLength;
+            }
+        }
+        if (prefixIndex == prefixLength) {
+            *outMatchedLength = matchedLength;
+            return groupIndex;
+        }
+        firstIndex = mGroups[groupIndex].mFirstChildIndex;
+        groupCount = mGroups[groupIndex].mChildrenCount;
+        if (NOT_AN_INDEX == firstIndex) {
+            return NOT_AN_INDEX;
+        }
+    }
+}
+
+bool CompletionIndex::build(const uint8_t *const dicRoot, const int dicSize) {
+    if (dicSize <= 0) {
+        return false;
+    }
+    // Children arrays to read, as triples of (position, group count, index of the parent)
+    std::vector<int> pendingArrays;
+    int rootPos = 0;
+    const int rootCount = BinaryFormat::getGroupCountAndForwardPointer(dicRoot, &rootPos);
+    pendingArrays.push_back(rootPos);
+    pendingArrays.push_back(rootCount);
+    pendingArrays.push_back(NOT_AN_INDEX);
+    int subword[MAX_WORD_LENGTH];
+    while (!pendingArrays.empty()) {
+        const int parent = pendingArrays.back();
+        pendingArrays.pop_back();
+        const int count = pendingArrays.back();
+        pendingArrays.pop_back();
+        int pos = pendingArrays.back();
+        pendingArrays.pop_back();
+        if (count <= 0 || pos <= 0 || pos >= dicSize
+                || static_cast<int>(mGroups.size()) + count > MAX_GROUP_COUNT) {
+            return false;
+        }
+        const int firstIndex = static_cast<int>(mGroups.size());
+        if (NOT_AN_INDEX == parent) {
+            mRootCount = count;
+        } else {
+            mGroups[parent].mFirstChildIndex = firstIndex;
+            mGroups[parent].mChildrenCount = static_cast<int16_t>(count);
+        }
+        for (int i = 0; i < count; ++i) {
+            if (pos >= dicSize) {
+                return false;
+            }
+            DicNodeChildrenCache::DecodedChild child;
+            pos = DicNodeUtils::readChildGroup(dicRoot, pos, &child, subword);
+            const bool isWord = (BinaryFormat::FLAG_IS_TERMINAL & child.mFlags)
+                    && !BinaryFormat::hasBlacklistedOrNotAWordFlag(child.mFlags);
+            Group group;
+            group.mPos = child.mPos;
+            group.mFirstChildIndex = NOT_AN_INDEX;
+            group.mChildrenCount = 0;
+            group.mProbability = static_cast<int16_t>(isWord ? child.mProbability
+                    : NOT_A_PROBABILITY);
+            group.mMaxProbability = group.mProbability;
+            mGroups.push_back(group);
+            if (child.mChildrenCount > 0) {
+                pendingArrays.push_back(child.mChildrenPos);
+                pendingArrays.push_back(child.mChildrenCount);
+                pendingArrays.push_back(firstIndex + i);
+            }
+        }
+    }
+    // The children of a group are read after it, so the bounds are summed up from the end.
+    for (int i = static_cast<int>(mGroups.size()) - 1; i >= 0; --i) {
+        Group *const group = &mGroups[i];
+        if (NOT_AN_INDEX == group->mFirstChildIndex) {
+            continue;
+        }
+        for (int j = group->mFirstChildIndex;
+                j < group->mFirstChildIndex + group->mChildrenCount; ++j) {
+            group->mMaxProbability = max(group->mMaxProbability, mGroups[j].mMaxProbability);
+        }
+    }
+    // Release the capacity left by the growth of the vector.
+    std::vector<Group>(mGroups).swap(mGroups);
+    return true;
+}
+} // namespace latinime
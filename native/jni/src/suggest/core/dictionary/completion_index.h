@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_COMPLETION_INDEX_H
+#define LATINIME_COMPLETION_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "memory_utils.h"
+
+namespace latinime {
+
+/**
+ * The highest probability of the words under each char group of a dictionary, so that the most
+ * probable words that start with a prefix are found by a best-first descent from the group of the
+ * prefix, which only visits the groups whose bound may beat the words found so far, instead of a
+ * correction search past the end of the input. The groups of a children array are stored next to
+ * each other, in the order of the dictionary. Immutable once created, hence shared by all
+ * sessions.
+ */
+class CompletionIndex {
+ public:
+    // Returns 0 if the dictionary is too large to index or seems broken.
+    static CompletionIndex *create(const uint8_t *const dicRoot, const int dicSize);
+
+    // The bytes allocated for the index, including the retained capacity.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mGroups);
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    ~CompletionIndex() {}
+
+    // Writes the at most maxCount most probable words that start with the prefix, including the
+    // prefix itself, by decreasing probability, and returns their count. Each word is written at
+    // i * MAX_WORD_LENGTH of outCodePoints, terminated by 0 if shorter. The words that are
+    // blacklisted or not words are not completions.
+    int getCompletions(const uint8_t *const dicRoot, const int *const prefix,
+            const int prefixLength, const int maxCount, int *const outCodePoints,
+            int *const outProbabilities) const;
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(CompletionIndex);
+    static const int MAX_GROUP_COUNT;
+
+    struct Group {
+        int mPos;
+        // The index of the first of the children groups, or NOT_AN_INDEX
+        int mFirstChildIndex;
+        int16_t mChildrenCount;
+        // The probability of the word that ends at the group, or NOT_A_PROBABILITY
+        int16_t mProbability;
+        // The highest probability of the words that end at the group or below, or
+        // NOT_A_PROBABILITY
+        int16_t mMaxProbability;
+    };
+
+    // A group or a word to visit in the descent. The words of the groups go on the queue with the
+    // probability of the group, so that they are output when no group can lead to a better one.
+    struct QueueEntry {
+        int mProbability;
+        int mGroupIndex;
+        // The index in the path of the descent of the entry for the group
+        int mPathIndex;
+        bool mIsWord;
+    };
+
+    struct QueueEntryComparator {
+        // The entries are output by decreasing probability, the words before the groups of the
+        // same probability, and by the order of their groups in the dictionary.
+        bool operator()(const QueueEntry &left, const QueueEntry &right) const {
+            if (left.mProbability != right.mProbability) {
+                return left.mProbability < right.mProbability;
+            }
+            if (left.mIsWord != right.mIsWord) {
+                return right.mIsWord;
+            }
+            return left.mGroupIndex > right.mGroupIndex;
+        }
+    };
+
+    CompletionIndex() : mGroups(), mRootCount(0) {}
+
+    bool build(const uint8_t *const dicRoot, const int dicSize);
+
+    // Returns the index of the group where the prefix ends and sets outMatchedLength to the number
+    // of code points of the group that the prefix matches, or returns NOT_AN_INDEX.
+    int findPrefixGroup(const uint8_t *const dicRoot, const int *const prefix,
+            const int prefixLength, int *const outMatchedLength) const;
+
+    std::vector<Group> mGroups;
+    // The groups of the root array are the first ones.
+    int mRootCount;
+};
+} // namespace latinime
+#endif // LATINIME_COMPLETION_INDEX_H
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "suggest/core/dictionary/decoded_node_index.h"
+
+#include "binary_format.h"
+#include "suggest/core/dicnode/dic_node_utils.h"
+
+namespace latinime {
+
+// About 35 bytes per group with the code points and the table: the index stays under 20MB.
+const int DecodedNodeIndex::MAX_GROUP_COUNT = 1 << 19;
+// The root and the children of its groups
+const int DecodedNodeIndex::ROOT_FAN_OUT_DEPTH = 2;
+
+/* static */ DecodedNodeIndex *DecodedNodeIndex::create(const uint8_t *const dicRoot,
+        const int dicSize) {
+    DecodedNodeIndex *index = new DecodedNodeIndex();
+    if (index->build(dicRoot, dicSize, MAX_WORD_LENGTH)) {
+        return index;
+    }
+    delete index;
+    // The dictionary may only be too large: keep the levels that every new word starts from.
+    index = new DecodedNodeIndex();
+    if (index->build(dicRoot, dicSize, ROOT_FAN_OUT_DEPTH)) {
+        AKLOGI("Decoded the first %d levels of the dictionary of size %d", ROOT_FAN_OUT_DEPTH,
+                dicSize);
+        return index;
+    }
+    AKLOGI("No decoded node index for the dictionary of size %d", dicSize);
+    delete index;
+    return 0;
+}
+
+bool DecodedNodeIndex::build(const uint8_t *const dicRoot, const int dicSize,
+        const int maxDepth) {
+    if (dicSize <= 0) {
+        return false;
+    }
+    // Children arrays to decode, as triples of (position, group count, depth)
+    std::vector<int> pendingArrays;
+    // Decoded children arrays, as pairs of (position, index of the first child)
+    std::vector<int> arrays;
+    int rootPos = 0;
+    const int rootCount = BinaryFormat::getGroupCountAndForwardPointer(dicRoot, &rootPos);
+    pendingArrays.push_back(rootPos);
+    pendingArrays.push_back(rootCount);
+    pendingArrays.push_back(0);
+    int subword[MAX_WORD_LENGTH];
+    while (!pendingArrays.empty()) {
+        const int depth = pendingArrays.back();
+        pendingArrays.pop_back();
+        const int count = pendingArrays.back();
+        pendingArrays.pop_back();
+        int pos = pendingArrays.back();
+        pendingArrays.pop_back();
+        if (count <= 0 || pos <= 0 || pos >= dicSize
+                || static_cast<int>(mGroups.size()) + count > MAX_GROUP_COUNT) {
+            return false;
+        }
+        arrays.push_back(pos);
+        arrays.push_back(static_cast<int>(mGroups.size()));
+        for (int i = 0; i < count; ++i) {
+            if (pos >= dicSize) {
+                return false;
+            }
+            DicNodeChildrenCache::DecodedChild child;
+            pos = DicNodeUtils::readChildGroup(dicRoot, pos, &child, subword);
+            if (!addGroup(&child, subword)) {
+                return false;
+            }
+            if (child.mChildrenCount > 0 && depth + 1 < maxDepth) {
+                pendingArrays.push_back(child.mChildrenPos);
+                pendingArrays.push_back(child.mChildrenCount);
+                pendingArrays.push_back(depth + 1);
+            }
+        }
+    }
+
+    // Release the capacity left by the growth of the vectors.
+    std::vector<Group>(mGroups).swap(mGroups);
+    std::vector<int>(mCodePointColumn).swap(mCodePointColumn);
+    std::vector<int>(mCodePoints).swap(mCodePoints);
+
+    // At most two thirds full, so that lookups of missing positions stop quickly. A partial index
+    // is looked up for missing positions, so the table always keeps an empty slot.
+    const int arrayCount = static_cast<int>(arrays.size()) / 2;
+    int tableSize = 1;
+    while (tableSize <= arrayCount * 3 / 2) {
+        tableSize <<= 1;
+    }
+    mTableMask = tableSize - 1;
+    mTable.assign(tableSize * 2, NOT_AN_INDEX);
+    for (int i = 0; i < arrayCount; ++i) {
+        int slot = getSlot(arrays[i * 2]);
+        while (mTable[slot * 2] != NOT_AN_INDEX) {
+            if (mTable[slot * 2] == arrays[i * 2]) {
+                // Two groups share a children array: not a tree.
+                return false;
+            }
+            slot = (slot + 1) & mTableMask;
+        }
+        mTable[slot * 2] = arrays[i * 2];
+        mTable[slot * 2 + 1] = arrays[i * 2 + 1];
+    }
+    return true;
+}
+// Returns false if a field of the group does not fit in the fixed-size record.
+bool DecodedNodeIndex::addGroup(const DicNodeChildrenCache::DecodedChild *const child,
+        const int *const subword) {
+    const int attributesOffset = child->mAttributesPos - child->mPos;
+    const int siblingOffset = child->mSiblingPos - child->mPos;
+    if (static_cast<uint16_t>(attributesOffset) != attributesOffset
+            || static_cast<uint16_t>(siblingOffset) != siblingOffset
+            || static_cast<int16_t>(child->mChildrenCount) != child->mChildrenCount
+            || static_cast<uint8_t>(child->mSubwordLength) != child->mSubwordLength) {
+        return false;
+    }
+    Group group;
+    group.mPos = child->mPos;
+    group.mChildrenPos = child->mChildrenPos;
+    // Most groups have a single code point, which is read from the column.
+    group.mSubwordStart = NOT_AN_INDEX;
+    if (child->mSubwordLength > 1) {
+        group.mSubwordStart = static_cast<int>(mCodePoints.size());
+        mCodePoints.insert(mCodePoints.end(), subword, subword + child->mSubwordLength);
+    }
+    group.mAttributesOffset = static_cast<uint16_t>(attributesOffset);
+    group.mSiblingOffset = static_cast<uint16_t>(siblingOffset);
+    group.mChildrenCount = static_cast<int16_t>(child->mChildrenCount);
+    group.mProbability = static_cast<int16_t>(child->mProbability);
+    group.mSubwordLength = static_cast<uint8_t>(child->mSubwordLength);
+    group.mFlags = child->mFlags;
+    mGroups.push_back(group);
+    mCodePointColumn.push_back(child->mCodePoint);
+    return true;
+}
+} // namespace latinime
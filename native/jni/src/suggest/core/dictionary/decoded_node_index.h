@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LATINIME_DECODED_NODE_INDEX_H
+#define LATINIME_DECODED_NODE_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "memory_utils.h"
+#include "suggest/core/dicnode/dic_node_children_cache.h"
+
+namespace latinime {
+
+/**
+ * All the char groups of a dictionary decoded once when it is opened, so that expanding a dicNode
+ * reads fixed-size records instead of parsing the variable-length fields of the binary format.
+ * The groups of a children array are stored next to each other and found by the position of the
+ * array with an open-addressing table. The first code points of the groups are kept in a column
+ * of their own, so that children are matched against the input with plain loads of a few cache
+ * lines and only the accepted ones are decoded. Immutable once created, hence shared by all
+ * sessions.
+ *
+ * When the whole dictionary does not fit, only the children arrays of the first
+ * ROOT_FAN_OUT_DEPTH levels are indexed. Every new word of a multiple word search restarts from
+ * the root, which has the widest children array of the trie and may have more children than the
+ * children cache of a session keeps. The deeper arrays are not found and read as without index.
+ */
+class DecodedNodeIndex {
+ public:
+    // A decoded char group. Other positions are stored relative to the position of the group.
+    struct Group {
+        int mPos;
+        int mChildrenPos;
+        // The index of the code points in mCodePoints if the group has more than one
+        int mSubwordStart;
+        uint16_t mAttributesOffset;
+        uint16_t mSiblingOffset;
+        int16_t mChildrenCount;
+        int16_t mProbability;
+        uint8_t mSubwordLength;
+        uint8_t mFlags;
+    };
+
+    // Returns 0 if the dictionary is too large to index or seems broken.
+    static DecodedNodeIndex *create(const uint8_t *const dicRoot, const int dicSize);
+
+    // The bytes allocated for the index, including the retained capacity.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mGroups)
+                + MemoryUtils::getVectorMemorySize(&mCodePointColumn)
+                + MemoryUtils::getVectorMemorySize(&mCodePoints)
+                + MemoryUtils::getVectorMemorySize(&mTable);
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    ~DecodedNodeIndex() {}
+
+    // Returns the index of the first of the children groups starting at childrenPos, or
+    // NOT_AN_INDEX if they are not indexed.
+    AK_FORCE_INLINE int getFirstChildIndex(const int childrenPos) const {
+        for (int slot = getSlot(childrenPos); ; slot = (slot + 1) & mTableMask) {
+            const int pos = mTable[slot * 2];
+            if (pos == childrenPos) {
+                return mTable[slot * 2 + 1];
+            }
+            if (pos == NOT_AN_INDEX) {
+                return NOT_AN_INDEX;
+            }
+        }
+    }
+
+    AK_FORCE_INLINE int getCodePointAt(const int index) const {
+        return mCodePointColumn[index];
+    }
+
+    // Fills child and subword with the group at index, as DicNodeUtils::readChildGroup would.
+    // Returns the code points of the group.
+    AK_FORCE_INLINE const int *decodeGroupAt(const int index,
+            DicNodeChildrenCache::DecodedChild *const child) const {
+        const Group *const group = &mGroups[index];
+        child->mPos = group->mPos;
+        child->mChildrenPos = group->mChildrenPos;
+        child->mAttributesPos = group->mPos + group->mAttributesOffset;
+        child->mSiblingPos = group->mPos + group->mSiblingOffset;
+        child->mCodePoint = mCodePointColumn[index];
+        child->mChildrenCount = group->mChildrenCount;
+        child->mProbability = group->mProbability;
+        child->mSubwordLength = group->mSubwordLength;
+        child->mFlags = group->mFlags;
+        return group->mSubwordLength > 1 ? &mCodePoints[group->mSubwordStart]
+                : &mCodePointColumn[index];
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(DecodedNodeIndex);
+    static const int MAX_GROUP_COUNT;
+    static const int ROOT_FAN_OUT_DEPTH;
+
+    DecodedNodeIndex()
+            : mGroups(), mCodePointColumn(), mCodePoints(), mTable(), mTableMask(0) {}
+
+    // Decodes the children arrays of the first maxDepth levels.
+    bool build(const uint8_t *const dicRoot, const int dicSize, const int maxDepth);
+    bool addGroup(const DicNodeChildrenCache::DecodedChild *const child,
+            const int *const subword);
+
+    AK_FORCE_INLINE int getSlot(const int childrenPos) const {
+        // Fibonacci hashing, as children positions are close to each other.
+        return static_cast<int>((static_cast<uint32_t>(childrenPos) * 2654435769U) >> 8)
+                & mTableMask;
+    }
+
+    std::vector<Group> mGroups;
+    // The first code point of each group
+    std::vector<int> mCodePointColumn;
+    // The code points of the groups that have more than one
+    std::vector<int> mCodePoints;
+    // Pairs of (children position, index of the first child in mGroups)
+    std::vector<int> mTable;
+    int mTableMask;
+};
+} // namespace latinime
+#endif // LATINIME_DECODED_NODE_INDEX_H
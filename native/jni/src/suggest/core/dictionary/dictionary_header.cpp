@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "LatinIME: dictionary_header.cpp"
+
+#include "suggest/core/dictionary/dictionary_header.h"
+
+#include <cctype>
+#include <cstdlib>
+
+#include "binary_format.h"
+
+namespace latinime {
+
+const char *const DictionaryHeader::MULTIPLE_WORDS_DEMOTION_RATE_KEY =
+        "MULTIPLE_WORDS_DEMOTION_RATE";
+
+DictionaryHeader::DictionaryHeader(const uint8_t *const dict, const int dictSize)
+        : mFormatVersion(BinaryFormat::detectFormat(dict, dictSize)),
+          mFlags(BinaryFormat::getFlags(dict, dictSize)),
+          mSize(BinaryFormat::getHeaderSize(dict, dictSize)), mAttributes(),
+          mMultiWordCostMultiplier(1.0f) {
+    readAttributes(dict);
+    mMultiWordCostMultiplier = readMultiWordCostMultiplier();
+}
+
+void DictionaryHeader::readValue(const char *const key, int *outValue,
+        const int outValueSize) const {
+    int outValueIndex = 0;
+    const Attribute *const attribute = getAttribute(key);
+    if (attribute) {
+        const int valueSize = static_cast<int>(attribute->mValue.size());
+        while (outValueIndex < valueSize && outValueIndex < outValueSize) {
+            outValue[outValueIndex] = attribute->mValue[outValueIndex];
+            ++outValueIndex;
+        }
+    }
+    // Put a terminator 0 if possible at all (always unless outValueSize is <= 0)
+    if (outValueIndex >= outValueSize) outValueIndex = outValueSize - 1;
+    if (outValueIndex >= 0) outValue[outValueIndex] = 0;
+}
+
+int DictionaryHeader::readValueInt(const char *const key) const {
+    const int bufferSize = LARGEST_INT_DIGIT_COUNT;
+    int intBuffer[bufferSize];
+    char charBuffer[bufferSize];
+    readValue(key, intBuffer, bufferSize);
+    for (int i = 0; i < bufferSize; ++i) {
+        charBuffer[i] = intBuffer[i];
+    }
+    // If not a number, return S_INT_MIN
+    if (!isdigit(charBuffer[0])) return S_INT_MIN;
+    return atoi(charBuffer);
+}
+
+// Only format 2 and above have header attributes as {key,value} string pairs, each string
+// terminated by NOT_A_CODE_POINT.
+void DictionaryHeader::readAttributes(const uint8_t *const dict) {
+    if (mFormatVersion < 2) {
+        return;
+    }
+    // Magic number (4 bytes), version (2 bytes), flags (2 bytes) and header size (4 bytes)
+    int index = 4 + 2 + 2 + 4;
+    while (index < mSize) {
+        mAttributes.push_back(Attribute());
+        Attribute *const attribute = &mAttributes.back();
+        int codePoint = BinaryFormat::getCodePointAndForwardPointer(dict, &index);
+        while (codePoint != NOT_A_CODE_POINT) {
+            attribute->mKey.push_back(codePoint);
+            codePoint = BinaryFormat::getCodePointAndForwardPointer(dict, &index);
+        }
+        codePoint = BinaryFormat::getCodePointAndForwardPointer(dict, &index);
+        while (codePoint != NOT_A_CODE_POINT) {
+            attribute->mValue.push_back(codePoint);
+            codePoint = BinaryFormat::getCodePointAndForwardPointer(dict, &index);
+        }
+    }
+}
+
+const DictionaryHeader::Attribute *DictionaryHeader::getAttribute(const char *const key) const {
+    for (int i = 0; i < static_cast<int>(mAttributes.size()); ++i) {
+        const std::vector<int> &attributeKey = mAttributes[i].mKey;
+        const int keySize = static_cast<int>(attributeKey.size());
+        int keyIndex = 0;
+        while (keyIndex < keySize && key[keyIndex] != 0
+                && attributeKey[keyIndex] == key[keyIndex]) {
+            ++keyIndex;
+        }
+        if (keyIndex == keySize && key[keyIndex] == 0) {
+            return &mAttributes[i];
+        }
+    }
+    return 0;
+}
+
+float DictionaryHeader::readMultiWordCostMultiplier() const {
+    const int headerValue = readValueInt(MULTIPLE_WORDS_DEMOTION_RATE_KEY);
+    if (headerValue == S_INT_MIN) {
+        return 1.0f;
+    }
+    if (headerValue <= 0) {
+        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+    return 100.0f / static_cast<float>(headerValue);
+}
+} // namespace latinime
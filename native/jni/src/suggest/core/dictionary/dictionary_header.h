@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LATINIME_DICTIONARY_HEADER_H
+#define LATINIME_DICTIONARY_HEADER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * The header of a dictionary, parsed once when the dictionary is opened so that the options and
+ * attributes are not looked up again by scanning the {key,value} string pairs of the header on
+ * every query. Immutable once created, hence shared by all sessions.
+ */
+class DictionaryHeader {
+ public:
+    DictionaryHeader(const uint8_t *const dict, const int dictSize);
+
+    // Non virtual inline destructor -- never inherit this class
+    ~DictionaryHeader() {}
+
+    int getFormatVersion() const { return mFormatVersion; }
+    int getFlags() const { return mFlags; }
+    // The size of the header, which is the offset of the root of the trie.
+    int getSize() const { return mSize; }
+    float getMultiWordCostMultiplier() const { return mMultiWordCostMultiplier; }
+
+    // Copies the value of the attribute like BinaryFormat::readHeaderValue does: an attribute
+    // that is not in the header has an empty value.
+    void readValue(const char *const key, int *outValue, const int outValueSize) const;
+    // Returns the value of the attribute as an int, or S_INT_MIN if it is not a number.
+    int readValueInt(const char *const key) const;
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(DictionaryHeader);
+    static const char *const MULTIPLE_WORDS_DEMOTION_RATE_KEY;
+
+    struct Attribute {
+        Attribute() : mKey(), mValue() {}
+
+        std::vector<int> mKey;
+        std::vector<int> mValue;
+    };
+
+    void readAttributes(const uint8_t *const dict);
+    const Attribute *getAttribute(const char *const key) const;
+    float readMultiWordCostMultiplier() const;
+
+    const int mFormatVersion;
+    const int mFlags;
+    const int mSize;
+    std::vector<Attribute> mAttributes;
+    float mMultiWordCostMultiplier;
+};
+} // namespace latinime
+#endif // LATINIME_DICTIONARY_HEADER_H
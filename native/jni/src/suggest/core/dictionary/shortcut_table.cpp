@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: shortcut_table.cpp"
+
+#include "suggest/core/dictionary/shortcut_table.h"
+
+#include <utility>
+
+#include "binary_format.h"
+#include "suggest/core/dicnode/dic_node_utils.h"
+#include "terminal_attributes.h"
+
+namespace latinime {
+
+/* static */ ShortcutTable *ShortcutTable::create(const uint8_t *const dicRoot,
+        const int dicSize) {
+    ShortcutTable *const table = new ShortcutTable();
+    if (!table->build(dicRoot, dicSize)) {
+        AKLOGI("No shortcut table for the dictionary of size %d", dicSize);
+        delete table;
+        return 0;
+    }
+    return table;
+}
+
+bool ShortcutTable::build(const uint8_t *const dicRoot, const int dicSize) {
+    if (dicSize <= 0) {
+        return false;
+    }
+    // Children arrays to read, as pairs of (position, group count)
+    std::vector<int> pendingArrays;
+    int rootPos = 0;
+    const int rootCount = BinaryFormat::getGroupCountAndForwardPointer(dicRoot, &rootPos);
+    pendingArrays.push_back(rootPos);
+    pendingArrays.push_back(rootCount);
+    // Every group takes at least 2 bytes: more groups than this means a loop.
+    int remainingGroupCount = dicSize / 2;
+    // Pairs of (attributes position, index in the order of the reading) of the shortcut lists,
+    // and the index of the first target of each list in the order of the reading
+    std::vector<std::pair<int, int> > lists;
+    std::vector<int> firstTargets;
+    std::vector<Target> targets;
+    int subword[MAX_WORD_LENGTH];
+    while (!pendingArrays.empty()) {
+        const int count = pendingArrays.back();
+        pendingArrays.pop_back();
+        int pos = pendingArrays.back();
+        pendingArrays.pop_back();
+        remainingGroupCount -= count;
+        if (count <= 0 || pos <= 0 || pos >= dicSize || remainingGroupCount < 0) {
+            return false;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (pos >= dicSize) {
+                return false;
+            }
+            DicNodeChildrenCache::DecodedChild child;
+            pos = DicNodeUtils::readChildGroup(dicRoot, pos, &child, subword);
+            if ((child.mFlags & BinaryFormat::FLAG_IS_TERMINAL)
+                    && (child.mFlags & BinaryFormat::FLAG_HAS_SHORTCUT_TARGETS)) {
+                lists.push_back(std::make_pair(child.mAttributesPos,
+                        static_cast<int>(firstTargets.size())));
+                firstTargets.push_back(static_cast<int>(targets.size()));
+                // Decoded as the shortcut lists are read when there is no table.
+                const TerminalAttributes terminalAttributes(dicRoot, child.mFlags,
+                        child.mAttributesPos, 0 /* shortcutTable */);
+                TerminalAttributes::ShortcutIterator iterator =
+                        terminalAttributes.getShortcutIterator();
+                while (iterator.hasNextShortcutTarget()) {
+                    int codePoints[MAX_WORD_LENGTH];
+                    Target target;
+                    target.mCodePointStart = static_cast<int>(mCodePoints.size());
+                    target.mLength = iterator.getNextShortcutTarget(MAX_WORD_LENGTH, codePoints,
+                            &target.mProbability);
+                    mCodePoints.insert(mCodePoints.end(), codePoints,
+                            codePoints + target.mLength);
+                    targets.push_back(target);
+                }
+            }
+            if (child.mChildrenCount > 0) {
+                pendingArrays.push_back(child.mChildrenPos);
+                pendingArrays.push_back(child.mChildrenCount);
+            }
+        }
+    }
+    if (lists.empty()) {
+        return false;
+    }
+    firstTargets.push_back(static_cast<int>(targets.size()));
+
+    std::sort(lists.begin(), lists.end());
+    const int listCount = static_cast<int>(lists.size());
+    mAttributesPositions.reserve(listCount);
+    mFirstTargets.reserve(listCount + 1);
+    mTargets.reserve(targets.size());
+    for (int i = 0; i < listCount; ++i) {
+        if (i > 0 && lists[i].first == lists[i - 1].first) {
+            // Two terminals share their attributes: not a tree.
+            return false;
+        }
+        mAttributesPositions.push_back(lists[i].first);
+        mFirstTargets.push_back(static_cast<int>(mTargets.size()));
+        const int list = lists[i].second;
+        mTargets.insert(mTargets.end(), targets.begin() + firstTargets[list],
+                targets.begin() + firstTargets[list + 1]);
+    }
+    mFirstTargets.push_back(static_cast<int>(mTargets.size()));
+    std::vector<int>(mCodePoints).swap(mCodePoints);
+    return true;
+}
+} // namespace latinime
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_SHORTCUT_TABLE_H
+#define LATINIME_SHORTCUT_TABLE_H
+
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "memory_utils.h"
+
+namespace latinime {
+
+/**
+ * The shortcut targets of all the terminals of a dictionary decoded once when it is opened, so
+ * that outputting them copies their code points instead of reading them from the variable-length
+ * encoding of the attribute lists. The shortcut lists are found by the position of the attributes
+ * of their terminal with a binary search over the few terminals that have some. Immutable once
+ * created, hence shared by all sessions.
+ */
+class ShortcutTable {
+ public:
+    // Returns 0 if the dictionary has no shortcuts or seems broken.
+    static ShortcutTable *create(const uint8_t *const dicRoot, const int dicSize);
+
+    // The bytes allocated for the table, including the retained capacity.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mAttributesPositions)
+                + MemoryUtils::getVectorMemorySize(&mFirstTargets)
+                + MemoryUtils::getVectorMemorySize(&mTargets)
+                + MemoryUtils::getVectorMemorySize(&mCodePoints);
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    ~ShortcutTable() {}
+
+    // Returns the index of the first target of the terminal whose attributes start at
+    // attributesPos, or NOT_AN_INDEX. The targets of a terminal follow each other up to the index
+    // set in outTargetEnd, excluded.
+    AK_FORCE_INLINE int findFirstTarget(const int attributesPos, int *const outTargetEnd) const {
+        const std::vector<int>::const_iterator it = std::lower_bound(mAttributesPositions.begin(),
+                mAttributesPositions.end(), attributesPos);
+        if (it == mAttributesPositions.end() || *it != attributesPos) {
+            return NOT_AN_INDEX;
+        }
+        const int list = static_cast<int>(it - mAttributesPositions.begin());
+        *outTargetEnd = mFirstTargets[list + 1];
+        return mFirstTargets[list];
+    }
+
+    AK_FORCE_INLINE const int *getTargetCodePoints(const int target) const {
+        return &mCodePoints[mTargets[target].mCodePointStart];
+    }
+
+    AK_FORCE_INLINE int getTargetLength(const int target) const {
+        return mTargets[target].mLength;
+    }
+
+    AK_FORCE_INLINE int getTargetProbability(const int target) const {
+        return mTargets[target].mProbability;
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(ShortcutTable);
+
+    struct Target {
+        int mCodePointStart;
+        int mLength;
+        int mProbability;
+    };
+
+    ShortcutTable() : mAttributesPositions(), mFirstTargets(), mTargets(), mCodePoints() {}
+
+    bool build(const uint8_t *const dicRoot, const int dicSize);
+
+    // The positions of the attributes of the terminals that have shortcuts, sorted
+    std::vector<int> mAttributesPositions;
+    // The index of the first target of each terminal, and the number of targets at the end
+    std::vector<int> mFirstTargets;
+    std::vector<Target> mTargets;
+    std::vector<int> mCodePoints;
+};
+} // namespace latinime
+#endif // LATINIME_SHORTCUT_TABLE_H
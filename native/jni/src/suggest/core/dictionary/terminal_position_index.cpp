@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: terminal_position_index.cpp"
+
+#include "suggest/core/dictionary/terminal_position_index.h"
+
+#include "suggest/core/dicnode/dic_node_utils.h"
+
+namespace latinime {
+
+// 8 bytes per word and 4 per bucket of displacements: the index stays under 10MB.
+const int TerminalPositionIndex::MAX_TERMINAL_COUNT;
+const int TerminalPositionIndex::DISPLACEMENT_D1_BITS;
+const int TerminalPositionIndex::MAX_BUILD_ATTEMPTS = 4;
+const int TerminalPositionIndex::AVERAGE_BUCKET_SIZE = 3;
+// d0 is only needed when two words of a bucket start at the same slot.
+const uint32_t TerminalPositionIndex::MAX_D0 = 8;
+const uint64_t TerminalPositionIndex::INITIAL_HASH = 14695981039346656037ULL;
+
+/* static */ TerminalPositionIndex *TerminalPositionIndex::create(const uint8_t *const dicRoot,
+        const int dicSize) {
+    std::vector<uint64_t> wordHashes;
+    std::vector<int> terminalPositions;
+    if (collectTerminals(dicRoot, dicSize, &wordHashes, &terminalPositions)) {
+        TerminalPositionIndex *const index = new TerminalPositionIndex();
+        for (int attempt = 0; attempt < MAX_BUILD_ATTEMPTS; ++attempt) {
+            if (index->placeTerminals(&wordHashes, &terminalPositions,
+                    static_cast<uint32_t>(attempt))) {
+                return index;
+            }
+        }
+        delete index;
+    }
+    AKLOGI("No terminal position index for the dictionary of size %d", dicSize);
+    return 0;
+}
+
+/* static */ bool TerminalPositionIndex::collectTerminals(const uint8_t *const dicRoot,
+        const int dicSize, std::vector<uint64_t> *const wordHashes,
+        std::vector<int> *const terminalPositions) {
+    if (dicSize <= 0) {
+        return false;
+    }
+    // Children arrays to read, as pairs of (position, group count), with the hash of the code
+    // points leading to them.
+    std::vector<int> pendingArrays;
+    std::vector<uint64_t> pendingPrefixHashes;
+    int rootPos = 0;
+    const int rootCount = BinaryFormat::getGroupCountAndForwardPointer(dicRoot, &rootPos);
+    pendingArrays.push_back(rootPos);
+    pendingArrays.push_back(rootCount);
+    pendingPrefixHashes.push_back(INITIAL_HASH);
+    // Every group takes at least 2 bytes: more groups than this means a loop.
+    int remainingGroupCount = dicSize / 2;
+    int subword[MAX_WORD_LENGTH];
+    while (!pendingArrays.empty()) {
+        const int count = pendingArrays.back();
+        pendingArrays.pop_back();
+        int pos = pendingArrays.back();
+        pendingArrays.pop_back();
+        const uint64_t prefixHash = pendingPrefixHashes.back();
+        pendingPrefixHashes.pop_back();
+        remainingGroupCount -= count;
+        if (count <= 0 || pos <= 0 || pos >= dicSize || remainingGroupCount < 0) {
+            return false;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (pos >= dicSize) {
+                return false;
+            }
+            DicNodeChildrenCache::DecodedChild child;
+            pos = DicNodeUtils::readChildGroup(dicRoot, pos, &child, subword);
+            uint64_t hash = prefixHash;
+            for (int j = 0; j < child.mSubwordLength; ++j) {
+                hash = addToHash(hash, subword[j]);
+            }
+            if (child.mFlags & BinaryFormat::FLAG_IS_TERMINAL) {
+                if (static_cast<int>(terminalPositions->size()) >= MAX_TERMINAL_COUNT) {
+                    return false;
+                }
+                wordHashes->push_back(hash);
+                terminalPositions->push_back(child.mPos);
+            }
+            if (child.mChildrenCount > 0) {
+                pendingArrays.push_back(child.mChildrenPos);
+                pendingArrays.push_back(child.mChildrenCount);
+                pendingPrefixHashes.push_back(hash);
+            }
+        }
+    }
+    return !terminalPositions->empty();
+}
+
+// Places the words of the largest buckets first, while the table is still mostly free. Returns
+// false if the words of a bucket cannot be separated.
+bool TerminalPositionIndex::placeTerminals(const std::vector<uint64_t> *const wordHashes,
+        const std::vector<int> *const terminalPositions, const uint32_t seed) {
+    const int wordCount = static_cast<int>(wordHashes->size());
+    const int bucketCount = (wordCount + AVERAGE_BUCKET_SIZE - 1) / AVERAGE_BUCKET_SIZE;
+    mSeed = seed;
+    mSlots.assign(wordCount, Slot());
+    mDisplacements.assign(bucketCount, 0);
+
+    // Sort the words by bucket.
+    std::vector<uint64_t> hashes(wordCount);
+    std::vector<int> bucketStarts(bucketCount + 1, 0);
+    for (int i = 0; i < wordCount; ++i) {
+        hashes[i] = finalizeHash((*wordHashes)[i], seed);
+        ++bucketStarts[getBucket(hashes[i]) + 1];
+    }
+    int maxBucketSize = 0;
+    for (int i = 0; i < bucketCount; ++i) {
+        maxBucketSize = max(maxBucketSize, bucketStarts[i + 1]);
+        bucketStarts[i + 1] += bucketStarts[i];
+    }
+    std::vector<int> wordsByBucket(wordCount);
+    std::vector<int> nextInBucket(bucketStarts.begin(), bucketStarts.end() - 1);
+    for (int i = 0; i < wordCount; ++i) {
+        wordsByBucket[nextInBucket[getBucket(hashes[i])]++] = i;
+    }
+    // Then the buckets by decreasing size.
+    std::vector<int> sizeStarts(maxBucketSize + 2, 0);
+    for (int i = 0; i < bucketCount; ++i) {
+        ++sizeStarts[maxBucketSize - (bucketStarts[i + 1] - bucketStarts[i]) + 1];
+    }
+    for (int i = 0; i <= maxBucketSize; ++i) {
+        sizeStarts[i + 1] += sizeStarts[i];
+    }
+    std::vector<int> bucketsBySize(bucketCount);
+    for (int i = 0; i < bucketCount; ++i) {
+        bucketsBySize[sizeStarts[maxBucketSize - (bucketStarts[i + 1] - bucketStarts[i])]++] = i;
+    }
+
+    std::vector<bool> isSlotTaken(wordCount, false);
+    std::vector<int> bucketSlots(maxBucketSize);
+    // Single word buckets go to any free slot, found by a cursor as slots are only taken.
+    int freeSlotCursor = 0;
+    for (int i = 0; i < bucketCount; ++i) {
+        const int bucket = bucketsBySize[i];
+        const int begin = bucketStarts[bucket];
+        const int size = bucketStarts[bucket + 1] - begin;
+        if (size == 0) {
+            break;
+        }
+        bool isPlaced = false;
+        uint32_t displacement = 0;
+        if (size == 1) {
+            while (isSlotTaken[freeSlotCursor]) {
+                ++freeSlotCursor;
+            }
+            const int slot = getSlot(hashes[wordsByBucket[begin]], 0);
+            displacement = static_cast<uint32_t>((freeSlotCursor - slot + wordCount) % wordCount);
+            isPlaced = true;
+        }
+        for (uint32_t d0 = 0; !isPlaced && d0 < MAX_D0; ++d0) {
+            // The slots for d1 = 0, which must differ as d1 moves the bucket as a whole.
+            bool areSlotsDistinct = true;
+            for (int j = 0; j < size; ++j) {
+                bucketSlots[j] = getSlot(hashes[wordsByBucket[begin + j]],
+                        d0 << DISPLACEMENT_D1_BITS);
+                for (int k = 0; k < j; ++k) {
+                    areSlotsDistinct &= bucketSlots[k] != bucketSlots[j];
+                }
+            }
+            for (int d1 = 0; areSlotsDistinct && !isPlaced && d1 < wordCount; ++d1) {
+                int j = 0;
+                while (j < size && !isSlotTaken[bucketSlots[j] + d1 < wordCount
+                        ? bucketSlots[j] + d1 : bucketSlots[j] + d1 - wordCount]) {
+                    ++j;
+                }
+                isPlaced = j == size;
+                displacement = (d0 << DISPLACEMENT_D1_BITS) | static_cast<uint32_t>(d1);
+            }
+        }
+        if (!isPlaced) {
+            return false;
+        }
+        mDisplacements[bucket] = displacement;
+        for (int j = 0; j < size; ++j) {
+            const int word = wordsByBucket[begin + j];
+            const int slot = getSlot(hashes[word], displacement);
+            isSlotTaken[slot] = true;
+            mSlots[slot].mTerminalPos = (*terminalPositions)[word];
+            mSlots[slot].mFingerprint = getFingerprint(hashes[word]);
+        }
+    }
+    return true;
+}
+} // namespace latinime
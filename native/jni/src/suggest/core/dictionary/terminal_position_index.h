@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_TERMINAL_POSITION_INDEX_H
+#define LATINIME_TERMINAL_POSITION_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "binary_format.h"
+#include "defines.h"
+#include "memory_utils.h"
+
+namespace latinime {
+
+/**
+ * A minimal perfect hash from the words of a dictionary to the positions of their terminal
+ * groups, so that looking up a word costs one hash of its code points and two loads instead of a
+ * walk of the trie from the root. The keys are hashed into buckets of a few words, and each
+ * bucket stores the displacement that sends its words to free slots of a table with exactly one
+ * slot per word. Words not in the dictionary also land in some slot, and are told apart by a
+ * fingerprint of their hash. Immutable once created, hence shared by all sessions.
+ */
+class TerminalPositionIndex {
+ public:
+    // Returns 0 if the dictionary is too large to index or seems broken.
+    static TerminalPositionIndex *create(const uint8_t *const dicRoot, const int dicSize);
+
+    // The bytes allocated for the index, including the retained capacity.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mSlots)
+                + MemoryUtils::getVectorMemorySize(&mDisplacements);
+    }
+
+    // Looks a word up with the index if there is one, or walks the trie like
+    // BinaryFormat::getTerminalPosition does. Lower case searches always walk the trie, as they
+    // only lower the first code point of each group.
+    static AK_FORCE_INLINE int getTerminalPosition(const TerminalPositionIndex *const index,
+            const uint8_t *const root, const int *const inWord, const int length,
+            const bool forceLowerCaseSearch) {
+        if (index && !forceLowerCaseSearch) {
+            return index->findTerminalPosition(inWord, length);
+        }
+        return BinaryFormat::getTerminalPosition(root, inWord, length, forceLowerCaseSearch);
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    ~TerminalPositionIndex() {}
+
+    // Returns the position of the terminal group of the word, or NOT_VALID_WORD.
+    AK_FORCE_INLINE int findTerminalPosition(const int *const inWord, const int length) const {
+        if (length <= 0) {
+            return NOT_VALID_WORD;
+        }
+        uint64_t hash = INITIAL_HASH;
+        for (int i = 0; i < length; ++i) {
+            hash = addToHash(hash, inWord[i]);
+        }
+        hash = finalizeHash(hash, mSeed);
+        const int slot = getSlot(hash, mDisplacements[getBucket(hash)]);
+        if (mSlots[slot].mFingerprint != getFingerprint(hash)) {
+            return NOT_VALID_WORD;
+        }
+        return mSlots[slot].mTerminalPos;
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(TerminalPositionIndex);
+    // Displacements are stored as (d0 << DISPLACEMENT_D1_BITS) | d1.
+    static const int DISPLACEMENT_D1_BITS = 20;
+    static const int MAX_TERMINAL_COUNT = 1 << DISPLACEMENT_D1_BITS;
+    static const uint32_t MAX_D0;
+    static const int MAX_BUILD_ATTEMPTS;
+    static const int AVERAGE_BUCKET_SIZE;
+    static const uint64_t INITIAL_HASH;
+
+    struct Slot {
+        int mTerminalPos;
+        uint32_t mFingerprint;
+    };
+
+    TerminalPositionIndex() : mSlots(), mDisplacements(), mSeed(0) {}
+
+    static bool collectTerminals(const uint8_t *const dicRoot, const int dicSize,
+            std::vector<uint64_t> *const wordHashes, std::vector<int> *const terminalPositions);
+    bool placeTerminals(const std::vector<uint64_t> *const wordHashes,
+            const std::vector<int> *const terminalPositions, const uint32_t seed);
+
+    // FNV-1a over the code points, so that the hashes of the words are built along the trie.
+    static AK_FORCE_INLINE uint64_t addToHash(const uint64_t hash, const int codePoint) {
+        return (hash ^ static_cast<uint32_t>(codePoint)) * 1099511628211ULL;
+    }
+
+    // The finalizer of MurmurHash3, as FNV-1a leaves the high bits poorly mixed. The seed is
+    // changed when some words cannot be placed.
+    static AK_FORCE_INLINE uint64_t finalizeHash(uint64_t hash, const uint32_t seed) {
+        hash ^= seed * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 33;
+        hash *= 0xC4CEB9FE1A85EC53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    AK_FORCE_INLINE int getBucket(const uint64_t hash) const {
+        return static_cast<int>((hash >> 32) % mDisplacements.size());
+    }
+
+    // A displacement (d0, d1) sends a word to (h1 + d0 * h2 + d1) % slotCount: d1 alone moves a
+    // bucket as a whole and d0 changes the distances between its words.
+    AK_FORCE_INLINE int getSlot(const uint64_t hash, const uint32_t displacement) const {
+        const uint64_t slotCount = mSlots.size();
+        const uint64_t h1 = (hash & 0xFFFFFFFFULL) % slotCount;
+        const uint64_t h2 = ((hash * 0xC2B2AE3D27D4EB4FULL) >> 32) % slotCount;
+        return static_cast<int>((h1 + (displacement >> DISPLACEMENT_D1_BITS) * h2
+                + (displacement & ((1 << DISPLACEMENT_D1_BITS) - 1))) % slotCount);
+    }
+
+    static AK_FORCE_INLINE uint32_t getFingerprint(const uint64_t hash) {
+        // Bits independent of the bucket and the slot
+        return static_cast<uint32_t>((hash * 0x9E3779B97F4A7C15ULL) >> 32);
+    }
+
+    std::vector<Slot> mSlots;
+    std::vector<uint32_t> mDisplacements;
+    uint32_t mSeed;
+};
+} // namespace latinime
+#endif // LATINIME_TERMINAL_POSITION_INDEX_H
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: word_address_index.cpp"
+
+#include "suggest/core/dictionary/word_address_index.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "suggest/core/dicnode/dic_node_utils.h"
+
+namespace latinime {
+
+// 8 bytes per group: the index stays under 8MB.
+const int WordAddressIndex::MAX_GROUP_COUNT = 1 << 20;
+
+/* static */ WordAddressIndex *WordAddressIndex::create(const uint8_t *const dicRoot,
+        const int dicSize) {
+    WordAddressIndex *const index = new WordAddressIndex();
+    if (!index->build(dicRoot, dicSize)) {
+        AKLOGI("No word address index for the dictionary of size %d", dicSize);
+        delete index;
+        return 0;
+    }
+    return index;
+}
+
+int WordAddressIndex::readWordAtAddress(const uint8_t *const root, const int address,
+        const int maxDepth, int *outWord, int *outUnigramProbability) const {
+    const std::vector<int>::const_iterator it =
+            std::lower_bound(mPositions.begin(), mPositions.end(), address);
+    if (it == mPositions.end() || *it != address) {
+        return 0;
+    }
+    // The groups from the root to the one at the address
+    int groupIndices[MAX_WORD_LENGTH];
+    int depth = 0;
+    for (int index = static_cast<int>(it - mPositions.begin()); index != NOT_AN_INDEX;
+            index = mParentIndices[index]) {
+        if (depth >= maxDepth || depth >= MAX_WORD_LENGTH) {
+            return 0;
+        }
+        groupIndices[depth++] = index;
+    }
+    int wordPos = 0;
+    int pos = 0;
+    while (depth > 0) {
+        pos = mPositions[groupIndices[--depth]];
+        const uint8_t flags = BinaryFormat::getFlagsAndForwardPointer(root, &pos);
+        int codePoint = BinaryFormat::getCodePointAndForwardPointer(root, &pos);
+        while (true) {
+            if (wordPos >= maxDepth) {
+                return 0;
+            }
+            outWord[wordPos++] = codePoint;
+            if (!(BinaryFormat::FLAG_HAS_MULTIPLE_CHARS & flags)) {
+                break;
+            }
+            codePoint = BinaryFormat::getCodePointAndForwardPointer(root, &pos);
+            if (NOT_A_CODE_POINT == codePoint) {
+                break;
+            }
+        }
+    }
+    *outUnigramProbability = BinaryFormat::readProbabilityWithoutMovingPointer(root, pos);
+    return wordPos;
+}
+
+bool WordAddressIndex::build(const uint8_t *const dicRoot, const int dicSize) {
+    if (dicSize <= 0) {
+        return false;
+    }
+    // Children arrays to read, as triples of (position, group count, index of the parent in the
+    // order of the reading)
+    std::vector<int> pendingArrays;
+    int rootPos = 0;
+    const int rootCount = BinaryFormat::getGroupCountAndForwardPointer(dicRoot, &rootPos);
+    pendingArrays.push_back(rootPos);
+    pendingArrays.push_back(rootCount);
+    pendingArrays.push_back(NOT_AN_INDEX);
+    // Pairs of (position, index in the order of the reading) of the groups, and their parents
+    std::vector<std::pair<int, int> > groups;
+    std::vector<int> parents;
+    int subword[MAX_WORD_LENGTH];
+    while (!pendingArrays.empty()) {
+        const int parent = pendingArrays.back();
+        pendingArrays.pop_back();
+        const int count = pendingArrays.back();
+        pendingArrays.pop_back();
+        int pos = pendingArrays.back();
+        pendingArrays.pop_back();
+        if (count <= 0 || pos <= 0 || pos >= dicSize
+                || static_cast<int>(groups.size()) + count > MAX_GROUP_COUNT) {
+            return false;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (pos >= dicSize) {
+                return false;
+            }
+            DicNodeChildrenCache::DecodedChild child;
+            pos = DicNodeUtils::readChildGroup(dicRoot, pos, &child, subword);
+            const int index = static_cast<int>(groups.size());
+            groups.push_back(std::make_pair(child.mPos, index));
+            parents.push_back(parent);
+            if (child.mChildrenCount > 0) {
+                pendingArrays.push_back(child.mChildrenPos);
+                pendingArrays.push_back(child.mChildrenCount);
+                pendingArrays.push_back(index);
+            }
+        }
+    }
+
+    std::sort(groups.begin(), groups.end());
+    const int groupCount = static_cast<int>(groups.size());
+    // The index in the sorted order of each group, in the order of the reading
+    std::vector<int> sortedIndices(groupCount);
+    mPositions.resize(groupCount);
+    for (int i = 0; i < groupCount; ++i) {
+        if (i > 0 && groups[i].first == groups[i - 1].first) {
+            // Two children arrays share a group: not a tree.
+            return false;
+        }
+        mPositions[i] = groups[i].first;
+        sortedIndices[groups[i].second] = i;
+    }
+    mParentIndices.resize(groupCount);
+    for (int i = 0; i < groupCount; ++i) {
+        const int parent = parents[groups[i].second];
+        mParentIndices[i] = NOT_AN_INDEX == parent ? NOT_AN_INDEX : sortedIndices[parent];
+    }
+    return true;
+}
+} // namespace latinime
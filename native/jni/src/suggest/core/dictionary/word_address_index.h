@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_WORD_ADDRESS_INDEX_H
+#define LATINIME_WORD_ADDRESS_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "binary_format.h"
+#include "defines.h"
+#include "memory_utils.h"
+
+namespace latinime {
+
+/**
+ * The parent of every char group of a dictionary, so that the word ending at a group is read by
+ * climbing from the group to the root instead of searching down from the root for the children
+ * array that holds it, as BinaryFormat::getWordAtAddress does. The positions of the groups are
+ * sorted, so the group at an address is found by a binary search and its ancestors by their
+ * indices. Only the code points of the groups on the way are read from the dictionary. Immutable
+ * once created, hence shared by all sessions.
+ */
+class WordAddressIndex {
+ public:
+    // Returns 0 if the dictionary is too large to index or seems broken.
+    static WordAddressIndex *create(const uint8_t *const dicRoot, const int dicSize);
+
+    // The bytes allocated for the index, including the retained capacity.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mPositions)
+                + MemoryUtils::getVectorMemorySize(&mParentIndices);
+    }
+
+    // Reads the word with the index if there is one, or searches the trie like
+    // BinaryFormat::getWordAtAddress does. For parameters and return value see
+    // BinaryFormat::getWordAtAddress.
+    static AK_FORCE_INLINE int getWordAtAddress(const WordAddressIndex *const index,
+            const uint8_t *const root, const int address, const int maxDepth, int *outWord,
+            int *outUnigramProbability) {
+        if (index) {
+            return index->readWordAtAddress(root, address, maxDepth, outWord,
+                    outUnigramProbability);
+        }
+        return BinaryFormat::getWordAtAddress(root, address, maxDepth, outWord,
+                outUnigramProbability);
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    ~WordAddressIndex() {}
+
+    int readWordAtAddress(const uint8_t *const root, const int address, const int maxDepth,
+            int *outWord, int *outUnigramProbability) const;
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(WordAddressIndex);
+    static const int MAX_GROUP_COUNT;
+
+    WordAddressIndex() : mPositions(), mParentIndices() {}
+
+    bool build(const uint8_t *const dicRoot, const int dicSize);
+
+    // The positions of the groups, sorted
+    std::vector<int> mPositions;
+    // The index in mPositions of the parent of each group, or NOT_AN_INDEX in the root array
+    std::vector<int> mParentIndices;
+};
+} // namespace latinime
+#endif // LATINIME_WORD_ADDRESS_INDEX_H
@@ -35,10 +35,11 @@ class Scoring {
     virtual void safetyNetForMostProbableString(const int terminalSize,
             const int maxScore, int *const outputCodePoints, int *const frequencies) const = 0;
     // TODO: Make more generic
-    virtual void searchWordWithDoubleLetter(DicNode *terminals, const int terminalSize,
+    virtual void searchWordWithDoubleLetter(DicNode *const *const terminals,
+            const int terminalSize,
             int *doubleLetterTerminalIndex, DoubleLetterLevel *doubleLetterLevel) const = 0;
     virtual float getAdjustedLanguageWeight(DicTraverseSession *const traverseSession,
-            DicNode *const terminals, const int size) const = 0;
+            DicNode *const *const terminals, const int size) const = 0;
     virtual float getDoubleLetterDemotionDistanceCost(const int terminalIndex,
             const int doubleLetterTerminalIndex,
             const DoubleLetterLevel doubleLetterLevel) const = 0;
@@ -26,7 +26,8 @@ class DicTraverseSession;
 class Traversal {
  public:
     virtual int getMaxPointerCount() const = 0;
-    virtual bool allowsErrorCorrections(const DicNode *const dicNode) const = 0;
+    virtual bool allowsErrorCorrections(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode) const = 0;
     virtual bool isOmission(const DicTraverseSession *const traverseSession,
             const DicNode *const dicNode, const DicNode *const childDicNode,
             const bool allowsErrorCorrections) const = 0;
@@ -48,6 +49,9 @@ class Traversal {
     virtual bool allowPartialCommit() const = 0;
     virtual int getDefaultExpandDicNodeSize() const = 0;
     virtual int getMaxCacheSize() const = 0;
+    // The beam width of the first pass of a two-pass search, see DicTraverseSession, or 0 to
+    // search the input in a single pass.
+    virtual int getCoarsePassCacheSize(const DicTraverseSession *const traverseSession) const = 0;
     virtual bool isPossibleOmissionChildNode(const DicTraverseSession *const traverseSession,
             const DicNode *const parentDicNode, const DicNode *const dicNode) const = 0;
     virtual bool isGoodToTraverseNextWord(const DicNode *const dicNode) const = 0;
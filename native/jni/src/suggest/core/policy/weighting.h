@@ -18,6 +18,10 @@
 #define LATINIME_WEIGHTING_H
 
 #include "defines.h"
+#include "suggest/core/dicnode/dic_node.h"
+#include "suggest/core/dicnode/dic_node_profiler.h"
+#include "suggest/core/dicnode/dic_node_utils.h"
+#include "suggest/core/session/dic_traverse_session.h"
 
 namespace latinime {
 
@@ -28,11 +32,32 @@ class MultiBigramMap;
 
 class Weighting {
  public:
-    static void addCostAndForwardInputIndex(const Weighting *const weighting,
-            const CorrectionType correctionType,
-            const DicTraverseSession *const traverseSession,
+    // Inlined with the constant correction type of each call site, so that only the costs of that
+    // correction are computed, and the costs of a policy whose instance is known are bound
+    // statically.
+    static AK_FORCE_INLINE void addCostAndForwardInputIndex(const Weighting *const weighting,
+            const CorrectionType correctionType, const DicTraverseSession *const traverseSession,
             const DicNode *const parentDicNode, DicNode *const dicNode,
-            MultiBigramMap *const multiBigramMap);
+            MultiBigramMap *const multiBigramMap) {
+        const int inputSize = traverseSession->getInputSize();
+        DicNode_InputStateG inputStateG;
+        inputStateG.mNeedsToUpdateInputStateG = false; // Don't use input info by default
+        const float spatialCost = Weighting::getSpatialCost(weighting, correctionType,
+                traverseSession, parentDicNode, dicNode, &inputStateG);
+        const float languageCost = Weighting::getLanguageCost(weighting, correctionType,
+                traverseSession, parentDicNode, dicNode, multiBigramMap);
+        const ErrorType errorType = weighting->getErrorType(correctionType, traverseSession,
+                parentDicNode, dicNode);
+        profile(correctionType, dicNode);
+        if (inputStateG.mNeedsToUpdateInputStateG) {
+            dicNode->updateInputIndexG(&inputStateG);
+        } else {
+            dicNode->forwardInputIndex(0, getForwardInputCount(correctionType),
+                    (correctionType == CT_TRANSPOSITION));
+        }
+        dicNode->addCost(spatialCost, languageCost, weighting->needsToNormalizeCompoundDistance(),
+                inputSize, errorType);
+    }
 
  protected:
     virtual float getTerminalSpatialCost(const DicTraverseSession *const traverseSession,
@@ -90,16 +115,141 @@ class Weighting {
  private:
     DISALLOW_COPY_AND_ASSIGN(Weighting);
 
-    static float getSpatialCost(const Weighting *const weighting,
+    static AK_FORCE_INLINE void profile(const CorrectionType correctionType, DicNode *const node) {
+#if DEBUG_DICT
+        switch (correctionType) {
+        case CT_OMISSION:
+            PROF_OMISSION(node->mProfiler);
+            return;
+        case CT_ADDITIONAL_PROXIMITY:
+            PROF_ADDITIONAL_PROXIMITY(node->mProfiler);
+            return;
+        case CT_SUBSTITUTION:
+            PROF_SUBSTITUTION(node->mProfiler);
+            return;
+        case CT_NEW_WORD_SPACE_OMITTION:
+            PROF_NEW_WORD(node->mProfiler);
+            return;
+        case CT_MATCH:
+            PROF_MATCH(node->mProfiler);
+            return;
+        case CT_COMPLETION:
+            PROF_COMPLETION(node->mProfiler);
+            return;
+        case CT_TERMINAL:
+            PROF_TERMINAL(node->mProfiler);
+            return;
+        case CT_NEW_WORD_SPACE_SUBSTITUTION:
+            PROF_SPACE_SUBSTITUTION(node->mProfiler);
+            return;
+        case CT_INSERTION:
+            PROF_INSERTION(node->mProfiler);
+            return;
+        case CT_TRANSPOSITION:
+            PROF_TRANSPOSITION(node->mProfiler);
+            return;
+        default:
+            // do nothing
+            return;
+        }
+#else
+        // do nothing
+#endif
+    }
+
+    static AK_FORCE_INLINE float getSpatialCost(const Weighting *const weighting,
             const CorrectionType correctionType, const DicTraverseSession *const traverseSession,
             const DicNode *const parentDicNode, const DicNode *const dicNode,
-            DicNode_InputStateG *const inputStateG);
-    static float getLanguageCost(const Weighting *const weighting,
+            DicNode_InputStateG *const inputStateG) {
+        switch(correctionType) {
+        case CT_OMISSION:
+            return weighting->getOmissionCost(parentDicNode, dicNode);
+        case CT_ADDITIONAL_PROXIMITY:
+            // only used for typing
+            return weighting->getAdditionalProximityCost();
+        case CT_SUBSTITUTION:
+            // only used for typing
+            return weighting->getSubstitutionCost();
+        case CT_NEW_WORD_SPACE_OMITTION:
+            return weighting->getNewWordCost(traverseSession, dicNode);
+        case CT_MATCH:
+            return weighting->getMatchedCost(traverseSession, dicNode, inputStateG);
+        case CT_COMPLETION:
+            return weighting->getCompletionCost(traverseSession, dicNode);
+        case CT_TERMINAL:
+            return weighting->getTerminalSpatialCost(traverseSession, dicNode);
+        case CT_NEW_WORD_SPACE_SUBSTITUTION:
+            return weighting->getSpaceSubstitutionCost(traverseSession, dicNode);
+        case CT_INSERTION:
+            return weighting->getInsertionCost(traverseSession, parentDicNode, dicNode);
+        case CT_TRANSPOSITION:
+            return weighting->getTranspositionCost(traverseSession, parentDicNode, dicNode);
+        default:
+            return 0.0f;
+        }
+    }
+
+    static AK_FORCE_INLINE float getLanguageCost(const Weighting *const weighting,
             const CorrectionType correctionType, const DicTraverseSession *const traverseSession,
             const DicNode *const parentDicNode, const DicNode *const dicNode,
-            MultiBigramMap *const multiBigramMap);
+            MultiBigramMap *const multiBigramMap) {
+        switch(correctionType) {
+        case CT_OMISSION:
+            return 0.0f;
+        case CT_SUBSTITUTION:
+            return 0.0f;
+        case CT_NEW_WORD_SPACE_OMITTION:
+            return weighting->getNewWordBigramCost(traverseSession, parentDicNode, multiBigramMap);
+        case CT_MATCH:
+            return 0.0f;
+        case CT_COMPLETION:
+            return 0.0f;
+        case CT_TERMINAL: {
+            const float languageImprobability =
+                    DicNodeUtils::getBigramNodeImprobability(traverseSession->getOffsetDict(),
+                            traverseSession->getBigramListIndex(), dicNode, multiBigramMap,
+                            traverseSession->getProbabilityOverlay());
+            return weighting->getTerminalLanguageCost(traverseSession, dicNode,
+                    languageImprobability);
+        }
+        case CT_NEW_WORD_SPACE_SUBSTITUTION:
+            return weighting->getNewWordBigramCost(traverseSession, parentDicNode, multiBigramMap);
+        case CT_INSERTION:
+            return 0.0f;
+        case CT_TRANSPOSITION:
+            return 0.0f;
+        default:
+            return 0.0f;
+        }
+    }
+
     // TODO: Move to TypingWeighting and GestureWeighting?
-    static int getForwardInputCount(const CorrectionType correctionType);
+    static AK_FORCE_INLINE int getForwardInputCount(const CorrectionType correctionType) {
+        switch(correctionType) {
+            case CT_OMISSION:
+                return 0;
+            case CT_ADDITIONAL_PROXIMITY:
+                return 0;
+            case CT_SUBSTITUTION:
+                return 0;
+            case CT_NEW_WORD_SPACE_OMITTION:
+                return 0;
+            case CT_MATCH:
+                return 1;
+            case CT_COMPLETION:
+                return 1;
+            case CT_TERMINAL:
+                return 0;
+            case CT_NEW_WORD_SPACE_SUBSTITUTION:
+                return 1;
+            case CT_INSERTION:
+                return 2;
+            case CT_TRANSPOSITION:
+                return 2;
+            default:
+                return 0;
+        }
+    }
 };
 } // namespace latinime
 #endif // LATINIME_WEIGHTING_H
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "suggest/core/session/adaptive_beam_controller.h"
+
+#include <time.h>
+
+namespace latinime {
+
+const int AdaptiveBeamController::NO_LATENCY_BUDGET = 0;
+const float AdaptiveBeamController::SHRINK_THRESHOLD = 1.0f;
+const float AdaptiveBeamController::GROW_THRESHOLD = 2.0f;
+const float AdaptiveBeamController::MIN_BEAM_SHRINK_RATE = 0.5f;
+const float AdaptiveBeamController::MAX_BEAM_GROWTH_RATE = 1.25f;
+
+int AdaptiveBeamController::updateBeamWidth(const int remainingStepCount) {
+    ++mStepCount;
+    const int64_t elapsedUs = getCurrentTimeUs() - mStartTimeUs;
+    if (elapsedUs >= mLatencyBudgetUs) {
+        mBeamWidth = MIN_ADAPTIVE_BEAM_WIDTH;
+        return mBeamWidth;
+    }
+    // Assume the remaining input indices take as long as the average one so far.
+    const float projectedUs = static_cast<float>(elapsedUs) / static_cast<float>(mStepCount)
+            * static_cast<float>(max(remainingStepCount, 1));
+    const float slack = projectedUs > 0.0f
+            ? static_cast<float>(mLatencyBudgetUs - elapsedUs) / projectedUs
+            : MAX_BEAM_GROWTH_RATE;
+    if (slack < SHRINK_THRESHOLD) {
+        mBeamWidth = static_cast<int>(static_cast<float>(mBeamWidth)
+                * max(slack, MIN_BEAM_SHRINK_RATE));
+    } else if (slack > GROW_THRESHOLD) {
+        mBeamWidth = static_cast<int>(static_cast<float>(mBeamWidth)
+                * min(slack, MAX_BEAM_GROWTH_RATE));
+    }
+    mBeamWidth = min(max(mBeamWidth, MIN_ADAPTIVE_BEAM_WIDTH), mMaxBeamWidth);
+    if (DEBUG_DICT) {
+        AKLOGI("Adaptive beam: elapsed = %lldus, slack = %f, beam width = %d",
+                static_cast<long long>(elapsedUs), slack, mBeamWidth);
+    }
+    return mBeamWidth;
+}
+
+/* static */ int64_t AdaptiveBeamController::getCurrentTimeUs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000LL + now.tv_nsec / 1000;
+}
+
+} // namespace latinime
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_ADAPTIVE_BEAM_CONTROLLER_H
+#define LATINIME_ADAPTIVE_BEAM_CONTROLLER_H
+
+#include <stdint.h>
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * Chooses the number of dicNodes kept for the next input index so that a search finishes within
+ * a latency budget. After each input index, the time spent so far is used to project the time
+ * the remaining input indices will take with the current beam width. The beam is narrowed when
+ * the projection exceeds the budget and widened when there is enough slack.
+ */
+class AdaptiveBeamController {
+ public:
+    static const int NO_LATENCY_BUDGET;
+
+    AK_FORCE_INLINE AdaptiveBeamController()
+            : mLatencyBudgetUs(NO_LATENCY_BUDGET), mStartTimeUs(0), mMaxBeamWidth(0),
+              mBeamWidth(0), mStepCount(0) {}
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~AdaptiveBeamController() {}
+
+    // A budget of NO_LATENCY_BUDGET or less disables the adaptation.
+    void setLatencyBudgetMs(const int latencyBudgetMs) {
+        mLatencyBudgetUs = max(latencyBudgetMs, NO_LATENCY_BUDGET) * 1000LL;
+    }
+
+    bool isEnabled() const {
+        return mLatencyBudgetUs > NO_LATENCY_BUDGET;
+    }
+
+    // Starts measuring a search that initially keeps defaultBeamWidth dicNodes per input index
+    // and never keeps more than maxBeamWidth.
+    AK_FORCE_INLINE void start(const int defaultBeamWidth, const int maxBeamWidth) {
+        mStartTimeUs = getCurrentTimeUs();
+        mMaxBeamWidth = max(maxBeamWidth, MIN_ADAPTIVE_BEAM_WIDTH);
+        mBeamWidth = min(max(defaultBeamWidth, MIN_ADAPTIVE_BEAM_WIDTH), mMaxBeamWidth);
+        mStepCount = 0;
+    }
+
+    // Called after each input index. Returns the beam width for the next one.
+    int updateBeamWidth(const int remainingStepCount);
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(AdaptiveBeamController);
+
+    // The beam is narrowed when the remaining budget covers less than this ratio of the
+    // projected time, and widened when it covers more than GROW_THRESHOLD.
+    static const float SHRINK_THRESHOLD;
+    static const float GROW_THRESHOLD;
+    static const float MIN_BEAM_SHRINK_RATE;
+    static const float MAX_BEAM_GROWTH_RATE;
+
+    static int64_t getCurrentTimeUs();
+
+    int64_t mLatencyBudgetUs;
+    int64_t mStartTimeUs;
+    int mMaxBeamWidth;
+    int mBeamWidth;
+    int mStepCount;
+};
+} // namespace latinime
+#endif // LATINIME_ADAPTIVE_BEAM_CONTROLLER_H
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "suggest/core/session/candidate_path_set.h"
+
+#include "suggest/core/dicnode/dic_node_utils.h"
+#include "suggest/core/dicnode/dic_node_vector.h"
+
+namespace latinime {
+
+bool CandidatePathSet::addWord(const uint8_t *const dicRoot, const int rootPos,
+        const DecodedNodeIndex *const nodeIndex, DicNodeChildrenCache *const childrenCache,
+        DicNodeVector *const childDicNodes, const int *const codePoints,
+        const int codePointCount) {
+    DicNode dicNode;
+    DicNodeUtils::initAsRoot(rootPos, dicRoot, NOT_VALID_WORD, &dicNode);
+    for (int i = 0; i < codePointCount; ++i) {
+        childDicNodes->clear();
+        DicNodeUtils::getAllChildDicNodes(&dicNode, dicRoot, nodeIndex, childrenCache,
+                childDicNodes);
+        const int childDicNodesSize = childDicNodes->getSizeAndLock();
+        DicNode *childDicNode = 0;
+        for (int j = 0; j < childDicNodesSize; ++j) {
+            if ((*childDicNodes)[j]->getNodeCodePoint() == codePoints[i]) {
+                childDicNode = (*childDicNodes)[j];
+                break;
+            }
+        }
+        if (!childDicNode) {
+            return false;
+        }
+        mKeys.push_back(getKey(childDicNode));
+        dicNode.initByCopy(childDicNode);
+    }
+    return true;
+}
+
+void CandidatePathSet::sort() {
+    std::sort(mKeys.begin(), mKeys.end());
+    mKeys.erase(std::unique(mKeys.begin(), mKeys.end()), mKeys.end());
+}
+} // namespace latinime
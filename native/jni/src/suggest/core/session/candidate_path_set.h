@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_CANDIDATE_PATH_SET_H
+#define LATINIME_CANDIDATE_PATH_SET_H
+
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+#include "defines.h"
+#include "suggest/core/dicnode/dic_node.h"
+
+namespace latinime {
+
+class DecodedNodeIndex;
+class DicNodeChildrenCache;
+class DicNodeVector;
+
+/**
+ * The paths of the lexicon trie that spell some words, as the positions and depths of the dicNodes
+ * along them. The second pass of a two-pass search only expands the dicNodes on the paths of the
+ * words found by the first one. The paths are kept sorted once they are all added and looked up
+ * by a binary search.
+ */
+class CandidatePathSet {
+ public:
+    CandidatePathSet() : mKeys() {}
+    // Non virtual inline destructor -- never inherit this class
+    ~CandidatePathSet() {}
+
+    // Adds the path of the codePointCount code points of a word from the root at rootPos, and
+    // returns whether the whole word was found. The children of the dicNodes are expanded into
+    // childDicNodes. nodeIndex and childrenCache may be null, as for
+    // DicNodeUtils::getAllChildDicNodes.
+    bool addWord(const uint8_t *const dicRoot, const int rootPos,
+            const DecodedNodeIndex *const nodeIndex, DicNodeChildrenCache *const childrenCache,
+            DicNodeVector *const childDicNodes, const int *const codePoints,
+            const int codePointCount);
+    // Sorts the added paths. Must be called before contains().
+    void sort();
+
+    AK_FORCE_INLINE bool contains(const DicNode *const dicNode) const {
+        return std::binary_search(mKeys.begin(), mKeys.end(), getKey(dicNode));
+    }
+
+    bool isEmpty() const { return mKeys.empty(); }
+    // Keeps the capacity for the next search.
+    void clear() { mKeys.clear(); }
+    int getMemorySize() const { return static_cast<int>(mKeys.capacity() * sizeof(mKeys[0])); }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(CandidatePathSet);
+
+    // The code points of a char group share its position, and are told apart by their depths.
+    static AK_FORCE_INLINE uint64_t getKey(const DicNode *const dicNode) {
+        return (static_cast<uint64_t>(dicNode->getPos()) << 16) | dicNode->getDepth();
+    }
+
+    std::vector<uint64_t> mKeys;
+};
+} // namespace latinime
+#endif // LATINIME_CANDIDATE_PATH_SET_H
@@ -16,20 +16,41 @@
 
 #include "suggest/core/session/dic_traverse_session.h"
 
+#include <pthread.h>
+
 #include "binary_format.h"
 #include "defines.h"
 #include "dictionary.h"
 #include "dic_traverse_wrapper.h"
 #include "jni.h"
+#include "memory_utils.h"
+#include "probability_overlay.h"
+#include "proximity_info.h"
 #include "suggest/core/dicnode/dic_node_utils.h"
+#include "suggest/core/dictionary/dictionary_header.h"
+#include "suggest/core/dictionary/terminal_position_index.h"
 
 namespace latinime {
 
 const int DicTraverseSession::CACHE_START_INPUT_LENGTH_THRESHOLD = 20;
 
+// The released sessions, kept with their buffers for the next Java session. A session does not
+// depend on its locale and is rebound to its dictionary by init, so any of them serves any
+// dictionary, and switching between the subtypes of a multilingual user allocates nothing.
+static const int MAX_POOLED_SESSION_COUNT = 4;
+static pthread_mutex_t sSessionPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static DicTraverseSession *sPooledSessions[MAX_POOLED_SESSION_COUNT];
+static int sPooledSessionCount = 0;
+
 // A factory method for DicTraverseSession
 static void *getSessionInstance(JNIEnv *env, jstring localeStr) {
-    return new DicTraverseSession(env, localeStr);
+    DicTraverseSession *session = 0;
+    pthread_mutex_lock(&sSessionPoolMutex);
+    if (sPooledSessionCount > 0) {
+        session = sPooledSessions[--sPooledSessionCount];
+    }
+    pthread_mutex_unlock(&sSessionPoolMutex);
+    return session ? session : new DicTraverseSession(env, localeStr);
 }
 
 // TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
@@ -43,7 +64,160 @@ static void initSessionInstance(void *traverseSession, const Dictionary *const d
 
 // TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
 static void releaseSessionInstance(void *traverseSession) {
-    delete static_cast<DicTraverseSession *>(traverseSession);
+    if (!traverseSession) {
+        return;
+    }
+    DicTraverseSession *const session = static_cast<DicTraverseSession *>(traverseSession);
+    session->resetForReuse();
+    pthread_mutex_lock(&sSessionPoolMutex);
+    const bool isPooled = sPooledSessionCount < MAX_POOLED_SESSION_COUNT;
+    if (isPooled) {
+        sPooledSessions[sPooledSessionCount++] = session;
+    }
+    pthread_mutex_unlock(&sSessionPoolMutex);
+    if (!isPooled) {
+        delete session;
+    }
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static void setSessionInstanceLatencyBudget(void *traverseSession, const int latencyBudgetMs) {
+    if (traverseSession) {
+        static_cast<DicTraverseSession *>(traverseSession)->setLatencyBudgetMs(latencyBudgetMs);
+    }
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static void setSessionInstanceProbabilityOverlay(void *traverseSession,
+        const ProbabilityOverlay *const overlay) {
+    if (traverseSession) {
+        static_cast<DicTraverseSession *>(traverseSession)->setProbabilityOverlay(overlay);
+    }
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static void setSessionInstanceSearchProfile(void *traverseSession, const int profile) {
+    if (traverseSession) {
+        static_cast<DicTraverseSession *>(traverseSession)->setSearchProfile(profile);
+    }
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static void setSessionInstanceRequestTicket(void *traverseSession, const int ticket) {
+    if (traverseSession) {
+        static_cast<DicTraverseSession *>(traverseSession)->setRequestTicket(ticket);
+    }
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static void cancelSessionInstanceRequest(void *traverseSession, const int ticket) {
+    if (traverseSession) {
+        static_cast<DicTraverseSession *>(traverseSession)->cancelRequest(ticket);
+    }
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static void setSessionInstanceProgressiveInterval(void *traverseSession,
+        const int inputIndexCount, const int intervalMs) {
+    if (traverseSession) {
+        static_cast<DicTraverseSession *>(traverseSession)->setProgressiveInterval(
+                inputIndexCount, intervalMs);
+    }
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static int getSessionInstancePublishedResults(void *traverseSession, const int ticket,
+        int *const outCodePoints, int *const outScores, int *const outSpaceIndices,
+        int *const outTypes) {
+    if (traverseSession) {
+        return static_cast<DicTraverseSession *>(traverseSession)->getProgressiveResults()->
+                getPublishedResults(ticket, outCodePoints, outScores, outSpaceIndices, outTypes);
+    }
+    return 0;
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static int getSessionInstanceCachedSuggestions(void *traverseSession,
+        const ProximityInfo *const proximityInfo, const bool isGesture,
+        const int *const xcoordinates, const int *const ycoordinates, const int *const times,
+        const int *const pointerIds, const int *const inputCodePoints, const int inputSize,
+        const int commitPoint, int *const outWords, int *const frequencies,
+        int *const spaceIndices, int *const outputTypes) {
+    if (traverseSession) {
+        return static_cast<DicTraverseSession *>(traverseSession)->getCachedSuggestions(
+                proximityInfo, isGesture, xcoordinates, ycoordinates, times, pointerIds,
+                inputCodePoints, inputSize, commitPoint, outWords, frequencies, spaceIndices,
+                outputTypes);
+    }
+    return NOT_AN_INDEX;
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static void cacheSessionInstanceSuggestions(void *traverseSession, const int *const outWords,
+        const int *const frequencies, const int *const spaceIndices,
+        const int *const outputTypes, const int count) {
+    if (traverseSession) {
+        static_cast<DicTraverseSession *>(traverseSession)->cacheSuggestions(outWords,
+                frequencies, spaceIndices, outputTypes, count);
+    }
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static BigramProbabilityMap *getSessionInstanceBigramProbabilityMap(void *traverseSession) {
+    if (traverseSession) {
+        return static_cast<DicTraverseSession *>(traverseSession)->getBigramProbabilityMap();
+    }
+    return 0;
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static BigramPredictionCache *getSessionInstanceBigramPredictionCache(void *traverseSession) {
+    if (traverseSession) {
+        return static_cast<DicTraverseSession *>(traverseSession)->getBigramPredictionCache();
+    }
+    return 0;
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static void addSessionInstanceMemoryUsage(void *traverseSession, int *const usage) {
+    if (traverseSession) {
+        static_cast<DicTraverseSession *>(traverseSession)->addMemoryUsage(usage);
+    }
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static void addSessionInstanceStatistics(void *traverseSession, int64_t *const statistics,
+        const bool reset) {
+    if (traverseSession) {
+        SearchStatistics *const searchStatistics =
+                static_cast<DicTraverseSession *>(traverseSession)->getSearchStatistics();
+        searchStatistics->addTo(statistics);
+        if (reset) {
+            searchStatistics->reset();
+        }
+    }
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static void recordSessionInstanceLatency(void *traverseSession, const bool isGesture,
+        const int inputSize, const int64_t durationNs) {
+    if (traverseSession) {
+        static_cast<DicTraverseSession *>(traverseSession)->getLatencyHistogram()->record(
+                isGesture, inputSize, durationNs);
+    }
+}
+
+// TODO: Pass "DicTraverseSession *traverseSession" when the source code structure settles down.
+static void addSessionInstanceLatencyHistogram(void *traverseSession, int *const counts,
+        const bool reset) {
+    if (traverseSession) {
+        LatencyHistogram *const latencyHistogram =
+                static_cast<DicTraverseSession *>(traverseSession)->getLatencyHistogram();
+        latencyHistogram->addTo(counts);
+        if (reset) {
+            latencyHistogram->reset();
+        }
+    }
 }
 
 // An ad-hoc internal class to register the factory method defined above
@@ -53,6 +227,32 @@ class TraverseSessionFactoryRegisterer {
         DicTraverseWrapper::setTraverseSessionFactoryMethod(getSessionInstance);
         DicTraverseWrapper::setTraverseSessionInitMethod(initSessionInstance);
         DicTraverseWrapper::setTraverseSessionReleaseMethod(releaseSessionInstance);
+        DicTraverseWrapper::setTraverseSessionSetLatencyBudgetMethod(
+                setSessionInstanceLatencyBudget);
+        DicTraverseWrapper::setTraverseSessionSetProbabilityOverlayMethod(
+                setSessionInstanceProbabilityOverlay);
+        DicTraverseWrapper::setTraverseSessionSetSearchProfileMethod(
+                setSessionInstanceSearchProfile);
+        DicTraverseWrapper::setTraverseSessionSetRequestTicketMethod(
+                setSessionInstanceRequestTicket);
+        DicTraverseWrapper::setTraverseSessionCancelRequestMethod(cancelSessionInstanceRequest);
+        DicTraverseWrapper::setTraverseSessionSetProgressiveIntervalMethod(
+                setSessionInstanceProgressiveInterval);
+        DicTraverseWrapper::setTraverseSessionGetPublishedResultsMethod(
+                getSessionInstancePublishedResults);
+        DicTraverseWrapper::setTraverseSessionGetCachedSuggestionsMethod(
+                getSessionInstanceCachedSuggestions);
+        DicTraverseWrapper::setTraverseSessionCacheSuggestionsMethod(
+                cacheSessionInstanceSuggestions);
+        DicTraverseWrapper::setTraverseSessionGetBigramProbabilityMapMethod(
+                getSessionInstanceBigramProbabilityMap);
+        DicTraverseWrapper::setTraverseSessionGetBigramPredictionCacheMethod(
+                getSessionInstanceBigramPredictionCache);
+        DicTraverseWrapper::setTraverseSessionAddMemoryUsageMethod(addSessionInstanceMemoryUsage);
+        DicTraverseWrapper::setTraverseSessionAddStatisticsMethod(addSessionInstanceStatistics);
+        DicTraverseWrapper::setTraverseSessionRecordLatencyMethod(recordSessionInstanceLatency);
+        DicTraverseWrapper::setTraverseSessionAddLatencyHistogramMethod(
+                addSessionInstanceLatencyHistogram);
     }
  private:
     DISALLOW_COPY_AND_ASSIGN(TraverseSessionFactoryRegisterer);
@@ -64,14 +264,45 @@ static TraverseSessionFactoryRegisterer traverseSessionFactoryRegisterer;
 void DicTraverseSession::init(const Dictionary *const dictionary, const int *prevWord,
         int prevWordLength) {
     mDictionary = dictionary;
-    mMultiWordCostMultiplier = BinaryFormat::getMultiWordCostMultiplier(mDictionary->getDict(),
-            mDictionary->getDictSize());
+    mProbabilityOverlay = 0;
+    if (!dictionary) {
+        // The Java dictionary may not be open yet, or be closed already.
+        mPrevWordPos = NOT_VALID_WORD;
+        return;
+    }
+    if (dictionary->getId() != mDictionaryId) {
+        // The dictionary was swapped or flushed, and may be at the address of the old one.
+        mDicNodesCache.clearCachedDicNodesForContinuousSuggestion();
+        mDicNodeSnapshots.clear();
+        mSnapshotInputSize = 0;
+        mMultiBigramMap.clear();
+        for (int i = 0; i < MAX_EXPANSION_WORKER_COUNT; ++i) {
+            mExpansionBuffers[i].getChildrenCache()->clear();
+        }
+        mDictionaryId = dictionary->getId();
+        mProbabilityOverlayId = 0;
+    }
+    // An overlay set before the dictionary was swapped has the positions of the old one.
+    mProbabilityOverlay = (mAttachedProbabilityOverlay
+            && mAttachedProbabilityOverlay->getDictionaryId() == dictionary->getId())
+                    ? mAttachedProbabilityOverlay : 0;
+    const int probabilityOverlayId = mProbabilityOverlay ? mProbabilityOverlay->getId() : 0;
+    if (probabilityOverlayId != mProbabilityOverlayId) {
+        // The cached dicNodes were weighted with the previous probabilities.
+        mDicNodesCache.clearCachedDicNodesForContinuousSuggestion();
+        mDicNodeSnapshots.clear();
+        mSnapshotInputSize = 0;
+        mProbabilityOverlayId = probabilityOverlayId;
+    }
+    mMultiWordCostMultiplier = mDictionary->getHeader()->getMultiWordCostMultiplier();
+    mDigraphCodePoints.setDictFlags(mDictionary->getDictFlags());
     if (!prevWord) {
         mPrevWordPos = NOT_VALID_WORD;
         return;
     }
     // TODO: merge following similar calls to getTerminalPosition into one case-insensitive call.
-    mPrevWordPos = BinaryFormat::getTerminalPosition(dictionary->getOffsetDict(), prevWord,
+    mPrevWordPos = TerminalPositionIndex::getTerminalPosition(
+            dictionary->getTerminalPositionIndex(), dictionary->getOffsetDict(), prevWord,
             prevWordLength, false /* forceLowerCaseSearch */);
     if (mPrevWordPos == NOT_VALID_WORD) {
         // Check bigrams for lower-cased previous word if original was not found. Useful for
@@ -81,14 +312,78 @@ void DicTraverseSession::init(const Dictionary *const dictionary, const int *pre
     }
 }
 
+void DicTraverseSession::resetForReuse() {
+    mDictionary = 0;
+    mProximityInfo = 0;
+    mPrevWordPos = NOT_VALID_WORD;
+    // Makes the next init clear the caches filled from the dictionary, which may be closed.
+    mDictionaryId = 0;
+    mAttachedProbabilityOverlay = 0;
+    mProbabilityOverlay = 0;
+    mProbabilityOverlayId = 0;
+    mDicNodesCache.clearCachedDicNodesForContinuousSuggestion();
+    clearPrevWordChains();
+    mSnapshotInputSize = 0;
+    mSnapshotDictionary = 0;
+    mSnapshotProximityInfo = 0;
+    mBigramProbabilityMap.clear();
+    mSuggestionResultCache.clear();
+    mPartiallyCommited = false;
+    // The settings and the counters belong to the Java session that released it.
+    mAdaptiveBeamController.setLatencyBudgetMs(AdaptiveBeamController::NO_LATENCY_BUDGET);
+    mSearchProfile.setProfile(SearchProfile::SEARCH_PROFILE_DEFAULT);
+    mProgressiveResults.setInterval(ProgressiveResults::NO_INTERVAL,
+            ProgressiveResults::NO_INTERVAL);
+    mRequestTicket = NOT_A_REQUEST_TICKET;
+    mCancelledRequestTicket = NOT_A_REQUEST_TICKET;
+    mSearchStatistics.reset();
+    mLatencyHistogram.reset();
+}
+
 void DicTraverseSession::setupForGetSuggestions(const ProximityInfo *pInfo,
         const int *inputCodePoints, const int inputSize, const int *const inputXs,
         const int *const inputYs, const int *const times, const int *const pointerIds,
         const float maxSpatialDistance, const int maxPointerCount) {
     mProximityInfo = pInfo;
     mMaxPointerCount = maxPointerCount;
+    mIsInCoarsePass = false;
+    mCandidatePaths.clear();
     initializeProximityInfoStates(inputCodePoints, inputXs, inputYs, times, pointerIds, inputSize,
             maxSpatialDistance, maxPointerCount);
+    updateSnapshotInput(inputCodePoints, inputSize, inputXs, inputYs, maxPointerCount);
+    mSpatialCostCache.reset();
+}
+
+// Called after setupForGetSuggestions() with the same input.
+void DicTraverseSession::setupForCoarsePass(const int *inputCodePoints, const int inputSize,
+        const int *const inputXs, const int *const inputYs, const int *const times,
+        const int *const pointerIds, const float maxSpatialDistance) {
+    mCoarseProximityInfoState.initInputParams(0, maxSpatialDistance, mProximityInfo,
+            inputCodePoints, inputSize, inputXs, inputYs, times, pointerIds,
+            mMaxPointerCount == MAX_POINTER_COUNT_G, true /* samplesCoarsely */);
+    mIsInCoarsePass = true;
+    mInputSize += mCoarseProximityInfoState.size() - mProximityInfoStates[0].size();
+    mSpatialCostCache.reset();
+}
+
+// The words are those of the terminals of the first pass. When it found none, the second pass
+// is not restricted.
+void DicTraverseSession::endCoarsePass() {
+    const int terminalSize = min(MAX_RESULTS, static_cast<int>(mDicNodesCache.terminalSize()));
+    DicNode *terminals[MAX_RESULTS] = {}; // Avoiding variable length array
+    mDicNodesCache.getSortedTerminals(terminals, terminalSize);
+    DicNodeExpansionBuffer *const expansionBuffer = getExpansionBuffer(0);
+    mCandidatePaths.clear();
+    for (int i = 0; i < terminalSize; ++i) {
+        int codePoints[MAX_WORD_LENGTH];
+        mCandidatePaths.addWord(getOffsetDict(), getDicRootPos(), getDecodedNodeIndex(),
+                expansionBuffer->getChildrenCache(), expansionBuffer->getChildDicNodes(),
+                terminals[i]->getOutputCodePoints(codePoints), terminals[i]->getDepth());
+    }
+    mCandidatePaths.sort();
+    mIsInCoarsePass = false;
+    mInputSize -= mCoarseProximityInfoState.size() - mProximityInfoStates[0].size();
+    mSpatialCostCache.reset();
 }
 
 const uint8_t *DicTraverseSession::getOffsetDict() const {
@@ -99,23 +394,211 @@ int DicTraverseSession::getDictFlags() const {
     return mDictionary->getDictFlags();
 }
 
+const DecodedNodeIndex *DicTraverseSession::getDecodedNodeIndex() const {
+    return mDictionary->getDecodedNodeIndex();
+}
+
+const BigramListIndex *DicTraverseSession::getBigramListIndex() const {
+    return mDictionary->getBigramListIndex();
+}
+
+const ShortcutTable *DicTraverseSession::getShortcutTable() const {
+    return mDictionary->getShortcutTable();
+}
+
+void DicTraverseSession::addMemoryUsage(int *const usage) const {
+    usage[Dictionary::MEMORY_USAGE_SESSION_QUEUES] += mDicNodesCache.getMemorySize()
+            + mPrevWordChains.getMemorySize() + mTruncatedPrevWordChains.getMemorySize();
+    int cacheSize = mMultiBigramMap.getMemorySize() + mBigramProbabilityMap.getMemorySize()
+            + static_cast<int>(sizeof(mBigramPredictionCache) + sizeof(mSuggestionResultCache)
+                    + sizeof(mSpatialCostCache))
+            + mDicNodeSnapshots.getMemorySize();
+    int otherSize = static_cast<int>(sizeof(*this) - sizeof(mBigramPredictionCache)
+            - sizeof(mSuggestionResultCache) - sizeof(mSpatialCostCache))
+            + MemoryUtils::getVectorMemorySize(&mExpansionFrontier);
+    for (int i = 0; i < MAX_EXPANSION_WORKER_COUNT; ++i) {
+        cacheSize += mExpansionBuffers[i].getChildrenCache()->getMemorySize();
+        otherSize += mExpansionBuffers[i].getMemorySize();
+    }
+    for (int i = 0; i < MAX_POINTER_COUNT_G; ++i) {
+        otherSize += mProximityInfoStates[i].getMemorySize();
+    }
+    otherSize += mCoarseProximityInfoState.getMemorySize() + mCandidatePaths.getMemorySize();
+    usage[Dictionary::MEMORY_USAGE_SESSION_CACHES] += cacheSize;
+    usage[Dictionary::MEMORY_USAGE_SESSION_OTHERS] += otherSize;
+}
+
+// The search continues from the caches of a partially committed search with its previous word,
+// and commits at commitPoint, so its suggestions are not those of the query alone.
+int DicTraverseSession::getCachedSuggestions(const ProximityInfo *pInfo, const bool isGesture,
+        const int *const inputXs, const int *const inputYs, const int *const times,
+        const int *const pointerIds, const int *const inputCodePoints, const int inputSize,
+        const int commitPoint, int *const outWords, int *const outScores,
+        int *const outSpaceIndices, int *const outTypes) {
+    if (!USE_SUGGESTION_RESULT_CACHE || !mDictionary || commitPoint != 0 || mPartiallyCommited) {
+        mSuggestionResultCache.dropPendingQuery();
+        return NOT_AN_INDEX;
+    }
+    return mSuggestionResultCache.get(mDictionaryId, mProbabilityOverlayId,
+            pInfo ? pInfo->getId() : 0, mPrevWordPos, isGesture, mSearchProfile.getProfile(),
+            inputCodePoints, inputXs, inputYs, times, pointerIds, inputSize, outWords, outScores,
+            outSpaceIndices, outTypes);
+}
+
+// A cancelled search has no suggestions. The caches of the session are left to the last search,
+// so a query answered from the cache does not change the search that continues from them.
+void DicTraverseSession::cacheSuggestions(const int *const words, const int *const scores,
+        const int *const spaceIndices, const int *const types, const int count) {
+    if (isRequestCancelled()) {
+        mSuggestionResultCache.dropPendingQuery();
+        return;
+    }
+    mSuggestionResultCache.add(words, scores, spaceIndices, types, count);
+}
+
 void DicTraverseSession::resetCache(const int nextActiveCacheSize, const int maxWords) {
     mDicNodesCache.reset(nextActiveCacheSize, maxWords);
-    mMultiBigramMap.clear();
+    // The bigram maps are kept for the next keystrokes: they only depend on the dictionary.
     mPartiallyCommited = false;
 }
 
+// The frontiers kept for the next searches were pruned with the parameters of the previous
+// profile, so they are dropped when it changes.
+void DicTraverseSession::setSearchProfile(const int profile) {
+    const int previousProfile = mSearchProfile.getProfile();
+    mSearchProfile.setProfile(profile);
+    if (mSearchProfile.getProfile() != previousProfile) {
+        mDicNodesCache.clearCachedDicNodesForContinuousSuggestion();
+        mDicNodeSnapshots.clear();
+    }
+}
+
+/**
+ * Returns the deepest input index from which the search can resume with a snapshot of the
+ * previous searches, or NOT_AN_INDEX. Nodes within DicNodesCache::CACHE_BACK_LENGTH from the end
+ * of the input may change with the input size, so snapshots there are not used.
+ */
+int DicTraverseSession::getResumableSnapshotInputIndex() const {
+    if (!mUsesSnapshots || mPrevWordChains.isFull()) {
+        return NOT_AN_INDEX;
+    }
+    return mDicNodeSnapshots.getDeepestInputIndex(mInputSize - DicNodesCache::CACHE_BACK_LENGTH);
+}
+
+// The cache must have been reset before this call.
+void DicTraverseSession::resumeFromSnapshot(const int inputIndex) {
+    const int size = mDicNodeSnapshots.getSize(inputIndex);
+    for (int i = 0; i < size; ++i) {
+        mDicNodesCache.copyPushActive(mDicNodeSnapshots.getDicNodeAt(inputIndex, i));
+    }
+    mDicNodesCache.setInputIndexToResume(inputIndex);
+    if (DEBUG_CACHE) {
+        AKLOGI("Resume from the snapshot of %d nodes at inputIndex = %d.", size, inputIndex);
+    }
+}
+
+// Starts recording the frontier of the current input index if later searches may resume there.
+void DicTraverseSession::beginSnapshotIfNeeded() {
+    const int inputIndex = mDicNodesCache.getInputIndex();
+    if (mUsesSnapshots && inputIndex <= mInputSize - DicNodesCache::CACHE_BACK_LENGTH) {
+        mDicNodeSnapshots.beginSnapshot(inputIndex);
+    } else {
+        mDicNodeSnapshots.endSnapshot();
+    }
+}
+
+/**
+ * Drops the snapshots that do not match the new input and remembers the new input. The frontier
+ * of an input index has only consumed the points before it, so its snapshot stays valid as long
+ * as those points and the point of the index itself are unchanged. Typing another letter or
+ * deleting the last one resumes the search from a snapshot instead of the root. How deep a
+ * snapshot may be used also depends on the input size; see getResumableSnapshotInputIndex.
+ */
+void DicTraverseSession::updateSnapshotInput(const int *const inputCodePoints,
+        const int inputSize, const int *const inputXs, const int *const inputYs,
+        const int maxPointerCount) {
+    // TODO: this is a hack. Gesture input is resampled, so the input indices of dicNodes are not
+    // the indices of the raw input.
+    mUsesSnapshots = maxPointerCount != MAX_POINTER_COUNT_G && inputSize <= MAX_WORD_LENGTH;
+    if (!mUsesSnapshots) {
+        mDicNodeSnapshots.clear();
+        mSnapshotInputSize = 0;
+        return;
+    }
+    const bool hasCoordinates = inputXs && inputYs;
+    int commonLength = 0;
+    if (mSnapshotDictionary == mDictionary && mSnapshotProximityInfo == mProximityInfo
+            && mSnapshotPrevWordPos == mPrevWordPos && mSnapshotHasCoordinates == hasCoordinates) {
+        const int maxCommonLength = min(inputSize, mSnapshotInputSize);
+        while (commonLength < maxCommonLength
+                && inputCodePoints[commonLength] == mSnapshotInputCodePoints[commonLength]
+                && (!hasCoordinates || (inputXs[commonLength] == mSnapshotInputXs[commonLength]
+                        && inputYs[commonLength] == mSnapshotInputYs[commonLength]))) {
+            ++commonLength;
+        }
+    }
+    mDicNodeSnapshots.invalidateFrom(commonLength - 1);
+    for (int i = commonLength; i < inputSize; ++i) {
+        mSnapshotInputCodePoints[i] = inputCodePoints[i];
+        mSnapshotInputXs[i] = hasCoordinates ? inputXs[i] : NOT_A_COORDINATE;
+        mSnapshotInputYs[i] = hasCoordinates ? inputYs[i] : NOT_A_COORDINATE;
+    }
+    mSnapshotInputSize = inputSize;
+    mSnapshotHasCoordinates = hasCoordinates;
+    mSnapshotPrevWordPos = mPrevWordPos;
+    mSnapshotDictionary = mDictionary;
+    mSnapshotProximityInfo = mProximityInfo;
+}
+
+// Initializes the proximity info states of the pointers jobId, jobId + jobCount, and so on. The
+// states of the pointers are independent, so they can be initialized on different threads.
+class DicTraverseSession::ProximityInfoStatesJob : public ExpansionWorkerPool::Job {
+ public:
+    ProximityInfoStatesJob(DicTraverseSession *const traverseSession,
+            const int *const inputCodePoints, const int *const inputXs, const int *const inputYs,
+            const int *const times, const int *const pointerIds, const int inputSize,
+            const float maxSpatialDistance, const int maxPointerCount, const int jobCount)
+            : mTraverseSession(traverseSession), mInputCodePoints(inputCodePoints),
+              mInputXs(inputXs), mInputYs(inputYs), mTimes(times), mPointerIds(pointerIds),
+              mInputSize(inputSize), mMaxSpatialDistance(maxSpatialDistance),
+              mMaxPointerCount(maxPointerCount), mJobCount(jobCount) {}
+
+    void run(const int jobId) {
+        for (int i = jobId; i < mMaxPointerCount; i += mJobCount) {
+            mTraverseSession->mProximityInfoStates[i].initInputParams(i, mMaxSpatialDistance,
+                    mTraverseSession->getProximityInfo(), mInputCodePoints, mInputSize, mInputXs,
+                    mInputYs, mTimes, mPointerIds, mMaxPointerCount == MAX_POINTER_COUNT_G
+                    /* TODO: this is a hack. fix proximity info state */,
+                    false /* samplesCoarsely */);
+        }
+    }
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ProximityInfoStatesJob);
+    DicTraverseSession *const mTraverseSession;
+    const int *const mInputCodePoints;
+    const int *const mInputXs;
+    const int *const mInputYs;
+    const int *const mTimes;
+    const int *const mPointerIds;
+    const int mInputSize;
+    const float mMaxSpatialDistance;
+    const int mMaxPointerCount;
+    const int mJobCount;
+};
+
 void DicTraverseSession::initializeProximityInfoStates(const int *const inputCodePoints,
         const int *const inputXs, const int *const inputYs, const int *const times,
         const int *const pointerIds, const int inputSize, const float maxSpatialDistance,
         const int maxPointerCount) {
     ASSERT(1 <= maxPointerCount && maxPointerCount <= MAX_POINTER_COUNT_G);
+    const int jobCount = (USE_PARALLEL_EXPANSION && maxPointerCount > 1)
+            ? min(mExpansionWorkerPool.getMaxJobCount(), maxPointerCount) : 1;
+    ProximityInfoStatesJob job(this, inputCodePoints, inputXs, inputYs, times, pointerIds,
+            inputSize, maxSpatialDistance, maxPointerCount, jobCount);
+    mExpansionWorkerPool.runAndWait(&job, jobCount);
     mInputSize = 0;
     for (int i = 0; i < maxPointerCount; ++i) {
-        mProximityInfoStates[i].initInputParams(i, maxSpatialDistance, getProximityInfo(),
-                inputCodePoints, inputSize, inputXs, inputYs, times, pointerIds,
-                maxPointerCount == MAX_POINTER_COUNT_G
-                /* TODO: this is a hack. fix proximity info state */);
         mInputSize += mProximityInfoStates[i].size();
     }
 }
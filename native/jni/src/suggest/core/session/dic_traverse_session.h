@@ -20,42 +20,152 @@
 #include <stdint.h>
 #include <vector>
 
+#include "bigram_prediction_cache.h"
+#include "bigram_probability_map.h"
 #include "defines.h"
+#include "digraph_code_point_set.h"
 #include "jni.h"
 #include "multi_bigram_map.h"
 #include "proximity_info_state.h"
+#include "suggest/core/dicnode/dic_node_expansion_buffer.h"
+#include "suggest/core/dicnode/dic_node_prev_word_chains.h"
+#include "suggest/core/dicnode/dic_node_snapshots.h"
+#include "suggest/core/session/adaptive_beam_controller.h"
+#include "suggest/core/session/candidate_path_set.h"
 #include "suggest/core/dicnode/dic_nodes_cache.h"
+#include "suggest/core/session/expansion_worker_pool.h"
+#include "suggest/core/session/latency_histogram.h"
+#include "suggest/core/session/progressive_results.h"
+#include "suggest/core/session/search_profile.h"
+#include "suggest/core/session/search_statistics.h"
+#include "suggest/core/session/spatial_cost_cache.h"
+#include "suggest/core/session/suggestion_result_cache.h"
 
 namespace latinime {
 
+class BigramListIndex;
+class DecodedNodeIndex;
 class Dictionary;
+class ProbabilityOverlay;
 class ProximityInfo;
+class ShortcutTable;
 
+// Holds all the mutable state of a suggestion call, so that one dictionary can serve several
+// threads with a session each. A session must only be used by one thread at a time.
 class DicTraverseSession {
  public:
     AK_FORCE_INLINE DicTraverseSession(JNIEnv *env, jstring localeStr)
-            : mPrevWordPos(NOT_VALID_WORD), mProximityInfo(0),
-              mDictionary(0), mDicNodesCache(), mMultiBigramMap(),
-              mInputSize(0), mPartiallyCommited(false), mMaxPointerCount(1),
-              mMultiWordCostMultiplier(1.0f) {
-        // NOTE: mProximityInfoStates is an array of instances.
-        // No need to initialize it explicitly here.
+            : mPrevWordPos(NOT_VALID_WORD), mProximityInfo(0), mDictionary(0), mDictionaryId(0),
+              mAttachedProbabilityOverlay(0), mProbabilityOverlay(0), mProbabilityOverlayId(0),
+              mSearchStatistics(), mLatencyHistogram(), mDicNodesCache(&mSearchStatistics),
+              mPrevWordChains(), mTruncatedPrevWordChains(), mMultiBigramMap(&mSearchStatistics),
+              mBigramProbabilityMap(), mBigramPredictionCache(&mSearchStatistics),
+              mSuggestionResultCache(&mSearchStatistics), mSpatialCostCache(),
+              mDigraphCodePoints(), mCoarseProximityInfoState(), mIsInCoarsePass(false),
+              mCandidatePaths(), mInputSize(0), mPartiallyCommited(false), mMaxPointerCount(1),
+              mMultiWordCostMultiplier(1.0f), mExpansionWorkerPool(), mExpansionFrontier(),
+              mDicNodeSnapshots(), mSnapshotInputCodePoints(), mSnapshotInputXs(),
+              mSnapshotInputYs(), mSnapshotInputSize(0), mSnapshotHasCoordinates(false),
+              mSnapshotPrevWordPos(NOT_VALID_WORD), mSnapshotDictionary(0),
+              mSnapshotProximityInfo(0), mUsesSnapshots(false), mAdaptiveBeamController(),
+              mSearchProfile(), mRequestTicket(NOT_A_REQUEST_TICKET),
+              mCancelledRequestTicket(NOT_A_REQUEST_TICKET), mProgressiveResults() {
+        // NOTE: mProximityInfoStates and mExpansionBuffers are arrays of instances.
+        // No need to initialize them explicitly here.
     }
 
     // Non virtual inline destructor -- never inherit this class
     AK_FORCE_INLINE ~DicTraverseSession() {}
 
     void init(const Dictionary *dictionary, const int *prevWord, int prevWordLength);
+    // Drops the state of the Java session that released this one, keeping the buffers, before it
+    // is pooled for the next Java session.
+    void resetForReuse();
     // TODO: Remove and merge into init
     void setupForGetSuggestions(const ProximityInfo *pInfo, const int *inputCodePoints,
             const int inputSize, const int *const inputXs, const int *const inputYs,
             const int *const times, const int *const pointerIds, const float maxSpatialDistance,
             const int maxPointerCount);
     void resetCache(const int nextActiveCacheSize, const int maxWords);
+    // Adds the bytes of the session to the MEMORY_USAGE_SESSION_* categories of usage, see
+    // Dictionary. The stacks of the expansion workers are not counted.
+    void addMemoryUsage(int *const usage) const;
+
+    // Incremental search
+    int getResumableSnapshotInputIndex() const;
+    void resumeFromSnapshot(const int inputIndex);
+    void beginSnapshotIfNeeded();
+    void invalidateSnapshots() { mDicNodeSnapshots.clear(); }
+    // The snapshots share the chains, so they are dropped with them.
+    void clearPrevWordChains() {
+        mPrevWordChains.clear();
+        mDicNodeSnapshots.clear();
+    }
+    DicNodeSnapshots *getDicNodeSnapshots() { return &mDicNodeSnapshots; }
+
+    // Two-pass search. The first pass searches the input of the first pointer sampled coarsely,
+    // from setupForCoarsePass() to endCoarsePass(), which restricts the second pass on the input
+    // of setupForGetSuggestions() to the paths of the words it found.
+    void setupForCoarsePass(const int *inputCodePoints, const int inputSize,
+            const int *const inputXs, const int *const inputYs, const int *const times,
+            const int *const pointerIds, const float maxSpatialDistance);
+    void endCoarsePass();
+    bool hasCandidatePaths() const { return !mCandidatePaths.isEmpty(); }
+    AK_FORCE_INLINE bool isOnCandidatePath(const DicNode *const dicNode) const {
+        return mCandidatePaths.contains(dicNode);
+    }
+
+    // Latency budget
+    void setLatencyBudgetMs(const int latencyBudgetMs) {
+        mAdaptiveBeamController.setLatencyBudgetMs(latencyBudgetMs);
+    }
+    AdaptiveBeamController *getAdaptiveBeamController() { return &mAdaptiveBeamController; }
+
+    // Probability overlay. The queries started after this use overlay, which may be 0, on the
+    // dictionary it was created for. The session does not own it.
+    void setProbabilityOverlay(const ProbabilityOverlay *const overlay) {
+        mAttachedProbabilityOverlay = overlay;
+    }
+
+    // Search profile
+    void setSearchProfile(const int profile);
+    const SearchProfile *getSearchProfile() const { return &mSearchProfile; }
+
+    // Cancellation. The ticket is set by the thread that runs the request, and the request may be
+    // cancelled from any thread while it runs.
+    void setRequestTicket(const int ticket) { mRequestTicket = ticket; }
+    void cancelRequest(const int ticket) { mCancelledRequestTicket = ticket; }
+    bool isRequestCancelled() const {
+        return mRequestTicket != NOT_A_REQUEST_TICKET && mRequestTicket == mCancelledRequestTicket;
+    }
+    int getRequestTicket() const { return mRequestTicket; }
+
+    // Progressive results. The results published by the running request are read from any
+    // thread.
+    void setProgressiveInterval(const int inputIndexCount, const int intervalMs) {
+        mProgressiveResults.setInterval(inputIndexCount, intervalMs);
+    }
+    ProgressiveResults *getProgressiveResults() { return &mProgressiveResults; }
+
+    // Suggestion results. Called after init() with the arguments of Dictionary::getSuggestions:
+    // returns the count of the cached suggestions of the query, or NOT_AN_INDEX to search them,
+    // in which case the search passes them to cacheSuggestions().
+    int getCachedSuggestions(const ProximityInfo *pInfo, const bool isGesture,
+            const int *const inputXs, const int *const inputYs, const int *const times,
+            const int *const pointerIds, const int *const inputCodePoints, const int inputSize,
+            const int commitPoint, int *const outWords, int *const outScores,
+            int *const outSpaceIndices, int *const outTypes);
+    void cacheSuggestions(const int *const words, const int *const scores,
+            const int *const spaceIndices, const int *const types, const int count);
 
     // TODO: Remove
     const uint8_t *getOffsetDict() const;
     int getDictFlags() const;
+    const DecodedNodeIndex *getDecodedNodeIndex() const;
+    const BigramListIndex *getBigramListIndex() const;
+    const ShortcutTable *getShortcutTable() const;
+    // The overlay of the query, or 0 if none is attached or it is for another dictionary.
+    const ProbabilityOverlay *getProbabilityOverlay() const { return mProbabilityOverlay; }
 
     //--------------------
     // getters and setters
@@ -67,9 +177,25 @@ class DicTraverseSession {
     // TODO: Use proper parameter when changed
     int getDicRootPos() const { return 0; }
     DicNodesCache *getDicTraverseCache() { return &mDicNodesCache; }
+    DicNodePrevWordChains *getPrevWordChains() { return &mPrevWordChains; }
+    DicNodePrevWordChains *getTruncatedPrevWordChains() { return &mTruncatedPrevWordChains; }
+    SearchStatistics *getSearchStatistics() { return &mSearchStatistics; }
+    LatencyHistogram *getLatencyHistogram() { return &mLatencyHistogram; }
     MultiBigramMap *getMultiBigramMap() { return &mMultiBigramMap; }
+    BigramProbabilityMap *getBigramProbabilityMap() { return &mBigramProbabilityMap; }
+    BigramPredictionCache *getBigramPredictionCache() { return &mBigramPredictionCache; }
+    // The policies only get a const session, and fill the cache while they weight the dicNodes.
+    SpatialCostCache *getSpatialCostCache() const { return &mSpatialCostCache; }
+    const DigraphCodePointSet *getDigraphCodePoints() const { return &mDigraphCodePoints; }
+    ExpansionWorkerPool *getExpansionWorkerPool() { return &mExpansionWorkerPool; }
+    DicNodeExpansionBuffer *getExpansionBuffer(const int jobId) {
+        ASSERT(jobId >= 0 && jobId < MAX_EXPANSION_WORKER_COUNT);
+        return &mExpansionBuffers[jobId];
+    }
+    std::vector<DicNode> *getExpansionFrontier() { return &mExpansionFrontier; }
     const ProximityInfoState *getProximityInfoState(int id) const {
-        return &mProximityInfoStates[id];
+        return (mIsInCoarsePass && id == 0)
+                ? &mCoarseProximityInfoState : &mProximityInfoStates[id];
     }
     int getInputSize() const { return mInputSize; }
     void setPartiallyCommited() { mPartiallyCommited = true; }
@@ -92,27 +218,27 @@ class DicTraverseSession {
         return true;
     }
 
-    void getSearchKeys(const DicNode *node, std::vector<int> *const outputSearchKeyVector) const {
+    // The search keys of the input indices of node for all of the pointers, as a mask of key
+    // indices.
+    uint64_t getSearchKeys(const DicNode *node) const {
+        uint64_t searchKeys = 0;
         for (int i = 0; i < MAX_POINTER_COUNT_G; ++i) {
-            if (!mProximityInfoStates[i].isUsed()) {
+            if (!getProximityInfoState(i)->isUsed()) {
                 continue;
             }
-            const int pointerId = node->getInputIndex(i);
-            const std::vector<int> *const searchKeyVector =
-                    mProximityInfoStates[i].getSearchKeyVector(pointerId);
-            outputSearchKeyVector->insert(outputSearchKeyVector->end(), searchKeyVector->begin(),
-                    searchKeyVector->end());
+            searchKeys |= getProximityInfoState(i)->getSearchKeys(node->getInputIndex(i));
         }
+        return searchKeys;
     }
 
     ProximityType getProximityTypeG(const DicNode *const node, const int childCodePoint) const {
         ProximityType proximityType = UNRELATED_CHAR;
         for (int i = 0; i < MAX_POINTER_COUNT_G; ++i) {
-            if (!mProximityInfoStates[i].isUsed()) {
+            if (!getProximityInfoState(i)->isUsed()) {
                 continue;
             }
             const int pointerId = node->getInputIndex(i);
-            proximityType = mProximityInfoStates[i].getProximityTypeG(pointerId, childCodePoint);
+            proximityType = getProximityInfoState(i)->getProximityTypeG(pointerId, childCodePoint);
             ASSERT(proximityType == UNRELATED_CHAR || proximityType == MATCH_CHAR);
             // TODO: Make this more generic
             // Currently we assume there are only two types here -- UNRELATED_CHAR
@@ -133,7 +259,8 @@ class DicTraverseSession {
      */
     // TODO: Remove. No need to check once the session is fully implemented.
     bool isContinuousSuggestionPossible() const {
-        if (!mDicNodesCache.hasCachedDicNodesForContinuousSuggestion()) {
+        if (!mDicNodesCache.hasCachedDicNodesForContinuousSuggestion()
+                || mPrevWordChains.isFull()) {
             return false;
         }
         ASSERT(mMaxPointerCount <= MAX_POINTER_COUNT_G);
@@ -158,20 +285,52 @@ class DicTraverseSession {
 
  private:
     DISALLOW_IMPLICIT_CONSTRUCTORS(DicTraverseSession);
+    class ProximityInfoStatesJob;
+
     // threshold to start caching
     static const int CACHE_START_INPUT_LENGTH_THRESHOLD;
     void initializeProximityInfoStates(const int *const inputCodePoints, const int *const inputXs,
             const int *const inputYs, const int *const times, const int *const pointerIds,
             const int inputSize, const float maxSpatialDistance, const int maxPointerCount);
+    void updateSnapshotInput(const int *const inputCodePoints, const int inputSize,
+            const int *const inputXs, const int *const inputYs, const int maxPointerCount);
 
     int mPrevWordPos;
     const ProximityInfo *mProximityInfo;
     const Dictionary *mDictionary;
+    // The id of the dictionary the caches of the session were filled from, or 0 if none.
+    int mDictionaryId;
+    const ProbabilityOverlay *mAttachedProbabilityOverlay;
+    const ProbabilityOverlay *mProbabilityOverlay;
+    // The id of the overlay the costs of the cached dicNodes were computed with, or 0 if none.
+    int mProbabilityOverlayId;
 
+    // Declared before mDicNodesCache and the bigram caches, which count into it
+    SearchStatistics mSearchStatistics;
+    LatencyHistogram mLatencyHistogram;
     DicNodesCache mDicNodesCache;
-    // Temporary cache for bigram frequencies
+    // The previous words of the multi-word dicNodes of the caches and the snapshots
+    DicNodePrevWordChains mPrevWordChains;
+    // Where the chains are truncated at a partial commit, empty otherwise
+    DicNodePrevWordChains mTruncatedPrevWordChains;
+    // Cache for bigram frequencies, across the keystrokes
     MultiBigramMap mMultiBigramMap;
+    // Bigrams of the previous word for the suggestions without the suggest interface
+    BigramProbabilityMap mBigramProbabilityMap;
+    // Predictions of the last previous words, across the calls
+    BigramPredictionCache mBigramPredictionCache;
+    // Suggestions of the last queries, across the calls
+    SuggestionResultCache mSuggestionResultCache;
+    // Spatial costs of the current query
+    mutable SpatialCostCache mSpatialCostCache;
+    // The code points of the digraphs of the dictionary
+    DigraphCodePointSet mDigraphCodePoints;
     ProximityInfoState mProximityInfoStates[MAX_POINTER_COUNT_G];
+    // Replaces the state of the first pointer during the first pass of a two-pass search
+    ProximityInfoState mCoarseProximityInfoState;
+    bool mIsInCoarsePass;
+    // The paths the second pass of a two-pass search expands, empty for a single pass
+    CandidatePathSet mCandidatePaths;
 
     int mInputSize;
     bool mPartiallyCommited;
@@ -181,6 +340,39 @@ class DicTraverseSession {
     // Configuration per dictionary
     float mMultiWordCostMultiplier;
 
+    /////////////////////////////////
+    // Parallel frontier expansion
+    ExpansionWorkerPool mExpansionWorkerPool;
+    DicNodeExpansionBuffer mExpansionBuffers[MAX_EXPANSION_WORKER_COUNT];
+    // Active nodes popped for the current input index
+    std::vector<DicNode> mExpansionFrontier;
+
+    /////////////////////////////////
+    // Incremental search
+    DicNodeSnapshots mDicNodeSnapshots;
+    // The input of the last search, for which the snapshots were taken
+    int mSnapshotInputCodePoints[MAX_WORD_LENGTH];
+    int mSnapshotInputXs[MAX_WORD_LENGTH];
+    int mSnapshotInputYs[MAX_WORD_LENGTH];
+    int mSnapshotInputSize;
+    bool mSnapshotHasCoordinates;
+    int mSnapshotPrevWordPos;
+    const Dictionary *mSnapshotDictionary;
+    const ProximityInfo *mSnapshotProximityInfo;
+    bool mUsesSnapshots;
+
+    // Adapts the beam width to the latency budget set through the session
+    AdaptiveBeamController mAdaptiveBeamController;
+    // Scales the search parameters of the policies
+    SearchProfile mSearchProfile;
+
+    // The ticket of the running request, or NOT_A_REQUEST_TICKET for a synchronous call
+    int mRequestTicket;
+    // Written by another thread, hence volatile. Tickets are never reused, so a late cancellation
+    // of a finished request does not affect the next one.
+    volatile int mCancelledRequestTicket;
+    // The suggestions published while the request runs
+    ProgressiveResults mProgressiveResults;
 };
 } // namespace latinime
 #endif // LATINIME_DIC_TRAVERSE_SESSION_H
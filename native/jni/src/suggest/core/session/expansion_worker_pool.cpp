@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "LatinIME: expansion_worker_pool.cpp"
+
+#include "suggest/core/session/expansion_worker_pool.h"
+
+#include "defines.h"
+#include "thread_placement.h"
+
+namespace latinime {
+
+ExpansionWorkerPool::ExpansionWorkerPool()
+        : mMutex(), mJobReadyCond(), mJobDoneCond(), mThreads(), mWorkerArgs(),
+          mHasTriedToStartWorkers(false), mWorkerCount(0), mJob(0), mJobCount(0),
+          mJobGeneration(0), mPendingJobCount(0), mIsTerminating(false) {
+    pthread_mutex_init(&mMutex, 0);
+    pthread_cond_init(&mJobReadyCond, 0);
+    pthread_cond_init(&mJobDoneCond, 0);
+}
+
+ExpansionWorkerPool::~ExpansionWorkerPool() {
+    pthread_mutex_lock(&mMutex);
+    mIsTerminating = true;
+    pthread_cond_broadcast(&mJobReadyCond);
+    pthread_mutex_unlock(&mMutex);
+    for (int i = 0; i < mWorkerCount; ++i) {
+        pthread_join(mThreads[i], 0);
+    }
+    pthread_cond_destroy(&mJobDoneCond);
+    pthread_cond_destroy(&mJobReadyCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+int ExpansionWorkerPool::getMaxJobCount() {
+    if (!mHasTriedToStartWorkers) {
+        startWorkers();
+    }
+    return mWorkerCount + 1;
+}
+
+void ExpansionWorkerPool::runAndWait(Job *const job, const int jobCount) {
+    ASSERT(jobCount > 0 && jobCount <= getMaxJobCount());
+    if (jobCount == 1) {
+        job->run(0);
+        return;
+    }
+    pthread_mutex_lock(&mMutex);
+    mJob = job;
+    mJobCount = jobCount;
+    mPendingJobCount = jobCount - 1;
+    ++mJobGeneration;
+    pthread_cond_broadcast(&mJobReadyCond);
+    pthread_mutex_unlock(&mMutex);
+
+    job->run(0);
+
+    pthread_mutex_lock(&mMutex);
+    while (mPendingJobCount > 0) {
+        pthread_cond_wait(&mJobDoneCond, &mMutex);
+    }
+    mJob = 0;
+    pthread_mutex_unlock(&mMutex);
+}
+
+/* static */ void *ExpansionWorkerPool::workerMain(void *args) {
+    WorkerArgs *const workerArgs = static_cast<WorkerArgs *>(args);
+    workerArgs->mPool->runWorker(workerArgs->mJobId);
+    return 0;
+}
+
+void ExpansionWorkerPool::startWorkers() {
+    mHasTriedToStartWorkers = true;
+    for (int i = 0; i < MAX_EXPANSION_WORKER_COUNT - 1; ++i) {
+        mWorkerArgs[i].mPool = this;
+        mWorkerArgs[i].mJobId = i + 1;
+        // The callers wait for the workers, so they are on the critical path of the search.
+        if (!ThreadPlacement::createThread(&mThreads[i],
+                ThreadPlacement::THREAD_CLASS_LATENCY_CRITICAL, workerMain, &mWorkerArgs[i])) {
+            AKLOGE("Cannot create a worker thread. %d workers are available.", mWorkerCount);
+            break;
+        }
+        ++mWorkerCount;
+    }
+}
+
+void ExpansionWorkerPool::runWorker(const int jobId) {
+    int lastJobGeneration = 0;
+    pthread_mutex_lock(&mMutex);
+    while (true) {
+        while (!mIsTerminating && mJobGeneration == lastJobGeneration) {
+            pthread_cond_wait(&mJobReadyCond, &mMutex);
+        }
+        if (mIsTerminating) {
+            break;
+        }
+        lastJobGeneration = mJobGeneration;
+        if (jobId >= mJobCount) {
+            continue;
+        }
+        Job *const job = mJob;
+        pthread_mutex_unlock(&mMutex);
+        job->run(jobId);
+        pthread_mutex_lock(&mMutex);
+        --mPendingJobCount;
+        if (mPendingJobCount == 0) {
+            pthread_cond_signal(&mJobDoneCond);
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+} // namespace latinime
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LATINIME_EXPANSION_WORKER_POOL_H
+#define LATINIME_EXPANSION_WORKER_POOL_H
+
+#include <pthread.h>
+
+#include "defines.h"
+
+namespace latinime {
+
+// A small pool of threads to run one job on several workers at a time. The threads are created
+// on the first use and live as long as the pool.
+class ExpansionWorkerPool {
+ public:
+    class Job {
+     public:
+        Job() {}
+        virtual ~Job() {}
+        virtual void run(const int jobId) = 0;
+
+     private:
+        DISALLOW_COPY_AND_ASSIGN(Job);
+    };
+
+    ExpansionWorkerPool();
+    // Non virtual destructor -- never inherit this class
+    ~ExpansionWorkerPool();
+
+    // Returns how many jobs can run at a time. This is smaller than MAX_EXPANSION_WORKER_COUNT
+    // when worker threads could not be created.
+    int getMaxJobCount();
+
+    // Runs job->run(jobId) for every jobId in [0, jobCount) and returns when all have finished.
+    // The job 0 runs on the calling thread.
+    void runAndWait(Job *const job, const int jobCount);
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(ExpansionWorkerPool);
+
+    struct WorkerArgs {
+        ExpansionWorkerPool *mPool;
+        int mJobId;
+    };
+
+    static void *workerMain(void *args);
+    void startWorkers();
+    void runWorker(const int jobId);
+
+    pthread_mutex_t mMutex;
+    pthread_cond_t mJobReadyCond;
+    pthread_cond_t mJobDoneCond;
+    pthread_t mThreads[MAX_EXPANSION_WORKER_COUNT - 1];
+    WorkerArgs mWorkerArgs[MAX_EXPANSION_WORKER_COUNT - 1];
+    bool mHasTriedToStartWorkers;
+    int mWorkerCount;
+    Job *mJob;
+    int mJobCount;
+    int mJobGeneration;
+    int mPendingJobCount;
+    bool mIsTerminating;
+};
+} // namespace latinime
+#endif // LATINIME_EXPANSION_WORKER_POOL_H
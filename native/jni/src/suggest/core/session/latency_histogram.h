@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_LATENCY_HISTOGRAM_H
+#define LATINIME_LATENCY_HISTOGRAM_H
+
+#include <cstring>
+#include <stdint.h>
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * The latencies of the getSuggestions calls of a session, as measured natively, accumulated until
+ * they are reset. The calls are split by input type and by input size class, and their latencies
+ * in microseconds are counted in log-scaled buckets of LATENCY_SUB_BUCKET_COUNT buckets per power
+ * of two, so that the relative error of a percentile is bounded at any scale.
+ */
+class LatencyHistogram {
+ public:
+    // Taken from BinaryDictionary.java
+    static const int LATENCY_INPUT_TYPE_TYPING = 0;
+    static const int LATENCY_INPUT_TYPE_GESTURE = 1;
+    static const int LATENCY_INPUT_TYPE_COUNT = 2;
+    // The class of an input size is its bit length, up to LATENCY_INPUT_SIZE_CLASS_COUNT - 1:
+    // 0, 1, 2-3, 4-7, ..., 64 and more.
+    static const int LATENCY_INPUT_SIZE_CLASS_COUNT = 8;
+    static const int LATENCY_SUB_BUCKET_COUNT = 4;
+    // The last bucket starts at 7 * 2^22 us, about 29 s, and has all the longer latencies.
+    static const int LATENCY_BUCKET_COUNT = 96;
+    static const int LATENCY_HISTOGRAM_SIZE =
+            LATENCY_INPUT_TYPE_COUNT * LATENCY_INPUT_SIZE_CLASS_COUNT * LATENCY_BUCKET_COUNT;
+
+    AK_FORCE_INLINE LatencyHistogram() : mCounts() {}
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~LatencyHistogram() {}
+
+    AK_FORCE_INLINE void reset() {
+        memset(mCounts, 0, sizeof(mCounts));
+    }
+
+    AK_FORCE_INLINE void record(const bool isGesture, const int inputSize,
+            const int64_t durationNs) {
+        const int inputType = isGesture ? LATENCY_INPUT_TYPE_GESTURE : LATENCY_INPUT_TYPE_TYPING;
+        ++mCounts[getIndex(inputType, getInputSizeClass(inputSize),
+                getBucket(durationNs / 1000))];
+    }
+
+    // Adds the counts to the LATENCY_HISTOGRAM_SIZE elements of outCounts, ordered by input type,
+    // then input size class, then bucket.
+    AK_FORCE_INLINE void addTo(int *const outCounts) const {
+        for (int i = 0; i < LATENCY_HISTOGRAM_SIZE; ++i) {
+            outCounts[i] += mCounts[i];
+        }
+    }
+
+    static AK_FORCE_INLINE int getInputSizeClass(const int inputSize) {
+        int inputSizeClass = 0;
+        for (int size = inputSize; size > 0 && inputSizeClass < LATENCY_INPUT_SIZE_CLASS_COUNT - 1;
+                size >>= 1) {
+            ++inputSizeClass;
+        }
+        return inputSizeClass;
+    }
+
+    // The buckets below LATENCY_SUB_BUCKET_COUNT us are 1 us wide. Above, the power of two range
+    // of the latency is split in LATENCY_SUB_BUCKET_COUNT buckets.
+    static AK_FORCE_INLINE int getBucket(const int64_t durationUs) {
+        if (durationUs < LATENCY_SUB_BUCKET_COUNT) {
+            return durationUs < 0 ? 0 : static_cast<int>(durationUs);
+        }
+        int exponent = 0;
+        while ((durationUs >> (exponent + 1)) > 0) {
+            ++exponent;
+        }
+        // exponent >= 2 here: the two bits below the leading one pick the sub bucket.
+        const int bucket = (exponent - 1) * LATENCY_SUB_BUCKET_COUNT
+                + static_cast<int>((durationUs >> (exponent - 2)) & (LATENCY_SUB_BUCKET_COUNT - 1));
+        return bucket < LATENCY_BUCKET_COUNT ? bucket : LATENCY_BUCKET_COUNT - 1;
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(LatencyHistogram);
+
+    static AK_FORCE_INLINE int getIndex(const int inputType, const int inputSizeClass,
+            const int bucket) {
+        return (inputType * LATENCY_INPUT_SIZE_CLASS_COUNT + inputSizeClass)
+                * LATENCY_BUCKET_COUNT + bucket;
+    }
+
+    int mCounts[LATENCY_HISTOGRAM_SIZE];
+};
+} // namespace latinime
+#endif // LATINIME_LATENCY_HISTOGRAM_H
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "suggest/core/session/progressive_results.h"
+
+#include <cstring>
+#include <time.h>
+
+namespace latinime {
+
+const int ProgressiveResults::NO_INTERVAL = 0;
+
+ProgressiveResults::ProgressiveResults()
+        : mInputIndexCount(NO_INTERVAL), mIntervalUs(NO_INTERVAL), mStepCount(0),
+          mLastPublicationTimeUs(0), mOutputCodePoints(), mOutputScores(), mOutputSpaceIndices(),
+          mOutputTypes(), mMutex(), mPublishedTicket(NOT_A_REQUEST_TICKET), mPublishedCount(0),
+          mPublishedCodePoints(), mPublishedScores(), mPublishedSpaceIndices(),
+          mPublishedTypes() {
+    pthread_mutex_init(&mMutex, 0);
+}
+
+bool ProgressiveResults::start(const int ticket) {
+    pthread_mutex_lock(&mMutex);
+    mPublishedTicket = ticket;
+    mPublishedCount = 0;
+    pthread_mutex_unlock(&mMutex);
+    if (ticket == NOT_A_REQUEST_TICKET
+            || (mInputIndexCount == NO_INTERVAL && mIntervalUs == NO_INTERVAL)) {
+        return false;
+    }
+    mStepCount = 0;
+    mLastPublicationTimeUs = mIntervalUs != NO_INTERVAL ? getCurrentTimeUs() : 0;
+    return true;
+}
+
+bool ProgressiveResults::isPublicationDue() {
+    ++mStepCount;
+    if (mInputIndexCount != NO_INTERVAL && mStepCount >= mInputIndexCount) {
+        return true;
+    }
+    return mIntervalUs != NO_INTERVAL
+            && getCurrentTimeUs() - mLastPublicationTimeUs >= mIntervalUs;
+}
+
+void ProgressiveResults::publish(const int count) {
+    pthread_mutex_lock(&mMutex);
+    memcpy(mPublishedCodePoints, mOutputCodePoints,
+            count * MAX_WORD_LENGTH * sizeof(mPublishedCodePoints[0]));
+    memcpy(mPublishedScores, mOutputScores, count * sizeof(mPublishedScores[0]));
+    memcpy(mPublishedSpaceIndices, mOutputSpaceIndices,
+            count * sizeof(mPublishedSpaceIndices[0]));
+    memcpy(mPublishedTypes, mOutputTypes, count * sizeof(mPublishedTypes[0]));
+    mPublishedCount = count;
+    pthread_mutex_unlock(&mMutex);
+    mStepCount = 0;
+    if (mIntervalUs != NO_INTERVAL) {
+        mLastPublicationTimeUs = getCurrentTimeUs();
+    }
+}
+
+int ProgressiveResults::getPublishedResults(const int ticket, int *const outCodePoints,
+        int *const outScores, int *const outSpaceIndices, int *const outTypes) {
+    pthread_mutex_lock(&mMutex);
+    const int count = (ticket != NOT_A_REQUEST_TICKET && ticket == mPublishedTicket)
+            ? mPublishedCount : 0;
+    memcpy(outCodePoints, mPublishedCodePoints, count * MAX_WORD_LENGTH * sizeof(outCodePoints[0]));
+    memcpy(outScores, mPublishedScores, count * sizeof(outScores[0]));
+    memcpy(outSpaceIndices, mPublishedSpaceIndices, count * sizeof(outSpaceIndices[0]));
+    memcpy(outTypes, mPublishedTypes, count * sizeof(outTypes[0]));
+    pthread_mutex_unlock(&mMutex);
+    return count;
+}
+
+/* static */ int64_t ProgressiveResults::getCurrentTimeUs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000LL + now.tv_nsec / 1000;
+}
+} // namespace latinime
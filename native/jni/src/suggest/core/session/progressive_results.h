@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_PROGRESSIVE_RESULTS_H
+#define LATINIME_PROGRESSIVE_RESULTS_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * The suggestions of the terminals found so far by the running request of a session. The search
+ * writes them to the output buffers and publishes them every few input indices or milliseconds
+ * while it continues, so that another thread can show them before the search completes. Only the
+ * published results are shared, under the lock; the rest belongs to the thread of the search.
+ */
+class ProgressiveResults {
+ public:
+    static const int NO_INTERVAL;
+
+    ProgressiveResults();
+
+    // Non virtual inline destructor -- never inherit this class
+    ~ProgressiveResults() {
+        pthread_mutex_destroy(&mMutex);
+    }
+
+    // The results are published after inputIndexCount input indices or intervalMs milliseconds,
+    // whichever comes first. NO_INTERVAL for both, the default, disables the publication.
+    void setInterval(const int inputIndexCount, const int intervalMs) {
+        mInputIndexCount = max(inputIndexCount, NO_INTERVAL);
+        mIntervalUs = max(intervalMs, NO_INTERVAL) * 1000LL;
+    }
+
+    // Starts the search of the request with ticket, which drops the results published for the
+    // previous one. Returns whether the search should publish its results: synchronous calls,
+    // which have no ticket, do not.
+    bool start(const int ticket);
+
+    // Called after each input index. Returns whether the results are due.
+    bool isPublicationDue();
+
+    // The buffers the search writes the results to, as the output of Dictionary::getSuggestions.
+    int *getOutputCodePoints() { return mOutputCodePoints; }
+    int *getOutputScores() { return mOutputScores; }
+    int *getOutputSpaceIndices() { return mOutputSpaceIndices; }
+    int *getOutputTypes() { return mOutputTypes; }
+
+    // Publishes the count results of the output buffers.
+    void publish(const int count);
+
+    // Copies the results last published for the request with ticket to the arrays, which have
+    // the sizes of the output buffers, and returns their count, or 0 if there are none.
+    int getPublishedResults(const int ticket, int *const outCodePoints, int *const outScores,
+            int *const outSpaceIndices, int *const outTypes);
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(ProgressiveResults);
+
+    static int64_t getCurrentTimeUs();
+
+    int mInputIndexCount;
+    int64_t mIntervalUs;
+    // Since the last publication or the start of the search
+    int mStepCount;
+    int64_t mLastPublicationTimeUs;
+
+    int mOutputCodePoints[MAX_RESULTS * MAX_WORD_LENGTH];
+    int mOutputScores[MAX_RESULTS];
+    int mOutputSpaceIndices[MAX_RESULTS];
+    int mOutputTypes[MAX_RESULTS];
+
+    // Guards the published results, which are read from other threads.
+    pthread_mutex_t mMutex;
+    int mPublishedTicket;
+    int mPublishedCount;
+    int mPublishedCodePoints[MAX_RESULTS * MAX_WORD_LENGTH];
+    int mPublishedScores[MAX_RESULTS];
+    int mPublishedSpaceIndices[MAX_RESULTS];
+    int mPublishedTypes[MAX_RESULTS];
+};
+} // namespace latinime
+#endif // LATINIME_PROGRESSIVE_RESULTS_H
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "suggest/core/session/search_profile.h"
+
+#include "suggest/core/dicnode/dic_node_priority_queue.h"
+
+namespace latinime {
+
+const int SearchProfile::MIN_CACHE_SIZE = MIN_ADAPTIVE_BEAM_WIDTH;
+const int SearchProfile::MAX_CACHE_SIZE = MAX_DIC_NODE_PRIORITY_QUEUE_CAPACITY;
+const float SearchProfile::BATTERY_SAVER_CACHE_SIZE_RATE = 0.5f;
+const float SearchProfile::BATTERY_SAVER_ERROR_CORRECTION_THRESHOLD_RATE = 0.75f;
+const float SearchProfile::HIGH_QUALITY_CACHE_SIZE_RATE = 1.6f;
+const float SearchProfile::HIGH_QUALITY_ERROR_CORRECTION_THRESHOLD_RATE = 1.5f;
+
+void SearchProfile::setProfile(const int profile) {
+    switch (profile) {
+        case SEARCH_PROFILE_BATTERY_SAVER:
+            mProfile = profile;
+            mCacheSizeRate = BATTERY_SAVER_CACHE_SIZE_RATE;
+            mErrorCorrectionThresholdRate = BATTERY_SAVER_ERROR_CORRECTION_THRESHOLD_RATE;
+            // Each terminal starts a next word for the multiple word suggestions. The look-ahead
+            // corrections are kept: the insertions and transpositions they find are common.
+            mAllowsMultipleWords = false;
+            break;
+        case SEARCH_PROFILE_HIGH_QUALITY:
+            mProfile = profile;
+            mCacheSizeRate = HIGH_QUALITY_CACHE_SIZE_RATE;
+            mErrorCorrectionThresholdRate = HIGH_QUALITY_ERROR_CORRECTION_THRESHOLD_RATE;
+            mAllowsMultipleWords = true;
+            break;
+        default:
+            mProfile = SEARCH_PROFILE_DEFAULT;
+            mCacheSizeRate = 1.0f;
+            mErrorCorrectionThresholdRate = 1.0f;
+            mAllowsMultipleWords = true;
+            break;
+    }
+}
+} // namespace latinime
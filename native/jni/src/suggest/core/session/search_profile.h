@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_SEARCH_PROFILE_H
+#define LATINIME_SEARCH_PROFILE_H
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * The search parameters of a session, which trade accuracy for CPU time together. The policies
+ * keep their defaults, which a profile scales: the number of dicNodes kept for each input index,
+ * the normalized spatial distance below which the typing errors are corrected, and whether the
+ * multiple word suggestions are searched at all.
+ */
+class SearchProfile {
+ public:
+    // Taken from DicTraverseSession.java
+    static const int SEARCH_PROFILE_DEFAULT = 0;
+    static const int SEARCH_PROFILE_BATTERY_SAVER = 1;
+    static const int SEARCH_PROFILE_HIGH_QUALITY = 2;
+
+    AK_FORCE_INLINE SearchProfile()
+            : mProfile(SEARCH_PROFILE_DEFAULT), mCacheSizeRate(1.0f),
+              mErrorCorrectionThresholdRate(1.0f), mAllowsMultipleWords(true) {}
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~SearchProfile() {}
+
+    // An unknown profile selects SEARCH_PROFILE_DEFAULT.
+    void setProfile(const int profile);
+
+    AK_FORCE_INLINE int getProfile() const {
+        return mProfile;
+    }
+
+    // Scales the default number of dicNodes kept for each input index of a policy.
+    AK_FORCE_INLINE int getMaxCacheSize(const int defaultMaxCacheSize) const {
+        const int maxCacheSize = static_cast<int>(
+                static_cast<float>(defaultMaxCacheSize) * mCacheSizeRate);
+        return min(max(maxCacheSize, MIN_CACHE_SIZE), MAX_CACHE_SIZE);
+    }
+
+    // Scales the default normalized spatial distance threshold for the error corrections.
+    AK_FORCE_INLINE float getErrorCorrectionThreshold(const float defaultThreshold) const {
+        return defaultThreshold * mErrorCorrectionThresholdRate;
+    }
+
+    AK_FORCE_INLINE bool allowsMultipleWords() const {
+        return mAllowsMultipleWords;
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(SearchProfile);
+
+    static const int MIN_CACHE_SIZE;
+    static const int MAX_CACHE_SIZE;
+    static const float BATTERY_SAVER_CACHE_SIZE_RATE;
+    static const float BATTERY_SAVER_ERROR_CORRECTION_THRESHOLD_RATE;
+    static const float HIGH_QUALITY_CACHE_SIZE_RATE;
+    static const float HIGH_QUALITY_ERROR_CORRECTION_THRESHOLD_RATE;
+
+    int mProfile;
+    float mCacheSizeRate;
+    float mErrorCorrectionThresholdRate;
+    bool mAllowsMultipleWords;
+};
+} // namespace latinime
+#endif // LATINIME_SEARCH_PROFILE_H
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_SEARCH_STATISTICS_H
+#define LATINIME_SEARCH_STATISTICS_H
+
+#include <cstring>
+#include <stdint.h>
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * Counters of the work of the searches of a session, and high-water marks of its queues and
+ * caches, accumulated until they are reset. Unlike DicNodeProfiler, which follows the corrections
+ * on the path of each dicNode in debug builds, they are always counted, so that the latency of
+ * a search can be related to its size in the field. Only the thread of the session counts; the
+ * expansion workers do not touch them.
+ */
+class SearchStatistics {
+ public:
+    // Taken from BinaryDictionary.java
+    static const int STATISTIC_SEARCHES = 0;
+    static const int STATISTIC_EXPANDED_DIC_NODES = 1; // Popped from the active queue
+    static const int STATISTIC_PUSHED_DIC_NODES = 2; // Pushed to the next active queue
+    // Rejected or evicted by the next active queue when it was full
+    static const int STATISTIC_DROPPED_DIC_NODES = 3;
+    // Searches that continued from the dicNodes cached by the previous one, or not
+    static const int STATISTIC_CONTINUOUS_CACHE_HITS = 4;
+    static const int STATISTIC_CONTINUOUS_CACHE_MISSES = 5;
+    static const int STATISTIC_TERMINALS = 6; // Pushed to the terminal queue
+    // The largest sizes the queues reached, and the pushes to a full queue, which drop a dicNode.
+    // The overflows of the next active queue are the STATISTIC_DROPPED_DIC_NODES.
+    static const int STATISTIC_ACTIVE_QUEUE_HIGH_WATER_MARK = 7;
+    static const int STATISTIC_ACTIVE_QUEUE_OVERFLOWS = 8;
+    static const int STATISTIC_NEXT_ACTIVE_QUEUE_HIGH_WATER_MARK = 9;
+    static const int STATISTIC_TERMINAL_QUEUE_HIGH_WATER_MARK = 10;
+    static const int STATISTIC_TERMINAL_QUEUE_OVERFLOWS = 11;
+    static const int STATISTIC_CONTINUOUS_QUEUE_HIGH_WATER_MARK = 12;
+    static const int STATISTIC_CONTINUOUS_QUEUE_OVERFLOWS = 13;
+    // The largest number and size in bytes of the maps of MultiBigramMap, and its evictions
+    static const int STATISTIC_BIGRAM_MAP_CACHE_HIGH_WATER_MARK = 14;
+    static const int STATISTIC_BIGRAM_MAP_CACHE_BYTES_HIGH_WATER_MARK = 15;
+    static const int STATISTIC_BIGRAM_MAP_CACHE_EVICTIONS = 16;
+    // The predictions of BigramPredictionCache replaced by those of another previous word
+    static const int STATISTIC_BIGRAM_PREDICTION_CACHE_EVICTIONS = 17;
+    // Dropped by the lower bound pruning before they were pushed to the next active queue
+    static const int STATISTIC_PRUNED_DIC_NODES = 18;
+    // Terminals of a word that the terminal queue already has, merged into its queued terminal
+    static const int STATISTIC_DUPLICATE_TERMINALS = 19;
+    // Queries answered by SuggestionResultCache without a search, and its replaced entries
+    static const int STATISTIC_SUGGESTION_RESULT_CACHE_HITS = 20;
+    static const int STATISTIC_SUGGESTION_RESULT_CACHE_EVICTIONS = 21;
+    static const int STATISTIC_COUNT = 22;
+
+    AK_FORCE_INLINE SearchStatistics() : mCounts() {}
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~SearchStatistics() {}
+
+    AK_FORCE_INLINE void reset() {
+        memset(mCounts, 0, sizeof(mCounts));
+    }
+
+    AK_FORCE_INLINE void countSearch(const bool continuesCachedSearch) {
+        ++mCounts[STATISTIC_SEARCHES];
+        if (continuesCachedSearch) {
+            ++mCounts[STATISTIC_CONTINUOUS_CACHE_HITS];
+        } else {
+            ++mCounts[STATISTIC_CONTINUOUS_CACHE_MISSES];
+        }
+    }
+
+    AK_FORCE_INLINE void countExpandedDicNode() {
+        ++mCounts[STATISTIC_EXPANDED_DIC_NODES];
+    }
+
+    AK_FORCE_INLINE void countPushedDicNode(const bool dropsDicNode) {
+        ++mCounts[STATISTIC_PUSHED_DIC_NODES];
+        if (dropsDicNode) {
+            ++mCounts[STATISTIC_DROPPED_DIC_NODES];
+        }
+    }
+
+    AK_FORCE_INLINE void countTerminal() {
+        ++mCounts[STATISTIC_TERMINALS];
+    }
+
+    AK_FORCE_INLINE void countPrunedDicNode() {
+        ++mCounts[STATISTIC_PRUNED_DIC_NODES];
+    }
+
+    AK_FORCE_INLINE void countDuplicateTerminal() {
+        ++mCounts[STATISTIC_DUPLICATE_TERMINALS];
+    }
+
+    AK_FORCE_INLINE void countSuggestionResultCacheHit() {
+        ++mCounts[STATISTIC_SUGGESTION_RESULT_CACHE_HITS];
+    }
+
+    // Counts the size of a queue after a push, and whether it was full before.
+    AK_FORCE_INLINE void countQueuePush(const int highWaterMarkStatistic,
+            const int overflowStatistic, const int size, const bool wasFull) {
+        updateHighWaterMark(highWaterMarkStatistic, size);
+        if (wasFull) {
+            ++mCounts[overflowStatistic];
+        }
+    }
+
+    AK_FORCE_INLINE void updateHighWaterMark(const int statistic, const int value) {
+        if (value > mCounts[statistic]) {
+            mCounts[statistic] = value;
+        }
+    }
+
+    AK_FORCE_INLINE void countEviction(const int statistic) {
+        ++mCounts[statistic];
+    }
+
+    // Adds the counters to the STATISTIC_COUNT elements of outCounts. The high-water marks are
+    // merged with the largest one instead.
+    AK_FORCE_INLINE void addTo(int64_t *const outCounts) const {
+        for (int i = 0; i < STATISTIC_COUNT; ++i) {
+            if (isHighWaterMark(i)) {
+                outCounts[i] = max(outCounts[i], mCounts[i]);
+            } else {
+                outCounts[i] += mCounts[i];
+            }
+        }
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(SearchStatistics);
+
+    static AK_FORCE_INLINE bool isHighWaterMark(const int statistic) {
+        switch (statistic) {
+            case STATISTIC_ACTIVE_QUEUE_HIGH_WATER_MARK:
+            case STATISTIC_NEXT_ACTIVE_QUEUE_HIGH_WATER_MARK:
+            case STATISTIC_TERMINAL_QUEUE_HIGH_WATER_MARK:
+            case STATISTIC_CONTINUOUS_QUEUE_HIGH_WATER_MARK:
+            case STATISTIC_BIGRAM_MAP_CACHE_HIGH_WATER_MARK:
+            case STATISTIC_BIGRAM_MAP_CACHE_BYTES_HIGH_WATER_MARK:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    int64_t mCounts[STATISTIC_COUNT];
+};
+} // namespace latinime
+#endif // LATINIME_SEARCH_STATISTICS_H
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_SPATIAL_COST_CACHE_H
+#define LATINIME_SPATIAL_COST_CACHE_H
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * The spatial costs of matching a code point at an input index of the current query, filled
+ * lazily by the weighting policy: the weighted distance of the touch point to the key, and the cost
+ * of the key not being the primary one of the touch point. They only depend on the touch point and
+ * the key, but they are computed for every dicNode that reaches the input index with that code
+ * point, and the siblings of different branches share their letters. The code points are direct
+ * mapped to SLOT_COUNT slots per input index, which keeps the lower case letters of a latin
+ * keyboard apart; a colliding code point replaces the cached one.
+ *
+ * While the frontier is expanded on the worker threads, the cache is read only: the misses are
+ * computed but not stored.
+ *
+ * The cache also keeps the lower bounds of the cost of the input from each index to its end that
+ * the lower bound pruning uses, which the traversal policy fills at once on the thread of the
+ * session.
+ */
+class SpatialCostCache {
+ public:
+    AK_FORCE_INLINE SpatialCostCache()
+            : mIsReadOnly(false), mUsedRowCount(MAX_WORD_LENGTH), mEntries(),
+              mHasMinRemainingCosts(false), mMinRemainingCostInputSize(0),
+              mMinRemainingCosts() {
+        reset();
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~SpatialCostCache() {}
+
+    // Clears the costs for a new query.
+    AK_FORCE_INLINE void reset() {
+        for (int i = 0; i < mUsedRowCount; ++i) {
+            for (int j = 0; j < SLOT_COUNT; ++j) {
+                mEntries[i][j].mCodePoint = NOT_A_CODE_POINT;
+            }
+        }
+        mUsedRowCount = 0;
+        mHasMinRemainingCosts = false;
+    }
+
+    AK_FORCE_INLINE void setReadOnly(const bool isReadOnly) {
+        mIsReadOnly = isReadOnly;
+    }
+
+    AK_FORCE_INLINE bool get(const int inputIndex, const int codePoint,
+            float *const outDistanceCost, float *const outProximityCost) const {
+        if (inputIndex < 0 || inputIndex >= MAX_WORD_LENGTH) {
+            return false;
+        }
+        const Entry *const entry = &mEntries[inputIndex][codePoint & (SLOT_COUNT - 1)];
+        if (entry->mCodePoint != codePoint) {
+            return false;
+        }
+        *outDistanceCost = entry->mDistanceCost;
+        *outProximityCost = entry->mProximityCost;
+        return true;
+    }
+
+    AK_FORCE_INLINE void put(const int inputIndex, const int codePoint, const float distanceCost,
+            const float proximityCost) {
+        if (mIsReadOnly || inputIndex < 0 || inputIndex >= MAX_WORD_LENGTH) {
+            return;
+        }
+        Entry *const entry = &mEntries[inputIndex][codePoint & (SLOT_COUNT - 1)];
+        entry->mCodePoint = codePoint;
+        entry->mDistanceCost = distanceCost;
+        entry->mProximityCost = proximityCost;
+        mUsedRowCount = max(mUsedRowCount, inputIndex + 1);
+    }
+
+    AK_FORCE_INLINE bool hasMinRemainingCosts() const {
+        return mHasMinRemainingCosts;
+    }
+
+    // Returns the lower bound of the cost of the input points from inputIndex to the end.
+    AK_FORCE_INLINE float getMinRemainingCost(const int inputIndex) const {
+        if (inputIndex >= mMinRemainingCostInputSize) {
+            return 0.0f;
+        }
+        return mMinRemainingCosts[max(inputIndex, 0)];
+    }
+
+    // Sets the lower bounds of the cost of each of the inputSize input points, which are summed up
+    // from the end.
+    AK_FORCE_INLINE void setMinPointCosts(const float *const minPointCosts, const int inputSize) {
+        mMinRemainingCostInputSize = min(inputSize, MAX_WORD_LENGTH);
+        float minRemainingCost = 0.0f;
+        for (int i = mMinRemainingCostInputSize - 1; i >= 0; --i) {
+            minRemainingCost += minPointCosts[i];
+            mMinRemainingCosts[i] = minRemainingCost;
+        }
+        mHasMinRemainingCosts = true;
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(SpatialCostCache);
+
+    struct Entry {
+        int mCodePoint;
+        float mDistanceCost;
+        float mProximityCost;
+    };
+
+    // Must be a power of 2
+    static const int SLOT_COUNT = 32;
+
+    bool mIsReadOnly;
+    // The input indices below this may have cached costs.
+    int mUsedRowCount;
+    Entry mEntries[MAX_WORD_LENGTH][SLOT_COUNT];
+    bool mHasMinRemainingCosts;
+    int mMinRemainingCostInputSize;
+    float mMinRemainingCosts[MAX_WORD_LENGTH];
+};
+} // namespace latinime
+#endif // LATINIME_SPATIAL_COST_CACHE_H
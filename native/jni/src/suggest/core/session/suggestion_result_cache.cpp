@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "suggest/core/session/suggestion_result_cache.h"
+
+#include <cstring>
+
+#include "suggest/core/session/search_statistics.h"
+
+namespace latinime {
+
+// FNV-1a
+static const uint32_t HASH_OFFSET_BASIS = 2166136261U;
+static const uint32_t HASH_PRIME = 16777619U;
+
+static AK_FORCE_INLINE uint32_t hashInt(const uint32_t hash, const int value) {
+    return (hash ^ static_cast<uint32_t>(value)) * HASH_PRIME;
+}
+
+static AK_FORCE_INLINE uint32_t hashInts(uint32_t hash, const int *const values,
+        const int count) {
+    for (int i = 0; i < count; ++i) {
+        hash = hashInt(hash, values[i]);
+    }
+    return hash;
+}
+
+SuggestionResultCache::SuggestionResultCache(SearchStatistics *const statistics)
+        : mStatistics(statistics), mEntries(), mUseCount(0), mPendingQuery(),
+          mHasPendingQuery(false) {
+    clear();
+}
+
+int SuggestionResultCache::get(const int dictionaryId, const int probabilityOverlayId,
+        const int proximityInfoId, const int prevWordPos, const bool isGesture,
+        const int searchProfile, const int *const inputCodePoints, const int *const inputXs,
+        const int *const inputYs, const int *const times, const int *const pointerIds,
+        const int inputSize, int *const outWords, int *const outScores,
+        int *const outSpaceIndices, int *const outTypes) {
+    mHasPendingQuery = false;
+    if (inputSize < 0 || inputSize > MAX_WORD_LENGTH) {
+        // Most gestures have more points than a cached input.
+        return NOT_AN_INDEX;
+    }
+    Key *const query = &mPendingQuery;
+    query->mDictionaryId = dictionaryId;
+    query->mProbabilityOverlayId = probabilityOverlayId;
+    query->mProximityInfoId = proximityInfoId;
+    query->mPrevWordPos = prevWordPos;
+    query->mIsGesture = isGesture;
+    query->mSearchProfile = searchProfile;
+    query->mInputSize = inputSize;
+    memcpy(query->mInputCodePoints, inputCodePoints, inputSize * sizeof(inputCodePoints[0]));
+    memcpy(query->mInputXs, inputXs, inputSize * sizeof(inputXs[0]));
+    memcpy(query->mInputYs, inputYs, inputSize * sizeof(inputYs[0]));
+    memcpy(query->mTimes, times, inputSize * sizeof(times[0]));
+    memcpy(query->mPointerIds, pointerIds, inputSize * sizeof(pointerIds[0]));
+    query->mHash = hashKey(query);
+    for (int i = 0; i < MAX_ENTRIES; ++i) {
+        Entry *const entry = &mEntries[i];
+        if (entry->mLastUsed == 0 || !equals(&entry->mKey, query)) {
+            continue;
+        }
+        entry->mLastUsed = ++mUseCount;
+        memcpy(outWords, entry->mWords, entry->mCount * MAX_WORD_LENGTH * sizeof(outWords[0]));
+        memcpy(outScores, entry->mScores, entry->mCount * sizeof(outScores[0]));
+        memcpy(outSpaceIndices, entry->mSpaceIndices, entry->mCount * sizeof(outSpaceIndices[0]));
+        memcpy(outTypes, entry->mTypes, entry->mCount * sizeof(outTypes[0]));
+        mStatistics->countSuggestionResultCacheHit();
+        return entry->mCount;
+    }
+    mHasPendingQuery = true;
+    return NOT_AN_INDEX;
+}
+
+void SuggestionResultCache::add(const int *const words, const int *const scores,
+        const int *const spaceIndices, const int *const types, const int count) {
+    if (!mHasPendingQuery || count < 0 || count > MAX_RESULTS) {
+        mHasPendingQuery = false;
+        return;
+    }
+    mHasPendingQuery = false;
+    Entry *entry = &mEntries[0];
+    for (int i = 1; i < MAX_ENTRIES; ++i) {
+        if (mEntries[i].mLastUsed < entry->mLastUsed) {
+            entry = &mEntries[i];
+        }
+    }
+    if (entry->mLastUsed != 0) {
+        mStatistics->countEviction(
+                SearchStatistics::STATISTIC_SUGGESTION_RESULT_CACHE_EVICTIONS);
+    }
+    entry->mKey = mPendingQuery;
+    entry->mLastUsed = ++mUseCount;
+    entry->mCount = count;
+    memcpy(entry->mWords, words, count * MAX_WORD_LENGTH * sizeof(entry->mWords[0]));
+    memcpy(entry->mScores, scores, count * sizeof(entry->mScores[0]));
+    memcpy(entry->mSpaceIndices, spaceIndices, count * sizeof(entry->mSpaceIndices[0]));
+    memcpy(entry->mTypes, types, count * sizeof(entry->mTypes[0]));
+}
+
+void SuggestionResultCache::clear() {
+    for (int i = 0; i < MAX_ENTRIES; ++i) {
+        mEntries[i].mLastUsed = 0;
+    }
+    mUseCount = 0;
+    mHasPendingQuery = false;
+}
+
+/* static */ uint32_t SuggestionResultCache::hashKey(const Key *const key) {
+    uint32_t hash = HASH_OFFSET_BASIS;
+    hash = hashInt(hash, key->mDictionaryId);
+    hash = hashInt(hash, key->mProbabilityOverlayId);
+    hash = hashInt(hash, key->mProximityInfoId);
+    hash = hashInt(hash, key->mPrevWordPos);
+    hash = hashInt(hash, key->mIsGesture ? 1 : 0);
+    hash = hashInt(hash, key->mSearchProfile);
+    hash = hashInt(hash, key->mInputSize);
+    hash = hashInts(hash, key->mInputCodePoints, key->mInputSize);
+    hash = hashInts(hash, key->mInputXs, key->mInputSize);
+    hash = hashInts(hash, key->mInputYs, key->mInputSize);
+    hash = hashInts(hash, key->mTimes, key->mInputSize);
+    return hashInts(hash, key->mPointerIds, key->mInputSize);
+}
+
+/* static */ bool SuggestionResultCache::equals(const Key *const left, const Key *const right) {
+    if (left->mHash != right->mHash || left->mInputSize != right->mInputSize
+            || left->mDictionaryId != right->mDictionaryId
+            || left->mProbabilityOverlayId != right->mProbabilityOverlayId
+            || left->mProximityInfoId != right->mProximityInfoId
+            || left->mPrevWordPos != right->mPrevWordPos
+            || left->mIsGesture != right->mIsGesture
+            || left->mSearchProfile != right->mSearchProfile) {
+        return false;
+    }
+    const size_t inputBytes = left->mInputSize * sizeof(left->mInputCodePoints[0]);
+    return memcmp(left->mInputCodePoints, right->mInputCodePoints, inputBytes) == 0
+            && memcmp(left->mInputXs, right->mInputXs, inputBytes) == 0
+            && memcmp(left->mInputYs, right->mInputYs, inputBytes) == 0
+            && memcmp(left->mTimes, right->mTimes, inputBytes) == 0
+            && memcmp(left->mPointerIds, right->mPointerIds, inputBytes) == 0;
+}
+} // namespace latinime
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_SUGGESTION_RESULT_CACHE_H
+#define LATINIME_SUGGESTION_RESULT_CACHE_H
+
+#include <stdint.h>
+
+#include "defines.h"
+
+namespace latinime {
+
+class SearchStatistics;
+
+/**
+ * The final suggestions of the last queries of a session. The same query is often issued again,
+ * e.g. by the recorrection of a word, or by the spell checker for unchanged text, and a cached one
+ * is not searched again. A query is keyed by the dictionary and its overlay, the keyboard, the
+ * previous word, the mode of the search and the whole input, which is compared exactly: two
+ * inputs whose points differ slightly may have different suggestions. The key is hashed to reject
+ * most of the other entries at once, and the least recently used entry is replaced.
+ */
+class SuggestionResultCache {
+ public:
+    // The evictions and hits are counted in statistics.
+    explicit SuggestionResultCache(SearchStatistics *const statistics);
+
+    // Non virtual inline destructor -- never inherit this class
+    ~SuggestionResultCache() {}
+
+    // Copies the cached suggestions of the query to the output arrays, which have the sizes of
+    // those of Dictionary::getSuggestions, and returns their count. Returns NOT_AN_INDEX if they
+    // are not cached; the query is then kept for add(), unless its input is too long to cache.
+    int get(const int dictionaryId, const int probabilityOverlayId, const int proximityInfoId,
+            const int prevWordPos, const bool isGesture, const int searchProfile,
+            const int *const inputCodePoints, const int *const inputXs, const int *const inputYs,
+            const int *const times, const int *const pointerIds, const int inputSize,
+            int *const outWords, int *const outScores, int *const outSpaceIndices,
+            int *const outTypes);
+
+    // Caches the count suggestions of the query last missed by get(), if any.
+    void add(const int *const words, const int *const scores, const int *const spaceIndices,
+            const int *const types, const int count);
+
+    // Forgets the query last missed by get(), whose suggestions may not be cached.
+    void dropPendingQuery() { mHasPendingQuery = false; }
+
+    void clear();
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(SuggestionResultCache);
+
+    static const int MAX_ENTRIES = 8;
+
+    struct Key {
+        uint32_t mHash;
+        int mDictionaryId;
+        int mProbabilityOverlayId;
+        int mProximityInfoId;
+        int mPrevWordPos;
+        bool mIsGesture;
+        int mSearchProfile;
+        int mInputSize;
+        int mInputCodePoints[MAX_WORD_LENGTH];
+        int mInputXs[MAX_WORD_LENGTH];
+        int mInputYs[MAX_WORD_LENGTH];
+        int mTimes[MAX_WORD_LENGTH];
+        int mPointerIds[MAX_WORD_LENGTH];
+    };
+
+    struct Entry {
+        Key mKey;
+        // 0 for an empty entry
+        int mLastUsed;
+        int mCount;
+        int mWords[MAX_RESULTS * MAX_WORD_LENGTH];
+        int mScores[MAX_RESULTS];
+        int mSpaceIndices[MAX_RESULTS];
+        int mTypes[MAX_RESULTS];
+    };
+
+    static uint32_t hashKey(const Key *const key);
+    static bool equals(const Key *const left, const Key *const right);
+
+    SearchStatistics *const mStatistics;
+    Entry mEntries[MAX_ENTRIES];
+    int mUseCount;
+    // The query last missed by get()
+    Key mPendingQuery;
+    bool mHasPendingQuery;
+};
+} // namespace latinime
+#endif // LATINIME_SUGGESTION_RESULT_CACHE_H
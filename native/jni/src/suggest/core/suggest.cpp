@@ -16,94 +16,342 @@
 
 #include "suggest/core/suggest.h"
 
+#include <cstring>
+
 #include "char_utils.h"
 #include "dictionary.h"
-#include "digraph_utils.h"
+#include "digraph_code_point_set.h"
 #include "proximity_info.h"
 #include "suggest/core/dicnode/dic_node.h"
+#include "suggest/core/dicnode/dic_node_expansion_buffer.h"
 #include "suggest/core/dicnode/dic_node_priority_queue.h"
 #include "suggest/core/dicnode/dic_node_vector.h"
 #include "suggest/core/dictionary/shortcut_utils.h"
 #include "suggest/core/policy/scoring.h"
 #include "suggest/core/policy/traversal.h"
 #include "suggest/core/policy/weighting.h"
+#include "suggest/core/session/adaptive_beam_controller.h"
 #include "suggest/core/session/dic_traverse_session.h"
+#include "suggest/core/session/expansion_worker_pool.h"
+#include "suggest/policyimpl/typing/typing_scoring.h"
+#include "suggest/policyimpl/typing/typing_traversal.h"
+#include "suggest/policyimpl/typing/typing_weighting.h"
 #include "terminal_attributes.h"
+#include "trace_recorder.h"
 
 namespace latinime {
 
 // Initialization of class constants.
-const int Suggest::MIN_LEN_FOR_MULTI_WORD_AUTOCORRECT = 16;
-const int Suggest::MIN_CONTINUOUS_SUGGESTION_INPUT_SIZE = 2;
-const float Suggest::AUTOCORRECT_CLASSIFICATION_THRESHOLD = 0.33f;
+template<class TraversalT, class ScoringT, class WeightingT>
+const int SuggestImpl<TraversalT, ScoringT, WeightingT>::MIN_LEN_FOR_MULTI_WORD_AUTOCORRECT = 16;
+template<class TraversalT, class ScoringT, class WeightingT>
+const int SuggestImpl<TraversalT, ScoringT, WeightingT>::MIN_CONTINUOUS_SUGGESTION_INPUT_SIZE = 2;
+template<class TraversalT, class ScoringT, class WeightingT>
+const float SuggestImpl<TraversalT, ScoringT, WeightingT>::AUTOCORRECT_CLASSIFICATION_THRESHOLD =
+        0.33f;
+template<class TraversalT, class ScoringT, class WeightingT>
+const float SuggestImpl<TraversalT, ScoringT, WeightingT>::LOWER_BOUND_PRUNING_MARGIN = 0.000001f;
+
+// The policies of Suggest are the ones of its SuggestPolicy, whose calls are virtual.
+template<>
+AK_FORCE_INLINE const Traversal *Suggest::getTraversal() const {
+    return TRAVERSAL;
+}
+
+template<>
+AK_FORCE_INLINE const Scoring *Suggest::getScoring() const {
+    return SCORING;
+}
+
+template<>
+AK_FORCE_INLINE const Weighting *Suggest::getWeighting() const {
+    return WEIGHTING;
+}
+
+// The policies of a SuggestPolicy may normalize the compound distance by the input size, so that
+// it does not grow monotonically as the input is consumed and no lower bound holds for it.
+template<>
+AK_FORCE_INLINE bool Suggest::isPrunedByLowerBound(DicTraverseSession *traverseSession,
+        DicNode *dicNode) const {
+    return false;
+}
+
+// Returns the expansion buffer of the expanding thread, whose scratch storage is kept across
+// searches. The sequential expansion runs on the same thread as the first parallel job, so they
+// share the first expansion buffer.
+static inline DicNodeExpansionBuffer *getWorkerBuffer(DicTraverseSession *traverseSession,
+        DicNodeExpansionBuffer *expansionBuffer) {
+    return expansionBuffer ? expansionBuffer : traverseSession->getExpansionBuffer(0);
+}
+
+// Returns the decoded children cache of the expanding thread.
+static inline DicNodeChildrenCache *getChildrenCache(DicTraverseSession *traverseSession,
+        DicNodeExpansionBuffer *expansionBuffer) {
+    return getWorkerBuffer(traverseSession, expansionBuffer)->getChildrenCache();
+}
+
+// The number of dicNodes kept for each input index: the one of the traversal policy, scaled by
+// the search profile of the session.
+template<class TraversalT, class ScoringT, class WeightingT>
+int SuggestImpl<TraversalT, ScoringT, WeightingT>::getMaxCacheSize(
+        const DicTraverseSession *const traverseSession) const {
+    return traverseSession->getSearchProfile()->getMaxCacheSize(getTraversal()->getMaxCacheSize());
+}
 
 /**
  * Returns a set of suggestions for the given input touch points. The commitPoint argument indicates
  * whether to prematurely commit the suggested words up to the given point for sentence-level
  * suggestion.
  *
- * Note: Currently does not support concurrent calls across threads. Continuous suggestion is
- * automatically activated for sequential calls that share the same starting input.
+ * Suggest itself is immutable; all the state of a call is in the traverse session, so calls with
+ * different sessions may run concurrently on one dictionary. A session must only be used by one
+ * thread at a time. Continuous suggestion is automatically activated for sequential calls on a
+ * session that share the same starting input.
  * TODO: Stop detecting continuous suggestion. Start using traverseSession instead.
+ *
+ * When the session has a latency budget, the number of dicNodes kept for each input index starts
+ * at getMaxCacheSize() and is adapted after every input index to finish in time.
+ *
+ * The request of the session may be cancelled from another thread. This is checked between input
+ * indices, and a cancelled search returns no suggestions.
+ *
+ * When the session has a progressive interval, the suggestions of the terminals found so far are
+ * published between input indices for the request to be read from another thread.
  */
-int Suggest::getSuggestions(ProximityInfo *pInfo, void *traverseSession,
-        int *inputXs, int *inputYs, int *times, int *pointerIds, int *inputCodePoints,
-        int inputSize, int commitPoint, int *outWords, int *frequencies, int *outputIndices,
-        int *outputTypes) const {
-    PROF_OPEN;
-    PROF_START(0);
-    const float maxSpatialDistance = TRAVERSAL->getMaxSpatialDistance();
+template<class TraversalT, class ScoringT, class WeightingT>
+int SuggestImpl<TraversalT, ScoringT, WeightingT>::getSuggestions(ProximityInfo *pInfo,
+        void *traverseSession, int *inputXs, int *inputYs, int *times, int *pointerIds,
+        int *inputCodePoints, int inputSize, int commitPoint, int *outWords, int *frequencies,
+        int *outputIndices, int *outputTypes) const {
+    TraceSpan setupSpan(TraceRecorder::PHASE_SESSION_SETUP);
+    const float maxSpatialDistance = getTraversal()->getMaxSpatialDistance();
     DicTraverseSession *tSession = static_cast<DicTraverseSession *>(traverseSession);
+    AdaptiveBeamController *const beamController = tSession->getAdaptiveBeamController();
+    const bool adaptsBeamWidth = beamController->isEnabled();
+    if (adaptsBeamWidth) {
+        beamController->start(getMaxCacheSize(tSession), MAX_DIC_NODE_PRIORITY_QUEUE_CAPACITY);
+    }
     tSession->setupForGetSuggestions(pInfo, inputCodePoints, inputSize, inputXs, inputYs, times,
-            pointerIds, maxSpatialDistance, TRAVERSAL->getMaxPointerCount());
+            pointerIds, maxSpatialDistance, getTraversal()->getMaxPointerCount());
     // TODO: Add the way to evaluate cache
 
+    // The first pass fills the cache, so a search that continues from it has a single pass.
+    const int coarsePassCacheSize = getTraversal()->getCoarsePassCacheSize(tSession);
+    if (coarsePassCacheSize > 0 && tSession->getProximityInfoState(0)->isUsed()
+            && !tSession->isContinuousSuggestionPossible()
+            && !searchCoarsePass(tSession, inputXs, inputYs, times, pointerIds, inputCodePoints,
+                    inputSize, coarsePassCacheSize)) {
+        return 0;
+    }
     initializeSearch(tSession, commitPoint);
-    PROF_END(0);
-    PROF_START(1);
+    ProgressiveResults *const progressiveResults = tSession->getProgressiveResults();
+    const bool publishesResults = progressiveResults->start(tSession->getRequestTicket());
+    if (adaptsBeamWidth) {
+        // The queue may keep the width adapted in the previous search when it continues.
+        tSession->getDicTraverseCache()->setNextActiveCacheSize(getMaxCacheSize(tSession));
+    }
+    setupSpan.end();
+    TraceSpan searchSpan(TraceRecorder::PHASE_SEARCH);
 
     // keep expanding search dicNodes until all have terminated.
     while (tSession->getDicTraverseCache()->activeSize() > 0) {
+        if (tSession->isRequestCancelled()) {
+            // The cache is left in the middle of the search, so the next call must not continue
+            // from it. The snapshots of the expanded input indices are still valid.
+            tSession->resetCache(getMaxCacheSize(tSession), MAX_RESULTS);
+            return 0;
+        }
         expandCurrentDicNodes(tSession);
         tSession->getDicTraverseCache()->advanceActiveDicNodes();
         tSession->getDicTraverseCache()->advanceInputIndex(inputSize);
+        if (adaptsBeamWidth) {
+            // Include the input index that only completes and terminates the dicNodes.
+            const int remainingStepCount =
+                    inputSize - tSession->getDicTraverseCache()->getInputIndex() + 1;
+            tSession->getDicTraverseCache()->setNextActiveCacheSize(
+                    beamController->updateBeamWidth(remainingStepCount));
+        }
+        if (publishesResults && progressiveResults->isPublicationDue()
+                && tSession->getDicTraverseCache()->terminalSize() > 0) {
+            progressiveResults->publish(outputSuggestions(tSession,
+                    progressiveResults->getOutputScores(),
+                    progressiveResults->getOutputCodePoints(),
+                    progressiveResults->getOutputSpaceIndices(),
+                    progressiveResults->getOutputTypes(), false /* clearsTerminals */));
+        }
+    }
+    searchSpan.end();
+    TraceSpan outputSpan(TraceRecorder::PHASE_OUTPUT);
+    return outputSuggestions(tSession, frequencies, outWords, outputIndices, outputTypes,
+            true /* clearsTerminals */);
+}
+
+/**
+ * Searches the input sampled coarsely with a beam of cacheSize dicNodes, and restricts the next
+ * search of the session to the paths of the words found. Returns false if the request was
+ * cancelled.
+ */
+template<class TraversalT, class ScoringT, class WeightingT>
+bool SuggestImpl<TraversalT, ScoringT, WeightingT>::searchCoarsePass(
+        DicTraverseSession *traverseSession, int *inputXs, int *inputYs, int *times,
+        int *pointerIds, int *inputCodePoints, int inputSize, const int cacheSize) const {
+    // Within the setup span of the second pass
+    TraceSpan searchSpan(TraceRecorder::PHASE_SEARCH);
+    traverseSession->setupForCoarsePass(inputCodePoints, inputSize, inputXs, inputYs, times,
+            pointerIds, getTraversal()->getMaxSpatialDistance());
+    traverseSession->resetCache(traverseSession->getSearchProfile()->getMaxCacheSize(cacheSize),
+            MAX_RESULTS);
+    if (traverseSession->getProximityInfoState(0)->isUsed()) {
+        DicNode rootNode;
+        DicNodeUtils::initAsRoot(traverseSession->getDicRootPos(),
+                traverseSession->getOffsetDict(), traverseSession->getPrevWordPos(), &rootNode);
+        traverseSession->getDicTraverseCache()->copyPushActive(&rootNode);
     }
-    PROF_END(1);
-    PROF_START(2);
-    const int size = outputSuggestions(tSession, frequencies, outWords, outputIndices, outputTypes);
-    PROF_END(2);
-    PROF_CLOSE;
-    return size;
+    while (traverseSession->getDicTraverseCache()->activeSize() > 0) {
+        if (traverseSession->isRequestCancelled()) {
+            traverseSession->resetCache(getMaxCacheSize(traverseSession), MAX_RESULTS);
+            return false;
+        }
+        expandCurrentDicNodes(traverseSession);
+        traverseSession->getDicTraverseCache()->advanceActiveDicNodes();
+        traverseSession->getDicTraverseCache()->advanceInputIndex(inputSize);
+    }
+    traverseSession->endCoarsePass();
+    return true;
+}
+
+/**
+ * Expands the frontier for the input followed by one more key, so that the search resumes from a
+ * deeper snapshot when the key arrives. The frontier of an input index only depends on the points
+ * before it, and on the input size for the last DicNodesCache::CACHE_BACK_LENGTH indices. Hence
+ * the deepest frontier the next search may resume from does not depend on the next key, which is
+ * stood for by a copy of the last point. This is at most maxStepCount input indices from the
+ * deepest snapshot, which is normally one index after a search of the same input.
+ */
+template<class TraversalT, class ScoringT, class WeightingT>
+int SuggestImpl<TraversalT, ScoringT, WeightingT>::speculateNextInput(ProximityInfo *pInfo,
+        void *traverseSession, int *inputXs, int *inputYs, int *times, int *pointerIds,
+        int *inputCodePoints, int inputSize, int maxStepCount) const {
+    const int nextInputSize = inputSize + 1;
+    const int targetInputIndex = nextInputSize - DicNodesCache::CACHE_BACK_LENGTH;
+    if (maxStepCount <= 0 || targetInputIndex <= 0 || nextInputSize > MAX_WORD_LENGTH
+            || getTraversal()->getMaxPointerCount() != 1) {
+        return 0;
+    }
+    int nextInputXs[MAX_WORD_LENGTH];
+    int nextInputYs[MAX_WORD_LENGTH];
+    int nextTimes[MAX_WORD_LENGTH];
+    int nextPointerIds[MAX_WORD_LENGTH];
+    int nextInputCodePoints[MAX_WORD_LENGTH];
+    memcpy(nextInputXs, inputXs, inputSize * sizeof(nextInputXs[0]));
+    memcpy(nextInputYs, inputYs, inputSize * sizeof(nextInputYs[0]));
+    memcpy(nextTimes, times, inputSize * sizeof(nextTimes[0]));
+    memcpy(nextPointerIds, pointerIds, inputSize * sizeof(nextPointerIds[0]));
+    memcpy(nextInputCodePoints, inputCodePoints, inputSize * sizeof(nextInputCodePoints[0]));
+    nextInputXs[inputSize] = inputXs[inputSize - 1];
+    nextInputYs[inputSize] = inputYs[inputSize - 1];
+    nextTimes[inputSize] = times[inputSize - 1];
+    nextPointerIds[inputSize] = pointerIds[inputSize - 1];
+    nextInputCodePoints[inputSize] = inputCodePoints[inputSize - 1];
+
+    DicTraverseSession *tSession = static_cast<DicTraverseSession *>(traverseSession);
+    tSession->setupForGetSuggestions(pInfo, nextInputCodePoints, nextInputSize, nextInputXs,
+            nextInputYs, nextTimes, nextPointerIds, getTraversal()->getMaxSpatialDistance(),
+            getTraversal()->getMaxPointerCount());
+    if (!tSession->getProximityInfoState(0)->isUsed()) {
+        return 0;
+    }
+    tSession->resetCache(getMaxCacheSize(tSession), MAX_RESULTS);
+    const int snapshotInputIndex = tSession->getResumableSnapshotInputIndex();
+    const int startInputIndex = snapshotInputIndex != NOT_AN_INDEX ? snapshotInputIndex : 0;
+    if (startInputIndex == targetInputIndex
+            || targetInputIndex - startInputIndex > maxStepCount) {
+        return 0;
+    }
+    if (snapshotInputIndex != NOT_AN_INDEX) {
+        tSession->resumeFromSnapshot(snapshotInputIndex);
+    } else {
+        DicNode rootNode;
+        DicNodeUtils::initAsRoot(tSession->getDicRootPos(), tSession->getOffsetDict(),
+                tSession->getPrevWordPos(), &rootNode);
+        tSession->getDicTraverseCache()->copyPushActive(&rootNode);
+    }
+    int stepCount = 0;
+    while (tSession->getDicTraverseCache()->activeSize() > 0
+            && tSession->getDicTraverseCache()->getInputIndex() < targetInputIndex) {
+        expandCurrentDicNodes(tSession);
+        tSession->getDicTraverseCache()->advanceActiveDicNodes();
+        tSession->getDicTraverseCache()->advanceInputIndex(nextInputSize);
+        ++stepCount;
+    }
+    if (tSession->getDicTraverseCache()->getInputIndex() == targetInputIndex) {
+        // Record the frontier without expanding it, as the expansion needs the next key.
+        DicNodeSnapshots *const snapshots = tSession->getDicNodeSnapshots();
+        tSession->beginSnapshotIfNeeded();
+        DicNode dicNode;
+        while (tSession->getDicTraverseCache()->activeSize() > 0) {
+            tSession->getDicTraverseCache()->popActive(&dicNode);
+            if (dicNode.isTotalInputSizeExceedingLimit()) {
+                snapshots->abortSnapshot();
+                break;
+            }
+            if (snapshots->isRecording()) {
+                snapshots->add(&dicNode);
+            }
+        }
+        snapshots->endSnapshot();
+    }
+    // The cache was filled for the speculative input, so the next search must not continue
+    // from it.
+    tSession->resetCache(getMaxCacheSize(tSession), MAX_RESULTS);
+    return stepCount;
 }
 
 /**
  * Initializes the search at the root of the lexicon trie. Note that when possible the search will
  * continue suggestion from where it left off during the last call.
  */
-void Suggest::initializeSearch(DicTraverseSession *traverseSession, int commitPoint) const {
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::initializeSearch(
+        DicTraverseSession *traverseSession, int commitPoint) const {
     if (!traverseSession->getProximityInfoState(0)->isUsed()) {
         return;
     }
-    if (TRAVERSAL->allowPartialCommit()) {
+    if (getTraversal()->allowPartialCommit()) {
         commitPoint = 0;
     }
 
-    if (traverseSession->getInputSize() > MIN_CONTINUOUS_SUGGESTION_INPUT_SIZE
-            && traverseSession->isContinuousSuggestionPossible()) {
+    const bool continuesSearch =
+            traverseSession->getInputSize() > MIN_CONTINUOUS_SUGGESTION_INPUT_SIZE
+            && traverseSession->isContinuousSuggestionPossible();
+    traverseSession->getSearchStatistics()->countSearch(continuesSearch);
+    if (continuesSearch) {
         if (commitPoint == 0) {
             // Continue suggestion
             traverseSession->getDicTraverseCache()->continueSearch();
         } else {
             // Continue suggestion after partial commit.
-            DicNode *topDicNode =
-                    traverseSession->getDicTraverseCache()->setCommitPoint(commitPoint);
-            traverseSession->setPrevWordPos(topDicNode->getPrevWordNodePos());
+            // The previous words of the remaining dicNodes stay shared in the truncated chains.
+            traverseSession->setPrevWordPos(traverseSession->getDicTraverseCache()->setCommitPoint(
+                    commitPoint, traverseSession->getPrevWordChains(),
+                    traverseSession->getTruncatedPrevWordChains()));
             traverseSession->getDicTraverseCache()->continueSearch();
             traverseSession->setPartiallyCommited();
+            // The snapshots were taken with the previous word context, in the replaced chains.
+            traverseSession->invalidateSnapshots();
         }
     } else {
+        traverseSession->resetCache(getMaxCacheSize(traverseSession), MAX_RESULTS);
+        const int snapshotInputIndex = traverseSession->getResumableSnapshotInputIndex();
+        if (snapshotInputIndex != NOT_AN_INDEX) {
+            // Resume from the frontier of a previous search that shares the input prefix
+            // (e.g. after a backspace).
+            traverseSession->resumeFromSnapshot(snapshotInputIndex);
+            return;
+        }
+        // No dicNode of the previous searches is used any longer.
+        traverseSession->clearPrevWordChains();
         // Restart recognition at the root.
-        traverseSession->resetCache(TRAVERSAL->getMaxCacheSize(), MAX_RESULTS);
         // Create a new dic node here
         DicNode rootNode;
         DicNodeUtils::initAsRoot(traverseSession->getDicRootPos(),
@@ -113,29 +361,30 @@ void Suggest::initializeSearch(DicTraverseSession *traverseSession, int commitPo
 }
 
 /**
- * Outputs the final list of suggestions (i.e., terminal nodes).
+ * Outputs the final list of suggestions (i.e., terminal nodes). The terminals are read in place in
+ * the terminal queue, which is cleared afterwards if clearsTerminals is true. Otherwise the search
+ * may go on, as for the progressive results.
  */
-int Suggest::outputSuggestions(DicTraverseSession *traverseSession, int *frequencies,
-        int *outputCodePoints, int *spaceIndices, int *outputTypes) const {
+template<class TraversalT, class ScoringT, class WeightingT>
+int SuggestImpl<TraversalT, ScoringT, WeightingT>::outputSuggestions(
+        DicTraverseSession *traverseSession, int *frequencies, int *outputCodePoints,
+        int *spaceIndices, int *outputTypes, const bool clearsTerminals) const {
 #if DEBUG_EVALUATE_MOST_PROBABLE_STRING
     const int terminalSize = 0;
 #else
     const int terminalSize = min(MAX_RESULTS,
             static_cast<int>(traverseSession->getDicTraverseCache()->terminalSize()));
 #endif
-    DicNode terminals[MAX_RESULTS]; // Avoiding non-POD variable length array
+    DicNode *terminals[MAX_RESULTS] = {}; // Avoiding variable length array
+    traverseSession->getDicTraverseCache()->getSortedTerminals(terminals, terminalSize);
 
-    for (int index = terminalSize - 1; index >= 0; --index) {
-        traverseSession->getDicTraverseCache()->popTerminal(&terminals[index]);
-    }
-
-    const float languageWeight = SCORING->getAdjustedLanguageWeight(
+    const float languageWeight = getScoring()->getAdjustedLanguageWeight(
             traverseSession, terminals, terminalSize);
 
     int outputWordIndex = 0;
     // Insert most probable word at index == 0 as long as there is one terminal at least
     const bool hasMostProbableString =
-            SCORING->getMostProbableString(traverseSession, terminalSize, languageWeight,
+            getScoring()->getMostProbableString(traverseSession, terminalSize, languageWeight,
                     &outputCodePoints[0], &outputTypes[0], &frequencies[0]);
     if (hasMostProbableString) {
         ++outputWordIndex;
@@ -144,23 +393,24 @@ int Suggest::outputSuggestions(DicTraverseSession *traverseSession, int *frequen
     // Initial value of the loop index for terminal nodes (words)
     int doubleLetterTerminalIndex = -1;
     DoubleLetterLevel doubleLetterLevel = NOT_A_DOUBLE_LETTER;
-    SCORING->searchWordWithDoubleLetter(terminals, terminalSize,
+    getScoring()->searchWordWithDoubleLetter(terminals, terminalSize,
             &doubleLetterTerminalIndex, &doubleLetterLevel);
 
     int maxScore = S_INT_MIN;
     // Output suggestion results here
     for (int terminalIndex = 0; terminalIndex < terminalSize && outputWordIndex < MAX_RESULTS;
             ++terminalIndex) {
-        DicNode *terminalDicNode = &terminals[terminalIndex];
+        DicNode *terminalDicNode = terminals[terminalIndex];
         if (DEBUG_GEO_FULL) {
             terminalDicNode->dump("OUT:");
         }
-        const float doubleLetterCost = SCORING->getDoubleLetterDemotionDistanceCost(
+        const float doubleLetterCost = getScoring()->getDoubleLetterDemotionDistanceCost(
                 terminalIndex, doubleLetterTerminalIndex, doubleLetterLevel);
         const float compoundDistance = terminalDicNode->getCompoundDistance(languageWeight)
                 + doubleLetterCost;
         const TerminalAttributes terminalAttributes(traverseSession->getOffsetDict(),
-                terminalDicNode->getFlags(), terminalDicNode->getAttributesPos());
+                terminalDicNode->getFlags(), terminalDicNode->getAttributesPos(),
+                traverseSession->getShortcutTable());
         const bool isPossiblyOffensiveWord = terminalDicNode->getProbability() <= 0;
         const bool isExactMatch = terminalDicNode->isExactMatch();
         const bool isFirstCharUppercase = terminalDicNode->isFirstCharUppercase();
@@ -178,18 +428,19 @@ int Suggest::outputSuggestions(DicTraverseSession *traverseSession, int *frequen
         // Increase output score of top typing suggestion to ensure autocorrection.
         // TODO: Better integration with java side autocorrection logic.
         // Force autocorrection for obvious long multi-word suggestions.
-        const bool isForceCommitMultiWords = TRAVERSAL->allowPartialCommit()
+        const bool isForceCommitMultiWords = getTraversal()->allowPartialCommit()
                 && (traverseSession->isPartiallyCommited()
                         || (traverseSession->getInputSize() >= MIN_LEN_FOR_MULTI_WORD_AUTOCORRECT
                                 && terminalDicNode->hasMultipleWords()));
 
-        const int finalScore = SCORING->calculateFinalScore(
+        const int finalScore = getScoring()->calculateFinalScore(
                 compoundDistance, traverseSession->getInputSize(),
-                isForceCommitMultiWords || (isValidWord && SCORING->doesAutoCorrectValidWord()));
+                isForceCommitMultiWords
+                        || (isValidWord && getScoring()->doesAutoCorrectValidWord()));
 
         maxScore = max(maxScore, finalScore);
 
-        if (TRAVERSAL->allowPartialCommit()) {
+        if (getTraversal()->allowPartialCommit()) {
             // Index for top typing suggestion should be 0.
             if (isValidWord && outputWordIndex == 0) {
                 terminalDicNode->outputSpacePositionsResult(spaceIndices);
@@ -206,14 +457,16 @@ int Suggest::outputSuggestions(DicTraverseSession *traverseSession, int *frequen
             ++outputWordIndex;
         }
 
-        const bool sameAsTyped = TRAVERSAL->sameAsTyped(traverseSession, terminalDicNode);
+        const bool sameAsTyped = getTraversal()->sameAsTyped(traverseSession, terminalDicNode);
         outputWordIndex = ShortcutUtils::outputShortcuts(&terminalAttributes, outputWordIndex,
                 finalScore, outputCodePoints, frequencies, outputTypes, sameAsTyped);
-        DicNode::managedDelete(terminalDicNode);
+    }
+    if (clearsTerminals) {
+        traverseSession->getDicTraverseCache()->clearTerminals();
     }
 
     if (hasMostProbableString) {
-        SCORING->safetyNetForMostProbableString(terminalSize, maxScore,
+        getScoring()->safetyNetForMostProbableString(terminalSize, maxScore,
                 &outputCodePoints[0], &frequencies[0]);
     }
     return outputWordIndex;
@@ -223,136 +476,327 @@ int Suggest::outputSuggestions(DicTraverseSession *traverseSession, int *frequen
  * Expands the dicNodes in the current search priority queue by advancing to the possible child
  * nodes based on the next touch point(s) (or no touch points for lookahead)
  */
-void Suggest::expandCurrentDicNodes(DicTraverseSession *traverseSession) const {
-    const int inputSize = traverseSession->getInputSize();
-    DicNodeVector childDicNodes(TRAVERSAL->getDefaultExpandDicNodeSize());
-    DicNode correctionDicNode;
-
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::expandCurrentDicNodes(
+        DicTraverseSession *traverseSession) const {
     // TODO: Find more efficient caching
-    const bool shouldDepthLevelCache = TRAVERSAL->shouldDepthLevelCache(traverseSession);
+    const bool shouldDepthLevelCache = getTraversal()->shouldDepthLevelCache(traverseSession);
     if (shouldDepthLevelCache) {
         traverseSession->getDicTraverseCache()->updateLastCachedInputIndex();
     }
     if (DEBUG_CACHE) {
         AKLOGI("expandCurrentDicNodes depth level cache = %d, inputSize = %d",
-                shouldDepthLevelCache, inputSize);
+                shouldDepthLevelCache, traverseSession->getInputSize());
+    }
+    traverseSession->beginSnapshotIfNeeded();
+    if (USE_PARALLEL_EXPANSION && traverseSession->getDicTraverseCache()->activeSize()
+            >= MIN_ACTIVE_SIZE_FOR_PARALLEL_EXPANSION) {
+        expandCurrentDicNodesInParallel(traverseSession, shouldDepthLevelCache);
+        return;
     }
+    // The child vector of the session is reused so that no allocation happens per input index.
+    DicNodeVector *const childDicNodes = traverseSession->getExpansionBuffer(0)->getChildDicNodes();
+    // Reused for every popped dicNode; popActive overwrites it entirely.
+    DicNode dicNode;
     while (traverseSession->getDicTraverseCache()->activeSize() > 0) {
-        DicNode dicNode;
         traverseSession->getDicTraverseCache()->popActive(&dicNode);
         if (dicNode.isTotalInputSizeExceedingLimit()) {
+            traverseSession->getDicNodeSnapshots()->abortSnapshot();
             return;
         }
-        childDicNodes.clear();
-        const int point0Index = dicNode.getInputIndex(0);
-        const bool canDoLookAheadCorrection =
-                TRAVERSAL->canDoLookAheadCorrection(traverseSession, &dicNode);
-        const bool isLookAheadCorrection = canDoLookAheadCorrection
-                && traverseSession->getDicTraverseCache()->
-                        isLookAheadCorrectionInputIndex(static_cast<int>(point0Index));
-        const bool isCompletion = dicNode.isCompletion(inputSize);
-
-        const bool shouldNodeLevelCache =
-                TRAVERSAL->shouldNodeLevelCache(traverseSession, &dicNode);
-        if (shouldDepthLevelCache || shouldNodeLevelCache) {
-            if (DEBUG_CACHE) {
-                dicNode.dump("PUSH_CACHE");
-            }
-            traverseSession->getDicTraverseCache()->copyPushContinue(&dicNode);
-            dicNode.setCached();
+        cacheDicNodeIfNeeded(traverseSession, shouldDepthLevelCache, &dicNode);
+        expandDicNode(traverseSession, &dicNode, childDicNodes, 0 /* expansionBuffer */);
+    }
+    traverseSession->getDicNodeSnapshots()->endSnapshot();
+}
+
+// Expands a contiguous range of the popped frontier on one worker.
+template<class TraversalT, class ScoringT, class WeightingT>
+class SuggestImpl<TraversalT, ScoringT, WeightingT>::ExpansionJob
+        : public ExpansionWorkerPool::Job {
+ public:
+    ExpansionJob(const SuggestImpl *const suggest, DicTraverseSession *const traverseSession,
+            const int frontierSize, const int jobCount)
+            : mSuggest(suggest), mTraverseSession(traverseSession), mFrontierSize(frontierSize),
+              mJobCount(jobCount) {}
+
+    void run(const int jobId) {
+        std::vector<DicNode> *const frontier = mTraverseSession->getExpansionFrontier();
+        DicNodeExpansionBuffer *const expansionBuffer =
+                mTraverseSession->getExpansionBuffer(jobId);
+        expansionBuffer->clear();
+        const int begin = mFrontierSize * jobId / mJobCount;
+        const int end = mFrontierSize * (jobId + 1) / mJobCount;
+        for (int i = begin; i < end; ++i) {
+            mSuggest->expandDicNode(mTraverseSession, &(*frontier)[i],
+                    expansionBuffer->getChildDicNodes(), expansionBuffer);
         }
+    }
 
-        if (dicNode.isInDigraph()) {
-            // Finish digraph handling if the node is in the middle of a digraph expansion.
-            processDicNodeAsDigraph(traverseSession, &dicNode);
-        } else if (isLookAheadCorrection) {
-            // The algorithm maintains a small set of "deferred" nodes that have not consumed the
-            // latest touch point yet. These are needed to apply look-ahead correction operations
-            // that require special handling of the latest touch point. For example, with insertions
-            // (e.g., "thiis" -> "this") the latest touch point should not be consumed at all.
-            processDicNodeAsTransposition(traverseSession, &dicNode);
-            processDicNodeAsInsertion(traverseSession, &dicNode);
-        } else { // !isLookAheadCorrection
-            // Only consider typing error corrections if the normalized compound distance is
-            // below a spatial distance threshold.
-            // NOTE: the threshold may need to be updated if scoring model changes.
-            // TODO: Remove. Do not prune node here.
-            const bool allowsErrorCorrections = TRAVERSAL->allowsErrorCorrections(&dicNode);
-            // Process for handling space substitution (e.g., hevis => he is)
-            if (allowsErrorCorrections
-                    && TRAVERSAL->isSpaceSubstitutionTerminal(traverseSession, &dicNode)) {
-                createNextWordDicNode(traverseSession, &dicNode, true /* spaceSubstitution */);
-            }
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ExpansionJob);
+    const SuggestImpl *const mSuggest;
+    DicTraverseSession *const mTraverseSession;
+    const int mFrontierSize;
+    const int mJobCount;
+};
 
-            DicNodeUtils::getAllChildDicNodes(
-                    &dicNode, traverseSession->getOffsetDict(), &childDicNodes);
-
-            const int childDicNodesSize = childDicNodes.getSizeAndLock();
-            for (int i = 0; i < childDicNodesSize; ++i) {
-                DicNode *const childDicNode = childDicNodes[i];
-                if (isCompletion) {
-                    // Handle forward lookahead when the lexicon letter exceeds the input size.
-                    processDicNodeAsMatch(traverseSession, childDicNode);
-                    continue;
-                }
-                if (DigraphUtils::hasDigraphForCodePoint(traverseSession->getDictFlags(),
-                        childDicNode->getNodeCodePoint())) {
-                    correctionDicNode.initByCopy(childDicNode);
-                    correctionDicNode.advanceDigraphIndex();
-                    processDicNodeAsDigraph(traverseSession, &correctionDicNode);
-                }
-                if (TRAVERSAL->isOmission(traverseSession, &dicNode, childDicNode,
-                        allowsErrorCorrections)) {
-                    // TODO: (Gesture) Change weight between omission and substitution errors
-                    // TODO: (Gesture) Terminal node should not be handled as omission
-                    correctionDicNode.initByCopy(childDicNode);
-                    processDicNodeAsOmission(traverseSession, &correctionDicNode);
-                }
-                const ProximityType proximityType = TRAVERSAL->getProximityType(
-                        traverseSession, &dicNode, childDicNode);
-                switch (proximityType) {
-                    // TODO: Consider the difference of proximityType here
-                    case MATCH_CHAR:
-                    case PROXIMITY_CHAR:
-                        processDicNodeAsMatch(traverseSession, childDicNode);
-                        break;
-                    case ADDITIONAL_PROXIMITY_CHAR:
-                        if (allowsErrorCorrections) {
-                            processDicNodeAsAdditionalProximityChar(traverseSession, &dicNode,
-                                    childDicNode);
-                        }
-                        break;
-                    case SUBSTITUTION_CHAR:
-                        if (allowsErrorCorrections) {
-                            processDicNodeAsSubstitution(traverseSession, &dicNode, childDicNode);
-                        }
-                        break;
-                    case UNRELATED_CHAR:
-                        // Just drop this node and do nothing.
-                        break;
-                    default:
-                        // Just drop this node and do nothing.
-                        break;
-                }
-            }
+/**
+ * Same as the sequential loop of expandCurrentDicNodes, but the popped frontier is split across
+ * the worker pool. Workers only read the session; what they would push to the cache is recorded
+ * into a buffer per worker and applied afterwards in the frontier order, which gives the same
+ * result as the sequential expansion.
+ */
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::expandCurrentDicNodesInParallel(
+        DicTraverseSession *traverseSession, const bool shouldDepthLevelCache) const {
+    std::vector<DicNode> *const frontier = traverseSession->getExpansionFrontier();
+    int frontierSize = 0;
+    while (traverseSession->getDicTraverseCache()->activeSize() > 0) {
+        if (frontierSize == static_cast<int>(frontier->size())) {
+            frontier->push_back(DicNode());
+        }
+        DicNode *const dicNode = &(*frontier)[frontierSize];
+        traverseSession->getDicTraverseCache()->popActive(dicNode);
+        if (dicNode->isTotalInputSizeExceedingLimit()) {
+            traverseSession->getDicNodeSnapshots()->abortSnapshot();
+            break;
+        }
+        cacheDicNodeIfNeeded(traverseSession, shouldDepthLevelCache, dicNode);
+        ++frontierSize;
+    }
+    traverseSession->getDicNodeSnapshots()->endSnapshot();
+    const int jobCount = min(traverseSession->getExpansionWorkerPool()->getMaxJobCount(),
+            (frontierSize + MIN_ACTIVE_SIZE_FOR_PARALLEL_EXPANSION - 1)
+                    / MIN_ACTIVE_SIZE_FOR_PARALLEL_EXPANSION);
+    if (jobCount <= 0) {
+        return;
+    }
+    ExpansionJob job(this, traverseSession, frontierSize, jobCount);
+    // The workers share the session, so they must not fill its spatial cost cache.
+    traverseSession->getSpatialCostCache()->setReadOnly(true);
+    traverseSession->getExpansionWorkerPool()->runAndWait(&job, jobCount);
+    traverseSession->getSpatialCostCache()->setReadOnly(false);
+    for (int i = 0; i < jobCount; ++i) {
+        applyExpansionBuffer(traverseSession, traverseSession->getExpansionBuffer(i));
+    }
+}
+
+/**
+ * Pushes the popped active dicNode to the cache for continuous suggestion if the traversal
+ * policy requires it, and adds it to the snapshot of the current input index if one is being
+ * recorded.
+ */
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::cacheDicNodeIfNeeded(
+        DicTraverseSession *traverseSession, const bool shouldDepthLevelCache,
+        DicNode *dicNode) const {
+    if (traverseSession->getDicNodeSnapshots()->isRecording()) {
+        traverseSession->getDicNodeSnapshots()->add(dicNode);
+    }
+    const bool shouldNodeLevelCache =
+            getTraversal()->shouldNodeLevelCache(traverseSession, dicNode);
+    if (shouldDepthLevelCache || shouldNodeLevelCache) {
+        if (DEBUG_CACHE) {
+            dicNode->dump("PUSH_CACHE");
+        }
+        traverseSession->getDicTraverseCache()->copyPushContinue(dicNode);
+        dicNode->setCached();
+    }
+}
+
+/**
+ * Expands one popped active dicNode. When expansionBuffer is not null, the outputs are recorded
+ * there instead of being pushed to the cache, so that this can run on a worker thread.
+ */
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::expandDicNode(
+        DicTraverseSession *traverseSession, DicNode *dicNode, DicNodeVector *childDicNodes,
+        DicNodeExpansionBuffer *expansionBuffer) const {
+    const int inputSize = traverseSession->getInputSize();
+    DicNode correctionDicNode;
+    childDicNodes->clear();
+    const int point0Index = dicNode->getInputIndex(0);
+    const bool canDoLookAheadCorrection =
+            getTraversal()->canDoLookAheadCorrection(traverseSession, dicNode);
+    const bool isLookAheadCorrection = canDoLookAheadCorrection
+            && traverseSession->getDicTraverseCache()->
+                    isLookAheadCorrectionInputIndex(static_cast<int>(point0Index));
+    const bool isCompletion = dicNode->isCompletion(inputSize);
+
+    if (dicNode->isInDigraph()) {
+        // Finish digraph handling if the node is in the middle of a digraph expansion.
+        processDicNodeAsDigraph(traverseSession, dicNode, expansionBuffer);
+    } else if (isLookAheadCorrection) {
+        // The algorithm maintains a small set of "deferred" nodes that have not consumed the
+        // latest touch point yet. These are needed to apply look-ahead correction operations
+        // that require special handling of the latest touch point. For example, with insertions
+        // (e.g., "thiis" -> "this") the latest touch point should not be consumed at all.
+        processDicNodeAsTransposition(traverseSession, dicNode, expansionBuffer);
+        processDicNodeAsInsertion(traverseSession, dicNode, expansionBuffer);
+    } else { // !isLookAheadCorrection
+        // Only consider typing error corrections if the normalized compound distance is
+        // below a spatial distance threshold.
+        // NOTE: the threshold may need to be updated if scoring model changes.
+        // TODO: Remove. Do not prune node here.
+        const bool allowsErrorCorrections =
+                getTraversal()->allowsErrorCorrections(traverseSession, dicNode);
+        // Process for handling space substitution (e.g., hevis => he is)
+        if (allowsErrorCorrections
+                && getTraversal()->isSpaceSubstitutionTerminal(traverseSession, dicNode)) {
+            createNextWordDicNode(traverseSession, dicNode, true /* spaceSubstitution */,
+                    expansionBuffer);
+        }
+
+        DicNodeUtils::getAllChildDicNodes(dicNode, traverseSession->getOffsetDict(),
+                traverseSession->getDecodedNodeIndex(),
+                getChildrenCache(traverseSession, expansionBuffer), childDicNodes);
 
-            // Push the node for look-ahead correction
-            if (allowsErrorCorrections && canDoLookAheadCorrection) {
-                traverseSession->getDicTraverseCache()->copyPushNextActive(&dicNode);
+        // Most dictionaries have no digraphs, which skips the test of each child.
+        const DigraphCodePointSet *const digraphCodePoints =
+                traverseSession->getDigraphCodePoints();
+        const bool hasDigraphs = !digraphCodePoints->isEmpty();
+        // The second pass of a two-pass search only follows the words of the first one.
+        const bool hasCandidatePaths = traverseSession->hasCandidatePaths();
+        const int childDicNodesSize = childDicNodes->getSizeAndLock();
+        for (int i = 0; i < childDicNodesSize; ++i) {
+            DicNode *const childDicNode = (*childDicNodes)[i];
+            if (hasCandidatePaths && !traverseSession->isOnCandidatePath(childDicNode)) {
+                continue;
+            }
+            if (isCompletion) {
+                // Handle forward lookahead when the lexicon letter exceeds the input size.
+                processDicNodeAsMatch(traverseSession, childDicNode, expansionBuffer);
+                continue;
+            }
+            if (hasDigraphs && digraphCodePoints->contains(childDicNode->getNodeCodePoint())) {
+                correctionDicNode.initByCopy(childDicNode);
+                correctionDicNode.advanceDigraphIndex();
+                processDicNodeAsDigraph(traverseSession, &correctionDicNode, expansionBuffer);
+            }
+            if (getTraversal()->isOmission(traverseSession, dicNode, childDicNode,
+                    allowsErrorCorrections)) {
+                // TODO: (Gesture) Change weight between omission and substitution errors
+                // TODO: (Gesture) Terminal node should not be handled as omission
+                correctionDicNode.initByCopy(childDicNode);
+                processDicNodeAsOmission(traverseSession, &correctionDicNode, expansionBuffer);
+            }
+            const ProximityType proximityType = getTraversal()->getProximityType(
+                    traverseSession, dicNode, childDicNode);
+            switch (proximityType) {
+                // TODO: Consider the difference of proximityType here
+                case MATCH_CHAR:
+                case PROXIMITY_CHAR:
+                    processDicNodeAsMatch(traverseSession, childDicNode, expansionBuffer);
+                    break;
+                case ADDITIONAL_PROXIMITY_CHAR:
+                    if (allowsErrorCorrections) {
+                        processDicNodeAsAdditionalProximityChar(traverseSession, dicNode,
+                                childDicNode, expansionBuffer);
+                    }
+                    break;
+                case SUBSTITUTION_CHAR:
+                    if (allowsErrorCorrections) {
+                        processDicNodeAsSubstitution(traverseSession, dicNode, childDicNode,
+                                expansionBuffer);
+                    }
+                    break;
+                case UNRELATED_CHAR:
+                    // Just drop this node and do nothing.
+                    break;
+                default:
+                    // Just drop this node and do nothing.
+                    break;
             }
         }
+
+        // Push the node for look-ahead correction
+        if (allowsErrorCorrections && canDoLookAheadCorrection) {
+            pushNextActiveDicNode(traverseSession, dicNode, expansionBuffer);
+        }
+    }
+}
+
+/**
+ * Applies the outputs recorded by expandDicNode on a worker thread.
+ */
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::applyExpansionBuffer(
+        DicTraverseSession *traverseSession, DicNodeExpansionBuffer *expansionBuffer) const {
+    const int size = expansionBuffer->getSize();
+    for (int i = 0; i < size; ++i) {
+        DicNode *const dicNode = expansionBuffer->getDicNodeAt(i);
+        switch (expansionBuffer->getOutputTypeAt(i)) {
+            case DicNodeExpansionBuffer::OUTPUT_NEXT_ACTIVE:
+                pushNextActiveDicNode(traverseSession, dicNode, 0 /* expansionBuffer */);
+                break;
+            case DicNodeExpansionBuffer::OUTPUT_TERMINAL:
+                processTerminalDicNode(traverseSession, dicNode, 0 /* expansionBuffer */);
+                break;
+            case DicNodeExpansionBuffer::OUTPUT_NEXT_WORD:
+                createNextWordDicNode(traverseSession, dicNode, false /* spaceSubstitution */,
+                        0 /* expansionBuffer */);
+                break;
+            case DicNodeExpansionBuffer::OUTPUT_NEXT_WORD_BY_SPACE_SUBSTITUTION:
+                createNextWordDicNode(traverseSession, dicNode, true /* spaceSubstitution */,
+                        0 /* expansionBuffer */);
+                break;
+            default:
+                ASSERT(false);
+                break;
+        }
+    }
+    expansionBuffer->clear();
+}
+
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::pushNextActiveDicNode(
+        DicTraverseSession *traverseSession, DicNode *dicNode,
+        DicNodeExpansionBuffer *expansionBuffer) const {
+    if (expansionBuffer) {
+        expansionBuffer->push(DicNodeExpansionBuffer::OUTPUT_NEXT_ACTIVE, dicNode);
+        return;
+    }
+    if (isPrunedByLowerBound(traverseSession, dicNode)) {
+        traverseSession->getDicTraverseCache()->dropPrunedDicNode(dicNode);
+        return;
     }
+    traverseSession->getDicTraverseCache()->copyPushNextActive(dicNode);
 }
 
-void Suggest::processTerminalDicNode(
+/**
+ * Returns whether the dicNode cannot end up in the terminal queue, as its distance plus a lower
+ * bound of the cost of the rest of the input is worse than the worst terminal of the full queue.
+ * The compound distance of the typing policies only grows, so terminals and next words of the
+ * dicNode are never better than this.
+ */
+template<class TraversalT, class ScoringT, class WeightingT>
+bool SuggestImpl<TraversalT, ScoringT, WeightingT>::isPrunedByLowerBound(
         DicTraverseSession *traverseSession, DicNode *dicNode) const {
+    if (!USE_LOWER_BOUND_PRUNING) {
+        return false;
+    }
+    float worstTerminalDistance = 0.0f;
+    if (!traverseSession->getDicTraverseCache()->getWorstTerminalDistance(
+            &worstTerminalDistance)) {
+        return false;
+    }
+    return dicNode->getNormalizedCompoundDistance()
+            + getTraversal()->getMinRemainingCost(traverseSession, dicNode)
+            > worstTerminalDistance + LOWER_BOUND_PRUNING_MARGIN;
+}
+
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::processTerminalDicNode(
+        DicTraverseSession *traverseSession, DicNode *dicNode,
+        DicNodeExpansionBuffer *expansionBuffer) const {
     if (dicNode->getCompoundDistance() >= static_cast<float>(MAX_VALUE_FOR_WEIGHTING)) {
         return;
     }
     if (!dicNode->isTerminalWordNode()) {
         return;
     }
-    if (TRAVERSAL->needsToTraverseAllUserInput()
+    if (getTraversal()->needsToTraverseAllUserInput()
             && dicNode->getInputIndex(0) < traverseSession->getInputSize()) {
         return;
     }
@@ -360,10 +804,15 @@ void Suggest::processTerminalDicNode(
     if (dicNode->shouldBeFilterdBySafetyNetForBigram()) {
         return;
     }
+    if (expansionBuffer) {
+        // Weighting as a terminal looks up the bigram map, which is not thread safe.
+        expansionBuffer->push(DicNodeExpansionBuffer::OUTPUT_TERMINAL, dicNode);
+        return;
+    }
     // Create a non-cached node here.
     DicNode terminalDicNode;
     DicNodeUtils::initByCopy(dicNode, &terminalDicNode);
-    Weighting::addCostAndForwardInputIndex(WEIGHTING, CT_TERMINAL, traverseSession, 0,
+    Weighting::addCostAndForwardInputIndex(getWeighting(), CT_TERMINAL, traverseSession, 0,
             &terminalDicNode, traverseSession->getMultiBigramMap());
     traverseSession->getDicTraverseCache()->copyPushTerminal(&terminalDicNode);
 }
@@ -372,54 +821,65 @@ void Suggest::processTerminalDicNode(
  * Adds the expanded dicNode to the next search priority queue. Also creates an additional next word
  * (by the space omission error correction) search path if input dicNode is on a terminal node.
  */
-void Suggest::processExpandedDicNode(
-        DicTraverseSession *traverseSession, DicNode *dicNode) const {
-    processTerminalDicNode(traverseSession, dicNode);
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::processExpandedDicNode(
+        DicTraverseSession *traverseSession, DicNode *dicNode,
+        DicNodeExpansionBuffer *expansionBuffer) const {
+    processTerminalDicNode(traverseSession, dicNode, expansionBuffer);
     if (dicNode->getCompoundDistance() < static_cast<float>(MAX_VALUE_FOR_WEIGHTING)) {
-        if (TRAVERSAL->isSpaceOmissionTerminal(traverseSession, dicNode)) {
-            createNextWordDicNode(traverseSession, dicNode, false /* spaceSubstitution */);
+        if (getTraversal()->isSpaceOmissionTerminal(traverseSession, dicNode)) {
+            createNextWordDicNode(traverseSession, dicNode, false /* spaceSubstitution */,
+                    expansionBuffer);
         }
         const int allowsLookAhead = !(dicNode->hasMultipleWords()
                 && dicNode->isCompletion(traverseSession->getInputSize()));
         if (dicNode->hasChildren() && allowsLookAhead) {
-            traverseSession->getDicTraverseCache()->copyPushNextActive(dicNode);
+            pushNextActiveDicNode(traverseSession, dicNode, expansionBuffer);
         }
     }
     DicNode::managedDelete(dicNode);
 }
 
-void Suggest::processDicNodeAsMatch(DicTraverseSession *traverseSession,
-        DicNode *childDicNode) const {
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::processDicNodeAsMatch(
+        DicTraverseSession *traverseSession, DicNode *childDicNode,
+        DicNodeExpansionBuffer *expansionBuffer) const {
     weightChildNode(traverseSession, childDicNode);
-    processExpandedDicNode(traverseSession, childDicNode);
+    processExpandedDicNode(traverseSession, childDicNode, expansionBuffer);
 }
 
-void Suggest::processDicNodeAsAdditionalProximityChar(DicTraverseSession *traverseSession,
-        DicNode *dicNode, DicNode *childDicNode) const {
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::processDicNodeAsAdditionalProximityChar(
+        DicTraverseSession *traverseSession, DicNode *dicNode, DicNode *childDicNode,
+        DicNodeExpansionBuffer *expansionBuffer) const {
     // Note: Most types of corrections don't need to look up the bigram information since they do
     // not treat the node as a terminal. There is no need to pass the bigram map in these cases.
-    Weighting::addCostAndForwardInputIndex(WEIGHTING, CT_ADDITIONAL_PROXIMITY,
+    Weighting::addCostAndForwardInputIndex(getWeighting(), CT_ADDITIONAL_PROXIMITY,
             traverseSession, dicNode, childDicNode, 0 /* multiBigramMap */);
     weightChildNode(traverseSession, childDicNode);
-    processExpandedDicNode(traverseSession, childDicNode);
+    processExpandedDicNode(traverseSession, childDicNode, expansionBuffer);
 }
 
-void Suggest::processDicNodeAsSubstitution(DicTraverseSession *traverseSession,
-        DicNode *dicNode, DicNode *childDicNode) const {
-    Weighting::addCostAndForwardInputIndex(WEIGHTING, CT_SUBSTITUTION, traverseSession,
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::processDicNodeAsSubstitution(
+        DicTraverseSession *traverseSession, DicNode *dicNode, DicNode *childDicNode,
+        DicNodeExpansionBuffer *expansionBuffer) const {
+    Weighting::addCostAndForwardInputIndex(getWeighting(), CT_SUBSTITUTION, traverseSession,
             dicNode, childDicNode, 0 /* multiBigramMap */);
     weightChildNode(traverseSession, childDicNode);
-    processExpandedDicNode(traverseSession, childDicNode);
+    processExpandedDicNode(traverseSession, childDicNode, expansionBuffer);
 }
 
 // Process the node codepoint as a digraph. This means that composite glyphs like the German
 // u-umlaut is expanded to the transliteration "ue". Note that this happens in parallel with
 // the normal non-digraph traversal, so both "uber" and "ueber" can be corrected to "[u-umlaut]ber".
-void Suggest::processDicNodeAsDigraph(DicTraverseSession *traverseSession,
-        DicNode *childDicNode) const {
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::processDicNodeAsDigraph(
+        DicTraverseSession *traverseSession, DicNode *childDicNode,
+        DicNodeExpansionBuffer *expansionBuffer) const {
     weightChildNode(traverseSession, childDicNode);
     childDicNode->advanceDigraphIndex();
-    processExpandedDicNode(traverseSession, childDicNode);
+    processExpandedDicNode(traverseSession, childDicNode, expansionBuffer);
 }
 
 /**
@@ -429,23 +889,29 @@ void Suggest::processDicNodeAsDigraph(DicTraverseSession *traverseSession,
  * the possible *next* letters after the omission to better limit search to plausible omissions.
  * Note that apostrophes are handled as omissions.
  */
-void Suggest::processDicNodeAsOmission(
-        DicTraverseSession *traverseSession, DicNode *dicNode) const {
-    DicNodeVector childDicNodes;
-    DicNodeUtils::getAllChildDicNodes(dicNode, traverseSession->getOffsetDict(), &childDicNodes);
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::processDicNodeAsOmission(
+        DicTraverseSession *traverseSession, DicNode *dicNode,
+        DicNodeExpansionBuffer *expansionBuffer) const {
+    DicNodeExpansionBuffer *const workerBuffer = getWorkerBuffer(traverseSession, expansionBuffer);
+    DicNodeVector *const childDicNodes = workerBuffer->getCorrectionDicNodes();
+    childDicNodes->clear();
+    DicNodeUtils::getAllChildDicNodes(dicNode, traverseSession->getOffsetDict(),
+            traverseSession->getDecodedNodeIndex(), workerBuffer->getChildrenCache(),
+            childDicNodes);
 
-    const int size = childDicNodes.getSizeAndLock();
+    const int size = childDicNodes->getSizeAndLock();
     for (int i = 0; i < size; i++) {
-        DicNode *const childDicNode = childDicNodes[i];
+        DicNode *const childDicNode = (*childDicNodes)[i];
         // Treat this word as omission
-        Weighting::addCostAndForwardInputIndex(WEIGHTING, CT_OMISSION, traverseSession,
+        Weighting::addCostAndForwardInputIndex(getWeighting(), CT_OMISSION, traverseSession,
                 dicNode, childDicNode, 0 /* multiBigramMap */);
         weightChildNode(traverseSession, childDicNode);
 
-        if (!TRAVERSAL->isPossibleOmissionChildNode(traverseSession, dicNode, childDicNode)) {
+        if (!getTraversal()->isPossibleOmissionChildNode(traverseSession, dicNode, childDicNode)) {
             continue;
         }
-        processExpandedDicNode(traverseSession, childDicNode);
+        processExpandedDicNode(traverseSession, childDicNode, expansionBuffer);
     }
 }
 
@@ -453,59 +919,77 @@ void Suggest::processDicNodeAsOmission(
  * Handle the dicNode as an insertion error (e.g., thiis => this). Skip the current touch point and
  * consider matches for the next touch point.
  */
-void Suggest::processDicNodeAsInsertion(DicTraverseSession *traverseSession,
-        DicNode *dicNode) const {
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::processDicNodeAsInsertion(
+        DicTraverseSession *traverseSession, DicNode *dicNode,
+        DicNodeExpansionBuffer *expansionBuffer) const {
     const int16_t pointIndex = dicNode->getInputIndex(0);
-    DicNodeVector childDicNodes;
+    DicNodeExpansionBuffer *const workerBuffer = getWorkerBuffer(traverseSession, expansionBuffer);
+    DicNodeVector *const childDicNodes = workerBuffer->getCorrectionDicNodes();
+    childDicNodes->clear();
     DicNodeUtils::getProximityChildDicNodes(dicNode, traverseSession->getOffsetDict(),
-            traverseSession->getProximityInfoState(0), pointIndex + 1, true, &childDicNodes);
-    const int size = childDicNodes.getSizeAndLock();
+            traverseSession->getProximityInfoState(0), pointIndex + 1, true,
+            traverseSession->getDecodedNodeIndex(), workerBuffer->getChildrenCache(),
+            childDicNodes);
+    const int size = childDicNodes->getSizeAndLock();
     for (int i = 0; i < size; i++) {
-        DicNode *const childDicNode = childDicNodes[i];
-        Weighting::addCostAndForwardInputIndex(WEIGHTING, CT_INSERTION, traverseSession,
+        DicNode *const childDicNode = (*childDicNodes)[i];
+        Weighting::addCostAndForwardInputIndex(getWeighting(), CT_INSERTION, traverseSession,
                 dicNode, childDicNode, 0 /* multiBigramMap */);
-        processExpandedDicNode(traverseSession, childDicNode);
+        processExpandedDicNode(traverseSession, childDicNode, expansionBuffer);
     }
 }
 
 /**
  * Handle the dicNode as a transposition error (e.g., thsi => this). Swap the next two touch points.
  */
-void Suggest::processDicNodeAsTransposition(DicTraverseSession *traverseSession,
-        DicNode *dicNode) const {
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::processDicNodeAsTransposition(
+        DicTraverseSession *traverseSession, DicNode *dicNode,
+        DicNodeExpansionBuffer *expansionBuffer) const {
     const int16_t pointIndex = dicNode->getInputIndex(0);
-    DicNodeVector childDicNodes1;
+    const DecodedNodeIndex *const nodeIndex = traverseSession->getDecodedNodeIndex();
+    DicNodeExpansionBuffer *const workerBuffer = getWorkerBuffer(traverseSession, expansionBuffer);
+    DicNodeChildrenCache *const childrenCache = workerBuffer->getChildrenCache();
+    DicNodeVector *const childDicNodes1 = workerBuffer->getCorrectionDicNodes();
+    DicNodeVector *const childDicNodes2 = workerBuffer->getTranspositionDicNodes();
+    childDicNodes1->clear();
     DicNodeUtils::getProximityChildDicNodes(dicNode, traverseSession->getOffsetDict(),
-            traverseSession->getProximityInfoState(0), pointIndex + 1, false, &childDicNodes1);
-    const int childSize1 = childDicNodes1.getSizeAndLock();
+            traverseSession->getProximityInfoState(0), pointIndex + 1, false, nodeIndex,
+            childrenCache, childDicNodes1);
+    const int childSize1 = childDicNodes1->getSizeAndLock();
     for (int i = 0; i < childSize1; i++) {
-        if (childDicNodes1[i]->hasChildren()) {
-            DicNodeVector childDicNodes2;
+        DicNode *const childDicNode1 = (*childDicNodes1)[i];
+        if (childDicNode1->hasChildren()) {
+            childDicNodes2->clear();
             DicNodeUtils::getProximityChildDicNodes(
-                    childDicNodes1[i], traverseSession->getOffsetDict(),
-                    traverseSession->getProximityInfoState(0), pointIndex, false, &childDicNodes2);
-            const int childSize2 = childDicNodes2.getSizeAndLock();
+                    childDicNode1, traverseSession->getOffsetDict(),
+                    traverseSession->getProximityInfoState(0), pointIndex, false, nodeIndex,
+                    childrenCache, childDicNodes2);
+            const int childSize2 = childDicNodes2->getSizeAndLock();
             for (int j = 0; j < childSize2; j++) {
-                DicNode *const childDicNode2 = childDicNodes2[j];
-                Weighting::addCostAndForwardInputIndex(WEIGHTING, CT_TRANSPOSITION,
-                        traverseSession, childDicNodes1[i], childDicNode2, 0 /* multiBigramMap */);
-                processExpandedDicNode(traverseSession, childDicNode2);
+                DicNode *const childDicNode2 = (*childDicNodes2)[j];
+                Weighting::addCostAndForwardInputIndex(getWeighting(), CT_TRANSPOSITION,
+                        traverseSession, childDicNode1, childDicNode2, 0 /* multiBigramMap */);
+                processExpandedDicNode(traverseSession, childDicNode2, expansionBuffer);
             }
         }
-        DicNode::managedDelete(childDicNodes1[i]);
+        DicNode::managedDelete(childDicNode1);
     }
 }
 
 /**
  * Weight child node by aligning it to the key
  */
-void Suggest::weightChildNode(DicTraverseSession *traverseSession, DicNode *dicNode) const {
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::weightChildNode(
+        DicTraverseSession *traverseSession, DicNode *dicNode) const {
     const int inputSize = traverseSession->getInputSize();
     if (dicNode->isCompletion(inputSize)) {
-        Weighting::addCostAndForwardInputIndex(WEIGHTING, CT_COMPLETION, traverseSession,
+        Weighting::addCostAndForwardInputIndex(getWeighting(), CT_COMPLETION, traverseSession,
                 0 /* parentDicNode */, dicNode, 0 /* multiBigramMap */);
     } else { // completion
-        Weighting::addCostAndForwardInputIndex(WEIGHTING, CT_MATCH, traverseSession,
+        Weighting::addCostAndForwardInputIndex(getWeighting(), CT_MATCH, traverseSession,
                 0 /* parentDicNode */, dicNode, 0 /* multiBigramMap */);
     }
 }
@@ -514,20 +998,34 @@ void Suggest::weightChildNode(DicTraverseSession *traverseSession, DicNode *dicN
  * Creates a new dicNode that represents a space insertion at the end of the input dicNode. Also
  * incorporates the unigram / bigram score for the ending word into the new dicNode.
  */
-void Suggest::createNextWordDicNode(DicTraverseSession *traverseSession, DicNode *dicNode,
-        const bool spaceSubstitution) const {
-    if (!TRAVERSAL->isGoodToTraverseNextWord(dicNode)) {
+template<class TraversalT, class ScoringT, class WeightingT>
+void SuggestImpl<TraversalT, ScoringT, WeightingT>::createNextWordDicNode(
+        DicTraverseSession *traverseSession, DicNode *dicNode, const bool spaceSubstitution,
+        DicNodeExpansionBuffer *expansionBuffer) const {
+    if (!getTraversal()->isGoodToTraverseNextWord(dicNode)
+            || traverseSession->getPrevWordChains()->isFull()) {
+        return;
+    }
+    if (expansionBuffer) {
+        // The bigram cost of the ending word looks up the bigram map, which is not thread safe.
+        expansionBuffer->push(spaceSubstitution
+                ? DicNodeExpansionBuffer::OUTPUT_NEXT_WORD_BY_SPACE_SUBSTITUTION
+                : DicNodeExpansionBuffer::OUTPUT_NEXT_WORD, dicNode);
         return;
     }
 
     // Create a non-cached node here.
     DicNode newDicNode;
     DicNodeUtils::initAsRootWithPreviousWord(traverseSession->getDicRootPos(),
-            traverseSession->getOffsetDict(), dicNode, &newDicNode);
+            traverseSession->getOffsetDict(), traverseSession->getPrevWordChains(), dicNode,
+            &newDicNode);
     const CorrectionType correctionType = spaceSubstitution ?
             CT_NEW_WORD_SPACE_SUBSTITUTION : CT_NEW_WORD_SPACE_OMITTION;
-    Weighting::addCostAndForwardInputIndex(WEIGHTING, correctionType, traverseSession, dicNode,
+    Weighting::addCostAndForwardInputIndex(getWeighting(), correctionType, traverseSession, dicNode,
             &newDicNode, traverseSession->getMultiBigramMap());
-    traverseSession->getDicTraverseCache()->copyPushNextActive(&newDicNode);
+    pushNextActiveDicNode(traverseSession, &newDicNode, 0 /* expansionBuffer */);
 }
+
+template class SuggestImpl<Traversal, Scoring, Weighting>;
+template class SuggestImpl<TypingTraversal, TypingScoring, TypingWeighting>;
 } // namespace latinime
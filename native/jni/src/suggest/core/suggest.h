@@ -33,48 +33,102 @@ namespace latinime {
 //       priority of a suggested word
 
 class DicNode;
+class DicNodeExpansionBuffer;
+class DicNodeVector;
 class DicTraverseSession;
 class ProximityInfo;
 class Scoring;
 class Traversal;
+class TypingScoring;
+class TypingTraversal;
+class TypingWeighting;
 class Weighting;
 
-class Suggest : public SuggestInterface {
+/**
+ * The search for the traversal, scoring and weighting policies of the given types. Suggest takes
+ * the policies of any SuggestPolicy and calls them virtually, e.g. for the gesture policy that is
+ * plugged in. TypingSuggest is specialized for the typing policies: it uses their static
+ * instances, whose types are known at compile time, so that their calls are bound statically and
+ * inlined into the expansion.
+ * The methods are defined and instantiated for both in suggest.cpp.
+ */
+template<class TraversalT, class ScoringT, class WeightingT>
+class SuggestImpl : public SuggestInterface {
  public:
-    AK_FORCE_INLINE Suggest(const SuggestPolicy *const suggestPolicy)
+    AK_FORCE_INLINE SuggestImpl(const SuggestPolicy *const suggestPolicy)
             : TRAVERSAL(suggestPolicy ? suggestPolicy->getTraversal() : 0),
               SCORING(suggestPolicy ? suggestPolicy->getScoring() : 0),
               WEIGHTING(suggestPolicy ? suggestPolicy->getWeighting() : 0) {}
-    AK_FORCE_INLINE virtual ~Suggest() {}
+    AK_FORCE_INLINE virtual ~SuggestImpl() {}
     int getSuggestions(ProximityInfo *pInfo, void *traverseSession, int *inputXs, int *inputYs,
             int *times, int *pointerIds, int *inputCodePoints, int inputSize, int commitPoint,
             int *outWords, int *frequencies, int *outputIndices, int *outputTypes) const;
+    int speculateNextInput(ProximityInfo *pInfo, void *traverseSession, int *inputXs,
+            int *inputYs, int *times, int *pointerIds, int *inputCodePoints, int inputSize,
+            int maxStepCount) const;
 
  private:
-    DISALLOW_IMPLICIT_CONSTRUCTORS(Suggest);
+    DISALLOW_IMPLICIT_CONSTRUCTORS(SuggestImpl);
+    // Defined in suggest.cpp
+    class ExpansionJob;
+
+    // The policies of the search. Specialized in suggest.cpp for Suggest, which uses the ones of
+    // its SuggestPolicy.
+    AK_FORCE_INLINE const TraversalT *getTraversal() const {
+        return TraversalT::getInstance();
+    }
+    AK_FORCE_INLINE const ScoringT *getScoring() const {
+        return ScoringT::getInstance();
+    }
+    AK_FORCE_INLINE const WeightingT *getWeighting() const {
+        return WeightingT::getInstance();
+    }
+
+    int getMaxCacheSize(const DicTraverseSession *const traverseSession) const;
     void createNextWordDicNode(DicTraverseSession *traverseSession, DicNode *dicNode,
-            const bool spaceSubstitution) const;
+            const bool spaceSubstitution, DicNodeExpansionBuffer *expansionBuffer) const;
     int outputSuggestions(DicTraverseSession *traverseSession, int *frequencies,
-            int *outputCodePoints, int *outputIndices, int *outputTypes) const;
+            int *outputCodePoints, int *outputIndices, int *outputTypes,
+            const bool clearsTerminals) const;
     void initializeSearch(DicTraverseSession *traverseSession, int commitPoint) const;
+    bool searchCoarsePass(DicTraverseSession *traverseSession, int *inputXs, int *inputYs,
+            int *times, int *pointerIds, int *inputCodePoints, int inputSize,
+            const int cacheSize) const;
     void expandCurrentDicNodes(DicTraverseSession *traverseSession) const;
-    void processTerminalDicNode(DicTraverseSession *traverseSession, DicNode *dicNode) const;
-    void processExpandedDicNode(DicTraverseSession *traverseSession, DicNode *dicNode) const;
+    void expandCurrentDicNodesInParallel(DicTraverseSession *traverseSession,
+            const bool shouldDepthLevelCache) const;
+    void cacheDicNodeIfNeeded(DicTraverseSession *traverseSession,
+            const bool shouldDepthLevelCache, DicNode *dicNode) const;
+    void expandDicNode(DicTraverseSession *traverseSession, DicNode *dicNode,
+            DicNodeVector *childDicNodes, DicNodeExpansionBuffer *expansionBuffer) const;
+    void applyExpansionBuffer(DicTraverseSession *traverseSession,
+            DicNodeExpansionBuffer *expansionBuffer) const;
+    void pushNextActiveDicNode(DicTraverseSession *traverseSession, DicNode *dicNode,
+            DicNodeExpansionBuffer *expansionBuffer) const;
+    bool isPrunedByLowerBound(DicTraverseSession *traverseSession, DicNode *dicNode) const;
+    void processTerminalDicNode(DicTraverseSession *traverseSession, DicNode *dicNode,
+            DicNodeExpansionBuffer *expansionBuffer) const;
+    void processExpandedDicNode(DicTraverseSession *traverseSession, DicNode *dicNode,
+            DicNodeExpansionBuffer *expansionBuffer) const;
     void weightChildNode(DicTraverseSession *traverseSession, DicNode *dicNode) const;
     float getAutocorrectScore(DicTraverseSession *traverseSession, DicNode *dicNode) const;
     void generateFeatures(
             DicTraverseSession *traverseSession, DicNode *dicNode, float *features) const;
-    void processDicNodeAsOmission(DicTraverseSession *traverseSession, DicNode *dicNode) const;
-    void processDicNodeAsDigraph(DicTraverseSession *traverseSession, DicNode *dicNode) const;
+    void processDicNodeAsOmission(DicTraverseSession *traverseSession, DicNode *dicNode,
+            DicNodeExpansionBuffer *expansionBuffer) const;
+    void processDicNodeAsDigraph(DicTraverseSession *traverseSession, DicNode *dicNode,
+            DicNodeExpansionBuffer *expansionBuffer) const;
     void processDicNodeAsTransposition(DicTraverseSession *traverseSession,
-            DicNode *dicNode) const;
-    void processDicNodeAsInsertion(DicTraverseSession *traverseSession, DicNode *dicNode) const;
+            DicNode *dicNode, DicNodeExpansionBuffer *expansionBuffer) const;
+    void processDicNodeAsInsertion(DicTraverseSession *traverseSession, DicNode *dicNode,
+            DicNodeExpansionBuffer *expansionBuffer) const;
     void processDicNodeAsAdditionalProximityChar(DicTraverseSession *traverseSession,
-            DicNode *dicNode, DicNode *childDicNode) const;
+            DicNode *dicNode, DicNode *childDicNode,
+            DicNodeExpansionBuffer *expansionBuffer) const;
     void processDicNodeAsSubstitution(DicTraverseSession *traverseSession, DicNode *dicNode,
-            DicNode *childDicNode) const;
+            DicNode *childDicNode, DicNodeExpansionBuffer *expansionBuffer) const;
     void processDicNodeAsMatch(DicTraverseSession *traverseSession,
-            DicNode *childDicNode) const;
+            DicNode *childDicNode, DicNodeExpansionBuffer *expansionBuffer) const;
 
     // Inputs longer than this will autocorrect if the suggestion is multi-word
     static const int MIN_LEN_FOR_MULTI_WORD_AUTOCORRECT;
@@ -83,9 +137,15 @@ class Suggest : public SuggestInterface {
     // Threshold for autocorrection classifier
     static const float AUTOCORRECT_CLASSIFICATION_THRESHOLD;
 
+    // The lower bound pruning keeps the dicNodes that tie with the worst terminal
+    static const float LOWER_BOUND_PRUNING_MARGIN;
+
     const Traversal *const TRAVERSAL;
     const Scoring *const SCORING;
     const Weighting *const WEIGHTING;
 };
+
+typedef SuggestImpl<Traversal, Scoring, Weighting> Suggest;
+typedef SuggestImpl<TypingTraversal, TypingScoring, TypingWeighting> TypingSuggest;
 } // namespace latinime
 #endif // LATINIME_SUGGEST_IMPL_H
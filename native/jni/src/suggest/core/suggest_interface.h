@@ -29,6 +29,11 @@ class SuggestInterface {
             int *inputYs, int *times, int *pointerIds, int *inputCodePoints, int inputSize,
             int commitPoint, int *outWords, int *frequencies, int *outputIndices,
             int *outputTypes) const = 0;
+    // Prepares the search of the input followed by one more key, in the idle time after the
+    // search of the input. Returns the number of input indices expanded.
+    virtual int speculateNextInput(ProximityInfo *pInfo, void *traverseSession, int *inputXs,
+            int *inputYs, int *times, int *pointerIds, int *inputCodePoints, int inputSize,
+            int maxStepCount) const = 0;
     SuggestInterface() {}
     virtual ~SuggestInterface() {}
  private:
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "suggest/policyimpl/gesture/gesture_params.h"
+
+namespace latinime {
+// The cap of the normalized squared point to key lengths. Not below the near key threshold of
+// ProximityInfoParams, so that the probabilities of the near keys are not flattened.
+const float GestureParams::MAX_SPATIAL_DISTANCE = 4.0f;
+const int GestureParams::MAX_CACHE_DIC_NODE_SIZE = 200;
+// The gestures of about 4 letters or more, whose search dominates the latency
+const int GestureParams::MIN_SAMPLED_INPUT_SIZE_FOR_TWO_PASSES = 20;
+const int GestureParams::COARSE_PASS_CACHE_DIC_NODE_SIZE = 60;
+
+const float GestureParams::DOUBLE_LETTER_COST = 1.0f;
+const float GestureParams::DISTANCE_WEIGHT_LANGUAGE = 4.0f;
+const float GestureParams::GESTURE_BASE_OUTPUT_SCORE = 1.0f;
+const float GestureParams::GESTURE_MAX_OUTPUT_SCORE_PER_INPUT = 0.1f;
+} // namespace latinime
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LATINIME_GESTURE_PARAMS_H
+#define LATINIME_GESTURE_PARAMS_H
+
+#include "defines.h"
+
+namespace latinime {
+
+class GestureParams {
+ public:
+    // Fixed model parameters
+    static const float MAX_SPATIAL_DISTANCE;
+    static const int MAX_CACHE_DIC_NODE_SIZE;
+    static const int MIN_SAMPLED_INPUT_SIZE_FOR_TWO_PASSES;
+    static const int COARSE_PASS_CACHE_DIC_NODE_SIZE;
+
+    // The spatial costs are the -log probabilities of ProximityInfoState, relative to the
+    // cheapest choice of each sampled point.
+    // TODO: explore optimization of the gesture parameters.
+    static const float DOUBLE_LETTER_COST;
+    static const float DISTANCE_WEIGHT_LANGUAGE;
+    static const float GESTURE_BASE_OUTPUT_SCORE;
+    static const float GESTURE_MAX_OUTPUT_SCORE_PER_INPUT;
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(GestureParams);
+};
+} // namespace latinime
+#endif // LATINIME_GESTURE_PARAMS_H
@@ -18,6 +18,7 @@
 #define LATINIME_GESTURE_SUGGEST_POLICY_FACTORY_H
 
 #include "defines.h"
+#include "suggest/policyimpl/gesture/gesture_suggest_policy.h"
 
 namespace latinime {
 
@@ -29,15 +30,17 @@ class GestureSuggestPolicyFactory {
         sGestureSuggestFactoryMethod = factoryMethod;
     }
 
+    // An installed factory method overrides the in-tree GestureSuggestPolicy.
     static const SuggestPolicy *getGestureSuggestPolicy() {
         if (!sGestureSuggestFactoryMethod) {
-            return 0;
+            return GestureSuggestPolicy::getInstance();
         }
         return sGestureSuggestFactoryMethod();
     }
 
  private:
     DISALLOW_COPY_AND_ASSIGN(GestureSuggestPolicyFactory);
+    // Set by a static initializer before any dictionary is opened and never changed afterwards.
     static const SuggestPolicy *(*sGestureSuggestFactoryMethod)();
 };
 } // namespace latinime
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_GESTURE_TRAVERSAL_H
+#define LATINIME_GESTURE_TRAVERSAL_H
+
+#include "char_utils.h"
+#include "defines.h"
+#include "proximity_info.h"
+#include "proximity_info_state.h"
+#include "suggest/core/dicnode/dic_node.h"
+#include "suggest/core/dicnode/dic_node_vector.h"
+#include "suggest/core/policy/traversal.h"
+#include "suggest/core/session/dic_traverse_session.h"
+#include "suggest/policyimpl/gesture/gesture_params.h"
+
+namespace latinime {
+
+/**
+ * The traversal of a gesture drawn by one pointer. Each letter of a word consumes a sampled point
+ * of the path, at or after the input index of its parent, and GestureWeighting skips the points
+ * that it passes over. There are no error corrections: a letter whose key is not near the path
+ * ahead of the input index is dropped at once.
+ */
+class GestureTraversal : public Traversal {
+ public:
+    static const GestureTraversal *getInstance() { return &sInstance; }
+
+    // The geometric sampling of ProximityInfoState is enabled by MAX_POINTER_COUNT_G. Only the
+    // first pointer is decoded.
+    AK_FORCE_INLINE int getMaxPointerCount() const {
+        return MAX_POINTER_COUNT_G;
+    }
+
+    AK_FORCE_INLINE bool allowsErrorCorrections(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode) const {
+        return false;
+    }
+
+    // Apostrophes and hyphens are not on the keyboard, so they are always omitted.
+    AK_FORCE_INLINE bool isOmission(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode, const DicNode *const childDicNode,
+            const bool allowsErrorCorrections) const {
+        return childDicNode->canBeIntentionalOmission()
+                && !dicNode->isCompletion(traverseSession->getInputSize());
+    }
+
+    AK_FORCE_INLINE bool isSpaceSubstitutionTerminal(
+            const DicTraverseSession *const traverseSession, const DicNode *const dicNode) const {
+        return false;
+    }
+
+    // TODO: Decode phrase gestures.
+    AK_FORCE_INLINE bool isSpaceOmissionTerminal(
+            const DicTraverseSession *const traverseSession, const DicNode *const dicNode) const {
+        return false;
+    }
+
+    AK_FORCE_INLINE bool shouldDepthLevelCache(
+            const DicTraverseSession *const traverseSession) const {
+        return false;
+    }
+
+    AK_FORCE_INLINE bool shouldNodeLevelCache(
+            const DicTraverseSession *const traverseSession, const DicNode *const dicNode) const {
+        return false;
+    }
+
+    AK_FORCE_INLINE bool canDoLookAheadCorrection(
+            const DicTraverseSession *const traverseSession, const DicNode *const dicNode) const {
+        return false;
+    }
+
+    // Prunes the letters whose key is not near the sampled points that the search keys of the
+    // input index cover. A double letter may take the point of the first one again.
+    AK_FORCE_INLINE ProximityType getProximityType(
+            const DicTraverseSession *const traverseSession, const DicNode *const dicNode,
+            const DicNode *const childDicNode) const {
+        const ProximityInfoState *const pInfoState = traverseSession->getProximityInfoState(0);
+        const int pointIndex = dicNode->getInputIndex(0);
+        if (pointIndex >= pInfoState->size()) {
+            return UNRELATED_CHAR;
+        }
+        const int codePoint = childDicNode->getNodeCodePoint();
+        const int keyId =
+                traverseSession->getProximityInfo()->getKeyIndexOrBaseKeyIndexOf(codePoint);
+        if (keyId == NOT_AN_INDEX) {
+            return UNRELATED_CHAR;
+        }
+        if (pInfoState->isKeyInSerchKeysAfterIndex(pointIndex, keyId)) {
+            return MATCH_CHAR;
+        }
+        // There is no previous letter at the root.
+        const int prevCodePoint = dicNode->getPrevCodePointG(0);
+        return (prevCodePoint != NOT_A_CODE_POINT
+                && toBaseLowerCase(codePoint) == toBaseLowerCase(prevCodePoint))
+                        ? MATCH_CHAR : UNRELATED_CHAR;
+    }
+
+    AK_FORCE_INLINE bool needsToTraverseAllUserInput() const {
+        return false;
+    }
+
+    AK_FORCE_INLINE float getMaxSpatialDistance() const {
+        return GestureParams::MAX_SPATIAL_DISTANCE;
+    }
+
+    AK_FORCE_INLINE bool allowPartialCommit() const {
+        return false;
+    }
+
+    AK_FORCE_INLINE int getDefaultExpandDicNodeSize() const {
+        return DicNodeVector::DEFAULT_NODES_SIZE_FOR_OPTIMIZATION;
+    }
+
+    AK_FORCE_INLINE bool sameAsTyped(
+            const DicTraverseSession *const traverseSession, const DicNode *const dicNode) const {
+        return false;
+    }
+
+    AK_FORCE_INLINE int getMaxCacheSize() const {
+        return GestureParams::MAX_CACHE_DIC_NODE_SIZE;
+    }
+
+    // The long gestures are first searched on a coarse sampling of their path, which rules out
+    // most of the lexicon at a fraction of the cost of the full sampling.
+    AK_FORCE_INLINE int getCoarsePassCacheSize(
+            const DicTraverseSession *const traverseSession) const {
+        if (!USE_TWO_PASS_GESTURE || traverseSession->getProximityInfoState(0)->size()
+                < GestureParams::MIN_SAMPLED_INPUT_SIZE_FOR_TWO_PASSES) {
+            return 0;
+        }
+        return GestureParams::COARSE_PASS_CACHE_DIC_NODE_SIZE;
+    }
+
+    // The omitted apostrophe or hyphen consumes no point, and the matched cost of the letter after
+    // it decides.
+    AK_FORCE_INLINE bool isPossibleOmissionChildNode(
+            const DicTraverseSession *const traverseSession, const DicNode *const parentDicNode,
+            const DicNode *const dicNode) const {
+        return true;
+    }
+
+    AK_FORCE_INLINE bool isGoodToTraverseNextWord(const DicNode *const dicNode) const {
+        return false;
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(GestureTraversal);
+    static const GestureTraversal sInstance;
+
+    GestureTraversal() {}
+    ~GestureTraversal() {}
+};
+} // namespace latinime
+#endif // LATINIME_GESTURE_TRAVERSAL_H
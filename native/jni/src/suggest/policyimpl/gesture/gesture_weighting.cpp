@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "suggest/policyimpl/gesture/gesture_weighting.h"
+
+namespace latinime {
+
+const GestureWeighting GestureWeighting::sInstance;
+
+/**
+ * Aligns the letter of the dicNode to the sampled point at or after its input index that is the
+ * cheapest to reach: the points before it are skipped. The alignment costs of the key are laid out
+ * by point, so the scan reads them in order, and it stops once skipping the points already costs
+ * more than the best alignment, or once the key is out of reach of the rest of the path. A double
+ * letter may also be aligned to the point of the first one.
+ */
+float GestureWeighting::getMatchedCost(const DicTraverseSession *const traverseSession,
+        const DicNode *const dicNode, DicNode_InputStateG *inputStateG) const {
+    const ProximityInfoState *const pInfoState = traverseSession->getProximityInfoState(0);
+    const int sampledInputSize = pInfoState->size();
+    const int startIndex = dicNode->getInputIndex(0);
+    const int codePoint = dicNode->getNodeCodePoint();
+    const int keyId = traverseSession->getProximityInfo()->getKeyIndexOrBaseKeyIndexOf(codePoint);
+    if (keyId == NOT_AN_INDEX || startIndex >= sampledInputSize) {
+        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+    float cost = static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    int alignedIndex = NOT_AN_INDEX;
+    const int prevCodePoint = dicNode->getPrevCodePointG(0);
+    if (startIndex > 0 && prevCodePoint != NOT_A_CODE_POINT
+            && toBaseLowerCase(codePoint) == toBaseLowerCase(prevCodePoint)) {
+        cost = GestureParams::DOUBLE_LETTER_COST;
+        alignedIndex = startIndex - 1;
+    }
+    const float *const alignmentCosts = pInfoState->getKeyAlignmentCosts(keyId);
+    const float startSkipCostSum = pInfoState->getSkipCostSum(startIndex);
+    for (int i = startIndex; i < sampledInputSize; ++i) {
+        const float skipCost = pInfoState->getSkipCostSum(i) - startSkipCostSum;
+        if (skipCost >= cost || !pInfoState->isKeyInSerchKeysAfterIndex(i, keyId)) {
+            break;
+        }
+        const float alignmentCost = skipCost + alignmentCosts[i];
+        if (alignmentCost < cost) {
+            cost = alignmentCost;
+            alignedIndex = i;
+        }
+    }
+    if (alignedIndex == NOT_AN_INDEX) {
+        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+    inputStateG->mNeedsToUpdateInputStateG = true;
+    inputStateG->mPointerId = 0;
+    inputStateG->mInputIndex = static_cast<int16_t>(alignedIndex + 1);
+    inputStateG->mPrevCodePoint = codePoint;
+    inputStateG->mTerminalDiffCost = 0.0f;
+    inputStateG->mRawLength = 0.0f;
+    inputStateG->mDoubleLetterLevel = NOT_A_DOUBLE_LETTER;
+    return cost;
+}
+
+ErrorType GestureWeighting::getErrorType(const CorrectionType correctionType,
+        const DicTraverseSession *const traverseSession, const DicNode *const parentDicNode,
+        const DicNode *const dicNode) const {
+    switch (correctionType) {
+        case CT_MATCH:
+            // Nothing of a gesture is typed exactly.
+            return ET_PROXIMITY_CORRECTION;
+        case CT_OMISSION:
+            return ET_INTENTIONAL_OMISSION;
+        case CT_TERMINAL:
+            return ET_NOT_AN_ERROR;
+        case CT_COMPLETION:
+            return ET_COMPLETION;
+        default:
+            return ET_EDIT_CORRECTION;
+    }
+}
+} // namespace latinime
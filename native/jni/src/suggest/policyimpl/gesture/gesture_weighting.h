@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_GESTURE_WEIGHTING_H
+#define LATINIME_GESTURE_WEIGHTING_H
+
+#include "char_utils.h"
+#include "defines.h"
+#include "proximity_info.h"
+#include "proximity_info_state.h"
+#include "suggest/core/dicnode/dic_node.h"
+#include "suggest/core/policy/weighting.h"
+#include "suggest/core/session/dic_traverse_session.h"
+#include "suggest/policyimpl/gesture/gesture_params.h"
+
+namespace latinime {
+
+class MultiBigramMap;
+
+/**
+ * The costs of the alignment of a word to the sampled points of a gesture, from the -log
+ * probabilities of ProximityInfoState of aligning each point to a key or skipping it. The costs
+ * are relative to the cheapest choice of each point, so the compound distance does not need to be
+ * normalized: the dicNodes that consumed more points were charged the least they could for them.
+ */
+class GestureWeighting : public Weighting {
+ public:
+    static const GestureWeighting *getInstance() { return &sInstance; }
+
+ protected:
+    // Skips the points after the last letter.
+    float getTerminalSpatialCost(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode) const {
+        const ProximityInfoState *const pInfoState = traverseSession->getProximityInfoState(0);
+        const int sampledInputSize = pInfoState->size();
+        const int pointIndex = min(static_cast<int>(dicNode->getInputIndex(0)), sampledInputSize);
+        return pInfoState->getSkipCostSum(sampledInputSize)
+                - pInfoState->getSkipCostSum(pointIndex);
+    }
+
+    float getOmissionCost(const DicNode *const parentDicNode, const DicNode *const dicNode) const {
+        return parentDicNode->canBeIntentionalOmission()
+                ? 0.0f : static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+
+    float getMatchedCost(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode, DicNode_InputStateG *inputStateG) const;
+
+    bool isProximityDicNode(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode) const {
+        return false;
+    }
+
+    float getTranspositionCost(const DicTraverseSession *const traverseSession,
+            const DicNode *const parentDicNode, const DicNode *const dicNode) const {
+        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+
+    float getInsertionCost(const DicTraverseSession *const traverseSession,
+            const DicNode *const parentDicNode, const DicNode *const dicNode) const {
+        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+
+    float getNewWordCost(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode) const {
+        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+
+    float getNewWordBigramCost(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode, MultiBigramMap *const multiBigramMap) const {
+        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+
+    // A gesture is not completed: the word ends where the path does.
+    float getCompletionCost(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode) const {
+        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+
+    float getTerminalLanguageCost(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode, const float dicNodeLanguageImprobability) const {
+        return dicNodeLanguageImprobability * GestureParams::DISTANCE_WEIGHT_LANGUAGE;
+    }
+
+    AK_FORCE_INLINE bool needsToNormalizeCompoundDistance() const {
+        return false;
+    }
+
+    AK_FORCE_INLINE float getAdditionalProximityCost() const {
+        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+
+    AK_FORCE_INLINE float getSubstitutionCost() const {
+        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+
+    AK_FORCE_INLINE float getSpaceSubstitutionCost(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode) const {
+        return static_cast<float>(MAX_VALUE_FOR_WEIGHTING);
+    }
+
+    ErrorType getErrorType(const CorrectionType correctionType,
+            const DicTraverseSession *const traverseSession,
+            const DicNode *const parentDicNode, const DicNode *const dicNode) const;
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(GestureWeighting);
+    static const GestureWeighting sInstance;
+
+    GestureWeighting() {}
+    ~GestureWeighting() {}
+};
+} // namespace latinime
+#endif // LATINIME_GESTURE_WEIGHTING_H
@@ -41,13 +41,13 @@ class TypingScoring : public Scoring {
             const int maxScore, int *const outputCodePoints, int *const frequencies) const {
     }
 
-    AK_FORCE_INLINE void searchWordWithDoubleLetter(DicNode *terminals,
+    AK_FORCE_INLINE void searchWordWithDoubleLetter(DicNode *const *const terminals,
             const int terminalSize, int *doubleLetterTerminalIndex,
             DoubleLetterLevel *doubleLetterLevel) const {
     }
 
     AK_FORCE_INLINE float getAdjustedLanguageWeight(DicTraverseSession *const traverseSession,
-             DicNode *const terminals, const int size) const {
+             DicNode *const *const terminals, const int size) const {
         return 1.0f;
     }
 
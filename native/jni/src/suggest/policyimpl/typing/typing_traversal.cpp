@@ -16,9 +16,53 @@
 
 #include "suggest/policyimpl/typing/typing_traversal.h"
 
+#include "proximity_info.h"
+#include "suggest_utils.h"
+
 namespace latinime {
 const bool TypingTraversal::CORRECT_OMISSION = true;
 const bool TypingTraversal::CORRECT_NEW_WORD_SPACE_SUBSTITUTION = true;
 const bool TypingTraversal::CORRECT_NEW_WORD_SPACE_OMISSION = true;
 const TypingTraversal TypingTraversal::sInstance;
+
+/**
+ * Sets the lower bounds of the spatial cost of each input point, as TypingWeighting weights them.
+ * A point is matched to a key, which costs at least the weighted distance to the nearest key, or
+ * to an intentionally omitted code point, which costs the proximity cost unless it was typed.
+ * Otherwise it is consumed by a space substitution, or by an insertion or a transposition, whose
+ * fixed cost covers the two points that they consume. The bound of a point is the smallest of
+ * these, so that the bounds of the remaining points can be summed up.
+ */
+void TypingTraversal::setMinPointCosts(const DicTraverseSession *const traverseSession,
+        SpatialCostCache *const spatialCostCache) const {
+    const ProximityInfoState *const pInfoState = traverseSession->getProximityInfoState(0);
+    const ProximityInfo *const pInfo = traverseSession->getProximityInfo();
+    const int keyCount = pInfo ? pInfo->getKeyCount() : 0;
+    const int inputSize = min(traverseSession->getInputSize(), MAX_WORD_LENGTH);
+    const bool isTouchPositionCorrectionEnabled =
+            traverseSession->isTouchPositionCorrectionEnabled();
+    const float minCorrectionCost = min(
+            (ScoringParams::SPACE_SUBSTITUTION_COST + ScoringParams::COST_NEW_WORD)
+                    * traverseSession->getMultiWordCostMultiplier(),
+            min(min(ScoringParams::INSERTION_COST, ScoringParams::INSERTION_COST_SAME_CHAR),
+                    ScoringParams::TRANSPOSITION_COST) / 2.0f);
+    float minPointCosts[MAX_WORD_LENGTH];
+    for (int i = 0; i < inputSize; ++i) {
+        if (isIntentionalOmissionCodePoint(pInfoState->getPrimaryCodePointAt(i))) {
+            minPointCosts[i] = 0.0f;
+            continue;
+        }
+        float minPointCost = min(minCorrectionCost,
+                i == 0 ? ScoringParams::FIRST_PROXIMITY_COST : ScoringParams::PROXIMITY_COST);
+        for (int keyId = 0; keyId < keyCount; ++keyId) {
+            const float normalizedDistance = SuggestUtils::getSweetSpotFactor(
+                    isTouchPositionCorrectionEnabled,
+                    pInfoState->getPointToKeyByIdLength(i, keyId));
+            minPointCost = min(minPointCost,
+                    ScoringParams::DISTANCE_WEIGHT_LENGTH * normalizedDistance);
+        }
+        minPointCosts[i] = max(minPointCost, 0.0f);
+    }
+    spatialCostCache->setMinPointCosts(minPointCosts, inputSize);
+}
 }  // namespace latinime
@@ -37,9 +37,11 @@ class TypingTraversal : public Traversal {
         return MAX_POINTER_COUNT;
     }
 
-    AK_FORCE_INLINE bool allowsErrorCorrections(const DicNode *const dicNode) const {
+    AK_FORCE_INLINE bool allowsErrorCorrections(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode) const {
         return dicNode->getNormalizedSpatialDistance()
-                < ScoringParams::NORMALIZED_SPATIAL_DISTANCE_THRESHOLD_FOR_EDIT;
+                < traverseSession->getSearchProfile()->getErrorCorrectionThreshold(
+                        ScoringParams::NORMALIZED_SPATIAL_DISTANCE_THRESHOLD_FOR_EDIT);
     }
 
     AK_FORCE_INLINE bool isOmission(const DicTraverseSession *const traverseSession,
@@ -73,7 +75,8 @@ class TypingTraversal : public Traversal {
 
     AK_FORCE_INLINE bool isSpaceSubstitutionTerminal(
             const DicTraverseSession *const traverseSession, const DicNode *const dicNode) const {
-        if (!CORRECT_NEW_WORD_SPACE_SUBSTITUTION) {
+        if (!CORRECT_NEW_WORD_SPACE_SUBSTITUTION
+                || !traverseSession->getSearchProfile()->allowsMultipleWords()) {
             return false;
         }
         if (!canDoLookAheadCorrection(traverseSession, dicNode)) {
@@ -87,7 +90,8 @@ class TypingTraversal : public Traversal {
 
     AK_FORCE_INLINE bool isSpaceOmissionTerminal(
             const DicTraverseSession *const traverseSession, const DicNode *const dicNode) const {
-        if (!CORRECT_NEW_WORD_SPACE_OMISSION) {
+        if (!CORRECT_NEW_WORD_SPACE_OMISSION
+                || !traverseSession->getSearchProfile()->allowsMultipleWords()) {
             return false;
         }
         const int inputSize = traverseSession->getInputSize();
@@ -146,14 +150,20 @@ class TypingTraversal : public Traversal {
 
     AK_FORCE_INLINE bool sameAsTyped(
             const DicTraverseSession *const traverseSession, const DicNode *const dicNode) const {
+        int codePoints[MAX_WORD_LENGTH];
         return traverseSession->getProximityInfoState(0)->sameAsTyped(
-                dicNode->getOutputWordBuf(), dicNode->getDepth());
+                dicNode->getOutputCodePoints(codePoints), dicNode->getDepth());
     }
 
     AK_FORCE_INLINE int getMaxCacheSize() const {
         return ScoringParams::MAX_CACHE_DIC_NODE_SIZE;
     }
 
+    AK_FORCE_INLINE int getCoarsePassCacheSize(
+            const DicTraverseSession *const traverseSession) const {
+        return 0;
+    }
+
     AK_FORCE_INLINE bool isPossibleOmissionChildNode(
             const DicTraverseSession *const traverseSession, const DicNode *const parentDicNode,
             const DicNode *const dicNode) const {
@@ -170,13 +180,24 @@ class TypingTraversal : public Traversal {
         if (probability < ScoringParams::THRESHOLD_NEXT_WORD_PROBABILITY) {
             return false;
         }
-        const int c = dicNode->getOutputWordBuf()[0];
         const bool shortCappedWord = dicNode->getDepth()
-                < ScoringParams::THRESHOLD_SHORT_WORD_LENGTH && isAsciiUpper(c);
+                < ScoringParams::THRESHOLD_SHORT_WORD_LENGTH && dicNode->isFirstCharUppercase();
         return !shortCappedWord
                 || probability >= ScoringParams::THRESHOLD_NEXT_WORD_PROBABILITY_FOR_CAPPED;
     }
 
+    // Returns a lower bound of the cost that the dicNode adds until it is output as a terminal, for
+    // the lower bound pruning. Only the spatial costs of the input points that it has not consumed
+    // yet are bounded; the language costs are not.
+    AK_FORCE_INLINE float getMinRemainingCost(const DicTraverseSession *const traverseSession,
+            const DicNode *const dicNode) const {
+        SpatialCostCache *const spatialCostCache = traverseSession->getSpatialCostCache();
+        if (!spatialCostCache->hasMinRemainingCosts()) {
+            setMinPointCosts(traverseSession, spatialCostCache);
+        }
+        return spatialCostCache->getMinRemainingCost(dicNode->getInputIndex(0));
+    }
+
  private:
     DISALLOW_COPY_AND_ASSIGN(TypingTraversal);
     static const bool CORRECT_OMISSION;
@@ -186,6 +207,9 @@ class TypingTraversal : public Traversal {
 
     TypingTraversal() {}
     ~TypingTraversal() {}
+
+    void setMinPointCosts(const DicTraverseSession *const traverseSession,
+            SpatialCostCache *const spatialCostCache) const;
 };
 } // namespace latinime
 #endif // LATINIME_TYPING_TRAVERSAL_H
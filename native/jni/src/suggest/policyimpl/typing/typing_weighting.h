@@ -70,18 +70,15 @@ class TypingWeighting : public Weighting {
     float getMatchedCost(const DicTraverseSession *const traverseSession,
             const DicNode *const dicNode, DicNode_InputStateG *inputStateG) const {
         const int pointIndex = dicNode->getInputIndex(0);
-        // Note: min() required since length can be MAX_POINT_TO_KEY_LENGTH for characters not on
-        // the keyboard (like accented letters)
-        const float normalizedSquaredLength = traverseSession->getProximityInfoState(0)
-                ->getPointToKeyLength(pointIndex, dicNode->getNodeCodePoint());
-        const float normalizedDistance = SuggestUtils::getSweetSpotFactor(
-                traverseSession->isTouchPositionCorrectionEnabled(), normalizedSquaredLength);
-        const float weightedDistance = ScoringParams::DISTANCE_WEIGHT_LENGTH * normalizedDistance;
-
-        const bool isFirstChar = pointIndex == 0;
-        const bool isProximity = isProximityDicNode(traverseSession, dicNode);
-        float cost = isProximity ? (isFirstChar ? ScoringParams::FIRST_PROXIMITY_COST
-                : ScoringParams::PROXIMITY_COST) : 0.0f;
+        const int codePoint = dicNode->getNodeCodePoint();
+        SpatialCostCache *const spatialCostCache = traverseSession->getSpatialCostCache();
+        float weightedDistance = 0.0f;
+        float cost = 0.0f;
+        if (!spatialCostCache->get(pointIndex, codePoint, &weightedDistance, &cost)) {
+            getMatchedSpatialCosts(traverseSession, pointIndex, codePoint, &weightedDistance,
+                    &cost);
+            spatialCostCache->put(pointIndex, codePoint, weightedDistance, cost);
+        }
         if (dicNode->getDepth() == 2) {
             // At the second character of the current word, we check if the first char is uppercase
             // and the word is a second or later word of a multiple word suggestion. We demote it
@@ -146,7 +143,9 @@ class TypingWeighting : public Weighting {
             const DicNode *const dicNode,
             MultiBigramMap *const multiBigramMap) const {
         return DicNodeUtils::getBigramNodeImprobability(traverseSession->getOffsetDict(),
-                dicNode, multiBigramMap) * ScoringParams::DISTANCE_WEIGHT_LANGUAGE;
+                traverseSession->getBigramListIndex(), dicNode, multiBigramMap,
+                traverseSession->getProbabilityOverlay())
+                * ScoringParams::DISTANCE_WEIGHT_LANGUAGE;
     }
 
     float getCompletionCost(const DicTraverseSession *const traverseSession,
@@ -195,6 +194,27 @@ class TypingWeighting : public Weighting {
 
     TypingWeighting() {}
     ~TypingWeighting() {}
+
+    // The parts of the matched cost that only depend on the touch point and the code point, which
+    // the session caches.
+    void getMatchedSpatialCosts(const DicTraverseSession *const traverseSession,
+            const int pointIndex, const int codePoint, float *const outWeightedDistance,
+            float *const outProximityCost) const {
+        // Note: min() required since length can be MAX_POINT_TO_KEY_LENGTH for characters not on
+        // the keyboard (like accented letters)
+        const float normalizedSquaredLength = traverseSession->getProximityInfoState(0)
+                ->getPointToKeyLength(pointIndex, codePoint);
+        const float normalizedDistance = SuggestUtils::getSweetSpotFactor(
+                traverseSession->isTouchPositionCorrectionEnabled(), normalizedSquaredLength);
+        *outWeightedDistance = ScoringParams::DISTANCE_WEIGHT_LENGTH * normalizedDistance;
+
+        const bool isFirstChar = pointIndex == 0;
+        const int primaryCodePoint = toBaseLowerCase(
+                traverseSession->getProximityInfoState(0)->getPrimaryCodePointAt(pointIndex));
+        const bool isProximity = primaryCodePoint != toBaseLowerCase(codePoint);
+        *outProximityCost = isProximity ? (isFirstChar ? ScoringParams::FIRST_PROXIMITY_COST
+                : ScoringParams::PROXIMITY_COST) : 0.0f;
+    }
 };
 } // namespace latinime
 #endif // LATINIME_TYPING_WEIGHTING_H
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_BIT_VECTOR_EDIT_DISTANCE_H
+#define LATINIME_BIT_VECTOR_EDIT_DISTANCE_H
+
+#include <cstring>
+#include <stdint.h>
+
+#include "char_utils.h"
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * The Damerau-Levenshtein (optimal string alignment) distance of
+ * DamerauLevenshteinEditDistancePolicy, computed with the bit-vector algorithm of Myers as
+ * extended by Hyyro for the transpositions.
+ * A column of the distance matrix, the distances from a prefix of string1 to all the prefixes of
+ * string0, is kept as the bit vectors of its vertical differences, so string0 must have at most
+ * MAX_STRING0_LENGTH code points. Adding a code point of string1 takes a few word operations.
+ *
+ * The columns of the prefixes of string1 are kept, so that string1 can be traversed in depth
+ * first order: setting the code point at an index recomputes the column of that index from the
+ * column before it.
+ */
+class BitVectorEditDistance {
+ public:
+    static const int MAX_STRING0_LENGTH = 64;
+
+    BitVectorEditDistance() : mString0Length(0), mDistinctCodePointCount(0) {
+        memset(mDistinctCodePoints, 0, sizeof(mDistinctCodePoints));
+        memset(mDistinctCodePointMasks, 0, sizeof(mDistinctCodePointMasks));
+        memset(mColumns, 0, sizeof(mColumns));
+    }
+
+    // Non virtual inline destructor -- never inherit this class
+    ~BitVectorEditDistance() {}
+
+    // Sets string0 and the column of the empty string1.
+    void setString0(const int *const string0, const int length) {
+        ASSERT(length <= MAX_STRING0_LENGTH);
+        mString0Length = length;
+        mDistinctCodePointCount = buildMasks(string0, length, mDistinctCodePoints,
+                mDistinctCodePointMasks);
+        initColumn(&mColumns[0]);
+    }
+
+    // Computes the column of the string1 prefix of string1Length code points, of which codePoint
+    // is the last one. The column of the prefix one code point shorter must have been computed.
+    AK_FORCE_INLINE void setString1CodePointAt(const int string1Length, const int codePoint) {
+        ASSERT(string1Length > 0 && string1Length <= MAX_WORD_LENGTH);
+        updateColumn(&mColumns[string1Length - 1], getMask(mDistinctCodePointCount,
+                mDistinctCodePoints, mDistinctCodePointMasks, toBaseLowerCase(codePoint)),
+                &mColumns[string1Length]);
+    }
+
+    // Returns the distance between the prefixes of string0Length and string1Length code points.
+    AK_FORCE_INLINE int getEditDistance(const int string0Length, const int string1Length) const {
+        ASSERT(string0Length <= mString0Length && string1Length <= MAX_WORD_LENGTH);
+        return getEditDistance(&mColumns[string1Length], string0Length, string1Length);
+    }
+
+    // Returns the distance between string0 and string1. string0 must have at most
+    // MAX_STRING0_LENGTH code points; string1 can have any length.
+    static int getEditDistance(const int *const string0, const int length0,
+            const int *const string1, const int length1) {
+        ASSERT(length0 <= MAX_STRING0_LENGTH);
+        int codePoints[MAX_STRING0_LENGTH];
+        uint64_t masks[MAX_STRING0_LENGTH];
+        const int distinctCodePointCount = buildMasks(string0, length0, codePoints, masks);
+        return getEditDistance(distinctCodePointCount, codePoints, masks, length0, string1,
+                length1);
+    }
+
+    // Sets the distances between string0 and each of the string1Count strings of string1s, the
+    // string i spanning from string1Offsets[i] to string1Offsets[i + 1]. The bit vectors of
+    // string0 are only built once.
+    static void getEditDistances(const int *const string0, const int length0,
+            const int *const string1Offsets, const int *const string1s, const int string1Count,
+            int *const outDistances) {
+        ASSERT(length0 <= MAX_STRING0_LENGTH);
+        int codePoints[MAX_STRING0_LENGTH];
+        uint64_t masks[MAX_STRING0_LENGTH];
+        const int distinctCodePointCount = buildMasks(string0, length0, codePoints, masks);
+        for (int i = 0; i < string1Count; ++i) {
+            outDistances[i] = getEditDistance(distinctCodePointCount, codePoints, masks, length0,
+                    string1s + string1Offsets[i], string1Offsets[i + 1] - string1Offsets[i]);
+        }
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(BitVectorEditDistance);
+
+    // A column of the distance matrix. The bit i of mPositiveDiffs (resp. mNegativeDiffs) is set
+    // when the distance to the string0 prefix of i + 1 code points is one more (resp. one less)
+    // than the distance to the prefix of i code points.
+    struct Column {
+        uint64_t mPositiveDiffs;
+        uint64_t mNegativeDiffs;
+        // The bit i is set when the diagonal difference ending at the code point i is zero.
+        uint64_t mZeroDiagonalDiffs;
+        // The bits of the string0 code points that match the last code point of string1.
+        uint64_t mMatchMask;
+    };
+
+    static int buildMasks(const int *const string0, const int length, int *const codePoints,
+            uint64_t *const masks) {
+        int distinctCodePointCount = 0;
+        for (int i = 0; i < length; ++i) {
+            const int codePoint = toBaseLowerCase(string0[i]);
+            int j = 0;
+            while (j < distinctCodePointCount && codePoints[j] != codePoint) {
+                ++j;
+            }
+            if (j == distinctCodePointCount) {
+                codePoints[j] = codePoint;
+                masks[j] = 0;
+                ++distinctCodePointCount;
+            }
+            masks[j] |= 1ULL << i;
+        }
+        return distinctCodePointCount;
+    }
+
+    static AK_FORCE_INLINE uint64_t getMask(const int distinctCodePointCount,
+            const int *const codePoints, const uint64_t *const masks, const int codePoint) {
+        for (int i = 0; i < distinctCodePointCount; ++i) {
+            if (codePoints[i] == codePoint) {
+                return masks[i];
+            }
+        }
+        return 0;
+    }
+
+    static int getEditDistance(const int distinctCodePointCount, const int *const codePoints,
+            const uint64_t *const masks, const int length0, const int *const string1,
+            const int length1) {
+        Column columns[2];
+        initColumn(&columns[0]);
+        for (int i = 0; i < length1; ++i) {
+            updateColumn(&columns[i % 2], getMask(distinctCodePointCount, codePoints, masks,
+                    toBaseLowerCase(string1[i])), &columns[(i + 1) % 2]);
+        }
+        return getEditDistance(&columns[length1 % 2], length0, length1);
+    }
+
+    // The column of the empty string1: the distance to the prefix of i code points is i.
+    static AK_FORCE_INLINE void initColumn(Column *const column) {
+        column->mPositiveDiffs = ~0ULL;
+        column->mNegativeDiffs = 0;
+        column->mZeroDiagonalDiffs = 0;
+        column->mMatchMask = 0;
+    }
+
+    static AK_FORCE_INLINE void updateColumn(const Column *const prev, const uint64_t matchMask,
+            Column *const column) {
+        const uint64_t positiveDiffs = prev->mPositiveDiffs;
+        const uint64_t negativeDiffs = prev->mNegativeDiffs;
+        const uint64_t transpositions =
+                ((~prev->mZeroDiagonalDiffs & matchMask) << 1) & prev->mMatchMask;
+        const uint64_t zeroDiagonalDiffs =
+                (((matchMask & positiveDiffs) + positiveDiffs) ^ positiveDiffs) | matchMask
+                        | negativeDiffs | transpositions;
+        const uint64_t positiveHorizontalDiffs =
+                negativeDiffs | ~(zeroDiagonalDiffs | positiveDiffs);
+        const uint64_t negativeHorizontalDiffs = positiveDiffs & zeroDiagonalDiffs;
+        // The distance to the empty string0 prefix grows by one with each code point of string1.
+        const uint64_t shiftedPositiveHorizontalDiffs = (positiveHorizontalDiffs << 1) | 1;
+        column->mPositiveDiffs = (negativeHorizontalDiffs << 1)
+                | ~(zeroDiagonalDiffs | shiftedPositiveHorizontalDiffs);
+        column->mNegativeDiffs = zeroDiagonalDiffs & shiftedPositiveHorizontalDiffs;
+        column->mZeroDiagonalDiffs = zeroDiagonalDiffs;
+        column->mMatchMask = matchMask;
+    }
+
+    static AK_FORCE_INLINE int getEditDistance(const Column *const column,
+            const int string0Length, const int string1Length) {
+        const uint64_t mask =
+                string0Length >= MAX_STRING0_LENGTH ? ~0ULL : (1ULL << string0Length) - 1;
+        return string1Length + __builtin_popcountll(column->mPositiveDiffs & mask)
+                - __builtin_popcountll(column->mNegativeDiffs & mask);
+    }
+
+    int mString0Length;
+    int mDistinctCodePointCount;
+    int mDistinctCodePoints[MAX_STRING0_LENGTH];
+    uint64_t mDistinctCodePointMasks[MAX_STRING0_LENGTH];
+    Column mColumns[MAX_WORD_LENGTH + 1];
+};
+} // namespace latinime
+#endif // LATINIME_BIT_VECTOR_EDIT_DISTANCE_H
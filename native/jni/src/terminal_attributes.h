@@ -17,8 +17,10 @@
 #ifndef LATINIME_TERMINAL_ATTRIBUTES_H
 #define LATINIME_TERMINAL_ATTRIBUTES_H
 
+#include <cstring>
 #include <stdint.h>
 #include "binary_format.h"
+#include "suggest/core/dictionary/shortcut_table.h"
 
 namespace latinime {
 
@@ -33,7 +35,15 @@ class TerminalAttributes {
      public:
         ShortcutIterator(const uint8_t *dict, const int pos, const uint8_t flags)
                 : mDict(dict), mPos(pos),
-                  mHasNextShortcutTarget(0 != (flags & BinaryFormat::FLAG_HAS_SHORTCUT_TARGETS)) {
+                  mHasNextShortcutTarget(0 != (flags & BinaryFormat::FLAG_HAS_SHORTCUT_TARGETS)),
+                  mShortcutTable(0), mTargetEnd(0) {
+        }
+
+        // Iterates over the targets of the table from firstTarget to targetEnd, excluded.
+        ShortcutIterator(const ShortcutTable *const shortcutTable, const int firstTarget,
+                const int targetEnd)
+                : mDict(0), mPos(firstTarget), mHasNextShortcutTarget(firstTarget < targetEnd),
+                  mShortcutTable(shortcutTable), mTargetEnd(targetEnd) {
         }
 
         inline bool hasNextShortcutTarget() const {
@@ -43,6 +53,15 @@ class TerminalAttributes {
         // Gets the shortcut target itself as an int string. For parameters and return value
         // see BinaryFormat::getWordAtAddress.
         inline int getNextShortcutTarget(const int maxDepth, int *outWord, int *outFreq) {
+            if (mShortcutTable) {
+                // mPos is the index of the target in the table.
+                const int length = mShortcutTable->getTargetLength(mPos);
+                memcpy(outWord, mShortcutTable->getTargetCodePoints(mPos),
+                        length * sizeof(outWord[0]));
+                *outFreq = mShortcutTable->getTargetProbability(mPos);
+                mHasNextShortcutTarget = ++mPos < mTargetEnd;
+                return length;
+            }
             const int shortcutFlags = BinaryFormat::getFlagsAndForwardPointer(mDict, &mPos);
             mHasNextShortcutTarget = 0 != (shortcutFlags & BinaryFormat::FLAG_ATTRIBUTE_HAS_NEXT);
             unsigned int i;
@@ -59,13 +78,24 @@ class TerminalAttributes {
         const uint8_t *const mDict;
         int mPos;
         bool mHasNextShortcutTarget;
+        const ShortcutTable *const mShortcutTable;
+        const int mTargetEnd;
     };
 
-    TerminalAttributes(const uint8_t *const dict, const uint8_t flags, const int pos)
-            : mDict(dict), mFlags(flags), mStartPos(pos) {
+    // The shortcut targets are copied from shortcutTable if it is not 0.
+    TerminalAttributes(const uint8_t *const dict, const uint8_t flags, const int pos,
+            const ShortcutTable *const shortcutTable)
+            : mDict(dict), mFlags(flags), mStartPos(pos), mShortcutTable(shortcutTable) {
     }
 
     inline ShortcutIterator getShortcutIterator() const {
+        if (mShortcutTable && (mFlags & BinaryFormat::FLAG_HAS_SHORTCUT_TARGETS)) {
+            int targetEnd = 0;
+            const int firstTarget = mShortcutTable->findFirstTarget(mStartPos, &targetEnd);
+            if (firstTarget != NOT_AN_INDEX) {
+                return ShortcutIterator(mShortcutTable, firstTarget, targetEnd);
+            }
+        }
         // The size of the shortcuts is stored here so that the whole shortcut chunk can be
         // skipped quickly, so we ignore it.
         return ShortcutIterator(mDict, mStartPos + BinaryFormat::SHORTCUT_LIST_SIZE_SIZE, mFlags);
@@ -80,6 +110,7 @@ class TerminalAttributes {
     const uint8_t *const mDict;
     const uint8_t mFlags;
     const int mStartPos;
+    const ShortcutTable *const mShortcutTable;
 };
 } // namespace latinime
 #endif // LATINIME_TERMINAL_ATTRIBUTES_H
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: thread_placement.cpp"
+
+#include "thread_placement.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace latinime {
+
+// Android's THREAD_PRIORITY_BACKGROUND
+const int ThreadPlacement::BACKGROUND_PRIORITY = 10;
+
+pthread_once_t ThreadPlacement::sCoreClassesOnce = PTHREAD_ONCE_INIT;
+bool ThreadPlacement::sHasCoreClasses = false;
+cpu_set_t ThreadPlacement::sFastCores;
+cpu_set_t ThreadPlacement::sSlowCores;
+
+/* static */ bool ThreadPlacement::createThread(pthread_t *const thread,
+        const ThreadClass threadClass, void *(*startRoutine)(void *), void *const arg) {
+    ThreadArgs *const threadArgs = new ThreadArgs();
+    threadArgs->mThreadClass = threadClass;
+    threadArgs->mStartRoutine = startRoutine;
+    threadArgs->mArg = arg;
+    if (pthread_create(thread, 0, threadMain, threadArgs) != 0) {
+        delete threadArgs;
+        return false;
+    }
+    return true;
+}
+
+/* static */ void *ThreadPlacement::threadMain(void *args) {
+    ThreadArgs *const threadArgs = static_cast<ThreadArgs *>(args);
+    void *(*const startRoutine)(void *) = threadArgs->mStartRoutine;
+    void *const arg = threadArgs->mArg;
+    placeCurrentThread(threadArgs->mThreadClass);
+    delete threadArgs;
+    return startRoutine(arg);
+}
+
+/* static */ void ThreadPlacement::placeCurrentThread(const ThreadClass threadClass) {
+    const cpu_set_t *const cores = getCores(threadClass);
+    // The cpuset of the process may exclude all of them, which leaves the thread where it was.
+    if (cores && sched_setaffinity(0, sizeof(*cores), cores) != 0 && DEBUG_DICT) {
+        AKLOGI("Can't set the affinity of a thread. errno=%d", errno);
+    }
+    if (THREAD_CLASS_BACKGROUND == threadClass
+            && setpriority(PRIO_PROCESS, getCurrentThreadId(), BACKGROUND_PRIORITY) != 0) {
+        AKLOGI("Can't lower the priority of a thread. errno=%d", errno);
+    }
+}
+
+/* static */ const cpu_set_t *ThreadPlacement::getCores(const ThreadClass threadClass) {
+    pthread_once(&sCoreClassesOnce, findCoreClasses);
+    if (!sHasCoreClasses) {
+        return 0;
+    }
+    return THREAD_CLASS_LATENCY_CRITICAL == threadClass ? &sFastCores : &sSlowCores;
+}
+
+// The cores whose frequency is not known, e.g. because they are offline, are left out.
+/* static */ void ThreadPlacement::findCoreClasses() {
+    CPU_ZERO(&sFastCores);
+    CPU_ZERO(&sSlowCores);
+    const int coreCount = min(static_cast<int>(sysconf(_SC_NPROCESSORS_CONF)), CPU_SETSIZE);
+    int maxFrequencies[CPU_SETSIZE];
+    int fastestFrequency = 0;
+    int slowestFrequency = 0;
+    for (int i = 0; i < coreCount; ++i) {
+        maxFrequencies[i] = 0;
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq",
+                i);
+        FILE *const file = fopen(path, "r");
+        if (!file) {
+            continue;
+        }
+        if (fscanf(file, "%d", &maxFrequencies[i]) != 1) {
+            maxFrequencies[i] = 0;
+        }
+        fclose(file);
+        if (maxFrequencies[i] <= 0) {
+            continue;
+        }
+        fastestFrequency = max(fastestFrequency, maxFrequencies[i]);
+        slowestFrequency = slowestFrequency > 0
+                ? min(slowestFrequency, maxFrequencies[i]) : maxFrequencies[i];
+    }
+    sHasCoreClasses = slowestFrequency > 0 && slowestFrequency < fastestFrequency;
+    if (!sHasCoreClasses) {
+        return;
+    }
+    for (int i = 0; i < coreCount; ++i) {
+        if (maxFrequencies[i] == fastestFrequency) {
+            CPU_SET(i, &sFastCores);
+        } else if (maxFrequencies[i] == slowestFrequency) {
+            CPU_SET(i, &sSlowCores);
+        }
+    }
+    if (DEBUG_DICT) {
+        AKLOGI("Core classes: the fast cores run at %d kHz, the slow ones at %d kHz",
+                fastestFrequency, slowestFrequency);
+    }
+}
+
+/* static */ int ThreadPlacement::getCurrentThreadId() {
+    return static_cast<int>(syscall(__NR_gettid));
+}
+
+ScopedThreadPlacement::ScopedThreadPlacement(const ThreadPlacement::ThreadClass threadClass)
+        : mPreviousCores(), mHasPreviousCores(false) {
+    const cpu_set_t *const cores = ThreadPlacement::getCores(threadClass);
+    if (!cores || sched_getaffinity(0, sizeof(mPreviousCores), &mPreviousCores) != 0) {
+        return;
+    }
+    mHasPreviousCores = sched_setaffinity(0, sizeof(*cores), cores) == 0;
+}
+
+ScopedThreadPlacement::~ScopedThreadPlacement() {
+    if (mHasPreviousCores) {
+        sched_setaffinity(0, sizeof(mPreviousCores), &mPreviousCores);
+    }
+}
+} // namespace latinime
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_THREAD_PLACEMENT_H
+#define LATINIME_THREAD_PLACEMENT_H
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * Where the native threads run. On SoCs with cores of different speeds, the threads on the
+ * critical path of a suggestion run on the fastest cores, and the background ones on the slowest
+ * cores at a low priority, so that they neither slow down the suggestions nor keep the fast cores
+ * awake. The classes of the cores are told apart by their maximum frequencies; when all the cores
+ * are alike, only the priority of the background threads is lowered.
+ */
+class ThreadPlacement {
+ public:
+    enum ThreadClass {
+        // Expansion workers
+        THREAD_CLASS_LATENCY_CRITICAL,
+        // Page warming, speculation of the next input
+        THREAD_CLASS_BACKGROUND
+    };
+
+    // Creates a thread of threadClass as pthread_create does, and returns whether it was
+    // created. The thread places itself before running startRoutine.
+    static bool createThread(pthread_t *const thread, const ThreadClass threadClass,
+            void *(*startRoutine)(void *), void *const arg);
+
+    // Places the calling thread as a thread of threadClass.
+    static void placeCurrentThread(const ThreadClass threadClass);
+
+    // Returns the cores of threadClass, or 0 if the threads of this class may run on any core.
+    static const cpu_set_t *getCores(const ThreadClass threadClass);
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ThreadPlacement);
+
+    // The nice value of the background threads
+    static const int BACKGROUND_PRIORITY;
+
+    struct ThreadArgs {
+        ThreadClass mThreadClass;
+        void *(*mStartRoutine)(void *);
+        void *mArg;
+    };
+
+    static void *threadMain(void *args);
+    static void findCoreClasses();
+    static int getCurrentThreadId();
+
+    static pthread_once_t sCoreClassesOnce;
+    // Whether the cores are of several classes, and the cores of the fastest and the slowest one
+    static bool sHasCoreClasses;
+    static cpu_set_t sFastCores;
+    static cpu_set_t sSlowCores;
+};
+
+/**
+ * Moves the calling thread to the cores of a class for the lifetime of this object, and then
+ * restores its previous affinity. This is for the work of another class on a thread that is not
+ * ours, e.g. a speculation on the Java thread of the suggestions. The priority is kept, as an
+ * unprivileged thread may not raise it back once lowered.
+ */
+class ScopedThreadPlacement {
+ public:
+    explicit ScopedThreadPlacement(const ThreadPlacement::ThreadClass threadClass);
+    // Non virtual destructor -- never inherit this class
+    ~ScopedThreadPlacement();
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ScopedThreadPlacement);
+
+    cpu_set_t mPreviousCores;
+    bool mHasPreviousCores;
+};
+} // namespace latinime
+#endif // LATINIME_THREAD_PLACEMENT_H
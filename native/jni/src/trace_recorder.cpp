@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatinIME: trace_recorder.cpp"
+
+#include "trace_recorder.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace latinime {
+
+namespace {
+
+struct Span {
+    int mPhase;
+    int mThreadId;
+    int64_t mStartTimeNs;
+    int64_t mDurationNs;
+};
+
+const char *const PHASE_NAMES[TraceRecorder::PHASE_COUNT] = {
+    "openDictionary", "getSuggestions", "sessionSetup", "search", "output", "getBigrams"
+};
+
+const char *const SYSTRACE_MARKER_PATH = "/sys/kernel/debug/tracing/trace_marker";
+
+pthread_mutex_t sSpansMutex = PTHREAD_MUTEX_INITIALIZER;
+Span sSpans[TraceRecorder::MAX_SPAN_COUNT];
+// The total numbers of spans written and drained. The ring buffer holds the spans in between.
+int64_t sWrittenSpanCount = 0;
+int64_t sDrainedSpanCount = 0;
+int sSystraceFd = -1;
+
+AK_FORCE_INLINE int getThreadId() {
+    return static_cast<int>(syscall(__NR_gettid));
+}
+
+// Writes the begin (B) or end (E) marker of a phase.
+void writeSystraceMarker(const char markerType, const int phase) {
+    const int fd = sSystraceFd;
+    if (fd < 0) {
+        return;
+    }
+    char marker[64];
+    const int length = snprintf(marker, sizeof(marker), "%c|%d|LatinIME:%s", markerType,
+            static_cast<int>(getpid()), PHASE_NAMES[phase]);
+    if (length > 0 && length < static_cast<int>(sizeof(marker))) {
+        // A marker that cannot be written is only missing from the trace.
+        const ssize_t written = write(fd, marker, length);
+        (void)written;
+    }
+}
+
+} // namespace
+
+volatile int TraceRecorder::sFlags = 0;
+
+/* static */ const char *TraceRecorder::getPhaseName(const int phase) {
+    return PHASE_NAMES[phase];
+}
+
+/* static */ void TraceRecorder::setFlags(const int flags) {
+    pthread_mutex_lock(&sSpansMutex);
+    if ((flags & TRACE_FLAG_SYSTRACE) && sSystraceFd < 0) {
+        sSystraceFd = open(SYSTRACE_MARKER_PATH, O_WRONLY);
+        if (sSystraceFd < 0) {
+            AKLOGI("Cannot open the systrace marker file.");
+        }
+    }
+    // The file is kept open when systrace is disabled, since a span in flight may still write
+    // its end marker.
+    sFlags = flags;
+    pthread_mutex_unlock(&sSpansMutex);
+}
+
+/* static */ int64_t TraceRecorder::beginSpan(const int phase) {
+    if (sFlags & TRACE_FLAG_SYSTRACE) {
+        writeSystraceMarker('B', phase);
+    }
+    const int64_t startTimeNs = getCurrentTimeNs();
+    return startTimeNs != 0 ? startTimeNs : 1;
+}
+
+/* static */ void TraceRecorder::endSpan(const int phase, const int64_t startTimeNs) {
+    const int64_t durationNs = getCurrentTimeNs() - startTimeNs;
+    const int flags = sFlags;
+    if (flags & TRACE_FLAG_SYSTRACE) {
+        writeSystraceMarker('E', phase);
+    }
+    if (!(flags & TRACE_FLAG_RECORD_SPANS)) {
+        return;
+    }
+    const int threadId = getThreadId();
+    pthread_mutex_lock(&sSpansMutex);
+    Span *const span = &sSpans[sWrittenSpanCount % MAX_SPAN_COUNT];
+    span->mPhase = phase;
+    span->mThreadId = threadId;
+    span->mStartTimeNs = startTimeNs;
+    span->mDurationNs = durationNs;
+    ++sWrittenSpanCount;
+    if (sWrittenSpanCount - sDrainedSpanCount > MAX_SPAN_COUNT) {
+        // The oldest span was overwritten.
+        sDrainedSpanCount = sWrittenSpanCount - MAX_SPAN_COUNT;
+    }
+    pthread_mutex_unlock(&sSpansMutex);
+}
+
+/* static */ int TraceRecorder::drainSpans(const int maxCount, int *const outPhases,
+        int *const outThreadIds, int64_t *const outStartTimesNs,
+        int64_t *const outDurationsNs) {
+    pthread_mutex_lock(&sSpansMutex);
+    int count = 0;
+    while (count < maxCount && sDrainedSpanCount < sWrittenSpanCount) {
+        const Span *const span = &sSpans[sDrainedSpanCount % MAX_SPAN_COUNT];
+        outPhases[count] = span->mPhase;
+        outThreadIds[count] = span->mThreadId;
+        outStartTimesNs[count] = span->mStartTimeNs;
+        outDurationsNs[count] = span->mDurationNs;
+        ++sDrainedSpanCount;
+        ++count;
+    }
+    pthread_mutex_unlock(&sSpansMutex);
+    return count;
+}
+} // namespace latinime
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_TRACE_RECORDER_H
+#define LATINIME_TRACE_RECORDER_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "defines.h"
+
+namespace latinime {
+
+/**
+ * Process-wide recorder of the time spans of the phases of the native calls, compiled in all
+ * builds and enabled at runtime. The spans are kept in a ring buffer that Java drains, and can
+ * also be written as systrace markers. Unlike the PROF_* macros, this does not need a profiling
+ * build, whose -fno-inline changes the timing of the inlined hot paths. When it is disabled a
+ * span only costs reading a flag at its start and its end. Thread safe.
+ */
+class TraceRecorder {
+ public:
+    // Taken from BinaryDictionary.java
+    static const int TRACE_FLAG_RECORD_SPANS = 0x1;
+    static const int TRACE_FLAG_SYSTRACE = 0x2;
+
+    // Taken from BinaryDictionary.java
+    static const int PHASE_OPEN_DICTIONARY = 0;
+    static const int PHASE_GET_SUGGESTIONS = 1; // A whole suggestion call
+    static const int PHASE_SESSION_SETUP = 2; // Input states and the first dicNodes
+    static const int PHASE_SEARCH = 3; // Expanding the dicNodes up to the end of the input
+    static const int PHASE_OUTPUT = 4; // Scoring and sorting the terminal dicNodes
+    static const int PHASE_GET_BIGRAMS = 5;
+    static const int PHASE_COUNT = 6;
+
+    // The number of spans kept. Older spans are overwritten when Java does not drain them.
+    static const int MAX_SPAN_COUNT = 1024;
+
+    // The name of the phase in the systrace markers, e.g. "search".
+    static const char *getPhaseName(const int phase);
+
+    // A combination of the TRACE_FLAG_* flags, or 0 to disable tracing.
+    static void setFlags(const int flags);
+
+    static AK_FORCE_INLINE bool isEnabled() {
+        return sFlags != 0;
+    }
+
+    // Starts a span and returns its start time, which is never 0.
+    static int64_t beginSpan(const int phase);
+    static void endSpan(const int phase, const int64_t startTimeNs);
+
+    // Moves up to maxCount of the oldest spans to the arrays and returns their number.
+    static int drainSpans(const int maxCount, int *const outPhases, int *const outThreadIds,
+            int64_t *const outStartTimesNs, int64_t *const outDurationsNs);
+
+    static AK_FORCE_INLINE int64_t getCurrentTimeNs() {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    }
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(TraceRecorder);
+
+    // Read without a lock by every span, hence volatile.
+    static volatile int sFlags;
+};
+
+// Records a span of the phase from its construction to end() or its destruction.
+class TraceSpan {
+ public:
+    AK_FORCE_INLINE explicit TraceSpan(const int phase)
+            : mPhase(phase),
+              mStartTimeNs(TraceRecorder::isEnabled() ? TraceRecorder::beginSpan(phase) : 0) {}
+
+    // Non virtual inline destructor -- never inherit this class
+    AK_FORCE_INLINE ~TraceSpan() {
+        end();
+    }
+
+    AK_FORCE_INLINE void end() {
+        if (mStartTimeNs != 0) {
+            TraceRecorder::endSpan(mPhase, mStartTimeNs);
+            mStartTimeNs = 0;
+        }
+    }
+
+ private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(TraceSpan);
+
+    const int mPhase;
+    int64_t mStartTimeNs;
+};
+} // namespace latinime
+#endif // LATINIME_TRACE_RECORDER_H
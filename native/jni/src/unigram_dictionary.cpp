@@ -24,6 +24,7 @@
 #include "dictionary.h"
 #include "digraph_utils.h"
 #include "proximity_info.h"
+#include "suggest/core/dictionary/terminal_position_index.h"
 #include "terminal_attributes.h"
 #include "unigram_dictionary.h"
 #include "words_priority_queue.h"
@@ -31,10 +32,19 @@
 
 namespace latinime {
 
+// The 8 bit truncation of the count is how the limit has always been checked.
+static AK_FORCE_INLINE bool isTotalTraverseCountExceeded(const int totalTraverseCount) {
+    return static_cast<uint8_t>(totalTraverseCount)
+            > MULTIPLE_WORDS_SUGGESTION_MAX_TOTAL_TRAVERSE_COUNT;
+}
+
 // TODO: check the header
-UnigramDictionary::UnigramDictionary(const uint8_t *const streamStart, const unsigned int dictFlags)
+UnigramDictionary::UnigramDictionary(const uint8_t *const streamStart, const unsigned int dictFlags,
+        const TerminalPositionIndex *const terminalPositionIndex,
+        const ShortcutTable *const shortcutTable)
         : DICT_ROOT(streamStart), ROOT_POS(0),
-          MAX_DIGRAPH_SEARCH_DEPTH(DEFAULT_MAX_DIGRAPH_SEARCH_DEPTH), DICT_FLAGS(dictFlags) {
+          MAX_DIGRAPH_SEARCH_DEPTH(DEFAULT_MAX_DIGRAPH_SEARCH_DEPTH), DICT_FLAGS(dictFlags),
+          mTerminalPositionIndex(terminalPositionIndex), mShortcutTable(shortcutTable) {
     if (DEBUG_DICT) {
         AKLOGI("UnigramDictionary - constructor");
     }
@@ -48,135 +58,24 @@ static void addWord(int *word, int length, int probability, WordsPriorityQueue *
     queue->push(probability, word, length, type);
 }
 
-// Return the replacement code point for a digraph, or 0 if none.
-int UnigramDictionary::getDigraphReplacement(const int *codes, const int i, const int inputSize,
-        const DigraphUtils::digraph_t *const digraphs, const unsigned int digraphsSize) const {
-
-    // There can't be a digraph if we don't have at least 2 characters to examine
-    if (i + 2 > inputSize) return false;
-
-    // Search for the first char of some digraph
-    int lastDigraphIndex = -1;
-    const int thisChar = codes[i];
-    for (lastDigraphIndex = digraphsSize - 1; lastDigraphIndex >= 0; --lastDigraphIndex) {
-        if (thisChar == digraphs[lastDigraphIndex].first) break;
-    }
-    // No match: return early
-    if (lastDigraphIndex < 0) return 0;
-
-    // It's an interesting digraph if the second char matches too.
-    if (digraphs[lastDigraphIndex].second == codes[i + 1]) {
-        return digraphs[lastDigraphIndex].compositeGlyph;
-    } else {
-        return 0;
-    }
-}
-
-// Mostly the same arguments as the non-recursive version, except:
-// codes is the original value. It points to the start of the work buffer, and gets passed as is.
-// inputSize is the size of the user input (thus, it is the size of codesSrc).
-// codesDest is the current point in the work buffer.
-// codesSrc is the current point in the user-input, original, content-unmodified buffer.
-// codesRemain is the remaining size in codesSrc.
-void UnigramDictionary::getWordWithDigraphSuggestionsRec(ProximityInfo *proximityInfo,
-        const int *xcoordinates, const int *ycoordinates, const int *codesBuffer,
-        int *xCoordinatesBuffer, int *yCoordinatesBuffer,
-        const int codesBufferSize, const std::map<int, int> *bigramMap, const uint8_t *bigramFilter,
-        const bool useFullEditDistance, const int *codesSrc,
-        const int codesRemain, const int currentDepth, int *codesDest, Correction *correction,
-        WordsPriorityQueuePool *queuePool,
-        const DigraphUtils::digraph_t *const digraphs, const unsigned int digraphsSize) const {
-    ASSERT(sizeof(codesDest[0]) == sizeof(codesSrc[0]));
-    ASSERT(sizeof(xCoordinatesBuffer[0]) == sizeof(xcoordinates[0]));
-    ASSERT(sizeof(yCoordinatesBuffer[0]) == sizeof(ycoordinates[0]));
-
-    const int startIndex = static_cast<int>(codesDest - codesBuffer);
-    if (currentDepth < MAX_DIGRAPH_SEARCH_DEPTH) {
-        for (int i = 0; i < codesRemain; ++i) {
-            xCoordinatesBuffer[startIndex + i] = xcoordinates[codesBufferSize - codesRemain + i];
-            yCoordinatesBuffer[startIndex + i] = ycoordinates[codesBufferSize - codesRemain + i];
-            const int replacementCodePoint =
-                    getDigraphReplacement(codesSrc, i, codesRemain, digraphs, digraphsSize);
-            if (0 != replacementCodePoint) {
-                // Found a digraph. We will try both spellings. eg. the word is "pruefen"
-
-                // Copy the word up to the first char of the digraph, including proximity chars,
-                // and overwrite the primary code with the replacement code point. Then, continue
-                // processing on the remaining part of the word, skipping the second char of the
-                // digraph.
-                // In our example, copy "pru", replace "u" with the version with the diaeresis and
-                // continue running on "fen".
-                // Make i the index of the second char of the digraph for simplicity. Forgetting
-                // to do that results in an infinite recursion so take care!
-                ++i;
-                memcpy(codesDest, codesSrc, i * sizeof(codesDest[0]));
-                codesDest[i - 1] = replacementCodePoint;
-                getWordWithDigraphSuggestionsRec(proximityInfo, xcoordinates, ycoordinates,
-                        codesBuffer, xCoordinatesBuffer, yCoordinatesBuffer, codesBufferSize,
-                        bigramMap, bigramFilter, useFullEditDistance, codesSrc + i + 1,
-                        codesRemain - i - 1, currentDepth + 1, codesDest + i, correction,
-                        queuePool, digraphs, digraphsSize);
-
-                // Copy the second char of the digraph in place, then continue processing on
-                // the remaining part of the word.
-                // In our example, after "pru" in the buffer copy the "e", and continue on "fen"
-                memcpy(codesDest + i, codesSrc + i, sizeof(codesDest[0]));
-                getWordWithDigraphSuggestionsRec(proximityInfo, xcoordinates, ycoordinates,
-                        codesBuffer, xCoordinatesBuffer, yCoordinatesBuffer, codesBufferSize,
-                        bigramMap, bigramFilter, useFullEditDistance, codesSrc + i, codesRemain - i,
-                        currentDepth + 1, codesDest + i, correction, queuePool, digraphs,
-                        digraphsSize);
-                return;
-            }
-        }
-    }
-
-    // If we come here, we hit the end of the word: let's check it against the dictionary.
-    // In our example, we'll come here once for "prufen" and then once for "pruefen".
-    // If the word contains several digraphs, we'll come it for the product of them.
-    // eg. if the word is "ueberpruefen" we'll test, in order, against
-    // "uberprufen", "uberpruefen", "ueberprufen", "ueberpruefen".
-    const unsigned int remainingBytes = sizeof(codesDest[0]) * codesRemain;
-    if (0 != remainingBytes) {
-        memcpy(codesDest, codesSrc, remainingBytes);
-        memcpy(&xCoordinatesBuffer[startIndex], &xcoordinates[codesBufferSize - codesRemain],
-                sizeof(xCoordinatesBuffer[0]) * codesRemain);
-        memcpy(&yCoordinatesBuffer[startIndex], &ycoordinates[codesBufferSize - codesRemain],
-                sizeof(yCoordinatesBuffer[0]) * codesRemain);
-    }
-
-    getWordSuggestions(proximityInfo, xCoordinatesBuffer, yCoordinatesBuffer, codesBuffer,
-            startIndex + codesRemain, bigramMap, bigramFilter, useFullEditDistance, correction,
-            queuePool);
-}
-
 // bigramMap contains the association <bigram address> -> <bigram probability>
-// bigramFilter is a bloom filter for fast rejection: see functions setInFilter and isInFilter
-// in bigram_dictionary.cpp
+// It has a bloom filter for fast rejection: see bloom_filter.h
 int UnigramDictionary::getSuggestions(ProximityInfo *proximityInfo, const int *xcoordinates,
         const int *ycoordinates, const int *inputCodePoints, const int inputSize,
-        const std::map<int, int> *bigramMap, const uint8_t *bigramFilter,
-        const bool useFullEditDistance, int *outWords, int *frequencies, int *outputTypes) const {
+        const BigramProbabilityMap *bigramMap, const bool useFullEditDistance, int *outWords,
+        int *frequencies, int *outputTypes) const {
     WordsPriorityQueuePool queuePool(MAX_RESULTS, SUB_QUEUE_MAX_WORDS);
     queuePool.clearAll();
     Correction masterCorrection;
     masterCorrection.resetCorrection();
+    // The digraphs are matched to the composite glyphs in the traversal, so that a word like
+    // "pruefen" finds both "pruefen" and "pr[u-umlaut]fen" at once.
     const DigraphUtils::digraph_t *digraphs = 0;
     const int digraphsSize =
             DigraphUtils::getAllDigraphsForDictionaryAndReturnSize(DICT_FLAGS, &digraphs);
-    if (digraphsSize > 0)
-    { // Incrementally tune the word and try all possibilities
-        int codesBuffer[sizeof(*inputCodePoints) * inputSize];
-        int xCoordinatesBuffer[inputSize];
-        int yCoordinatesBuffer[inputSize];
-        getWordWithDigraphSuggestionsRec(proximityInfo, xcoordinates, ycoordinates, codesBuffer,
-                xCoordinatesBuffer, yCoordinatesBuffer, inputSize, bigramMap, bigramFilter,
-                useFullEditDistance, inputCodePoints, inputSize, 0, codesBuffer, &masterCorrection,
-                &queuePool, digraphs, digraphsSize);
-    } else { // Normal processing
-        getWordSuggestions(proximityInfo, xcoordinates, ycoordinates, inputCodePoints, inputSize,
-                bigramMap, bigramFilter, useFullEditDistance, &masterCorrection, &queuePool);
-    }
+    masterCorrection.setDigraphs(digraphs, digraphsSize);
+    getWordSuggestions(proximityInfo, xcoordinates, ycoordinates, inputCodePoints, inputSize,
+            bigramMap, useFullEditDistance, &masterCorrection, &queuePool);
 
     PROF_START(20);
     if (DEBUG_DICT) {
@@ -210,16 +109,15 @@ int UnigramDictionary::getSuggestions(ProximityInfo *proximityInfo, const int *x
 
 void UnigramDictionary::getWordSuggestions(ProximityInfo *proximityInfo, const int *xcoordinates,
         const int *ycoordinates, const int *inputCodePoints, const int inputSize,
-        const std::map<int, int> *bigramMap, const uint8_t *bigramFilter,
-        const bool useFullEditDistance, Correction *correction, WordsPriorityQueuePool *queuePool)
-        const {
+        const BigramProbabilityMap *bigramMap, const bool useFullEditDistance,
+        Correction *correction, WordsPriorityQueuePool *queuePool) const {
     PROF_OPEN;
     PROF_START(0);
     PROF_END(0);
 
     PROF_START(1);
     getOneWordSuggestions(proximityInfo, xcoordinates, ycoordinates, inputCodePoints, bigramMap,
-            bigramFilter, useFullEditDistance, inputSize, correction, queuePool);
+            useFullEditDistance, inputSize, correction, queuePool);
     PROF_END(1);
 
     PROF_START(2);
@@ -289,23 +187,22 @@ void UnigramDictionary::initSuggestions(ProximityInfo *proximityInfo, const int
 
 void UnigramDictionary::getOneWordSuggestions(ProximityInfo *proximityInfo,
         const int *xcoordinates, const int *ycoordinates, const int *codes,
-        const std::map<int, int> *bigramMap, const uint8_t *bigramFilter,
-        const bool useFullEditDistance, const int inputSize,
-        Correction *correction, WordsPriorityQueuePool *queuePool) const {
+        const BigramProbabilityMap *bigramMap, const bool useFullEditDistance,
+        const int inputSize, Correction *correction, WordsPriorityQueuePool *queuePool) const {
     initSuggestions(proximityInfo, xcoordinates, ycoordinates, codes, inputSize, correction);
-    getSuggestionCandidates(useFullEditDistance, inputSize, bigramMap, bigramFilter, correction,
+    getSuggestionCandidates(useFullEditDistance, inputSize, bigramMap, correction,
             queuePool, true /* doAutoCompletion */, DEFAULT_MAX_ERRORS, FIRST_WORD_INDEX);
 }
 
 void UnigramDictionary::getSuggestionCandidates(const bool useFullEditDistance,
-        const int inputSize, const std::map<int, int> *bigramMap, const uint8_t *bigramFilter,
+        const int inputSize, const BigramProbabilityMap *bigramMap,
         Correction *correction, WordsPriorityQueuePool *queuePool,
         const bool doAutoCompletion, const int maxErrors, const int currentWordIndex) const {
     uint8_t totalTraverseCount = correction->pushAndGetTotalTraverseCount();
     if (DEBUG_DICT) {
         AKLOGI("Traverse count %d", totalTraverseCount);
     }
-    if (totalTraverseCount > MULTIPLE_WORDS_SUGGESTION_MAX_TOTAL_TRAVERSE_COUNT) {
+    if (isTotalTraverseCountExceeded(totalTraverseCount)) {
         if (DEBUG_DICT) {
             AKLOGI("Abort traversing %d", totalTraverseCount);
         }
@@ -329,10 +226,12 @@ void UnigramDictionary::getSuggestionCandidates(const bool useFullEditDistance,
             int firstChildPos;
 
             const bool needsToTraverseChildrenNodes = processCurrentNode(siblingPos,
-                    bigramMap, bigramFilter, correction, &childCount, &firstChildPos, &siblingPos,
+                    bigramMap, correction, &childCount, &firstChildPos, &siblingPos,
                     queuePool, currentWordIndex);
-            // Update next sibling pos
-            correction->setTreeSiblingPos(outputIndex, siblingPos);
+            // Update next sibling pos, unless this node is visited again for a digraph
+            if (!correction->retryCurrentNodeForDigraphs(outputIndex)) {
+                correction->setTreeSiblingPos(outputIndex, siblingPos);
+            }
 
             if (needsToTraverseChildrenNodes) {
                 // Goes to child node
@@ -420,7 +319,8 @@ int UnigramDictionary::getSubStringSuggestion(
         const bool hasAutoCorrectionCandidate, const int currentWordIndex,
         const int inputWordStartPos, const int inputWordLength,
         const int outputWordStartPos, const bool isSpaceProximity, int *freqArray,
-        int *wordLengthArray, int *outputWord, int *outputWordLength) const {
+        int *wordLengthArray, int *outputWord, int *outputWordLength,
+        SubStringCandidateCache *candidateCache) const {
     if (inputWordLength > MULTIPLE_WORDS_SUGGESTION_MAX_WORD_LENGTH) {
         return FLAG_MULTIPLE_SUGGEST_ABORT;
     }
@@ -463,57 +363,34 @@ int UnigramDictionary::getSubStringSuggestion(
     // TODO: Remove the safety net above        //
     //////////////////////////////////////////////
 
-    int *tempOutputWord = 0;
-    int nextWordLength = 0;
-    // TODO: Optimize init suggestion
-    initSuggestions(proximityInfo, xcoordinates, ycoordinates, codes,
-            inputSize, correction);
-
-    int word[MAX_WORD_LENGTH];
-    int freq = getMostProbableWordLike(
-            inputWordStartPos, inputWordLength, correction, word);
-    if (freq > 0) {
-        nextWordLength = inputWordLength;
-        tempOutputWord = word;
-    } else if (!hasAutoCorrectionCandidate) {
-        if (inputWordStartPos > 0) {
-            const int offset = inputWordStartPos;
-            initSuggestions(proximityInfo, &xcoordinates[offset], &ycoordinates[offset],
-                    codes + offset, inputWordLength, correction);
-            queuePool->clearSubQueue(currentWordIndex);
-            // TODO: pass the bigram list for substring suggestion
-            getSuggestionCandidates(useFullEditDistance, inputWordLength,
-                    0 /* bigramMap */, 0 /* bigramFilter */, correction, queuePool,
-                    false /* doAutoCompletion */, MAX_ERRORS_FOR_TWO_WORDS, currentWordIndex);
-            if (DEBUG_DICT) {
-                if (currentWordIndex < MULTIPLE_WORDS_SUGGESTION_MAX_WORDS) {
-                    AKLOGI("Dump word candidates(%d) %d", currentWordIndex, inputWordLength);
-                    for (int i = 0; i < SUB_QUEUE_MAX_COUNT; ++i) {
-                        queuePool->getSubQueue(currentWordIndex, i)->dumpTopWord();
-                    }
-                }
-            }
-        }
-        WordsPriorityQueue *queue = queuePool->getSubQueue(currentWordIndex, inputWordLength);
-        // TODO: Return the correct value depending on doAutoCompletion
-        if (!queue || queue->size() <= 0) {
-            return FLAG_MULTIPLE_SUGGEST_ABORT;
-        }
-        int score = 0;
-        const float ns = queue->getHighestNormalizedScore(
-                correction->getPrimaryInputWord(), inputWordLength,
-                &tempOutputWord, &score, &nextWordLength);
-        if (DEBUG_DICT) {
-            AKLOGI("NS(%d) = %f, Score = %d", currentWordIndex, ns, score);
-        }
-        // Two words correction won't be done if the score of the first word doesn't exceed the
-        // threshold.
-        if (ns < TWO_WORDS_CORRECTION_WITH_OTHER_ERROR_THRESHOLD
-                || nextWordLength < SUB_QUEUE_MIN_WORD_LENGTH) {
-            return FLAG_MULTIPLE_SUGGEST_SKIP;
+    const SubStringCandidateCache::Candidate *candidate =
+            candidateCache->get(inputWordStartPos, inputWordLength);
+    if (candidate && candidate->mHasSearchedCorrections) {
+        // The search is counted again, and done again if the limit of the traversals would not
+        // give the same result.
+        if (isTotalTraverseCountExceeded(correction->getTotalTraverseCount() + 1)
+                == candidate->mIsTraverseCountExceeded) {
+            correction->pushAndGetTotalTraverseCount();
+        } else {
+            candidate = 0;
         }
-        freq = score >> (nextWordLength + TWO_WORDS_PLUS_OTHER_ERROR_CORRECTION_DEMOTION_DIVIDER);
     }
+    if (candidate) {
+        candidateCache->onReused(candidate);
+    } else {
+        SubStringCandidateCache::Candidate *const newCandidate =
+                candidateCache->add(inputWordStartPos, inputWordLength);
+        getSubStringCandidate(proximityInfo, xcoordinates, ycoordinates, codes,
+                useFullEditDistance, correction, queuePool, inputSize, hasAutoCorrectionCandidate,
+                currentWordIndex, inputWordStartPos, inputWordLength, newCandidate);
+        candidate = newCandidate;
+    }
+    if (candidate->mFlag != FLAG_MULTIPLE_SUGGEST_CONTINUE) {
+        return candidate->mFlag;
+    }
+    const int freq = candidate->mProbability;
+    const int nextWordLength = candidate->mWordLength;
+    const int *const tempOutputWord = candidate->mWord;
     if (DEBUG_DICT) {
         AKLOGI("Freq(%d): %d, length: %d, input length: %d, input start: %d (%d)",
                 currentWordIndex, freq, nextWordLength, inputWordLength, inputWordStartPos,
@@ -530,7 +407,7 @@ int UnigramDictionary::getSubStringSuggestion(
     // Put output values
     freqArray[currentWordIndex] = freq;
     // TODO: put output length instead of input length
-    wordLengthArray[currentWordIndex] = inputWordLength;
+    wordLengthArray[currentWordIndex] = candidate->mMatchedLength;
     const int tempOutputWordLength = outputWordStartPos + nextWordLength;
     if (outputWordLength) {
         *outputWordLength = tempOutputWordLength;
@@ -563,12 +440,90 @@ int UnigramDictionary::getSubStringSuggestion(
     return FLAG_MULTIPLE_SUGGEST_CONTINUE;
 }
 
+// Looks a word up for the substring of the input, first in the dictionary and then as a
+// correction when there is no auto correction candidate.
+void UnigramDictionary::getSubStringCandidate(ProximityInfo *proximityInfo,
+        const int *xcoordinates, const int *ycoordinates, const int *codes,
+        const bool useFullEditDistance, Correction *correction, WordsPriorityQueuePool *queuePool,
+        const int inputSize, const bool hasAutoCorrectionCandidate, const int currentWordIndex,
+        const int inputWordStartPos, const int inputWordLength,
+        SubStringCandidateCache::Candidate *candidate) const {
+    int *tempOutputWord = 0;
+    int nextWordLength = 0;
+    int matchedLength = inputWordLength;
+    // TODO: Optimize init suggestion
+    initSuggestions(proximityInfo, xcoordinates, ycoordinates, codes,
+            inputSize, correction);
+
+    int word[MAX_WORD_LENGTH];
+    int wordLength = 0;
+    int freq = getMostProbableWordLike(
+            inputWordStartPos, inputWordLength, correction, word, &wordLength);
+    if (freq > 0) {
+        nextWordLength = wordLength;
+        // The word is shorter than the substring when it matched digraphs to composite glyphs
+        matchedLength = wordLength;
+        tempOutputWord = word;
+    } else if (!hasAutoCorrectionCandidate) {
+        if (inputWordStartPos > 0) {
+            const int offset = inputWordStartPos;
+            initSuggestions(proximityInfo, &xcoordinates[offset], &ycoordinates[offset],
+                    codes + offset, inputWordLength, correction);
+            candidate->mHasSearchedCorrections = true;
+            candidate->mIsTraverseCountExceeded =
+                    isTotalTraverseCountExceeded(correction->getTotalTraverseCount() + 1);
+            queuePool->clearSubQueue(currentWordIndex);
+            // TODO: pass the bigram list for substring suggestion
+            getSuggestionCandidates(useFullEditDistance, inputWordLength,
+                    0 /* bigramMap */, correction, queuePool,
+                    false /* doAutoCompletion */, MAX_ERRORS_FOR_TWO_WORDS, currentWordIndex);
+            if (DEBUG_DICT) {
+                if (currentWordIndex < MULTIPLE_WORDS_SUGGESTION_MAX_WORDS) {
+                    AKLOGI("Dump word candidates(%d) %d", currentWordIndex, inputWordLength);
+                    for (int i = 0; i < SUB_QUEUE_MAX_COUNT; ++i) {
+                        queuePool->getSubQueue(currentWordIndex, i)->dumpTopWord();
+                    }
+                }
+            }
+        }
+        WordsPriorityQueue *queue = queuePool->getSubQueue(currentWordIndex, inputWordLength);
+        // TODO: Return the correct value depending on doAutoCompletion
+        if (!queue || queue->size() <= 0) {
+            candidate->mFlag = FLAG_MULTIPLE_SUGGEST_ABORT;
+            return;
+        }
+        int score = 0;
+        const float ns = queue->getHighestNormalizedScore(
+                correction->getPrimaryInputWord(), inputWordLength,
+                &tempOutputWord, &score, &nextWordLength);
+        if (DEBUG_DICT) {
+            AKLOGI("NS(%d) = %f, Score = %d", currentWordIndex, ns, score);
+        }
+        // Two words correction won't be done if the score of the first word doesn't exceed the
+        // threshold.
+        if (ns < TWO_WORDS_CORRECTION_WITH_OTHER_ERROR_THRESHOLD
+                || nextWordLength < SUB_QUEUE_MIN_WORD_LENGTH) {
+            candidate->mFlag = FLAG_MULTIPLE_SUGGEST_SKIP;
+            return;
+        }
+        freq = score >> (nextWordLength + TWO_WORDS_PLUS_OTHER_ERROR_CORRECTION_DEMOTION_DIVIDER);
+    }
+    candidate->mFlag = FLAG_MULTIPLE_SUGGEST_CONTINUE;
+    candidate->mProbability = freq;
+    candidate->mWordLength = nextWordLength;
+    candidate->mMatchedLength = matchedLength;
+    if (tempOutputWord) {
+        memcpy(candidate->mWord, tempOutputWord, nextWordLength * sizeof(tempOutputWord[0]));
+    }
+}
+
 void UnigramDictionary::getMultiWordsSuggestionRec(ProximityInfo *proximityInfo,
         const int *xcoordinates, const int *ycoordinates, const int *codes,
         const bool useFullEditDistance, const int inputSize, Correction *correction,
         WordsPriorityQueuePool *queuePool, const bool hasAutoCorrectionCandidate,
         const int startInputPos, const int startWordIndex, const int outputWordLength,
-        int *freqArray, int *wordLengthArray, int *outputWord) const {
+        int *freqArray, int *wordLengthArray, int *outputWord,
+        SubStringCandidateCache *candidateCache) const {
     if (startWordIndex >= (MULTIPLE_WORDS_SUGGESTION_MAX_WORDS - 1)) {
         // Return if the last word index
         return;
@@ -593,7 +548,7 @@ void UnigramDictionary::getMultiWordsSuggestionRec(ProximityInfo *proximityInfo,
                 codes, useFullEditDistance, correction, queuePool, inputSize,
                 hasAutoCorrectionCandidate, startWordIndex, inputWordStartPos, inputWordLength,
                 outputWordLength, true /* not used */, freqArray, wordLengthArray, outputWord,
-                &tempOutputWordLength);
+                &tempOutputWordLength, candidateCache);
         if (suggestionFlag == FLAG_MULTIPLE_SUGGEST_ABORT) {
             // TODO: break here
             continue;
@@ -611,12 +566,12 @@ void UnigramDictionary::getMultiWordsSuggestionRec(ProximityInfo *proximityInfo,
         if (getSubStringSuggestion(proximityInfo, xcoordinates, ycoordinates, codes,
                 useFullEditDistance, correction, queuePool, inputSize, hasAutoCorrectionCandidate,
                 startWordIndex + 1, inputWordStartPos, inputWordLength, tempOutputWordLength,
-                false /* missing space */, freqArray, wordLengthArray, outputWord, 0)
-                        != FLAG_MULTIPLE_SUGGEST_CONTINUE) {
+                false /* missing space */, freqArray, wordLengthArray, outputWord, 0,
+                candidateCache) != FLAG_MULTIPLE_SUGGEST_CONTINUE) {
             getMultiWordsSuggestionRec(proximityInfo, xcoordinates, ycoordinates, codes,
                     useFullEditDistance, inputSize, correction, queuePool,
                     hasAutoCorrectionCandidate, inputWordStartPos, startWordIndex + 1,
-                    tempOutputWordLength, freqArray, wordLengthArray, outputWord);
+                    tempOutputWordLength, freqArray, wordLengthArray, outputWord, candidateCache);
         }
 
         // Mistyped space
@@ -639,7 +594,8 @@ void UnigramDictionary::getMultiWordsSuggestionRec(ProximityInfo *proximityInfo,
         getSubStringSuggestion(proximityInfo, xcoordinates, ycoordinates, codes,
                 useFullEditDistance, correction, queuePool, inputSize, hasAutoCorrectionCandidate,
                 startWordIndex + 1, inputWordStartPos, inputWordLength, tempOutputWordLength,
-                true /* mistyped space */, freqArray, wordLengthArray, outputWord, 0);
+                true /* mistyped space */, freqArray, wordLengthArray, outputWord, 0,
+                candidateCache);
     }
 }
 
@@ -660,21 +616,85 @@ void UnigramDictionary::getSplitMultipleWordsSuggestions(ProximityInfo *proximit
     const int outputWordLength = 0;
     const int startInputPos = 0;
     const int startWordIndex = 0;
+    SubStringCandidateCache candidateCache;
     getMultiWordsSuggestionRec(proximityInfo, xcoordinates, ycoordinates, codes,
             useFullEditDistance, inputSize, correction, queuePool, hasAutoCorrectionCandidate,
             startInputPos, startWordIndex, outputWordLength, freqArray, wordLengthArray,
-            outputWord);
+            outputWord, &candidateCache);
+    // The suggestions are output with the correction as the last lookup left it.
+    const SubStringCandidateCache::Candidate *const reusedCandidate =
+            candidateCache.getReusedCandidate();
+    if (reusedCandidate) {
+        if (reusedCandidate->mHasSearchedCorrections) {
+            const int offset = reusedCandidate->mStartPos;
+            initSuggestions(proximityInfo, &xcoordinates[offset], &ycoordinates[offset],
+                    codes + offset, reusedCandidate->mLength, correction);
+        } else {
+            initSuggestions(proximityInfo, xcoordinates, ycoordinates, codes, inputSize,
+                    correction);
+        }
+    }
 }
 
 // Wrapper for getMostProbableWordLikeInner, which matches it to the previous
-// interface.
+// interface. Each digraph of the substring is tried both as typed and as its composite glyph, so
+// that "ueber" finds "[u-umlaut]ber"; wordLength receives the length of the word found.
 int UnigramDictionary::getMostProbableWordLike(const int startInputIndex, const int inputSize,
-        Correction *correction, int *word) const {
+        Correction *correction, int *word, int *wordLength) const {
     int inWord[inputSize];
     for (int i = 0; i < inputSize; ++i) {
         inWord[i] = correction->getPrimaryCodePointAt(startInputIndex + i);
     }
-    return getMostProbableWordLikeInner(inWord, inputSize, word);
+    const DigraphUtils::digraph_t *digraphs = 0;
+    const int digraphsSize =
+            DigraphUtils::getAllDigraphsForDictionaryAndReturnSize(DICT_FLAGS, &digraphs);
+    int digraphPositions[DEFAULT_MAX_DIGRAPH_SEARCH_DEPTH];
+    int digraphGlyphs[DEFAULT_MAX_DIGRAPH_SEARCH_DEPTH];
+    int digraphCount = 0;
+    for (int i = 0; i + 1 < inputSize && digraphCount < MAX_DIGRAPH_SEARCH_DEPTH; ++i) {
+        for (int j = 0; j < digraphsSize; ++j) {
+            if (digraphs[j].first == inWord[i] && digraphs[j].second == inWord[i + 1]) {
+                digraphPositions[digraphCount] = i;
+                digraphGlyphs[digraphCount] = digraphs[j].compositeGlyph;
+                ++digraphCount;
+                ++i;
+                break;
+            }
+        }
+    }
+    *wordLength = inputSize;
+    if (digraphCount == 0) {
+        return getMostProbableWordLikeInner(inWord, inputSize, word);
+    }
+    // The bit (digraphCount - 1 - i) of a spelling tells whether the digraph i is replaced with
+    // its glyph. The spellings with the glyphs are tried first, and the first word found of the
+    // highest probability is kept.
+    int maxFreq = -1;
+    int spelling[inputSize];
+    int spellingWord[MAX_WORD_LENGTH];
+    for (int spellingBits = (1 << digraphCount) - 1; spellingBits >= 0; --spellingBits) {
+        int spellingLength = 0;
+        int digraphIndex = 0;
+        for (int i = 0; i < inputSize; ++i) {
+            if (digraphIndex < digraphCount && digraphPositions[digraphIndex] == i) {
+                if (spellingBits & (1 << (digraphCount - 1 - digraphIndex))) {
+                    spelling[spellingLength++] = digraphGlyphs[digraphIndex];
+                    ++i;
+                    ++digraphIndex;
+                    continue;
+                }
+                ++digraphIndex;
+            }
+            spelling[spellingLength++] = inWord[i];
+        }
+        const int freq = getMostProbableWordLikeInner(spelling, spellingLength, spellingWord);
+        if (freq > maxFreq) {
+            memcpy(word, spellingWord, (spellingLength + 1) * sizeof(word[0]));
+            *wordLength = spellingLength;
+            maxFreq = freq;
+        }
+    }
+    return maxFreq;
 }
 
 // This function will take the position of a character array within a CharGroup,
@@ -806,8 +826,8 @@ int UnigramDictionary::getMostProbableWordLikeInner(const int *const inWord, con
 
 int UnigramDictionary::getProbability(const int *const inWord, const int length) const {
     const uint8_t *const root = DICT_ROOT;
-    int pos = BinaryFormat::getTerminalPosition(root, inWord, length,
-            false /* forceLowerCaseSearch */);
+    int pos = TerminalPositionIndex::getTerminalPosition(mTerminalPositionIndex, root, inWord,
+            length, false /* forceLowerCaseSearch */);
     if (NOT_VALID_WORD == pos) {
         return NOT_A_PROBABILITY;
     }
@@ -848,7 +868,7 @@ int UnigramDictionary::getBigramPosition(int pos, int *word, int offset, int len
 // the current node in nextSiblingPosition. Thus, the caller must keep count of the nodes at any
 // given level, as output into newCount when traversing this level's parent.
 bool UnigramDictionary::processCurrentNode(const int initialPos,
-        const std::map<int, int> *bigramMap, const uint8_t *bigramFilter, Correction *correction,
+        const BigramProbabilityMap *bigramMap, Correction *correction,
         int *newCount, int *newChildrenPosition, int *nextSiblingPosition,
         WordsPriorityQueuePool *queuePool, const int currentWordIndex) const {
     if (DEBUG_DICT) {
@@ -931,10 +951,9 @@ bool UnigramDictionary::processCurrentNode(const int initialPos,
                 BinaryFormat::readProbabilityWithoutMovingPointer(DICT_ROOT, pos);
         const int childrenAddressPos = BinaryFormat::skipProbability(flags, pos);
         const int attributesPos = BinaryFormat::skipChildrenPosition(flags, childrenAddressPos);
-        TerminalAttributes terminalAttributes(DICT_ROOT, flags, attributesPos);
+        TerminalAttributes terminalAttributes(DICT_ROOT, flags, attributesPos, mShortcutTable);
         // bigramMap contains the bigram frequencies indexed by addresses for fast lookup.
-        // bigramFilter is a bloom filter of said frequencies for even faster rejection.
-        const int probability = BinaryFormat::getProbability(initialPos, bigramMap, bigramFilter,
+        const int probability = BinaryFormat::getProbability(initialPos, bigramMap,
                 unigramProbability);
         onTerminal(probability, terminalAttributes, correction, queuePool, needsToInvokeOnTerminal,
                 currentWordIndex);
@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "LatinIME: updatable_dictionary.cpp"
+
+#include "updatable_dictionary.h"
+
+#include <algorithm>
+
+#include "binary_format.h"
+#include "dictionary.h"
+
+namespace latinime {
+
+const int UpdatableDictionary::ROOT_NODE = 0;
+
+// The children addresses and the bigram addresses are always written on three bytes, so that the
+// size of each group is known before the positions of the others.
+static const int ADDRESS_SIZE = 3;
+static const int BIGRAM_SIZE = 1 /* flags */ + ADDRESS_SIZE;
+// The largest offset that fits on three bytes
+static const int MAX_IMAGE_SIZE = 1 << (8 * ADDRESS_SIZE);
+// Magic number (4 bytes), version (2 bytes), flags (2 bytes) and header size (4 bytes), with no
+// attributes
+static const int HEADER_SIZE = 12;
+static const int FORMAT_VERSION = 2;
+// A children array with more groups than this writes its count on two bytes.
+static const int MAX_ONE_BYTE_GROUP_COUNT = 0x7F;
+
+static int getCodePointSize(const int codePoint) {
+    return (codePoint >= BinaryFormat::MINIMAL_ONE_BYTE_CHARACTER_VALUE && codePoint <= 0xFF)
+            ? 1 : 3;
+}
+
+static void writeBytes(const int value, const int size, uint8_t *const out) {
+    for (int i = 0; i < size; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * (size - 1 - i)));
+    }
+}
+
+// Orders the children of a node by code point, as makedict writes them.
+class NodeCodePointComparator {
+ public:
+    explicit NodeCodePointComparator(const std::vector<int> *const codePoints)
+            : mCodePoints(codePoints) {}
+
+    bool operator()(const int left, const int right) const {
+        return (*mCodePoints)[left] < (*mCodePoints)[right];
+    }
+
+ private:
+    const std::vector<int> *mCodePoints;
+};
+
+UpdatableDictionary::UpdatableDictionary()
+        : mNodes(), mBigrams(), mImage(), mUpdatedNodes(), mUpdatedBigrams(),
+          mHasStructureChanged(true), mDictionary(0), mRetiredDictionaries() {
+    mNodes.push_back(Node(NOT_AN_INDEX, NOT_A_CODE_POINT));
+}
+
+UpdatableDictionary::~UpdatableDictionary() {
+    for (int i = 0; i < static_cast<int>(mRetiredDictionaries.size()); ++i) {
+        delete mRetiredDictionaries[i].first;
+        delete mRetiredDictionaries[i].second;
+    }
+    delete mDictionary;
+}
+
+int UpdatableDictionary::findNode(const int *const word, const int length) const {
+    if (length <= 0 || length > MAX_WORD_LENGTH) {
+        return NOT_AN_INDEX;
+    }
+    int nodeIndex = ROOT_NODE;
+    for (int i = 0; i < length; ++i) {
+        int child = mNodes[nodeIndex].mFirstChild;
+        while (child != NOT_AN_INDEX && mNodes[child].mCodePoint != word[i]) {
+            child = mNodes[child].mNextSibling;
+        }
+        if (child == NOT_AN_INDEX) {
+            return NOT_AN_INDEX;
+        }
+        nodeIndex = child;
+    }
+    return nodeIndex;
+}
+
+int UpdatableDictionary::findOrAddNode(const int *const word, const int length) {
+    if (length <= 0 || length > MAX_WORD_LENGTH) {
+        return NOT_AN_INDEX;
+    }
+    int nodeIndex = ROOT_NODE;
+    for (int i = 0; i < length; ++i) {
+        int child = mNodes[nodeIndex].mFirstChild;
+        while (child != NOT_AN_INDEX && mNodes[child].mCodePoint != word[i]) {
+            child = mNodes[child].mNextSibling;
+        }
+        if (child == NOT_AN_INDEX) {
+            // Appended, so that a child is always after its parent in the pool.
+            child = static_cast<int>(mNodes.size());
+            mNodes.push_back(Node(nodeIndex, word[i]));
+            mNodes[child].mNextSibling = mNodes[nodeIndex].mFirstChild;
+            mNodes[nodeIndex].mFirstChild = child;
+        }
+        nodeIndex = child;
+    }
+    return nodeIndex;
+}
+
+bool UpdatableDictionary::addUnigramWord(const int *const word, const int length,
+        const int probability, const bool isNotAWord) {
+    if (USE_BMP_CODE_POINTS) {
+        for (int i = 0; i < length; ++i) {
+            if (word[i] > MAX_BMP_CODE_POINT) {
+                return false;
+            }
+        }
+    }
+    const int nodeIndex = findOrAddNode(word, length);
+    if (nodeIndex == NOT_AN_INDEX) {
+        return false;
+    }
+    Node *const node = &mNodes[nodeIndex];
+    const int clampedProbability = std::min(std::max(probability, 0), MAX_PROBABILITY);
+    if (node->mProbability == NOT_A_PROBABILITY || node->mIsNotAWord != isNotAWord) {
+        mHasStructureChanged = true;
+    } else if (node->mProbability != clampedProbability) {
+        mUpdatedNodes.push_back(nodeIndex);
+    }
+    node->mProbability = clampedProbability;
+    node->mIsNotAWord = isNotAWord;
+    return true;
+}
+
+bool UpdatableDictionary::addBigramWords(const int *const word0, const int length0,
+        const int *const word1, const int length1, const int probability) {
+    const int nodeIndex0 = findNode(word0, length0);
+    const int nodeIndex1 = findNode(word1, length1);
+    if (nodeIndex0 == NOT_AN_INDEX || nodeIndex1 == NOT_AN_INDEX
+            || mNodes[nodeIndex0].mProbability == NOT_A_PROBABILITY
+            || mNodes[nodeIndex1].mProbability == NOT_A_PROBABILITY) {
+        return false;
+    }
+    const int clampedProbability =
+            std::min(std::max(probability, 0), MAX_BIGRAM_ENCODED_PROBABILITY);
+    for (int bigram = mNodes[nodeIndex0].mFirstBigram; bigram != NOT_AN_INDEX;
+            bigram = mBigrams[bigram].mNext) {
+        if (mBigrams[bigram].mTargetNode == nodeIndex1) {
+            if (mBigrams[bigram].mProbability == NOT_A_PROBABILITY) {
+                // Removed with its target, so it is not in the image.
+                mHasStructureChanged = true;
+            } else if (mBigrams[bigram].mProbability != clampedProbability) {
+                mUpdatedBigrams.push_back(bigram);
+            }
+            mBigrams[bigram].mProbability = clampedProbability;
+            return true;
+        }
+    }
+    mBigrams.push_back(Bigram(nodeIndex1, clampedProbability, mNodes[nodeIndex0].mFirstBigram));
+    mNodes[nodeIndex0].mFirstBigram = static_cast<int>(mBigrams.size()) - 1;
+    mHasStructureChanged = true;
+    return true;
+}
+
+bool UpdatableDictionary::removeUnigramWord(const int *const word, const int length) {
+    const int nodeIndex = findNode(word, length);
+    if (nodeIndex == NOT_AN_INDEX || mNodes[nodeIndex].mProbability == NOT_A_PROBABILITY) {
+        return false;
+    }
+    // The nodes stay in the pool, but are not written anymore if they lead to no other word.
+    mNodes[nodeIndex].mProbability = NOT_A_PROBABILITY;
+    mNodes[nodeIndex].mFirstBigram = NOT_AN_INDEX;
+    for (int i = 0; i < static_cast<int>(mBigrams.size()); ++i) {
+        if (mBigrams[i].mTargetNode == nodeIndex) {
+            mBigrams[i].mProbability = NOT_A_PROBABILITY;
+        }
+    }
+    mHasStructureChanged = true;
+    return true;
+}
+
+int UpdatableDictionary::getProbability(const int *const word, const int length) const {
+    const int nodeIndex = findNode(word, length);
+    if (nodeIndex == NOT_AN_INDEX || mNodes[nodeIndex].mIsNotAWord) {
+        return NOT_A_PROBABILITY;
+    }
+    return mNodes[nodeIndex].mProbability;
+}
+
+Dictionary *UpdatableDictionary::flush() {
+    if (mDictionary && !mHasStructureChanged && mUpdatedNodes.empty()
+            && mUpdatedBigrams.empty()) {
+        return mDictionary;
+    }
+    if (mHasStructureChanged || !mDictionary) {
+        std::vector<uint8_t> image;
+        if (!writeImage(&image)) {
+            return mDictionary;
+        }
+        retireDictionary();
+        mImage.swap(image);
+    } else {
+        // Only the probabilities changed, so the image keeps its layout and a copy of it is
+        // patched, as the dictionary of the previous flush may still read it.
+        std::vector<uint8_t> image(mImage);
+        retireDictionary();
+        mImage.swap(image);
+        patchImage();
+    }
+    // The dictionary decodes its indexes when created, so it is created again even when the image
+    // is only patched.
+    mDictionary = new Dictionary(&mImage[0], static_cast<int>(mImage.size()), 0 /* mmapFd */,
+            0 /* dictBufAdjust */, 0 /* loadOptions */);
+    mUpdatedNodes.clear();
+    mUpdatedBigrams.clear();
+    mHasStructureChanged = false;
+    return mDictionary;
+}
+
+void UpdatableDictionary::releaseFlushedDictionary(const Dictionary *const dictionary) {
+    for (int i = 0; i < static_cast<int>(mRetiredDictionaries.size()); ++i) {
+        if (mRetiredDictionaries[i].first == dictionary) {
+            delete mRetiredDictionaries[i].first;
+            delete mRetiredDictionaries[i].second;
+            mRetiredDictionaries.erase(mRetiredDictionaries.begin() + i);
+            return;
+        }
+    }
+}
+
+void UpdatableDictionary::retireDictionary() {
+    if (!mDictionary) return;
+    // Swapping keeps the buffer that the dictionary reads.
+    std::vector<uint8_t> *const image = new std::vector<uint8_t>();
+    image->swap(mImage);
+    mRetiredDictionaries.push_back(std::make_pair(mDictionary, image));
+    mDictionary = 0;
+}
+
+void UpdatableDictionary::patchImage() {
+    for (int i = 0; i < static_cast<int>(mUpdatedNodes.size()); ++i) {
+        const Node &node = mNodes[mUpdatedNodes[i]];
+        mImage[node.mProbabilityPos] = static_cast<uint8_t>(node.mProbability);
+    }
+    for (int i = 0; i < static_cast<int>(mUpdatedBigrams.size()); ++i) {
+        const Bigram &bigram = mBigrams[mUpdatedBigrams[i]];
+        uint8_t *const flags = &mImage[bigram.mFlagsPos];
+        *flags = static_cast<uint8_t>((*flags & ~BinaryFormat::MASK_ATTRIBUTE_PROBABILITY)
+                | bigram.mProbability);
+    }
+}
+
+bool UpdatableDictionary::isBigramWritten(const Bigram &bigram) const {
+    return bigram.mProbability != NOT_A_PROBABILITY
+            && mNodes[bigram.mTargetNode].mProbability != NOT_A_PROBABILITY;
+}
+
+// Writes the children arrays in breadth-first order, so that the children of a group are always
+// after it and its children address is a positive offset, as makedict does.
+bool UpdatableDictionary::writeImage(std::vector<uint8_t> *const outImage) {
+    const int nodeCount = static_cast<int>(mNodes.size());
+    // Only the nodes leading to a word are written. A node is always after its parent in the pool.
+    std::vector<bool> isWritten(nodeCount, false);
+    std::vector<bool> hasWrittenChildren(nodeCount, false);
+    for (int i = nodeCount - 1; i > ROOT_NODE; --i) {
+        if (mNodes[i].mProbability != NOT_A_PROBABILITY) {
+            isWritten[i] = true;
+        }
+        if (isWritten[i]) {
+            isWritten[mNodes[i].mParent] = true;
+            hasWrittenChildren[mNodes[i].mParent] = true;
+        }
+    }
+    std::vector<int> codePoints(nodeCount);
+    for (int i = 0; i < nodeCount; ++i) {
+        codePoints[i] = mNodes[i].mCodePoint;
+    }
+
+    // The groups in the order of the image. The groups of the children array a are from
+    // arrayStarts[a] to arrayStarts[a + 1], and they are the children of arrayParents[a].
+    std::vector<int> groups;
+    std::vector<int> arrayStarts;
+    std::vector<int> arrayParents(1, ROOT_NODE);
+    for (int a = 0; a < static_cast<int>(arrayParents.size()); ++a) {
+        arrayStarts.push_back(static_cast<int>(groups.size()));
+        for (int child = mNodes[arrayParents[a]].mFirstChild; child != NOT_AN_INDEX;
+                child = mNodes[child].mNextSibling) {
+            if (isWritten[child]) {
+                groups.push_back(child);
+            }
+        }
+        std::sort(groups.begin() + arrayStarts[a], groups.end(),
+                NodeCodePointComparator(&codePoints));
+        for (int g = arrayStarts[a]; g < static_cast<int>(groups.size()); ++g) {
+            if (hasWrittenChildren[groups[g]]) {
+                arrayParents.push_back(groups[g]);
+            }
+        }
+    }
+    arrayStarts.push_back(static_cast<int>(groups.size()));
+
+    // The positions from the root, which is right after the header
+    std::vector<int> groupPositions(nodeCount, NOT_AN_INDEX);
+    std::vector<int> childrenPositions(nodeCount, NOT_AN_INDEX);
+    int pos = 0;
+    for (int a = 0; a < static_cast<int>(arrayParents.size()); ++a) {
+        childrenPositions[arrayParents[a]] = pos;
+        const int groupCount = arrayStarts[a + 1] - arrayStarts[a];
+        pos += (groupCount > MAX_ONE_BYTE_GROUP_COUNT) ? 2 : 1;
+        for (int g = arrayStarts[a]; g < arrayStarts[a + 1]; ++g) {
+            const Node &node = mNodes[groups[g]];
+            groupPositions[groups[g]] = pos;
+            pos += 1 /* flags */ + getCodePointSize(node.mCodePoint);
+            if (node.mProbability != NOT_A_PROBABILITY) {
+                pos += 1 /* probability */;
+                for (int bigram = node.mFirstBigram; bigram != NOT_AN_INDEX;
+                        bigram = mBigrams[bigram].mNext) {
+                    if (isBigramWritten(mBigrams[bigram])) {
+                        pos += BIGRAM_SIZE;
+                    }
+                }
+            }
+            if (hasWrittenChildren[groups[g]]) {
+                pos += ADDRESS_SIZE;
+            }
+        }
+    }
+    if (HEADER_SIZE + pos >= MAX_IMAGE_SIZE) {
+        AKLOGE("Too many words to write: %d bytes", HEADER_SIZE + pos);
+        return false;
+    }
+
+    outImage->assign(HEADER_SIZE + pos, 0);
+    uint8_t *const header = &(*outImage)[0];
+    writeBytes(BinaryFormat::FORMAT_VERSION_2_MAGIC_NUMBER, 4, header);
+    writeBytes(FORMAT_VERSION, 2, header + 4);
+    writeBytes(0 /* flags */, 2, header + 6);
+    writeBytes(HEADER_SIZE, 4, header + 8);
+    uint8_t *const root = header + HEADER_SIZE;
+    for (int i = 0; i < nodeCount; ++i) {
+        mNodes[i].mProbabilityPos = NOT_AN_INDEX;
+    }
+    for (int i = 0; i < static_cast<int>(mBigrams.size()); ++i) {
+        mBigrams[i].mFlagsPos = NOT_AN_INDEX;
+    }
+    for (int a = 0; a < static_cast<int>(arrayParents.size()); ++a) {
+        pos = childrenPositions[arrayParents[a]];
+        const int groupCount = arrayStarts[a + 1] - arrayStarts[a];
+        if (groupCount > MAX_ONE_BYTE_GROUP_COUNT) {
+            writeBytes(0x8000 | groupCount, 2, &root[pos]);
+            pos += 2;
+        } else {
+            root[pos++] = static_cast<uint8_t>(groupCount);
+        }
+        for (int g = arrayStarts[a]; g < arrayStarts[a + 1]; ++g) {
+            const int nodeIndex = groups[g];
+            Node *const node = &mNodes[nodeIndex];
+            const bool isTerminal = node->mProbability != NOT_A_PROBABILITY;
+            int bigramCount = 0;
+            if (isTerminal) {
+                for (int bigram = node->mFirstBigram; bigram != NOT_AN_INDEX;
+                        bigram = mBigrams[bigram].mNext) {
+                    if (isBigramWritten(mBigrams[bigram])) {
+                        ++bigramCount;
+                    }
+                }
+            }
+            root[pos++] = static_cast<uint8_t>((hasWrittenChildren[nodeIndex]
+                    ? BinaryFormat::FLAG_GROUP_ADDRESS_TYPE_THREEBYTES
+                    : BinaryFormat::FLAG_GROUP_ADDRESS_TYPE_NOADDRESS)
+                    | (isTerminal ? BinaryFormat::FLAG_IS_TERMINAL : 0)
+                    | (bigramCount > 0 ? BinaryFormat::FLAG_HAS_BIGRAMS : 0)
+                    | (node->mIsNotAWord ? BinaryFormat::FLAG_IS_NOT_A_WORD : 0));
+            const int codePointSize = getCodePointSize(node->mCodePoint);
+            writeBytes(node->mCodePoint, codePointSize, &root[pos]);
+            pos += codePointSize;
+            if (isTerminal) {
+                node->mProbabilityPos = HEADER_SIZE + pos;
+                root[pos++] = static_cast<uint8_t>(node->mProbability);
+            }
+            if (hasWrittenChildren[nodeIndex]) {
+                writeBytes(childrenPositions[nodeIndex] - pos, ADDRESS_SIZE, &root[pos]);
+                pos += ADDRESS_SIZE;
+            }
+            for (int bigram = node->mFirstBigram; bigramCount > 0 && bigram != NOT_AN_INDEX;
+                    bigram = mBigrams[bigram].mNext) {
+                if (!isBigramWritten(mBigrams[bigram])) {
+                    continue;
+                }
+                --bigramCount;
+                mBigrams[bigram].mFlagsPos = HEADER_SIZE + pos;
+                // The offset is from the address, which is after the flags.
+                const int offset = groupPositions[mBigrams[bigram].mTargetNode] - (pos + 1);
+                root[pos++] = static_cast<uint8_t>((bigramCount > 0
+                        ? BinaryFormat::FLAG_ATTRIBUTE_HAS_NEXT : 0)
+                        | (offset < 0 ? BinaryFormat::FLAG_ATTRIBUTE_OFFSET_NEGATIVE : 0)
+                        | BinaryFormat::FLAG_ATTRIBUTE_ADDRESS_TYPE_THREEBYTES
+                        | mBigrams[bigram].mProbability);
+                writeBytes(offset < 0 ? -offset : offset, ADDRESS_SIZE, &root[pos]);
+                pos += ADDRESS_SIZE;
+            }
+        }
+    }
+    return true;
+}
+} // namespace latinime
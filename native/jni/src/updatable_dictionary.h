@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LATINIME_UPDATABLE_DICTIONARY_H
+#define LATINIME_UPDATABLE_DICTIONARY_H
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "defines.h"
+#include "memory_utils.h"
+
+namespace latinime {
+
+class Dictionary;
+
+/**
+ * A dictionary that words and bigrams are added to while typing, for the user and the history
+ * dictionaries. The words are kept in an append-only pool of nodes whose probabilities are
+ * updated in place, and flush() writes them in the binary format to an image read by a
+ * Dictionary, so that they are queried by the same engine as the dictionaries opened from a file.
+ * A flush after changes of probabilities only patches a copy of the image of the previous flush
+ * instead of writing it again. Not thread safe, but each dictionary returned by flush() reads an
+ * image of its own, so it may be queried while words are added or the dictionary is flushed
+ * again, until it is released.
+ */
+class UpdatableDictionary {
+ public:
+    UpdatableDictionary();
+    ~UpdatableDictionary();
+
+    // Adds the word, or updates its probability if it is already there. Returns false if the
+    // word is empty or too long, or has code points beyond the BMP with USE_BMP_CODE_POINTS.
+    bool addUnigramWord(const int *const word, const int length, const int probability,
+            const bool isNotAWord);
+    // Adds the bigram from word0 to word1, or updates its probability, which is encoded like the
+    // probabilities of the bigrams of the binary format. Returns false if either word is not in
+    // the dictionary.
+    bool addBigramWords(const int *const word0, const int length0, const int *const word1,
+            const int length1, const int probability);
+    // Removes the word along with its bigrams. Returns false if it is not in the dictionary.
+    bool removeUnigramWord(const int *const word, const int length);
+    // Returns the probability of the word, or NOT_A_PROBABILITY. Changes are seen before they
+    // are flushed.
+    int getProbability(const int *const word, const int length) const;
+    // Makes the changes visible to the queries and returns the dictionary to query. The
+    // dictionary of the previous flush stays valid until releaseFlushedDictionary() is called
+    // for it, or this is deleted.
+    Dictionary *flush();
+    // Deletes a dictionary returned by a previous flush, which the last one replaced, and its
+    // image. Does nothing for the dictionary of the last flush.
+    void releaseFlushedDictionary(const Dictionary *const dictionary);
+    // The bytes allocated for the words and the bigrams. The image is the data of the dictionary
+    // returned by flush(), which accounts for it.
+    int getMemorySize() const {
+        return MemoryUtils::getVectorMemorySize(&mNodes)
+                + MemoryUtils::getVectorMemorySize(&mBigrams)
+                + MemoryUtils::getVectorMemorySize(&mUpdatedNodes)
+                + MemoryUtils::getVectorMemorySize(&mUpdatedBigrams);
+    }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(UpdatableDictionary);
+
+    struct Node {
+        Node(const int parent, const int codePoint)
+                : mParent(parent), mCodePoint(codePoint), mProbability(NOT_A_PROBABILITY),
+                  mIsNotAWord(false), mFirstChild(NOT_AN_INDEX), mNextSibling(NOT_AN_INDEX),
+                  mFirstBigram(NOT_AN_INDEX), mProbabilityPos(NOT_AN_INDEX) {}
+
+        int mParent;
+        int mCodePoint;
+        // NOT_A_PROBABILITY if the node does not end a word
+        int mProbability;
+        bool mIsNotAWord;
+        int mFirstChild;
+        int mNextSibling;
+        int mFirstBigram;
+        // The position of the probability in the image, or NOT_AN_INDEX if it was not written
+        int mProbabilityPos;
+    };
+
+    struct Bigram {
+        Bigram(const int targetNode, const int probability, const int next)
+                : mTargetNode(targetNode), mProbability(probability), mNext(next),
+                  mFlagsPos(NOT_AN_INDEX) {}
+
+        int mTargetNode;
+        int mProbability;
+        int mNext;
+        // The position of the flags holding the probability in the image, or NOT_AN_INDEX
+        int mFlagsPos;
+    };
+
+    static const int ROOT_NODE;
+
+    int findNode(const int *const word, const int length) const;
+    int findOrAddNode(const int *const word, const int length);
+    bool isBigramWritten(const Bigram &bigram) const;
+    // Writes the whole image, and the positions of the probabilities in it. Returns false if the
+    // words do not fit in the binary format.
+    bool writeImage(std::vector<uint8_t> *const outImage);
+    // Writes the probabilities that changed at their positions in the image.
+    void patchImage();
+    // Keeps the dictionary of the last flush and its image until they are released.
+    void retireDictionary();
+
+    std::vector<Node> mNodes;
+    std::vector<Bigram> mBigrams;
+    std::vector<uint8_t> mImage;
+    // The nodes and the bigrams whose probability changed since the last flush
+    std::vector<int> mUpdatedNodes;
+    std::vector<int> mUpdatedBigrams;
+    // Whether words or bigrams were added or removed since the last flush
+    bool mHasStructureChanged;
+    Dictionary *mDictionary;
+    // The dictionaries of the previous flushes that are not released yet, with their images
+    std::vector<std::pair<Dictionary *, std::vector<uint8_t> *> > mRetiredDictionaries;
+};
+} // namespace latinime
+#endif // LATINIME_UPDATABLE_DICTIONARY_H
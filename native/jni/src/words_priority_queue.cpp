@@ -18,29 +18,31 @@
 
 namespace latinime {
 
+// Writes the queued words in the order of their scores, except for the word of the best
+// normalized score that goes first, straight from the word storage into the output buffers.
+// The normalized score, which needs an edit distance, is only computed for the words whose upper
+// bound could reach the best one so far. The queue is empty afterwards.
 int WordsPriorityQueue::outputSuggestions(const int *before, const int beforeLength,
         int *frequencies, int *outputCodePoints, int* outputTypes) {
     mHighestSuggestedWord = 0;
-    const int size = min(MAX_WORDS, static_cast<int>(mSuggestions.size()));
-    SuggestedWord *swBuffer[size];
-    int index = size - 1;
-    while (!mSuggestions.empty() && index >= 0) {
-        SuggestedWord *sw = mSuggestions.top();
-        if (DEBUG_WORDS_PRIORITY_QUEUE) {
-            AKLOGI("dump word. %d", sw->mScore);
-            DUMP_WORD(sw->mWord, sw->mWordLength);
+    const int size = mSize;
+    // Sorts the heap in place, from the highest score to the lowest one.
+    std::sort_heap(mSuggestions, mSuggestions + size, wordComparator());
+    if (DEBUG_WORDS_PRIORITY_QUEUE) {
+        for (int i = size - 1; i >= 0; --i) {
+            AKLOGI("dump word. %d", mSuggestions[i]->mScore);
+            DUMP_WORD(mSuggestions[i]->mWord, mSuggestions[i]->mWordLength);
         }
-        swBuffer[index] = sw;
-        mSuggestions.pop();
-        --index;
     }
     if (size >= 2) {
         SuggestedWord *nsMaxSw = 0;
         int maxIndex = 0;
         float maxNs = 0;
         for (int i = 0; i < size; ++i) {
-            SuggestedWord *tempSw = swBuffer[i];
-            if (!tempSw) {
+            SuggestedWord *tempSw = mSuggestions[i];
+            // Words are visited from the highest score, so most of them are bounded out.
+            if (Correction::RankingAlgorithm::calcNormalizedScoreUpperBound(beforeLength,
+                    tempSw->mWord, tempSw->mWordLength, tempSw->mScore) < maxNs) {
                 continue;
             }
             const float tempNs = getNormalizedScore(tempSw, before, beforeLength, 0, 0, 0);
@@ -51,16 +53,12 @@ int WordsPriorityQueue::outputSuggestions(const int *before, const int beforeLen
             }
         }
         if (maxIndex > 0 && nsMaxSw) {
-            memmove(&swBuffer[1], &swBuffer[0], maxIndex * sizeof(swBuffer[0]));
-            swBuffer[0] = nsMaxSw;
+            memmove(&mSuggestions[1], &mSuggestions[0], maxIndex * sizeof(mSuggestions[0]));
+            mSuggestions[0] = nsMaxSw;
         }
     }
     for (int i = 0; i < size; ++i) {
-        SuggestedWord *sw = swBuffer[i];
-        if (!sw) {
-            AKLOGE("SuggestedWord is null %d", i);
-            continue;
-        }
+        const SuggestedWord *const sw = mSuggestions[i];
         const int wordLength = sw->mWordLength;
         int *targetAddress = outputCodePoints + i * MAX_WORD_LENGTH;
         frequencies[i] = sw->mScore;
@@ -69,8 +67,8 @@ int WordsPriorityQueue::outputSuggestions(const int *before, const int beforeLen
         if (wordLength < MAX_WORD_LENGTH) {
             targetAddress[wordLength] = 0;
         }
-        sw->mUsed = false;
     }
+    mSize = 0;
     return size;
 }
 } // namespace latinime
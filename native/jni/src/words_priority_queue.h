@@ -17,96 +17,91 @@
 #ifndef LATINIME_WORDS_PRIORITY_QUEUE_H
 #define LATINIME_WORDS_PRIORITY_QUEUE_H
 
+#include <algorithm> // for push_heap(), pop_heap() and sort_heap()
 #include <cstring> // for memcpy()
-#include <queue>
 
 #include "correction.h"
 #include "defines.h"
 
 namespace latinime {
 
+/**
+ * A priority queue of the best suggested words. The queue does not own its memory: the words are
+ * stored in a slice of the word storage arena of WordsPriorityQueuePool, and the heap of the
+ * queue is a slice of the heap storage arena of the pool. The heap always holds the words of the
+ * first size() slots of the word storage, so that clearing the queue only rewinds its size.
+ */
 class WordsPriorityQueue {
  public:
     struct SuggestedWord {
         int mScore;
         int mWord[MAX_WORD_LENGTH];
         int mWordLength;
-        bool mUsed;
         int mType;
 
         void setParams(int score, int *word, int wordLength, int type) {
             mScore = score;
             mWordLength = wordLength;
             memcpy(mWord, word, sizeof(mWord[0]) * wordLength);
-            mUsed = true;
             mType = type;
         }
     };
 
-    WordsPriorityQueue(int maxWords)
-            : mSuggestions(), MAX_WORDS(maxWords),
-              mSuggestedWords(new SuggestedWord[MAX_WORD_LENGTH]), mHighestSuggestedWord(0) {
-        for (int i = 0; i < MAX_WORD_LENGTH; ++i) {
-            mSuggestedWords[i].mUsed = false;
-        }
-    }
+    // wordStorage and heapStorage must have room for maxWords elements each.
+    WordsPriorityQueue(int maxWords, SuggestedWord *const wordStorage,
+            SuggestedWord **const heapStorage)
+            : MAX_WORDS(maxWords), mSuggestedWords(wordStorage), mSuggestions(heapStorage),
+              mSize(0), mHighestSuggestedWord(0) {}
 
     // Non virtual inline destructor -- never inherit this class
-    AK_FORCE_INLINE ~WordsPriorityQueue() {
-        delete[] mSuggestedWords;
-    }
+    AK_FORCE_INLINE ~WordsPriorityQueue() {}
 
     void push(int score, int *word, int wordLength, int type) {
         SuggestedWord *sw = 0;
         if (size() >= MAX_WORDS) {
-            sw = mSuggestions.top();
+            sw = top();
             const int minScore = sw->mScore;
             if (minScore >= score) {
                 return;
             }
-            sw->mUsed = false;
-            mSuggestions.pop();
-        }
-        if (sw == 0) {
-            sw = getFreeSuggestedWord(score, word, wordLength, type);
+            std::pop_heap(mSuggestions, mSuggestions + mSize, wordComparator());
+            --mSize;
         } else {
-            sw->setParams(score, word, wordLength, type);
-        }
-        if (sw == 0) {
-            AKLOGE("SuggestedWord is accidentally null.");
-            return;
+            // The slots of the queued words are the first size() ones.
+            sw = &mSuggestedWords[mSize];
         }
+        sw->setParams(score, word, wordLength, type);
         if (DEBUG_WORDS_PRIORITY_QUEUE) {
             AKLOGI("Push word. %d, %d", score, wordLength);
             DUMP_WORD(word, wordLength);
         }
-        mSuggestions.push(sw);
+        mSuggestions[mSize] = sw;
+        ++mSize;
+        std::push_heap(mSuggestions, mSuggestions + mSize, wordComparator());
         if (!mHighestSuggestedWord || mHighestSuggestedWord->mScore < sw->mScore) {
             mHighestSuggestedWord = sw;
         }
     }
 
     SuggestedWord *top() const {
-        if (mSuggestions.empty()) return 0;
-        SuggestedWord *sw = mSuggestions.top();
+        if (mSize == 0) return 0;
+        SuggestedWord *sw = mSuggestions[0];
         return sw;
     }
 
     int size() const {
-        return static_cast<int>(mSuggestions.size());
+        return mSize;
     }
 
     AK_FORCE_INLINE void clear() {
-        mHighestSuggestedWord = 0;
-        while (!mSuggestions.empty()) {
-            SuggestedWord *sw = mSuggestions.top();
-            if (DEBUG_WORDS_PRIORITY_QUEUE) {
-                AKLOGI("Clear word. %d", sw->mScore);
-                DUMP_WORD(sw->mWord, sw->mWordLength);
+        if (DEBUG_WORDS_PRIORITY_QUEUE) {
+            for (int i = 0; i < mSize; ++i) {
+                AKLOGI("Clear word. %d", mSuggestions[i]->mScore);
+                DUMP_WORD(mSuggestions[i]->mWord, mSuggestions[i]->mWordLength);
             }
-            sw->mUsed = false;
-            mSuggestions.pop();
         }
+        mHighestSuggestedWord = 0;
+        mSize = 0;
     }
 
     AK_FORCE_INLINE void dumpTopWord() const {
@@ -136,16 +131,6 @@ class WordsPriorityQueue {
         }
     };
 
-    SuggestedWord *getFreeSuggestedWord(int score, int *word, int wordLength, int type) const {
-        for (int i = 0; i < MAX_WORD_LENGTH; ++i) {
-            if (!mSuggestedWords[i].mUsed) {
-                mSuggestedWords[i].setParams(score, word, wordLength, type);
-                return &mSuggestedWords[i];
-            }
-        }
-        return 0;
-    }
-
     static float getNormalizedScore(SuggestedWord *sw, const int *before, const int beforeLength,
             int **outWord, int *outScore, int *outLength) {
         const int score = sw->mScore;
@@ -164,11 +149,11 @@ class WordsPriorityQueue {
                 wordLength, score);
     }
 
-    typedef std::priority_queue<SuggestedWord *, std::vector<SuggestedWord *>,
-            wordComparator> Suggestions;
-    Suggestions mSuggestions;
     const int MAX_WORDS;
-    SuggestedWord *mSuggestedWords;
+    SuggestedWord *const mSuggestedWords;
+    // A min heap on the scores, as ordered by std::push_heap() and std::pop_heap()
+    SuggestedWord **const mSuggestions;
+    int mSize;
     SuggestedWord *mHighestSuggestedWord;
 };
 } // namespace latinime
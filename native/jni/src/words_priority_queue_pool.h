@@ -22,16 +22,23 @@
 
 namespace latinime {
 
+// The master queue and the sub queues of a suggestion call. All the queues share one word storage
+// arena and one heap storage arena that live in the pool, so that building the pool allocates
+// nothing and clearing a queue is a rewind of its size.
 class WordsPriorityQueuePool {
  public:
     WordsPriorityQueuePool(int mainQueueMaxWords, int subQueueMaxWords)
             // Note: using placement new() requires the caller to call the destructor explicitly.
-            : mMasterQueue(new(mMasterQueueBuf) WordsPriorityQueue(mainQueueMaxWords)) {
-        for (int i = 0, subQueueBufOffset = 0;
+            : mMasterQueue(new(mMasterQueueBuf) WordsPriorityQueue(mainQueueMaxWords,
+                      mWordStorage, mHeapStorage)) {
+        ASSERT(mainQueueMaxWords <= MAX_RESULTS && subQueueMaxWords <= SUB_QUEUE_MAX_WORDS);
+        for (int i = 0, subQueueBufOffset = 0, storageOffset = MAX_RESULTS;
                 i < MULTIPLE_WORDS_SUGGESTION_MAX_WORDS * SUB_QUEUE_MAX_COUNT;
-                ++i, subQueueBufOffset += static_cast<int>(sizeof(WordsPriorityQueue))) {
+                ++i, subQueueBufOffset += static_cast<int>(sizeof(WordsPriorityQueue)),
+                storageOffset += SUB_QUEUE_MAX_WORDS) {
             mSubQueues[i] = new(mSubQueueBuf + subQueueBufOffset)
-                    WordsPriorityQueue(subQueueMaxWords);
+                    WordsPriorityQueue(subQueueMaxWords, mWordStorage + storageOffset,
+                            mHeapStorage + storageOffset);
         }
     }
 
@@ -91,6 +98,11 @@ class WordsPriorityQueuePool {
             * sizeof(WordsPriorityQueue)];
     WordsPriorityQueue *mMasterQueue;
     WordsPriorityQueue *mSubQueues[SUB_QUEUE_MAX_COUNT * MULTIPLE_WORDS_SUGGESTION_MAX_WORDS];
+    // The slots of the master queue, followed by those of each sub queue
+    WordsPriorityQueue::SuggestedWord mWordStorage[MAX_RESULTS
+            + SUB_QUEUE_MAX_COUNT * MULTIPLE_WORDS_SUGGESTION_MAX_WORDS * SUB_QUEUE_MAX_WORDS];
+    WordsPriorityQueue::SuggestedWord *mHeapStorage[MAX_RESULTS
+            + SUB_QUEUE_MAX_COUNT * MULTIPLE_WORDS_SUGGESTION_MAX_WORDS * SUB_QUEUE_MAX_WORDS];
 };
 } // namespace latinime
 #endif // LATINIME_WORDS_PRIORITY_QUEUE_POOL_H
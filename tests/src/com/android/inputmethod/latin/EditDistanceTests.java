@@ -92,6 +92,37 @@ public class EditDistanceTests extends AndroidTestCase {
                 0, dist);
     }
 
+    public void testBatch() {
+        final String before = "kitten";
+        final String[] afters = { "sitting", "", "kitten", "Kitten", "kittens", "iktten" };
+        final int[] dists = BinaryDictionary.editDistances(before, afters);
+        assertEquals("one distance is returned for each word", afters.length, dists.length);
+        for (int i = 0; i < afters.length; ++i) {
+            assertEquals("the batch distance to '" + afters[i] + "' is the single distance",
+                    BinaryDictionary.editDistance(before, afters[i]), dists[i]);
+        }
+    }
+
+    public void testBatchOfNoWords() {
+        final int[] dists = BinaryDictionary.editDistances("kitten", new String[0]);
+        assertEquals("no distances are returned for no words", 0, dists.length);
+    }
+
+    public void testBatchNullArg() {
+        try {
+            BinaryDictionary.editDistances(null, new String[] { "aaa" });
+            fail("IllegalArgumentException should be thrown.");
+        } catch (Exception e) {
+            assertTrue(e instanceof IllegalArgumentException);
+        }
+        try {
+            BinaryDictionary.editDistances("aaa", new String[] { "aaa", null });
+            fail("IllegalArgumentException should be thrown.");
+        } catch (Exception e) {
+            assertTrue(e instanceof IllegalArgumentException);
+        }
+    }
+
     public void testNullArg() {
         try {
             BinaryDictionary.editDistance(null, "aaa");
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.inputmethod.latin;
+
+import android.test.AndroidTestCase;
+import android.test.suitebuilder.annotation.SmallTest;
+
+import java.util.Locale;
+
+@SmallTest
+public class UpdatableBinaryDictionaryTests extends AndroidTestCase {
+    private BinaryDictionary mDictionary;
+
+    @Override
+    protected void setUp() throws Exception {
+        super.setUp();
+        mDictionary = new BinaryDictionary(true /* useFullEditDistance */, Locale.US,
+                Dictionary.TYPE_USER);
+    }
+
+    @Override
+    protected void tearDown() throws Exception {
+        mDictionary.close();
+        super.tearDown();
+    }
+
+    public void testAddedWordsAreFoundAfterFlush() {
+        assertTrue(mDictionary.isValidDictionary());
+        assertTrue(mDictionary.addUnigramWord("hello", 100, false /* isNotAWord */));
+        assertTrue(mDictionary.addUnigramWord("world", 120, false /* isNotAWord */));
+        assertFalse(mDictionary.isValidWord("hello"));
+        mDictionary.flushUpdates();
+        assertEquals(100, mDictionary.getFrequency("hello"));
+        assertEquals(120, mDictionary.getFrequency("world"));
+        assertFalse(mDictionary.isValidWord("hell"));
+    }
+
+    public void testProbabilityUpdate() {
+        mDictionary.addUnigramWord("hello", 100, false /* isNotAWord */);
+        mDictionary.flushUpdates();
+        mDictionary.addUnigramWord("hello", 200, false /* isNotAWord */);
+        mDictionary.flushUpdates();
+        assertEquals(200, mDictionary.getFrequency("hello"));
+    }
+
+    public void testBigrams() {
+        mDictionary.addUnigramWord("hello", 100, false /* isNotAWord */);
+        assertFalse(mDictionary.addBigramWords("hello", "world", 10));
+        mDictionary.addUnigramWord("world", 120, false /* isNotAWord */);
+        assertTrue(mDictionary.addBigramWords("hello", "world", 10));
+        mDictionary.flushUpdates();
+        assertTrue(mDictionary.isValidBigram("hello", "world"));
+        assertFalse(mDictionary.isValidBigram("world", "hello"));
+    }
+
+    public void testRemoveWord() {
+        mDictionary.addUnigramWord("hello", 100, false /* isNotAWord */);
+        mDictionary.addUnigramWord("help", 110, false /* isNotAWord */);
+        mDictionary.addBigramWords("help", "hello", 10);
+        mDictionary.flushUpdates();
+        assertTrue(mDictionary.removeUnigramWord("hello"));
+        assertFalse(mDictionary.removeUnigramWord("hello"));
+        mDictionary.flushUpdates();
+        assertFalse(mDictionary.isValidWord("hello"));
+        assertEquals(110, mDictionary.getFrequency("help"));
+        assertFalse(mDictionary.isValidBigram("help", "hello"));
+    }
+}
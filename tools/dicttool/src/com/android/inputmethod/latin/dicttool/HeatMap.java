@@ -0,0 +1,215 @@
+/**
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+
+package com.android.inputmethod.latin.dicttool;
+
+import com.android.inputmethod.latin.dicttool.BinaryDictOffdeviceUtils.DecoderChainSpec;
+import com.android.inputmethod.latin.makedict.BinaryDictInputOutput;
+import com.android.inputmethod.latin.makedict.CharGroupInfo;
+import com.android.inputmethod.latin.makedict.FormatSpec.FileHeader;
+import com.android.inputmethod.latin.makedict.FormatSpec.FormatOptions;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileReader;
+import java.io.IOException;
+import java.nio.channels.FileChannel;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.Comparator;
+import java.util.HashSet;
+import java.util.TreeMap;
+
+/**
+ * Shows the locality of the accesses to a binary dictionary recorded with
+ * BinaryDictionary.writeNativeHeatMap: how many pages the hot char groups are spread over in the
+ * current layout, and how few they would take if they were contiguous.
+ */
+public class HeatMap extends Dicttool.Command {
+    public static final String COMMAND = "heatmap";
+
+    private static final int PAGE_SIZE = 4096;
+    private static final int HOTTEST_RANGE_COUNT = 20;
+    private static final double[] COVERAGES = { 0.5, 0.9, 0.99, 1.0 };
+
+    // The bytes of a char group array or of a char group, and the reads recorded in them.
+    private static final class Range {
+        public final int mStart;
+        public final int mEnd;
+        public final String mDescription;
+        public long mReadCount;
+
+        public Range(final int start, final int end, final String description) {
+            mStart = start;
+            mEnd = end;
+            mDescription = description;
+        }
+    }
+
+    private static final Comparator<Range> HOTTEST_FIRST = new Comparator<Range>() {
+        @Override
+        public int compare(final Range range0, final Range range1) {
+            if (range0.mReadCount != range1.mReadCount) {
+                return range0.mReadCount > range1.mReadCount ? -1 : 1;
+            }
+            return range0.mStart - range1.mStart;
+        }
+    };
+
+    public HeatMap() {
+    }
+
+    @Override
+    public String getHelp() {
+        return COMMAND + " <dictionary> <heat map> : shows how the char groups read in a heat map"
+                + " recorded by\n  BinaryDictionary.writeNativeHeatMap are spread over the pages"
+                + " of the dictionary";
+    }
+
+    @Override
+    public void run() throws IOException {
+        if (mArgs.length != 2) {
+            throw new RuntimeException("Wrong number of arguments for command " + COMMAND);
+        }
+        final DecoderChainSpec decodedSpec =
+                BinaryDictOffdeviceUtils.getRawBinaryDictionaryOrNull(new File(mArgs[0]));
+        if (null == decodedSpec) {
+            throw new RuntimeException(mArgs[0] + " does not seem to be a dictionary file");
+        }
+        final FileInputStream inStream = new FileInputStream(decodedSpec.mFile);
+        final BinaryDictInputOutput.ByteBufferWrapper buffer =
+                new BinaryDictInputOutput.ByteBufferWrapper(inStream.getChannel().map(
+                        FileChannel.MapMode.READ_ONLY, 0, decodedSpec.mFile.length()));
+        final FileHeader header;
+        try {
+            header = BinaryDictInputOutput.readHeader(buffer);
+        } catch (Exception e) {
+            throw new RuntimeException("Can't read the header of " + mArgs[0], e);
+        }
+        if (header.mFormatOptions.mSupportsDynamicUpdate) {
+            throw new RuntimeException("Dictionaries with dynamic update are not supported");
+        }
+        // The positions of the heat map are relative to the end of the header, as the addresses
+        // read by readCharGroup.
+        final TreeMap<Integer, Range> arrays = new TreeMap<Integer, Range>();
+        final TreeMap<Integer, Range> groups = new TreeMap<Integer, Range>();
+        readArray(buffer, header, 0 /* address */, "", arrays, groups);
+        inStream.close();
+
+        final HashSet<Range> hotRanges = new HashSet<Range>();
+        long readCount = 0;
+        long unresolvedReadCount = 0;
+        final BufferedReader reader = new BufferedReader(new FileReader(mArgs[1]));
+        for (String line = reader.readLine(); null != line; line = reader.readLine()) {
+            if (line.isEmpty() || line.startsWith("#")) {
+                System.out.println(line);
+                continue;
+            }
+            final String[] fields = line.trim().split(" ");
+            final int position = Integer.parseInt(fields[0]);
+            final int count = Integer.parseInt(fields[1]);
+            readCount += count;
+            // The expanded arrays are recorded at their first group, the bigram reads inside a
+            // group.
+            Range range = arrays.get(position);
+            if (null == range) {
+                final Integer groupStart = groups.floorKey(position);
+                range = null == groupStart ? null : groups.get(groupStart);
+                if (null != range && position >= range.mEnd) range = null;
+            }
+            if (null == range) {
+                unresolvedReadCount += count;
+                continue;
+            }
+            range.mReadCount += count;
+            hotRanges.add(range);
+        }
+        reader.close();
+        System.out.println("Sampled reads : " + readCount + " (" + unresolvedReadCount
+                + " not at a char group of this dictionary)");
+        showLocality(new ArrayList<Range>(hotRanges), readCount - unresolvedReadCount);
+    }
+
+    // Reads the char group array at address and the arrays of its children, depth first.
+    private static void readArray(final BinaryDictInputOutput.ByteBufferWrapper buffer,
+            final FileHeader header, final int address, final String prefix,
+            final TreeMap<Integer, Range> arrays, final TreeMap<Integer, Range> groups) {
+        final FormatOptions options = header.mFormatOptions;
+        buffer.position(address + header.mHeaderSize);
+        final int count = BinaryDictInputOutput.readCharGroupCount(buffer);
+        final int firstGroupAddress = address + BinaryDictInputOutput.getGroupCountSize(count);
+        int groupAddress = firstGroupAddress;
+        final ArrayList<CharGroupInfo> infos = new ArrayList<CharGroupInfo>(count);
+        for (int i = 0; i < count; ++i) {
+            final CharGroupInfo info =
+                    BinaryDictInputOutput.readCharGroup(buffer, groupAddress, options);
+            infos.add(info);
+            groupAddress = info.mEndAddress;
+        }
+        arrays.put(firstGroupAddress, new Range(address, groupAddress,
+                "children of \"" + prefix + "\""));
+        for (final CharGroupInfo info : infos) {
+            final String word = prefix + new String(info.mCharacters, 0, info.mCharacters.length);
+            groups.put(info.mOriginalAddress,
+                    new Range(info.mOriginalAddress, info.mEndAddress, "\"" + word + "\""));
+            if (BinaryDictInputOutput.hasChildrenAddress(info.mChildrenAddress)) {
+                readArray(buffer, header, info.mChildrenAddress, word, arrays, groups);
+            }
+        }
+    }
+
+    private static void showLocality(final ArrayList<Range> hotRanges, final long readCount) {
+        Collections.sort(hotRanges, HOTTEST_FIRST);
+        System.out.println("Hot ranges : " + hotRanges.size());
+        System.out.println("Reads covered : bytes, pages touched, pages if contiguous");
+        int coverageIndex = 0;
+        long coveredReadCount = 0;
+        int bytes = 0;
+        final ArrayList<Range> coveredRanges = new ArrayList<Range>();
+        for (final Range range : hotRanges) {
+            coveredRanges.add(range);
+            coveredReadCount += range.mReadCount;
+            bytes += range.mEnd - range.mStart;
+            while (coverageIndex < COVERAGES.length
+                    && coveredReadCount >= COVERAGES[coverageIndex] * readCount) {
+                System.out.println("  " + (int)(COVERAGES[coverageIndex] * 100) + "% : " + bytes
+                        + ", " + countPages(coveredRanges) + ", "
+                        + (bytes + PAGE_SIZE - 1) / PAGE_SIZE);
+                ++coverageIndex;
+            }
+        }
+        System.out.println("Hottest ranges : reads, position, bytes");
+        for (int i = 0; i < HOTTEST_RANGE_COUNT && i < hotRanges.size(); ++i) {
+            final Range range = hotRanges.get(i);
+            System.out.println("  " + range.mReadCount + ", " + range.mStart + ", "
+                    + (range.mEnd - range.mStart) + " : " + range.mDescription);
+        }
+    }
+
+    // The pages touched by the ranges. A page is counted once even if several ranges touch it.
+    private static int countPages(final ArrayList<Range> ranges) {
+        final HashSet<Integer> pages = new HashSet<Integer>();
+        for (final Range range : ranges) {
+            for (int page = range.mStart / PAGE_SIZE; page <= (range.mEnd - 1) / PAGE_SIZE;
+                    ++page) {
+                pages.add(page);
+            }
+        }
+        return pages.size();
+    }
+}